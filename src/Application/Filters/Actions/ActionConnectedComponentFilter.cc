@@ -26,17 +26,17 @@
  DEALINGS IN THE SOFTWARE.
  */
 
-// ITK includes
-#include <itkConnectedComponentImageFilter.h>
+// Boost includes
+#include <boost/bind.hpp>
 
-#include <Core/DataBlock/StdDataBlock.h>
-#include <Core/DataBlock/ITKDataBlock.h>
+// Core includes
+#include <Core/DataBlock/ConnectedComponents.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
 
 // Application includes
 #include <Application/Layer/LayerManager.h>
 #include <Application/StatusBar/StatusBar.h>
-#include <Application/Filters/ITKFilter.h>
+#include <Application/Filters/LayerFilter.h>
 #include <Application/Filters/Actions/ActionConnectedComponentFilter.h>
 
 // REGISTER ACTION:
@@ -97,7 +97,7 @@ bool ActionConnectedComponentFilter::validate( Core::ActionContextHandle& contex
 // NOTE: The separation of the algorithm into a private class is for the purpose of running the
 // filter on a separate thread.
 
-class ConnectedComponentFilterAlgo : public ITKFilter
+class ConnectedComponentFilterAlgo : public LayerFilter
 {
 
 public:
@@ -109,290 +109,87 @@ public:
   bool invert_mask_;
   
 public:
-  // NOTE: The macro needs a data type to select which version to run. This needs to be
-  // a member variable of the algorithm class.
-  SCI_BEGIN_ITK_RUN()
+  // RUN_FILTER:
+  // Implemtation of run of the Runnable base class, this function is called when the thread
+  // is launched.
+
+  virtual void run_filter()
   {
-    // Define the type of filter that we use.
-    typedef itk::ConnectedComponentImageFilter< 
-      UCHAR_IMAGE_TYPE, USHORT_IMAGE_TYPE > filter_type;
-
-    // Retrieve the image as an itk image from the underlying data structure
-    // NOTE: This only does wrapping and does not regenerate the data.
-    Core::ITKImageDataT<unsigned char>::Handle input_image; 
-    this->get_itk_image_from_layer<unsigned char>( this->src_layer_, input_image );
-        
-    // Create a new ITK filter instantiation. 
-    filter_type::Pointer filter = filter_type::New();
-
-    // Relay abort and progress information to the layer that is executing the filter.
-    this->forward_abort_to_filter( filter, this->dst_layer_ );
-    this->observe_itk_progress( filter, this->dst_layer_, 0.0, 0.75 );
-    
-    // Setup the filter parameters that we do not want to change.
-    filter->SetInput( input_image->get_image() );
-
-    // Ensure we will have some threads left for doing something else
-    this->limit_number_of_itk_threads( filter );
-
-    // Run the actual ITK filter.
-    // This needs to be in a try/catch statement as certain filters throw exceptions when they
-    // are aborted. In that case we will relay a message to the status bar for information.
-
-    bool need_32bits = false;
-    try 
-    { 
-      filter->Update(); 
-    } 
-    catch ( ... ) 
+    // Label the components directly from the bits of the mask
+    Core::MaskDataBlockHandle src_mask = boost::dynamic_pointer_cast< MaskLayer >( 
+      this->src_layer_ )->get_mask_volume()->get_mask_data_block();
+    Core::ConnectedComponents components;
     {
-      if ( this->check_abort() )
-      {
-        this->report_error( "Filter was aborted." );
-        return;
-      }
-      if (  filter->GetObjectCount() > static_cast<unsigned long int>(
-        itk::NumericTraits<unsigned short>::max() ) )
-      {
-        need_32bits = true;
-      }
-      else
+      Core::MaskDataBlock::shared_lock_type lock( src_mask->get_mutex() );
+      if ( !components.label( src_mask, false, boost::bind( 
+        &ConnectedComponentFilterAlgo::update_labeling_progress, this, _1, 0.0, 0.75 ) ) )
       {
-        this->report_error( "ITK filter failed to complete." );
+        if ( !this->check_abort() ) this->report_error( "Could not allocate enough memory." );
         return;
       }
     }
 
-    // As ITK filters generate an inconsistent abort behavior, we record our own abort flag
-    // This one is set when the abort button is pressed and an abort is sent to ITK.
-    if ( this->check_abort() ) return;
-
-    Core::DataBlockHandle output_datablock;
-
-    if ( need_32bits )
-    {
-      filter = 0;
-    
-      // Define the type of filter that we use.
-      typedef itk::ConnectedComponentImageFilter< 
-        UCHAR_IMAGE_TYPE, UINT_IMAGE_TYPE > filter32_type;
-
-      // Retrieve the image as an itk image from the underlying data structure
-      // NOTE: This only does wrapping and does not regenerate the data.
-      Core::ITKImageDataT<unsigned char>::Handle input_image; 
-      this->get_itk_image_from_layer<unsigned char>( this->src_layer_, input_image );
-          
-      // Create a new ITK filter instantiation. 
-      filter32_type::Pointer filter32 = filter32_type::New();
-
-      // Relay abort and progress information to the layer that is executing the filter.
-      this->forward_abort_to_filter( filter32, this->dst_layer_ );
-      this->observe_itk_progress( filter32, this->dst_layer_, 0.0, 0.75 );
-      
-      // Setup the filter parameters that we do not want to change.
-      filter32->SetInput( input_image->get_image() );
-
-      // Ensure we will have some threads left for doing something else
-      this->limit_number_of_itk_threads( filter32 );
-
-      // Run the actual ITK filter.
-      // This needs to be in a try/catch statement as certain filters throw exceptions when they
-      // are aborted. In that case we will relay a message to the status bar for information.     
+    // Select the components that hold a seed point
+    std::vector< unsigned char > selected( components.get_num_components() + 1, 0 );
+    Core::Transform trans = this->src_layer_->get_grid_transform().get_inverse();
+    for ( size_t i = 0; i < this->seeds_.size(); ++i )
+    {   
+      Core::Point location = trans * this->seeds_[ i ];
+      int x = static_cast<int>( Core::Round( location.x() ) );
+      int y = static_cast<int>( Core::Round( location.y() ) );
+      int z = static_cast<int>( Core::Round( location.z() ) );
       
-      try 
-      { 
-        filter32->Update(); 
-      } 
-      catch ( ... ) 
-      {
-        if ( this->check_abort() )
-        {
-          this->report_error( "Filter was aborted." );
-          return;
-        }
-        this->report_error( "ITK filter failed to complete." );
-        return;
-      }
-    
-      // As ITK filters generate an inconsistent abort behavior, we record our own abort flag
-      // This one is set when the abort button is pressed and an abort is sent to ITK.
-      if ( this->check_abort() ) return;
-
-      output_datablock = Core::ITKDataBlock::New( filter32->GetOutput() );
-
-      if ( ! output_datablock )
-      {
-        this->report_error("Could not allocate enough memory.");
-        return;
-      }
-      
-      unsigned int max_label = filter32->GetObjectCount();
-      std::vector<unsigned int> lut( max_label + 1, 0 );
-      
-      Core::GridTransform grid = input_image->get_grid_transform();
-      Core::Transform trans = grid.get_inverse();
-      int nx = static_cast<int>( grid.get_nx() ); 
-      int ny = static_cast<int>( grid.get_ny() ); 
-      int nz = static_cast<int>( grid.get_nz() ); 
-      
-      unsigned int* data = reinterpret_cast<unsigned int*>( output_datablock->get_data() );
-      for ( size_t i = 0; i < this->seeds_.size(); ++i )
-      {   
-        Core::Point location = trans * seeds_[ i ];
-        int x = static_cast<int>( Core::Round( location.x() ) );
-        int y = static_cast<int>( Core::Round( location.y() ) );
-        int z = static_cast<int>( Core::Round( location.z() ) );
-        
-        if ( x >= 0 && y >= 0 && z >= 0 && x < nx && y < ny && z < nz )
-        {
-          unsigned int val = data[ output_datablock->to_index( static_cast<size_t>( x ), 
-            static_cast<size_t>( y ), static_cast<size_t>( z ) ) ];
-          if ( val ) lut[ val ] = 1;
-        }
-      }
-      
-      if ( this->mask_layer_ )
-      {
-        Core::MaskDataBlockHandle mask_handle = 
-          dynamic_cast<MaskLayer*>( this->mask_layer_.get() )->
-          get_mask_volume()->get_mask_data_block();
-          
-        unsigned char mask_value = mask_handle->get_mask_value();
-        size_t size = mask_handle->get_size();
-        unsigned char* mask_data = mask_handle->get_mask_data();
-        
-        Core::DataBlock::shared_lock_type lock( mask_handle->get_mutex() );
-        if ( this->invert_mask_ )
-        {
-          for ( size_t j = 0; j < size; j++ )
-          {
-            if ( ! ( mask_data[ j ] & mask_value ) && data[ j ] ) lut[ data[ j ] ] = 1;
-          }     
-        }
-        else
-        {
-          for ( size_t j = 0; j < size; j++ )
-          {
-            if ( ( mask_data[ j ] & mask_value ) && data[ j ] ) lut[ data[ j ] ] = 1;
-          }           
-        
-        }
-      }
-
-      this->dst_layer_->update_progress_signal_( 0.80 );
-      if ( this->check_abort() )
+      if ( x >= 0 && y >= 0 && z >= 0 )
       {
-        return;
-      }
-
-      size_t size = output_datablock->get_size();
-      for ( size_t j = 0; j < size; j++ )
-      {
-        data[ j ] = lut[ data[ j ] ];
+        selected[ components.get_label_at( static_cast<size_t>( x ), 
+          static_cast<size_t>( y ), static_cast<size_t>( z ) ) ] = 1;
       }
     }
-    else
-    {
-      // As ITK filters generate an inconsistent abort behavior, we record our own abort flag
-      // This one is set when the abort button is pressed and an abort is sent to ITK.
-      if ( this->check_abort() ) return;
-
-      output_datablock = Core::ITKDataBlock::New( filter->GetOutput() );    
     
-      if ( ! output_datablock )
-      {
-        this->report_error("Could not allocate enough memory.");
-        return;
-      }
-      
-      unsigned int max_label = filter->GetObjectCount();
-      std::vector<unsigned short> lut( max_label + 1, 0 );
-      
-      Core::GridTransform grid = input_image->get_grid_transform();
-      Core::Transform trans = grid.get_inverse();
-      int nx = static_cast<int>( grid.get_nx() ); 
-      int ny = static_cast<int>( grid.get_ny() ); 
-      int nz = static_cast<int>( grid.get_nz() ); 
-      
-      unsigned short* data = reinterpret_cast<unsigned short*>( output_datablock->get_data() );
-      for ( size_t i = 0; i < this->seeds_.size(); ++i )
-      {   
-        Core::Point location = trans * seeds_[ i ];
-        int x = static_cast<int>( Core::Round( location.x() ) );
-        int y = static_cast<int>( Core::Round( location.y() ) );
-        int z = static_cast<int>( Core::Round( location.z() ) );
-        
-        if ( x >= 0 && y >= 0 && z >= 0 && x < nx && y < ny && z < nz )
-        {
-          unsigned short val = data[ output_datablock->to_index( static_cast<size_t>( x ), 
-            static_cast<size_t>( y ), static_cast<size_t>( z ) ) ];
-          if ( val ) lut[ val ] = 1;
-        }
-      }
-      
-      if ( this->mask_layer_ )
-      {
-        Core::MaskDataBlockHandle mask_handle = 
-          dynamic_cast<MaskLayer*>( this->mask_layer_.get() )->
-          get_mask_volume()->get_mask_data_block();
-          
-        unsigned char mask_value = mask_handle->get_mask_value();
-        size_t size = mask_handle->get_size();
-        unsigned char* mask_data = mask_handle->get_mask_data();
-        
-        Core::DataBlock::shared_lock_type lock( mask_handle->get_mutex() );
-        if ( this->invert_mask_ )
-        {
-          for ( size_t j = 0; j < size; j++ )
-          {
-            if ( ! ( mask_data[ j ] & mask_value && data[ j ] ) ) lut[ data[ j ] ] = 1;
-          }     
-        }
-        else
-        {
-          for ( size_t j = 0; j < size; j++ )
-          {
-            if ( ( mask_data[ j ] & mask_value && data[ j ] ) ) lut[ data[ j ] ] = 1;
-          }           
-        
-        }
-      }
-
-      this->dst_layer_->update_progress_signal_( 0.80 );
-      if ( this->check_abort() )
-      {
-        return;
-      }
-
-      size_t size = output_datablock->get_size();
-      for ( size_t j = 0; j < size; j++ )
-      {
-        data[ j ] = lut[ data[ j ] ];
-      }
+    // Select the components that overlap with the mask
+    if ( this->mask_layer_ )
+    {
+      Core::MaskDataBlockHandle mask_handle = boost::dynamic_pointer_cast< MaskLayer >(
+        this->mask_layer_ )->get_mask_volume()->get_mask_data_block();
+      Core::MaskDataBlock::shared_lock_type lock( mask_handle->get_mutex() );
+      components.find_overlapping( mask_handle, this->invert_mask_, selected );
     }
+    selected[ 0 ] = 0;
 
-    this->dst_layer_->update_progress_signal_( .90 );
+    this->dst_layer_->update_progress_signal_( 0.80 );
     if ( this->check_abort() )
     {
       return;
     }
     
     Core::MaskDataBlockHandle mask_datablock;
-    if ( ! ( Core::MaskDataBlockManager::Convert( output_datablock, 
+    if ( ! ( Core::MaskDataBlockManager::Create( 
       this->dst_layer_->get_grid_transform(), mask_datablock ) ) )  
     {
       this->report_error("Could not allocate enough memory.");
       return;
     }
+
+    {
+      Core::MaskDataBlock::lock_type lock( mask_datablock->get_mutex() );
+      components.write_mask( selected, mask_datablock );
+    }
       
     this->dst_layer_->update_progress_signal_( 1.0 );
     
     this->dispatch_insert_mask_volume_into_layer( this->dst_layer_,
       Core::MaskVolumeHandle( new Core::MaskVolume(
       this->dst_layer_->get_grid_transform(), mask_datablock ) ) );
-      
   }
-  SCI_END_ITK_RUN()
+
+  // UPDATE_LABELING_PROGRESS:
+  // Forward the progress of the labeling to the layer and check whether the filter needs to
+  // abort.
+  bool update_labeling_progress( double progress, double start, double amount )
+  {
+    this->dst_layer_->update_progress( start + progress * amount );
+    return !this->check_abort();
+  }
 
   // GET_FITLER_NAME:
   // The name of the filter, this information is used for generating new layer labels.
@@ -26,17 +26,20 @@
  DEALINGS IN THE SOFTWARE.
  */
 
-// ITK includes
-#include <itkConnectedComponentImageFilter.h>
+// STL includes
+#include <cmath>
 
+// Boost includes
+#include <boost/bind.hpp>
+
+// Core includes
+#include <Core/DataBlock/ConnectedComponents.h>
 #include <Core/DataBlock/StdDataBlock.h>
-#include <Core/DataBlock/ITKDataBlock.h>
-#include <Core/DataBlock/MaskDataBlockManager.h>
 
 // Application includes
 #include <Application/Layer/LayerManager.h>
 #include <Application/StatusBar/StatusBar.h>
-#include <Application/Filters/ITKFilter.h>
+#include <Application/Filters/LayerFilter.h>
 #include <Application/Filters/Actions/ActionConnectedComponentSizeFilter.h>
 
 // REGISTER ACTION:
@@ -71,7 +74,7 @@ bool ActionConnectedComponentSizeFilter::validate( Core::ActionContextHandle& co
 // NOTE: The separation of the algorithm into a private class is for the purpose of running the
 // filter on a separate thread.
 
-class ConnectedComponentSizeFilterAlgo : public ITKFilter
+class ConnectedComponentSizeFilterAlgo : public LayerFilter
 {
 
 public:
@@ -81,98 +84,62 @@ public:
   bool log_scale_;
 
 public:
-  // NOTE: The macro needs a data type to select which version to run. This needs to be
-  // a member variable of the algorithm class.
-  SCI_BEGIN_ITK_RUN()
-  {
-    // Define the type of filter that we use.
-    typedef itk::ConnectedComponentImageFilter< 
-      UCHAR_IMAGE_TYPE, UINT_IMAGE_TYPE > filter_type;
-
-    // Retrieve the image as an itk image from the underlying data structure
-    // NOTE: This only does wrapping and does not regenerate the data.
-    Core::ITKImageDataT<unsigned char>::Handle input_image; 
-    this->get_itk_image_from_layer<unsigned char>( this->src_layer_, input_image );
-        
-    // Create a new ITK filter instantiation. 
-    filter_type::Pointer filter = filter_type::New();
+  // RUN_FILTER:
+  // Implemtation of run of the Runnable base class, this function is called when the thread
+  // is launched.
 
-    // Relay abort and progress information to the layer that is executing the filter.
-    this->forward_abort_to_filter( filter, this->dst_layer_ );
-    this->observe_itk_progress( filter, this->dst_layer_, 0.0, 0.75 );
-    
-    // Setup the filter parameters that we do not want to change.
-    filter->SetInput( input_image->get_image() );
-
-    // Ensure we will have some threads left for doing something else
-    this->limit_number_of_itk_threads( filter );
-    
-    // Run the actual ITK filter.
-    // This needs to be in a try/catch statement as certain filters throw exceptions when they
-    // are aborted. In that case we will relay a message to the status bar for information.
-    try 
-    { 
-      filter->Update(); 
-    } 
-    catch ( ... ) 
+  virtual void run_filter()
+  {
+    // Label the components directly from the bits of the mask
+    Core::MaskDataBlockHandle src_mask = boost::dynamic_pointer_cast< MaskLayer >( 
+      this->src_layer_ )->get_mask_volume()->get_mask_data_block();
+    Core::ConnectedComponents components;
     {
-      this->report_error( "ITK filter failed to complete." );
-      return;
+      Core::MaskDataBlock::shared_lock_type lock( src_mask->get_mutex() );
+      if ( !components.label( src_mask, false, boost::bind( 
+        &ConnectedComponentSizeFilterAlgo::update_labeling_progress, this, _1, 0.0, 0.75 ) ) )
+      {
+        if ( !this->check_abort() ) this->report_error( "Could not allocate enough memory." );
+        return;
+      }
     }
 
-    // As ITK filters generate an inconsistent abort behavior, we record our own abort flag
-    // This one is set when the abort button is pressed and an abort is sent to ITK.
-    if ( this->check_abort() ) return;
-
-    Core::DataBlockHandle output_datablock = Core::ITKDataBlock::New( filter->GetOutput() );
+    size_t num_components = components.get_num_components();
+    Core::DataBlockHandle output_datablock = Core::StdDataBlock::New( 
+      this->dst_layer_->get_grid_transform(), log_scale_ ? Core::DataType::FLOAT_E : 
+      Core::DataType::UINT_E );
     
     if ( ! output_datablock )
     {
       this->report_error("Could not allocate enough memory.");
       return;
     }   
-    
-    unsigned int max_label = filter->GetObjectCount();
-    
-    std::vector<unsigned int> hist;
-    try
-    {
-      hist.resize( max_label + 1, 0 );
-    }
-    catch( ... )
-    {
-      this->report_error( "Could not allocate enough memory." );
-      return;   
-    }
-    
-    size_t size = output_datablock->get_size();
-    unsigned int* data = reinterpret_cast<unsigned int*>( output_datablock->get_data() );
-  
-    for ( size_t j = 0; j < size; j++ )
-    {
-      hist[ data[ j ] ]++;
-    }
-  
-    hist[ 0 ] = 0;
   
     this->dst_layer_->update_progress_signal_( 0.85 );
     if ( this->check_abort() ) return;
 
+    // Write the size of its component into every voxel
     if ( log_scale_ )
     {
-      float* ldata = reinterpret_cast<float*>( output_datablock->get_data() );
-      for ( size_t j = 0; j < size; j++ )
+      std::vector<float> values( num_components + 1, 0.0f );
+      for ( size_t j = 1; j <= num_components; j++ )
       {
-        ldata[ j ] = logf( static_cast<float>( hist[ data[ j ] ] + 1) );
+        values[ j ] = logf( static_cast<float>( components.get_size( 
+          static_cast< Core::ConnectedComponents::label_type >( j ) ) + 1 ) );
       }
-      output_datablock->update_data_type( Core::DataType::FLOAT_E );
+      components.write_values( values, 
+        reinterpret_cast<float*>( output_datablock->get_data() ) );
     }
     else
     {
-      for ( size_t j = 0; j < size; j++ )
+      std::vector<unsigned int> values( num_components + 1, 0 );
+      for ( size_t j = 1; j <= num_components; j++ )
       {
-        data[ j ] = hist[ data[ j ] ];
-      }   
+        values[ j ] = static_cast<unsigned int>( components.get_size( 
+          static_cast< Core::ConnectedComponents::label_type >( j ) ) );
+      }
+      components.write_values( values, 
+        reinterpret_cast<unsigned int*>( output_datablock->get_data() ) );
     }
     
     this->dst_layer_->update_progress_signal_( 0.95 );
@@ -182,7 +149,15 @@ public:
       Core::DataVolumeHandle( new Core::DataVolume(
       this->dst_layer_->get_grid_transform(), output_datablock ) ), true );
   }
-  SCI_END_ITK_RUN()
+
+  // UPDATE_LABELING_PROGRESS:
+  // Forward the progress of the labeling to the layer and check whether the filter needs to
+  // abort.
+  bool update_labeling_progress( double progress, double start, double amount )
+  {
+    this->dst_layer_->update_progress( start + progress * amount );
+    return !this->check_abort();
+  }
 
   // GET_FITLER_NAME:
   // The name of the filter, this information is used for generating new layer labels.
@@ -26,6 +26,19 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+// STL includes
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Boost includes
+#include <boost/bind.hpp>
+
+// Core includes
+#include <Core/DataBlock/MaskKernels.h>
+#include <Core/Math/MathFunctions.h>
+#include <Core/Utils/TaskScheduler.h>
+
 // Application includes
 #include <Application/Layer/LayerManager.h>
 #include <Application/StatusBar/StatusBar.h>
@@ -80,6 +93,42 @@ bool ActionMaskDataFilter::validate( Core::ActionContextHandle& context )
   return true;
 }
 
+// FINDMASKEDRANGE:
+// Find the minimum and maximum of the selected voxels in each of the parts in 
+// [part_begin, part_end). The volume is split into num_parts parts of about equal size and
+// the range of each part is stored as a pair of the minimum and the maximum.
+template< class T >
+static void FindMaskedRange( const unsigned char* mask, unsigned char mask_value, bool invert,
+  const T* data, size_t size, std::vector< std::pair< T, T > >* ranges,
+  size_t part_begin, size_t part_end )
+{
+  unsigned char selection[ Core::MASK_KERNEL_BLOCK_SIZE_C ];
+  size_t num_parts = ranges->size();
+  for ( size_t part = part_begin; part < part_end; part++ )
+  {
+    T min_value = ( *ranges )[ part ].first;
+    T max_value = ( *ranges )[ part ].second;
+    size_t end = size * ( part + 1 ) / num_parts;
+    for ( size_t j = size * part / num_parts; j < end; j += Core::MASK_KERNEL_BLOCK_SIZE_C )
+    {
+      size_t block_size = Core::Min( end - j, Core::MASK_KERNEL_BLOCK_SIZE_C );
+      // Blocks without any selected voxels are skipped
+      if ( Core::ReadMaskBits( mask + j, mask_value, invert, selection, block_size ) == 0 ) 
+      {
+        continue;
+      }
+      
+      for ( size_t k = 0; k < block_size; k++ )
+      {
+        if ( !selection[ k ] ) continue;
+        if ( data[ j + k ] < min_value ) min_value = data[ j + k ];
+        if ( data[ j + k ] > max_value ) max_value = data[ j + k ];
+      }
+    }
+    ( *ranges )[ part ] = std::make_pair( min_value, max_value );
+  }
+}
+
 // ALGORITHM CLASS
 // This class does the actual work and is run on a separate thread.
 // NOTE: The separation of the algorithm into a private class is for the purpose of running the
@@ -123,65 +172,34 @@ public:
     Core::MaskDataBlockHandle mask_data_block = input_mask_volume->get_mask_data_block();
 
     VALUE_TYPE replace_value( 0 );
-    if ( replace_with_ == "new_max_value" )
+    if ( replace_with_ == "new_max_value" || replace_with_ == "new_min_value" )
     {
-      replace_value = std::numeric_limits<VALUE_TYPE>::min();
-      VALUE_TYPE* data = reinterpret_cast< VALUE_TYPE* >( output_data_block->get_data() );
+      const VALUE_TYPE* data = reinterpret_cast< VALUE_TYPE* >( output_data_block->get_data() );
       
       unsigned char mask_value = mask_data_block->get_mask_value();
       unsigned char* mask = mask_data_block->get_mask_data();
       size_t size = mask_data_block->get_size();
       
-      Core::DataBlock::shared_lock_type lock( mask_data_block->get_mutex() );
-      if ( ! invert_mask_ )
-      {
-        for ( size_t j = 0; j < size ; j++ )
-        {
-          if ( mask[ j ] & mask_value )
-          {
-            if ( data[ j ] > replace_value ) replace_value = data[ j ];
-          }
-        }     
-      }
-      else
-      {
-        for ( size_t j = 0; j < size ; j++ )
-        {
-          if ( !( mask[ j ] & mask_value ) )
-          {
-            if ( data[ j ] > replace_value ) replace_value = data[ j ];
-          }
-        }
-      }
-    }
-    else if ( replace_with_ == "new_min_value" )
-    {
-      replace_value = std::numeric_limits<VALUE_TYPE>::max();
-      VALUE_TYPE* data = reinterpret_cast< VALUE_TYPE* >( output_data_block->get_data() );
-      
-      unsigned char mask_value = mask_data_block->get_mask_value();
-      unsigned char* mask = mask_data_block->get_mask_data();
-      size_t size = mask_data_block->get_size();
+      // NOTE: Every part of the volume finds its own range, the ranges are combined afterwards
+      size_t num_parts = Core::Max( size / Core::MASK_KERNEL_GRAIN_SIZE_C, size_t( 1 ) );
+      std::vector< std::pair< VALUE_TYPE, VALUE_TYPE > > ranges( num_parts, std::make_pair( 
+        std::numeric_limits<VALUE_TYPE>::max(), std::numeric_limits<VALUE_TYPE>::min() ) );
       
       Core::DataBlock::shared_lock_type lock( mask_data_block->get_mutex() );
-      if ( ! invert_mask_ )
+      Core::ParallelFor( 0, num_parts, boost::bind( &FindMaskedRange< VALUE_TYPE >, mask, 
+        mask_value, invert_mask_, data, size, &ranges, _1, _2 ), 1 );
+      
+      replace_value = ( replace_with_ == "new_max_value" ) ? ranges[ 0 ].second : 
+        ranges[ 0 ].first;
+      for ( size_t j = 1; j < num_parts; j++ )
       {
-        for ( size_t j = 0; j < size ; j++ )
+        if ( replace_with_ == "new_max_value" )
         {
-          if ( mask[ j ] & mask_value )
-          {
-            if ( data[ j ] < replace_value ) replace_value = data[ j ];
-          }
-        }     
-      }
-      else
-      {
-        for ( size_t j = 0; j < size ; j++ )
+          if ( ranges[ j ].second > replace_value ) replace_value = ranges[ j ].second;
+        }
+        else
         {
-          if ( !( mask[ j ] & mask_value ) )
-          {
-            if ( data[ j ] < replace_value ) replace_value = data[ j ];
-          }
+          if ( ranges[ j ].first < replace_value ) replace_value = ranges[ j ].first;
         }
       }
     }
@@ -202,27 +220,10 @@ public:
     unsigned char* mask = mask_data_block->get_mask_data();
     size_t size = mask_data_block->get_size();
     
+    // NOTE: The voxels outside the mask are replaced, or the ones inside if the mask is inverted
     Core::DataBlock::shared_lock_type lock( mask_data_block->get_mutex() );
-    if ( invert_mask_ )
-    {
-      for ( size_t j = 0; j < size ; j++ )
-      {
-        if ( ( mask[ j ] & mask_value ) )
-        {
-          data[ j ] = replace_value;
-        }
-      }     
-    }
-    else
-    {
-      for ( size_t j = 0; j < size ; j++ )
-      {
-        if ( ! ( mask[ j ] & mask_value ) )
-        {
-          data[ j ] = replace_value;
-        }
-      }
-    }
+    Core::ParallelFor( 0, size, boost::bind( &Core::FillMaskedData< VALUE_TYPE >, mask, 
+      mask_value, !invert_mask_, data, replace_value, _1, _2 ), Core::MASK_KERNEL_GRAIN_SIZE_C );
 
     Core::DataVolumeHandle output_data_volume( new Core::DataVolume( 
       this->src_layer_->get_grid_transform(), output_data_block ) );
@@ -26,9 +26,14 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+// Boost includes
+#include <boost/bind.hpp>
+
 // Core includes
 #include <Core/Math/MathFunctions.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/DataBlock/MaskKernels.h>
+#include <Core/Utils/TaskScheduler.h>
 
 // Application includes
 #include <Application/Layer/LayerManager.h>
@@ -155,44 +160,22 @@ public:
         slock2.swap(mutex);
       }
     
-      size_t size = mask1_data_block->get_size();
-      size_t size8 = Core::RemoveRemainder8( size );
-      size_t progress_count = 0;
-      for ( size_t j = 0; j < size8; j+=8 )
+      // NOTE: The volume is processed in slabs of slices, every slab is split up over the
+      // workers of the task scheduler. Progress and abort are handled between the slabs.
+      size_t nxy = mask1_data_block->get_nx() * mask1_data_block->get_ny();
+      size_t nz = mask1_data_block->get_nz();
+      size_t slab_size = Core::Max( nz / 20, size_t( 1 ) );
+      for ( size_t z = 0; z < nz; z += slab_size )
       {
-        if ( ( mask1_data[ j ] & mask1_value ) || ( mask2_data[ j ] & mask2_value ) )
-          mask_data[ j ] |= mask_value;
-        if ( ( mask1_data[ j + 1 ] & mask1_value ) || ( mask2_data[ j + 1 ] & mask2_value ) )
-          mask_data[ j + 1 ] |= mask_value;
-        if ( ( mask1_data[ j + 2 ] & mask1_value ) || ( mask2_data[ j + 2 ] & mask2_value ) )
-          mask_data[ j + 2 ] |= mask_value;
-        if ( ( mask1_data[ j + 3 ] & mask1_value ) || ( mask2_data[ j + 3 ] & mask2_value ) )
-          mask_data[ j + 3 ] |= mask_value;
-        if ( ( mask1_data[ j + 4 ] & mask1_value ) || ( mask2_data[ j + 4 ] & mask2_value ) )
-          mask_data[ j + 4 ] |= mask_value;
-        if ( ( mask1_data[ j + 5 ] & mask1_value ) || ( mask2_data[ j + 5 ] & mask2_value ) )
-          mask_data[ j + 5 ] |= mask_value;
-        if ( ( mask1_data[ j + 6 ] & mask1_value ) || ( mask2_data[ j + 6 ] & mask2_value ) )
-          mask_data[ j + 6 ] |= mask_value;
-        if ( ( mask1_data[ j + 7 ] & mask1_value ) || ( mask2_data[ j + 7 ] & mask2_value ) )
-          mask_data[ j + 7 ] |= mask_value;
-        progress_count++;
-        if ( progress_count == 1000 )
-        {
-          progress_count = 0;
-          this->dst_layer_->update_progress( 
-            static_cast<float>( j )/static_cast<float>( size ) );
-          if ( this->check_abort() ) return;
-        }     
+        Core::ParallelFor( z * nxy, Core::Min( z + slab_size, nz ) * nxy, boost::bind( 
+          &Core::CombineMaskBits, Core::MaskOperator::OR_E, mask1_data, mask1_value, 
+          mask2_data, mask2_value, mask_data, mask_value, _1, _2 ), 
+          Core::MASK_KERNEL_GRAIN_SIZE_C );
+
+        this->dst_layer_->update_progress( static_cast<float>( 
+          Core::Min( z + slab_size, nz ) ) / static_cast<float>( nz ) );
+        if ( this->check_abort() ) return;
       }
-      
-      for ( size_t j = size8; j < size; j++ )
-      {
-        if ( ( mask1_data[ j ] & mask1_value ) || ( mask2_data[ j ] & mask2_value ) )
-          mask_data[ j ] |= mask_value;     
-      }     
-
-      if ( this->check_abort() ) return;
     }
       
     this->dispatch_insert_mask_volume_into_layer( this->dst_layer_, mask_volume );
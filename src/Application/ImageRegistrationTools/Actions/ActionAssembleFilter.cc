@@ -37,16 +37,24 @@
 #include <Core/ITKCommon/AsyncMosiacSave.h>
 
 // system includes:
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include <sstream>
 
 // Application includes
 //#include <Application/Layer/LayerManager.h>
 
 #include <Core/Utils/Log.h>
+#include <Core/LargeVolume/LargeVolumeBuilder.h>
+#include <Core/LargeVolume/LargeVolumeSchema.h>
 
 // boost:
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace bfs=boost::filesystem;
 
@@ -59,6 +67,257 @@ namespace Seg3D
 //{
 //};
 
+// COPY_MOSAIC:
+// Copy an assembled mosaic into a data block of the same size, values outside of the range of
+// the data type are clamped
+template <typename T>
+static void
+copy_mosaic(const image_t* mosaic, Core::DataBlockHandle data_block)
+{
+  const pixel_t* src = mosaic->GetBufferPointer();
+  T* dst = reinterpret_cast<T*>(data_block->get_data());
+  const double min_val = static_cast<double>(std::numeric_limits<T>::min());
+  const double max_val = static_cast<double>(std::numeric_limits<T>::max());
+  
+  const size_t size = data_block->get_size();
+  for (size_t i = 0; i < size; i++)
+  {
+    dst[i] = static_cast<T>(std::min(std::max(static_cast<double>(src[i]), min_val), max_val));
+  }
+}
+
+// CLASS MOSAICBRICKRENDERER:
+// Renders the regions of the bricks of a large volume from the mosaic tiles. A tile is loaded
+// when the first brick that overlaps it is rendered and released after the last one, hence only
+// the tiles along the front of bricks that are being rendered are kept in memory.
+class MosaicBrickRenderer : public boost::noncopyable
+{
+public:
+  MosaicBrickRenderer(const std::list<bfs::path>& fn_image,
+                      const std::vector<base_transform_t::Pointer>& transform,
+                      const std::vector<image_t::PointType>& image_min,
+                      const std::vector<image_t::PointType>& image_max,
+                      const image_t::PointType& mosaic_min,
+                      const image_t::SpacingType& mosaic_sp,
+                      unsigned int shrink_factor,
+                      double pixel_spacing,
+                      bool use_standard_mask,
+                      double clahe_slope,
+                      feathering_t feathering) :
+    fn_image_(fn_image.begin(), fn_image.end()),
+    transform_(transform),
+    image_min_(image_min),
+    image_max_(image_max),
+    mosaic_min_(mosaic_min),
+    mosaic_sp_(mosaic_sp),
+    shrink_factor_(shrink_factor),
+    pixel_spacing_(pixel_spacing),
+    use_standard_mask_(use_standard_mask),
+    clahe_slope_(clahe_slope),
+    feathering_(feathering)
+  {
+    for (size_t i = 0; i < this->fn_image_.size(); i++)
+    {
+      this->tiles_.push_back(TileHandle(new Tile));
+    }
+  }
+  
+  // ADD_BRICK:
+  // Register a brick region [start, end) that will be rendered, which keeps the tiles that it
+  // overlaps loaded until it has been rendered
+  void add_brick(const Core::IndexVector& start, const Core::IndexVector& end)
+  {
+    std::vector<size_t> tiles;
+    this->find_tiles(start, end, tiles);
+    for (size_t k = 0; k < tiles.size(); k++)
+    {
+      this->tiles_[tiles[k]]->num_bricks_++;
+    }
+  }
+  
+  // RENDER:
+  // Assemble the region of a brick, this function is called from several threads at the same
+  // time by the large volume builder
+  bool render(const Core::IndexVector& start, Core::DataBlockHandle data_block, std::string& error)
+  {
+    const Core::IndexVector end = start + Core::IndexVector(data_block->get_nx(),
+      data_block->get_ny(), data_block->get_nz());
+    std::vector<size_t> tiles;
+    this->find_tiles(start, end, tiles);
+    
+    std::memset(data_block->get_data(), 0, data_block->get_byte_size());
+    
+    bool success = true;
+    try
+    {
+      const size_t num_tiles = tiles.size();
+      std::vector<image_t::ConstPointer> image(num_tiles);
+      std::vector<mask_t::ConstPointer> mask(num_tiles);
+      std::vector<base_transform_t::Pointer> transform(num_tiles);
+      for (size_t k = 0; k < num_tiles; k++)
+      {
+        this->load_tile(tiles[k], image[k], mask[k]);
+        transform[k] = this->transform_[tiles[k]];
+      }
+      
+      if (num_tiles > 0)
+      {
+        image_t::PointType tile_min;
+        tile_min[0] = this->mosaic_min_[0] + start.x() * this->mosaic_sp_[0];
+        tile_min[1] = this->mosaic_min_[1] + start.y() * this->mosaic_sp_[1];
+        
+        image_t::SizeType tile_sz;
+        tile_sz[0] = data_block->get_nx();
+        tile_sz[1] = data_block->get_ny();
+        
+        mask_t::Pointer mosaic_mask;
+        image_t::Pointer mosaic =
+        make_mosaic_st<image_t::ConstPointer, base_transform_t::Pointer>(false,
+                                                                         mosaic_mask,
+                                                                         this->mosaic_sp_,
+                                                                         tile_min,
+                                                                         tile_sz,
+                                                                         num_tiles,
+                                                                         std::vector<bool>(num_tiles, false),
+                                                                         std::vector<double>(num_tiles, 1.0),
+                                                                         transform,
+                                                                         image,
+                                                                         mask,
+                                                                         this->feathering_,
+                                                                         0.0);  // background
+        
+        switch (data_block->get_data_type())
+        {
+          case Core::DataType::USHORT_E:
+            copy_mosaic<unsigned short>(mosaic, data_block);
+            break;
+          case Core::DataType::SHORT_E:
+            copy_mosaic<short>(mosaic, data_block);
+            break;
+          default:
+            copy_mosaic<unsigned char>(mosaic, data_block);
+            break;
+        }
+      }
+    }
+    catch (itk::ExceptionObject &err)
+    {
+      error = err.GetDescription();
+      success = false;
+    }
+    catch (std::exception &err)
+    {
+      error = err.what();
+      success = false;
+    }
+    
+    for (size_t k = 0; k < tiles.size(); k++)
+    {
+      this->release_tile(tiles[k]);
+    }
+    
+    return success;
+  }
+  
+private:
+  // FIND_TILES:
+  // Find the tiles whose bounding box overlaps the brick region [start, end)
+  void find_tiles(const Core::IndexVector& start, const Core::IndexVector& end,
+                  std::vector<size_t>& tiles) const
+  {
+    image_t::PointType region_min;
+    image_t::PointType region_max;
+    for (unsigned int j = 0; j < 2; j++)
+    {
+      region_min[j] = this->mosaic_min_[j] + start[j] * this->mosaic_sp_[j];
+      region_max[j] = this->mosaic_min_[j] + end[j] * this->mosaic_sp_[j];
+    }
+    
+    for (size_t i = 0; i < this->fn_image_.size(); i++)
+    {
+      if (bbox_overlap(region_min, region_max, this->image_min_[i], this->image_max_[i]))
+      {
+        tiles.push_back(i);
+      }
+    }
+  }
+  
+  // LOAD_TILE:
+  // Get a tile, loading it and applying the mask and CLAHE if it is not in memory yet
+  void load_tile(size_t i, image_t::ConstPointer& image, mask_t::ConstPointer& mask)
+  {
+    Tile& tile = *this->tiles_[i];
+    boost::mutex::scoped_lock lock(tile.mutex_);
+    if (tile.image_.IsNull())
+    {
+      image_t::Pointer tile_image = std_tile<image_t>(this->fn_image_[i],
+                                                      this->shrink_factor_,
+                                                      this->pixel_spacing_,
+                                                      true);
+      mask_t::Pointer tile_mask;
+      if (this->use_standard_mask_)
+      {
+        tile_mask = std_mask<image_t>(tile_image);
+      }
+      
+      if (this->clahe_slope_ > 1.0)
+      {
+        tile_image = CLAHE<image_t>(tile_image,
+                                    255,
+                                    255,
+                                    this->clahe_slope_,
+                                    256,
+                                    0.0,
+                                    255.0,
+                                    tile_mask);
+      }
+      
+      tile.image_ = tile_image;
+      tile.mask_ = tile_mask;
+    }
+    
+    image = tile.image_;
+    mask = tile.mask_;
+  }
+  
+  // RELEASE_TILE:
+  // Unload a tile once all the bricks that overlap it have been rendered
+  void release_tile(size_t i)
+  {
+    Tile& tile = *this->tiles_[i];
+    boost::mutex::scoped_lock lock(tile.mutex_);
+    if (--tile.num_bricks_ == 0 && tile.image_.IsNotNull())
+    {
+      tile.image_ = image_t::ConstPointer(NULL);
+      tile.mask_ = mask_t::ConstPointer(NULL);
+    }
+  }
+  
+  struct Tile
+  {
+    Tile() : num_bricks_(0) {}
+    
+    boost::mutex mutex_;
+    image_t::ConstPointer image_;
+    mask_t::ConstPointer mask_;
+    size_t num_bricks_;
+  };
+  typedef boost::shared_ptr<Tile> TileHandle;
+  
+  std::vector<bfs::path> fn_image_;
+  std::vector<base_transform_t::Pointer> transform_;
+  std::vector<image_t::PointType> image_min_;
+  std::vector<image_t::PointType> image_max_;
+  image_t::PointType mosaic_min_;
+  image_t::SpacingType mosaic_sp_;
+  unsigned int shrink_factor_;
+  double pixel_spacing_;
+  bool use_standard_mask_;
+  double clahe_slope_;
+  feathering_t feathering_;
+  std::vector<TileHandle> tiles_;
+};
+
 bool
 ActionAssembleFilter::validate( Core::ActionContextHandle& context )
 {
@@ -67,6 +326,32 @@ ActionAssembleFilter::validate( Core::ActionContextHandle& context )
     context->report_warning(this->feathering_ + " is not a recognized feathering option.");
   }
 
+  if (this->large_volume_)
+  {
+    if (this->save_variance_)
+    {
+      context->report_error("The mosaic variance cannot be saved as a large volume.");
+      return false;
+    }
+    
+    if (this->mask_ != "<none>")
+    {
+      context->report_error("A mosaic mask cannot be assembled together with a large volume.");
+      return false;
+    }
+    
+    if (this->brick_size_ <= 2 * this->overlap_)
+    {
+      context->report_error("The brick size needs to be larger than twice the overlap.");
+      return false;
+    }
+    
+    if (this->remap_values_)
+    {
+      context->report_warning("Values are not remapped when assembling a large volume.");
+    }
+  }
+
   return true;
 }
 
@@ -222,7 +507,7 @@ ActionAssembleFilter::run( Core::ActionContextHandle& context, Core::ActionResul
     image.resize(num_images);
     mask.resize(num_images);
     
-    if ( ! this->defer_image_loading_ )
+    if ( ! this->defer_image_loading_ && ! this->large_volume_ )
     {
       unsigned int i = 0;
 //    for (std::list<the_text_t>::const_iterator iter = in.begin();
@@ -277,7 +562,7 @@ ActionAssembleFilter::run( Core::ActionContextHandle& context, Core::ActionResul
       return false;
     }
     
-    if (this->defer_image_loading_ && !save_tiles)
+    if (this->defer_image_loading_ && !save_tiles && !this->large_volume_)
     {
       context->report_error("Defer image loading requires tile_width and tile_height arguments.");
       return false;
@@ -299,6 +584,89 @@ ActionAssembleFilter::run( Core::ActionContextHandle& context, Core::ActionResul
     image_t::SizeType mosaic_sz;
     the_thread_pool_t thread_pool(1);
     
+    if (this->large_volume_)
+    {
+      // Only the bounding boxes are computed up front, the tiles are loaded while the bricks
+      // that overlap them are rendered.
+      image_t::PointType mosaic_min;
+      image_t::PointType mosaic_max;
+      std::vector<image_t::PointType> image_min;
+      std::vector<image_t::PointType> image_max;
+      calc_mosaic_bbox_load_images<image_t::ConstPointer, 
+      base_transform_t::Pointer>
+      (transform,
+       in,
+       mosaic_min,
+       mosaic_max,
+       image_min,
+       image_max,
+       this->shrink_factor_,
+       this->pixel_spacing_);
+      
+      image_t::SpacingType mosaic_sp = std_tile<image_t>(in.front(), 
+                                                         this->shrink_factor_, 
+                                                         this->pixel_spacing_)->GetSpacing();
+      mosaic_sz[0] = static_cast<unsigned int>((mosaic_max[0] - mosaic_min[0]) / mosaic_sp[0]);
+      mosaic_sz[1] = static_cast<unsigned int>((mosaic_max[1] - mosaic_min[1]) / mosaic_sp[1]);
+      
+      Core::DataType data_type = Core::DataType::UCHAR_E;
+      if (this->save_uint16_image_)
+      {
+        data_type = Core::DataType::USHORT_E;
+      }
+      else if (this->save_int16_image_)
+      {
+        data_type = Core::DataType::SHORT_E;
+      }
+      
+      // The mosaic is a single slice, hence the bricks are only one slice thick and only overlap
+      // their neighbors within the slice
+      Core::LargeVolumeSchemaHandle schema(new Core::LargeVolumeSchema);
+      schema->set_dir(fn_save);
+      schema->set_parameters(Core::IndexVector(mosaic_sz[0], mosaic_sz[1], 1),
+                             Core::Vector(mosaic_sp[0], mosaic_sp[1], mosaic_sp[0]),
+                             Core::Point(mosaic_min[0], mosaic_min[1], 0.0),
+                             Core::IndexVector(this->brick_size_, this->brick_size_, 1),
+                             this->overlap_,
+                             data_type);
+      schema->compute_levels();
+      
+      MosaicBrickRenderer renderer(in,
+                                   transform,
+                                   image_min,
+                                   image_max,
+                                   mosaic_min,
+                                   mosaic_sp,
+                                   this->shrink_factor_,
+                                   this->pixel_spacing_,
+                                   this->use_standard_mask_,
+                                   this->clahe_slope_,
+                                   feathering_val);
+      
+      const size_t num_bricks = schema->compute_level_num_bricks(0);
+      for (size_t k = 0; k < num_bricks; k++)
+      {
+        Core::IndexVector start;
+        Core::IndexVector end;
+        Core::LargeVolumeBuilder::GetBrickRegion(schema, Core::BrickInfo(k, 0), start, end);
+        renderer.add_brick(start, end);
+      }
+      
+      std::cout << "assembling mosaic into " << num_bricks << " bricks of " << fn_save 
+      << "..." << std::endl;
+      
+      Core::LargeVolumeBuilder builder(schema);
+      std::string error;
+      if (! builder.run(boost::bind(&MosaicBrickRenderer::render, &renderer, _1, _2, _3), error))
+      {
+        context->report_error(error);
+        return false;
+      }
+      
+      CORE_LOG_SUCCESS("ir-assemble done");
+      return true;
+    }
+    
     if ( !save_tiles && this->defer_image_loading_ )
     {
       // Setup the full mosaic to copy to.
@@ -761,7 +1129,10 @@ ActionAssembleFilter::Dispatch(Core::ActionContextHandle context,
                                std::string output_image,
                                std::string directory,
                                std::string mask,
-                               std::string feathering)
+                               std::string feathering,
+                               bool large_volume,
+                               unsigned int brick_size,
+                               unsigned int overlap)
 {
   // Create a new action
   ActionAssembleFilter* action = new ActionAssembleFilter;
@@ -785,6 +1156,9 @@ ActionAssembleFilter::Dispatch(Core::ActionContextHandle context,
   action->directory_ = directory;
   action->mask_ = mask;
   action->feathering_ = feathering;
+  action->large_volume_ = large_volume;
+  action->brick_size_ = brick_size;
+  action->overlap_ = overlap;
   
   // Dispatch action to underlying engine
   Core::ActionDispatcher::PostAction( Core::ActionHandle( action ), context );
@@ -62,6 +62,9 @@ CORE_ACTION(
   CORE_ACTION_OPTIONAL_ARGUMENT( "defer_image_loading", "false", "" )
   CORE_ACTION_OPTIONAL_ARGUMENT( "feathering", "none", "Blend edges (none, blend, binary)." ) // none, blend, binary
   CORE_ACTION_OPTIONAL_ARGUMENT( "mask", "<none>", "Apply given mask." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "large_volume", "false", "Stream the mosaic into a large volume directory." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "brick_size", "256", "Brick size of the large volume." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "overlap", "2", "Overlap between the bricks of the large volume." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "sandbox", "-1", "The sandbox in which to run the action." )
   CORE_ACTION_ARGUMENT_IS_NONPERSISTENT( "sandbox" )
   //  CORE_ACTION_CHANGES_PROJECT_DATA()
@@ -92,6 +95,9 @@ public:
     this->add_parameter( this->remap_values_ );
     this->add_parameter( this->feathering_ );
     this->add_parameter( this->mask_ );
+    this->add_parameter( this->large_volume_ );
+    this->add_parameter( this->brick_size_ );
+    this->add_parameter( this->overlap_ );
     this->add_parameter( this->sandbox_ );
   }
   
@@ -118,7 +124,10 @@ public:
                        std::string output_image,
                        std::string directory,
                        std::string mask,
-                       std::string feathering);
+                       std::string feathering,
+                       bool large_volume = false,
+                       unsigned int brick_size = 256,
+                       unsigned int overlap = 2);
   
 private:
   std::string target_layer_;
@@ -141,6 +150,9 @@ private:
   std::string directory_;
   std::string mask_;
   std::string feathering_;
+  bool large_volume_;
+  unsigned int brick_size_;
+  unsigned int overlap_;
 
   const int CLAHE_DEFAULT_NX;
   const int CLAHE_DEFAULT_NY;
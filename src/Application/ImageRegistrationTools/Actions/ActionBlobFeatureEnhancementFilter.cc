@@ -34,7 +34,7 @@
 // the includes:
 #include <Core/ITKCommon/common.hxx>
 #include <Core/ITKCommon/the_utils.hxx>
-#include <Core/ITKCommon/ThreadUtils/the_thread_pool.hxx>
+#include <Core/ITKCommon/ThreadUtils/the_transaction_group.hxx>
 #include <Core/ITKCommon/ThreadUtils/the_boost_mutex.hxx>
 #include <Core/ITKCommon/ThreadUtils/the_boost_thread.hxx>
 
@@ -270,8 +270,6 @@ enhance_blobs(const image_t * image,
   image_t::Pointer variance = cast<image_t, image_t>(image);
   variance->FillBuffer(float_max);
   
-  the_thread_pool_t thread_pool(num_threads);
-  thread_pool.set_idle_sleep_duration(50); // 50 usec
   std::list<the_transaction_t *> schedule;
   
   const size_t pixels_per_transaction = std::min<size_t>(64, sz[0]);
@@ -352,10 +350,7 @@ enhance_blobs(const image_t * image,
     }
   }
   
-  thread_pool.push_back(schedule);
-  thread_pool.pre_distribute_work();
-  thread_pool.start();
-  thread_pool.wait();
+  run_transactions(schedule, num_threads);
   
   // find the median:
   std::vector<pixel_t> variance_vector(sz[0] * sz[1]);
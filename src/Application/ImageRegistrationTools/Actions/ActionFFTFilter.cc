@@ -45,6 +45,7 @@
 #include <itkImageRegistrationMethod.h>
 #include <itkMeanSquaresImageToImageMetric.h>
 
+#include <Core/Application/Application.h>
 #include <Core/Utils/Exception.h>
 #include <Core/Utils/Log.h>
 
@@ -64,6 +65,14 @@ namespace Seg3D
 bool
 ActionFFTFilter::validate( Core::ActionContextHandle& context )
 {
+  itk_fft::fftw_planner_mode_t planner_mode;
+  if ( ! itk_fft::fftw_planner_mode_from_string( this->fftw_planner_, planner_mode ) )
+  {
+    context->report_error( "Unknown FFTW planner mode '" + this->fftw_planner_ + 
+      "', options are estimate, measure and patient." );
+    return false;
+  }
+
   return true;
 }
 
@@ -94,6 +103,25 @@ ActionFFTFilter::run( Core::ActionContextHandle& context, Core::ActionResultHand
     fftwf_init_threads();
     itk_fft::set_num_fftw_threads(this->num_threads_);
     
+    // plans are shared between threads and tiles of the same size, and
+    // measured plans are kept across runs as wisdom. The planner mode and
+    // wisdom only apply to this run:
+    itk_fft::fftw_planner_mode_t planner_mode = itk_fft::FFTW_PLANNER_ESTIMATE_E;
+    itk_fft::fftw_planner_mode_from_string(this->fftw_planner_, planner_mode);
+    
+    bfs::path wisdom_file;
+    bfs::path config_dir;
+    if (Core::Application::Instance()->get_config_directory(config_dir))
+    {
+      wisdom_file = config_dir / "fftw_wisdom";
+    }
+    
+    itk_fft::fftw_planner_scope_t planner_scope(planner_mode, wisdom_file.string());
+    if (! planner_scope.wisdom_loaded())
+    {
+      CORE_LOG_WARNING("Could not read FFTW wisdom from " + wisdom_file.string());
+    }
+    
     // parse the command line arguments:
     std::list<bfs::path> in;
     
@@ -487,7 +515,8 @@ ActionFFTFilter::Dispatch(Core::ActionContextHandle context,
                           double overlap_max,
                           bool use_standard_mask,
                           bool try_refining,
-                          bool run_on_one)
+                          bool run_on_one,
+                          std::string fftw_planner)
 {
   // Create a new action
   ActionFFTFilter* action = new ActionFFTFilter;
@@ -500,6 +529,7 @@ ActionFFTFilter::Dispatch(Core::ActionContextHandle context,
   action->output_mosaic_ = output_mosaic;
   action->shrink_factor_ = shrink_factor;
   action->num_threads_ = num_threads;
+  action->fftw_planner_ = fftw_planner;
   action->pyramid_levels_ = pyramid_levels;
   action->iterations_per_level_ = iterations_per_level;
   action->pixel_spacing_ = pixel_spacing;
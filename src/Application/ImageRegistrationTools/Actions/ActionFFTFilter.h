@@ -58,6 +58,7 @@ CORE_ACTION(
     "Image file names (optional, images can be detected in image file directory). Do not use full path." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "shrink_factor", "1", "Downsample factor." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "num_threads", "0", "Number of threads used (if 0, the number of cores will be used)." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "fftw_planner", "estimate", "FFTW planner mode. Options: estimate, measure, patient. Measured plans are slower to create but faster to run, and are saved as FFTW wisdom in the user configuration directory." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "pyramid_levels", "1", "Number of multiresolution pyramid levels." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "iterations_per_level", "5", "Iterations per pyramid level." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "pixel_spacing", "1.0", "Pixel spacing." )          
@@ -85,6 +86,7 @@ public:
     this->add_parameter( this->images_ );
     this->add_parameter( this->shrink_factor_ );
     this->add_parameter( this->num_threads_ );
+    this->add_parameter( this->fftw_planner_ );
     this->add_parameter( this->pyramid_levels_ );
     this->add_parameter( this->iterations_per_level_ );
     this->add_parameter( this->pixel_spacing_ );
@@ -120,7 +122,8 @@ public:
                        double overlap_max,
                        bool use_standard_mask,
                        bool try_refining,
-                       bool run_on_one);
+                       bool run_on_one,
+                       std::string fftw_planner = "estimate");
   
 private:
   std::string target_layer_;
@@ -134,6 +137,7 @@ private:
   std::vector<std::string> images_;
   unsigned int shrink_factor_;
   unsigned int num_threads_;
+  std::string fftw_planner_;
   unsigned int pyramid_levels_;
   unsigned int iterations_per_level_;
   double pixel_spacing_;
@@ -40,6 +40,7 @@
 #include <Core/ITKCommon/FFT/fft_common.hxx>
 #include <Core/ITKCommon/ThreadUtils/the_boost_mutex.hxx>
 #include <Core/ITKCommon/ThreadUtils/the_boost_thread.hxx>
+#include <Core/ITKCommon/ThreadUtils/the_transaction_group.hxx>
 #include <Core/ITKCommon/grid_common.hxx>
 #include <Core/ITKCommon/the_text.hxx>
 #include <Core/ITKCommon/the_utils.hxx>
@@ -681,9 +682,243 @@ image_center(const image_t * image)
   return center;
 }
 
+//----------------------------------------------------------------
+// orientation_match_t
+//
+// The result of matching the moving image rotated by one angle
+// to the fixed image.
+//
+class orientation_match_t
+{
+public:
+  orientation_match_t():
+  metric_(std::numeric_limits<double>::max()),
+  angle_(0.0),
+  shift_(vec2d(0, 0))
+  {}
+  
+  double metric_;
+  double angle_;
+  vec2d_t shift_;
+};
+
+//----------------------------------------------------------------
+// match_orientation
+//
+// Rotate the moving image about its center and find the
+// translation that best matches it to the fixed image.
+//
+static orientation_match_t
+match_orientation(const double & angle,
+                  const image_t * a,
+                  const image_t * b,
+                  const mask_t * ma,
+                  const mask_t * mb)
+{
+  orientation_match_t match;
+  match.angle_ = angle;
+  
+  coarse_transform_t::Pointer rot = coarse_transform_t::New();
+  rot->SetCenterOfRotationComponent(image_center<image_t>(b));
+  rot->Rotate2D(angle);
+  
+  // resample the moving image:
+  image_t::Pointer b_warped = warp<image_t>(b, rot.GetPointer());
+  mask_t::Pointer mb_warped = NULL;
+  if ( mb != NULL )
+    mb_warped = warp<mask_t>(mb, rot.GetPointer());
+  static const pnt2d_t zero = pnt2d(0, 0);
+  vec2d_t shift = b_warped->GetOrigin() - zero;
+  b_warped->SetOrigin(zero);
+  if ( mb != NULL )
+    mb_warped->SetOrigin(zero);
+  
+  image_t::SizeType period_sz = calc_padding<image_t>(a, b_warped);
+  
+  image_t::PointType offset_min;
+  offset_min[0] = -std::numeric_limits<double>::max();
+  offset_min[1] = -std::numeric_limits<double>::max();
+  image_t::PointType offset_max;
+  offset_max[0] = std::numeric_limits<double>::max();
+  offset_max[1] = std::numeric_limits<double>::max();
+  
+  translate_transform_t::Pointer translate;
+  double v = match_one_pair<image_t>(translate,
+                                     
+                                     a,
+                                     ma,
+                                     b_warped.GetPointer(),
+                                     mb_warped.GetPointer(),
+                                     
+                                     period_sz,
+                                     
+                                     // overlap min/max:
+                                     0.6,
+                                     1.0,
+                                     
+                                     // offset min/max:
+                                     offset_min,
+                                     offset_max,
+                                     
+                                     // low pass filters:
+                                     0.9, // r
+                                     0.1, // s
+                                     
+                                     // max peaks in the PDF:
+                                     10,
+                                     
+                                     // don't consider the zero displacement:
+                                     false);
+  
+  if (v != std::numeric_limits<double>::max())
+  {
+    match.metric_ = v;
+    match.shift_ = translate->GetOffset() + shift;
+  }
+  
+  return match;
+}
+
+//----------------------------------------------------------------
+// match_orientations_t
+//
+// Match a subset of the orientations on one thread. Every
+// transaction works on its own copy of the images, so the ITK
+// pipelines that warp and match them never share an input.
+//
+class match_orientations_t : public the_transaction_t
+{
+public:
+  match_orientations_t(const image_t * a,
+                       const image_t * b,
+                       const mask_t * ma,
+                       const mask_t * mb,
+                       const std::vector<double> & angles,
+                       const std::list<std::size_t> & indices,
+                       std::vector<orientation_match_t> & matches,
+                       orientation_match_t & best_match):
+  indices_(indices.begin(), indices.end()),
+  angles_(angles),
+  matches_(matches),
+  best_match_(best_match)
+  {
+    a_ = cast<image_t, image_t>(a);
+    b_ = cast<image_t, image_t>(b);
+    if (ma != NULL) ma_ = cast<mask_t, mask_t>(ma);
+    if (mb != NULL) mb_ = cast<mask_t, mask_t>(mb);
+  }
+  
+  // virtual:
+  void execute(the_thread_interface_t * thread)
+  {
+    WRAP(the_terminator_t terminator("match_orientations_t"));
+    
+    for (std::size_t i = 0; i < indices_.size(); i++)
+    {
+      const std::size_t k = indices_[i];
+      matches_[k] = match_orientation(angles_[k],
+                                      a_.GetPointer(),
+                                      b_.GetPointer(),
+                                      ma_.GetPointer(),
+                                      mb_.GetPointer());
+      
+      // indices are visited in increasing order, so ties resolve
+      // to the first angle as in a sequential search:
+      if (matches_[k].metric_ < best_match_.metric_)
+      {
+        best_match_ = matches_[k];
+      }
+    }
+  }
+  
+  image_t::Pointer a_;
+  image_t::Pointer b_;
+  mask_t::Pointer ma_;
+  mask_t::Pointer mb_;
+  
+  std::vector<std::size_t> indices_;
+  const std::vector<double> & angles_;
+  std::vector<orientation_match_t> & matches_;
+  orientation_match_t & best_match_;
+};
+
+//----------------------------------------------------------------
+// match_orientations_mt
+//
+// Match the orientations with the given indices multi-threaded,
+// and return the best match among them. Each match is also stored
+// in matches at the index of its angle.
+//
+static orientation_match_t
+match_orientations_mt(unsigned int num_threads,
+                      const image_t * a,
+                      const image_t * b,
+                      const mask_t * ma,
+                      const mask_t * mb,
+                      const std::vector<double> & angles,
+                      const std::vector<std::size_t> & indices,
+                      std::vector<orientation_match_t> & matches)
+{
+  num_threads = std::max(1u, std::min(num_threads,
+                                      static_cast<unsigned int>(indices.size())));
+  
+  // split the orientations between threads, round robin since
+  // every orientation takes about as long to match:
+  std::vector<std::list<std::size_t> > thread_indices(num_threads);
+  for (std::size_t i = 0; i < indices.size(); i++)
+  {
+    thread_indices[i % num_threads].push_back(indices[i]);
+  }
+  
+  std::vector<orientation_match_t> thread_best(num_threads);
+  
+  std::list<the_transaction_t *> schedule;
+  for (unsigned int i = 0; i < num_threads; i++)
+  {
+    match_orientations_t * t =
+    new match_orientations_t(a, b, ma, mb,
+                             angles,
+                             thread_indices[i],
+                             matches,
+                             thread_best[i]);
+    schedule.push_back(t);
+  }
+  
+  // run the transactions:
+  suspend_itk_multithreading_t suspend_itk_mt;
+  run_transactions(schedule);
+  
+  // reduce the per thread results, preferring the smallest angle
+  // index on a tie:
+  orientation_match_t best;
+  std::size_t best_index = std::numeric_limits<std::size_t>::max();
+  for (unsigned int i = 0; i < num_threads; i++)
+  {
+    if (thread_best[i].metric_ == std::numeric_limits<double>::max()) continue;
+    
+    std::size_t index = std::find(angles.begin(), angles.end(),
+                                  thread_best[i].angle_) - angles.begin();
+    if (thread_best[i].metric_ < best.metric_ ||
+        (thread_best[i].metric_ == best.metric_ && index < best_index))
+    {
+      best = thread_best[i];
+      best_index = index;
+    }
+  }
+  
+  return best;
+}
+
 //----------------------------------------------------------------
 // brute_force
 //
+// Search for the rotation and translation that best match the
+// moving image to the fixed image. The orientations are matched
+// multi-threaded. With angle refinement only every
+// COARSE_ANGLE_STEP-th orientation is matched at first, and
+// the full angular resolution is only explored around the best
+// few coarse orientations.
+//
 void
 brute_force(const bool & brute_force_rotation,
             const bool & brute_force_translation,
@@ -699,26 +934,13 @@ brute_force(const bool & brute_force_rotation,
             double a0,
             double a1,
             int num_orientations,
+            unsigned int num_threads,
+            bool refine_angle,
             const int step_size = 1,
             bool verbose = false)
 {
-  // octave 0 is fixed, octave 1 is rotated and matched to octave 0:
-  double best_metric = std::numeric_limits<double>::max();
-  
-  double v_min_global = std::numeric_limits<double>::max();
-  double v_max_global = -v_min_global;
-  std::vector<double> v_min(num_orientations, v_min_global);
-  std::vector<double> v_max(num_orientations, v_max_global);
-  std::vector<image_t::Pointer> vimage(num_orientations);
-  
-  image_t::SizeType z0 = a->GetLargestPossibleRegion().GetSize();
-  image_t::SpacingType s1 = b->GetSpacing();
-  const pnt2d_t center = image_center<image_t>(b);
-  
-  typedef itk::NearestNeighborInterpolateImageFunction
-  <image_t, double> interpolator_t;
-  interpolator_t::Pointer b_interpolator = interpolator_t::New();
-  b_interpolator->SetInputImage(b);
+  static const int COARSE_ANGLE_STEP = 4;
+  static const std::size_t NUM_COARSE_CANDIDATES = 3;
   
 #ifdef DEBUG_EVERYTHING
   if (! fn_debug.empty())
@@ -731,135 +953,95 @@ brute_force(const bool & brute_force_rotation,
   // TODO: this needs to be a state instead
 //  set_major_progress(0.05);
   
-  bool done_rotation = false;
-  for (int k = 0; k < num_orientations && !done_rotation; k++)
+  if (!brute_force_rotation)
   {
-    double angle = a0 + (a1 - a0) * static_cast<double>(k) / static_cast<double>(num_orientations - 1);
-    
-    if (!brute_force_rotation)
+    orientation_match_t match = match_orientation(best_angle, a, b, ma, mb);
+    if (match.metric_ != std::numeric_limits<double>::max())
     {
-      angle = best_angle;
-      done_rotation = true;
+      best_shift = match.shift_;
     }
-    
-#ifdef DEBUG_EVERYTHING
-    std::ostringstream fn_dbg_pfx;
-    if (! fn_debug.empty())
+    return;
+  }
+  
+  std::vector<double> angles(num_orientations);
+  for (int k = 0; k < num_orientations; k++)
+  {
+    angles[k] = a0 + (a1 - a0) * static_cast<double>(k) / static_cast<double>(num_orientations - 1);
+  }
+  std::vector<orientation_match_t> matches(num_orientations);
+  
+  // the fine search may wrap around if the angles cover a full circle:
+  const double angle_step = (a1 - a0) / static_cast<double>(num_orientations - 1);
+  const bool full_circle = fabs(a1 - a0 + angle_step - TWO_PI) < 1e-6;
+  
+  std::vector<std::size_t> indices;
+  const int coarse_step = refine_angle ? COARSE_ANGLE_STEP : 1;
+  for (int k = 0; k < num_orientations; k += coarse_step)
+  {
+    indices.push_back(k);
+  }
+  
+  orientation_match_t best = match_orientations_mt(num_threads, a, b, ma, mb,
+                                                   angles, indices, matches);
+  
+  if (coarse_step > 1)
+  {
+    // rank the coarse orientations:
+    std::vector<std::pair<double, std::size_t> > ranked;
+    for (std::size_t i = 0; i < indices.size(); i++)
     {
-      fn_dbg_pfx << fn_debug << "a" << the_text_t::number(static_cast<int>(0.5 + angle * 360.0 / TWO_PI), 3, '0') << "-";
+      const orientation_match_t & match = matches[indices[i]];
+      if (match.metric_ == std::numeric_limits<double>::max()) continue;
+      ranked.push_back(std::make_pair(match.metric_, indices[i]));
     }
-#endif
-    
-    coarse_transform_t::Pointer rot = coarse_transform_t::New();
-    rot->SetCenterOfRotationComponent(center);
-    rot->Rotate2D(angle);
-    
-    // re-estimate the dimensions of the rotated tile:
-    image_t::PointType min;
-    image_t::PointType max;
-    calc_tile_mosaic_bbox<image_t>(rot, b, min, max);
-    
-    // resample the moving image:
-    image_t::Pointer b_warped = warp<image_t>(b, rot.GetPointer());
-    mask_t::Pointer mb_warped = NULL;
-    if ( mb != NULL )
-      mb_warped = warp<mask_t>(mb, rot.GetPointer());
-    static const pnt2d_t zero = pnt2d(0, 0);
-    vec2d_t shift = b_warped->GetOrigin() - zero;
-    b_warped->SetOrigin(zero);
-    if ( mb != NULL )
-      mb_warped->SetOrigin(zero);
-    
-//#if 0 // def DEBUG_EVERYTHING
-//    if (fn_debug.size() != 0)
-//    {
-//      save<native_image_t>(cast<image_t, native_image_t>(b_warped),
-//                           fn_dbg_pfx.str() + "warped.png");
-//    }
-//#endif
-    
-    image_t::SizeType period_sz = calc_padding<image_t>(a, b_warped);
-    
-    image_t::PointType offset_min;
-    min[0] = -std::numeric_limits<double>::max();
-    min[1] = -std::numeric_limits<double>::max();
-    image_t::PointType offset_max;
-    max[0] = std::numeric_limits<double>::max();
-    max[1] = std::numeric_limits<double>::max();
-    
+    std::sort(ranked.begin(), ranked.end());
     
-    translate_transform_t::Pointer translate;
-    double v = match_one_pair<image_t>(translate,
-                                       
-                                       a,
-                                       ma,
-                                       b_warped.GetPointer(),
-                                       mb_warped.GetPointer(),
-                                       
-                                       period_sz,
-                                       
-                                       // overlap min/max:
-                                       0.6,
-                                       1.0,
-                                       
-                                       // offset min/max:
-                                       offset_min,
-                                       offset_max,
-                                       
-                                       // low pass filters:
-                                       0.9, // r
-                                       0.1, // s
-                                       
-                                       // max peaks in the PDF:
-                                       10,
-                                       
-                                       // don't consider the zero displacement:
-                                       false);
+    // explore all orientations between the coarse neighbors
+    // of the best coarse orientations:
+    std::vector<bool> visited(num_orientations, false);
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+      visited[indices[i]] = true;
+    }
     
-//#if 0 // def DEBUG_EVERYTHING
-//    if (fn_debug.size() != 0)
-//    {
-//      if (v != std::numeric_limits<double>::max())
-//      {
-//        save_rgb<image_t>(fn_dbg_pfx.str() + "000000.png",
-//                          
-//                          remap_min_max<image_t>(a),
-//                          remap_min_max<image_t>(b_warped),
-//                          
-//                          translate,
-//                          
-//                          ma,
-//                          mb_warped,
-//                          false);
-//      }
-//    }
-//#endif
+    std::vector<std::size_t> fine_indices;
+    for (std::size_t i = 0; i < std::min(NUM_COARSE_CANDIDATES, ranked.size()); i++)
+    {
+      const int center = static_cast<int>(ranked[i].second);
+      for (int d = 1 - coarse_step; d < coarse_step; d++)
+      {
+        int k = center + d;
+        if (full_circle)
+        {
+          k = (k + num_orientations) % num_orientations;
+        }
+        else if (k < 0 || k >= num_orientations)
+        {
+          continue;
+        }
+        
+        if (visited[k]) continue;
+        visited[k] = true;
+        fine_indices.push_back(k);
+      }
+    }
+    std::sort(fine_indices.begin(), fine_indices.end());
     
-    if (v < best_metric)
+    if (!fine_indices.empty())
     {
-      best_metric = v;
-      best_angle = angle;
-      best_shift = translate->GetOffset() + shift;
-      // best_overlap = overlap;
-      
-#ifdef DEBUG_EVERYTHING
-      if (! fn_debug.empty())
+      orientation_match_t fine = match_orientations_mt(num_threads, a, b, ma, mb,
+                                                       angles, fine_indices, matches);
+      if (fine.metric_ < best.metric_)
       {
-        save_rgb<image_t>(fn_dbg_pfx.str() + "better.png",
-                          
-                          remap_min_max<image_t>(a),
-                          remap_min_max<image_t>(b_warped),
-                          
-                          translate,
-                          
-                          ma,
-                          mb_warped,
-                          true);
+        best = fine;
       }
-#endif
     }
-    // TODO: this needs to be a state instead
-//    set_major_progress(0.94 * (k+1)/(num_orientations+1) + 0.05);
+  }
+  
+  if (best.metric_ != std::numeric_limits<double>::max())
+  {
+    best_angle = best.angle_;
+    best_shift = best.shift_;
   }
   
   // TODO: this needs to be a state instead
@@ -944,6 +1126,12 @@ ActionSliceToSliceBruteFilter::run( Core::ActionContextHandle& context, Core::Ac
       best_shift = vec2d(this->best_shift_x_, this->best_shift_y_);
     }
 
+    // by default run as many threads as there are cores:
+    if (this->num_threads_ == 0)
+    {
+      this->num_threads_ = boost::thread::hardware_concurrency();
+    }
+    
     // unsigned int num_orientations = 120;
     unsigned int num_orientations = 360;
     unsigned int step_size = 2;
@@ -1126,6 +1314,8 @@ ActionSliceToSliceBruteFilter::run( Core::ActionContextHandle& context, Core::Ac
                 TWO_PI * (static_cast<double>(num_orientations - 1) /
                           static_cast<double>(num_orientations)),
                 num_orientations,
+                this->num_threads_,
+                this->refine_angle_,
                 step_size,
                 verbose);
     
@@ -1283,7 +1473,9 @@ ActionSliceToSliceBruteFilter::Dispatch(Core::ActionContextHandle context,
                                         std::string mask_fixed,
                                         std::string mask_moving,
                                         std::string image_dir_fixed,
-                                        std::string image_dir_moving)
+                                        std::string image_dir_moving,
+                                        unsigned int num_threads,
+                                        bool refine_angle)
 {
   // Create a new action
   ActionSliceToSliceBruteFilter* action = new ActionSliceToSliceBruteFilter;
@@ -1310,6 +1502,8 @@ ActionSliceToSliceBruteFilter::Dispatch(Core::ActionContextHandle context,
   action->mask_moving_ = mask_moving;
   action->image_dir_fixed_ = image_dir_fixed;
   action->image_dir_moving_ = image_dir_moving;
+  action->num_threads_ = num_threads;
+  action->refine_angle_ = refine_angle;
   
   // Dispatch action to underlying engine
   Core::ActionDispatcher::PostAction( Core::ActionHandle( action ), context );
@@ -65,6 +65,8 @@ CORE_ACTION(
   CORE_ACTION_OPTIONAL_ARGUMENT( "mask_moving", "<none>", "Moving image mask." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "image_dir_fixed", "<none>", "Fixed image directory." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "image_dir_moving", "<none>", "Moving image directory." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "num_threads", "0", "Number of threads used to match orientations (if 0, the number of cores will be used)." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "refine_angle", "false", "Search every fourth orientation first, and only search the remaining orientations near the best matches." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "sandbox", "-1", "The sandbox in which to run the action." )
   CORE_ACTION_ARGUMENT_IS_NONPERSISTENT( "sandbox" )
 )
@@ -99,6 +101,8 @@ public:
     this->add_parameter( this->mask_moving_ );
     this->add_parameter( this->image_dir_fixed_ );
     this->add_parameter( this->image_dir_moving_ );
+    this->add_parameter( this->num_threads_ );
+    this->add_parameter( this->refine_angle_ );
     this->add_parameter( this->sandbox_ );
   }
   
@@ -128,7 +132,9 @@ public:
                        std::string mask_fixed,
                        std::string mask_moving,
                        std::string image_dir_fixed,
-                       std::string image_dir_moving);
+                       std::string image_dir_moving,
+                       unsigned int num_threads = 0,
+                       bool refine_angle = false);
   
 private:
   std::string target_layer_;
@@ -154,6 +160,8 @@ private:
   std::string mask_moving_;
   std::string image_dir_fixed_;
   std::string image_dir_moving_;
+  unsigned int num_threads_;
+  bool refine_angle_;
 
   const unsigned int DEFAULT_ITERATIONS;
   const double DEFAULT_MIN_STEP;
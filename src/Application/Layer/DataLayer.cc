@@ -34,6 +34,7 @@
 
 // Core includes
 #include <Core/Application/Application.h>
+#include <Core/DataBlock/DataBlockChunkStore.h>
 #include <Core/State/StateIO.h>
 #include <Core/Utils/ScopedCounter.h>
 #include <Core/Utils/Log.h>
@@ -350,17 +351,22 @@ bool DataLayer::pre_save_states( Core::StateIO& state_io )
 {
   if ( this->data_volume_ )
   {
+    // The generation that was recorded before, its chunks can serve as the base for this save
+    long long base_generation = this->generation_state_->get();
     long long generation_number = this->data_volume_->get_generation();
     this->generation_state_->set( generation_number );
 
     // Add the number to the project so it can be recorded into the session database
     ProjectManager::Instance()->get_current_project()->add_generation_number( generation_number );
     
-    std::string data_file_name = this->generation_state_->export_to_string() + ".nrrd";
-    boost::filesystem::path full_data_file_name = ProjectManager::Instance()->
-      get_current_project()->get_project_data_path() / data_file_name;
+    boost::filesystem::path data_path = ProjectManager::Instance()->
+      get_current_project()->get_project_data_path();
+    std::string generation = this->generation_state_->export_to_string();
+    boost::filesystem::path full_data_file_name = data_path / 
+      ( generation + Core::DataBlockChunkStore::GetManifestExtension() );
     
-    if ( boost::filesystem::exists( full_data_file_name ) )
+    if ( boost::filesystem::exists( full_data_file_name ) ||
+      boost::filesystem::exists( data_path / ( generation + ".nrrd" ) ) )
     {
       // File has already been saved
       return true;
@@ -369,9 +375,16 @@ bool DataLayer::pre_save_states( Core::StateIO& state_io )
     bool compress = PreferencesManager::Instance()->compression_state_->get();
     int level = PreferencesManager::Instance()->compression_level_state_->get();
     
+    // NOTE: The data is stored in chunks, only the chunks that differ from the ones saved for
+    // earlier generations are written to disk. Only the chunks that changed since the base
+    // generation need to be hashed.
+    boost::filesystem::path base_file = data_path / ( Core::ExportToString( base_generation ) +
+      Core::DataBlockChunkStore::GetManifestExtension() );
+
     std::string error;
-    if ( ! Core::DataVolume::SaveDataVolume( full_data_file_name.string(), this->data_volume_, 
-      error, compress, level ) )
+    if ( ! Core::DataBlockChunkStore::Save( full_data_file_name, 
+      this->data_volume_->get_data_block(), this->data_volume_->get_grid_transform(), 
+      base_file, base_generation, compress, level, error ) )
     {
       CORE_LOG_ERROR( error );
       return false;   
@@ -387,12 +400,33 @@ bool DataLayer::post_load_states( const Core::StateIO& state_io )
 {
   if ( this->generation_state_->get() >= 0 )
   {
-    std::string generation = this->generation_state_->export_to_string() + ".nrrd";
-    boost::filesystem::path volume_path = ProjectManager::Instance()->get_current_project()->
-      get_project_data_path() / generation;
+    boost::filesystem::path data_path = ProjectManager::Instance()->get_current_project()->
+      get_project_data_path();
+    std::string generation = this->generation_state_->export_to_string();
+    boost::filesystem::path manifest_path = data_path / 
+      ( generation + Core::DataBlockChunkStore::GetManifestExtension() );
     std::string error;
+
+    // Sessions saved by older versions store each generation as a single nrrd file
+    bool loaded = false;
+    if ( boost::filesystem::exists( manifest_path ) )
+    {
+      Core::DataBlockHandle data_block;
+      Core::GridTransform grid_transform;
+      loaded = Core::DataBlockChunkStore::Load( manifest_path, data_block, grid_transform, 
+        error );
+      if ( loaded ) 
+      {
+        this->data_volume_.reset( new Core::DataVolume( grid_transform, data_block ) );
+      }
+    }
+    else
+    {
+      loaded = Core::DataVolume::LoadDataVolume( data_path / ( generation + ".nrrd" ), 
+        this->data_volume_, error );
+    }
     
-    if( Core::DataVolume::LoadDataVolume( volume_path, this->data_volume_, error ) )
+    if( loaded )
     {
       this->data_volume_->register_data( this->generation_state_->get() );
       this->private_->update_data_info();
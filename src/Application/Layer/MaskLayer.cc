@@ -32,7 +32,11 @@
 
 // Core includes
 #include <Core/Application/Application.h>
+#include <Core/DataBlock/DataBlockChunkStore.h>
+#include <Core/DataBlock/DataBlockManager.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/Interface/Interface.h>
 #include <Core/Utils/AtomicCounter.h>
 #include <Core/Utils/StringUtil.h>
 #include <Core/Utils/Log.h>
@@ -41,6 +45,7 @@
 // Application includes
 #include <Application/Layer/MaskLayer.h>
 #include <Application/Layer/LayerManager.h>
+#include <Application/Layer/Actions/ActionComputeIsosurface.h>
 #include <Application/PreferencesManager/PreferencesManager.h>
 #include <Application/ProjectManager/ProjectManager.h>
 
@@ -63,10 +68,17 @@ public:
   // need to be loaded.
   Core::StateIntHandle   bit_state_;
 
+  // NOTE: Whether the mask is stored in its own sparse data block. The session stores such a
+  // mask as a dense volume, this flag allows it to be compressed again when it is loaded.
+  Core::StateBoolHandle sparse_state_;
+
   // Information about two components not included in the state manager.
   Core::MaskVolumeHandle mask_volume_;
   Core::IsosurfaceHandle isosurface_;
 
+  // Whether a full recomputation of the isosurface has been dispatched and has not run yet
+  bool isosurface_rebuild_pending_;
+
   MaskLayer * layer_;
 };
 
@@ -101,6 +113,7 @@ void MaskLayerPrivate::initialize_states()
 
   // == Internal information for keeping track of which bit we are using ==
   this->layer_->add_state( "bit", this->bit_state_, 0 );
+  this->layer_->add_state( "sparse", this->sparse_state_, false );
 
   // == Keep track of whether the isosurface has been generated
   this->layer_->add_state( "iso_generated", this->layer_->iso_generated_state_, false );
@@ -125,6 +138,12 @@ void MaskLayerPrivate::handle_mask_data_changed()
   this->layer_->calculated_volume_state_->set( "N/A" );
   this->layer_->counted_pixels_state_->set( "N/A" );
   this->layer_->layer_updated_signal_();
+
+  // Keep the shown isosurface in sync with the edits
+  if ( this->layer_->show_isosurface_state_->get() )
+  {
+    this->layer_->update_isosurface();
+  }
 }
 
 void MaskLayerPrivate::handle_isosurface_update_progress( double progress )
@@ -156,6 +175,7 @@ MaskLayer::MaskLayer( const std::string& name, const Core::MaskVolumeHandle& vol
   this->private_->mask_volume_ = volume;
   this->private_->mask_volume_->register_data();
   this->private_->layer_ = this;
+  this->private_->isosurface_rebuild_pending_ = false;
   
   this->private_->initialize_states();
   
@@ -172,6 +192,7 @@ MaskLayer::MaskLayer( const std::string& state_id ) :
   private_( new MaskLayerPrivate )
 {
   this->private_->layer_ = this;
+  this->private_->isosurface_rebuild_pending_ = false;
   this->private_->initialize_states();
 }
 
@@ -284,15 +305,24 @@ bool MaskLayer::set_mask_volume( Core::MaskVolumeHandle volume )
 
 bool MaskLayer::pre_save_states( Core::StateIO& state_io )
 {
+  // The generation that was recorded before, its chunks can serve as the base for this save
+  long long base_generation = this->generation_state_->get();
   long long generation_number = this->get_mask_volume()->get_generation();
   this->generation_state_->set( generation_number );
+  // NOTE: A sparse mask that has been expanded still occupies a data block of its own
+  this->private_->sparse_state_->set( dynamic_cast< Core::SparseMaskDataBlock* >( this->
+    get_mask_volume()->get_mask_data_block()->get_unexpanded_data_block().get() ) != 0 );
 
   // Add the number to the project so it can be recorded into the session database
   ProjectManager::Instance()->get_current_project()->add_generation_number( generation_number );
   
-  boost::filesystem::path data_file = ProjectManager::Instance()->get_current_project()->
-    get_project_data_path() / ( this->generation_state_->export_to_string() + ".nrrd" );
-  if ( boost::filesystem::exists( data_file ) )
+  boost::filesystem::path data_path = ProjectManager::Instance()->get_current_project()->
+    get_project_data_path();
+  std::string generation = this->generation_state_->export_to_string();
+  boost::filesystem::path data_file = data_path / 
+    ( generation + Core::DataBlockChunkStore::GetManifestExtension() );
+  if ( boost::filesystem::exists( data_file ) || 
+    boost::filesystem::exists( data_path / ( generation + ".nrrd" ) ) )
   {
     // File has already been saved
     return true;
@@ -301,13 +331,41 @@ bool MaskLayer::pre_save_states( Core::StateIO& state_io )
   bool compress = PreferencesManager::Instance()->compression_state_->get();
   int level = PreferencesManager::Instance()->compression_level_state_->get();
 
-  Core::DataBlockHandle data_block = this->get_mask_volume()->
-    get_mask_data_block()->get_data_block();
-  Core::NrrdDataHandle nrrd( new Core::NrrdData( data_block, this->get_grid_transform() ) );
+  // NOTE: The data is stored in chunks, only the chunks that differ from the ones saved for
+  // earlier generations are written to disk. Only the chunks that changed since the base
+  // generation need to be hashed.
+  Core::MaskDataBlockHandle mask_data_block = this->get_mask_volume()->get_mask_data_block();
+  Core::DataBlockHandle data_block;
+  if ( mask_data_block->is_sparse() )
+  {
+    // NOTE: Write a sparse mask out through a temporary dense copy, so that saving the
+    // session does not keep the mask expanded in memory.
+    Core::DataBlockHandle sparse_data_block = mask_data_block->get_unexpanded_data_block();
+    data_block = Core::StdDataBlock::New( sparse_data_block->get_nx(), 
+      sparse_data_block->get_ny(), sparse_data_block->get_nz(), Core::DataType::UCHAR_E );
+    if ( !data_block )
+    {
+      CORE_LOG_ERROR( "Could not allocate enough memory to save the mask." );
+      return false;
+    }
+    
+    {
+      Core::DataBlock::shared_lock_type lock( sparse_data_block->get_mutex() );
+      static_cast< Core::SparseMaskDataBlock* >( sparse_data_block.get() )->copy_dense(
+        reinterpret_cast< unsigned char* >( data_block->get_data() ) );
+    }
+    data_block->update_histogram();
+  }
+  else
+  {
+    data_block = mask_data_block->get_data_block();
+  }
+  boost::filesystem::path base_file = data_path / ( Core::ExportToString( base_generation ) +
+    Core::DataBlockChunkStore::GetManifestExtension() );
 
   std::string error;
-  Core::DataBlock::shared_lock_type slock( data_block->get_mutex() );
-  if ( !Core::NrrdData::SaveNrrd( data_file.string(), nrrd, error, compress, level ) )
+  if ( !Core::DataBlockChunkStore::Save( data_file, data_block, this->get_grid_transform(), 
+    base_file, base_generation, compress, level, error ) )
   {
     CORE_LOG_ERROR( error );
     return false;
@@ -327,11 +385,50 @@ bool MaskLayer::post_load_states( const Core::StateIO& state_io )
   if ( !success )
   {
     Core::DataVolumeHandle data_volume;
-    boost::filesystem::path volume_path = ProjectManager::Instance()->get_current_project()->
-      get_project_data_path() / ( this->generation_state_->export_to_string() + ".nrrd" );
+    boost::filesystem::path data_path = ProjectManager::Instance()->get_current_project()->
+      get_project_data_path();
+    std::string generation_name = this->generation_state_->export_to_string();
+    boost::filesystem::path manifest_path = data_path / 
+      ( generation_name + Core::DataBlockChunkStore::GetManifestExtension() );
     std::string error;
 
-    if( Core::DataVolume::LoadDataVolume( volume_path, data_volume, error ) )
+    // Sessions saved by older versions store each generation as a single nrrd file
+    bool loaded = false;
+    if ( boost::filesystem::exists( manifest_path ) )
+    {
+      Core::DataBlockHandle data_block;
+      Core::GridTransform data_transform;
+      loaded = Core::DataBlockChunkStore::Load( manifest_path, data_block, data_transform, 
+        error );
+      if ( loaded ) 
+      {
+        data_volume.reset( new Core::DataVolume( data_transform, data_block ) );
+      }
+    }
+    else
+    {
+      loaded = Core::DataVolume::LoadDataVolume( data_path / ( generation_name + ".nrrd" ), 
+        data_volume, error );
+    }
+
+    if ( loaded && this->private_->sparse_state_->get() )
+    {
+      // Compress the mask again, so that the masks that were imported as separate sparse
+      // masks do not each claim a full byte per voxel after loading the session
+      Core::DataBlockHandle data_block = data_volume->get_data_block();
+      Core::SparseMaskDataBlockHandle sparse_data_block;
+      {
+        Core::DataBlock::shared_lock_type lock( data_block->get_mutex() );
+        sparse_data_block = Core::SparseMaskDataBlock::New( 
+          reinterpret_cast< const unsigned char* >( data_block->get_data() ), 1,
+          data_block->get_nx(), data_block->get_ny(), data_block->get_nz() );
+      }
+      Core::DataBlockManager::Instance()->register_datablock( sparse_data_block, generation );
+      grid_transform = data_volume->get_grid_transform();
+      success = Core::MaskDataBlockManager::Instance()->
+        create( grid_transform, sparse_data_block, mask_data_block );
+    }
+    else if( loaded )
     {
       data_volume->register_data( generation );
       Core::MaskDataBlockManager::Instance()->register_data_block( 
@@ -396,6 +493,8 @@ void MaskLayer::compute_isosurface( double quality_factor, bool capping_enabled
     return;
   }
   
+  this->private_->isosurface_rebuild_pending_ = false;
+
   Core::IsosurfaceHandle iso = this->private_->isosurface_;
   if ( !iso )
   {
@@ -404,6 +503,9 @@ void MaskLayer::compute_isosurface( double quality_factor, bool capping_enabled
       boost::bind( &MaskLayerPrivate::handle_isosurface_update_progress, this->private_, _1 ) ) );
   }
   
+  iso->set_triangle_budget( static_cast< size_t >( 
+    PreferencesManager::Instance()->isosurface_triangle_budget_state_->get() ) );
+
   // Set data state to processing so that progress bar is displayed
   this->data_state_->set( Layer::PROCESSING_C );
 
@@ -428,6 +530,39 @@ void MaskLayer::compute_isosurface( double quality_factor, bool capping_enabled
   LayerManager::Instance()->mask_layer_isosurface_created_signal_();
 }
 
+void MaskLayer::update_isosurface()
+{
+  if ( !Core::Application::IsApplicationThread() )
+  {
+    Core::Application::PostEvent( boost::bind( &MaskLayer::update_isosurface, this ) );
+    return;
+  }
+
+  Core::IsosurfaceHandle iso = this->get_isosurface();
+  if ( !iso || !this->iso_generated_state_->get() || !this->show_isosurface_state_->get() ||
+    this->private_->isosurface_rebuild_pending_ )
+  {
+    return;
+  }
+
+  iso->set_triangle_budget( static_cast< size_t >( 
+    PreferencesManager::Instance()->isosurface_triangle_budget_state_->get() ) );
+  this->reset_abort();
+  if ( !iso->update( boost::bind( &Layer::check_abort, this ) ) )
+  {
+    // The change cannot be applied incrementally. Recompute the whole isosurface through the 
+    // action, so it shows progress and can be aborted like any other computation.
+    this->private_->isosurface_rebuild_pending_ = true;
+    ActionComputeIsosurface::Dispatch( Core::Interface::GetWidgetActionContext(),
+      LayerManager::FindMaskLayer( this->get_layer_id() ), iso->get_quality_factor(), 
+      iso->get_capping_enabled(), true );
+    return;
+  }
+
+  this->isosurface_area_state_->set( iso->surface_area() );
+  this->isosurface_updated_signal_();
+}
+
 void MaskLayer::delete_isosurface()
 {
   if ( ! Core::Application::IsApplicationThread() )
@@ -440,6 +575,7 @@ void MaskLayer::delete_isosurface()
     lock_type lock( Layer::GetMutex() );
     this->private_->isosurface_.reset();
   }
+  this->private_->isosurface_rebuild_pending_ = false;
 
   if ( this->show_isosurface_state_->get() )
   {
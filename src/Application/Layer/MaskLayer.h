@@ -116,6 +116,12 @@ public:
   /// Compute the isosurface for this layer using the given quality factor.
   /// Quality factor must be one of: 1.0, 0.5, 0.25, 0.125
   void compute_isosurface( double quality_factor, bool capping_enabled );
+
+  /// UPDATE_ISOSURFACE
+  /// Bring a shown isosurface up to date with the mask, recomputing only the blocks of the 
+  /// isosurface close to the voxels that changed. If the change cannot be applied incrementally,
+  /// a full recomputation is dispatched through ActionComputeIsosurface.
+  void update_isosurface();
   
   /// CALCULATE_VOLUME:
   /// function that is called by the calculate volume action that calculate the volume of the mask
@@ -30,6 +30,10 @@ DEALINGS IN THE SOFTWARE.
 #include <boost/filesystem.hpp>
 
 #include <sstream>
+#include <tuple>
+
+// Core includes
+#include <Core/Utils/FilesystemUtil.h>
 
 // Application includes
 #include <Application/LayerIO/Actions/ActionExportIsosurface.h>
@@ -67,6 +71,16 @@ bool ActionExportIsosurface::validate( Core::ActionContextHandle& context )
     context->report_error( std::string( "Isosurface is empty." ) );
     return false;
   }
+
+  if ( this->lod_level_ < 0 || static_cast< size_t >( this->lod_level_ ) >= 
+    mask_layer->get_isosurface()->get_num_lod_levels() )
+  {
+    std::ostringstream error;
+    error << "Level of detail " << this->lod_level_ << " is not available, the isosurface has " <<
+      mask_layer->get_isosurface()->get_num_lod_levels() << " levels of detail.";
+    context->report_error( error.str() );
+    return false;
+  }
   
   boost::filesystem::path isosurface_path( this->file_path_ );
   if ( ! boost::filesystem::exists ( isosurface_path.parent_path() ) )
@@ -77,13 +91,17 @@ bool ActionExportIsosurface::validate( Core::ActionContextHandle& context )
     return false;
   }
   
-  boost::filesystem::path extension = isosurface_path.extension();
+  std::string extension;
+  std::tie( extension, std::ignore ) = Core::GetFullExtension( isosurface_path );
   
   if (! ( (extension == ".fac") ||
           (extension == ".pts") ||
           (extension == ".val") ||
           (extension == ".stl") ||
-          (extension == ".vtk") ) )
+          (extension == ".vtk") ||
+          (extension == ".vtk.gz") ||
+          (extension == ".ply") ||
+          (extension == ".ply.gz") ) )
   {
     std::ostringstream error;
     error << extension << " is not supported for isosurface export.";
@@ -109,7 +127,8 @@ bool ActionExportIsosurface::run( Core::ActionContextHandle& context, Core::Acti
   progress->begin_progress_reporting();
   
   boost::filesystem::path filename_and_path = boost::filesystem::path( this->file_path_ );
-  boost::filesystem::path extension = filename_and_path.extension();
+  std::string extension;
+  std::tie( extension, std::ignore ) = Core::GetFullExtension( filename_and_path );
   
   LayerHandle temp_handle = LayerManager::Instance()->find_layer_by_id( this->layer_ );
   MaskLayer* mask_layer = dynamic_cast< MaskLayer* >( temp_handle.get() );
@@ -118,22 +137,35 @@ bool ActionExportIsosurface::run( Core::ActionContextHandle& context, Core::Acti
   {
     boost::filesystem::path file_path = filename_and_path.parent_path();
     boost::filesystem::path file_prefix = filename_and_path.stem();
-    mask_layer->get_isosurface()->export_legacy_isosurface(file_path, file_prefix.string());
+    mask_layer->get_isosurface()->export_legacy_isosurface(file_path, file_prefix.string(), 
+      this->lod_level_ );
   }
   else if (extension == ".stl")
   {
     if (this->binary_file_export_)
     {
-      mask_layer->get_isosurface()->export_stl_binary_isosurface( filename_and_path, this->name_ );
+      mask_layer->get_isosurface()->export_stl_binary_isosurface( filename_and_path, this->name_,
+        this->lod_level_ );
     }
     else
     {
-      mask_layer->get_isosurface()->export_stl_ascii_isosurface( filename_and_path, this->name_ );
+      mask_layer->get_isosurface()->export_stl_ascii_isosurface( filename_and_path, this->name_,
+        this->lod_level_ );
     }
   }
+  else if ( (extension == ".ply") || (extension == ".ply.gz") )
+  {
+    mask_layer->get_isosurface()->export_ply_binary_isosurface( filename_and_path,
+      extension == ".ply.gz", this->lod_level_ );
+  }
+  else if ( this->binary_file_export_ || (extension == ".vtk.gz") )
+  {
+    mask_layer->get_isosurface()->export_vtk_binary_isosurface( filename_and_path,
+      extension == ".vtk.gz", this->lod_level_ );
+  }
   else
   {
-    mask_layer->get_isosurface()->export_vtk_isosurface( filename_and_path );
+    mask_layer->get_isosurface()->export_vtk_isosurface( filename_and_path, this->lod_level_ );
   }
   
   ProjectManager::Instance()->current_file_folder_state_->set( filename_and_path.parent_path().string() );
@@ -153,7 +185,8 @@ void ActionExportIsosurface::Dispatch( Core::ActionContextHandle context,
                                        const std::string& layer_id,
                                        const std::string& file_path,
                                        const std::string& name,
-                                       const bool binary_file_export )
+                                       const bool binary_file_export,
+                                       const int lod_level )
 {
   // Create new action
   ActionExportIsosurface* action = new ActionExportIsosurface;
@@ -162,6 +195,7 @@ void ActionExportIsosurface::Dispatch( Core::ActionContextHandle context,
   action->file_path_ = file_path;
   action->name_ = name;
   action->binary_file_export_ = binary_file_export;
+  action->lod_level_ = lod_level;
   
   Core::ActionDispatcher::PostAction( Core::ActionHandle( action ), context );
 }
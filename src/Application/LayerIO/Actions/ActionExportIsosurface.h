@@ -46,7 +46,8 @@ CORE_ACTION(
   CORE_ACTION_ARGUMENT( "layer", "layer to be exported." )
   CORE_ACTION_ARGUMENT( "file_path", "A path, including the name of the file where the layer should be exported to." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "name", "<none>", "Optional dataset name. Currently only used for STL files (defaults to layer ID if name is not set)." )
-  CORE_ACTION_OPTIONAL_ARGUMENT( "binary", "false", "Optionally export binary file. Currently only available for STL files.")
+  CORE_ACTION_OPTIONAL_ARGUMENT( "binary", "false", "Optionally export binary file for STL and VTK files. PLY files are always binary, and .ply.gz and .vtk.gz files are binary and gzip compressed.")
+  CORE_ACTION_OPTIONAL_ARGUMENT( "lod_level", "0", "Level of detail to export, 0 exports the full resolution isosurface and higher levels export decimated versions.")
   CORE_ACTION_CHANGES_PROJECT_DATA()
 )
   
@@ -58,6 +59,7 @@ public:
     this->add_parameter( this->file_path_ );
     this->add_parameter( this->name_ );
     this->add_parameter( this->binary_file_export_ );
+    this->add_parameter( this->lod_level_ );
   }
   
   // -- Functions that describe action --
@@ -92,6 +94,9 @@ private:
   // Optionally export binary file format
   bool binary_file_export_;
 
+  // Level of detail that is exported
+  int lod_level_;
+
   // -- Dispatch this action from the interface --
 public:
 
@@ -100,7 +105,8 @@ public:
                        const std::string& layer_id, 
                        const std::string& file_path,
                        const std::string& name = "<none>",
-                       const bool binary_file_export = false );
+                       const bool binary_file_export = false,
+                       const int lod_level = 0 );
 };
 
 } // end namespace Seg3D
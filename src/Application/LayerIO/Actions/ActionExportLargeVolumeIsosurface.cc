@@ -0,0 +1,167 @@
+/*
+For more information, please see: http://software.sci.utah.edu
+
+The MIT License
+
+Copyright (c) 2016 Scientific Computing and Imaging Institute,
+University of Utah.
+
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+// Boost includes
+#include <boost/filesystem.hpp>
+
+#include <sstream>
+
+// Core includes
+#include <Core/Isosurface/LargeVolumeIsosurface.h>
+
+// Application includes
+#include <Application/LayerIO/Actions/ActionExportLargeVolumeIsosurface.h>
+#include <Application/Layer/LayerManager.h>
+#include <Application/Layer/LargeVolumeLayer.h>
+#include <Application/ProjectManager/ProjectManager.h>
+
+// REGISTER ACTION:
+// Define a function that registers the action. The action also needs to be
+// registered in the CMake file.
+CORE_REGISTER_ACTION( Seg3D, ExportLargeVolumeIsosurface )
+
+namespace Seg3D
+{
+
+bool ActionExportLargeVolumeIsosurface::validate( Core::ActionContextHandle& context )
+{
+  // Check for layer existence and type information
+  if ( ! LayerManager::CheckLayerExistenceAndType( this->layer_, 
+    Core::VolumeType::LARGE_DATA_E, context ) ) return false;
+
+  LayerHandle layer = LayerManager::FindLayer( this->layer_ );
+  LargeVolumeLayerHandle lv = boost::dynamic_pointer_cast<LargeVolumeLayer>( layer );
+  Core::LargeVolumeSchemaHandle schema = lv->get_schema();
+
+  if ( this->level_ < 0 || static_cast< size_t >( this->level_ ) >= schema->get_num_levels() )
+  {
+    context->report_error( "Level needs to be a level between 0 and " + 
+      Core::ExportToString( schema->get_num_levels() - 1 ) + "." );
+    return false;
+  }
+
+  if ( this->mask_bits_ == 0 && this->min_value_ > this->max_value_ )
+  {
+    context->report_error( "The minimum value needs to be smaller than the maximum value." );
+    return false;
+  }
+  
+  boost::filesystem::path isosurface_path( this->file_path_ );
+  if ( ! boost::filesystem::exists ( isosurface_path.parent_path() ) )
+  {
+    std::ostringstream error;
+    error << "The path '" << this->file_path_ << "' does not exist.";
+    context->report_error( error.str() );
+    return false;
+  }
+  
+  boost::filesystem::path extension = isosurface_path.extension();
+  if ( extension != ".stl" && extension != ".ply" )
+  {
+    std::ostringstream error;
+    error << extension << " is not supported for large volume isosurface export.";
+    context->report_error( error.str() );
+    return false;
+  }
+  
+  if ( this->name_ == "<none>" )
+  {
+    // fall back to layer ID
+    this->name_ = this->layer_;
+  }
+  
+  return true; // validated
+}
+
+bool ActionExportLargeVolumeIsosurface::run( Core::ActionContextHandle& context, 
+  Core::ActionResultHandle& result )
+{
+  std::string message = std::string( "Exporting the isosurface of the large volume." );
+  
+  Core::ActionProgressHandle progress = 
+    Core::ActionProgressHandle( new Core::ActionProgress( message, true, true ) );
+  
+  LayerHandle layer = LayerManager::FindLayer( this->layer_ );
+  LargeVolumeLayerHandle lv = boost::dynamic_pointer_cast<LargeVolumeLayer>( layer );
+
+  Core::LargeVolumeIsosurface isosurface( lv->get_schema() );
+  isosurface.set_level( static_cast< size_t >( this->level_ ) );
+  if ( this->mask_bits_ != 0 )
+  {
+    isosurface.set_mask( static_cast< unsigned int >( this->mask_bits_ ) );
+  }
+  else
+  {
+    isosurface.set_threshold( this->min_value_, this->max_value_ );
+  }
+  isosurface.update_progress_signal_.connect( 
+    boost::bind( &Core::ActionProgress::set_progress, progress, _1 ) );
+
+  progress->begin_progress_reporting();
+
+  boost::filesystem::path filename_and_path = boost::filesystem::path( this->file_path_ );
+  std::string error;
+  bool success = isosurface.export_isosurface( filename_and_path, this->name_,
+    boost::bind( &Core::ActionProgress::get_interrupt, progress ), error );
+
+  progress->end_progress_reporting();
+
+  if ( ! success )
+  {
+    context->report_error( error );
+    return false;
+  }
+
+  ProjectManager::Instance()->current_file_folder_state_->set( 
+    filename_and_path.parent_path().string() );
+  
+  return true;
+}
+
+void ActionExportLargeVolumeIsosurface::Dispatch( Core::ActionContextHandle context,
+                                                  const std::string& layer_id,
+                                                  const std::string& file_path,
+                                                  double min_value,
+                                                  double max_value,
+                                                  int level )
+{
+  // Create new action
+  ActionExportLargeVolumeIsosurface* action = new ActionExportLargeVolumeIsosurface;
+  
+  action->layer_ = layer_id;
+  action->file_path_ = file_path;
+  action->name_ = "<none>";
+  action->min_value_ = min_value;
+  action->max_value_ = max_value;
+  action->mask_bits_ = 0;
+  action->level_ = level;
+  
+  Core::ActionDispatcher::PostAction( Core::ActionHandle( action ), context );
+}
+
+} // end namespace Seg3D
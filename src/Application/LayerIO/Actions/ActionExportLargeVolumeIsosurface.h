@@ -0,0 +1,115 @@
+/*
+For more information, please see: http://software.sci.utah.edu
+
+The MIT License
+
+Copyright (c) 2016 Scientific Computing and Imaging Institute,
+University of Utah.
+
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef APPLICATION_LAYERIO_ACTIONS_ACTIONEXPORTLARGEVOLUMEISOSURFACE_H
+#define APPLICATION_LAYERIO_ACTIONS_ACTIONEXPORTLARGEVOLUMEISOSURFACE_H
+
+// Core includes
+#include <Core/Action/Actions.h>
+#include <Core/Interface/Interface.h>
+
+namespace Seg3D
+{
+
+class ActionExportLargeVolumeIsosurface : public Core::Action
+{
+  
+CORE_ACTION( 
+  CORE_ACTION_TYPE( "ExportLargeVolumeIsosurface", "This action extracts an isosurface from a large volume layer brick by brick and streams it to file.")
+  CORE_ACTION_ARGUMENT( "layer", "Large volume layer from which the isosurface is extracted." )
+  CORE_ACTION_ARGUMENT( "file_path", "A path, including the name of the .stl or .ply file where the isosurface should be exported to." )
+  CORE_ACTION_ARGUMENT( "min_value", "Lower bound of the values that are inside the isosurface." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "name", "<none>", "Optional dataset name. Currently only used for STL files (defaults to layer ID if name is not set)." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "max_value", "1e300", "Upper bound of the values that are inside the isosurface." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "mask_bits", "0", "If not zero, voxels with any of these bits set are inside the isosurface and the threshold is ignored." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "level", "0", "Resolution level of the large volume, 0 is full resolution." )
+)
+  
+  // -- Constructor/Destructor --
+public:
+  ActionExportLargeVolumeIsosurface()
+  {
+    this->add_parameter( this->layer_ );
+    this->add_parameter( this->file_path_ );
+    this->add_parameter( this->min_value_ );
+    this->add_parameter( this->name_ );
+    this->add_parameter( this->max_value_ );
+    this->add_parameter( this->mask_bits_ );
+    this->add_parameter( this->level_ );
+  }
+  
+  // -- Functions that describe action --
+public:
+  // VALIDATE:
+  // Each action needs to be validated just before it is posted. This way we
+  // enforce that every action that hits the main post_action signal will be
+  // a valid action to execute.
+  virtual bool validate( Core::ActionContextHandle& context ) override;
+  
+  // RUN:
+  // Each action needs to have this piece implemented. It spells out how the
+  // action is run. It returns whether the action was successful or not.
+  virtual bool run( Core::ActionContextHandle& context, Core::ActionResultHandle& result ) override;
+  
+  // -- Action parameters --
+private:
+  
+  // Where the isosurface should be exported
+  std::string file_path_;
+  
+  // The large volume layer
+  std::string layer_;
+  
+  // Optional dataset name
+  std::string name_;
+
+  // Range of values inside the isosurface
+  double min_value_;
+  double max_value_;
+
+  // Mask bits, when not zero these replace the threshold
+  int mask_bits_;
+
+  // Resolution level that is used
+  int level_;
+
+  // -- Dispatch this action from the interface --
+public:
+
+  // DISPATCH:
+  static void Dispatch( Core::ActionContextHandle context,
+                       const std::string& layer_id, 
+                       const std::string& file_path,
+                       double min_value,
+                       double max_value,
+                       int level = 0 );
+};
+
+} // end namespace Seg3D
+
+#endif
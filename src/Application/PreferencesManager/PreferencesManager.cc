@@ -34,6 +34,7 @@
 // Core includes
 #include <Core/Application/Application.h>
 #include <Core/State/StateIO.h>
+#include <Core/LargeVolume/LargeVolumeCache.h>
 
 // Application includes
 #include <Application/PreferencesManager/PreferencesManager.h>
@@ -49,6 +50,7 @@ class PreferencesManagerPrivate
 {
 public:
   void handle_axis_labels_option_changed( std::string option );
+  void handle_large_volume_cache_gb_changed( int gb );
 
   std::vector< Core::Color > default_colors_;
   boost::filesystem::path local_config_path_;
@@ -83,6 +85,17 @@ void PreferencesManagerPrivate::handle_axis_labels_option_changed( std::string o
   }
 }
 
+void PreferencesManagerPrivate::handle_large_volume_cache_gb_changed( int gb )
+{
+  // The cachegb command line parameter takes precedence over the preference
+  std::string cache_gb;
+  if ( Core::Application::Instance()->check_command_line_parameter( "cachegb", cache_gb ) ) return;
+
+  Core::LargeVolumeCache* cache = Core::LargeVolumeCache::Instance();
+  if ( gb > 0 ) cache->set_capacity( static_cast<long long>( gb ) << 30 );
+  else cache->set_capacity( cache->get_default_capacity() );
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Class PreferencesManager
 //////////////////////////////////////////////////////////////////////////
@@ -106,6 +119,13 @@ PreferencesManager::PreferencesManager() :
   // After we initialize the states, we then load the saved preferences from file.
   this->initialize();
   this->set_initializing( false );
+
+  // Only apply a cache size that was set by the user, the cache picks its own otherwise
+  if ( this->large_volume_cache_gb_state_->get() > 0 )
+  {
+    this->private_->handle_large_volume_cache_gb_changed( 
+      this->large_volume_cache_gb_state_->get() );
+  }
 }
 
 PreferencesManager::~PreferencesManager()
@@ -208,6 +228,8 @@ void PreferencesManager::initialize_states()
   this->add_state( "default_layer_opacity", this->default_layer_opacity_state_, 1.0, 0.0, 1.0, 0.01 );
   this->add_state( "default_mask_fill", this->default_mask_fill_state_, "striped", "none|striped|solid" );
   this->add_state( "default_mask_border", this->default_mask_border_state_, "thick", "none|thin|thick" );
+  this->add_state( "isosurface_triangle_budget", this->isosurface_triangle_budget_state_, 
+    500000, 0, 10000000, 50000 );
     
   this->color_states_.resize( 12 );
   for ( size_t j = 0; j < 12; j++ )
@@ -226,10 +248,14 @@ void PreferencesManager::initialize_states()
   this->add_state( "show_rendering_bar", this->show_rendering_bar_state_, false );
 
   this->add_state( "enable_large_volume", this->enable_large_volume_state_, false );
+  this->add_state( "large_volume_cache_gb", this->large_volume_cache_gb_state_, 0, 0, 1024, 1 );
 
   this->add_connection( this->axis_labels_option_state_->value_changed_signal_.connect(
     boost::bind( &PreferencesManagerPrivate::handle_axis_labels_option_changed, 
     this->private_, _2 ) ) );
+  this->add_connection( this->large_volume_cache_gb_state_->value_changed_signal_.connect(
+    boost::bind( &PreferencesManagerPrivate::handle_large_volume_cache_gb_changed, 
+    this->private_, _1 ) ) );
 }
 
 
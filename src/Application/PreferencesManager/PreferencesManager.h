@@ -102,6 +102,7 @@ public:
   Core::StateRangedDoubleHandle default_layer_opacity_state_;
   Core::StateOptionHandle default_mask_fill_state_;
   Core::StateOptionHandle default_mask_border_state_;
+  Core::StateRangedIntHandle isosurface_triangle_budget_state_;
   std::vector< Core::StateColorHandle > color_states_;
 
   //Interface Controls Preferences
@@ -116,6 +117,8 @@ public:
 
   // Large volume preferences
   Core::StateBoolHandle enable_large_volume_state_;
+  // Size of the large volume brick cache in GB, zero picks it from the memory size
+  Core::StateRangedIntHandle large_volume_cache_gb_state_;
   
 public:
   /// GET_DEFAULT_COLORS:
@@ -45,6 +45,7 @@
 #include <Core/Utils/FilesystemUtil.h>
 #include <Core/Utils/StringUtil.h>
 #include <Core/Utils/Log.h>
+#include <Core/DataBlock/DataBlockChunkStore.h>
 #include <Core/DataBlock/DataBlockManager.h>
 
 // Application includes
@@ -558,8 +559,10 @@ void ProjectPrivate::clean_up_data_files()
     
     // Skip directories
     if ( !boost::filesystem::is_regular_file( file_path ) ) continue;
-    // Skip non-nrrd files
-    if ( Core::StringToLower( file_path.extension().string() ) != ".nrrd" ) continue;
+    // Skip files that are not nrrd files or chunk manifests
+    std::string extension = Core::StringToLower( file_path.extension().string() );
+    if ( extension != ".nrrd" && 
+      extension != Core::DataBlockChunkStore::GetManifestExtension() ) continue;
 
     std::string file_name = file_path.stem().string();
     try
@@ -574,6 +577,9 @@ void ProjectPrivate::clean_up_data_files()
     }
     catch ( ... ) { /* Ignore any exceptions */ }
   }
+
+  // Remove the chunks that are no longer used by any of the remaining generations
+  Core::DataBlockChunkStore::RemoveUnusedChunks( data_path );
 }
 
 
@@ -2443,23 +2449,49 @@ bool Project::export_project( const boost::filesystem::path& export_path,
   // Copy those data files
   BOOST_FOREACH( Core::DataBlock::generation_type generation, generations )
   {
-    boost::filesystem::path src_file = project_path / DATA_DIR_C / 
-      ( Core::ExportToString( generation ) + ".nrrd" );
-    boost::filesystem::path dst_file = export_path / DATA_DIR_C /
-      ( Core::ExportToString( generation ) + ".nrrd" );
-    if ( !boost::filesystem::exists( src_file ) )
+    boost::filesystem::path src_dir = project_path / DATA_DIR_C;
+    boost::filesystem::path dst_dir = export_path / DATA_DIR_C;
+
+    std::vector< boost::filesystem::path > data_files;
+    std::string manifest_file = Core::ExportToString( generation ) + 
+      Core::DataBlockChunkStore::GetManifestExtension();
+    if ( boost::filesystem::exists( src_dir / manifest_file ) )
     {
-      CORE_LOG_ERROR( "Missing data file '" + src_file.string() + "'." );
-      return false;
+      // Copy the manifest and all the chunks it refers to
+      if ( !Core::DataBlockChunkStore::GetChunkFiles( src_dir / manifest_file, 
+        data_files, error ) )
+      {
+        CORE_LOG_ERROR( error );
+        return false;
+      }
+      data_files.push_back( manifest_file );
     }
-    try
+    else
     {
-      boost::filesystem::copy_file( src_file, dst_file );
+      data_files.push_back( Core::ExportToString( generation ) + ".nrrd" );
     }
-    catch ( ... )
+
+    BOOST_FOREACH( const boost::filesystem::path& data_file, data_files )
     {
-      CORE_LOG_ERROR( "Failed to copy file '" + src_file.string() + "'." );
-      return false;
+      boost::filesystem::path src_file = src_dir / data_file;
+      boost::filesystem::path dst_file = dst_dir / data_file;
+      if ( !boost::filesystem::exists( src_file ) )
+      {
+        CORE_LOG_ERROR( "Missing data file '" + src_file.string() + "'." );
+        return false;
+      }
+      // Chunks may be shared between generations
+      if ( boost::filesystem::exists( dst_file ) ) continue;
+      try
+      {
+        boost::filesystem::create_directories( dst_file.parent_path() );
+        boost::filesystem::copy_file( src_file, dst_file );
+      }
+      catch ( ... )
+      {
+        CORE_LOG_ERROR( "Failed to copy file '" + src_file.string() + "'." );
+        return false;
+      }
     }
   }
 
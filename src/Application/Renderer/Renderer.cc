@@ -902,6 +902,12 @@ void RendererPrivate::draw_isosurfaces( const IsosurfaceArray& isosurfaces )
     {
       continue;
     }
+
+    // Large isosurfaces are drawn at a decimated level of detail, as a view cannot show more
+    // triangles than it has pixels
+    size_t lod_level = iso->select_lod_level( static_cast< size_t >( this->renderer_->width_ ) * 
+      static_cast< size_t >( this->renderer_->height_ ) );
+
                 this->isosurface_shader_->set_opacity( isosurfaces[ i ]->opacity_ );
                 glColor4d( isosurfaces[ i ]->color_.r() / 255.0, isosurfaces[ i ]->color_.g() / 255.0,
                         isosurfaces[ i ]->color_.b() / 255.0, isosurfaces[ i ]->opacity_ );
@@ -915,12 +921,12 @@ void RendererPrivate::draw_isosurfaces( const IsosurfaceArray& isosurfaces )
       Core::Texture1DHandle colormap_tex = colormap->get_texture();
       Core::Texture::lock_type tex_lock( colormap_tex->get_mutex() );
       colormap_tex->bind();
-      iso->redraw( true );
+      iso->redraw( true, lod_level );
       colormap_tex->unbind();
     }
     else
     {
-      iso->redraw( false );
+      iso->redraw( false, lod_level );
     }
     CORE_CHECK_OPENGL_ERROR();
   }
@@ -136,7 +136,7 @@ public:
     LargeVolumeLayerHandle lv = boost::dynamic_pointer_cast<LargeVolumeLayer>( this->src_layer_ );
     Core::LargeVolumeSchemaHandle schema = lv->get_schema();
 
-    Core::IndexVector::index_type overlap = static_cast<Core::IndexVector::index_type> ( schema->get_overlap() );
+    Core::IndexVector overlap = schema->get_brick_overlap();
 
     if ( this->level_ >= schema->get_num_levels() )
     {
@@ -185,9 +185,9 @@ public:
             y * eff_brick_size.y(),
             z * eff_brick_size.z());
       
-          if ( ( this->start_.x() < ( origin.x() + ( size.x() - 2 * overlap ) ) && this->end_.x() > origin.x() ) &&
-            ( this->start_.y() < ( origin.y() + ( size.y() - 2 * overlap ) ) && this->end_.y() > origin.y() ) &&
-            ( this->start_.z() < ( origin.z() + ( size.z() - 2 * overlap ) ) && this->end_.z() > origin.z() ) )
+          if ( ( this->start_.x() < ( origin.x() + ( size.x() - 2 * overlap.x() ) ) && this->end_.x() > origin.x() ) &&
+            ( this->start_.y() < ( origin.y() + ( size.y() - 2 * overlap.y() ) ) && this->end_.y() > origin.y() ) &&
+            ( this->start_.z() < ( origin.z() + ( size.z() - 2 * overlap.z() ) ) && this->end_.z() > origin.z() ) )
           {
             total++;
           }
@@ -212,9 +212,9 @@ public:
             y * eff_brick_size.y(),
             z * eff_brick_size.z());
       
-          if ( ( this->start_.x() < ( origin.x() + ( size.x() - 2 * overlap ) ) && this->end_.x() > origin.x() ) &&
-            ( this->start_.y() < ( origin.y() + ( size.y() - 2 * overlap ) ) && this->end_.y() > origin.y() ) &&
-            ( this->start_.z() < ( origin.z() + ( size.z() - 2 * overlap ) ) && this->end_.z() > origin.z() ) )
+          if ( ( this->start_.x() < ( origin.x() + ( size.x() - 2 * overlap.x() ) ) && this->end_.x() > origin.x() ) &&
+            ( this->start_.y() < ( origin.y() + ( size.y() - 2 * overlap.y() ) ) && this->end_.y() > origin.y() ) &&
+            ( this->start_.z() < ( origin.z() + ( size.z() - 2 * overlap.z() ) ) && this->end_.z() > origin.z() ) )
           {
             Core::DataBlockHandle brick;
 
@@ -231,9 +231,9 @@ public:
               Core::Max( static_cast< Core::IndexVector::index_type>( 0 ) , this->start_.z() - origin.z() ) );
 
             Core::IndexVector clip_end = Core::IndexVector(
-              Core::Min( size.x() - 2 * overlap, this->end_.x() - origin.x() ),
-              Core::Min( size.y() - 2 * overlap, this->end_.y() - origin.y() ),
-              Core::Min( size.z() - 2 * overlap, this->end_.z() - origin.z() ) );
+              Core::Min( size.x() - 2 * overlap.x(), this->end_.x() - origin.x() ),
+              Core::Min( size.y() - 2 * overlap.y(), this->end_.y() - origin.y() ),
+              Core::Min( size.z() - 2 * overlap.z(), this->end_.z() - origin.z() ) );
           
             Core::IndexVector offset = Core::IndexVector( 
               Core::Max( static_cast< Core::IndexVector::index_type>( 0 ), x * eff_brick_size.x() - this->start_.x() ),
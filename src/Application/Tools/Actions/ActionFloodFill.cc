@@ -26,15 +26,23 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+
+#include <boost/bind.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 
 #include <Core/Action/ActionFactory.h>
+#include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/DataBlock/VolumeFloodFill.h>
 #include <Core/Volume/MaskVolumeSlice.h>
 #include <Core/Volume/DataVolumeSlice.h>
 #include <Core/Graphics/Algorithm.h>
+#include <Core/Math/MathFunctions.h>
 
 #include <Application/Tools/Actions/ActionFloodFill.h>
+#include <Application/Filters/LayerFilter.h>
+#include <Application/Layer/DataLayer.h>
 #include <Application/Layer/MaskLayer.h>
 #include <Application/Layer/LayerManager.h>
 #include <Application/Layer/LayerUndoBufferItem.h>
@@ -63,6 +71,7 @@ public:
   std::string mask_cstr2_layer_id_;
   bool negative_mask_cstr2_;
   bool erase_;
+  bool fill_3d_;
   SandboxID sandbox_;
 
   Core::MaskVolumeSliceHandle vol_slice_;
@@ -71,8 +80,261 @@ public:
   Core::MaskVolumeSliceHandle mask_cstr2_slice_;
 
   std::vector< std::pair< int, int > > seeds_2d_;
+
+  // The constraints and seeds for filling the whole volume
+  DataLayerHandle data_cstr_layer_;
+  MaskLayerHandle mask_cstr1_layer_;
+  MaskLayerHandle mask_cstr2_layer_;
+  std::vector< Core::IndexVector > seeds_3d_;
+};
+
+// APPLYMASKCONSTRAINT:
+// Close the voxels of which the mask bit is not set, or set if the constraint is negated.
+static void ApplyMaskConstraint( const Core::MaskDataBlockHandle& mask_block, bool negative, 
+  size_t begin, unsigned char* open, size_t size )
+{
+  const unsigned char* mask_data = mask_block->get_mask_data() + begin;
+  unsigned char mask_value = mask_block->get_mask_value();
+  for ( size_t j = 0; j < size; j++ )
+  {
+    if ( ( ( mask_data[ j ] & mask_value ) != 0 ) == negative ) open[ j ] = 0;
+  }
+}
+
+// APPLYDATACONSTRAINT:
+// Close the voxels of which the data is outside the range, or inside if the constraint is
+// negated.
+template< class T >
+static void ApplyDataConstraint( const Core::DataBlockHandle& data_block, double min_val, 
+  double max_val, bool negative, size_t begin, unsigned char* open, size_t size )
+{
+  const T* data = static_cast< const T* >( data_block->get_data() ) + begin;
+  for ( size_t j = 0; j < size; j++ )
+  {
+    bool in_range = ( data[ j ] >= min_val && data[ j ] <= max_val );
+    if ( in_range == negative ) open[ j ] = 0;
+  }
+}
+
+// FILLMASKSPAN:
+// Set or clear the mask bit of the voxels [begin, end).
+static void FillMaskSpan( unsigned char* mask_data, unsigned char mask_value, bool erase,
+  size_t begin, size_t end )
+{
+  if ( erase )
+  {
+    unsigned char not_mask_value = ~mask_value;
+    for ( size_t j = begin; j < end; j++ ) mask_data[ j ] &= not_mask_value;
+  }
+  else
+  {
+    for ( size_t j = begin; j < end; j++ ) mask_data[ j ] |= mask_value;
+  }
+}
+
+// ALGORITHM CLASS
+// This class fills the region in the whole volume and is run on a separate thread.
+
+class FloodFillVolumeAlgo : public LayerFilter
+{
+
+public:
+  LayerHandle dst_layer_;
+
+  DataLayerHandle data_cstr_layer_;
+  double min_val_;
+  double max_val_;
+  bool negative_data_cstr_;
+  MaskLayerHandle mask_cstr1_layer_;
+  bool negative_mask_cstr1_;
+  MaskLayerHandle mask_cstr2_layer_;
+  bool negative_mask_cstr2_;
+  bool erase_;
+  std::vector< Core::IndexVector > seeds_;
+
+  // The mask that is filled, which starts as a copy of the mask of the layer, and the
+  // constraints
+  Core::MaskDataBlockHandle mask_block_;
+  Core::DataBlockHandle data_cstr_block_;
+  Core::MaskDataBlockHandle mask_cstr1_block_;
+  Core::MaskDataBlockHandle mask_cstr2_block_;
+
+public:
+  // RUN_FILTER:
+  // Implemtation of run of the Runnable base class, this function is called when the thread
+  // is launched.
+  virtual void run_filter();
+
+  // COMPUTE_OPEN_SLICE:
+  // Mark the voxels of axial slice z that may be filled.
+  void compute_open_slice( size_t z, unsigned char* open );
+
+  // UPDATE_FILL_PROGRESS:
+  // Forward the progress of the fill to the layer and check whether the filter needs to
+  // abort.
+  bool update_fill_progress( double progress )
+  {
+    this->dst_layer_->update_progress( progress );
+    return !this->check_abort();
+  }
+
+  // GET_FITLER_NAME:
+  // The name of the filter, this information is used for generating new layer labels.
+  virtual std::string get_filter_name() const
+  {
+    return "FloodFill Filter";
+  }
+
+  // GET_LAYER_PREFIX:
+  // This function returns the name of the filter. The latter is prepended to the new layer name, 
+  // when a new layer is generated. 
+  virtual std::string get_layer_prefix() const
+  {
+    return "FloodFill"; 
+  }
 };
 
+void FloodFillVolumeAlgo::compute_open_slice( size_t z, unsigned char* open )
+{
+  size_t size = this->mask_block_->get_nx() * this->mask_block_->get_ny();
+  size_t begin = z * size;
+
+  // Filling stops at voxels that are already filled, erasing at voxels that are empty
+  const unsigned char* mask_data = this->mask_block_->get_mask_data() + begin;
+  unsigned char mask_value = this->mask_block_->get_mask_value();
+  for ( size_t j = 0; j < size; j++ )
+  {
+    open[ j ] = ( ( mask_data[ j ] & mask_value ) != 0 ) == this->erase_;
+  }
+
+  if ( this->mask_cstr1_block_ )
+  {
+    ApplyMaskConstraint( this->mask_cstr1_block_, this->negative_mask_cstr1_, 
+      begin, open, size );
+  }
+  if ( this->mask_cstr2_block_ )
+  {
+    ApplyMaskConstraint( this->mask_cstr2_block_, this->negative_mask_cstr2_, 
+      begin, open, size );
+  }
+
+  if ( this->data_cstr_block_ )
+  {
+    switch ( this->data_cstr_block_->get_data_type() )
+    {
+    case Core::DataType::CHAR_E:
+      ApplyDataConstraint< signed char >( this->data_cstr_block_, this->min_val_, 
+        this->max_val_, this->negative_data_cstr_, begin, open, size );
+      break;
+    case Core::DataType::UCHAR_E:
+      ApplyDataConstraint< unsigned char >( this->data_cstr_block_, this->min_val_, 
+        this->max_val_, this->negative_data_cstr_, begin, open, size );
+      break;
+    case Core::DataType::SHORT_E:
+      ApplyDataConstraint< short >( this->data_cstr_block_, this->min_val_, 
+        this->max_val_, this->negative_data_cstr_, begin, open, size );
+      break;
+    case Core::DataType::USHORT_E:
+      ApplyDataConstraint< unsigned short >( this->data_cstr_block_, this->min_val_, 
+        this->max_val_, this->negative_data_cstr_, begin, open, size );
+      break;
+    case Core::DataType::INT_E:
+      ApplyDataConstraint< int >( this->data_cstr_block_, this->min_val_, 
+        this->max_val_, this->negative_data_cstr_, begin, open, size );
+      break;
+    case Core::DataType::UINT_E:
+      ApplyDataConstraint< unsigned int >( this->data_cstr_block_, this->min_val_, 
+        this->max_val_, this->negative_data_cstr_, begin, open, size );
+      break;
+    case Core::DataType::FLOAT_E:
+      ApplyDataConstraint< float >( this->data_cstr_block_, this->min_val_, 
+        this->max_val_, this->negative_data_cstr_, begin, open, size );
+      break;
+    case Core::DataType::DOUBLE_E:
+      ApplyDataConstraint< double >( this->data_cstr_block_, this->min_val_, 
+        this->max_val_, this->negative_data_cstr_, begin, open, size );
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void FloodFillVolumeAlgo::run_filter()
+{
+  // NOTE: The region is filled in a copy of the mask, so that an aborted fill leaves the layer
+  // unchanged.
+  Core::MaskDataBlockHandle src_mask = boost::dynamic_pointer_cast< MaskLayer >( 
+    this->dst_layer_ )->get_mask_volume()->get_mask_data_block();
+  if ( !Core::MaskDataBlockManager::Duplicate( src_mask, this->dst_layer_->get_grid_transform(),
+    this->mask_block_ ) )
+  {
+    this->report_error( "Could not allocate enough memory." );
+    return;
+  }
+
+  if ( this->data_cstr_layer_ )
+  {
+    this->data_cstr_block_ = this->data_cstr_layer_->get_data_volume()->get_data_block();
+  }
+  if ( this->mask_cstr1_layer_ )
+  {
+    this->mask_cstr1_block_ = this->mask_cstr1_layer_->get_mask_volume()->get_mask_data_block();
+  }
+  if ( this->mask_cstr2_layer_ )
+  {
+    this->mask_cstr2_block_ = this->mask_cstr2_layer_->get_mask_volume()->get_mask_data_block();
+  }
+
+  if ( this->check_abort() ) return;
+
+  // Expand sparse masks before any of the data blocks are locked
+  unsigned char* mask_data = this->mask_block_->get_mask_data();
+  if ( this->mask_cstr1_block_ ) this->mask_cstr1_block_->get_mask_data();
+  if ( this->mask_cstr2_block_ ) this->mask_cstr2_block_->get_mask_data();
+
+  bool success;
+  {
+    // NOTE: Mask constraints can share the data block of the filled mask, in which case the
+    // lock on the filled mask already covers them.
+    Core::MaskDataBlock::lock_type lock( this->mask_block_->get_mutex() );
+    std::vector< Core::DataBlock::mutex_type* > mutexes( 1, &this->mask_block_->get_mutex() );
+    std::vector< boost::shared_ptr< Core::DataBlock::shared_lock_type > > shared_locks;
+    if ( this->data_cstr_block_ ) mutexes.push_back( &this->data_cstr_block_->get_mutex() );
+    if ( this->mask_cstr1_block_ ) mutexes.push_back( &this->mask_cstr1_block_->get_mutex() );
+    if ( this->mask_cstr2_block_ ) mutexes.push_back( &this->mask_cstr2_block_->get_mutex() );
+    for ( size_t j = 1; j < mutexes.size(); j++ )
+    {
+      if ( std::find( mutexes.begin(), mutexes.begin() + j, mutexes[ j ] ) == 
+        mutexes.begin() + j )
+      {
+        shared_locks.push_back( boost::shared_ptr< Core::DataBlock::shared_lock_type >( 
+          new Core::DataBlock::shared_lock_type( *mutexes[ j ] ) ) );
+      }
+    }
+
+    Core::IndexVector changed_min, changed_max;
+    size_t num_filled = 0;
+    success = Core::VolumeFloodFill::Fill( this->mask_block_->get_nx(), 
+      this->mask_block_->get_ny(), this->mask_block_->get_nz(), this->seeds_, 
+      boost::bind( &FloodFillVolumeAlgo::compute_open_slice, this, _1, _2 ), 
+      boost::bind( &FillMaskSpan, mask_data, this->mask_block_->get_mask_value(), 
+      this->erase_, _1, _2 ), 
+      boost::bind( &FloodFillVolumeAlgo::update_fill_progress, this, _1 ),
+      changed_min, changed_max, num_filled );
+  }
+
+  if ( !success )
+  {
+    if ( !this->check_abort() ) this->report_error( "Could not allocate enough memory." );
+    return;
+  }
+
+  this->dispatch_insert_mask_volume_into_layer( this->dst_layer_,
+    Core::MaskVolumeHandle( new Core::MaskVolume( this->dst_layer_->get_grid_transform(), 
+    this->mask_block_ ) ) );
+}
+
 ActionFloodFill::ActionFloodFill() :
   private_( new ActionFloodFillPrivate )
 {
@@ -89,6 +351,7 @@ ActionFloodFill::ActionFloodFill() :
   this->add_layer_id( this->private_->mask_cstr2_layer_id_ );
   this->add_parameter( this->private_->negative_mask_cstr2_ );
   this->add_parameter( this->private_->erase_ );
+  this->add_parameter( this->private_->fill_3d_ );
   this->add_parameter( this->private_->sandbox_ );
 }
 
@@ -161,6 +424,7 @@ bool ActionFloodFill::validate( Core::ActionContextHandle& context )
       this->private_->data_cstr_slice_.reset( new Core::DataVolumeSlice( 
         data_cstr_layer->get_data_volume(), slice_type, 
         this->private_->slice_number_ ) );
+      this->private_->data_cstr_layer_ = data_cstr_layer;
     }
   }
   
@@ -188,6 +452,7 @@ bool ActionFloodFill::validate( Core::ActionContextHandle& context )
       this->private_->mask_cstr1_slice_.reset( new Core::MaskVolumeSlice(
         mask_cstr1_layer->get_mask_volume(), slice_type, 
         this->private_->slice_number_ ) );
+      this->private_->mask_cstr1_layer_ = mask_cstr1_layer;
     }
   }
 
@@ -215,6 +480,7 @@ bool ActionFloodFill::validate( Core::ActionContextHandle& context )
       this->private_->mask_cstr2_slice_.reset( new Core::MaskVolumeSlice(
         mask_cstr2_layer->get_mask_volume(), slice_type, 
         this->private_->slice_number_ ) );
+      this->private_->mask_cstr2_layer_ = mask_cstr2_layer;
     }
   }
 
@@ -243,12 +509,52 @@ bool ActionFloodFill::validate( Core::ActionContextHandle& context )
       return false;
     }
   }
+
+  this->private_->seeds_3d_.clear();
+  if ( this->private_->fill_3d_ )
+  {
+    // NOTE: Without seeds the 2D fill covers the whole slice, the volume is not filled
+    // entirely as that is rarely what is wanted.
+    if ( seeds.size() == 0 )
+    {
+      context->report_error( "Filling the volume requires at least one seed point." );
+      return false;
+    }
+
+    Core::Transform inverse_transform = target_layer->get_grid_transform().get_inverse();
+    Core::MaskDataBlockHandle mask_block = this->private_->vol_slice_->get_mask_data_block();
+    for ( size_t i = 0; i < seeds.size(); ++i )
+    {
+      Core::Point index = inverse_transform * seeds[ i ];
+      int x = Core::Round( index.x() );
+      int y = Core::Round( index.y() );
+      int z = Core::Round( index.z() );
+      if ( x >= 0 && x < static_cast< int >( mask_block->get_nx() ) && 
+        y >= 0 && y < static_cast< int >( mask_block->get_ny() ) &&
+        z >= 0 && z < static_cast< int >( mask_block->get_nz() ) )
+      {
+        this->private_->seeds_3d_.push_back( Core::IndexVector( x, y, z ) );
+      }
+    }
+
+    if ( this->private_->seeds_3d_.size() == 0 )
+    {
+      context->report_error( "All seed points are outside the boundary of the volume." );
+      return false;
+    }
+  }
   
   return true;
 }
 
 bool ActionFloodFill::run( Core::ActionContextHandle& context, Core::ActionResultHandle& result )
 {
+  // Filling the whole volume runs as a filter on a separate thread
+  if ( this->private_->fill_3d_ )
+  {
+    return this->run_fill_volume( context, result );
+  }
+
   Core::MaskVolumeSliceHandle volume_slice = this->private_->vol_slice_;
   int nx = static_cast< int >( volume_slice->nx() );
   int ny = static_cast< int >( volume_slice->ny() );
@@ -371,6 +677,65 @@ bool ActionFloodFill::run( Core::ActionContextHandle& context, Core::ActionResul
   return true;
 }
 
+bool ActionFloodFill::run_fill_volume( Core::ActionContextHandle& context, 
+  Core::ActionResultHandle& result )
+{
+  // Create algorithm
+  boost::shared_ptr< FloodFillVolumeAlgo > algo( new FloodFillVolumeAlgo );
+  algo->set_sandbox( this->private_->sandbox_ );
+
+  // Find the handle to the layer
+  if ( !( algo->find_layer( this->private_->target_layer_id_, algo->dst_layer_ ) ) )
+  {
+    return false;
+  }
+
+  algo->data_cstr_layer_ = this->private_->data_cstr_layer_;
+  algo->min_val_ = this->private_->min_val_;
+  algo->max_val_ = this->private_->max_val_;
+  algo->negative_data_cstr_ = this->private_->negative_data_cstr_;
+  algo->mask_cstr1_layer_ = this->private_->mask_cstr1_layer_;
+  algo->negative_mask_cstr1_ = this->private_->negative_mask_cstr1_;
+  algo->mask_cstr2_layer_ = this->private_->mask_cstr2_layer_;
+  algo->negative_mask_cstr2_ = this->private_->negative_mask_cstr2_;
+  algo->erase_ = this->private_->erase_;
+  algo->seeds_ = this->private_->seeds_3d_;
+
+  // Mark the layer for processing.
+  algo->lock_for_processing( algo->dst_layer_ );
+
+  // Lock the constraint layers, so they cannot be changed while filling. A constraint that is
+  // the target layer itself is covered by the lock for processing.
+  if ( algo->data_cstr_layer_ ) algo->lock_for_use( algo->data_cstr_layer_ );
+  if ( algo->mask_cstr1_layer_ && algo->mask_cstr1_layer_ != algo->dst_layer_ )
+  {
+    algo->lock_for_use( algo->mask_cstr1_layer_ );
+  }
+  if ( algo->mask_cstr2_layer_ && algo->mask_cstr2_layer_ != algo->dst_layer_ &&
+    algo->mask_cstr2_layer_ != algo->mask_cstr1_layer_ )
+  {
+    algo->lock_for_use( algo->mask_cstr2_layer_ );
+  }
+
+  // Return the id of the destination layer.
+  result = Core::ActionResultHandle( new Core::ActionResult( algo->dst_layer_->get_layer_id() ) );
+  // If the action is run from a script (provenance is a special case of script),
+  // return a notifier that the script engine can wait on.
+  if ( context->source() == Core::ActionSource::SCRIPT_E ||
+    context->source() == Core::ActionSource::PROVENANCE_E )
+  {
+    context->report_need_resource( algo->get_notifier() );
+  }
+
+  // Build the undo-redo record
+  algo->create_undo_redo_and_provenance_record( context, this->shared_from_this() );
+  
+  // Start the filter on a separate thread.
+  Core::Runnable::Start( algo );
+
+  return true;
+}
+
 void ActionFloodFill::clear_cache()
 {
   this->private_->data_cstr_slice_.reset();
@@ -378,6 +743,10 @@ void ActionFloodFill::clear_cache()
   this->private_->mask_cstr2_slice_.reset();
   this->private_->vol_slice_.reset();
   this->private_->seeds_2d_.clear();
+  this->private_->data_cstr_layer_.reset();
+  this->private_->mask_cstr1_layer_.reset();
+  this->private_->mask_cstr2_layer_.reset();
+  this->private_->seeds_3d_.clear();
 }
 
 void ActionFloodFill::Dispatch( Core::ActionContextHandle context, 
@@ -397,6 +766,7 @@ void ActionFloodFill::Dispatch( Core::ActionContextHandle context,
   action->private_->mask_cstr2_layer_id_ = params.mask_constraint2_layer_id_;
   action->private_->negative_mask_cstr2_ = params.negative_mask_constraint2_;
   action->private_->erase_ = params.erase_;
+  action->private_->fill_3d_ = params.fill_3d_;
 
   Core::ActionDispatcher::PostAction( Core::ActionHandle( action ), context );
 }
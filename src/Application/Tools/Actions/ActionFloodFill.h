@@ -58,6 +58,7 @@ public:
   std::string mask_constraint2_layer_id_;
   bool negative_mask_constraint2_;
   bool erase_;
+  bool fill_3d_;
 };
 
 class ActionFloodFill : public LayerAction
@@ -80,6 +81,8 @@ CORE_ACTION
   CORE_ACTION_OPTIONAL_ARGUMENT( "mask_constraint2", "<none>", "The ID of second mask constraint layer." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "negative_mask_constraint2", "false", "Whether to negate the second mask constraint." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "erase", "false", "Whether to erase instead of fill." )
+  CORE_ACTION_OPTIONAL_ARGUMENT( "fill_3d", "false", "Whether to fill the connected region in "
+    "the whole volume instead of only in the slice." )
   CORE_ACTION_OPTIONAL_ARGUMENT( "sandbox", "-1", "The sandbox in which to run the action." )
   CORE_ACTION_ARGUMENT_IS_NONPERSISTENT( "sandbox" )  
   CORE_ACTION_CHANGES_PROJECT_DATA()
@@ -105,6 +108,10 @@ public:
   virtual void clear_cache() override;
 
 private:
+  // RUN_FILL_VOLUME:
+  // Start a filter that fills the connected region in the whole volume.
+  bool run_fill_volume( Core::ActionContextHandle& context, Core::ActionResultHandle& result );
+
   ActionFloodFillPrivateHandle private_;
 
 public:
@@ -336,8 +336,13 @@ bool ActionPolyline::run( Core::ActionContextHandle& context, Core::ActionResult
     }
   }
   
+  // Only the filled rows of the slice changed
+  Core::IndexVector changed_min, changed_max;
+  volume_slice->get_slice_region( 0, static_cast< size_t >( min_y ), nx - 1, 
+    static_cast< size_t >( max_y ), changed_min, changed_max );
+  mask_data_block->increase_generation( changed_min, changed_max );
+
   mask_data_lock.unlock();
-  mask_data_block->increase_generation();
   mask_data_block->mask_updated_signal_();
 
   result.reset( new Core::ActionResult( this->private_->target_layer_id_ ) );
@@ -201,6 +201,9 @@ public:
   /// Erase data instead of painting
   Core::StateBoolHandle erase_state_;
 
+  /// Flood fill the connected region in the whole volume instead of in the slice
+  Core::StateBoolHandle flood_fill_3d_state_;
+
 private:
   PaintToolPrivateHandle private_;
 
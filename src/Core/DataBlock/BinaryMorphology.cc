@@ -0,0 +1,373 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <limits>
+#include <new>
+#include <vector>
+
+// Boost includes
+#include <boost/bind.hpp>
+
+// Core includes
+#include <Core/DataBlock/BinaryMorphology.h>
+#include <Core/Utils/TaskScheduler.h>
+
+namespace Core
+{
+
+// Radii up to this size use a sliding window for the passes along y and z, larger ones the
+// lower envelope of parabolas
+static const int WINDOW_RADIUS_C = 4;
+
+// Number of parts each pass is split into, progress is reported in between the parts
+static const size_t NUM_PASS_PARTS_C = 8;
+
+// PARABOLAINTERSECTION:
+// The position where the parabolas rooted at q and v with heights f[ q ] and f[ v ] intersect
+static inline double ParabolaIntersection( const std::vector< double >& f, size_t q, size_t v )
+{
+  const double dq = static_cast< double >( q );
+  const double dv = static_cast< double >( v );
+  return ( ( f[ q ] + dq * dq ) - ( f[ v ] + dv * dv ) ) / ( 2.0 * ( dq - dv ) );
+}
+
+// CLASS BinaryMorphologyAlgo:
+// Squared distances to the nearest seed are stored in T, distances beyond the radius are
+// clamped to radius * radius + 1, hence small radii can use bytes.
+
+template< class T >
+class BinaryMorphologyAlgo
+{
+public:
+  BinaryMorphologyAlgo( unsigned char* data, size_t nx, size_t ny, size_t nz, int radius ) :
+    data_( data ), nx_( nx ), ny_( ny ), nz_( nz ), radius_( radius ),
+    radius2_( static_cast< size_t >( radius ) * static_cast< size_t >( radius ) ),
+    far_( static_cast< T >( radius2_ + 1 ) )
+  {
+  }
+
+  bool run( unsigned char seed_value, unsigned char target_value, unsigned char new_value,
+    bool x_axis, bool y_axis, bool z_axis, 
+    const BinaryMorphology::progress_function_type& progress );
+
+private:
+  typedef void ( BinaryMorphologyAlgo::*pass_type )( size_t, size_t );
+  bool run_pass( pass_type pass, size_t size, size_t grain_size );
+
+  // Passes over the volume, each one handles the range [begin, end)
+  void seed_rows( size_t begin, size_t end );
+  void transform_slices( size_t begin, size_t end );
+  void transform_planes( size_t begin, size_t end );
+  void apply( size_t begin, size_t end );
+
+  // TRANSFORM_LINES:
+  // Add the distance along the lines of length elements that start at base + x and step
+  // with stride, for all x in the row.
+  void transform_lines( size_t base, size_t stride, size_t length, std::vector< T >& block );
+
+  unsigned char* data_;
+  size_t nx_;
+  size_t ny_;
+  size_t nz_;
+  int radius_;
+  size_t radius2_;
+  T far_;
+
+  unsigned char seed_value_;
+  unsigned char target_value_;
+  unsigned char new_value_;
+  bool x_axis_;
+
+  std::vector< T > distance_;
+  
+  const BinaryMorphology::progress_function_type* progress_;
+  size_t num_parts_;
+  size_t part_;
+};
+
+template< class T >
+bool BinaryMorphologyAlgo< T >::run( unsigned char seed_value, unsigned char target_value, 
+  unsigned char new_value, bool x_axis, bool y_axis, bool z_axis, 
+  const BinaryMorphology::progress_function_type& progress )
+{
+  this->seed_value_ = seed_value;
+  this->target_value_ = target_value;
+  this->new_value_ = new_value;
+  this->x_axis_ = x_axis;
+  
+  try
+  {
+    this->distance_.resize( this->nx_ * this->ny_ * this->nz_ );
+  }
+  catch ( std::bad_alloc& )
+  {
+    return false;
+  }
+
+  this->progress_ = &progress;
+  this->num_parts_ = NUM_PASS_PARTS_C * ( 2 + ( y_axis ? 1 : 0 ) + ( z_axis ? 1 : 0 ) );
+  this->part_ = 0;
+  
+  // The pass along x also picks up the seeds
+  if ( !this->run_pass( &BinaryMorphologyAlgo::seed_rows, this->ny_ * this->nz_, 0 ) )
+  {
+    return false;
+  }
+  if ( y_axis && this->ny_ > 1 &&
+    !this->run_pass( &BinaryMorphologyAlgo::transform_slices, this->nz_, 1 ) )
+  {
+    return false;
+  }
+  if ( z_axis && this->nz_ > 1 && 
+    !this->run_pass( &BinaryMorphologyAlgo::transform_planes, this->ny_, 1 ) )
+  {
+    return false;
+  }
+  return this->run_pass( &BinaryMorphologyAlgo::apply, this->nx_ * this->ny_ * this->nz_, 0 );
+}
+
+template< class T >
+bool BinaryMorphologyAlgo< T >::run_pass( pass_type pass, size_t size, size_t grain_size )
+{
+  for ( size_t j = 0; j < NUM_PASS_PARTS_C; j++ )
+  {
+    ParallelFor( size * j / NUM_PASS_PARTS_C, size * ( j + 1 ) / NUM_PASS_PARTS_C, 
+      boost::bind( pass, this, _1, _2 ), grain_size );
+
+    this->part_++;
+    if ( *this->progress_ && !( *this->progress_ )( static_cast< double >( this->part_ ) / 
+      static_cast< double >( this->num_parts_ ) ) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template< class T >
+void BinaryMorphologyAlgo< T >::seed_rows( size_t begin, size_t end )
+{
+  const size_t nx = this->nx_;
+  const size_t radius = static_cast< size_t >( this->radius_ );
+  for ( size_t row = begin; row < end; row++ )
+  {
+    const unsigned char* data = this->data_ + row * nx;
+    T* distance = &this->distance_[ row * nx ];
+    
+    if ( !this->x_axis_ )
+    {
+      for ( size_t x = 0; x < nx; x++ )
+      {
+        distance[ x ] = data[ x ] == this->seed_value_ ? 0 : this->far_;
+      }
+      continue;
+    }
+    
+    // Distance to the nearest seed on the left, followed by the one on the right
+    size_t last = std::numeric_limits< size_t >::max();
+    for ( size_t x = 0; x < nx; x++ )
+    {
+      if ( data[ x ] == this->seed_value_ ) last = x;
+      distance[ x ] = ( last != std::numeric_limits< size_t >::max() && x - last <= radius ) ?
+        static_cast< T >( ( x - last ) * ( x - last ) ) : this->far_;
+    }
+    last = std::numeric_limits< size_t >::max();
+    for ( size_t x = nx; x-- > 0; )
+    {
+      if ( data[ x ] == this->seed_value_ ) last = x;
+      if ( last != std::numeric_limits< size_t >::max() && last - x <= radius )
+      {
+        T value = static_cast< T >( ( last - x ) * ( last - x ) );
+        if ( value < distance[ x ] ) distance[ x ] = value;
+      }
+    }
+  }
+}
+
+template< class T >
+void BinaryMorphologyAlgo< T >::transform_slices( size_t begin, size_t end )
+{
+  std::vector< T > block;
+  for ( size_t z = begin; z < end; z++ )
+  {
+    this->transform_lines( z * this->nx_ * this->ny_, this->nx_, this->ny_, block );
+  }
+}
+
+template< class T >
+void BinaryMorphologyAlgo< T >::transform_planes( size_t begin, size_t end )
+{
+  std::vector< T > block;
+  for ( size_t y = begin; y < end; y++ )
+  {
+    this->transform_lines( y * this->nx_, this->nx_ * this->ny_, this->nz_, block );
+  }
+}
+
+template< class T >
+void BinaryMorphologyAlgo< T >::transform_lines( size_t base, size_t stride, size_t length,
+  std::vector< T >& block )
+{
+  const size_t nx = this->nx_;
+  T* distance = &this->distance_[ base ];
+
+  // Copy the lines into a block, so the results can be written back in place
+  block.resize( length * nx );
+  for ( size_t i = 0; i < length; i++ )
+  {
+    std::copy( distance + i * stride, distance + i * stride + nx, &block[ i * nx ] );
+  }
+
+  if ( this->radius_ <= WINDOW_RADIUS_C )
+  {
+    // Sliding window, the loops over x do not depend on each other and can be vectorized
+    for ( size_t i = 0; i < length; i++ )
+    {
+      T* output = distance + i * stride;
+      for ( size_t d = 1; d <= static_cast< size_t >( this->radius_ ); d++ )
+      {
+        const unsigned int d2 = static_cast< unsigned int >( d * d );
+        for ( int side = 0; side < 2; side++ )
+        {
+          if ( side == 0 ? d > i : i + d >= length ) continue;
+          const T* input = &block[ ( side == 0 ? i - d : i + d ) * nx ];
+          for ( size_t x = 0; x < nx; x++ )
+          {
+            unsigned int value = static_cast< unsigned int >( input[ x ] ) + d2;
+            if ( value < output[ x ] ) output[ x ] = static_cast< T >( value );
+          }
+        }
+      }
+    }
+    return;
+  }
+
+  // Lower envelope of the parabolas rooted at every element, see Felzenszwalb and
+  // Huttenlocher, "Distance Transforms of Sampled Functions"
+  std::vector< double > f( length );
+  std::vector< size_t > v( length );
+  std::vector< double > boundary( length + 1 );
+  for ( size_t x = 0; x < nx; x++ )
+  {
+    bool empty = true;
+    for ( size_t i = 0; i < length; i++ )
+    {
+      f[ i ] = static_cast< double >( block[ i * nx + x ] );
+      if ( block[ i * nx + x ] != this->far_ ) empty = false;
+    }
+    // Lines without any voxel near a seed stay as they are
+    if ( empty ) continue;
+
+    size_t k = 0;
+    v[ 0 ] = 0;
+    boundary[ 0 ] = -std::numeric_limits< double >::max();
+    boundary[ 1 ] = std::numeric_limits< double >::max();
+    for ( size_t q = 1; q < length; q++ )
+    {
+      // NOTE: The first boundary is minus infinity, hence this loop stops at the first parabola
+      double s = ParabolaIntersection( f, q, v[ k ] );
+      while ( s <= boundary[ k ] )
+      {
+        k--;
+        s = ParabolaIntersection( f, q, v[ k ] );
+      }
+      k++;
+      v[ k ] = q;
+      boundary[ k ] = s;
+      boundary[ k + 1 ] = std::numeric_limits< double >::max();
+    }
+
+    k = 0;
+    for ( size_t q = 0; q < length; q++ )
+    {
+      while ( boundary[ k + 1 ] < static_cast< double >( q ) ) k++;
+      const double d = static_cast< double >( q ) - static_cast< double >( v[ k ] );
+      double value = d * d + f[ v[ k ] ];
+      distance[ q * stride + x ] = value < static_cast< double >( this->far_ ) ?
+        static_cast< T >( value ) : this->far_;
+    }
+  }
+}
+
+template< class T >
+void BinaryMorphologyAlgo< T >::apply( size_t begin, size_t end )
+{
+  const T* distance = &this->distance_[ 0 ];
+  const T radius2 = static_cast< T >( this->radius2_ );
+  for ( size_t j = begin; j < end; j++ )
+  {
+    if ( this->data_[ j ] == this->target_value_ && distance[ j ] <= radius2 )
+    {
+      this->data_[ j ] = this->new_value_;
+    }
+  }
+}
+
+static bool RunBinaryMorphology( unsigned char* data, size_t nx, size_t ny, size_t nz, 
+  int radius, bool x_axis, bool y_axis, bool z_axis, 
+  const BinaryMorphology::progress_function_type& progress,
+  unsigned char seed_value, unsigned char target_value, unsigned char new_value )
+{
+  // A ball with a radius of zero only holds the voxel itself, which is not a seed
+  if ( radius <= 0 ) return true;
+
+  // Pick the smallest type that can hold the squared radius plus one
+  if ( radius < 16 )
+  {
+    BinaryMorphologyAlgo< unsigned char > algo( data, nx, ny, nz, radius );
+    return algo.run( seed_value, target_value, new_value, x_axis, y_axis, z_axis, progress );
+  }
+  else if ( radius < 256 )
+  {
+    BinaryMorphologyAlgo< unsigned short > algo( data, nx, ny, nz, radius );
+    return algo.run( seed_value, target_value, new_value, x_axis, y_axis, z_axis, progress );
+  }
+  else
+  {
+    BinaryMorphologyAlgo< unsigned int > algo( data, nx, ny, nz, radius );
+    return algo.run( seed_value, target_value, new_value, x_axis, y_axis, z_axis, progress );
+  }
+}
+
+bool BinaryMorphology::Dilate( unsigned char* data, size_t nx, size_t ny, size_t nz, 
+  int radius, bool x_axis, bool y_axis, bool z_axis, progress_function_type progress )
+{
+  return RunBinaryMorphology( data, nx, ny, nz, radius, x_axis, y_axis, z_axis, progress,
+    1, 0, 1 );
+}
+
+bool BinaryMorphology::Erode( unsigned char* data, size_t nx, size_t ny, size_t nz, 
+  int radius, bool x_axis, bool y_axis, bool z_axis, progress_function_type progress )
+{
+  return RunBinaryMorphology( data, nx, ny, nz, radius, x_axis, y_axis, z_axis, progress,
+    0, 1, 0 );
+}
+
+} // end namespace Core
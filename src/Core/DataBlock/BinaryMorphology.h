@@ -0,0 +1,79 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_BINARYMORPHOLOGY_H
+#define CORE_DATABLOCK_BINARYMORPHOLOGY_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <cstddef>
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace Core
+{
+
+// CLASS BinaryMorphology:
+/// Dilation and erosion of label volumes with a ball shaped structuring element. The ball
+/// holds the offsets that are not longer than the radius, along the axes that are enabled.
+/// Both operations threshold the squared Euclidean distance to the nearest seed voxel, which
+/// is computed with one pass per axis. Small radii use a sliding window in each pass and
+/// larger ones the lower envelope of parabolas, hence the cost grows at most linearly with
+/// the radius instead of with the volume of the ball. Every pass runs in parallel on the task
+/// scheduler.
+
+class BinaryMorphology : public boost::noncopyable
+{
+public:
+  // The progress function is called in between the parts of the computation with the fraction
+  // that is done. When it returns false the computation is aborted.
+  typedef boost::function< bool ( double ) > progress_function_type;
+
+  // DILATE:
+  /// Set the voxels with value 0 to 1 if they are within radius of a voxel with value 1. Other
+  /// values are neither seeds nor changed. Returns false if the computation was aborted or if
+  /// not enough memory could be allocated.
+  static bool Dilate( unsigned char* data, size_t nx, size_t ny, size_t nz, int radius,
+    bool x_axis, bool y_axis, bool z_axis, progress_function_type progress );
+
+  // ERODE:
+  /// Set the voxels with value 1 to 0 if they are within radius of a voxel with value 0. Other
+  /// values are neither seeds nor changed. Returns false if the computation was aborted or if
+  /// not enough memory could be allocated.
+  static bool Erode( unsigned char* data, size_t nx, size_t ny, size_t nz, int radius,
+    bool x_axis, bool y_axis, bool z_axis, progress_function_type progress );
+};
+
+} // end namespace Core
+
+#endif
@@ -0,0 +1,462 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <new>
+#include <numeric>
+
+// Boost includes
+#include <boost/bind.hpp>
+
+// Core includes
+#include <Core/DataBlock/ConnectedComponents.h>
+#include <Core/Utils/TaskScheduler.h>
+
+namespace Core
+{
+
+// Number of slabs per worker thread, more slabs balance the work better while the merge pass
+// has to visit more slab boundaries
+static const size_t SLABS_PER_THREAD_C = 4;
+
+// CLASS ComponentRun:
+// The voxels [x0, x1) of a row that are part of a component
+
+class ComponentRun
+{
+public:
+  unsigned int x0_;
+  unsigned int x1_;
+};
+
+static inline bool RunStartLess( size_t x, const ComponentRun& run )
+{
+  return x < run.x0_;
+}
+
+class ConnectedComponentsPrivate
+{
+public:
+  ConnectedComponentsPrivate() :
+    nx_( 0 ), ny_( 0 ), nz_( 0 ), mask_data_( 0 ), mask_value_( 0 ), invert_( false )
+  {
+  }
+
+  // IS_SET:
+  // Whether the voxel at index is part of the components
+  bool is_set( size_t index ) const
+  {
+    return ( ( this->mask_data_[ index ] & this->mask_value_ ) != 0 ) != this->invert_;
+  }
+
+  // Passes over the volume, each one handles the range [begin, end)
+  void count_runs( size_t begin, size_t end );
+  void extract_runs( size_t begin, size_t end );
+  void label_slabs( size_t begin, size_t end );
+
+  // FIND_ROOT:
+  // Find the root of the set of a run. Every run points to a run with a lower index.
+  size_t find_root( size_t run )
+  {
+    while ( this->labels_[ run ] != run )
+    {
+      this->labels_[ run ] = this->labels_[ this->labels_[ run ] ];
+      run = this->labels_[ run ];
+    }
+    return run;
+  }
+
+  // JOIN_ROWS:
+  // Join the sets of the runs in both rows that overlap along x
+  void join_rows( size_t row1, size_t row2 );
+
+  // RESOLVE:
+  // Replace the parents of the runs by the final labels and collect the component statistics.
+  void resolve();
+
+  template< class T >
+  void write_values( const std::vector< T >* values, T* data, size_t begin, size_t end ) const;
+  void write_mask( const std::vector< unsigned char >* selected, unsigned char* mask_data, 
+    unsigned char mask_value, size_t begin, size_t end ) const;
+
+  size_t nx_;
+  size_t ny_;
+  size_t nz_;
+
+  // The mask that is being labeled
+  const unsigned char* mask_data_;
+  unsigned char mask_value_;
+  bool invert_;
+
+  // The first slice of each slab, followed by nz
+  std::vector< size_t > slab_start_;
+
+  // The runs of all rows in memory order, and the index of the first run of each row followed
+  // by the number of runs
+  std::vector< ComponentRun > runs_;
+  std::vector< size_t > row_start_;
+
+  // The parent of each run during labeling, the label of each run afterwards
+  std::vector< size_t > labels_;
+
+  // The size and bounding box of each component, entry 0 is not used
+  std::vector< size_t > sizes_;
+  std::vector< IndexVector > min_;
+  std::vector< IndexVector > max_;
+};
+
+void ConnectedComponentsPrivate::count_runs( size_t begin, size_t end )
+{
+  for ( size_t row = begin; row < end; row++ )
+  {
+    size_t index = row * this->nx_;
+    size_t count = 0;
+    bool previous = false;
+    for ( size_t x = 0; x < this->nx_; x++, index++ )
+    {
+      bool current = this->is_set( index );
+      if ( current && !previous ) count++;
+      previous = current;
+    }
+    this->row_start_[ row + 1 ] = count;
+  }
+}
+
+void ConnectedComponentsPrivate::extract_runs( size_t begin, size_t end )
+{
+  for ( size_t row = begin; row < end; row++ )
+  {
+    size_t index = row * this->nx_;
+    size_t run = this->row_start_[ row ];
+    size_t x = 0;
+    while ( x < this->nx_ )
+    {
+      if ( !this->is_set( index + x ) )
+      {
+        x++;
+        continue;
+      }
+      this->runs_[ run ].x0_ = static_cast< unsigned int >( x );
+      while ( x < this->nx_ && this->is_set( index + x ) ) x++;
+      this->runs_[ run ].x1_ = static_cast< unsigned int >( x );
+      this->labels_[ run ] = run;
+      run++;
+    }
+  }
+}
+
+void ConnectedComponentsPrivate::join_rows( size_t row1, size_t row2 )
+{
+  size_t run1 = this->row_start_[ row1 ];
+  size_t end1 = this->row_start_[ row1 + 1 ];
+  size_t run2 = this->row_start_[ row2 ];
+  size_t end2 = this->row_start_[ row2 + 1 ];
+
+  while ( run1 < end1 && run2 < end2 )
+  {
+    const ComponentRun& r1 = this->runs_[ run1 ];
+    const ComponentRun& r2 = this->runs_[ run2 ];
+    if ( r1.x1_ <= r2.x0_ ) 
+    {
+      run1++;
+      continue;
+    }
+    if ( r2.x1_ <= r1.x0_ )
+    {
+      run2++;
+      continue;
+    }
+
+    // The runs overlap, link the root with the higher index to the other one
+    size_t root1 = this->find_root( run1 );
+    size_t root2 = this->find_root( run2 );
+    if ( root1 < root2 ) this->labels_[ root2 ] = root1;
+    else if ( root2 < root1 ) this->labels_[ root1 ] = root2;
+
+    if ( r1.x1_ < r2.x1_ ) run1++;
+    else run2++;
+  }
+}
+
+void ConnectedComponentsPrivate::label_slabs( size_t begin, size_t end )
+{
+  // NOTE: The runs of a slab are stored contiguously and only joined with runs of the same
+  // slab, hence the slabs do not interfere with each other.
+  for ( size_t slab = begin; slab < end; slab++ )
+  {
+    for ( size_t z = this->slab_start_[ slab ]; z < this->slab_start_[ slab + 1 ]; z++ )
+    {
+      for ( size_t y = 0; y < this->ny_; y++ )
+      {
+        size_t row = z * this->ny_ + y;
+        if ( y > 0 ) this->join_rows( row, row - 1 );
+        if ( z > this->slab_start_[ slab ] ) this->join_rows( row, row - this->ny_ );
+      }
+    }
+  }
+}
+
+void ConnectedComponentsPrivate::resolve()
+{
+  // NOTE: A run always points to a run with a lower index, hence its parent already holds
+  // its final label.
+  this->sizes_.assign( 1, 0 );
+  this->min_.assign( 1, IndexVector() );
+  this->max_.assign( 1, IndexVector() );
+
+  for ( size_t row = 0; row < this->ny_ * this->nz_; row++ )
+  {
+    IndexVector::index_type y = static_cast< IndexVector::index_type >( row % this->ny_ );
+    IndexVector::index_type z = static_cast< IndexVector::index_type >( row / this->ny_ );
+    for ( size_t run = this->row_start_[ row ]; run < this->row_start_[ row + 1 ]; run++ )
+    {
+      const ComponentRun& r = this->runs_[ run ];
+      size_t label;
+      if ( this->labels_[ run ] == run )
+      {
+        label = this->sizes_.size();
+        this->sizes_.push_back( 0 );
+        this->min_.push_back( IndexVector( r.x0_, y, z ) );
+        this->max_.push_back( IndexVector( r.x1_ - 1, y, z ) );
+      }
+      else
+      {
+        label = this->labels_[ this->labels_[ run ] ];
+      }
+      this->labels_[ run ] = label;
+
+      this->sizes_[ label ] += r.x1_ - r.x0_;
+      IndexVector& min = this->min_[ label ];
+      IndexVector& max = this->max_[ label ];
+      min.x( std::min< IndexVector::index_type >( min.x(), r.x0_ ) );
+      max.x( std::max< IndexVector::index_type >( max.x(), r.x1_ - 1 ) );
+      min.y( std::min( min.y(), y ) );
+      max.y( std::max( max.y(), y ) );
+      max.z( z );
+    }
+  }
+}
+
+template< class T >
+void ConnectedComponentsPrivate::write_values( const std::vector< T >* values, T* data, 
+  size_t begin, size_t end ) const
+{
+  for ( size_t row = begin; row < end; row++ )
+  {
+    T* row_data = data + row * this->nx_;
+    std::fill( row_data, row_data + this->nx_, ( *values )[ 0 ] );
+    for ( size_t run = this->row_start_[ row ]; run < this->row_start_[ row + 1 ]; run++ )
+    {
+      std::fill( row_data + this->runs_[ run ].x0_, row_data + this->runs_[ run ].x1_,
+        ( *values )[ this->labels_[ run ] ] );
+    }
+  }
+}
+
+void ConnectedComponentsPrivate::write_mask( const std::vector< unsigned char >* selected, 
+  unsigned char* mask_data, unsigned char mask_value, size_t begin, size_t end ) const
+{
+  for ( size_t row = begin; row < end; row++ )
+  {
+    unsigned char* row_data = mask_data + row * this->nx_;
+    for ( size_t run = this->row_start_[ row ]; run < this->row_start_[ row + 1 ]; run++ )
+    {
+      if ( !( *selected )[ this->labels_[ run ] ] ) continue;
+      for ( size_t x = this->runs_[ run ].x0_; x < this->runs_[ run ].x1_; x++ )
+      {
+        row_data[ x ] |= mask_value;
+      }
+    }
+  }
+}
+
+ConnectedComponents::ConnectedComponents() :
+  private_( new ConnectedComponentsPrivate )
+{
+}
+
+ConnectedComponents::~ConnectedComponents()
+{
+}
+
+bool ConnectedComponents::label( const MaskDataBlockHandle& mask, bool invert, 
+  progress_function_type progress )
+{
+  ConnectedComponentsPrivate* priv = this->private_.get();
+  priv->nx_ = mask->get_nx();
+  priv->ny_ = mask->get_ny();
+  priv->nz_ = mask->get_nz();
+  priv->mask_data_ = mask->get_mask_data();
+  priv->mask_value_ = mask->get_mask_value();
+  priv->invert_ = invert;
+
+  size_t num_rows = priv->ny_ * priv->nz_;
+  size_t num_slabs = std::max< size_t >( 1, std::min< size_t >( priv->nz_, 
+    SLABS_PER_THREAD_C * TaskScheduler::Instance()->get_num_threads() ) );
+  priv->slab_start_.resize( num_slabs + 1 );
+  for ( size_t slab = 0; slab <= num_slabs; slab++ )
+  {
+    priv->slab_start_[ slab ] = priv->nz_ * slab / num_slabs;
+  }
+
+  try
+  {
+    priv->row_start_.assign( num_rows + 1, 0 );
+    ParallelFor( 0, num_rows, boost::bind( &ConnectedComponentsPrivate::count_runs, 
+      priv, _1, _2 ) );
+    std::partial_sum( priv->row_start_.begin(), priv->row_start_.end(), 
+      priv->row_start_.begin() );
+    if ( !progress( 0.2 ) ) return false;
+
+    size_t num_runs = priv->row_start_[ num_rows ];
+    priv->runs_.resize( num_runs );
+    priv->labels_.resize( num_runs );
+    ParallelFor( 0, num_rows, boost::bind( &ConnectedComponentsPrivate::extract_runs, 
+      priv, _1, _2 ) );
+    if ( !progress( 0.4 ) ) return false;
+  }
+  catch ( std::bad_alloc& )
+  {
+    return false;
+  }
+
+  ParallelFor( 0, num_slabs, boost::bind( &ConnectedComponentsPrivate::label_slabs, 
+    priv, _1, _2 ), 1 );
+  if ( !progress( 0.7 ) ) return false;
+
+  // Merge the components that touch across the slab boundaries
+  for ( size_t slab = 1; slab < num_slabs; slab++ )
+  {
+    size_t z = priv->slab_start_[ slab ];
+    for ( size_t y = 0; y < priv->ny_; y++ )
+    {
+      size_t row = z * priv->ny_ + y;
+      priv->join_rows( row, row - priv->ny_ );
+    }
+  }
+  if ( !progress( 0.8 ) ) return false;
+
+  try
+  {
+    priv->resolve();
+  }
+  catch ( std::bad_alloc& )
+  {
+    return false;
+  }
+
+  return progress( 1.0 );
+}
+
+size_t ConnectedComponents::get_num_components() const
+{
+  return this->private_->sizes_.size() - 1;
+}
+
+size_t ConnectedComponents::get_size( label_type label ) const
+{
+  return this->private_->sizes_[ label ];
+}
+
+void ConnectedComponents::get_bounding_box( label_type label, IndexVector& min, 
+  IndexVector& max ) const
+{
+  min = this->private_->min_[ label ];
+  max = this->private_->max_[ label ];
+}
+
+ConnectedComponents::label_type ConnectedComponents::get_label_at( size_t x, size_t y, 
+  size_t z ) const
+{
+  const ConnectedComponentsPrivate* priv = this->private_.get();
+  if ( x >= priv->nx_ || y >= priv->ny_ || z >= priv->nz_ ) return 0;
+
+  // Find the last run that starts at or before x
+  size_t row = z * priv->ny_ + y;
+  std::vector< ComponentRun >::const_iterator begin = priv->runs_.begin() + 
+    priv->row_start_[ row ];
+  std::vector< ComponentRun >::const_iterator end = priv->runs_.begin() + 
+    priv->row_start_[ row + 1 ];
+  std::vector< ComponentRun >::const_iterator it = std::upper_bound( begin, end, x, 
+    RunStartLess );
+  if ( it == begin || ( it - 1 )->x1_ <= x ) return 0;
+  return static_cast< label_type >( priv->labels_[ it - priv->runs_.begin() - 1 ] );
+}
+
+void ConnectedComponents::find_overlapping( const MaskDataBlockHandle& mask, bool invert,
+  std::vector< unsigned char >& selected ) const
+{
+  const ConnectedComponentsPrivate* priv = this->private_.get();
+  const unsigned char* mask_data = mask->get_mask_data();
+  unsigned char mask_value = mask->get_mask_value();
+
+  for ( size_t row = 0; row < priv->ny_ * priv->nz_; row++ )
+  {
+    const unsigned char* row_data = mask_data + row * priv->nx_;
+    for ( size_t run = priv->row_start_[ row ]; run < priv->row_start_[ row + 1 ]; run++ )
+    {
+      size_t label = priv->labels_[ run ];
+      if ( selected[ label ] ) continue;
+      for ( size_t x = priv->runs_[ run ].x0_; x < priv->runs_[ run ].x1_; x++ )
+      {
+        if ( ( ( row_data[ x ] & mask_value ) != 0 ) != invert )
+        {
+          selected[ label ] = 1;
+          break;
+        }
+      }
+    }
+  }
+}
+
+void ConnectedComponents::write_mask( const std::vector< unsigned char >& selected, 
+  const MaskDataBlockHandle& mask ) const
+{
+  ParallelFor( 0, this->private_->ny_ * this->private_->nz_, boost::bind( 
+    &ConnectedComponentsPrivate::write_mask, this->private_.get(), &selected, 
+    mask->get_mask_data(), mask->get_mask_value(), _1, _2 ) );
+}
+
+void ConnectedComponents::write_values( const std::vector< unsigned int >& values, 
+  unsigned int* data ) const
+{
+  ParallelFor( 0, this->private_->ny_ * this->private_->nz_, boost::bind( 
+    &ConnectedComponentsPrivate::write_values< unsigned int >, this->private_.get(), 
+    &values, data, _1, _2 ) );
+}
+
+void ConnectedComponents::write_values( const std::vector< float >& values, 
+  float* data ) const
+{
+  ParallelFor( 0, this->private_->ny_ * this->private_->nz_, boost::bind( 
+    &ConnectedComponentsPrivate::write_values< float >, this->private_.get(), 
+    &values, data, _1, _2 ) );
+}
+
+} // end namespace Core
@@ -0,0 +1,122 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_CONNECTEDCOMPONENTS_H
+#define CORE_DATABLOCK_CONNECTEDCOMPONENTS_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <vector>
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/smart_ptr.hpp>
+
+// Core includes
+#include <Core/DataBlock/MaskDataBlock.h>
+#include <Core/Geometry/IndexVector.h>
+
+namespace Core
+{
+
+class ConnectedComponentsPrivate;
+typedef boost::shared_ptr< ConnectedComponentsPrivate > ConnectedComponentsPrivateHandle;
+
+// CLASS ConnectedComponents:
+/// Labeling of the 6-connected components of a mask, computed directly from the bits of a
+/// MaskDataBlock. The voxels of the mask are stored as runs along x instead of one label per
+/// voxel. The slices are split into slabs that are labeled in parallel with a union-find over
+/// the runs, after which a merge pass joins the components that touch across the slab
+/// boundaries. The size and the bounding box of each component are collected in the same pass
+/// that assigns the final labels.
+
+class ConnectedComponents : public boost::noncopyable
+{
+public:
+  typedef unsigned int label_type;
+
+  // The progress function is called in between the parts of the computation with the fraction
+  // that is done. When it returns false the computation is aborted.
+  typedef boost::function< bool ( double ) > progress_function_type;
+
+  ConnectedComponents();
+  ~ConnectedComponents();
+
+  // LABEL:
+  /// Label the components formed by the voxels of which the mask bit is set, or not set if
+  /// invert is true. The caller needs to lock the mask. Returns false if the computation was
+  /// aborted or if not enough memory could be allocated.
+  bool label( const MaskDataBlockHandle& mask, bool invert, progress_function_type progress );
+
+  // GET_NUM_COMPONENTS:
+  /// The number of components. Components are labeled from 1 up to this number in the order of
+  /// their first voxel in memory.
+  size_t get_num_components() const;
+
+  // GET_SIZE:
+  /// The number of voxels in the component
+  size_t get_size( label_type label ) const;
+
+  // GET_BOUNDING_BOX:
+  /// The first and last voxel of the component along each axis
+  void get_bounding_box( label_type label, IndexVector& min, IndexVector& max ) const;
+
+  // GET_LABEL_AT:
+  /// The label of the component that holds the voxel, 0 if the voxel is not in any component
+  label_type get_label_at( size_t x, size_t y, size_t z ) const;
+
+  // FIND_OVERLAPPING:
+  /// Set the entries of selected, which has one entry per label, to 1 for the components that
+  /// hold a voxel of which the bit of the mask is set, or not set if invert is true. The caller
+  /// needs to lock the mask.
+  void find_overlapping( const MaskDataBlockHandle& mask, bool invert, 
+    std::vector< unsigned char >& selected ) const;
+
+  // WRITE_MASK:
+  /// Set the bit of the mask for the voxels of the components of which the entry in selected is
+  /// non-zero. Other voxels are not changed. The caller needs to lock the mask.
+  void write_mask( const std::vector< unsigned char >& selected, 
+    const MaskDataBlockHandle& mask ) const;
+
+  // WRITE_VALUES:
+  /// Write for every voxel the entry of values at the label of its component into data, which
+  /// needs to hold one entry per voxel. Voxels outside the components get values[ 0 ].
+  void write_values( const std::vector< unsigned int >& values, unsigned int* data ) const;
+  void write_values( const std::vector< float >& values, float* data ) const;
+
+private:
+  ConnectedComponentsPrivateHandle private_;
+};
+
+} // end namespace Core
+
+#endif
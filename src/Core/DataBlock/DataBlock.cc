@@ -26,6 +26,8 @@
  DEALINGS IN THE SOFTWARE.
 */
 
+#include <algorithm>
+
 #include <Core/DataBlock/DataBlock.h>
 #include <Core/DataBlock/DataBlockManager.h>
 #include <Core/DataBlock/StdDataBlock.h>
@@ -33,13 +35,19 @@
 namespace Core
 {
 
+const size_t DataBlock::DIRTY_BRICK_SIZE_C = 64;
+
+/// Maximum number of partial changes that are remembered
+static const size_t MAX_CHANGE_HISTORY_C = 1024;
+
 DataBlock::DataBlock() :
   nx_( 0 ), 
   ny_( 0 ), 
   nz_( 0 ), 
   data_type_( DataType::UNKNOWN_E ), 
   data_( 0 ),
-  generation_( -1 )
+  generation_( -1 ),
+  histogram_generation_( -1 )
 {
 }
 
@@ -199,6 +207,10 @@ void DataBlock::set_data( void* data )
 void DataBlock::set_histogram( const Histogram& histogram )
 {
   this->histogram_ = histogram;
+
+  // The contribution of the bricks is not known for this histogram
+  this->histogram_bricks_.clear();
+  this->histogram_generation_ = this->generation_;
 }
 
 double DataBlock::get_max() const
@@ -225,7 +237,7 @@ void DataBlock::clear()
 {
   lock_type lock( this->get_mutex() );
   memset( this->data_, 0, Core::GetSizeDataType( this->data_type_ ) * this->get_size() );
-  this->generation_ = DataBlockManager::Instance()->increase_generation( this->generation_ );
+  this->increase_generation();
 }
 
 DataBlock::generation_type DataBlock::get_generation() const
@@ -238,38 +250,164 @@ void DataBlock::set_generation( generation_type generation )
 {
   lock_type lock( this->get_mutex() );
   this->generation_ = generation;
+  this->reset_change_history();
 }
 
 void DataBlock::increase_generation()
 {
   this->generation_ = DataBlockManager::Instance()->increase_generation( this->generation_ );
+  this->reset_change_history();
+}
+
+void DataBlock::increase_generation( const IndexVector& min, const IndexVector& max )
+{
+  // Without a known starting point a partial change cannot be described
+  if ( this->change_history_.empty() || this->generation_ < 0 )
+  {
+    this->increase_generation();
+    return;
+  }
+
+  GenerationChange change;
+  change.min_ = IndexVector( Max( min.x(), IndexVector::index_type( 0 ) ), 
+    Max( min.y(), IndexVector::index_type( 0 ) ), Max( min.z(), IndexVector::index_type( 0 ) ) );
+  change.max_ = IndexVector( 
+    Min( max.x(), static_cast< IndexVector::index_type >( this->nx_ ) - 1 ), 
+    Min( max.y(), static_cast< IndexVector::index_type >( this->ny_ ) - 1 ), 
+    Min( max.z(), static_cast< IndexVector::index_type >( this->nz_ ) - 1 ) );
+
+  this->generation_ = DataBlockManager::Instance()->increase_generation( this->generation_ );
+  change.generation_ = this->generation_;
+  this->change_history_.push_back( change );
+  if ( this->change_history_.size() > MAX_CHANGE_HISTORY_C )
+  {
+    this->change_history_.pop_front();
+  }
+
+  if ( change.min_.x() > change.max_.x() || change.min_.y() > change.max_.y() ||
+    change.min_.z() > change.max_.z() ) return;
+
+  // Mark the bricks that overlap with the changed region
+  IndexVector num_bricks = this->get_num_bricks();
+  if ( this->brick_generations_.empty() )
+  {
+    this->brick_generations_.resize( static_cast< size_t >( num_bricks.x() * 
+      num_bricks.y() * num_bricks.z() ), this->change_history_.front().generation_ );
+  }
+
+  const IndexVector::index_type brick_size = 
+    static_cast< IndexVector::index_type >( DIRTY_BRICK_SIZE_C );
+  for ( IndexVector::index_type bz = change.min_.z() / brick_size; 
+    bz <= change.max_.z() / brick_size; bz++ )
+  {
+    for ( IndexVector::index_type by = change.min_.y() / brick_size; 
+      by <= change.max_.y() / brick_size; by++ )
+    {
+      for ( IndexVector::index_type bx = change.min_.x() / brick_size; 
+        bx <= change.max_.x() / brick_size; bx++ )
+      {
+        this->brick_generations_[ static_cast< size_t >( 
+          ( bz * num_bricks.y() + by ) * num_bricks.x() + bx ) ] = this->generation_;
+      }
+    }
+  }
+}
+
+void DataBlock::reset_change_history()
+{
+  this->change_history_.clear();
+  this->brick_generations_.clear();
+
+  GenerationChange change;
+  change.generation_ = this->generation_;
+  change.max_ = IndexVector( static_cast< IndexVector::index_type >( this->nx_ ) - 1,
+    static_cast< IndexVector::index_type >( this->ny_ ) - 1,
+    static_cast< IndexVector::index_type >( this->nz_ ) - 1 );
+  this->change_history_.push_back( change );
+}
+
+bool DataBlock::get_changed_region( generation_type generation, IndexVector& min, 
+  IndexVector& max ) const
+{
+  if ( generation < 0 || this->generation_ < 0 ) return false;
+
+  // Find the generation in the history, the generations are stored in increasing order
+  std::deque< GenerationChange >::const_iterator it = this->change_history_.begin();
+  while ( it != this->change_history_.end() && it->generation_ < generation ) ++it;
+  if ( it == this->change_history_.end() || it->generation_ != generation ) return false;
+
+  min = IndexVector( static_cast< IndexVector::index_type >( this->nx_ ), 
+    static_cast< IndexVector::index_type >( this->ny_ ), 
+    static_cast< IndexVector::index_type >( this->nz_ ) );
+  max = IndexVector( -1, -1, -1 );
+
+  for ( ++it; it != this->change_history_.end(); ++it )
+  {
+    for ( size_t k = 0; k < 3; k++ )
+    {
+      min[ k ] = Min( min[ k ], it->min_[ k ] );
+      max[ k ] = Max( max[ k ], it->max_[ k ] );
+    }
+  }
+
+  return true;
+}
+
+bool DataBlock::get_changed_bricks( generation_type generation, 
+  std::vector< size_t >& bricks ) const
+{
+  bricks.clear();
+
+  IndexVector min, max;
+  if ( !this->get_changed_region( generation, min, max ) ) return false;
+
+  // No partial changes since the last full change
+  if ( this->brick_generations_.empty() ) return true;
+
+  for ( size_t j = 0; j < this->brick_generations_.size(); j++ )
+  {
+    if ( this->brick_generations_[ j ] > generation ) bricks.push_back( j );
+  }
+
+  return true;
+}
+
+IndexVector DataBlock::get_num_bricks() const
+{
+  return IndexVector( 
+    static_cast< IndexVector::index_type >( ( this->nx_ + DIRTY_BRICK_SIZE_C - 1 ) / 
+      DIRTY_BRICK_SIZE_C ),
+    static_cast< IndexVector::index_type >( ( this->ny_ + DIRTY_BRICK_SIZE_C - 1 ) / 
+      DIRTY_BRICK_SIZE_C ),
+    static_cast< IndexVector::index_type >( ( this->nz_ + DIRTY_BRICK_SIZE_C - 1 ) / 
+      DIRTY_BRICK_SIZE_C ) );
 }
 
 bool DataBlock::update_histogram()
 {
   lock_type lock( this->get_mutex() );
 
-  switch( this->data_type_ )
+  // Nothing changed since the histogram was computed
+  if ( this->generation_ >= 0 && this->histogram_generation_ == this->generation_ ) return true;
+
+  // If the bricks that changed since the histogram was computed are known, only their
+  // contribution to the histogram is recomputed
+  bool success = false;
+  std::vector< size_t > bricks;
+  if ( this->histogram_generation_ >= 0 && !this->histogram_bricks_.empty() &&
+    this->get_changed_bricks( this->histogram_generation_, bricks ) )
   {
-    case DataType::CHAR_E:
-      return this->histogram_.compute( reinterpret_cast<signed char*>( get_data() ), get_size() );
-    case DataType::UCHAR_E:
-      return this->histogram_.compute( reinterpret_cast<unsigned char*>( get_data() ), get_size() );
-    case DataType::SHORT_E:
-      return this->histogram_.compute( reinterpret_cast<short*>( get_data() ), get_size() );
-    case DataType::USHORT_E:
-      return this->histogram_.compute( reinterpret_cast<unsigned short*>( get_data() ), get_size() );
-    case DataType::INT_E:
-      return this->histogram_.compute( reinterpret_cast<int*>( get_data() ), get_size() );
-    case DataType::UINT_E:
-      return this->histogram_.compute( reinterpret_cast<unsigned int*>( get_data() ), get_size() );
-    case DataType::FLOAT_E:
-      return this->histogram_.compute( reinterpret_cast<float*>( get_data() ), get_size() );
-    case DataType::DOUBLE_E:
-      return this->histogram_.compute( reinterpret_cast<double*>( get_data() ), get_size() );
+    success = this->histogram_.update( this->get_data(), this->data_type_, this->nx_, 
+      this->ny_, this->nz_, bricks, this->histogram_bricks_ );
+  }
+  else
+  {
+    success = this->histogram_.compute( this->get_data(), this->data_type_, this->nx_, 
+      this->ny_, this->nz_, DIRTY_BRICK_SIZE_C, this->histogram_bricks_ );
   }
 
-  return false;
+  this->histogram_generation_ = success ? this->generation_ : -1;
+  return success;
 }
 
 // same as set_type()
@@ -1307,7 +1445,8 @@ bool InsertSliceInternal( DataBlock* volume_data_block, const DataSliceHandle& s
         }
       }
       
-      volume_data_block->increase_generation();
+      volume_data_block->increase_generation( IndexVector( index, 0, 0 ), 
+        IndexVector( index, ny - 1, nz - 1 ) );
 
       return true;
     }
@@ -1349,7 +1488,8 @@ bool InsertSliceInternal( DataBlock* volume_data_block, const DataSliceHandle& s
         }
       }
 
-      volume_data_block->increase_generation();
+      volume_data_block->increase_generation( IndexVector( 0, index, 0 ), 
+        IndexVector( nx - 1, index, nz - 1 ) );
       
       return true;
     }
@@ -1365,7 +1505,8 @@ bool InsertSliceInternal( DataBlock* volume_data_block, const DataSliceHandle& s
       // Copy data as one memory block back
       std::memcpy( volume_ptr + index * ( nx * ny ), slice_ptr, nx * ny * sizeof( T ) );
       
-      volume_data_block->increase_generation();
+      volume_data_block->increase_generation( IndexVector( 0, 0, index ), 
+        IndexVector( nx - 1, ny - 1, index ) );
       
       return true;
     }
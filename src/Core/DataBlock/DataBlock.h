@@ -36,8 +36,13 @@
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/utility.hpp>
 
+// STL includes
+#include <deque>
+#include <vector>
+
 // Core includes
 #include <Core/Utils/Lockable.h>
+#include <Core/Geometry/IndexVector.h>
 #include <Core/DataBlock/DataType.h>
 #include <Core/DataBlock/Histogram.h>
 #include <Core/DataBlock/DataBlockFWD.h>
@@ -216,6 +221,12 @@ public:
   /// protect both the data change and the update of the generation atomically.
   void increase_generation();
 
+  // INCREASE_GENERATION:
+  /// Increase the generation number to a new unique number and record that only the voxels
+  /// from min up to and including max have changed.
+  /// NOTE: THis one does not lock the mutex, see above.
+  void increase_generation( const IndexVector& min, const IndexVector& max );
+
   // SET_HISTOGRAM:
   /// Set the histogram of the dataset
   void set_histogram( const Histogram& histogram );
@@ -224,6 +235,35 @@ public:
   /// Swap the endianess of the data
   void swap_endian();
 
+  // -- Tracking of changed regions --
+public:
+  /// Size of the bricks, in voxels along each axis, in which changes are tracked
+  static const size_t DIRTY_BRICK_SIZE_C;
+
+  // GET_CHANGED_REGION:
+  /// Get the bounding box of the voxels that changed after the given generation. If nothing
+  /// changed, min will be larger than max. Returns false if the changes are not known, which
+  /// happens when the generation is not a recent generation of this data block; in that case
+  /// the whole volume should be considered changed.
+  /// NOTE: The caller needs to hold a lock on the data block.
+  bool get_changed_region( generation_type generation, IndexVector& min, 
+    IndexVector& max ) const;
+
+  // GET_CHANGED_BRICKS:
+  /// Get the indices of the bricks that changed after the given generation. Bricks are
+  /// numbered with x varying fastest. Returns false if the changes are not known.
+  /// NOTE: The caller needs to hold a lock on the data block.
+  bool get_changed_bricks( generation_type generation, std::vector< size_t >& bricks ) const;
+
+  // GET_NUM_BRICKS:
+  /// Get the number of bricks along each axis
+  IndexVector get_num_bricks() const;
+
+private:
+  // RESET_CHANGE_HISTORY:
+  /// Forget the change history, all of the data is considered changed
+  void reset_change_history();
+
 private:
   friend class DataBlockManager;
   void set_generation( generation_type generation );
@@ -283,6 +323,27 @@ private:
   /// Generation number
   generation_type generation_;
 
+  /// The recent generations of this data block and the region that changed in each one of
+  /// them, oldest first. The first entry is the last generation in which all the data changed.
+  struct GenerationChange
+  {
+    generation_type generation_;
+    IndexVector min_;
+    IndexVector max_;
+  };
+  std::deque< GenerationChange > change_history_;
+
+  /// The generation in which each brick last changed. This one is only filled in once part of
+  /// the data has changed.
+  std::vector< generation_type > brick_generations_;
+
+  /// Generation for which the histogram was computed
+  generation_type histogram_generation_;
+
+  /// Contribution of each brick to the histogram, used for updating the histogram when only
+  /// part of the data changed
+  HistogramBricks histogram_bricks_;
+
   // -- static functions for managing datablocks -- 
 public:
   // CONVERTDATATYPE:
@@ -0,0 +1,723 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <set>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+// Zlib includes
+#include <zlib.h>
+
+// Core includes
+#include <Core/Utils/Log.h>
+#include <Core/Utils/Parallel.h>
+#include <Core/Utils/StringUtil.h>
+#include <Core/Utils/FilesystemUtil.h>
+#include <Core/Math/MathFunctions.h>
+#include <Core/Geometry/IndexVector.h>
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/DataBlock/DataBlockChunkStore.h>
+
+namespace bfs = boost::filesystem;
+
+namespace Core
+{
+
+namespace
+{
+
+// Chunk size in voxels along each axis
+const size_t CHUNK_SIZE_C = 64;
+
+// Directory, relative to the manifest files, that holds the chunks
+const char* CHUNK_DIR_C = "chunks";
+
+const char* CHUNK_EXTENSION_C = ".chunk";
+
+inline unsigned long long RotateLeft( unsigned long long x, int r )
+{
+  return ( x << r ) | ( x >> ( 64 - r ) );
+}
+
+inline unsigned long long FinalMix( unsigned long long k )
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+// 128 bit MurmurHash3 (x64 variant) of a buffer, returned as a hexadecimal string. This hash is
+// not cryptographic, but with 128 bits accidental collisions between chunks are not a concern.
+std::string HashChunk( const unsigned char* data, size_t size )
+{
+  const size_t num_blocks = size / 16;
+  const unsigned long long c1 = 0x87c37b91114253d5ULL;
+  const unsigned long long c2 = 0x4cf5ad432745937fULL;
+
+  unsigned long long h1 = 0x5365673344ULL;
+  unsigned long long h2 = 0x5365673344ULL;
+
+  for ( size_t i = 0; i < num_blocks; i++ )
+  {
+    unsigned long long k1, k2;
+    std::memcpy( &k1, data + i * 16, 8 );
+    std::memcpy( &k2, data + i * 16 + 8, 8 );
+
+    k1 *= c1; k1 = RotateLeft( k1, 31 ); k1 *= c2; h1 ^= k1;
+    h1 = RotateLeft( h1, 27 ); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+    k2 *= c2; k2 = RotateLeft( k2, 33 ); k2 *= c1; h2 ^= k2;
+    h2 = RotateLeft( h2, 31 ); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  const unsigned char* tail = data + num_blocks * 16;
+  unsigned long long k1 = 0, k2 = 0;
+  switch ( size & 15 )
+  {
+  case 15: k2 ^= static_cast<unsigned long long>( tail[ 14 ] ) << 48;
+  case 14: k2 ^= static_cast<unsigned long long>( tail[ 13 ] ) << 40;
+  case 13: k2 ^= static_cast<unsigned long long>( tail[ 12 ] ) << 32;
+  case 12: k2 ^= static_cast<unsigned long long>( tail[ 11 ] ) << 24;
+  case 11: k2 ^= static_cast<unsigned long long>( tail[ 10 ] ) << 16;
+  case 10: k2 ^= static_cast<unsigned long long>( tail[ 9 ] ) << 8;
+  case 9: k2 ^= static_cast<unsigned long long>( tail[ 8 ] );
+    k2 *= c2; k2 = RotateLeft( k2, 33 ); k2 *= c1; h2 ^= k2;
+  case 8: k1 ^= static_cast<unsigned long long>( tail[ 7 ] ) << 56;
+  case 7: k1 ^= static_cast<unsigned long long>( tail[ 6 ] ) << 48;
+  case 6: k1 ^= static_cast<unsigned long long>( tail[ 5 ] ) << 40;
+  case 5: k1 ^= static_cast<unsigned long long>( tail[ 4 ] ) << 32;
+  case 4: k1 ^= static_cast<unsigned long long>( tail[ 3 ] ) << 24;
+  case 3: k1 ^= static_cast<unsigned long long>( tail[ 2 ] ) << 16;
+  case 2: k1 ^= static_cast<unsigned long long>( tail[ 1 ] ) << 8;
+  case 1: k1 ^= static_cast<unsigned long long>( tail[ 0 ] );
+    k1 *= c1; k1 = RotateLeft( k1, 31 ); k1 *= c2; h1 ^= k1;
+  }
+
+  h1 ^= size; h2 ^= size;
+  h1 += h2; h2 += h1;
+  h1 = FinalMix( h1 ); h2 = FinalMix( h2 );
+  h1 += h2; h2 += h1;
+
+  const char* hex = "0123456789abcdef";
+  std::string result( 32, '0' );
+  for ( int j = 0; j < 16; j++ )
+  {
+    result[ 15 - j ] = hex[ ( h1 >> ( 4 * j ) ) & 0xf ];
+    result[ 31 - j ] = hex[ ( h2 >> ( 4 * j ) ) & 0xf ];
+  }
+  return result;
+}
+
+bool IsChunkHash( const std::string& hash )
+{
+  if ( hash.size() != 32 ) return false;
+  for ( size_t j = 0; j < hash.size(); j++ )
+  {
+    if ( !( ( hash[ j ] >= '0' && hash[ j ] <= '9' ) || ( hash[ j ] >= 'a' && hash[ j ] <= 'f' ) ) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Chunks are spread over subdirectories named after the first two characters of the hash
+bfs::path GetRelativeChunkFile( const std::string& hash )
+{
+  return bfs::path( CHUNK_DIR_C ) / hash.substr( 0, 2 ) / ( hash + CHUNK_EXTENSION_C );
+}
+
+bfs::path GetChunkFile( const bfs::path& directory, const std::string& hash )
+{
+  return directory / GetRelativeChunkFile( hash );
+}
+
+struct ChunkManifest
+{
+  ChunkManifest() :
+    data_type_( DataType::UNKNOWN_E ),
+    little_endian_( true ),
+    has_histogram_( false )
+  {
+  }
+
+  DataType data_type_;
+  IndexVector size_;
+  IndexVector chunk_size_;
+  bool little_endian_;
+  GridTransform grid_transform_;
+  Histogram histogram_;
+  bool has_histogram_;
+  std::vector< std::string > chunks_;
+
+  IndexVector num_chunks() const
+  {
+    return IndexVector( ( this->size_[ 0 ] + this->chunk_size_[ 0 ] - 1 ) / this->chunk_size_[ 0 ],
+      ( this->size_[ 1 ] + this->chunk_size_[ 1 ] - 1 ) / this->chunk_size_[ 1 ],
+      ( this->size_[ 2 ] + this->chunk_size_[ 2 ] - 1 ) / this->chunk_size_[ 2 ] );
+  }
+};
+
+bool ReadManifest( const bfs::path& manifest_file, ChunkManifest& manifest, std::string& error )
+{
+  std::ifstream file_text( manifest_file.string().c_str() );
+  if ( !file_text )
+  {
+    error = "Could not open file '" + manifest_file.string() + "'.";
+    return false;
+  }
+
+  std::map< std::string, std::string > values;
+  bool chunk_list = false;
+  std::string line;
+  while ( std::getline( file_text, line ) )
+  {
+    StripSurroundingSpaces( line );
+    if ( line.empty() ) continue;
+
+    if ( chunk_list )
+    {
+      if ( !IsChunkHash( line ) )
+      {
+        error = "Manifest file '" + manifest_file.string() + "' contains an invalid chunk.";
+        return false;
+      }
+      manifest.chunks_.push_back( line );
+      continue;
+    }
+
+    size_t pos = line.find( ':' );
+    if ( pos == std::string::npos ) continue;
+    std::string key = line.substr( 0, pos );
+    std::string value = line.substr( pos + 1 );
+    StripSurroundingSpaces( value );
+    if ( key == "chunks" ) chunk_list = true;
+    else values[ key ] = value;
+  }
+
+  manifest.little_endian_ = values[ "endian" ] != "big";
+  manifest.has_histogram_ = values.find( "histogram" ) != values.end() &&
+    ImportFromString( values[ "histogram" ], manifest.histogram_ );
+
+  if ( !ImportFromString( values[ "datatype" ], manifest.data_type_ ) ||
+    !ImportFromString( values[ "size" ], manifest.size_ ) ||
+    !ImportFromString( values[ "chunksize" ], manifest.chunk_size_ ) ||
+    !ImportFromString( values[ "transform" ], manifest.grid_transform_ ) )
+  {
+    error = "Manifest file '" + manifest_file.string() + "' is missing required fields.";
+    return false;
+  }
+
+  if ( manifest.chunk_size_[ 0 ] <= 0 || manifest.chunk_size_[ 1 ] <= 0 || 
+    manifest.chunk_size_[ 2 ] <= 0 || manifest.size_[ 0 ] <= 0 || manifest.size_[ 1 ] <= 0 || 
+    manifest.size_[ 2 ] <= 0 )
+  {
+    error = "Manifest file '" + manifest_file.string() + "' has an invalid size.";
+    return false;
+  }
+
+  IndexVector num_chunks = manifest.num_chunks();
+  if ( manifest.chunks_.size() != static_cast< size_t >( num_chunks.x() * num_chunks.y() * 
+    num_chunks.z() ) )
+  {
+    error = "Manifest file '" + manifest_file.string() + "' does not list all chunks.";
+    return false;
+  }
+
+  return true;
+}
+
+// Write a file under a temporary name and move it into place, so that an interrupted save never
+// leaves a partial file under the final name. The temporary name is unique, as several saves may
+// write the same chunk at the same time.
+bool WriteFileAtomic( const bfs::path& filename, const char* data, size_t size )
+{
+  boost::system::error_code unique_ec;
+  bfs::path temp_file = filename.parent_path() / bfs::unique_path( 
+    filename.filename().string() + ".%%%%-%%%%-%%%%.tmp", unique_ec );
+  if ( unique_ec ) return false;
+
+  {
+    std::ofstream output( temp_file.string().c_str(), std::ios::out | std::ios::binary | 
+      std::ios::trunc );
+    if ( !output ) return false;
+    output.write( data, size );
+    output.close();
+    if ( !output ) 
+    {
+      boost::system::error_code ec;
+      bfs::remove( temp_file, ec );
+      return false;
+    }
+  }
+
+  boost::system::error_code ec;
+  bfs::rename( temp_file, filename, ec );
+  if ( ec )
+  {
+    bfs::remove( temp_file, ec );
+    return false;
+  }
+  return true;
+}
+
+class ChunkStoreTask
+{
+public:
+  ChunkStoreTask( const bfs::path& directory, const ChunkManifest& manifest, 
+    unsigned char* data ) :
+    directory_( directory ),
+    manifest_( manifest ),
+    data_( data ),
+    elem_size_( GetSizeDataType( manifest.data_type_ ) ),
+    compress_( false ),
+    level_( Z_DEFAULT_COMPRESSION ),
+    success_( true ),
+    num_written_( 0 )
+  {
+  }
+
+  // Get the voxel range covered by a chunk
+  void get_chunk_range( size_t chunk, IndexVector& start, IndexVector& size ) const
+  {
+    IndexVector num_chunks = this->manifest_.num_chunks();
+    const IndexVector& chunk_size = this->manifest_.chunk_size_;
+
+    start = IndexVector( ( chunk % num_chunks.x() ) * chunk_size.x(),
+      ( ( chunk / num_chunks.x() ) % num_chunks.y() ) * chunk_size.y(),
+      ( chunk / ( num_chunks.x() * num_chunks.y() ) ) * chunk_size.z() );
+    size = IndexVector( Min( chunk_size.x(), this->manifest_.size_.x() - start.x() ),
+      Min( chunk_size.y(), this->manifest_.size_.y() - start.y() ),
+      Min( chunk_size.z(), this->manifest_.size_.z() - start.z() ) );
+  }
+
+  // Copy a chunk out of, or into, the volume
+  void copy_chunk( size_t chunk, std::vector< unsigned char >& buffer, bool extract )
+  {
+    IndexVector start, size;
+    this->get_chunk_range( chunk, start, size );
+    const IndexVector& volume_size = this->manifest_.size_;
+
+    size_t row_size = size.x() * this->elem_size_;
+    buffer.resize( row_size * size.y() * size.z() );
+
+    unsigned char* chunk_ptr = buffer.empty() ? 0 : &buffer[ 0 ];
+    for ( IndexVector::index_type z = 0; z < size.z(); z++ )
+    {
+      for ( IndexVector::index_type y = 0; y < size.y(); y++ )
+      {
+        unsigned char* volume_ptr = this->data_ + ( ( ( start.z() + z ) * volume_size.y() + 
+          ( start.y() + y ) ) * volume_size.x() + start.x() ) * this->elem_size_;
+        if ( extract ) std::memcpy( chunk_ptr, volume_ptr, row_size );
+        else std::memcpy( volume_ptr, chunk_ptr, row_size );
+        chunk_ptr += row_size;
+      }
+    }
+  }
+
+  void save_chunks( int thread, int num_threads, boost::barrier& barrier )
+  {
+    std::vector< unsigned char > buffer;
+    std::vector< unsigned char > compressed;
+
+    // Hash all the chunks first, chunks that did not change keep the hash of the base manifest
+    for ( size_t j = thread; j < this->chunks_.size(); j += num_threads )
+    {
+      if ( !this->hash_chunk_.empty() && !this->hash_chunk_[ j ] ) continue;
+      this->copy_chunk( j, buffer, true );
+      this->chunks_[ j ] = HashChunk( buffer.empty() ? 0 : &buffer[ 0 ], buffer.size() );
+    }
+
+    barrier.wait();
+
+    // Identical chunks within the volume, e.g. empty regions, only need to be written once.
+    // Chunks taken from the base manifest are on disk already.
+    if ( thread == 0 )
+    {
+      std::set< std::string > hashes;
+      this->write_chunk_.resize( this->chunks_.size() );
+      for ( size_t j = 0; j < this->chunks_.size(); j++ )
+      {
+        this->write_chunk_[ j ] = ( this->hash_chunk_.empty() || this->hash_chunk_[ j ] ) &&
+          hashes.insert( this->chunks_[ j ] ).second;
+      }
+    }
+
+    barrier.wait();
+
+    for ( size_t j = thread; j < this->chunks_.size(); j += num_threads )
+    {
+      if ( !this->success_ ) return;
+      if ( !this->write_chunk_[ j ] ) continue;
+
+      // Chunks that are already on disk are shared with the earlier generations
+      bfs::path chunk_file = GetChunkFile( this->directory_, this->chunks_[ j ] );
+      boost::system::error_code ec;
+      if ( bfs::exists( chunk_file, ec ) ) continue;
+
+      bfs::create_directories( chunk_file.parent_path(), ec );
+      this->copy_chunk( j, buffer, true );
+
+      // Chunks are stored compressed, unless that does not make them smaller. The size of
+      // the file tells the two apart when loading.
+      const char* chunk_data = reinterpret_cast< const char* >( buffer.empty() ? 0 : 
+        &buffer[ 0 ] );
+      size_t chunk_size = buffer.size();
+      if ( this->compress_ && !buffer.empty() )
+      {
+        uLongf compressed_size = compressBound( static_cast< uLong >( buffer.size() ) );
+        compressed.resize( compressed_size );
+        if ( compress2( &compressed[ 0 ], &compressed_size, &buffer[ 0 ], 
+          static_cast< uLong >( buffer.size() ), this->level_ ) == Z_OK && 
+          compressed_size < buffer.size() )
+        {
+          chunk_data = reinterpret_cast< const char* >( &compressed[ 0 ] );
+          chunk_size = compressed_size;
+        }
+      }
+
+      if ( !WriteFileAtomic( chunk_file, chunk_data, chunk_size ) )
+      {
+        lock_type lock( this->mutex_ );
+        this->error_ = "Could not write file '" + chunk_file.string() + "'.";
+        this->success_ = false;
+        return;
+      }
+
+      lock_type lock( this->mutex_ );
+      this->num_written_++;
+    }
+  }
+
+  void load_chunks( int thread, int num_threads, boost::barrier& barrier )
+  {
+    std::vector< unsigned char > buffer;
+    std::vector< unsigned char > file_data;
+
+    for ( size_t j = thread; j < this->manifest_.chunks_.size(); j += num_threads )
+    {
+      if ( !this->success_ ) return;
+
+      IndexVector start, size;
+      this->get_chunk_range( j, start, size );
+      buffer.resize( size.x() * size.y() * size.z() * this->elem_size_ );
+      uLongf chunk_size = static_cast< uLongf >( buffer.size() );
+
+      bfs::path chunk_file = GetChunkFile( this->directory_, this->manifest_.chunks_[ j ] );
+      std::ifstream input( chunk_file.string().c_str(), std::ios::in | std::ios::binary );
+      bool success = static_cast< bool >( input );
+      if ( success )
+      {
+        input.seekg( 0, std::ios::end );
+        file_data.resize( static_cast< size_t >( input.tellg() ) );
+        input.seekg( 0, std::ios::beg );
+        if ( !file_data.empty() ) input.read( reinterpret_cast< char* >( &file_data[ 0 ] ), 
+          file_data.size() );
+        success = static_cast< bool >( input );
+      }
+
+      if ( success && !buffer.empty() )
+      {
+        if ( file_data.size() == buffer.size() )
+        {
+          buffer.swap( file_data );
+        }
+        else
+        {
+          success = uncompress( &buffer[ 0 ], &chunk_size, &file_data[ 0 ], 
+            static_cast< uLong >( file_data.size() ) ) == Z_OK && chunk_size == buffer.size();
+        }
+      }
+
+      if ( !success )
+      {
+        lock_type lock( this->mutex_ );
+        this->error_ = "Could not read file '" + chunk_file.string() + "'.";
+        this->success_ = false;
+        return;
+      }
+
+      this->copy_chunk( j, buffer, false );
+    }
+  }
+
+  typedef boost::mutex mutex_type;
+  typedef boost::unique_lock< mutex_type > lock_type;
+
+  bfs::path directory_;
+  const ChunkManifest& manifest_;
+  unsigned char* data_;
+  size_t elem_size_;
+
+  bool compress_;
+  int level_;
+
+  // Hashes of the saved chunks
+  std::vector< std::string > chunks_;
+
+  // Which chunks need to be hashed. If empty, all chunks are hashed.
+  std::vector< bool > hash_chunk_;
+
+  // Whether a chunk is the first one with its hash
+  std::vector< bool > write_chunk_;
+
+  mutex_type mutex_;
+  volatile bool success_;
+  std::string error_;
+  size_t num_written_;
+};
+
+} // end anonymous namespace
+
+bool DataBlockChunkStore::Save( const bfs::path& manifest_file, DataBlockHandle data_block,
+  const GridTransform& grid_transform, bool compress, int level, std::string& error )
+{
+  return Save( manifest_file, data_block, grid_transform, bfs::path(), -1, compress, level,
+    error );
+}
+
+bool DataBlockChunkStore::Save( const bfs::path& manifest_file, DataBlockHandle data_block,
+  const GridTransform& grid_transform, const bfs::path& base_manifest_file,
+  DataBlock::generation_type base_generation, bool compress, int level, std::string& error )
+{
+  if ( !data_block )
+  {
+    error = "Error writing file: " + manifest_file.string() + " : no data volume available";
+    return false;
+  }
+
+  bfs::path directory = manifest_file.parent_path();
+
+  ChunkManifest manifest;
+  manifest.data_type_ = data_block->get_data_type();
+  manifest.size_ = IndexVector( data_block->get_nx(), data_block->get_ny(), 
+    data_block->get_nz() );
+  manifest.chunk_size_ = IndexVector( CHUNK_SIZE_C, CHUNK_SIZE_C, CHUNK_SIZE_C );
+  manifest.little_endian_ = DataBlock::IsLittleEndian();
+  manifest.grid_transform_ = grid_transform;
+  manifest.histogram_ = data_block->get_histogram();
+
+  IndexVector num_chunks = manifest.num_chunks();
+  ChunkStoreTask task( directory, manifest, 
+    reinterpret_cast< unsigned char* >( data_block->get_data() ) );
+  task.chunks_.resize( num_chunks.x() * num_chunks.y() * num_chunks.z() );
+  task.compress_ = compress;
+  task.level_ = level < 0 ? Z_DEFAULT_COMPRESSION : Min( 9, level );
+
+  // A base manifest can be used if its chunks line up with the bricks in which the data block
+  // tracks its changes
+  ChunkManifest base_manifest;
+  std::string base_error;
+  bool use_base = base_generation >= 0 && !base_manifest_file.empty() && 
+    bfs::exists( base_manifest_file ) && 
+    ReadManifest( base_manifest_file, base_manifest, base_error ) &&
+    base_manifest.data_type_ == manifest.data_type_ && base_manifest.size_ == manifest.size_ &&
+    base_manifest.chunk_size_ == IndexVector( DataBlock::DIRTY_BRICK_SIZE_C, 
+      DataBlock::DIRTY_BRICK_SIZE_C, DataBlock::DIRTY_BRICK_SIZE_C ) &&
+    base_manifest.chunk_size_ == manifest.chunk_size_ &&
+    base_manifest.little_endian_ == manifest.little_endian_;
+
+  {
+    DataBlock::shared_lock_type slock( data_block->get_mutex() );
+
+    std::vector< size_t > changed_bricks;
+    if ( use_base && data_block->get_changed_bricks( base_generation, changed_bricks ) )
+    {
+      task.chunks_ = base_manifest.chunks_;
+      task.hash_chunk_.resize( task.chunks_.size(), false );
+      for ( size_t j = 0; j < changed_bricks.size(); j++ )
+      {
+        task.hash_chunk_[ changed_bricks[ j ] ] = true;
+      }
+
+      CORE_LOG_DEBUG( "Hashing " + ExportToString( changed_bricks.size() ) + 
+        " changed chunks for '" + manifest_file.string() + "'." );
+    }
+
+    Parallel parallel( boost::bind( &ChunkStoreTask::save_chunks, &task, _1, _2, _3 ) );
+    parallel.run();
+  }
+
+  if ( !task.success_ )
+  {
+    error = task.error_;
+    return false;
+  }
+
+  CORE_LOG_DEBUG( "Saved " + ExportToString( task.num_written_ ) + " of " + 
+    ExportToString( task.chunks_.size() ) + " chunks for '" + manifest_file.string() + "'." );
+
+  // The manifest is written last, so it only exists once all its chunks are on disk
+  std::ostringstream text_file;
+  text_file << "datatype: " << ExportToString( manifest.data_type_ ) << std::endl;
+  text_file << "size: " << ExportToString( manifest.size_ ) << std::endl;
+  text_file << "chunksize: " << ExportToString( manifest.chunk_size_ ) << std::endl;
+  text_file << "endian: " << ( manifest.little_endian_ ? "little" : "big" ) << std::endl;
+  text_file << "transform: " << ExportToString( manifest.grid_transform_ ) << std::endl;
+  text_file << "histogram: " << ExportToString( manifest.histogram_ ) << std::endl;
+  text_file << "chunks:" << std::endl;
+  for ( size_t j = 0; j < task.chunks_.size(); j++ )
+  {
+    text_file << task.chunks_[ j ] << std::endl;
+  }
+
+  std::string text = text_file.str();
+  if ( !WriteFileAtomic( manifest_file, text.c_str(), text.size() ) )
+  {
+    error = "Could not write file '" + manifest_file.string() + "'.";
+    return false;
+  }
+
+  return true;
+}
+
+bool DataBlockChunkStore::Load( const bfs::path& manifest_file, DataBlockHandle& data_block,
+  GridTransform& grid_transform, std::string& error )
+{
+  data_block.reset();
+
+  ChunkManifest manifest;
+  if ( !ReadManifest( manifest_file, manifest, error ) ) return false;
+
+  DataBlockHandle new_data_block = StdDataBlock::New( manifest.size_.x(), manifest.size_.y(), 
+    manifest.size_.z(), manifest.data_type_ );
+  if ( !new_data_block )
+  {
+    error = "Could not allocate enough memory to load '" + manifest_file.string() + "'.";
+    return false;
+  }
+
+  ChunkStoreTask task( manifest_file.parent_path(), manifest, 
+    reinterpret_cast< unsigned char* >( new_data_block->get_data() ) );
+  Parallel parallel( boost::bind( &ChunkStoreTask::load_chunks, &task, _1, _2, _3 ) );
+  parallel.run();
+
+  if ( !task.success_ )
+  {
+    error = task.error_;
+    return false;
+  }
+
+  if ( manifest.little_endian_ != DataBlock::IsLittleEndian() ) new_data_block->swap_endian();
+
+  // Trust the histogram recorded in the manifest
+  if ( manifest.has_histogram_ && manifest.little_endian_ == DataBlock::IsLittleEndian() )
+  {
+    new_data_block->set_histogram( manifest.histogram_ );
+  }
+  else
+  {
+    new_data_block->update_histogram();
+  }
+
+  grid_transform = manifest.grid_transform_;
+  data_block = new_data_block;
+  return true;
+}
+
+bool DataBlockChunkStore::GetChunkFiles( const bfs::path& manifest_file, 
+  std::vector< bfs::path >& chunk_files, std::string& error )
+{
+  chunk_files.clear();
+
+  ChunkManifest manifest;
+  if ( !ReadManifest( manifest_file, manifest, error ) ) return false;
+
+  std::set< std::string > hashes( manifest.chunks_.begin(), manifest.chunks_.end() );
+  std::set< std::string >::const_iterator it = hashes.begin();
+  for ( ; it != hashes.end(); ++it )
+  {
+    chunk_files.push_back( GetRelativeChunkFile( *it ) );
+  }
+  return true;
+}
+
+void DataBlockChunkStore::RemoveUnusedChunks( const bfs::path& directory )
+{
+  bfs::path chunk_dir = directory / CHUNK_DIR_C;
+  boost::system::error_code ec;
+  if ( !bfs::exists( chunk_dir, ec ) ) return;
+
+  // Collect the chunks that are still in use
+  std::set< std::string > hashes;
+  bfs::directory_iterator dir_end;
+  for ( bfs::directory_iterator dir_itr( directory, ec ); !ec && dir_itr != dir_end; 
+    dir_itr.increment( ec ) )
+  {
+    bfs::path file_path = dir_itr->path();
+    if ( !bfs::is_regular_file( file_path ) ) continue;
+    if ( file_path.extension().string() != GetManifestExtension() ) continue;
+
+    ChunkManifest manifest;
+    std::string error;
+    if ( !ReadManifest( file_path, manifest, error ) )
+    {
+      // Do not remove anything if it is unclear which chunks are in use
+      CORE_LOG_ERROR( error );
+      return;
+    }
+    hashes.insert( manifest.chunks_.begin(), manifest.chunks_.end() );
+  }
+
+  if ( ec ) return;
+
+  // Remove the chunks that are no longer used, including left over temporary files
+  std::vector< bfs::path > unused_files;
+  bfs::recursive_directory_iterator rdir_end;
+  for ( bfs::recursive_directory_iterator rdir_itr( chunk_dir, ec ); !ec && rdir_itr != rdir_end; 
+    rdir_itr.increment( ec ) )
+  {
+    bfs::path file_path = rdir_itr->path();
+    if ( !bfs::is_regular_file( file_path ) ) continue;
+    if ( file_path.extension().string() == CHUNK_EXTENSION_C &&
+      hashes.count( file_path.stem().string() ) ) continue;
+    unused_files.push_back( file_path );
+  }
+
+  for ( size_t j = 0; j < unused_files.size(); j++ )
+  {
+    bfs::remove( unused_files[ j ], ec );
+  }
+}
+
+std::string DataBlockChunkStore::GetManifestExtension()
+{
+  return ".chunks";
+}
+
+} // end namespace Core
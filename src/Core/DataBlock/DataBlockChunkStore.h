@@ -0,0 +1,99 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_DATABLOCKCHUNKSTORE_H
+#define CORE_DATABLOCK_DATABLOCKCHUNKSTORE_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Boost includes
+#include <boost/filesystem.hpp>
+
+// Core includes
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/Geometry/GridTransform.h>
+
+namespace Core
+{
+
+// CLASS DATABLOCKCHUNKSTORE
+/// On disk store for data blocks that splits the data into fixed size chunks of 64x64x64 voxels.
+/// Each chunk is stored in a file named after the hash of its contents, and a small manifest
+/// file records the layout and the hashes of the chunks of one data block. When a new
+/// generation of a data block is saved, only the chunks that changed need to be written; chunks
+/// that are unchanged are shared with the generations that were saved before.
+class DataBlockChunkStore
+{
+  // -- Data IO --
+public:
+  // SAVE:
+  /// Save a data block into the manifest file. The chunks are stored in the chunk directory
+  /// next to the manifest file.
+  static bool Save( const boost::filesystem::path& manifest_file, DataBlockHandle data_block,
+    const GridTransform& grid_transform, bool compress, int level, std::string& error );
+
+  // SAVE:
+  /// Save a data block into the manifest file, starting from the manifest that was saved when
+  /// the data block had generation base_generation. Only the chunks that the data block marks as
+  /// changed since then are hashed again. If the changes are not known, all chunks are hashed.
+  static bool Save( const boost::filesystem::path& manifest_file, DataBlockHandle data_block,
+    const GridTransform& grid_transform, const boost::filesystem::path& base_manifest_file,
+    DataBlock::generation_type base_generation, bool compress, int level, std::string& error );
+
+  // LOAD:
+  /// Load a data block from a manifest file
+  static bool Load( const boost::filesystem::path& manifest_file, DataBlockHandle& data_block,
+    GridTransform& grid_transform, std::string& error );
+
+  // -- Chunk management --
+public:
+  // GETCHUNKFILES:
+  /// Get the chunk files that are referenced by a manifest file, relative to the directory
+  /// that contains the manifest file
+  static bool GetChunkFiles( const boost::filesystem::path& manifest_file, 
+    std::vector< boost::filesystem::path >& chunk_files, std::string& error );
+
+  // REMOVEUNUSEDCHUNKS:
+  /// Remove all the chunks from the chunk directory in directory that are not referenced by any
+  /// of the manifest files in that directory.
+  static void RemoveUnusedChunks( const boost::filesystem::path& directory );
+
+  // GETMANIFESTEXTENSION:
+  /// Extension of the manifest files
+  static std::string GetManifestExtension();
+};
+
+} // end namespace Core
+
+#endif
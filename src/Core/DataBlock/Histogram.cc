@@ -32,6 +32,8 @@
 
 // Boost includes
 #include <boost/algorithm/minmax_element.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
 
 // Core includes
 #include <Core/Utils/Parallel.h>
@@ -42,565 +44,552 @@
 namespace Core
 {
 
-Histogram::Histogram() 
+namespace
 {
-  this->min_ = Core::Nan();
-  this->max_ = Core::Nan();
-  this->bin_start_ = Core::Nan();
-  this->bin_size_ = Core::Nan();
-  this->histogram_.resize( 0 );
-}
 
-Histogram::Histogram( const signed char* data, size_t size )
-{
-  this->compute( data, size );
-}
-  
-Histogram::Histogram( const unsigned char* data, size_t size )
+// Number of values of a flat array that are processed as one unit
+const size_t FLAT_UNIT_SIZE_C = 1 << 20;
+
+// Maximum number of bins of a histogram
+const size_t MAX_NUM_BINS_C = 0x100;
+
+// Only finite floating point values are counted
+template< class T >
+inline bool IsValidValue( T )
 {
-  this->compute( data, size );
+  return true;
 }
 
-Histogram::Histogram( const short* data, size_t size )
+inline bool IsValidValue( float value )
 {
-  this->compute( data, size );
+  return IsFinite( value );
 }
 
-Histogram::Histogram( const unsigned short* data, size_t size )
+inline bool IsValidValue( double value )
 {
-  this->compute( data, size );
+  return IsFinite( value );
 }
 
-Histogram::Histogram( const int* data, size_t size )
+// Char and short data is binned through a lookup table that covers all the possible values
+template< class T >
+inline size_t TableIndex( T )
 {
-  this->compute( data, size );
+  return 0;
 }
 
-Histogram::Histogram( const unsigned int* data, size_t size )
+inline size_t TableIndex( signed char value )
 {
-  this->compute( data, size );
+  return static_cast< size_t >( static_cast< int >( value ) + 0x80 );
 }
 
-Histogram::Histogram( const float* data, size_t size )
+inline size_t TableIndex( unsigned char value )
 {
-  this->compute( data, size );
+  return static_cast< size_t >( value );
 }
 
-Histogram::Histogram( const double* data, size_t size )
+inline size_t TableIndex( short value )
 {
-  this->compute( data, size );
+  return static_cast< size_t >( static_cast< int >( value ) + 0x8000 );
 }
 
-Histogram::~Histogram()
+inline size_t TableIndex( unsigned short value )
 {
+  return static_cast< size_t >( value );
 }
 
-// For char and short data we do a single pass over the data to speed up the computation. The
-// first pass is used to generate the histogram. In the next step we use this data to compute
-// min and max
-
-bool Histogram::compute( const signed char* data, size_t size )
+// Layout of the bins of a histogram, which only depends on the range of the data
+struct HistogramLayout
 {
-  this->min_ = Core::Nan();
-  this->max_ = Core::Nan();
-  this->bin_start_ = Core::Nan();
-  this->bin_size_ = Core::Nan();
-  this->histogram_.resize( 0 );
-  if ( size == 0 ) return false;
-  
-  try
+  HistogramLayout() :
+    min_( 0.0 ),
+    max_( 0.0 ),
+    bin_start_( 0.0 ),
+    bin_size_( 1.0 ),
+    offset_( 0.0 ),
+    num_bins_( 0 )
   {
-    std::vector<size_t> histogram;
-    histogram.resize( 0x100 , 0 );
-
-    for ( size_t j = 0 ; j < size ; j++ )
-    {
-      histogram[ static_cast<int>( data[ j ] ) + 0x80 ]++;
-    }
-    
-    size_t hist_begin = 0;
-    size_t hist_end = 0;
-    
-    for ( size_t j = 0 ; j < histogram.size() ; j++ )
-    {
-      if ( histogram[ j ] > 0 ) hist_end = j;
-    }
-
-    size_t hsize = histogram.size();
-    for ( size_t j = 0 ; j < hsize; j++ )
-    {
-      if ( histogram[ hsize - 1 - j ] > 0 ) hist_begin = hsize - 1 - j;
-    }
+  }
 
-    this->min_ = static_cast<double>( hist_begin ) - static_cast<double>( 0x80 );
-    this->max_ = static_cast<double>( hist_end ) - static_cast<double>( 0x80 );
+  double min_;
+  double max_;
+  double bin_start_;
+  double bin_size_;
 
-    this->bin_size_  = 1.0;
-    this->bin_start_ = this->min_ - 0.5;
+  // Value that is subtracted from the data before dividing by the bin size
+  double offset_;
+  size_t num_bins_;
+};
 
-    this->histogram_.resize( hist_end + 1 - hist_begin );
-    for ( size_t j = 0 ; j < histogram_.size() ; j++ )
-    {
-      this->histogram_[ j ] = histogram[ j + hist_begin ];
-    }
+template< class T >
+void ComputeLayout( double min, double max, HistogramLayout& layout )
+{
+  const bool is_integer = std::numeric_limits< T >::is_integer;
+  const bool use_table = is_integer && sizeof( T ) <= 2;
 
-    std::pair< std::vector<size_t>::iterator, std::vector<size_t>::iterator > min_max = 
-      boost::minmax_element( this->histogram_.begin(), this->histogram_.end() );
-    this->min_bin_ = (*min_max.first);
-    this->max_bin_ = (*min_max.second);
+  layout.min_ = min;
+  layout.max_ = max;
+  if ( min == max )
+  {
+    layout.num_bins_ = 1;
+    layout.bin_size_ = 1.0;
   }
-  catch( ... )
+  else if ( is_integer && ( max - min ) < static_cast< double >( MAX_NUM_BINS_C ) )
   {
-    this->min_ = Core::Nan();
-    this->max_ = Core::Nan();
-    this->bin_start_ = Core::Nan();
-    this->bin_size_ = Core::Nan();
-    this->histogram_.resize( 0 );
-    return false;
+    layout.num_bins_ = static_cast< size_t >( max - min ) + 1;
+    layout.bin_size_ = 1.0;
   }
-  
-  return true;
+  else
+  {
+    layout.num_bins_ = MAX_NUM_BINS_C;
+    layout.bin_size_ = ( max - min ) / static_cast< double >( MAX_NUM_BINS_C - 1 );
+  }
+  layout.bin_start_ = min - ( layout.bin_size_ * 0.5 );
+
+  // NOTE: Char and short data is centered on the bins, the other types are binned from the
+  // minimum upwards.
+  layout.offset_ = use_table ? layout.bin_start_ : min;
 }
 
-bool Histogram::compute( const unsigned char* data, size_t size )
+template< class T >
+class HistogramTask
 {
-  this->min_ = Core::Nan();
-  this->max_ = Core::Nan();
-  this->bin_start_ = Core::Nan();
-  this->bin_size_ = Core::Nan();
-  this->histogram_.resize( 0 );
-  if ( size == 0 ) return false;
-
-  try
+public:
+  HistogramTask( const T* data, size_t nx, size_t ny, size_t nz, size_t brick_size ) :
+    data_( data ),
+    nx_( nx ),
+    ny_( ny ),
+    nz_( nz ),
+    brick_size_( brick_size ),
+    incremental_( false ),
+    valid_( true )
   {
-    std::vector<size_t> histogram;
-    histogram.resize( 0x100, 0 );
-    
-    for ( size_t j = 0 ; j < size ; j++ )
-    {
-      histogram[ static_cast<int>( data[ j ] ) ]++;
-    }
-    
-    size_t hist_begin = 0;
-    size_t hist_end = 0;
-    
-    for ( size_t j = 0 ; j < histogram.size() ; j++ )
+    if ( brick_size_ > 0 )
     {
-      if ( histogram[ j ] > 0 ) hist_end = j;
+      this->bnx_ = ( nx + brick_size - 1 ) / brick_size;
+      this->bny_ = ( ny + brick_size - 1 ) / brick_size;
+      this->bnz_ = ( nz + brick_size - 1 ) / brick_size;
     }
-
-    size_t hsize = histogram.size();
-    for ( size_t j = 0 ; j < hsize; j++ )
+    else
     {
-      if ( histogram[ hsize - 1 - j ] > 0 ) hist_begin = hsize - 1 - j;
+      this->bnx_ = ( nx * ny * nz + FLAT_UNIT_SIZE_C - 1 ) / FLAT_UNIT_SIZE_C;
+      this->bny_ = 1;
+      this->bnz_ = 1;
     }
+  }
 
+  // Get the number of units, i.e. bricks or parts of a flat array, the data is split in
+  size_t get_num_units() const
+  {
+    return this->bnx_ * this->bny_ * this->bnz_;
+  }
 
-    this->min_ = static_cast<double>( hist_begin );
-    this->max_ = static_cast<double>( hist_end );
-
-    this->bin_size_  = 1.0;
-    this->bin_start_ = this->min_ - 0.5;
-
-    this->histogram_.resize( hist_end + 1 - hist_begin );
-
-    for ( size_t j = 0 ; j < histogram_.size() ; j++ )
+  // Get the values covered by a unit
+  void get_unit_extent( size_t unit, size_t& x0, size_t& y0, size_t& z0, size_t& sx, 
+    size_t& sy, size_t& sz ) const
+  {
+    if ( this->brick_size_ == 0 )
     {
-      this->histogram_[ j ] = histogram[ j + hist_begin ];
+      size_t size = this->nx_ * this->ny_ * this->nz_;
+      x0 = unit * FLAT_UNIT_SIZE_C; y0 = 0; z0 = 0;
+      sx = Min( FLAT_UNIT_SIZE_C, size - x0 ); sy = 1; sz = 1;
+      return;
     }
 
-    std::pair< std::vector<size_t>::iterator, std::vector<size_t>::iterator > min_max = 
-      boost::minmax_element( this->histogram_.begin(), this->histogram_.end() );
-    this->min_bin_ = (*min_max.first);
-    this->max_bin_ = (*min_max.second);
+    x0 = ( unit % this->bnx_ ) * this->brick_size_;
+    y0 = ( ( unit / this->bnx_ ) % this->bny_ ) * this->brick_size_;
+    z0 = ( unit / ( this->bnx_ * this->bny_ ) ) * this->brick_size_;
+    sx = Min( this->brick_size_, this->nx_ - x0 );
+    sy = Min( this->brick_size_, this->ny_ - y0 );
+    sz = Min( this->brick_size_, this->nz_ - z0 );
   }
-  catch( ... )
+
+  // Get a pointer to the first value of a row of a unit
+  const T* get_row( size_t x0, size_t y, size_t z ) const
   {
-    this->min_ = Core::Nan();
-    this->max_ = Core::Nan();
-    this->bin_start_ = Core::Nan();
-    this->bin_size_ = Core::Nan();
-    this->histogram_.resize( 0 );
-    return false;
+    // NOTE: Flat arrays are addressed as one long row
+    if ( this->brick_size_ == 0 ) return this->data_ + x0;
+    return this->data_ + ( z * this->ny_ + y ) * this->nx_ + x0;
   }
-  
-  return true;  
-}
 
-bool Histogram::compute( const short* data, size_t size )
-{
-  this->min_ = Core::Nan();
-  this->max_ = Core::Nan();
-  this->bin_start_ = Core::Nan();
-  this->bin_size_ = Core::Nan();
-  this->histogram_.resize( 0 );
-  if ( size == 0 ) return false;
-
-  try
+  void compute_range( size_t unit )
   {
-    std::vector<size_t> histogram;
-    histogram.resize( 0x10000 , 0 );
-    
-    for ( size_t j = 0 ; j < size ; j++ )
+    size_t x0, y0, z0, sx, sy, sz;
+    this->get_unit_extent( unit, x0, y0, z0, sx, sy, sz );
+
+    // NOTE: Start with an empty range, as floating point units may not have valid values
+    T min = std::numeric_limits< T >::max();
+    T max = std::numeric_limits< T >::is_integer ? std::numeric_limits< T >::min() :
+      -std::numeric_limits< T >::max();
+    bool has_values = false;
+
+    for ( size_t z = z0; z < z0 + sz; z++ )
     {
-      histogram[ static_cast<int>( data[ j ] ) + 0x8000 ]++;
+      for ( size_t y = y0; y < y0 + sy; y++ )
+      {
+        const T* row = this->get_row( x0, y, z );
+        for ( size_t x = 0; x < sx; x++ )
+        {
+          T value = row[ x ];
+          if ( !IsValidValue( value ) ) continue;
+          if ( value < min ) min = value;
+          if ( value > max ) max = value;
+          has_values = true;
+        }
+      }
     }
-    
-    size_t hist_begin = 0;
-    size_t hist_end = 0;
-    
-    for ( size_t j = 0 ; j < histogram.size() ; j++ )
+
+    if ( has_values )
     {
-      if ( histogram[ j ] > 0 ) hist_end = j;
+      this->unit_min_[ unit ] = static_cast< double >( min );
+      this->unit_max_[ unit ] = static_cast< double >( max );
     }
-
-    size_t hsize = histogram.size();
-    for ( size_t j = 0 ; j < hsize; j++ )
+    else
     {
-      if ( histogram[ hsize - 1 - j ] > 0 ) hist_begin = hsize - 1 - j;
+      this->unit_min_[ unit ] = std::numeric_limits< double >::max();
+      this->unit_max_[ unit ] = -std::numeric_limits< double >::max();
     }
+  }
 
-    this->min_ = static_cast<double>( hist_begin ) - static_cast<double>( 0x8000 );
-    this->max_ = static_cast<double>( hist_end ) - static_cast<double>( 0x8000 );
+  size_t get_bin( T value ) const
+  {
+    const bool use_table = std::numeric_limits< T >::is_integer && sizeof( T ) <= 2;
+    if ( use_table ) return this->table_[ TableIndex( value ) ];
 
-    size_t hist_length = hist_end + 1 - hist_begin;
-    if ( hist_length > 0x100 ) hist_length = 0x100;
-    
-    this->histogram_.resize( hist_length, 0 );
+    double bin = ( static_cast< double >( value ) - this->layout_.offset_ ) * 
+      this->inv_bin_size_;
+    if ( bin <= 0.0 ) return 0;
+    return Min( static_cast< size_t >( bin ), this->layout_.num_bins_ - 1 );
+  }
 
-    if ( hist_length == 1 )
-    {
-      this->bin_size_  = 1.0;
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
-    }
-    else
+  void compute_bins( size_t unit, std::vector< size_t >& bins )
+  {
+    size_t x0, y0, z0, sx, sy, sz;
+    this->get_unit_extent( unit, x0, y0, z0, sx, sy, sz );
+
+    if ( this->brick_size_ == 0 )
     {
-      this->bin_size_ = ( this->max_ - this->min_ ) / static_cast<double>( hist_length - 1 );
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
+      const T* row = this->get_row( x0, 0, 0 );
+      for ( size_t x = 0; x < sx; x++ )
+      {
+        if ( IsValidValue( row[ x ] ) ) bins[ this->get_bin( row[ x ] ) ]++;
+      }
+      return;
     }
-    
-    for ( size_t j = 0 ; j < histogram_.size() ; j++ )
-    {
-      double min_value = this->bin_start_ + j * this->bin_size_;
-      double max_value = this->bin_start_ + ( j + 1 ) * this->bin_size_;
 
-      for ( int k = Ceil( min_value ) ; k < Ceil( max_value ); k++ )
+    // Record the contribution of the brick separately, so it can be subtracted later on
+    const size_t num_bins = this->layout_.num_bins_;
+    unsigned int* brick_bins = &this->brick_bins_[ unit * num_bins ];
+    std::fill( brick_bins, brick_bins + num_bins, 0 );
+
+    for ( size_t z = z0; z < z0 + sz; z++ )
+    {
+      for ( size_t y = y0; y < y0 + sy; y++ )
       {
-        int idx = static_cast<int>( k ) + 0x8000;
-        if ( idx >= 0 && idx < static_cast<int>( histogram.size() ) ) 
+        const T* row = this->get_row( x0, y, z );
+        for ( size_t x = 0; x < sx; x++ )
         {
-          this->histogram_[ j ] += histogram[ idx ];
+          if ( IsValidValue( row[ x ] ) ) brick_bins[ this->get_bin( row[ x ] ) ]++;
         }
       }
     }
 
-    std::pair< std::vector<size_t>::iterator, std::vector<size_t>::iterator > min_max = 
-      boost::minmax_element( this->histogram_.begin(), this->histogram_.end() );
-    this->min_bin_ = (*min_max.first);
-    this->max_bin_ = (*min_max.second);
-  }
-  catch( ... )
-  {
-    this->min_ = Core::Nan();
-    this->max_ = Core::Nan();
-    this->bin_start_ = Core::Nan();
-    this->bin_size_ = Core::Nan();
-    this->histogram_.resize( 0 );
-    return false;
+    for ( size_t j = 0; j < num_bins; j++ )
+    {
+      bins[ j ] += brick_bins[ j ];
+    }
   }
-  
-  return true;  
-}
-
-
-bool Histogram::compute( const unsigned short* data, size_t size )
-{
-  this->min_ = Core::Nan();
-  this->max_ = Core::Nan();
-  this->bin_start_ = Core::Nan();
-  this->bin_size_ = Core::Nan();
-  this->histogram_.resize( 0 );
-  if ( size == 0 ) return false;
 
-  try
+  // Determine the layout of the bins from the range of all the units
+  void setup_bins()
   {
-    std::vector<size_t> histogram;
-    histogram.resize( 0x10000 , 0 );
-    
-    for ( size_t j = 0 ; j < size ; j++ )
-    {
-      histogram[ static_cast<int>( data[ j ] ) ]++;
-    }
-    
-    size_t hist_begin = 0;
-    size_t hist_end = 0;
-    
-    for ( size_t j = 0 ; j < histogram.size() ; j++ )
+    double min = std::numeric_limits< double >::max();
+    double max = -std::numeric_limits< double >::max();
+    for ( size_t j = 0; j < this->unit_min_.size(); j++ )
     {
-      if ( histogram[ j ] > 0 ) hist_end = j;
+      if ( this->unit_min_[ j ] > this->unit_max_[ j ] ) continue;
+      min = Min( min, this->unit_min_[ j ] );
+      max = Max( max, this->unit_max_[ j ] );
     }
 
-    size_t hsize = histogram.size();
-    for ( size_t j = 0 ; j < hsize; j++ )
+    if ( min > max )
     {
-      if ( histogram[ hsize - 1 - j ] > 0 ) hist_begin = hsize - 1 - j;
+      // Most likely all the data is NaN
+      this->valid_ = false;
+      return;
     }
 
-    this->min_ = static_cast<double>( hist_begin );
-    this->max_ = static_cast<double>( hist_end );
-
-    size_t hist_length = hist_end + 1 - hist_begin;
-    if ( hist_length > 0x100 ) hist_length = 0x100;
-    
-    this->histogram_.resize( hist_length, 0 );
+    HistogramLayout layout;
+    ComputeLayout< T >( min, max, layout );
+    const size_t num_bins = layout.num_bins_;
 
-    if ( hist_length == 1 )
+    if ( this->incremental_ && layout.min_ == this->layout_.min_ && 
+      layout.max_ == this->layout_.max_ && num_bins == this->total_bins_.size() )
     {
-      this->bin_size_  = 1.0;
-      this->bin_start_ = min_ - ( this->bin_size_ * 0.5 );
+      // The layout did not change, hence only the contributions of the changed bricks need to
+      // be replaced
+      this->bin_units_ = this->range_units_;
+      for ( size_t j = 0; j < this->bin_units_.size(); j++ )
+      {
+        const unsigned int* brick_bins = &this->brick_bins_[ this->bin_units_[ j ] * num_bins ];
+        for ( size_t k = 0; k < num_bins; k++ )
+        {
+          this->total_bins_[ k ] -= brick_bins[ k ];
+        }
+      }
     }
     else
     {
-      this->bin_size_ = ( this->max_ - this->min_ ) / static_cast<double>( hist_length - 1 );
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
+      this->bin_units_.resize( this->get_num_units() );
+      for ( size_t j = 0; j < this->bin_units_.size(); j++ ) this->bin_units_[ j ] = j;
+      this->total_bins_.assign( num_bins, 0 );
+      if ( this->brick_size_ > 0 ) this->brick_bins_.resize( this->get_num_units() * num_bins );
     }
-    
-    for ( size_t j = 0 ; j < histogram_.size() ; j++ )
-    {
-      double min_value = this->bin_start_ + j * this->bin_size_;
-      double max_value = this->bin_start_ + ( j + 1 ) * this->bin_size_;
 
-      for ( int k = Ceil( min_value ) ; k < Ceil( max_value ); k ++ )
+    this->layout_ = layout;
+    this->inv_bin_size_ = 1.0 / layout.bin_size_;
+
+    const bool use_table = std::numeric_limits< T >::is_integer && sizeof( T ) <= 2;
+    if ( use_table )
+    {
+      const double type_min = static_cast< double >( std::numeric_limits< T >::min() );
+      this->table_.assign( size_t( 1 ) << ( 8 * sizeof( T ) ), 0 );
+      for ( size_t j = static_cast< size_t >( min - type_min ); 
+        j <= static_cast< size_t >( max - type_min ); j++ )
       {
-        int idx = static_cast<int>( k );
-        if ( idx >= 0 && idx < static_cast<int>( histogram.size() ) ) 
-        {
-          this->histogram_[ j ] += histogram[ idx ];
-        }
+        double bin = ( static_cast< double >( j ) + type_min - layout.offset_ ) * 
+          this->inv_bin_size_;
+        this->table_[ j ] = static_cast< unsigned char >( bin <= 0.0 ? 0 : 
+          Min( static_cast< size_t >( bin ), num_bins - 1 ) );
       }
     }
-
-    std::pair< std::vector<size_t>::iterator, std::vector<size_t>::iterator > min_max = 
-      boost::minmax_element( this->histogram_.begin(), this->histogram_.end() );
-    this->min_bin_ = (*min_max.first);
-    this->max_bin_ = (*min_max.second);
   }
-  catch( ... )
+
+  void run( int thread, int num_threads, boost::barrier& barrier )
   {
-    this->min_ = Core::Nan();
-    this->max_ = Core::Nan();
-    this->bin_start_ = Core::Nan();
-    this->bin_size_ = Core::Nan();
-    this->histogram_.resize( 0 );
-    return false;
-  }
-  
-  return true;  
-}
+    // Step 1: Compute the range of the units that need to be computed
+    for ( size_t j = thread; j < this->range_units_.size(); j += num_threads )
+    {
+      this->compute_range( this->range_units_[ j ] );
+    }
 
+    barrier.wait();
 
-bool Histogram::compute( const int* data, size_t size )
-{
-  this->min_ = Core::Nan();
-  this->max_ = Core::Nan();
-  this->bin_start_ = Core::Nan();
-  this->bin_size_ = Core::Nan();
-  this->histogram_.resize( 0 );
-  if ( size == 0 ) return false;
+    if ( thread == 0 ) this->setup_bins();
 
-  try
-  {
-    int int_min = data[ 0 ];
-    int int_max = data[ 0 ];
+    barrier.wait();
 
-    for ( size_t j = 1 ; j < size ; j++ )
-    {
-      if ( data[ j ] < int_min ) int_min = data[ j ];
-      if ( data[ j ] > int_max ) int_max = data[ j ];
-    }
-    
-    this->min_ = static_cast<double>( int_min );
-    this->max_ = static_cast<double>( int_max );
+    if ( !this->valid_ ) return;
 
-    if ( this->min_ == this->max_ )
+    // Step 2: Each thread computes a partial histogram, which are merged at the end
+    std::vector< size_t > bins( this->layout_.num_bins_, 0 );
+    for ( size_t j = thread; j < this->bin_units_.size(); j += num_threads )
     {
-      this->bin_size_  = 1.0;
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
-      this->histogram_.resize( 1, 0 );
-    }
-    else if ( ( this->max_ - this->min_ ) < 256.0 )
-    {
-      size_t hist_size = static_cast<size_t>( this->max_ - this->min_ ) + 1;
-      this->histogram_.resize( hist_size, 0 );
-      this->bin_size_ = ( this->max_ - this->min_ ) / static_cast<double>( hist_size - 1 );
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
-    }
-    else
-    {
-      size_t hist_size = 0x100;
-      this->histogram_.resize( hist_size, 0 );
-      this->bin_size_ = ( this->max_ - this->min_ ) / static_cast<double>( hist_size - 1 );
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );  
+      this->compute_bins( this->bin_units_[ j ], bins );
     }
 
-    double inv_bin_size = 1.0 / this->bin_size_;
-    for ( size_t j = 1 ; j < size ; j++ )
+    lock_type lock( this->mutex_ );
+    for ( size_t j = 0; j < bins.size(); j++ )
     {
-      size_t idx = static_cast<size_t>( ( static_cast<double>( data[j] ) - 
-        this->min_ ) * inv_bin_size );
-      this->histogram_[ idx ]++;
+      this->total_bins_[ j ] += bins[ j ];
     }
-
-    std::pair< std::vector<size_t>::iterator, std::vector<size_t>::iterator > min_max = 
-      boost::minmax_element( this->histogram_.begin(), this->histogram_.end() );
-    this->min_bin_ = (*min_max.first);
-    this->max_bin_ = (*min_max.second);
   }
-  catch( ... )
-  {
-    this->min_ = Core::Nan();
-    this->max_ = Core::Nan();
-    this->bin_start_ = Core::Nan();
-    this->bin_size_ = Core::Nan();
-    this->histogram_.resize( 0 );
-    return false;
-  }
-  
-  return true;
+
+  typedef boost::mutex mutex_type;
+  typedef boost::unique_lock< mutex_type > lock_type;
+
+  const T* data_;
+  size_t nx_;
+  size_t ny_;
+  size_t nz_;
+
+  // Size of the bricks, zero if the data is a flat array
+  size_t brick_size_;
+
+  // Number of units along each axis
+  size_t bnx_;
+  size_t bny_;
+  size_t bnz_;
+
+  // Whether the bins are updated for the units in range_units_ only
+  bool incremental_;
+  volatile bool valid_;
+
+  // Units whose range needs to be computed
+  std::vector< size_t > range_units_;
+
+  // Units whose bins need to be computed
+  std::vector< size_t > bin_units_;
+
+  // Range of the values in each unit
+  std::vector< double > unit_min_;
+  std::vector< double > unit_max_;
+
+  HistogramLayout layout_;
+  double inv_bin_size_;
+
+  // Lookup table with the bin of each value for char and short data
+  std::vector< unsigned char > table_;
+
+  // Bins of each brick and of the total histogram
+  std::vector< unsigned int > brick_bins_;
+  std::vector< size_t > total_bins_;
+
+  mutex_type mutex_;
+};
+
+} // end anonymous namespace
+
+HistogramBricks::HistogramBricks() :
+  brick_size_( 0 ),
+  nx_( 0 ),
+  ny_( 0 ),
+  nz_( 0 )
+{
 }
 
+void HistogramBricks::clear()
+{
+  this->nx_ = 0;
+  this->ny_ = 0;
+  this->nz_ = 0;
+  this->min_.clear();
+  this->max_.clear();
+  this->bins_.clear();
+}
 
-bool Histogram::compute( const unsigned int* data, size_t size )
+bool HistogramBricks::empty() const
 {
-  this->min_ = Core::Nan();
-  this->max_ = Core::Nan();
-  this->bin_start_ = Core::Nan();
-  this->bin_size_ = Core::Nan();
-  this->histogram_.resize( 0 );
-  if ( size == 0 ) return false;
+  return this->min_.empty();
+}
 
-  try
-  {
-    unsigned int int_min = data[ 0 ];
-    unsigned int int_max = data[ 0 ];
+Histogram::Histogram() 
+{
+  this->reset();
+}
 
-    for ( size_t j = 1 ; j < size ; j++ )
-    {
-      if ( data[ j ] < int_min ) int_min = data[ j ];
-      if ( data[ j ] > int_max ) int_max = data[ j ];
-    }
-    
-    this->min_ = static_cast<double>( int_min );
-    this->max_ = static_cast<double>( int_max );
+Histogram::Histogram( const signed char* data, size_t size )
+{
+  this->compute( data, size );
+}
+  
+Histogram::Histogram( const unsigned char* data, size_t size )
+{
+  this->compute( data, size );
+}
 
-    if ( this->min_ == this->max_ )
-    {
-      this->bin_size_  = 1.0;
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
-      this->histogram_.resize( 1, 0 );
-    }
-    else if ( ( this->max_ - this->min_ ) < 256.0 )
-    {
-      size_t hist_size = static_cast<size_t>( this->max_ - this->min_ ) + 1;
-      this->histogram_.resize( hist_size, 0 );
-      this->bin_size_ = ( this->max_ - this->min_ ) / static_cast<double>( hist_size - 1 );
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
-    }
-    else
-    {
-      size_t hist_size = 0x100;
-      this->histogram_.resize( hist_size, 0 );
-      this->bin_size_ = ( this->max_ - this->min_ ) / static_cast<double>( hist_size - 1 );
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );  
-    }
+Histogram::Histogram( const short* data, size_t size )
+{
+  this->compute( data, size );
+}
 
-    double inv_bin_size = 1.0 / this->bin_size_;
-    for ( size_t j = 1 ; j < size ; j++ )
-    {
-      size_t idx = static_cast<size_t>( ( static_cast<double>( data[j] ) - this->min_ ) * inv_bin_size );
-      this->histogram_[ idx ]++;
-    }
+Histogram::Histogram( const unsigned short* data, size_t size )
+{
+  this->compute( data, size );
+}
 
-    std::pair< std::vector<size_t>::iterator, std::vector<size_t>::iterator > min_max = 
-      boost::minmax_element( this->histogram_.begin(), this->histogram_.end() );
-    this->min_bin_ = (*min_max.first);
-    this->max_bin_ = (*min_max.second);
-  }
-  catch( ... )
-  {
-    this->min_ = Core::Nan();
-    this->max_ = Core::Nan();
-    this->bin_start_ = Core::Nan();
-    this->bin_size_ = Core::Nan();
-    this->histogram_.resize( 0 );
-    return false;
-  }
-  
-  return true;
+Histogram::Histogram( const int* data, size_t size )
+{
+  this->compute( data, size );
 }
 
+Histogram::Histogram( const unsigned int* data, size_t size )
+{
+  this->compute( data, size );
+}
 
-bool Histogram::compute( const float* data, size_t size )
+Histogram::Histogram( const float* data, size_t size )
+{
+  this->compute( data, size );
+}
+
+Histogram::Histogram( const double* data, size_t size )
+{
+  this->compute( data, size );
+}
+
+Histogram::~Histogram()
+{
+}
+
+void Histogram::reset()
 {
   this->min_ = Core::Nan();
   this->max_ = Core::Nan();
   this->bin_start_ = Core::Nan();
   this->bin_size_ = Core::Nan();
   this->histogram_.resize( 0 );
-  if ( size == 0 ) return false;
+}
 
+template< class T >
+bool Histogram::compute_histogram( const T* data, size_t nx, size_t ny, size_t nz, 
+  HistogramBricks* bricks, const std::vector< size_t >* changed_bricks )
+{
   try
   {
-    float float_min = std::numeric_limits<float>::max();
-    float float_max = std::numeric_limits<float>::min();
-
-    for ( size_t j = 0 ; j < size ; j++ )
+    if ( nx * ny * nz == 0 )
     {
-      float val = data[ j ];
-      if ( ! Core::IsFinite( val ) ) continue;
-      if ( val < float_min ) float_min = val;
-      if ( val > float_max ) float_max = val;
+      this->reset();
+      if ( bricks ) bricks->clear();
+      return false;
     }
-    
-    if ( float_min > float_max )
-    {
-      // Most likely all the data is NaN
-      this->min_ = Core::Nan();
-      this->max_ = Core::Nan();
-      this->bin_start_ = Core::Nan();
-      this->bin_size_ = Core::Nan();
-      this->histogram_.resize( 0 );
-      return false;   
-    }
-    
-    this->min_ = static_cast<double>( float_min );
-    this->max_ = static_cast<double>( float_max );
 
-    if ( this->min_ == this->max_ )
+    HistogramTask< T > task( data, nx, ny, nz, bricks ? bricks->brick_size_ : 0 );
+    const size_t num_units = task.get_num_units();
+
+    // Changes can only be applied to bricks that were computed for the same volume
+    if ( bricks && changed_bricks && this->is_valid() && bricks->nx_ == nx && 
+      bricks->ny_ == ny && bricks->nz_ == nz && bricks->min_.size() == num_units &&
+      bricks->max_.size() == num_units && 
+      bricks->bins_.size() == num_units * this->histogram_.size() )
     {
-      this->bin_size_  = 1.0;
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
-      this->histogram_.resize( 1, 0 );
+      task.incremental_ = true;
+      task.range_units_ = *changed_bricks;
+      task.unit_min_ = bricks->min_;
+      task.unit_max_ = bricks->max_;
+      task.brick_bins_.swap( bricks->bins_ );
+      task.total_bins_ = this->histogram_;
+      task.layout_.min_ = this->min_;
+      task.layout_.max_ = this->max_;
     }
     else
     {
-      size_t hist_size = 0x100;
-      this->histogram_.resize( hist_size, 0 );
-      this->bin_size_ = ( this->max_ - this->min_ ) / static_cast<double>( hist_size - 1 );
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );  
+      task.range_units_.resize( num_units );
+      for ( size_t j = 0; j < num_units; j++ ) task.range_units_[ j ] = j;
+      task.unit_min_.resize( num_units );
+      task.unit_max_.resize( num_units );
     }
 
-    float inv_bin_size = static_cast< float >( 1.0f / this->bin_size_ );
-    for ( size_t j = 1 ; j < size ; j++ )
+    // NOTE: The number of units that need to be binned is only known after the range has been
+    // computed, hence the number of threads is based on all the units.
+    int num_threads = static_cast< int >( Min( num_units, 
+      static_cast< size_t >( Max( 1u, boost::thread::hardware_concurrency() ) ) ) );
+    Parallel parallel( boost::bind( &HistogramTask< T >::run, &task, _1, _2, _3 ), 
+      num_threads );
+    parallel.run();
+
+    if ( !task.valid_ )
     {
-      float val = data[ j ];
-      if ( Core::IsFinite( val ) )
-      {
-        size_t idx = static_cast<size_t>( ( val - float_min ) * inv_bin_size );
-        this->histogram_[ idx ]++;
-      }
+      this->reset();
+      if ( bricks ) bricks->clear();
+      return false;
+    }
+
+    if ( bricks )
+    {
+      bricks->nx_ = nx;
+      bricks->ny_ = ny;
+      bricks->nz_ = nz;
+      bricks->min_.swap( task.unit_min_ );
+      bricks->max_.swap( task.unit_max_ );
+      bricks->bins_.swap( task.brick_bins_ );
     }
 
+    this->min_ = task.layout_.min_;
+    this->max_ = task.layout_.max_;
+    this->bin_start_ = task.layout_.bin_start_;
+    this->bin_size_ = task.layout_.bin_size_;
+    this->histogram_.swap( task.total_bins_ );
+
     std::pair< std::vector<size_t>::iterator, std::vector<size_t>::iterator > min_max = 
       boost::minmax_element( this->histogram_.begin(), this->histogram_.end() );
     this->min_bin_ = (*min_max.first);
@@ -608,94 +597,99 @@ bool Histogram::compute( const float* data, size_t size )
   }
   catch( ... )
   {
-    this->min_ = Core::Nan();
-    this->max_ = Core::Nan();
-    this->bin_start_ = Core::Nan();
-    this->bin_size_ = Core::Nan();
-    this->histogram_.resize( 0 );
+    this->reset();
+    if ( bricks ) bricks->clear();
     return false;
   }
   
   return true;
 }
 
+bool Histogram::compute( const signed char* data, size_t size )
+{
+  return this->compute_histogram( data, size, 1, 1, 0, 0 );
+}
 
-bool Histogram::compute( const double* data, size_t size )
+bool Histogram::compute( const unsigned char* data, size_t size )
 {
-  this->min_ = Core::Nan();
-  this->max_ = Core::Nan();
-  this->bin_start_ = Core::Nan();
-  this->bin_size_ = Core::Nan();
-  this->histogram_.resize( 0 );
-  if ( size == 0 ) return false;
+  return this->compute_histogram( data, size, 1, 1, 0, 0 );
+}
 
-  try
-  {
-    this->min_ = std::numeric_limits<double>::max();
-    this->max_ = std::numeric_limits<double>::min();
+bool Histogram::compute( const short* data, size_t size )
+{
+  return this->compute_histogram( data, size, 1, 1, 0, 0 );
+}
 
-    for ( size_t j = 0 ; j < size ; j++ )
-    {
-      double val = data[ j ];
-      if ( ! Core::IsFinite( val ) ) continue;
-      if ( val < this->min_ ) this->min_ = val;
-      if ( val > this->max_ ) this->max_ = val;
-    }
-    
-    if ( this->min_ > this->max_ )
-    {
-      // Most likely all the data is NaN
-      this->min_ = Core::Nan();
-      this->max_ = Core::Nan();
-      this->bin_start_ = Core::Nan();
-      this->bin_size_ = Core::Nan();
-      this->histogram_.resize( 0 );
-      return false;   
-    }
-      
-    if ( this->min_ == this->max_ )
-    {
-      this->bin_size_  = 1.0;
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );
-      this->histogram_.resize( 1, 0 );
-    }
-    else
-    {
-      size_t hist_size = 0x100;
-      this->histogram_.resize( hist_size, 0 );
-      this->bin_size_ = ( this->max_ - this->min_ ) / static_cast<double>( hist_size - 1 );
-      this->bin_start_ = this->min_ - ( this->bin_size_ * 0.5 );  
-    }
+bool Histogram::compute( const unsigned short* data, size_t size )
+{
+  return this->compute_histogram( data, size, 1, 1, 0, 0 );
+}
 
-    double inv_bin_size = 1.0 / bin_size_;
+bool Histogram::compute( const int* data, size_t size )
+{
+  return this->compute_histogram( data, size, 1, 1, 0, 0 );
+}
 
+bool Histogram::compute( const unsigned int* data, size_t size )
+{
+  return this->compute_histogram( data, size, 1, 1, 0, 0 );
+}
 
-    for ( size_t j = 1 ; j < size ; j++ )
-    {
-      double val = data[ j ];
-      if ( Core::IsFinite( val ) )
-      {
-        size_t idx = static_cast<size_t>( ( val - this->min_ ) * inv_bin_size );
-        this->histogram_[ idx ]++;
-      }   
-    }
-    
-    std::pair< std::vector<size_t>::iterator, std::vector<size_t>::iterator > min_max = 
-      boost::minmax_element( this->histogram_.begin(), this->histogram_.end() );
-    this->min_bin_ = (*min_max.first);
-    this->max_bin_ = (*min_max.second);
-  }
-  catch( ... )
+bool Histogram::compute( const float* data, size_t size )
+{
+  return this->compute_histogram( data, size, 1, 1, 0, 0 );
+}
+
+bool Histogram::compute( const double* data, size_t size )
+{
+  return this->compute_histogram( data, size, 1, 1, 0, 0 );
+}
+
+bool Histogram::compute( const void* data, DataType type, size_t nx, size_t ny, size_t nz, 
+  size_t brick_size, HistogramBricks& bricks )
+{
+  bricks.clear();
+  bricks.brick_size_ = Max( brick_size, size_t( 1 ) );
+  return this->update( data, type, nx, ny, nz, std::vector< size_t >(), bricks );
+}
+
+bool Histogram::update( const void* data, DataType type, size_t nx, size_t ny, size_t nz, 
+  const std::vector< size_t >& changed_bricks, HistogramBricks& bricks )
+{
+  // NOTE: If the bricks do not match the volume, all of them are computed
+  if ( bricks.brick_size_ == 0 ) bricks.brick_size_ = 1;
+
+  switch( type )
   {
-    this->min_ = Core::Nan();
-    this->max_ = Core::Nan();
-    this->bin_start_ = Core::Nan();
-    this->bin_size_ = Core::Nan();
-    this->histogram_.resize( 0 );
-    return false;
+    case DataType::CHAR_E:
+      return this->compute_histogram( static_cast< const signed char* >( data ), 
+        nx, ny, nz, &bricks, &changed_bricks );
+    case DataType::UCHAR_E:
+      return this->compute_histogram( static_cast< const unsigned char* >( data ), 
+        nx, ny, nz, &bricks, &changed_bricks );
+    case DataType::SHORT_E:
+      return this->compute_histogram( static_cast< const short* >( data ), 
+        nx, ny, nz, &bricks, &changed_bricks );
+    case DataType::USHORT_E:
+      return this->compute_histogram( static_cast< const unsigned short* >( data ), 
+        nx, ny, nz, &bricks, &changed_bricks );
+    case DataType::INT_E:
+      return this->compute_histogram( static_cast< const int* >( data ), 
+        nx, ny, nz, &bricks, &changed_bricks );
+    case DataType::UINT_E:
+      return this->compute_histogram( static_cast< const unsigned int* >( data ), 
+        nx, ny, nz, &bricks, &changed_bricks );
+    case DataType::FLOAT_E:
+      return this->compute_histogram( static_cast< const float* >( data ), 
+        nx, ny, nz, &bricks, &changed_bricks );
+    case DataType::DOUBLE_E:
+      return this->compute_histogram( static_cast< const double* >( data ), 
+        nx, ny, nz, &bricks, &changed_bricks );
   }
-  
-  return true;  
+
+  this->reset();
+  bricks.clear();
+  return false;
 }
 
 double Histogram::get_min() const
@@ -32,12 +32,47 @@
 
 #include <vector>
 
+#include <Core/DataBlock/DataType.h>
+
 namespace Core
 {
 
 // Forward Declaration
 class Histogram;
 
+// CLASS HISTOGRAMBRICKS
+/// The contribution of each brick of a volume to the histogram of the volume. Keeping these
+/// around allows the histogram to be updated when only some of the bricks change.
+class HistogramBricks
+{
+public:
+  HistogramBricks();
+
+  // CLEAR:
+  /// Forget the contributions of all the bricks
+  void clear();
+
+  // EMPTY:
+  /// Check whether the contributions of the bricks are known
+  bool empty() const;
+
+  /// Size of the bricks in voxels along each axis
+  size_t brick_size_;
+
+  /// Size of the volume the bricks were computed for
+  size_t nx_;
+  size_t ny_;
+  size_t nz_;
+
+  /// Range of the values in each brick. The minimum is larger than the maximum if the brick
+  /// does not contain any finite values.
+  std::vector< double > min_;
+  std::vector< double > max_;
+
+  /// Bins of the histogram of each brick, stored one brick after the other
+  std::vector< unsigned int > bins_;
+};
+
 class Histogram
 {
 
@@ -57,7 +92,8 @@ public:
   virtual ~Histogram();
   
   // COMPUTE:
-  /// Compute a histogram on an arbitrary size of data
+  /// Compute a histogram on an arbitrary size of data. The data is split over multiple threads
+  /// whose partial histograms are merged at the end.
   bool compute( const signed char* data, size_t size );
   bool compute( const unsigned char* data, size_t size );
   bool compute( const short* data, size_t size );
@@ -66,6 +102,20 @@ public:
   bool compute( const unsigned int* data, size_t size );
   bool compute( const float* data, size_t size );
   bool compute( const double* data, size_t size );
+
+  // COMPUTE:
+  /// Compute the histogram of a volume of nx by ny by nz values and record the contribution of
+  /// each brick of brick_size values along each axis. Bricks are numbered with x varying fastest.
+  bool compute( const void* data, DataType type, size_t nx, size_t ny, size_t nz, 
+    size_t brick_size, HistogramBricks& bricks );
+
+  // UPDATE:
+  /// Update the histogram of a volume of which only the given bricks changed. The contributions
+  /// of the changed bricks are subtracted and recomputed. If the range of the data changed, the
+  /// bins of all the bricks are computed again. The bricks need to come from an earlier call to
+  /// compute or update on the same volume.
+  bool update( const void* data, DataType type, size_t nx, size_t ny, size_t nz, 
+    const std::vector< size_t >& changed_bricks, HistogramBricks& bricks );
   
   // GET_MIN:
   /// Get the minimum value of the data
@@ -111,6 +161,18 @@ public:
   /// Check whther histogram is valid
   bool is_valid() const;
         
+private:
+  // COMPUTE_HISTOGRAM:
+  /// Compute the histogram of a volume in parallel. If bricks is given, the contribution of each
+  /// brick is recorded, and if changed_bricks is given too, only those bricks are recomputed.
+  template< class T >
+  bool compute_histogram( const T* data, size_t nx, size_t ny, size_t nz, 
+    HistogramBricks* bricks, const std::vector< size_t >* changed_bricks );
+
+  // RESET:
+  /// Mark the histogram as invalid
+  void reset();
+
 private:
   friend std::string ExportToString( const Histogram& value );
   friend bool ImportFromString( const std::string& str, Histogram& value );
@@ -0,0 +1,96 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// Boost includes
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// Core includes
+#include <Core/DataBlock/MappedDataBlock.h>
+
+namespace bip = boost::interprocess;
+
+namespace Core
+{
+
+class MappedDataBlockPrivate : public boost::noncopyable
+{
+public:
+  // The file that is mapped
+  bip::file_mapping file_;
+
+  // The part of the file that contains the data
+  bip::mapped_region region_;
+};
+
+
+MappedDataBlock::MappedDataBlock( size_t nx, size_t ny, size_t nz, DataType type ) :
+  private_( new MappedDataBlockPrivate )
+{
+  set_nx( nx );
+  set_ny( ny );
+  set_nz( nz );
+  set_type( type );
+}
+
+MappedDataBlock::~MappedDataBlock()
+{
+  // The memory is owned by the mapped region
+  set_data( 0 );
+}
+
+DataBlockHandle MappedDataBlock::New( const std::string& filename, size_t nx, size_t ny, 
+  size_t nz, DataType type, size_t offset )
+{
+  try
+  {
+    MappedDataBlockHandle data_block( new MappedDataBlock( nx, ny, nz, type ) );
+    size_t byte_size = data_block->get_byte_size();
+    if ( byte_size == 0 ) return DataBlockHandle();
+
+    // Accessing a mapped page beyond the end of the file is fatal, hence check the size first
+    if ( boost::filesystem::file_size( filename ) < offset + byte_size ) return DataBlockHandle();
+
+    // NOTE: mapped_region takes care of aligning the offset to the page boundaries
+    data_block->private_->file_ = bip::file_mapping( filename.c_str(), bip::read_only );
+    data_block->private_->region_ = bip::mapped_region( data_block->private_->file_, 
+      bip::copy_on_write, static_cast<bip::offset_t>( offset ), byte_size );
+    data_block->set_data( data_block->private_->region_.get_address() );
+
+    return data_block;
+  }
+  catch ( ... )
+  {
+    // Return an empty handle
+    DataBlockHandle data_block;
+    return data_block;
+  } 
+}
+
+} // end namespace Core
@@ -0,0 +1,76 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_MAPPEDDATABLOCK_H
+#define CORE_DATABLOCK_MAPPEDDATABLOCK_H
+
+// STL includes
+#include <string>
+
+// Core includes
+#include <Core/DataBlock/DataBlock.h>
+
+namespace Core
+{
+
+// Forward Declaration
+class MappedDataBlock;
+typedef boost::shared_ptr< MappedDataBlock > MappedDataBlockHandle;
+
+class MappedDataBlockPrivate;
+typedef boost::shared_ptr< MappedDataBlockPrivate > MappedDataBlockPrivateHandle;
+
+// CLASS MappedDataBlock
+/// A data block whose data is a memory mapped region of a file on disk. The file is mapped
+/// copy-on-write: the pages are shared with the page cache of the operating system until
+/// they are modified, and modifications are never written back to the file.
+class MappedDataBlock : public DataBlock
+{
+  // -- Constructor/destructor --
+private:
+  MappedDataBlock( size_t nx, size_t ny, size_t nz, DataType type );
+
+public:
+  virtual ~MappedDataBlock();
+
+  // -- Internal implementation of this class --
+private:
+  MappedDataBlockPrivateHandle private_;
+
+public:
+  // NEW: ( Factory constructor )
+  /// Map the file starting at offset. The file needs to contain at least nx * ny * nz samples
+  /// of the given data type after the offset. An empty handle is returned if the file could
+  /// not be mapped.
+  static DataBlockHandle New( const std::string& filename, size_t nx, size_t ny, size_t nz,
+    DataType type, size_t offset = 0 );
+};
+
+} // end namespace Core
+
+#endif
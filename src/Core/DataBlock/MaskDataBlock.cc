@@ -28,6 +28,7 @@
 
 #include <Core/DataBlock/MaskDataBlock.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/Utils/Exception.h>
 
 namespace Core
 {
@@ -39,11 +40,25 @@ MaskDataBlock::MaskDataBlock( DataBlockHandle data_block, unsigned int mask_bit
   data_block_( data_block ),
   mask_bit_( mask_bit ),
   mask_value_( 1 << mask_bit ),
-  not_mask_value_( ~( 1 << mask_bit ) ) 
+  not_mask_value_( ~( 1 << mask_bit ) ),
+  sparse_data_block_( 0 )
 {
   this->data_ = reinterpret_cast<unsigned char*>( this->data_block_->get_data() );
 }
 
+MaskDataBlock::MaskDataBlock( SparseMaskDataBlockHandle data_block ) :
+  nx_( data_block->get_nx() ),
+  ny_( data_block->get_ny() ),
+  nz_( data_block->get_nz() ),
+  data_block_( data_block ),
+  mask_bit_( 0 ),
+  mask_value_( 1 ),
+  not_mask_value_( ~1 ),
+  data_( 0 ),
+  sparse_data_block_( data_block.get() )
+{
+}
+
 MaskDataBlock::~MaskDataBlock()
 {
   MaskDataBlockManager::Instance()->release( data_block_, mask_bit_ );
@@ -51,9 +66,27 @@ MaskDataBlock::~MaskDataBlock()
 
 DataBlockHandle MaskDataBlock::get_data_block()
 {
+  if ( this->sparse_data_block_ != 0 ) this->expand();
   return this->data_block_;
 }
 
+DataBlockHandle MaskDataBlock::get_unexpanded_data_block() const
+{
+  return this->data_block_;
+}
+
+unsigned char* MaskDataBlock::expand()
+{
+  // NOTE: The sparse data block serializes concurrent expansions with the threads that read
+  // its chunks, hence the pointer is not cached in data_.
+  unsigned char* data = this->sparse_data_block_->expand();
+  if ( data == 0 )
+  {
+    CORE_THROW_EXCEPTION( "Could not allocate memory for the mask." );
+  }
+  return data;
+}
+
 DataBlock::generation_type MaskDataBlock::get_generation() const
 {
   return  this->data_block_->get_generation();
@@ -64,6 +97,11 @@ void MaskDataBlock::increase_generation()
   this->data_block_->increase_generation();
 }
 
+void MaskDataBlock::increase_generation( const IndexVector& min, const IndexVector& max )
+{
+  this->data_block_->increase_generation( min, max );
+}
+
 bool MaskDataBlock::extract_slice( SliceType type, 
   index_type index, MaskDataSliceHandle& slice  )
 {
@@ -369,7 +407,8 @@ bool MaskDataBlock::insert_slice( const MaskDataSliceHandle slice )
       }
 
       // Generate a new generation number for the new volume
-      this->increase_generation();
+      this->increase_generation( IndexVector( index, 0, 0 ), 
+        IndexVector( index, ny - 1, nz - 1 ) );
 
       return true;
     }
@@ -432,7 +471,8 @@ bool MaskDataBlock::insert_slice( const MaskDataSliceHandle slice )
       }
 
       // Generate a new generation number for the new volume
-      this->increase_generation();
+      this->increase_generation( IndexVector( 0, index, 0 ), 
+        IndexVector( nx - 1, index, nz - 1 ) );
 
       return true;
     }
@@ -495,7 +535,8 @@ bool MaskDataBlock::insert_slice( const MaskDataSliceHandle slice )
       }
       
       // Generate a new generation number for the new volume
-      this->increase_generation();
+      this->increase_generation( IndexVector( 0, 0, index ), 
+        IndexVector( nx - 1, ny - 1, index ) );
 
       return true;
     }
@@ -41,6 +41,7 @@
 #include <Core/DataBlock/MaskDataBlockFWD.h>
 #include <Core/DataBlock/MaskDataSlice.h>
 #include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/SparseMaskDataBlock.h>
 
 namespace Core
 {
@@ -52,6 +53,8 @@ namespace Core
 /// When a new datablock is created, it is checked whether a similar mask with
 /// the same dimensions exists with an unassigned bit and used if possible,
 /// otherwise a new one is generated.
+/// Masks can also be stored in a SparseMaskDataBlock of their own, which is expanded into
+/// dense data the first time the data of the mask is accessed directly.
 class MaskDataBlock : public boost::noncopyable, 
   public boost::enable_shared_from_this< MaskDataBlock >
 {
@@ -68,6 +71,7 @@ public:
   // -- Constructor/destructor --
 public:
   MaskDataBlock( DataBlockHandle data_block, unsigned int mask_bit );
+  explicit MaskDataBlock( SparseMaskDataBlockHandle data_block );
   virtual ~MaskDataBlock();
 
   // -- Access properties of data block --
@@ -107,11 +111,20 @@ public:
 
   // DATA
   /// Pointer to the block of data
+  /// NOTE: A sparse mask is expanded into dense data by this call
   inline unsigned char* get_mask_data()
   {
+    if ( this->sparse_data_block_ != 0 ) return this->expand();
     return  this->data_;
   }
 
+  // IS_SPARSE:
+  /// Whether the mask is stored in a sparse data block that has not been expanded yet
+  inline bool is_sparse() const
+  {
+    return this->sparse_data_block_ != 0 && !this->sparse_data_block_->is_expanded();
+  }
+
   // GET_MASK_BIT:
   /// Get the bit that describes the mask
   inline unsigned int get_mask_bit()
@@ -132,8 +145,14 @@ public:
   /// graphics card. As masks are shared the Texture will be shared
   /// hence access to the datablock is needed to see whether this one
   /// has already been uploaded
+  /// NOTE: A sparse mask is expanded into dense data by this call
   DataBlockHandle get_data_block();
 
+  // GET_UNEXPANDED_DATA_BLOCK
+  /// Retrieve the pointer to the data block without expanding a sparse mask. Only the
+  /// properties of the data block, such as its generation and change history, may be used.
+  DataBlockHandle get_unexpanded_data_block() const;
+
   // GET_GENERATION:
   /// Get the current generation number of the data volume.
   DataBlock::generation_type get_generation() const;
@@ -142,6 +161,11 @@ public:
   /// Increase the generation number to a new unique number.
   void increase_generation();
 
+  // INCREASE_GENERATION:
+  /// Increase the generation number to a new unique number and record that only the voxels
+  /// from min up to and including max have changed.
+  void increase_generation( const IndexVector& min, const IndexVector& max );
+
   // GET_MASK_AT:
   /// Get the mask value at a certain coordinate
   inline bool get_mask_at( size_t x, size_t y, size_t z ) const
@@ -160,6 +184,9 @@ public:
         return false;
     }
 
+    // A sparse mask is read from its chunks, or from its data once it has been expanded
+    if ( this->sparse_data_block_ != 0 ) return this->sparse_data_block_->get_mask_at( index );
+
     return ( this->data_[ index ] & this->mask_value_ ) != 0;
   }
 
@@ -174,7 +201,7 @@ public:
   /// Set the mask value at a certain index
   inline void set_mask_at( size_t index )
   {
-    this->data_[ index ] |= this->mask_value_;
+    this->get_mask_data()[ index ] |= this->mask_value_;
   }
   
   // Clear_MASK_AT:
@@ -186,7 +213,7 @@ public:
 
   inline void clear_mask_at( size_t index )
   {
-    this->data_[ index ] &= this->not_mask_value_;
+    this->get_mask_data()[ index ] &= this->not_mask_value_;
   }
 
 // -- Locking of the datablock --
@@ -221,6 +248,11 @@ public:
   bool extract_slice( SliceType type, index_type index, MaskDataSliceHandle& slice  );
 
   // -- internals of the DataBlock --
+private:
+  // EXPAND:
+  /// Expand a sparse mask into dense data and return a pointer to it
+  unsigned char* expand();
+
 private:
   /// The dimensions of the datablock
   size_t nx_;
@@ -237,9 +269,14 @@ private:
   const unsigned char mask_value_;
   const unsigned char not_mask_value_;
 
-  /// Cached data pointer of the underlying DataBlock
+  /// Cached data pointer of the underlying DataBlock. It is 0 for a sparse datablock, as its
+  /// data pointer is set when it is expanded and is only handed out by its expand function,
+  /// which serializes the expansion with the threads that read the mask.
   unsigned char* data_;
 
+  /// The datablock if it is a sparse datablock
+  SparseMaskDataBlock* const sparse_data_block_;
+
 };
 
 } // end namespace Core
@@ -31,16 +31,20 @@
 #endif
 
 // STL includes
+#include <algorithm>
 #include <bitset>
 
 // Boost includes
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 
 // Core includes
 #include <Core/Utils/Log.h>
 #include <Core/DataBlock/MaskDataBlockManager.h>
+#include <Core/DataBlock/MaskKernels.h>
 #include <Core/DataBlock/StdDataBlock.h>
 #include <Core/DataBlock/DataBlockManager.h>
+#include <Core/Utils/TaskScheduler.h>
 
 namespace Core
 {
@@ -53,14 +57,19 @@ CORE_SINGLETON_IMPLEMENTATION( MaskDataBlockManager );
 class MaskDataBlockEntry
 {
 public:
-  MaskDataBlockEntry( DataBlockHandle data_block, GridTransform grid_transform ) :
-    data_block_( data_block ), data_masks_( 8 ), grid_transform_( grid_transform )
+  MaskDataBlockEntry( DataBlockHandle data_block, GridTransform grid_transform, 
+    bool sparse = false ) :
+    data_block_( data_block ), sparse_( sparse ), data_masks_( 8 ), 
+    grid_transform_( grid_transform )
   {
   }
 
   // The datablock that holds the masks
   DataBlockHandle data_block_;
 
+  // Whether the datablock is a SparseMaskDataBlock, which only holds a single mask
+  bool sparse_;
+
   // Accounting which bits are used
   std::bitset< 8 > bits_used_;
 
@@ -107,7 +116,7 @@ bool MaskDataBlockManager::create( GridTransform grid_transform, MaskDataBlockHa
   for (size_t j=0; j<mask_list.size(); j++)
   {
     // Find an empty location
-    if ( ( mask_list[ j ].bits_used_.count() != 8 ) &&
+    if ( ( mask_list[ j ].bits_used_.count() != 8 ) && !mask_list[ j ].sparse_ &&
       ( grid_transform == mask_list[ j ].grid_transform_ ) )
     {
       data_block = mask_list[ j ].data_block_;
@@ -172,6 +181,22 @@ bool MaskDataBlockManager::create( GridTransform grid_transform, MaskDataBlockHa
   return true;
 }
 
+bool MaskDataBlockManager::create( GridTransform grid_transform, 
+  SparseMaskDataBlockHandle data_block, MaskDataBlockHandle& mask )
+{
+  lock_type lock( this->get_mutex() );
+
+  // A sparse data block is never shared with other masks
+  mask = MaskDataBlockHandle( new MaskDataBlock( data_block ) );
+
+  MaskDataBlockEntry entry( data_block, grid_transform, true );
+  entry.bits_used_[ 0 ] = 1;
+  entry.data_masks_[ 0 ] = mask;
+  this->private_->mask_list_.push_back( entry );
+
+  return true;
+}
+
 bool MaskDataBlockManager::create( DataBlock::generation_type generation, unsigned int bit, 
                   GridTransform& grid_transform, MaskDataBlockHandle& mask )
 {
@@ -258,40 +283,13 @@ bool MaskDataBlockManager::Create( GridTransform grid_transform, MaskDataBlockHa
 template< class T >
 bool ConvertToMaskInternal( DataBlockHandle data, MaskDataBlockHandle& mask, bool invert )
 {
-  T* data_ptr = reinterpret_cast<T*>( data->get_data() );
-  
+  const T* data_ptr = reinterpret_cast<T*>( data->get_data() );
   unsigned char* mask_ptr = mask->get_mask_data();
-  unsigned char mask_value;
-  unsigned char not_mask_value;
+  unsigned char mask_value = mask->get_mask_value();
 
-  if ( invert )
-  {
-    not_mask_value = mask->get_mask_value();
-    mask_value = ~( mask->get_mask_value() );
-  }
-  else
-  {
-    mask_value = mask->get_mask_value();
-    not_mask_value = ~( mask->get_mask_value() );
-  }
-  
-  size_t size = data->get_size();
-  size_t size8 = size & ~(0x7);
-  for ( size_t j = 0; j < size8; j+= 8 )
-  {
-    if ( data_ptr[ j ] ) mask_ptr[ j ] |= mask_value; else mask_ptr[ j ] &= not_mask_value;
-    if ( data_ptr[ j + 1 ] ) mask_ptr[ j + 1 ] |= mask_value; else mask_ptr[ j + 1 ] &= not_mask_value;
-    if ( data_ptr[ j + 2 ] ) mask_ptr[ j + 2 ] |= mask_value; else mask_ptr[ j + 2 ] &= not_mask_value;
-    if ( data_ptr[ j + 3 ] ) mask_ptr[ j + 3 ] |= mask_value; else mask_ptr[ j + 3 ] &= not_mask_value;
-    if ( data_ptr[ j + 4 ] ) mask_ptr[ j + 4 ] |= mask_value; else mask_ptr[ j + 4 ] &= not_mask_value;
-    if ( data_ptr[ j + 5 ] ) mask_ptr[ j + 5 ] |= mask_value; else mask_ptr[ j + 5 ] &= not_mask_value;
-    if ( data_ptr[ j + 6 ] ) mask_ptr[ j + 6 ] |= mask_value; else mask_ptr[ j + 6 ] &= not_mask_value;
-    if ( data_ptr[ j + 7 ] ) mask_ptr[ j + 7 ] |= mask_value; else mask_ptr[ j + 7 ] &= not_mask_value;
-  }
-  for ( size_t j = size8; j < size; j++ )
-  {
-    if ( data_ptr[ j ] ) mask_ptr[ j ] |= mask_value; else mask_ptr[ j ] &= not_mask_value; 
-  }
+  ParallelFor( 0, data->get_size(), boost::bind( 
+    &ConvertDataToMaskBits< T, NonZeroPredicate< T > >, data_ptr, NonZeroPredicate< T >(), 
+    invert, mask_ptr, mask_value, _1, _2 ), MASK_KERNEL_GRAIN_SIZE_C );
   
   return true;
 }
@@ -339,52 +337,14 @@ bool MaskDataBlockManager::Convert( DataBlockHandle data,
 template< class T >
 bool ConvertToMaskLargerThanInternal( DataBlockHandle data, MaskDataBlockHandle& mask, bool invert )
 {
-  T* data_ptr = reinterpret_cast<T*>( data->get_data() );
-  
+  const T* data_ptr = reinterpret_cast<T*>( data->get_data() );
   unsigned char* mask_ptr = mask->get_mask_data();
-  unsigned char mask_value;
-  unsigned char not_mask_value;
+  unsigned char mask_value = mask->get_mask_value();
 
-  if ( invert )
-  {
-    not_mask_value = mask->get_mask_value();
-    mask_value = ~( mask->get_mask_value() );
-  }
-  else
-  {
-    mask_value = mask->get_mask_value();
-    not_mask_value = ~( mask->get_mask_value() );
-  }
-  
-  size_t size = data->get_size();
-  size_t size8 = size & ~(0x7);
-  
-  T zero = T( 0 );
-  
-  for ( size_t j = 0; j < size8; j+= 8 )
-  {
-    if ( data_ptr[ j ] > zero ) 
-      mask_ptr[ j ] |= mask_value; else mask_ptr[ j ] &= not_mask_value;
-    if ( data_ptr[ j + 1 ] > zero ) 
-      mask_ptr[ j + 1 ] |= mask_value; else mask_ptr[ j + 1 ] &= not_mask_value;
-    if ( data_ptr[ j + 2 ] > zero ) 
-      mask_ptr[ j + 2 ] |= mask_value; else mask_ptr[ j + 2 ] &= not_mask_value;
-    if ( data_ptr[ j + 3 ] > zero ) 
-      mask_ptr[ j + 3 ] |= mask_value; else mask_ptr[ j + 3 ] &= not_mask_value;
-    if ( data_ptr[ j + 4 ] > zero ) 
-      mask_ptr[ j + 4 ] |= mask_value; else mask_ptr[ j + 4 ] &= not_mask_value;
-    if ( data_ptr[ j + 5 ] > zero ) 
-      mask_ptr[ j + 5 ] |= mask_value; else mask_ptr[ j + 5 ] &= not_mask_value;
-    if ( data_ptr[ j + 6 ] > zero ) 
-      mask_ptr[ j + 6 ] |= mask_value; else mask_ptr[ j + 6 ] &= not_mask_value;
-    if ( data_ptr[ j + 7 ] > zero ) 
-      mask_ptr[ j + 7 ] |= mask_value; else mask_ptr[ j + 7 ] &= not_mask_value;
-  }
-  for ( size_t j = size8; j < size; j++ )
-  {
-    if ( data_ptr[ j ] > zero )
-      mask_ptr[ j ] |= mask_value; else mask_ptr[ j ] &= not_mask_value;  
-  }
+  ParallelFor( 0, data->get_size(), boost::bind( 
+    &ConvertDataToMaskBits< T, LargerThanZeroPredicate< T > >, data_ptr, 
+    LargerThanZeroPredicate< T >(), invert, mask_ptr, mask_value, _1, _2 ), 
+    MASK_KERNEL_GRAIN_SIZE_C );
   
   return true;
 }
@@ -433,38 +393,14 @@ template< class T >
 bool ConvertLabelToMaskInternal( DataBlockHandle data, MaskDataBlockHandle& mask, double label )
 {
   T typed_label = static_cast<T>( label );
-  T* data_ptr = reinterpret_cast<T*>( data->get_data() );
-  
+  const T* data_ptr = reinterpret_cast<T*>( data->get_data() );
   unsigned char* mask_ptr = mask->get_mask_data();
   unsigned char mask_value = mask->get_mask_value();
-  unsigned char not_mask_value = ~( mask->get_mask_value() );
-  
-  size_t size = data->get_size();
-  size_t size8 = size & ~(0x7);
-  for ( size_t j = 0; j < size8; j+= 8 )
-  {
-    if ( data_ptr[ j ] == typed_label ) mask_ptr[ j ] |= mask_value; 
-      else mask_ptr[ j ] &= not_mask_value;
-    if ( data_ptr[ j + 1 ] == typed_label ) mask_ptr[ j + 1 ] |= mask_value;
-      else mask_ptr[ j + 1 ] &= not_mask_value;
-    if ( data_ptr[ j + 2 ] == typed_label ) mask_ptr[ j + 2 ] |= mask_value; 
-      else mask_ptr[ j + 2 ] &= not_mask_value;
-    if ( data_ptr[ j + 3 ] == typed_label ) mask_ptr[ j + 3 ] |= mask_value; 
-      else mask_ptr[ j + 3 ] &= not_mask_value;
-    if ( data_ptr[ j + 4 ] == typed_label ) mask_ptr[ j + 4 ] |= mask_value; 
-      else mask_ptr[ j + 4 ] &= not_mask_value;
-    if ( data_ptr[ j + 5 ] == typed_label ) mask_ptr[ j + 5 ] |= mask_value; 
-      else mask_ptr[ j + 5 ] &= not_mask_value;
-    if ( data_ptr[ j + 6 ] == typed_label ) mask_ptr[ j + 6 ] |= mask_value; 
-      else mask_ptr[ j + 6 ] &= not_mask_value;
-    if ( data_ptr[ j + 7 ] == typed_label ) mask_ptr[ j + 7 ] |= mask_value; 
-      else mask_ptr[ j + 7 ] &= not_mask_value;
-  }
-  for ( size_t j = size8; j < size; j++ )
-  {
-    if ( data_ptr[ j ] == typed_label ) mask_ptr[ j ] |= mask_value; 
-      else mask_ptr[ j ] &= not_mask_value; 
-  }
+
+  ParallelFor( 0, data->get_size(), boost::bind( 
+    &ConvertDataToMaskBits< T, EqualsPredicate< T > >, data_ptr, 
+    EqualsPredicate< T >( typed_label ), false, mask_ptr, mask_value, _1, _2 ), 
+    MASK_KERNEL_GRAIN_SIZE_C );
   
   return true;
 }
@@ -523,24 +459,9 @@ bool ConvertLabelToDataInternal( MaskDataBlockHandle mask, DataBlockHandle& data
   
   const T on = static_cast<T>( label );
   const T off = static_cast<T>( 0 );
-  size_t size = data->get_size();
-  size_t size8 = size & ~(0x7);
 
-  for ( size_t j = 0; j < size8; j+= 8 )
-  {
-    if ( mask_ptr[ j ] & mask_value ) data_ptr[ j ] = on; else data_ptr[ j ] = off;
-    if ( mask_ptr[ j + 1 ] & mask_value ) data_ptr[ j + 1 ] = on; else data_ptr[ j + 1 ] = off;
-    if ( mask_ptr[ j + 2 ] & mask_value ) data_ptr[ j + 2 ] = on; else data_ptr[ j + 2 ] = off;
-    if ( mask_ptr[ j + 3 ] & mask_value ) data_ptr[ j + 3 ] = on; else data_ptr[ j + 3 ] = off;
-    if ( mask_ptr[ j + 4 ] & mask_value ) data_ptr[ j + 4 ] = on; else data_ptr[ j + 4 ] = off;
-    if ( mask_ptr[ j + 5 ] & mask_value ) data_ptr[ j + 5 ] = on; else data_ptr[ j + 5 ] = off;
-    if ( mask_ptr[ j + 6 ] & mask_value ) data_ptr[ j + 6 ] = on; else data_ptr[ j + 6 ] = off;
-    if ( mask_ptr[ j + 7 ] & mask_value ) data_ptr[ j + 7 ] = on; else data_ptr[ j + 7 ] = off;
-  }
-  for ( size_t j = size8; j < size; j++ )
-  {
-    if ( mask_ptr[ j ] & mask_value ) data_ptr[ j ] = on; else data_ptr[ j ] = off;
-  }
+  ParallelFor( 0, data->get_size(), boost::bind( &ConvertMaskBitsToData< T >, mask_ptr, 
+    mask_value, data_ptr, on, off, _1, _2 ), MASK_KERNEL_GRAIN_SIZE_C );
 
   return true;
 }
@@ -584,24 +505,9 @@ bool ConvertToDataInternal( MaskDataBlockHandle mask, DataBlockHandle& data, boo
   
   const T on = static_cast<T>( invert?0:1 );
   const T off = static_cast<T>( invert?1:0 );
-  size_t size = data->get_size();
-  size_t size8 = size & ~(0x7);
 
-  for ( size_t j = 0; j < size8; j+= 8 )
-  {
-    if ( mask_ptr[ j ] & mask_value ) data_ptr[ j ] = on; else data_ptr[ j ] = off;
-    if ( mask_ptr[ j + 1 ] & mask_value ) data_ptr[ j + 1 ] = on; else data_ptr[ j + 1 ] = off;
-    if ( mask_ptr[ j + 2 ] & mask_value ) data_ptr[ j + 2 ] = on; else data_ptr[ j + 2 ] = off;
-    if ( mask_ptr[ j + 3 ] & mask_value ) data_ptr[ j + 3 ] = on; else data_ptr[ j + 3 ] = off;
-    if ( mask_ptr[ j + 4 ] & mask_value ) data_ptr[ j + 4 ] = on; else data_ptr[ j + 4 ] = off;
-    if ( mask_ptr[ j + 5 ] & mask_value ) data_ptr[ j + 5 ] = on; else data_ptr[ j + 5 ] = off;
-    if ( mask_ptr[ j + 6 ] & mask_value ) data_ptr[ j + 6 ] = on; else data_ptr[ j + 6 ] = off;
-    if ( mask_ptr[ j + 7 ] & mask_value ) data_ptr[ j + 7 ] = on; else data_ptr[ j + 7 ] = off;
-  }
-  for ( size_t j = size8; j < size; j++ )
-  {
-    if ( mask_ptr[ j ] & mask_value ) data_ptr[ j ] = on; else data_ptr[ j ] = off;
-  }
+  ParallelFor( 0, data->get_size(), boost::bind( &ConvertMaskBitsToData< T >, mask_ptr, 
+    mask_value, data_ptr, on, off, _1, _2 ), MASK_KERNEL_GRAIN_SIZE_C );
 
   return true;
 }
@@ -788,29 +694,29 @@ static bool CreateMaskFromBitPlaneDataInternal( const DataBlockHandle& data,
 
   std::bitset< sizeof( DATA ) * 8 > bits( used_bits );
 
+  // Each bitplane is extracted into the same scratch buffer and stored in a sparse mask, 
+  // hence only the bitplanes that are used later on are expanded into dense masks
+  std::vector< unsigned char > mask_data( size );
+
   for ( size_t k = 0; k < bits.size(); k++ )
   {
     if ( bits[ k ] )
     {
-      MaskDataBlockHandle mask;
-      if ( ! ( MaskDataBlockManager::Instance()->create( grid_transform, mask ) ) )
-      {
-        masks.clear();
-        return false;
-      }
-
-      MaskDataBlock::lock_type lock( mask->get_mutex() );
-
-      unsigned char* mask_data  = mask->get_mask_data();
-      unsigned char  mask_value = mask->get_mask_value();
-      unsigned char  not_mask_value = ~( mask->get_mask_value() );
-
       DATA test_value( 1 << k );
 
       for ( size_t j = 0; j < size; j++ )
       {
-        if ( src[ j ] & test_value ) mask_data[ j ] |= mask_value;
-        else mask_data[ j ] &= not_mask_value;
+        mask_data[ j ] = ( src[ j ] & test_value ) ? 1 : 0;
+      }
+
+      MaskDataBlockHandle mask;
+      SparseMaskDataBlockHandle sparse_data_block = SparseMaskDataBlock::New( &mask_data[ 0 ], 1,
+        data->get_nx(), data->get_ny(), data->get_nz() );
+      if ( ! ( MaskDataBlockManager::Instance()->create( grid_transform, sparse_data_block, 
+        mask ) ) )
+      {
+        masks.clear();
+        return false;
       }
 
       masks.push_back( mask );
@@ -864,6 +770,11 @@ static bool CreateMaskFromLabelDataInternal( const DataBlockHandle& data,
   DATA label( 0 );
   DATA zero_label( 0 );
 
+  // Each label is extracted into the same scratch buffer and stored in a sparse mask, as most
+  // labels only cover a small part of the volume
+  std::vector< unsigned char > mask_data( size, 0 );
+  size_t label_start = 0;
+
   size_t next_label_index = 0;
   while ( next_label_index < size && masks.size() < 32 )
   {
@@ -876,35 +787,35 @@ static bool CreateMaskFromLabelDataInternal( const DataBlockHandle& data,
 
     if ( next_label_index < size )
     {
-      MaskDataBlockHandle mask;
-      if ( ! ( MaskDataBlockManager::Instance()->create( grid_transform, mask) ) )
-      {
-        masks.clear();
-        return false;
-      }
-
-      unsigned char* mask_data  = mask->get_mask_data();
-      unsigned char  mask_value = mask->get_mask_value();
-      unsigned char  not_mask_value = ~( mask->get_mask_value() );
       label = src[ next_label_index ];
 
-      // Lock the mask layer as it may contain additional masks that are currently in use
-      // Hence we need to have full access
-      MaskDataBlock::lock_type mask_lock( mask->get_mutex() );
+      // Clear the voxels that the previous label set before this one starts
+      std::fill( mask_data.begin() + label_start, mask_data.begin() + next_label_index, 0 );
+      label_start = next_label_index;
 
       for ( size_t j = next_label_index; j < size; j++ )
       {
         if ( src[ j ] == label ) 
         {
           src[ j ] = zero_label;
-          mask_data[ j ] |= mask_value;
+          mask_data[ j ] = 1;
         }
         else
         {
-          mask_data[ j ] &= not_mask_value;
+          mask_data[ j ] = 0;
         }
       }
 
+      MaskDataBlockHandle mask;
+      SparseMaskDataBlockHandle sparse_data_block = SparseMaskDataBlock::New( &mask_data[ 0 ], 1,
+        data->get_nx(), data->get_ny(), data->get_nz() );
+      if ( ! ( MaskDataBlockManager::Instance()->create( grid_transform, sparse_data_block, 
+        mask ) ) )
+      {
+        masks.clear();
+        return false;
+      }
+
       masks.push_back( mask );    
     }
   }
@@ -957,47 +868,10 @@ bool InscribeInternal( MaskDataBlockHandle mask, DataBlockHandle data, double la
   unsigned char mask_value = mask->get_mask_value();
   
   T* data_ptr = reinterpret_cast< T* >( data->get_data() );
-  
   const T label_value = static_cast<T>( label );
-  size_t size = data->get_size();
-  size_t size8 = size & ~(0x7);
 
-  if ( invert )
-  {
-    for ( size_t j = 0; j < size8; j+= 8 )
-    {
-      if ( !( mask_ptr[ j ] & mask_value ) ) data_ptr[ j ] = label_value;
-      if ( !( mask_ptr[ j + 1 ] & mask_value ) ) data_ptr[ j + 1 ] = label_value;
-      if ( !( mask_ptr[ j + 2 ] & mask_value ) ) data_ptr[ j + 2 ] = label_value;
-      if ( !( mask_ptr[ j + 3 ] & mask_value ) ) data_ptr[ j + 3 ] = label_value;
-      if ( !( mask_ptr[ j + 4 ] & mask_value ) ) data_ptr[ j + 4 ] = label_value;
-      if ( !( mask_ptr[ j + 5 ] & mask_value ) ) data_ptr[ j + 5 ] = label_value;
-      if ( !( mask_ptr[ j + 6 ] & mask_value ) ) data_ptr[ j + 6 ] = label_value;
-      if ( !( mask_ptr[ j + 7 ] & mask_value ) ) data_ptr[ j + 7 ] = label_value;
-    }
-    for ( size_t j = size8; j < size; j++ )
-    {
-      if ( !( mask_ptr[ j ] & mask_value ) ) data_ptr[ j ] = label_value;
-    } 
-  }
-  else
-  {
-    for ( size_t j = 0; j < size8; j+= 8 )
-    {
-      if ( mask_ptr[ j ] & mask_value ) data_ptr[ j ] = label_value;
-      if ( mask_ptr[ j + 1 ] & mask_value ) data_ptr[ j + 1 ] = label_value;
-      if ( mask_ptr[ j + 2 ] & mask_value ) data_ptr[ j + 2 ] = label_value;
-      if ( mask_ptr[ j + 3 ] & mask_value ) data_ptr[ j + 3 ] = label_value;
-      if ( mask_ptr[ j + 4 ] & mask_value ) data_ptr[ j + 4 ] = label_value;
-      if ( mask_ptr[ j + 5 ] & mask_value ) data_ptr[ j + 5 ] = label_value;
-      if ( mask_ptr[ j + 6 ] & mask_value ) data_ptr[ j + 6 ] = label_value;
-      if ( mask_ptr[ j + 7 ] & mask_value ) data_ptr[ j + 7 ] = label_value;
-    }
-    for ( size_t j = size8; j < size; j++ )
-    {
-      if ( mask_ptr[ j ] & mask_value ) data_ptr[ j ] = label_value;
-    }
-  }
+  ParallelFor( 0, data->get_size(), boost::bind( &FillMaskedData< T >, mask_ptr, mask_value, 
+    invert, data_ptr, label_value, _1, _2 ), MASK_KERNEL_GRAIN_SIZE_C );
   
   return true;
 }
@@ -47,6 +47,7 @@
 #include <Core/Geometry/GridTransform.h>
 #include <Core/DataBlock/DataBlock.h>
 #include <Core/DataBlock/MaskDataBlock.h>
+#include <Core/DataBlock/SparseMaskDataBlock.h>
 
 // Application includes
 #include <Application/Layer/LayerFWD.h>
@@ -78,6 +79,12 @@ public:
   /// Create a new mask layer
   bool create( GridTransform grid_transform, MaskDataBlockHandle& mask );
 
+  // CREATE:
+  /// Create a new mask that is stored in a sparse data block. The data block is not shared
+  /// with other masks and is only expanded into dense data when the mask data is accessed.
+  bool create( GridTransform grid_transform, SparseMaskDataBlockHandle data_block,
+    MaskDataBlockHandle& mask );
+
   // CREATE:
   /// Create a new mask layer with a given generation number and bit
   bool create( DataBlock::generation_type generation, unsigned int bit, 
@@ -0,0 +1,256 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// Core includes
+#include <Core/DataBlock/MaskKernels.h>
+
+// NOTE: The instruction set is chosen when compiling, AVX2 is used when the compiler targets
+// it (-mavx2 or /arch:AVX2), SSE2 is available on every 64 bit x86 processor. Other
+// processors use the scalar loops, which handle the remainders of the vector loops as well.
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#define MASK_KERNELS_AVX2
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define MASK_KERNELS_SSE2
+#endif
+
+namespace Core
+{
+
+#if defined( MASK_KERNELS_AVX2 )
+
+// Thin wrappers around the intrinsics, so that the kernels are written only once
+typedef __m256i MaskVector;
+static const size_t MASK_VECTOR_SIZE_C = 32;
+
+static inline MaskVector MaskVectorLoad( const unsigned char* ptr ) 
+  { return _mm256_loadu_si256( reinterpret_cast< const __m256i* >( ptr ) ); }
+static inline void MaskVectorStore( unsigned char* ptr, MaskVector v ) 
+  { _mm256_storeu_si256( reinterpret_cast< __m256i* >( ptr ), v ); }
+static inline MaskVector MaskVectorSet( unsigned char value ) 
+  { return _mm256_set1_epi8( static_cast< char >( value ) ); }
+static inline MaskVector MaskVectorZero() { return _mm256_setzero_si256(); }
+static inline MaskVector MaskVectorAnd( MaskVector a, MaskVector b ) 
+  { return _mm256_and_si256( a, b ); }
+static inline MaskVector MaskVectorAndNot( MaskVector a, MaskVector b ) 
+  { return _mm256_andnot_si256( a, b ); }
+static inline MaskVector MaskVectorOr( MaskVector a, MaskVector b ) 
+  { return _mm256_or_si256( a, b ); }
+static inline MaskVector MaskVectorXor( MaskVector a, MaskVector b ) 
+  { return _mm256_xor_si256( a, b ); }
+static inline MaskVector MaskVectorIsZero( MaskVector a ) 
+  { return _mm256_cmpeq_epi8( a, _mm256_setzero_si256() ); }
+static inline unsigned int MaskVectorMoveMask( MaskVector a ) 
+  { return static_cast< unsigned int >( _mm256_movemask_epi8( a ) ); }
+
+#elif defined( MASK_KERNELS_SSE2 )
+
+typedef __m128i MaskVector;
+static const size_t MASK_VECTOR_SIZE_C = 16;
+
+static inline MaskVector MaskVectorLoad( const unsigned char* ptr ) 
+  { return _mm_loadu_si128( reinterpret_cast< const __m128i* >( ptr ) ); }
+static inline void MaskVectorStore( unsigned char* ptr, MaskVector v ) 
+  { _mm_storeu_si128( reinterpret_cast< __m128i* >( ptr ), v ); }
+static inline MaskVector MaskVectorSet( unsigned char value ) 
+  { return _mm_set1_epi8( static_cast< char >( value ) ); }
+static inline MaskVector MaskVectorZero() { return _mm_setzero_si128(); }
+static inline MaskVector MaskVectorAnd( MaskVector a, MaskVector b ) 
+  { return _mm_and_si128( a, b ); }
+static inline MaskVector MaskVectorAndNot( MaskVector a, MaskVector b ) 
+  { return _mm_andnot_si128( a, b ); }
+static inline MaskVector MaskVectorOr( MaskVector a, MaskVector b ) 
+  { return _mm_or_si128( a, b ); }
+static inline MaskVector MaskVectorXor( MaskVector a, MaskVector b ) 
+  { return _mm_xor_si128( a, b ); }
+static inline MaskVector MaskVectorIsZero( MaskVector a ) 
+  { return _mm_cmpeq_epi8( a, _mm_setzero_si128() ); }
+static inline unsigned int MaskVectorMoveMask( MaskVector a ) 
+  { return static_cast< unsigned int >( _mm_movemask_epi8( a ) ); }
+
+#endif
+
+#if defined( MASK_KERNELS_AVX2 ) || defined( MASK_KERNELS_SSE2 )
+#define MASK_KERNELS_VECTORIZED
+
+// POPCOUNT:
+/// Count the bits set in a move mask
+static inline size_t PopCount( unsigned int bits )
+{
+  size_t count = 0;
+  while ( bits )
+  {
+    bits &= bits - 1;
+    count++;
+  }
+  return count;
+}
+#endif
+
+template< int OPERATOR >
+static inline bool CombineScalar( bool a, bool b )
+{
+  switch ( OPERATOR )
+  {
+  case MaskOperator::AND_E:
+    return a && b;
+  case MaskOperator::OR_E:
+    return a || b;
+  case MaskOperator::XOR_E:
+    return a != b;
+  default:
+    return a && !b;
+  }
+}
+
+#if defined( MASK_KERNELS_VECTORIZED )
+// NOTE: The arguments are all ones for the voxels that are not in the masks and zero for the
+// ones that are, as that is what the compare instruction gives.
+template< int OPERATOR >
+static inline MaskVector CombineVector( MaskVector not_a, MaskVector not_b )
+{
+  switch ( OPERATOR )
+  {
+  case MaskOperator::AND_E:
+    return MaskVectorXor( MaskVectorOr( not_a, not_b ), MaskVectorSet( 0xff ) );
+  case MaskOperator::OR_E:
+    return MaskVectorXor( MaskVectorAnd( not_a, not_b ), MaskVectorSet( 0xff ) );
+  case MaskOperator::XOR_E:
+    return MaskVectorXor( not_a, not_b );
+  default:
+    return MaskVectorAndNot( not_a, not_b );
+  }
+}
+#endif
+
+template< int OPERATOR >
+static void CombineMaskBitsInternal( const unsigned char* src1, unsigned char value1, 
+  const unsigned char* src2, unsigned char value2, unsigned char* dst, unsigned char dst_value,
+  size_t begin, size_t end )
+{
+  size_t j = begin;
+#if defined( MASK_KERNELS_VECTORIZED )
+  const MaskVector vector_value1 = MaskVectorSet( value1 );
+  const MaskVector vector_value2 = MaskVectorSet( value2 );
+  const MaskVector vector_dst_value = MaskVectorSet( dst_value );
+  for ( ; j + MASK_VECTOR_SIZE_C <= end; j += MASK_VECTOR_SIZE_C )
+  {
+    MaskVector not_a = MaskVectorIsZero( MaskVectorAnd( MaskVectorLoad( src1 + j ), 
+      vector_value1 ) );
+    MaskVector not_b = MaskVectorIsZero( MaskVectorAnd( MaskVectorLoad( src2 + j ), 
+      vector_value2 ) );
+    MaskVector result = MaskVectorAnd( CombineVector< OPERATOR >( not_a, not_b ), 
+      vector_dst_value );
+    // NOTE: The destination is loaded after the sources, as it may be the same memory
+    MaskVectorStore( dst + j, MaskVectorOr( MaskVectorLoad( dst + j ), result ) );
+  }
+#endif
+  for ( ; j < end; j++ )
+  {
+    if ( CombineScalar< OPERATOR >( ( src1[ j ] & value1 ) != 0, ( src2[ j ] & value2 ) != 0 ) )
+    {
+      dst[ j ] |= dst_value;
+    }
+  }
+}
+
+void CombineMaskBits( MaskOperator op, const unsigned char* src1, unsigned char value1, 
+  const unsigned char* src2, unsigned char value2, unsigned char* dst, unsigned char dst_value,
+  size_t begin, size_t end )
+{
+  switch ( op )
+  {
+  case MaskOperator::AND_E:
+    CombineMaskBitsInternal< MaskOperator::AND_E >( src1, value1, src2, value2, 
+      dst, dst_value, begin, end );
+    break;
+  case MaskOperator::OR_E:
+    CombineMaskBitsInternal< MaskOperator::OR_E >( src1, value1, src2, value2, 
+      dst, dst_value, begin, end );
+    break;
+  case MaskOperator::XOR_E:
+    CombineMaskBitsInternal< MaskOperator::XOR_E >( src1, value1, src2, value2, 
+      dst, dst_value, begin, end );
+    break;
+  case MaskOperator::REMOVE_E:
+    CombineMaskBitsInternal< MaskOperator::REMOVE_E >( src1, value1, src2, value2, 
+      dst, dst_value, begin, end );
+    break;
+  }
+}
+
+size_t ReadMaskBits( const unsigned char* mask, unsigned char mask_value, bool invert,
+  unsigned char* selection, size_t size )
+{
+  size_t count = 0;
+  size_t j = 0;
+#if defined( MASK_KERNELS_VECTORIZED )
+  const MaskVector vector_mask_value = MaskVectorSet( mask_value );
+  const MaskVector one = MaskVectorSet( 1 );
+  // All ones for the voxels that are not selected
+  const MaskVector flip = invert ? MaskVectorSet( 0xff ) : MaskVectorZero();
+  for ( ; j + MASK_VECTOR_SIZE_C <= size; j += MASK_VECTOR_SIZE_C )
+  {
+    MaskVector not_selected = MaskVectorXor( MaskVectorIsZero( MaskVectorAnd( 
+      MaskVectorLoad( mask + j ), vector_mask_value ) ), flip );
+    MaskVectorStore( selection + j, MaskVectorAndNot( not_selected, one ) );
+    count += MASK_VECTOR_SIZE_C - PopCount( MaskVectorMoveMask( not_selected ) );
+  }
+#endif
+  for ( ; j < size; j++ )
+  {
+    unsigned char selected = ( ( mask[ j ] & mask_value ) != 0 ) != invert ? 1 : 0;
+    selection[ j ] = selected;
+    count += selected;
+  }
+  return count;
+}
+
+void WriteMaskBits( const unsigned char* selection, unsigned char* mask, 
+  unsigned char mask_value, size_t size )
+{
+  size_t j = 0;
+#if defined( MASK_KERNELS_VECTORIZED )
+  const MaskVector vector_mask_value = MaskVectorSet( mask_value );
+  for ( ; j + MASK_VECTOR_SIZE_C <= size; j += MASK_VECTOR_SIZE_C )
+  {
+    MaskVector not_selected = MaskVectorIsZero( MaskVectorLoad( selection + j ) );
+    MaskVector bits = MaskVectorAndNot( not_selected, vector_mask_value );
+    MaskVector other_bits = MaskVectorAndNot( vector_mask_value, MaskVectorLoad( mask + j ) );
+    MaskVectorStore( mask + j, MaskVectorOr( other_bits, bits ) );
+  }
+#endif
+  const unsigned char not_mask_value = ~mask_value;
+  for ( ; j < size; j++ )
+  {
+    if ( selection[ j ] ) mask[ j ] |= mask_value; else mask[ j ] &= not_mask_value;
+  }
+}
+
+} // end namespace Core
@@ -0,0 +1,190 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_MASKKERNELS_H
+#define CORE_DATABLOCK_MASKKERNELS_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <algorithm>
+#include <cstddef>
+
+// Core includes
+#include <Core/Utils/EnumClass.h>
+
+namespace Core
+{
+
+// CLASS MaskOperator:
+/// The boolean operators that combine two masks
+
+CORE_ENUM_CLASS
+(
+  MaskOperator,
+  AND_E,
+  OR_E,
+  XOR_E,
+  // Voxels in the first mask that are not in the second one
+  REMOVE_E
+)
+
+// MASK_KERNEL_BLOCK_SIZE_C:
+/// The number of voxels the typed kernels handle at once
+const size_t MASK_KERNEL_BLOCK_SIZE_C = 1024;
+
+// MASK_KERNEL_GRAIN_SIZE_C:
+/// The number of voxels that are worth handing to a worker thread
+const size_t MASK_KERNEL_GRAIN_SIZE_C = 1 << 18;
+
+// COMBINEMASKBITS:
+/// Set dst_value in dst for the voxels in [begin, end) for which the operator is true for
+/// the two source masks. The other bits in dst are left alone, hence dst can share its
+/// buffer with the sources.
+void CombineMaskBits( MaskOperator op, const unsigned char* src1, unsigned char value1, 
+  const unsigned char* src2, unsigned char value2, unsigned char* dst, unsigned char dst_value,
+  size_t begin, size_t end );
+
+// READMASKBITS:
+/// Write 1 into selection for the size voxels that have mask_value set, or not set if invert
+/// is true, and 0 for the others. Returns the number of selected voxels.
+size_t ReadMaskBits( const unsigned char* mask, unsigned char mask_value, bool invert,
+  unsigned char* selection, size_t size );
+
+// WRITEMASKBITS:
+/// Set mask_value for the size voxels that have a non zero selection and clear it for the
+/// others. The other bits in the mask are left alone.
+void WriteMaskBits( const unsigned char* selection, unsigned char* mask, 
+  unsigned char mask_value, size_t size );
+
+// PREDICATES:
+/// Predicates that are used for converting data into masks
+
+template< class T >
+class NonZeroPredicate
+{
+public:
+  bool operator()( T value ) const { return value != T( 0 ); }
+};
+
+template< class T >
+class LargerThanZeroPredicate
+{
+public:
+  bool operator()( T value ) const { return value > T( 0 ); }
+};
+
+template< class T >
+class EqualsPredicate
+{
+public:
+  explicit EqualsPredicate( T label ) : label_( label ) {}
+  bool operator()( T value ) const { return value == this->label_; }
+private:
+  T label_;
+};
+
+// CONVERTDATATOMASKBITS:
+/// Set mask_value for the voxels in [begin, end) for which the predicate is true, or false if
+/// invert is true, and clear it for the others.
+template< class T, class PREDICATE >
+void ConvertDataToMaskBits( const T* data, PREDICATE predicate, bool invert, 
+  unsigned char* mask, unsigned char mask_value, size_t begin, size_t end )
+{
+  unsigned char selection[ MASK_KERNEL_BLOCK_SIZE_C ];
+  const unsigned char flip = invert ? 1 : 0;
+  for ( size_t j = begin; j < end; j += MASK_KERNEL_BLOCK_SIZE_C )
+  {
+    size_t size = std::min( end - j, MASK_KERNEL_BLOCK_SIZE_C );
+    // NOTE: This loop has no branches, so the compiler can vectorize it
+    const T* block = data + j;
+    for ( size_t k = 0; k < size; k++ )
+    {
+      selection[ k ] = static_cast< unsigned char >( predicate( block[ k ] ) ) ^ flip;
+    }
+    WriteMaskBits( selection, mask + j, mask_value, size );
+  }
+}
+
+// CONVERTMASKBITSTODATA:
+/// Set the voxels in [begin, end) to on where mask_value is set and to off elsewhere.
+template< class T >
+void ConvertMaskBitsToData( const unsigned char* mask, unsigned char mask_value, 
+  T* data, T on, T off, size_t begin, size_t end )
+{
+  unsigned char selection[ MASK_KERNEL_BLOCK_SIZE_C ];
+  for ( size_t j = begin; j < end; j += MASK_KERNEL_BLOCK_SIZE_C )
+  {
+    size_t size = std::min( end - j, MASK_KERNEL_BLOCK_SIZE_C );
+    size_t count = ReadMaskBits( mask + j, mask_value, false, selection, size );
+    T* block = data + j;
+    if ( count == 0 )
+    {
+      std::fill( block, block + size, off );
+    }
+    else if ( count == size )
+    {
+      std::fill( block, block + size, on );
+    }
+    else
+    {
+      for ( size_t k = 0; k < size; k++ ) block[ k ] = selection[ k ] ? on : off;
+    }
+  }
+}
+
+// FILLMASKEDDATA:
+/// Set the voxels in [begin, end) that have mask_value set, or not set if invert is true, 
+/// to value. The other voxels are left alone.
+template< class T >
+void FillMaskedData( const unsigned char* mask, unsigned char mask_value, bool invert,
+  T* data, T value, size_t begin, size_t end )
+{
+  unsigned char selection[ MASK_KERNEL_BLOCK_SIZE_C ];
+  for ( size_t j = begin; j < end; j += MASK_KERNEL_BLOCK_SIZE_C )
+  {
+    size_t size = std::min( end - j, MASK_KERNEL_BLOCK_SIZE_C );
+    size_t count = ReadMaskBits( mask + j, mask_value, invert, selection, size );
+    T* block = data + j;
+    if ( count == 0 ) continue;
+    if ( count == size )
+    {
+      std::fill( block, block + size, value );
+    }
+    else
+    {
+      for ( size_t k = 0; k < size; k++ ) if ( selection[ k ] ) block[ k ] = value;
+    }
+  }
+}
+
+} // end namespace Core
+
+#endif
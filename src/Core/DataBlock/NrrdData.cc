@@ -35,6 +35,7 @@
 #include <Core/Math/MathFunctions.h>
 #include <Core/Geometry/GridTransform.h>
 #include <Core/DataBlock/NrrdData.h>
+#include <Core/DataBlock/NrrdNativeIO.h>
 
 // Boost includes
 #include <boost/filesystem.hpp>
@@ -504,12 +505,12 @@ bool NrrdData::get_originally_node_centered() const
 }
 
 
-bool NrrdData::LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata, std::string& error )
+bool NrrdData::LoadNrrdTeem( const std::string& filename, Nrrd*& nrrd, std::string& error )
 {
   // Lock down the Teem library
   lock_type lock( GetMutex() );
 
-  Nrrd* nrrd = nrrdNew();
+  nrrd = nrrdNew();
     boost::filesystem::path nrrd_path = boost::filesystem::path( filename ).parent_path();
     std::string filename_only = boost::filesystem::path( filename ).filename().string();
 
@@ -518,12 +519,16 @@ bool NrrdData::LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata,
     if ( ec )
     {
     error = std::string( "Could not open file: " ) + filename + " : Could not get current directory.";
+    nrrdNuke( nrrd );
+    nrrd = 0;
         return false;
     }
     boost::filesystem::current_path( nrrd_path, ec );
     if ( ec )
     {
     error = std::string( "Could not open file: " ) + filename + " : Could not access path.";
+    nrrdNuke( nrrd );
+    nrrd = 0;
         return false;
     }
 
@@ -534,12 +539,35 @@ bool NrrdData::LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata,
     free( err );
     biffDone( NRRD );
     nrrdNuke( nrrd );
-    nrrddata.reset();
+    nrrd = 0;
         boost::filesystem::current_path( current_path, ec );
     return false;
   }
     boost::filesystem::current_path( current_path, ec );
 
+  return true;
+}
+
+bool NrrdData::LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata, std::string& error )
+{
+  // Try the native reader first, it does not need to lock down the Teem library
+  Nrrd* nrrd = 0;
+  bool supported = false;
+  if ( !NrrdNativeIO::Read( filename, nrrd, supported, error ) )
+  {
+    if ( supported )
+    {
+      nrrddata.reset();
+      return false;
+    }
+
+    if ( !LoadNrrdTeem( filename, nrrd, error ) )
+    {
+      nrrddata.reset();
+      return false;
+    }
+  }
+
   if ( nrrd->dim < 2 )
   {
     error = "Currently only 2D or 3D nrrd files are supported.";
@@ -632,15 +660,22 @@ bool NrrdData::SaveNrrd( const std::string& filename,
                          bool compress,
                          int level )
 {
-  // Lock down the Teem library
-  lock_type lock( GetMutex() );
-
   if ( ! nrrddata.get() )
   {
     error = "Error writing file: " + filename + " : no data volume available";
     return false;
   }
 
+  // The common case is handled natively, which compresses the data in parallel and allows
+  // multiple volumes to be saved at the same time
+  if ( NrrdNativeIO::CanWrite( filename, nrrddata->nrrd() ) )
+  {
+    return NrrdNativeIO::Write( filename, nrrddata->nrrd(), compress, level, error );
+  }
+
+  // Lock down the Teem library
+  lock_type lock( GetMutex() );
+
   NrrdIoState* nio = nrrdIoStateNew();
 
   // Turn on compression if the user wants it.
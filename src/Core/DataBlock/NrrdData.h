@@ -153,6 +153,8 @@ public:
 
   // LOADNRRD:
   /// Load a nrrd into the nrrd data structure
+  /// NOTE: Files with an attached header and raw or gzip encoding are read without locking
+  /// the Teem library.
   static bool LoadNrrd( const std::string& filename, NrrdDataHandle& nrrddata, 
     std::string& error );
 
@@ -166,6 +168,11 @@ public:
                         bool compress,
                         int level );
 
+private:
+  // LOADNRRDTEEM:
+  /// Load a nrrd using the Teem library, used for files the native reader does not support
+  static bool LoadNrrdTeem( const std::string& filename, Nrrd*& nrrd, std::string& error );
+
   // -- Lock and Unlock Teem (Some parts of Teem are not thread safe) --
 public:
   typedef boost::recursive_mutex mutex_type;
@@ -0,0 +1,1030 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+// Boost includes
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+// Zlib includes
+#include <zlib.h>
+
+// Core includes
+#include <Core/Utils/Parallel.h>
+#include <Core/Math/MathFunctions.h>
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/DataBlock/NrrdNativeIO.h>
+
+namespace Core
+{
+
+namespace
+{
+
+// Size of the chunks that are compressed independently
+const size_t GZIP_CHUNK_SIZE_C = 1 << 20;
+
+struct NrrdNativeIOTypeName
+{
+  int type_;
+  const char* name_;
+  size_t size_;
+};
+
+// The first name of each type is the one that Teem writes, the others are accepted when reading
+const NrrdNativeIOTypeName NRRD_TYPE_NAMES_C[] = 
+{
+  { nrrdTypeChar, "signed char", 1 },
+  { nrrdTypeChar, "int8", 1 },
+  { nrrdTypeChar, "int8_t", 1 },
+  { nrrdTypeUChar, "unsigned char", 1 },
+  { nrrdTypeUChar, "uchar", 1 },
+  { nrrdTypeUChar, "uint8", 1 },
+  { nrrdTypeUChar, "uint8_t", 1 },
+  { nrrdTypeShort, "short", 2 },
+  { nrrdTypeShort, "short int", 2 },
+  { nrrdTypeShort, "signed short", 2 },
+  { nrrdTypeShort, "signed short int", 2 },
+  { nrrdTypeShort, "int16", 2 },
+  { nrrdTypeShort, "int16_t", 2 },
+  { nrrdTypeUShort, "unsigned short", 2 },
+  { nrrdTypeUShort, "ushort", 2 },
+  { nrrdTypeUShort, "unsigned short int", 2 },
+  { nrrdTypeUShort, "uint16", 2 },
+  { nrrdTypeUShort, "uint16_t", 2 },
+  { nrrdTypeInt, "int", 4 },
+  { nrrdTypeInt, "signed int", 4 },
+  { nrrdTypeInt, "int32", 4 },
+  { nrrdTypeInt, "int32_t", 4 },
+  { nrrdTypeUInt, "unsigned int", 4 },
+  { nrrdTypeUInt, "uint", 4 },
+  { nrrdTypeUInt, "uint32", 4 },
+  { nrrdTypeUInt, "uint32_t", 4 },
+  { nrrdTypeLLong, "long long int", 8 },
+  { nrrdTypeLLong, "longlong", 8 },
+  { nrrdTypeLLong, "long long", 8 },
+  { nrrdTypeLLong, "signed long long", 8 },
+  { nrrdTypeLLong, "signed long long int", 8 },
+  { nrrdTypeLLong, "int64", 8 },
+  { nrrdTypeLLong, "int64_t", 8 },
+  { nrrdTypeULLong, "unsigned long long int", 8 },
+  { nrrdTypeULLong, "ulonglong", 8 },
+  { nrrdTypeULLong, "unsigned long long", 8 },
+  { nrrdTypeULLong, "uint64", 8 },
+  { nrrdTypeULLong, "uint64_t", 8 },
+  { nrrdTypeFloat, "float", 4 },
+  { nrrdTypeDouble, "double", 8 },
+  { nrrdTypeUnknown, 0, 0 }
+};
+
+struct NrrdNativeIOEnumName
+{
+  int value_;
+  const char* name_;
+};
+
+const NrrdNativeIOEnumName NRRD_SPACE_NAMES_C[] =
+{
+  { nrrdSpace3DRightHanded, "3D-right-handed" },
+  { nrrdSpace3DLeftHanded, "3D-left-handed" },
+  { nrrdSpaceRightAnteriorSuperior, "right-anterior-superior" },
+  { nrrdSpaceRightAnteriorSuperior, "ras" },
+  { nrrdSpaceLeftAnteriorSuperior, "left-anterior-superior" },
+  { nrrdSpaceLeftAnteriorSuperior, "las" },
+  { nrrdSpaceLeftPosteriorSuperior, "left-posterior-superior" },
+  { nrrdSpaceLeftPosteriorSuperior, "lps" },
+  { nrrdSpaceScannerXYZ, "scanner-xyz" },
+  { nrrdSpaceUnknown, 0 }
+};
+
+const NrrdNativeIOEnumName NRRD_CENTER_NAMES_C[] =
+{
+  { nrrdCenterUnknown, "???" },
+  { nrrdCenterUnknown, "none" },
+  { nrrdCenterNode, "node" },
+  { nrrdCenterCell, "cell" },
+  { nrrdCenterUnknown, 0 }
+};
+
+const NrrdNativeIOEnumName NRRD_KIND_NAMES_C[] =
+{
+  { nrrdKindUnknown, "???" },
+  { nrrdKindUnknown, "none" },
+  { nrrdKindDomain, "domain" },
+  { nrrdKindSpace, "space" },
+  { nrrdKindTime, "time" },
+  { nrrdKindList, "list" },
+  { nrrdKindPoint, "point" },
+  { nrrdKindVector, "vector" },
+  { nrrdKindScalar, "scalar" },
+  { nrrdKind3Color, "3-color" },
+  { nrrdKindRGBColor, "rgb-color" },
+  { nrrdKindRGBAColor, "rgba-color" },
+  { nrrdKind3Vector, "3-vector" },
+  { nrrdKindUnknown, 0 }
+};
+
+const char* EnumToName( const NrrdNativeIOEnumName* names, int value )
+{
+  for ( size_t j = 0; names[ j ].name_; j++ )
+  {
+    if ( names[ j ].value_ == value ) return names[ j ].name_;
+  }
+  return 0;
+}
+
+bool NameToEnum( const NrrdNativeIOEnumName* names, const std::string& name, int& value )
+{
+  std::string lower_name = boost::to_lower_copy( name );
+  for ( size_t j = 0; names[ j ].name_; j++ )
+  {
+    if ( lower_name == boost::to_lower_copy( std::string( names[ j ].name_ ) ) )
+    {
+      value = names[ j ].value_;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t TypeSize( int type )
+{
+  for ( size_t j = 0; NRRD_TYPE_NAMES_C[ j ].name_; j++ )
+  {
+    if ( NRRD_TYPE_NAMES_C[ j ].type_ == type ) return NRRD_TYPE_NAMES_C[ j ].size_;
+  }
+  return 0;
+}
+
+// Numbers are always written and read in the C locale, independent of the global locale
+std::string DoubleToString( double value )
+{
+  if ( IsNan( value ) ) return "nan";
+  std::ostringstream oss;
+  oss.imbue( std::locale::classic() );
+  oss.precision( 17 );
+  oss << value;
+  return oss.str();
+}
+
+bool StringToDouble( const std::string& str, double& value )
+{
+  std::string lower_str = boost::to_lower_copy( str );
+  if ( lower_str == "nan" || lower_str == "-nan" )
+  {
+    value = std::numeric_limits<double>::quiet_NaN();
+    return true;
+  }
+  if ( lower_str == "inf" || lower_str == "+inf" )
+  {
+    value = std::numeric_limits<double>::infinity();
+    return true;
+  }
+  if ( lower_str == "-inf" )
+  {
+    value = -std::numeric_limits<double>::infinity();
+    return true;
+  }
+
+  std::istringstream iss( str );
+  iss.imbue( std::locale::classic() );
+  iss >> value;
+  return !iss.fail() && iss.eof();
+}
+
+std::string VectorToString( const double* values, unsigned int dim )
+{
+  std::string result = "(";
+  for ( unsigned int j = 0; j < dim; j++ )
+  {
+    if ( j ) result += ",";
+    result += DoubleToString( values[ j ] );
+  }
+  return result + ")";
+}
+
+// Parse a vector of the form (x,y,z)
+bool StringToVector( const std::string& str, double* values, unsigned int dim )
+{
+  std::string trimmed = boost::trim_copy( str );
+  if ( trimmed.size() < 2 || trimmed[ 0 ] != '(' || trimmed[ trimmed.size() - 1 ] != ')' ) 
+  {
+    return false;
+  }
+
+  std::vector<std::string> components;
+  std::string inner = trimmed.substr( 1, trimmed.size() - 2 );
+  boost::split( components, inner, boost::is_any_of( "," ) );
+  if ( components.size() != dim ) return false;
+
+  for ( unsigned int j = 0; j < dim; j++ )
+  {
+    if ( !StringToDouble( boost::trim_copy( components[ j ] ), values[ j ] ) ) return false;
+  }
+  return true;
+}
+
+// Split a list of per axis values, vectors may not contain spaces
+std::vector<std::string> SplitValues( const std::string& str )
+{
+  std::vector<std::string> values;
+  std::string trimmed = boost::trim_copy( str );
+  boost::split( values, trimmed, boost::is_any_of( " \t" ), boost::token_compress_on );
+  return values;
+}
+
+// Split a list of quoted per axis strings
+bool SplitQuotedValues( const std::string& str, std::vector<std::string>& values )
+{
+  values.clear();
+  size_t pos = 0;
+  while ( true )
+  {
+    size_t start = str.find( '"', pos );
+    if ( start == std::string::npos ) return true;
+    size_t end = str.find( '"', start + 1 );
+    if ( end == std::string::npos ) return false;
+    values.push_back( str.substr( start + 1, end - start - 1 ) );
+    pos = end + 1;
+  }
+}
+
+// Key/value pairs escape newlines and backslashes
+std::string EscapeValue( const std::string& str )
+{
+  std::string result;
+  for ( size_t j = 0; j < str.size(); j++ )
+  {
+    if ( str[ j ] == '\n' ) result += "\\n";
+    else if ( str[ j ] == '\\' ) result += "\\\\";
+    else result += str[ j ];
+  }
+  return result;
+}
+
+std::string UnescapeValue( const std::string& str )
+{
+  std::string result;
+  for ( size_t j = 0; j < str.size(); j++ )
+  {
+    if ( str[ j ] == '\\' && j + 1 < str.size() )
+    {
+      j++;
+      if ( str[ j ] == 'n' ) result += '\n';
+      else result += str[ j ];
+    }
+    else
+    {
+      result += str[ j ];
+    }
+  }
+  return result;
+}
+
+void SwapBytes( char* data, size_t size, size_t elem_size )
+{
+  if ( elem_size < 2 ) return;
+  for ( size_t j = 0; j + elem_size <= size; j += elem_size )
+  {
+    std::reverse( data + j, data + j + elem_size );
+  }
+}
+
+class GzipCompressor
+{
+public:
+  GzipCompressor( const char* data, size_t size, int level ) :
+    data_( data ),
+    size_( size ),
+    level_( level ),
+    success_( true )
+  {
+    size_t num_chunks = Max( static_cast<size_t>( 1 ), 
+      ( size + GZIP_CHUNK_SIZE_C - 1 ) / GZIP_CHUNK_SIZE_C );
+    this->chunks_.resize( num_chunks );
+    this->crcs_.resize( num_chunks );
+  }
+
+  void compress_chunks( int thread, int num_threads, boost::barrier& barrier )
+  {
+    for ( size_t j = thread; j < this->chunks_.size(); j += num_threads )
+    {
+      if ( !this->compress_chunk( j ) ) this->success_ = false;
+    }
+  }
+
+  bool compress_chunk( size_t chunk )
+  {
+    size_t start = chunk * GZIP_CHUNK_SIZE_C;
+    size_t size = Min( GZIP_CHUNK_SIZE_C, this->size_ - start );
+    bool last = chunk + 1 == this->chunks_.size();
+
+    this->crcs_[ chunk ] = crc32( crc32( 0L, Z_NULL, 0 ), 
+      reinterpret_cast<const Bytef*>( this->data_ + start ), static_cast<uInt>( size ) );
+
+    // Raw deflate stream, the gzip header and trailer are added when joining the chunks
+    z_stream stream;
+    std::memset( &stream, 0, sizeof( stream ) );
+    if ( deflateInit2( &stream, this->level_, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+    {
+      return false;
+    }
+
+    std::vector<char>& output = this->chunks_[ chunk ];
+    output.resize( deflateBound( &stream, static_cast<uLong>( size ) ) + 16 );
+
+    stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( this->data_ + start ) );
+    stream.avail_in = static_cast<uInt>( size );
+
+    // All but the last chunk end with a sync flush, which aligns the stream to a byte boundary
+    // without ending it, so the chunks can simply be concatenated
+    int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    size_t used = 0;
+    int ret;
+    do
+    {
+      if ( used == output.size() ) output.resize( 2 * output.size() );
+      stream.next_out = reinterpret_cast<Bytef*>( &output[ used ] );
+      stream.avail_out = static_cast<uInt>( output.size() - used );
+      ret = deflate( &stream, flush );
+      used = output.size() - stream.avail_out;
+    } 
+    while ( ( last && ret == Z_OK ) || ( !last && ret == Z_OK && stream.avail_out == 0 ) );
+
+    deflateEnd( &stream );
+    output.resize( used );
+
+    return last ? ret == Z_STREAM_END : ret == Z_OK || ret == Z_BUF_ERROR;
+  }
+
+  const char* data_;
+  size_t size_;
+  int level_;
+  bool success_;
+
+  std::vector< std::vector<char> > chunks_;
+  std::vector< uLong > crcs_;
+};
+
+} // end anonymous namespace
+
+bool NrrdNativeIO::GzipCompress( const char* data, size_t size, int level, 
+  std::vector<char>& result )
+{
+  GzipCompressor compressor( data, size, level );
+
+  int num_threads = static_cast<int>( Min( compressor.chunks_.size(), 
+    static_cast<size_t>( Max( 1, static_cast<int>( boost::thread::hardware_concurrency() ) ) ) ) );
+  Parallel parallel( boost::bind( &GzipCompressor::compress_chunks, &compressor, _1, _2, _3 ),
+    num_threads );
+  parallel.run();
+
+  if ( !compressor.success_ ) return false;
+
+  size_t total_size = 18;
+  uLong crc = crc32( 0L, Z_NULL, 0 );
+  for ( size_t j = 0; j < compressor.chunks_.size(); j++ )
+  {
+    total_size += compressor.chunks_[ j ].size();
+    size_t chunk_size = Min( GZIP_CHUNK_SIZE_C, size - j * GZIP_CHUNK_SIZE_C );
+    crc = crc32_combine( crc, compressor.crcs_[ j ], static_cast<z_off_t>( chunk_size ) );
+  }
+
+  result.clear();
+  result.reserve( total_size );
+
+  // Gzip header: magic, deflate, no flags, no time, no extra flags, unknown OS
+  const unsigned char header[ 10 ] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+  result.insert( result.end(), header, header + 10 );
+
+  for ( size_t j = 0; j < compressor.chunks_.size(); j++ )
+  {
+    result.insert( result.end(), compressor.chunks_[ j ].begin(), compressor.chunks_[ j ].end() );
+    std::vector<char>().swap( compressor.chunks_[ j ] );
+  }
+
+  // Gzip trailer: crc and size modulo 2^32, both little endian
+  unsigned long long isize = static_cast<unsigned long long>( size );
+  for ( int j = 0; j < 4; j++ ) result.push_back( static_cast<char>( ( crc >> ( 8 * j ) ) & 0xff ) );
+  for ( int j = 0; j < 4; j++ ) result.push_back( static_cast<char>( ( isize >> ( 8 * j ) ) & 0xff ) );
+
+  return true;
+}
+
+bool NrrdNativeIO::GzipDecompress( const char* data, size_t size, char* result, 
+  size_t result_size )
+{
+  z_stream stream;
+  std::memset( &stream, 0, sizeof( stream ) );
+
+  // Automatic detection of the gzip header
+  if ( inflateInit2( &stream, 16 + MAX_WBITS ) != Z_OK ) return false;
+
+  const size_t max_block = static_cast<size_t>( std::numeric_limits<uInt>::max() );
+  size_t in_pos = 0;
+  size_t out_pos = 0;
+  bool success = true;
+
+  while ( out_pos < result_size )
+  {
+    if ( stream.avail_in == 0 )
+    {
+      if ( in_pos == size ) 
+      {
+        success = false;
+        break;
+      }
+      size_t block = Min( max_block, size - in_pos );
+      stream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( data + in_pos ) );
+      stream.avail_in = static_cast<uInt>( block );
+      in_pos += block;
+    }
+
+    size_t block = Min( max_block, result_size - out_pos );
+    stream.next_out = reinterpret_cast<Bytef*>( result + out_pos );
+    stream.avail_out = static_cast<uInt>( block );
+
+    int ret = inflate( &stream, Z_NO_FLUSH );
+    out_pos += block - stream.avail_out;
+
+    if ( ret == Z_STREAM_END )
+    {
+      // Files may contain multiple gzip members
+      if ( out_pos < result_size && inflateReset( &stream ) != Z_OK )
+      {
+        success = false;
+        break;
+      }
+    }
+    else if ( ret != Z_OK )
+    {
+      success = false;
+      break;
+    }
+  }
+
+  inflateEnd( &stream );
+  return success && out_pos == result_size;
+}
+
+bool NrrdNativeIO::CanWrite( const std::string& filename, const Nrrd* nrrd )
+{
+  if ( !nrrd || !nrrd->data ) return false;
+
+  // Detached headers are left to Teem
+  std::string extension = boost::to_lower_copy( 
+    boost::filesystem::path( filename ).extension().string() );
+  if ( extension != ".nrrd" ) return false;
+
+  if ( nrrd->dim < 1 || nrrd->dim > 4 || TypeSize( nrrd->type ) == 0 ) return false;
+  if ( nrrd->content || nrrd->sampleUnits ) return false;
+  if ( nrrd->spaceDim > 3 ) return false;
+  if ( nrrd->space != nrrdSpaceUnknown && !EnumToName( NRRD_SPACE_NAMES_C, nrrd->space ) ) 
+  {
+    return false;
+  }
+
+  for ( unsigned int j = 0; j < nrrd->spaceDim; j++ )
+  {
+    if ( nrrd->spaceUnits[ j ] ) return false;
+  }
+
+  for ( unsigned int j = 0; j < nrrd->dim; j++ )
+  {
+    const NrrdAxisInfo& axis = nrrd->axis[ j ];
+    if ( !EnumToName( NRRD_KIND_NAMES_C, axis.kind ) ) return false;
+    if ( !EnumToName( NRRD_CENTER_NAMES_C, axis.center ) ) return false;
+    if ( IsFinite( axis.thickness ) ) return false;
+    if ( axis.label && std::strchr( axis.label, '"' ) ) return false;
+    if ( axis.units && std::strchr( axis.units, '"' ) ) return false;
+  }
+
+  return true;
+}
+
+bool NrrdNativeIO::Write( const std::string& filename, const Nrrd* nrrd, bool compress, 
+  int level, std::string& error )
+{
+  const unsigned int dim = nrrd->dim;
+  const unsigned int space_dim = nrrd->spaceDim;
+
+  size_t num_elements = 1;
+  for ( unsigned int j = 0; j < dim; j++ ) num_elements *= nrrd->axis[ j ].size;
+  const size_t elem_size = TypeSize( nrrd->type );
+  const size_t data_size = num_elements * elem_size;
+
+  std::ostringstream header;
+  header.imbue( std::locale::classic() );
+
+  header << "NRRD0004\n";
+  header << "# Complete NRRD file format specification at:\n";
+  header << "# http://teem.sourceforge.net/nrrd/format.html\n";
+
+  for ( size_t j = 0; NRRD_TYPE_NAMES_C[ j ].name_; j++ )
+  {
+    if ( NRRD_TYPE_NAMES_C[ j ].type_ == nrrd->type )
+    {
+      header << "type: " << NRRD_TYPE_NAMES_C[ j ].name_ << "\n";
+      break;
+    }
+  }
+
+  header << "dimension: " << dim << "\n";
+
+  if ( space_dim > 0 )
+  {
+    if ( nrrd->space != nrrdSpaceUnknown )
+    {
+      header << "space: " << EnumToName( NRRD_SPACE_NAMES_C, nrrd->space ) << "\n";
+    }
+    else
+    {
+      header << "space dimension: " << space_dim << "\n";
+    }
+  }
+
+  header << "sizes:";
+  for ( unsigned int j = 0; j < dim; j++ ) header << " " << nrrd->axis[ j ].size;
+  header << "\n";
+
+  if ( space_dim > 0 )
+  {
+    header << "space directions:";
+    for ( unsigned int j = 0; j < dim; j++ )
+    {
+      if ( IsNan( nrrd->axis[ j ].spaceDirection[ 0 ] ) ) header << " none";
+      else header << " " << VectorToString( nrrd->axis[ j ].spaceDirection, space_dim );
+    }
+    header << "\n";
+  }
+  else
+  {
+    bool has_spacings = false, has_mins = false, has_maxs = false;
+    for ( unsigned int j = 0; j < dim; j++ )
+    {
+      if ( IsFinite( nrrd->axis[ j ].spacing ) ) has_spacings = true;
+      if ( IsFinite( nrrd->axis[ j ].min ) ) has_mins = true;
+      if ( IsFinite( nrrd->axis[ j ].max ) ) has_maxs = true;
+    }
+
+    if ( has_spacings )
+    {
+      header << "spacings:";
+      for ( unsigned int j = 0; j < dim; j++ ) header << " " << DoubleToString( nrrd->axis[ j ].spacing );
+      header << "\n";
+    }
+    if ( has_mins )
+    {
+      header << "axis mins:";
+      for ( unsigned int j = 0; j < dim; j++ ) header << " " << DoubleToString( nrrd->axis[ j ].min );
+      header << "\n";
+    }
+    if ( has_maxs )
+    {
+      header << "axis maxs:";
+      for ( unsigned int j = 0; j < dim; j++ ) header << " " << DoubleToString( nrrd->axis[ j ].max );
+      header << "\n";
+    }
+  }
+
+  bool has_kinds = false, has_centers = false, has_labels = false, has_units = false;
+  for ( unsigned int j = 0; j < dim; j++ )
+  {
+    if ( nrrd->axis[ j ].kind != nrrdKindUnknown ) has_kinds = true;
+    if ( nrrd->axis[ j ].center != nrrdCenterUnknown ) has_centers = true;
+    if ( nrrd->axis[ j ].label ) has_labels = true;
+    if ( nrrd->axis[ j ].units ) has_units = true;
+  }
+
+  if ( has_centers )
+  {
+    header << "centers:";
+    for ( unsigned int j = 0; j < dim; j++ ) 
+    {
+      header << " " << EnumToName( NRRD_CENTER_NAMES_C, nrrd->axis[ j ].center );
+    }
+    header << "\n";
+  }
+  if ( has_kinds )
+  {
+    header << "kinds:";
+    for ( unsigned int j = 0; j < dim; j++ ) 
+    {
+      header << " " << EnumToName( NRRD_KIND_NAMES_C, nrrd->axis[ j ].kind );
+    }
+    header << "\n";
+  }
+  if ( has_labels )
+  {
+    header << "labels:";
+    for ( unsigned int j = 0; j < dim; j++ ) 
+    {
+      header << " \"" << ( nrrd->axis[ j ].label ? nrrd->axis[ j ].label : "" ) << "\"";
+    }
+    header << "\n";
+  }
+  if ( has_units )
+  {
+    header << "units:";
+    for ( unsigned int j = 0; j < dim; j++ ) 
+    {
+      header << " \"" << ( nrrd->axis[ j ].units ? nrrd->axis[ j ].units : "" ) << "\"";
+    }
+    header << "\n";
+  }
+
+  if ( elem_size > 1 )
+  {
+    header << "endian: " << ( DataBlock::IsLittleEndian() ? "little" : "big" ) << "\n";
+  }
+  header << "encoding: " << ( compress ? "gzip" : "raw" ) << "\n";
+
+  if ( space_dim > 0 )
+  {
+    if ( !IsNan( nrrd->spaceOrigin[ 0 ] ) )
+    {
+      header << "space origin: " << VectorToString( nrrd->spaceOrigin, space_dim ) << "\n";
+    }
+
+    if ( !IsNan( nrrd->measurementFrame[ 0 ][ 0 ] ) )
+    {
+      header << "measurement frame:";
+      for ( unsigned int j = 0; j < space_dim; j++ )
+      {
+        header << " " << VectorToString( nrrd->measurementFrame[ j ], space_dim );
+      }
+      header << "\n";
+    }
+  }
+
+  unsigned int num_key_values = nrrdKeyValueSize( nrrd );
+  for ( unsigned int j = 0; j < num_key_values; j++ )
+  {
+    char* key = 0;
+    char* value = 0;
+    nrrdKeyValueIndex( nrrd, &key, &value, j );
+    if ( key && value ) header << key << ":=" << EscapeValue( value ) << "\n";
+    free( key );
+    free( value );
+  }
+
+  header << "\n";
+
+  // Compress before opening the file, so a failure does not leave a truncated file behind
+  std::vector<char> compressed;
+  if ( compress && !GzipCompress( reinterpret_cast<const char*>( nrrd->data ), data_size, 
+    level < 0 ? Z_DEFAULT_COMPRESSION : Min( 9, level ), compressed ) )
+  {
+    error = "Error writing file: " + filename + " : could not compress data";
+    return false;
+  }
+
+  std::ofstream output( filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+  if ( !output )
+  {
+    error = "Error writing file: " + filename + " : could not open file";
+    return false;
+  }
+
+  std::string header_string = header.str();
+  output.write( header_string.c_str(), header_string.size() );
+  if ( compress )
+  {
+    if ( !compressed.empty() ) output.write( &compressed[ 0 ], compressed.size() );
+  }
+  else
+  {
+    output.write( reinterpret_cast<const char*>( nrrd->data ), data_size );
+  }
+
+  output.close();
+  if ( !output )
+  {
+    error = "Error writing file: " + filename + " : could not write data";
+    return false;
+  }
+
+  error = "";
+  return true;
+}
+
+bool NrrdNativeIO::Read( const std::string& filename, Nrrd*& result, bool& supported,
+  std::string& error )
+{
+  result = 0;
+  supported = false;
+
+  std::ifstream input( filename.c_str(), std::ios::in | std::ios::binary );
+  if ( !input ) return false;
+
+  std::string line;
+  std::getline( input, line );
+  boost::trim_right( line );
+  if ( line.size() != 8 || line.compare( 0, 7, "NRRD000" ) != 0 ) return false;
+
+  int type = nrrdTypeUnknown;
+  size_t elem_size = 0;
+  unsigned int dim = 0;
+  std::vector<size_t> sizes;
+  int space = nrrdSpaceUnknown;
+  unsigned int space_dim = 0;
+  bool gzip = false;
+  bool little_endian = DataBlock::IsLittleEndian();
+
+  // Per axis and space fields are parsed after the header, as they depend on the dimensions
+  std::vector< std::pair< std::string, std::string > > fields;
+  std::vector< std::pair< std::string, std::string > > key_values;
+  std::vector< std::string > comments;
+
+  while ( std::getline( input, line ) )
+  {
+    boost::trim_right_if( line, boost::is_any_of( "\r" ) );
+    if ( line.empty() ) break;
+
+    if ( line[ 0 ] == '#' )
+    {
+      std::string comment = boost::trim_copy( line.substr( 1 ) );
+      if ( !boost::starts_with( comment, "Complete NRRD file format specification at" ) &&
+        !boost::starts_with( comment, "http://teem.sourceforge.net/nrrd/format.html" ) )
+      {
+        comments.push_back( comment );
+      }
+      continue;
+    }
+
+    size_t kv_pos = line.find( ":=" );
+    size_t field_pos = line.find( ": " );
+    if ( kv_pos != std::string::npos && ( field_pos == std::string::npos || kv_pos < field_pos ) )
+    {
+      key_values.push_back( std::make_pair( line.substr( 0, kv_pos ), 
+        UnescapeValue( line.substr( kv_pos + 2 ) ) ) );
+      continue;
+    }
+
+    if ( field_pos == std::string::npos ) return false;
+
+    std::string field = boost::to_lower_copy( boost::trim_copy( line.substr( 0, field_pos ) ) );
+    std::string value = boost::trim_copy( line.substr( field_pos + 2 ) );
+
+    if ( field == "type" )
+    {
+      std::string lower_value = boost::to_lower_copy( value );
+      for ( size_t j = 0; NRRD_TYPE_NAMES_C[ j ].name_; j++ )
+      {
+        if ( lower_value == NRRD_TYPE_NAMES_C[ j ].name_ )
+        {
+          type = NRRD_TYPE_NAMES_C[ j ].type_;
+          elem_size = NRRD_TYPE_NAMES_C[ j ].size_;
+        }
+      }
+      if ( type == nrrdTypeUnknown ) return false;
+    }
+    else if ( field == "dimension" )
+    {
+      std::istringstream iss( value );
+      iss >> dim;
+      if ( iss.fail() || dim < 1 || dim > 4 ) return false;
+    }
+    else if ( field == "sizes" )
+    {
+      std::vector<std::string> values = SplitValues( value );
+      for ( size_t j = 0; j < values.size(); j++ )
+      {
+        std::istringstream iss( values[ j ] );
+        size_t size = 0;
+        iss >> size;
+        if ( iss.fail() || size == 0 ) return false;
+        sizes.push_back( size );
+      }
+    }
+    else if ( field == "space" )
+    {
+      if ( !NameToEnum( NRRD_SPACE_NAMES_C, value, space ) ) return false;
+      space_dim = nrrdSpaceDimension( space );
+    }
+    else if ( field == "space dimension" )
+    {
+      std::istringstream iss( value );
+      iss >> space_dim;
+      if ( iss.fail() || space_dim < 1 || space_dim > 3 ) return false;
+    }
+    else if ( field == "encoding" )
+    {
+      std::string lower_value = boost::to_lower_copy( value );
+      if ( lower_value == "gzip" || lower_value == "gz" ) gzip = true;
+      else if ( lower_value != "raw" ) return false;
+    }
+    else if ( field == "endian" )
+    {
+      std::string lower_value = boost::to_lower_copy( value );
+      if ( lower_value == "little" ) little_endian = true;
+      else if ( lower_value == "big" ) little_endian = false;
+      else return false;
+    }
+    else if ( field == "line skip" || field == "lineskip" || field == "byte skip" || 
+      field == "byteskip" )
+    {
+      if ( value != "0" ) return false;
+    }
+    else if ( field == "space directions" || field == "space origin" || 
+      field == "measurement frame" || field == "spacings" || field == "axis mins" || 
+      field == "axismins" || field == "axis maxs" || field == "axismaxs" || 
+      field == "centers" || field == "centerings" || field == "kinds" || field == "labels" || 
+      field == "units" )
+    {
+      fields.push_back( std::make_pair( field, value ) );
+    }
+    else
+    {
+      // Any other field, including detached data files, is left to Teem
+      return false;
+    }
+  }
+
+  if ( type == nrrdTypeUnknown || dim == 0 || sizes.size() != dim ) return false;
+
+  Nrrd* nrrd = nrrdNew();
+  nrrd->type = type;
+  nrrd->dim = dim;
+  nrrd->space = space;
+  nrrd->spaceDim = space_dim;
+
+  size_t num_elements = 1;
+  for ( unsigned int j = 0; j < dim; j++ )
+  {
+    nrrd->axis[ j ].size = sizes[ j ];
+    num_elements *= sizes[ j ];
+  }
+
+  bool valid = true;
+  for ( size_t k = 0; k < fields.size() && valid; k++ )
+  {
+    const std::string& field = fields[ k ].first;
+    const std::string& value = fields[ k ].second;
+
+    if ( field == "space directions" )
+    {
+      std::vector<std::string> values = SplitValues( value );
+      valid = space_dim > 0 && values.size() == dim;
+      for ( unsigned int j = 0; j < dim && valid; j++ )
+      {
+        if ( values[ j ] == "none" ) continue;
+        valid = StringToVector( values[ j ], nrrd->axis[ j ].spaceDirection, space_dim );
+      }
+    }
+    else if ( field == "space origin" )
+    {
+      valid = space_dim > 0 && StringToVector( value, nrrd->spaceOrigin, space_dim );
+    }
+    else if ( field == "measurement frame" )
+    {
+      std::vector<std::string> values = SplitValues( value );
+      valid = space_dim > 0 && values.size() == space_dim;
+      for ( unsigned int j = 0; j < space_dim && valid; j++ )
+      {
+        valid = StringToVector( values[ j ], nrrd->measurementFrame[ j ], space_dim );
+      }
+    }
+    else if ( field == "spacings" || field == "axis mins" || field == "axismins" ||
+      field == "axis maxs" || field == "axismaxs" )
+    {
+      std::vector<std::string> values = SplitValues( value );
+      valid = values.size() == dim;
+      for ( unsigned int j = 0; j < dim && valid; j++ )
+      {
+        double* target = field == "spacings" ? &nrrd->axis[ j ].spacing :
+          ( field == "axis mins" || field == "axismins" ) ? &nrrd->axis[ j ].min : 
+          &nrrd->axis[ j ].max;
+        valid = StringToDouble( values[ j ], *target );
+      }
+    }
+    else if ( field == "centers" || field == "centerings" || field == "kinds" )
+    {
+      std::vector<std::string> values = SplitValues( value );
+      valid = values.size() == dim;
+      for ( unsigned int j = 0; j < dim && valid; j++ )
+      {
+        if ( field == "kinds" ) 
+        {
+          valid = NameToEnum( NRRD_KIND_NAMES_C, values[ j ], nrrd->axis[ j ].kind );
+        }
+        else 
+        {
+          valid = NameToEnum( NRRD_CENTER_NAMES_C, values[ j ], nrrd->axis[ j ].center );
+        }
+      }
+    }
+    else if ( field == "labels" || field == "units" )
+    {
+      std::vector<std::string> values;
+      valid = SplitQuotedValues( value, values ) && values.size() == dim;
+      for ( unsigned int j = 0; j < dim && valid; j++ )
+      {
+        if ( values[ j ].empty() ) continue;
+        char*& target = field == "labels" ? nrrd->axis[ j ].label : nrrd->axis[ j ].units;
+        target = strdup( values[ j ].c_str() );
+      }
+    }
+  }
+
+  if ( !valid )
+  {
+    nrrdNuke( nrrd );
+    return false;
+  }
+
+  // From here on the file is handled by this reader, failures are real errors
+  supported = true;
+
+  for ( size_t j = 0; j < key_values.size(); j++ )
+  {
+    nrrdKeyValueAdd( nrrd, key_values[ j ].first.c_str(), key_values[ j ].second.c_str() );
+  }
+  for ( size_t j = 0; j < comments.size(); j++ )
+  {
+    nrrdCommentAdd( nrrd, comments[ j ].c_str() );
+  }
+
+  const size_t data_size = num_elements * elem_size;
+  nrrd->data = malloc( Max( data_size, static_cast<size_t>( 1 ) ) );
+  if ( !nrrd->data )
+  {
+    error = "Could not open file: " + filename + " : could not allocate memory";
+    nrrdNuke( nrrd );
+    return false;
+  }
+
+  if ( gzip )
+  {
+    std::streampos data_start = input.tellg();
+    input.seekg( 0, std::ios::end );
+    size_t compressed_size = static_cast<size_t>( input.tellg() - data_start );
+    input.seekg( data_start );
+
+    std::vector<char> compressed( Max( compressed_size, static_cast<size_t>( 1 ) ) );
+    input.read( &compressed[ 0 ], compressed_size );
+    if ( !input || !GzipDecompress( &compressed[ 0 ], compressed_size, 
+      reinterpret_cast<char*>( nrrd->data ), data_size ) )
+    {
+      error = "Could not open file: " + filename + " : could not decompress data";
+      nrrdNuke( nrrd );
+      return false;
+    }
+  }
+  else
+  {
+    input.read( reinterpret_cast<char*>( nrrd->data ), data_size );
+    if ( !input )
+    {
+      error = "Could not open file: " + filename + " : file is too short";
+      nrrdNuke( nrrd );
+      return false;
+    }
+  }
+
+  if ( little_endian != DataBlock::IsLittleEndian() )
+  {
+    SwapBytes( reinterpret_cast<char*>( nrrd->data ), data_size, elem_size );
+  }
+
+  result = nrrd;
+  error = "";
+  return true;
+}
+
+} // end namespace Core
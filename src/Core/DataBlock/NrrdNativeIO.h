@@ -0,0 +1,87 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_NRRDNATIVEIO_H
+#define CORE_DATABLOCK_NRRDNATIVEIO_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Teem includes
+#include <teem/nrrd.h>
+
+namespace Core
+{
+
+// CLASS NRRDNATIVEIO
+/// Reader and writer for the common cases of the nrrd file format: an attached header with raw or
+/// gzip encoded data. Unlike nrrdLoad and nrrdSave these functions do not use any global state of
+/// the Teem library, hence they do not need to lock the Teem mutex and multiple volumes can be
+/// read and written at the same time. Files that use other features of the format still need to
+/// go through Teem.
+class NrrdNativeIO
+{
+  // -- Data IO --
+public:
+  // CAN_WRITE:
+  /// Check whether the nrrd can be written by the native writer
+  static bool CanWrite( const std::string& filename, const Nrrd* nrrd );
+
+  // WRITE:
+  /// Write a nrrd with an attached header, the data is gzip compressed in parallel if compress
+  /// is true.
+  static bool Write( const std::string& filename, const Nrrd* nrrd, bool compress, int level,
+    std::string& error );
+
+  // READ:
+  /// Read a nrrd with an attached header. If the file uses features that are not supported, 
+  /// supported is set to false and the file should be read by Teem instead.
+  static bool Read( const std::string& filename, Nrrd*& nrrd, bool& supported,
+    std::string& error );
+
+  // -- Compression --
+public:
+  // GZIPCOMPRESS:
+  /// Compress data into a single gzip stream. The data is split into chunks that are compressed
+  /// in parallel, the chunks are joined with sync flushes so the result can be read by any gzip
+  /// reader.
+  static bool GzipCompress( const char* data, size_t size, int level, std::vector<char>& result );
+
+  // GZIPDECOMPRESS:
+  /// Decompress a gzip stream, which may consist of multiple members, into a buffer of known size
+  static bool GzipDecompress( const char* data, size_t size, char* result, size_t result_size );
+};
+
+} // end namespace Core
+
+#endif
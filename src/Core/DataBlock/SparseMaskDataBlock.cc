@@ -0,0 +1,289 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Boost includes
+#include <boost/thread/mutex.hpp>
+
+// Core includes
+#include <Core/DataBlock/SparseMaskDataBlock.h>
+
+namespace Core
+{
+
+const size_t SparseMaskDataBlock::CHUNK_SIZE_C = 16;
+
+// Number of voxels and bytes of a chunk that stores its bits
+static const size_t CHUNK_VOXELS_C = 16 * 16 * 16;
+static const size_t CHUNK_BYTES_C = CHUNK_VOXELS_C / 8;
+
+// Values in the chunk table of chunks that do not store bits
+static const size_t EMPTY_CHUNK_C = ~size_t( 0 );
+static const size_t FULL_CHUNK_C = ~size_t( 0 ) - 1;
+
+class SparseMaskDataBlockPrivate : public boost::noncopyable
+{
+public:
+  // LOCATE:
+  /// Find the chunk of a voxel and the index of the voxel inside that chunk
+  void locate( size_t index, size_t& chunk, size_t& chunk_index ) const
+  {
+    const size_t nxy = this->nx_ * this->ny_;
+    const size_t z = index / nxy;
+    const size_t y = ( index - z * nxy ) / this->nx_;
+    const size_t x = index - z * nxy - y * this->nx_;
+
+    chunk = ( x >> 4 ) + this->cx_ * ( ( y >> 4 ) + this->cy_ * ( z >> 4 ) );
+    chunk_index = ( x & 15 ) + ( ( y & 15 ) << 4 ) + ( ( z & 15 ) << 8 );
+  }
+
+  // WRITE_DENSE:
+  /// Write the mask into bit 0 of a dense buffer, clearing the other bits
+  void write_dense( unsigned char* data ) const;
+
+  size_t nx_;
+  size_t ny_;
+  size_t nz_;
+
+  // Number of chunks along each axis
+  size_t cx_;
+  size_t cy_;
+  size_t cz_;
+
+  // For each chunk, the offset of its bits or EMPTY_CHUNK_C or FULL_CHUNK_C.
+  // NOTE: The chunks are protected by expand_mutex_ and are freed once the data is expanded.
+  std::vector< size_t > chunks_;
+
+  // The bits of the chunks that are neither empty nor full
+  std::vector< unsigned char > bits_;
+
+  // Whether the dense data has been allocated, protected by expand_mutex_
+  bool expanded_;
+  boost::mutex expand_mutex_;
+};
+
+void SparseMaskDataBlockPrivate::write_dense( unsigned char* data ) const
+{
+  const size_t nxy = this->nx_ * this->ny_;
+  std::memset( data, 0, nxy * this->nz_ );
+
+  for ( size_t cz = 0; cz < this->cz_; cz++ )
+  {
+    const size_t z_end = std::min( ( cz + 1 ) * 16, this->nz_ );
+    for ( size_t cy = 0; cy < this->cy_; cy++ )
+    {
+      const size_t y_end = std::min( ( cy + 1 ) * 16, this->ny_ );
+      for ( size_t cx = 0; cx < this->cx_; cx++ )
+      {
+        const size_t x_start = cx * 16;
+        const size_t x_end = std::min( x_start + 16, this->nx_ );
+        const size_t offset = this->chunks_[ cx + this->cx_ * ( cy + this->cy_ * cz ) ];
+        if ( offset == EMPTY_CHUNK_C ) continue;
+
+        for ( size_t z = cz * 16; z < z_end; z++ )
+        {
+          for ( size_t y = cy * 16; y < y_end; y++ )
+          {
+            unsigned char* row = data + z * nxy + y * this->nx_;
+            if ( offset == FULL_CHUNK_C )
+            {
+              std::memset( row + x_start, 1, x_end - x_start );
+              continue;
+            }
+
+            // The 16 voxels of a row of a chunk are stored in two bytes
+            const unsigned char* row_bits = &this->bits_[ offset ] + 
+              ( ( ( z & 15 ) << 8 ) + ( ( y & 15 ) << 4 ) ) / 8;
+            for ( size_t x = x_start; x < x_end; x++ )
+            {
+              row[ x ] = ( row_bits[ ( x & 15 ) >> 3 ] >> ( x & 7 ) ) & 1;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+SparseMaskDataBlock::SparseMaskDataBlock( size_t nx, size_t ny, size_t nz ) :
+  private_( new SparseMaskDataBlockPrivate )
+{
+  set_nx( nx );
+  set_ny( ny );
+  set_nz( nz );
+  set_type( DataType::UCHAR_E );
+
+  this->private_->nx_ = nx;
+  this->private_->ny_ = ny;
+  this->private_->nz_ = nz;
+  this->private_->cx_ = ( nx + CHUNK_SIZE_C - 1 ) / CHUNK_SIZE_C;
+  this->private_->cy_ = ( ny + CHUNK_SIZE_C - 1 ) / CHUNK_SIZE_C;
+  this->private_->cz_ = ( nz + CHUNK_SIZE_C - 1 ) / CHUNK_SIZE_C;
+  this->private_->chunks_.assign( this->private_->cx_ * this->private_->cy_ * 
+    this->private_->cz_, EMPTY_CHUNK_C );
+  this->private_->expanded_ = false;
+}
+
+SparseMaskDataBlock::~SparseMaskDataBlock()
+{
+  delete[] reinterpret_cast< unsigned char* >( get_data() );
+  set_data( 0 );
+}
+
+bool SparseMaskDataBlock::is_expanded() const
+{
+  boost::mutex::scoped_lock lock( this->private_->expand_mutex_ );
+  return this->private_->expanded_;
+}
+
+bool SparseMaskDataBlock::get_mask_at( size_t index ) const
+{
+  boost::mutex::scoped_lock lock( this->private_->expand_mutex_ );
+  if ( this->private_->expanded_ )
+  {
+    return ( reinterpret_cast< const unsigned char* >( 
+      const_cast< SparseMaskDataBlock* >( this )->get_data() )[ index ] & 1 ) != 0;
+  }
+
+  size_t chunk, chunk_index;
+  this->private_->locate( index, chunk, chunk_index );
+  
+  const size_t offset = this->private_->chunks_[ chunk ];
+  if ( offset == EMPTY_CHUNK_C ) return false;
+  if ( offset == FULL_CHUNK_C ) return true;
+  return ( ( this->private_->bits_[ offset + ( chunk_index >> 3 ) ] >> 
+    ( chunk_index & 7 ) ) & 1 ) != 0;
+}
+
+size_t SparseMaskDataBlock::get_sparse_byte_size() const
+{
+  boost::mutex::scoped_lock lock( this->private_->expand_mutex_ );
+  return this->private_->chunks_.capacity() * sizeof( size_t ) + 
+    this->private_->bits_.capacity();
+}
+
+unsigned char* SparseMaskDataBlock::expand()
+{
+  boost::mutex::scoped_lock lock( this->private_->expand_mutex_ );
+  if ( !this->private_->expanded_ )
+  {
+    unsigned char* data = new ( std::nothrow ) unsigned char[ this->get_size() ];
+    if ( data == 0 ) return 0;
+
+    this->private_->write_dense( data );
+    set_data( data );
+    this->private_->expanded_ = true;
+
+    // NOTE: Every read of the chunks holds the mutex, hence nobody is reading them anymore
+    std::vector< size_t >().swap( this->private_->chunks_ );
+    std::vector< unsigned char >().swap( this->private_->bits_ );
+  }
+
+  return reinterpret_cast< unsigned char* >( get_data() );
+}
+
+void SparseMaskDataBlock::copy_dense( unsigned char* data ) const
+{
+  boost::mutex::scoped_lock lock( this->private_->expand_mutex_ );
+  if ( this->private_->expanded_ )
+  {
+    std::memcpy( data, const_cast< SparseMaskDataBlock* >( this )->get_data(), this->get_size() );
+  }
+  else
+  {
+    this->private_->write_dense( data );
+  }
+}
+
+SparseMaskDataBlockHandle SparseMaskDataBlock::New( const unsigned char* data, 
+  unsigned char mask_value, size_t nx, size_t ny, size_t nz )
+{
+  SparseMaskDataBlockHandle data_block( new SparseMaskDataBlock( nx, ny, nz ) );
+  SparseMaskDataBlockPrivate& sparse = *data_block->private_;
+
+  const size_t nxy = nx * ny;
+  unsigned char chunk_bits[ CHUNK_BYTES_C ];
+
+  for ( size_t cz = 0; cz < sparse.cz_; cz++ )
+  {
+    const size_t z_end = std::min( ( cz + 1 ) * 16, nz );
+    for ( size_t cy = 0; cy < sparse.cy_; cy++ )
+    {
+      const size_t y_end = std::min( ( cy + 1 ) * 16, ny );
+      for ( size_t cx = 0; cx < sparse.cx_; cx++ )
+      {
+        const size_t x_start = cx * 16;
+        const size_t x_end = std::min( x_start + 16, nx );
+        const size_t chunk_voxels = ( x_end - x_start ) * ( y_end - cy * 16 ) * 
+          ( z_end - cz * 16 );
+
+        std::memset( chunk_bits, 0, CHUNK_BYTES_C );
+        size_t count = 0;
+        for ( size_t z = cz * 16; z < z_end; z++ )
+        {
+          for ( size_t y = cy * 16; y < y_end; y++ )
+          {
+            const unsigned char* row = data + z * nxy + y * nx;
+            unsigned char* row_bits = chunk_bits + ( ( ( z & 15 ) << 8 ) + ( ( y & 15 ) << 4 ) ) / 8;
+            for ( size_t x = x_start; x < x_end; x++ )
+            {
+              if ( row[ x ] & mask_value )
+              {
+                row_bits[ ( x & 15 ) >> 3 ] |= static_cast< unsigned char >( 1 << ( x & 7 ) );
+                count++;
+              }
+            }
+          }
+        }
+
+        size_t& offset = sparse.chunks_[ cx + sparse.cx_ * ( cy + sparse.cy_ * cz ) ];
+        if ( count == 0 )
+        {
+          offset = EMPTY_CHUNK_C;
+        }
+        else if ( count == chunk_voxels )
+        {
+          offset = FULL_CHUNK_C;
+        }
+        else
+        {
+          offset = sparse.bits_.size();
+          sparse.bits_.insert( sparse.bits_.end(), chunk_bits, chunk_bits + CHUNK_BYTES_C );
+        }
+      }
+    }
+  }
+
+  return data_block;
+}
+
+} // end namespace Core
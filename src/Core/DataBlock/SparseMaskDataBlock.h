@@ -0,0 +1,109 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_SPARSEMASKDATABLOCK_H
+#define CORE_DATABLOCK_SPARSEMASKDATABLOCK_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// Core includes
+#include <Core/DataBlock/DataBlock.h>
+
+namespace Core
+{
+
+// Forward Declaration
+class SparseMaskDataBlock;
+typedef boost::shared_ptr< SparseMaskDataBlock > SparseMaskDataBlockHandle;
+
+class SparseMaskDataBlockPrivate;
+typedef boost::shared_ptr< SparseMaskDataBlockPrivate > SparseMaskDataBlockPrivateHandle;
+
+// CLASS SparseMaskDataBlock
+/// A data block that stores a single mask in bit 0 of its voxels in a compact form. The volume
+/// is split into chunks of 16x16x16 voxels, chunks that are completely empty or completely full
+/// are only flagged, and the other chunks store one bit per voxel. The data block has no dense
+/// data until it is expanded, after which it behaves like any other UCHAR data block and the
+/// chunks are freed. Reads of the chunks and the expansion are serialized by an internal mutex,
+/// so a read that races with the expansion sees either the chunks or the dense data.
+class SparseMaskDataBlock : public DataBlock
+{
+  // -- Constructor/destructor --
+private:
+  SparseMaskDataBlock( size_t nx, size_t ny, size_t nz );
+
+public:
+  virtual ~SparseMaskDataBlock();
+
+  // -- Sparse data --
+public:
+  // IS_EXPANDED:
+  /// Whether the dense data has been allocated
+  bool is_expanded() const;
+
+  // GET_MASK_AT:
+  /// Get the mask value at a certain index from the chunks, or from the dense data once the
+  /// data block has been expanded.
+  bool get_mask_at( size_t index ) const;
+
+  // GET_SPARSE_BYTE_SIZE:
+  /// Get the amount of memory used by the chunks
+  size_t get_sparse_byte_size() const;
+
+  // EXPAND:
+  /// Allocate the dense data, fill in the mask and free the chunks. Returns a pointer to
+  /// the dense data or 0 if the data could not be allocated. Once expanded, this function only
+  /// returns the pointer to the data.
+  unsigned char* expand();
+
+  // COPY_DENSE:
+  /// Write the mask into bit 0 of a dense buffer of get_size() bytes, without expanding the
+  /// data block. The other bits of the buffer are cleared.
+  /// NOTE: The caller needs to hold a read lock on the data block.
+  void copy_dense( unsigned char* data ) const;
+
+  // -- Internal implementation of this class --
+private:
+  SparseMaskDataBlockPrivateHandle private_;
+
+public:
+  // CHUNK_SIZE_C:
+  /// The size of the chunks along each axis
+  static const size_t CHUNK_SIZE_C;
+
+  // NEW: ( Factory constructor )
+  /// Compress the voxels of a dense mask that have mask_value set.
+  static SparseMaskDataBlockHandle New( const unsigned char* data, unsigned char mask_value,
+    size_t nx, size_t ny, size_t nz );
+};
+
+} // end namespace Core
+
+#endif
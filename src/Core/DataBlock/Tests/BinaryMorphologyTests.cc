@@ -0,0 +1,103 @@
+/*
+For more information, please see: http://software.sci.utah.edu
+
+The MIT License
+
+Copyright (c) 2016 Scientific Computing and Imaging Institute,
+University of Utah.
+
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include <Core/DataBlock/BinaryMorphology.h>
+
+using namespace Core;
+
+// Brute force version that checks every offset in the ball
+static std::vector<unsigned char> ReferenceMorphology( const std::vector<unsigned char>& data,
+  int nx, int ny, int nz, int radius, bool x_axis, bool y_axis, bool z_axis, 
+  unsigned char seed_value, unsigned char target_value, unsigned char new_value )
+{
+  std::vector<unsigned char> result = data;
+  int xr = x_axis ? radius : 0, yr = y_axis ? radius : 0, zr = z_axis ? radius : 0;
+  for ( int z = 0; z < nz; z++ ) for ( int y = 0; y < ny; y++ ) for ( int x = 0; x < nx; x++ )
+  {
+    size_t index = x + nx * ( y + ny * z );
+    if ( data[ index ] != target_value ) continue;
+    bool found = false;
+    for ( int dz = -zr; dz <= zr && !found; dz++ )
+    for ( int dy = -yr; dy <= yr && !found; dy++ )
+    for ( int dx = -xr; dx <= xr && !found; dx++ )
+    {
+      if ( dx * dx + dy * dy + dz * dz > radius * radius ) continue;
+      int px = x + dx, py = y + dy, pz = z + dz;
+      if ( px < 0 || px >= nx || py < 0 || py >= ny || pz < 0 || pz >= nz ) continue;
+      if ( data[ px + nx * ( py + ny * pz ) ] == seed_value ) found = true;
+    }
+    if ( found ) result[ index ] = new_value;
+  }
+  return result;
+}
+
+static std::vector<unsigned char> RandomLabels( size_t size, int density )
+{
+  std::vector<unsigned char> data( size );
+  for ( size_t j = 0; j < size; j++ )
+  {
+    int value = std::rand() % 1000;
+    data[ j ] = value < density ? 1 : ( value < density + 50 ? 255 : 0 );
+  }
+  return data;
+}
+
+TEST(BinaryMorphologyTests, MatchesBruteForce)
+{
+  const int nx = 41, ny = 23, nz = 19;
+  const int radii[] = { 0, 1, 2, 4, 5, 7, 17 };
+  std::srand( 42 );
+  
+  for ( size_t r = 0; r < sizeof( radii ) / sizeof( int ); r++ )
+  {
+    for ( int axes = 3; axes < 8; axes++ )
+    {
+      bool x_axis = ( axes & 1 ) != 0, y_axis = ( axes & 2 ) != 0, z_axis = ( axes & 4 ) != 0;
+      std::vector<unsigned char> data = RandomLabels( nx * ny * nz, radii[ r ] > 4 ? 3 : 30 );
+      
+      std::vector<unsigned char> dilated = data;
+      ASSERT_TRUE(BinaryMorphology::Dilate( &dilated[ 0 ], nx, ny, nz, radii[ r ], 
+        x_axis, y_axis, z_axis, BinaryMorphology::progress_function_type() ));
+      EXPECT_TRUE(dilated == ReferenceMorphology( data, nx, ny, nz, radii[ r ], 
+        x_axis, y_axis, z_axis, 1, 0, 1 )) << "dilate radius " << radii[ r ] << " axes " << axes;
+
+      data = RandomLabels( nx * ny * nz, radii[ r ] > 4 ? 997 : 900 );
+      std::vector<unsigned char> eroded = data;
+      ASSERT_TRUE(BinaryMorphology::Erode( &eroded[ 0 ], nx, ny, nz, radii[ r ], 
+        x_axis, y_axis, z_axis, BinaryMorphology::progress_function_type() ));
+      EXPECT_TRUE(eroded == ReferenceMorphology( data, nx, ny, nz, radii[ r ], 
+        x_axis, y_axis, z_axis, 0, 1, 0 )) << "erode radius " << radii[ r ] << " axes " << axes;
+    }
+  }
+}
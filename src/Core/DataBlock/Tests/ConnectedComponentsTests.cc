@@ -0,0 +1,163 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <Core/DataBlock/ConnectedComponents.h>
+#include <Core/DataBlock/StdDataBlock.h>
+
+using namespace Core;
+
+static bool AlwaysContinue( double )
+{
+  return true;
+}
+
+// Breadth first labeling of single voxels, components are numbered in memory order
+static size_t ReferenceLabels( const std::vector<unsigned char>& set, int nx, int ny, int nz,
+  std::vector<unsigned int>& labels )
+{
+  labels.assign( set.size(), 0 );
+  unsigned int num_labels = 0;
+  std::vector<size_t> queue;
+  for ( size_t start = 0; start < set.size(); start++ )
+  {
+    if ( !set[ start ] || labels[ start ] ) continue;
+    labels[ start ] = ++num_labels;
+    queue.assign( 1, start );
+    for ( size_t q = 0; q < queue.size(); q++ )
+    {
+      int x = static_cast<int>( queue[ q ] % nx ), y = static_cast<int>( queue[ q ] / nx % ny );
+      int z = static_cast<int>( queue[ q ] / nx / ny );
+      const int offsets[ 6 ][ 3 ] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, 
+        { 0, 0, -1 }, { 0, 0, 1 } };
+      for ( int k = 0; k < 6; k++ )
+      {
+        int px = x + offsets[ k ][ 0 ], py = y + offsets[ k ][ 1 ], pz = z + offsets[ k ][ 2 ];
+        if ( px < 0 || px >= nx || py < 0 || py >= ny || pz < 0 || pz >= nz ) continue;
+        size_t index = px + nx * ( py + ny * pz );
+        if ( set[ index ] && !labels[ index ] )
+        {
+          labels[ index ] = num_labels;
+          queue.push_back( index );
+        }
+      }
+    }
+  }
+  return num_labels;
+}
+
+static void CheckLabels( int nx, int ny, int nz, int density, bool invert, unsigned int seed )
+{
+  std::srand( seed );
+  DataBlockHandle data_block = StdDataBlock::New( nx, ny, nz, DataType::UCHAR_E );
+  unsigned char* data = reinterpret_cast<unsigned char*>( data_block->get_data() );
+  std::vector<unsigned char> set( data_block->get_size() );
+  for ( size_t j = 0; j < set.size(); j++ )
+  {
+    // Other bits hold noise that needs to be ignored
+    bool bit = ( std::rand() % 1000 ) < density;
+    data[ j ] = static_cast<unsigned char>( ( std::rand() & 0xfb ) | ( bit ? 0x04 : 0 ) );
+    set[ j ] = bit != invert;
+  }
+  MaskDataBlockHandle mask( new MaskDataBlock( data_block, 2 ) );
+
+  ConnectedComponents components;
+  ASSERT_TRUE( components.label( mask, invert, ConnectedComponents::progress_function_type(
+    &AlwaysContinue ) ) );
+
+  std::vector<unsigned int> expected;
+  size_t num_labels = ReferenceLabels( set, nx, ny, nz, expected );
+  ASSERT_EQ( num_labels, components.get_num_components() );
+
+  std::vector<size_t> sizes( num_labels + 1, 0 );
+  std::vector<IndexVector> min( num_labels + 1, IndexVector( nx, ny, nz ) );
+  std::vector<IndexVector> max( num_labels + 1, IndexVector( -1, -1, -1 ) );
+  for ( int z = 0; z < nz; z++ ) for ( int y = 0; y < ny; y++ ) for ( int x = 0; x < nx; x++ )
+  {
+    unsigned int label = expected[ x + nx * ( y + ny * z ) ];
+    ASSERT_EQ( label, components.get_label_at( x, y, z ) );
+    sizes[ label ]++;
+    IndexVector p( x, y, z );
+    for ( size_t k = 0; k < 3; k++ )
+    {
+      min[ label ][ k ] = std::min( min[ label ][ k ], p[ k ] );
+      max[ label ][ k ] = std::max( max[ label ][ k ], p[ k ] );
+    }
+  }
+  for ( unsigned int label = 1; label <= num_labels; label++ )
+  {
+    IndexVector component_min, component_max;
+    components.get_bounding_box( label, component_min, component_max );
+    EXPECT_EQ( sizes[ label ], components.get_size( label ) );
+    EXPECT_TRUE( component_min == min[ label ] );
+    EXPECT_TRUE( component_max == max[ label ] );
+  }
+
+  // Write the sizes and select every other component
+  std::vector<unsigned int> values( num_labels + 1, 0 );
+  std::vector<unsigned char> selected( num_labels + 1, 0 );
+  for ( unsigned int label = 1; label <= num_labels; label++ )
+  {
+    values[ label ] = static_cast<unsigned int>( sizes[ label ] );
+    selected[ label ] = label % 2;
+  }
+  std::vector<unsigned int> written( set.size(), 1 );
+  components.write_values( values, &written[ 0 ] );
+
+  DataBlockHandle output_block = StdDataBlock::New( nx, ny, nz, DataType::UCHAR_E );
+  output_block->clear();
+  MaskDataBlockHandle output( new MaskDataBlock( output_block, 5 ) );
+  components.write_mask( selected, output );
+
+  for ( size_t j = 0; j < set.size(); j++ )
+  {
+    ASSERT_EQ( values[ expected[ j ] ], written[ j ] );
+    ASSERT_EQ( selected[ expected[ j ] ] != 0, output->get_mask_at( j ) );
+  }
+
+  // Every component overlaps with the voxels it is made of
+  std::vector<unsigned char> overlapping( num_labels + 1, 0 );
+  components.find_overlapping( mask, invert, overlapping );
+  EXPECT_EQ( num_labels, static_cast<size_t>( std::count( overlapping.begin() + 1, 
+    overlapping.end(), 1 ) ) );
+}
+
+TEST(ConnectedComponentsTests, MatchesReferenceLabels)
+{
+  CheckLabels( 37, 29, 31, 300, false, 1 );
+  CheckLabels( 37, 29, 31, 300, true, 2 );
+  CheckLabels( 64, 13, 70, 500, false, 3 );
+  CheckLabels( 5, 3, 1, 500, false, 4 );
+  CheckLabels( 1, 1, 1, 1000, false, 5 );
+  CheckLabels( 20, 20, 20, 0, false, 6 );
+}
@@ -0,0 +1,155 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+ 
+ The MIT License
+ 
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+ 
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/DataBlock/DataBlockManager.h>
+#include <Core/DataBlock/DataBlockChunkStore.h>
+#include <Testing/Utils/FilesystemPaths.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+namespace {
+
+size_t countChunkFiles(const boost::filesystem::path& dir)
+{
+  size_t count = 0;
+  boost::filesystem::recursive_directory_iterator it(dir / "chunks"), end;
+  for (; it != end; ++it)
+  {
+    if (boost::filesystem::is_regular_file(it->path())) ++count;
+  }
+  return count;
+}
+
+}
+
+// A second generation that differs in a single voxel only adds the chunk containing it.
+TEST(DataBlockChunkStoreTests, UnchangedChunksAreShared)
+{
+  boost::filesystem::path dir = testOutputDir() / "chunkstore";
+  boost::filesystem::remove_all(dir);
+  boost::filesystem::create_directories(dir);
+
+  // 2x2x1 chunks, with partial chunks along x and y
+  DataBlockHandle dataBlock = StdDataBlock::New(100, 70, 30, DataType::SHORT_E);
+  ASSERT_FALSE(dataBlock.get() == 0);
+  short* data = reinterpret_cast<short*>(dataBlock->get_data());
+  for (size_t i = 0; i < dataBlock->get_size(); ++i)
+  {
+    data[i] = static_cast<short>(i % 1013);
+  }
+  GridTransform transform(100, 70, 30, Point(1, 2, 3), Vector(0.5, 0, 0),
+    Vector(0, 0.5, 0), Vector(0, 0, 2));
+
+  std::string error;
+  boost::filesystem::path first = dir / ("1" + DataBlockChunkStore::GetManifestExtension());
+  ASSERT_TRUE(DataBlockChunkStore::Save(first, dataBlock, transform, true, 6, error)) << error;
+  EXPECT_EQ(countChunkFiles(dir), 4u);
+
+  data[dataBlock->to_index(80, 10, 20)] = -1;
+  boost::filesystem::path second = dir / ("2" + DataBlockChunkStore::GetManifestExtension());
+  ASSERT_TRUE(DataBlockChunkStore::Save(second, dataBlock, transform, false, 0, error)) << error;
+  EXPECT_EQ(countChunkFiles(dir), 5u);
+
+  DataBlockHandle loaded;
+  GridTransform loadedTransform;
+  ASSERT_TRUE(DataBlockChunkStore::Load(second, loaded, loadedTransform, error)) << error;
+  EXPECT_EQ(loaded->get_data_type(), DataType::SHORT_E);
+  EXPECT_EQ(loaded->get_nx(), 100u);
+  EXPECT_EQ(loaded->get_ny(), 70u);
+  EXPECT_EQ(loaded->get_nz(), 30u);
+  EXPECT_EQ(loadedTransform, transform);
+  EXPECT_TRUE(std::equal(data, data + dataBlock->get_size(),
+    reinterpret_cast<short*>(loaded->get_data())));
+
+  // Removing the second generation makes its modified chunk unused
+  boost::filesystem::remove(second);
+  DataBlockChunkStore::RemoveUnusedChunks(dir);
+  EXPECT_EQ(countChunkFiles(dir), 4u);
+  ASSERT_TRUE(DataBlockChunkStore::Load(first, loaded, loadedTransform, error)) << error;
+}
+
+// Saving on top of an earlier generation only rehashes the chunks marked as changed, and gives
+// the same manifest as saving everything.
+TEST(DataBlockChunkStoreTests, IncrementalSaveUsesChangedRegion)
+{
+  boost::filesystem::path dir = testOutputDir() / "chunkstore_incremental";
+  boost::filesystem::remove_all(dir);
+  boost::filesystem::create_directories(dir);
+
+  DataBlockHandle dataBlock = StdDataBlock::New(100, 70, 30, DataType::UCHAR_E);
+  ASSERT_FALSE(dataBlock.get() == 0);
+  DataBlockManager::Instance()->register_datablock(dataBlock);
+  unsigned char* data = reinterpret_cast<unsigned char*>(dataBlock->get_data());
+  for (size_t i = 0; i < dataBlock->get_size(); ++i)
+  {
+    data[i] = static_cast<unsigned char>(i % 251);
+  }
+  GridTransform transform(100, 70, 30, Point(0, 0, 0), Vector(1, 0, 0),
+    Vector(0, 1, 0), Vector(0, 0, 1));
+
+  std::string error;
+  DataBlock::generation_type baseGeneration = dataBlock->get_generation();
+  boost::filesystem::path base = dir / ("base" + DataBlockChunkStore::GetManifestExtension());
+  ASSERT_TRUE(DataBlockChunkStore::Save(base, dataBlock, transform, false, 0, error)) << error;
+
+  {
+    DataBlock::lock_type lock(dataBlock->get_mutex());
+    data[dataBlock->to_index(80, 10, 20)] = 255;
+    dataBlock->increase_generation(IndexVector(80, 10, 20), IndexVector(80, 10, 20));
+
+    IndexVector min, max;
+    ASSERT_TRUE(dataBlock->get_changed_region(baseGeneration, min, max));
+    EXPECT_EQ(min, IndexVector(80, 10, 20));
+    EXPECT_EQ(max, IndexVector(80, 10, 20));
+    std::vector<size_t> bricks;
+    ASSERT_TRUE(dataBlock->get_changed_bricks(baseGeneration, bricks));
+    ASSERT_EQ(bricks.size(), 1u);
+    EXPECT_EQ(bricks[0], 1u);
+    EXPECT_FALSE(dataBlock->get_changed_region(baseGeneration - 1, min, max));
+  }
+
+  boost::filesystem::path incremental = dir / ("incremental" + 
+    DataBlockChunkStore::GetManifestExtension());
+  ASSERT_TRUE(DataBlockChunkStore::Save(incremental, dataBlock, transform, base, 
+    baseGeneration, false, 0, error)) << error;
+  boost::filesystem::path full = dir / ("full" + DataBlockChunkStore::GetManifestExtension());
+  ASSERT_TRUE(DataBlockChunkStore::Save(full, dataBlock, transform, false, 0, error)) << error;
+
+  std::vector<boost::filesystem::path> incrementalChunks, fullChunks;
+  ASSERT_TRUE(DataBlockChunkStore::GetChunkFiles(incremental, incrementalChunks, error));
+  ASSERT_TRUE(DataBlockChunkStore::GetChunkFiles(full, fullChunks, error));
+  EXPECT_EQ(incrementalChunks, fullChunks);
+
+  DataBlockManager::Instance()->unregister_datablock(dataBlock->get_generation());
+}
@@ -0,0 +1,94 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+ 
+ The MIT License
+ 
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+ 
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <Core/DataBlock/Histogram.h>
+
+using namespace Core;
+
+namespace {
+
+void expectSameHistogram(const Histogram& a, const Histogram& b)
+{
+  EXPECT_EQ(a.get_min(), b.get_min());
+  EXPECT_EQ(a.get_max(), b.get_max());
+  EXPECT_EQ(a.get_bin_size(), b.get_bin_size());
+  EXPECT_EQ(a.get_bin_start(), b.get_bin_start());
+  EXPECT_EQ(a.get_bins(), b.get_bins());
+}
+
+}
+
+// Every value is counted, also when the data is split over many threads
+TEST(HistogramTests, CountsAllValues)
+{
+  std::vector<float> data(3000000);
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    data[i] = -100.0f + static_cast<float>(i % 977);
+  }
+
+  Histogram histogram(&data[0], data.size());
+  ASSERT_TRUE(histogram.is_valid());
+  EXPECT_EQ(histogram.get_min(), -100.0);
+  EXPECT_EQ(histogram.get_max(), 876.0);
+
+  size_t total = 0;
+  for (size_t i = 0; i < histogram.get_size(); ++i) total += histogram.get_bins()[i];
+  EXPECT_EQ(total, data.size());
+}
+
+// Updating the changed bricks gives the same histogram as computing it again, both when the
+// range of the data stays the same and when it grows.
+TEST(HistogramTests, BrickUpdateMatchesFullCompute)
+{
+  const size_t nx = 70, ny = 40, nz = 33, brickSize = 16;
+  std::vector<short> data(nx * ny * nz);
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    data[i] = static_cast<short>((i * 7) % 1000);
+  }
+
+  Histogram histogram;
+  HistogramBricks bricks;
+  ASSERT_TRUE(histogram.compute(&data[0], DataType::SHORT_E, nx, ny, nz, brickSize, bricks));
+
+  // Brick 6 covers x = [16, 32), y = [16, 32), z = [0, 16)
+  std::vector<size_t> changed(1, 6);
+  data[(3 * ny + 20) * nx + 20] = 500;
+  ASSERT_TRUE(histogram.update(&data[0], DataType::SHORT_E, nx, ny, nz, changed, bricks));
+  expectSameHistogram(histogram, Histogram(&data[0], data.size()));
+
+  data[(4 * ny + 17) * nx + 30] = -2000;
+  ASSERT_TRUE(histogram.update(&data[0], DataType::SHORT_E, nx, ny, nz, changed, bricks));
+  expectSameHistogram(histogram, Histogram(&data[0], data.size()));
+  EXPECT_EQ(histogram.get_min(), -2000.0);
+}
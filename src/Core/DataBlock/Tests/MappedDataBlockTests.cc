@@ -0,0 +1,88 @@
+/*
+For more information, please see: http://software.sci.utah.edu
+
+The MIT License
+
+Copyright (c) 2016 Scientific Computing and Imaging Institute,
+University of Utah.
+
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <vector>
+
+#include <Core/DataBlock/MappedDataBlock.h>
+#include <Testing/Utils/FilesystemPaths.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+TEST(MappedDataBlockTests, MapRawFileWithOffset)
+{
+  boost::filesystem::path rawFile = testOutputDir() / "mappedDataBlockTest.raw";
+
+  // 16 bytes of header followed by a 3x3x3 int volume
+  std::vector<int> data( 4 + 27 );
+  for ( size_t j = 0; j < data.size(); j++ ) data[ j ] = static_cast<int>( j ) - 4;
+  {
+    std::ofstream output( rawFile.string().c_str(), std::ios_base::trunc | std::ios_base::binary );
+    output.write( reinterpret_cast<char*>( &data[ 0 ] ), data.size() * sizeof( int ) );
+  }
+
+  DataBlockHandle dataBlock = MappedDataBlock::New( rawFile.string(), 3, 3, 3, 
+    DataType::INT_E, 4 * sizeof( int ) );
+  ASSERT_FALSE(dataBlock.get() == 0);
+
+  EXPECT_EQ(dataBlock->get_size(), 27);
+  EXPECT_EQ(dataBlock->get_data_type(), DataType::INT_E);
+  EXPECT_EQ(dataBlock->get_data_at( 0, 0, 0 ), 0);
+  EXPECT_EQ(dataBlock->get_data_at( 1, 1, 1 ), 13.0);
+  EXPECT_EQ(dataBlock->get_data_at( 26 ), 26.0);
+
+  // Modifications are private to the data block
+  dataBlock->set_data_at( 0, 42.0 );
+  EXPECT_EQ(dataBlock->get_data_at( 0 ), 42.0);
+  dataBlock.reset();
+
+  std::vector<int> check( data.size() );
+  {
+    std::ifstream input( rawFile.string().c_str(), std::ios_base::binary );
+    input.read( reinterpret_cast<char*>( &check[ 0 ] ), check.size() * sizeof( int ) );
+  }
+  EXPECT_EQ(check[ 4 ], 0);
+}
+
+TEST(MappedDataBlockTests, FileTooSmall)
+{
+  boost::filesystem::path rawFile = testOutputDir() / "mappedDataBlockTestSmall.raw";
+  {
+    std::vector<char> data( 10 );
+    std::ofstream output( rawFile.string().c_str(), std::ios_base::trunc | std::ios_base::binary );
+    output.write( &data[ 0 ], data.size() );
+  }
+
+  DataBlockHandle dataBlock = MappedDataBlock::New( rawFile.string(), 3, 3, 3, DataType::INT_E );
+  EXPECT_TRUE(dataBlock.get() == 0);
+}
@@ -0,0 +1,112 @@
+/*
+For more information, please see: http://software.sci.utah.edu
+
+The MIT License
+
+Copyright (c) 2016 Scientific Computing and Imaging Institute,
+University of Utah.
+
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include <Core/DataBlock/MaskKernels.h>
+
+using namespace Core;
+
+static std::vector<unsigned char> RandomMaskData( size_t size )
+{
+  std::vector<unsigned char> data( size );
+  std::srand( 1234 );
+  for ( size_t j = 0; j < size; j++ ) data[ j ] = static_cast<unsigned char>( std::rand() );
+  return data;
+}
+
+TEST(MaskKernelsTests, CombineMaskBits)
+{
+  const size_t size = 1000;
+  const MaskOperator::enum_type operators[] = 
+    { MaskOperator::AND_E, MaskOperator::OR_E, MaskOperator::XOR_E, MaskOperator::REMOVE_E };
+
+  for ( size_t i = 0; i < 4; i++ )
+  {
+    // All masks share one buffer, as they do in the mask data blocks
+    std::vector<unsigned char> data = RandomMaskData( size );
+    std::vector<unsigned char> expected = data;
+    for ( size_t j = 3; j < size - 5; j++ )
+    {
+      bool a = ( data[ j ] & 0x01 ) != 0;
+      bool b = ( data[ j ] & 0x20 ) != 0;
+      bool result = false;
+      switch ( operators[ i ] )
+      {
+      case MaskOperator::AND_E: result = a && b; break;
+      case MaskOperator::OR_E: result = a || b; break;
+      case MaskOperator::XOR_E: result = a != b; break;
+      case MaskOperator::REMOVE_E: result = a && !b; break;
+      }
+      if ( result ) expected[ j ] |= 0x08;
+    }
+
+    CombineMaskBits( operators[ i ], &data[ 0 ], 0x01, &data[ 0 ], 0x20, &data[ 0 ], 0x08, 
+      3, size - 5 );
+    for ( size_t j = 0; j < size; j++ )
+    {
+      ASSERT_EQ(data[ j ], expected[ j ]) << "operator " << i << " index " << j;
+    }
+  }
+}
+
+TEST(MaskKernelsTests, ConvertDataAndMaskBits)
+{
+  const size_t size = 3000;
+  std::vector<short> labels( size );
+  for ( size_t j = 0; j < size; j++ ) labels[ j ] = static_cast<short>( ( j * 7 ) % 5 ) - 2;
+  
+  std::vector<unsigned char> mask = RandomMaskData( size );
+  std::vector<unsigned char> original = mask;
+  ConvertDataToMaskBits( &labels[ 0 ], LargerThanZeroPredicate<short>(), true, &mask[ 0 ], 
+    0x10, 0, size );
+  for ( size_t j = 0; j < size; j++ )
+  {
+    unsigned char expected = ( original[ j ] & ~0x10 ) | ( labels[ j ] > 0 ? 0 : 0x10 );
+    ASSERT_EQ(mask[ j ], expected) << "index " << j;
+  }
+
+  std::vector<float> data( size, -1.0f );
+  ConvertMaskBitsToData( &mask[ 0 ], 0x10, &data[ 0 ], 5.0f, 0.0f, 1, size );
+  EXPECT_EQ(data[ 0 ], -1.0f);
+  for ( size_t j = 1; j < size; j++ )
+  {
+    ASSERT_EQ(data[ j ], ( mask[ j ] & 0x10 ) ? 5.0f : 0.0f) << "index " << j;
+  }
+
+  std::vector<int> inscribed( size, 3 );
+  FillMaskedData( &mask[ 0 ], 0x10, true, &inscribed[ 0 ], 7, 0, size );
+  for ( size_t j = 0; j < size; j++ )
+  {
+    ASSERT_EQ(inscribed[ j ], ( mask[ j ] & 0x10 ) ? 3 : 7) << "index " << j;
+  }
+}
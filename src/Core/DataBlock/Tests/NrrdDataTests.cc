@@ -71,3 +71,36 @@ TEST(NrrdDataTests, DetachedNrrdFromStdDataBlockNodeCentered)
 //  inputfile.exceptions( std::ifstream::failbit | std::ifstream::badbit );
   
 }
+
+// Attached nrrds with gzip encoding are written and read without Teem.
+TEST(NrrdDataTests, AttachedCompressedNrrdRoundTrip)
+{
+  Core::Point origin(1, 1, 1);
+  Core::Vector spacing(0.5, 0.5, 0.5);
+  std::tuple<Core::DataBlockHandle, Core::GridTransform> tuple =
+    generate3x3x3StdDataBlock(Core::DataType::INT_E, origin, spacing, true);
+
+  Core::DataBlockHandle dataBlock = std::get<0>(tuple);
+  Core::GridTransform gridTransform = std::get<1>(tuple);
+  ASSERT_FALSE(dataBlock.get() == 0);
+
+  Core::NrrdDataHandle nrrd =
+    Core::NrrdDataHandle( new Core::NrrdData( dataBlock, gridTransform ) );
+
+  boost::filesystem::path nrrdFile = testOutputDir() / "compressedTest.nrrd";
+
+  std::string error;
+  EXPECT_TRUE(NrrdData::SaveNrrd(nrrdFile.string(), nrrd, error, true, 6));
+  EXPECT_TRUE(error.empty());
+
+  Core::NrrdDataHandle loaded;
+  ASSERT_TRUE(NrrdData::LoadNrrd(nrrdFile.string(), loaded, error));
+  EXPECT_TRUE(error.empty());
+
+  EXPECT_EQ(loaded->get_data_type(), Core::DataType::INT_E);
+  ASSERT_EQ(loaded->get_size(), dataBlock->get_size());
+  const int* expected = reinterpret_cast<const int*>(dataBlock->get_data());
+  const int* actual = reinterpret_cast<const int*>(loaded->get_data());
+  EXPECT_TRUE(std::equal(expected, expected + dataBlock->get_size(), actual));
+  EXPECT_EQ(loaded->get_grid_transform(), nrrd->get_grid_transform());
+}
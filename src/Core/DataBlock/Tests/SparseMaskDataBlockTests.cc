@@ -0,0 +1,149 @@
+/*
+For more information, please see: http://software.sci.utah.edu
+
+The MIT License
+
+Copyright (c) 2016 Scientific Computing and Imaging Institute,
+University of Utah.
+
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <Core/DataBlock/MaskDataBlock.h>
+#include <Core/DataBlock/SparseMaskDataBlock.h>
+
+using namespace Core;
+
+TEST(SparseMaskDataBlockTests, CompressAndExpand)
+{
+  // A volume that is not a multiple of the chunk size, with an empty chunk, a full chunk
+  // and a few mixed chunks
+  const size_t nx = 37, ny = 20, nz = 18;
+  std::vector<unsigned char> data( nx * ny * nz, 0 );
+  for ( size_t z = 0; z < nz; z++ )
+  {
+    for ( size_t y = 0; y < ny; y++ )
+    {
+      for ( size_t x = 0; x < nx; x++ )
+      {
+        size_t index = x + nx * ( y + ny * z );
+        if ( x < 16 && y < 16 && z < 16 ) data[ index ] = 0x04;
+        else if ( x >= 32 && ( x + y + z ) % 3 == 0 ) data[ index ] = 0x05;
+        else if ( x >= 16 && x < 32 ) data[ index ] = 0x01;
+      }
+    }
+  }
+
+  SparseMaskDataBlockHandle sparse = SparseMaskDataBlock::New( &data[ 0 ], 0x04, nx, ny, nz );
+  ASSERT_FALSE(sparse.get() == 0);
+  EXPECT_FALSE(sparse->is_expanded());
+  EXPECT_LT(sparse->get_sparse_byte_size(), data.size());
+
+  for ( size_t j = 0; j < data.size(); j++ )
+  {
+    ASSERT_EQ(sparse->get_mask_at( j ), ( data[ j ] & 0x04 ) != 0) << "index " << j;
+  }
+
+  std::vector<unsigned char> dense( data.size(), 0xff );
+  sparse->copy_dense( &dense[ 0 ] );
+  EXPECT_FALSE(sparse->is_expanded());
+  for ( size_t j = 0; j < data.size(); j++ )
+  {
+    ASSERT_EQ(dense[ j ], ( data[ j ] & 0x04 ) ? 1 : 0) << "index " << j;
+  }
+
+  unsigned char* expanded = sparse->expand();
+  ASSERT_FALSE(expanded == 0);
+  EXPECT_TRUE(sparse->is_expanded());
+  EXPECT_EQ(expanded, sparse->get_data());
+  EXPECT_EQ(expanded, sparse->expand());
+  EXPECT_EQ(0u, sparse->get_sparse_byte_size());
+  for ( size_t j = 0; j < data.size(); j++ )
+  {
+    ASSERT_EQ(expanded[ j ], dense[ j ]) << "index " << j;
+    ASSERT_EQ(sparse->get_mask_at( j ), dense[ j ] != 0) << "index " << j;
+  }
+}
+
+namespace {
+
+void readMask( MaskDataBlockHandle mask, const std::vector<unsigned char>* data, 
+  size_t* mismatches )
+{
+  for ( size_t j = 0; j < data->size(); j++ )
+  {
+    if ( mask->get_mask_at( j ) != ( ( *data )[ j ] != 0 ) ) ( *mismatches )++;
+  }
+}
+
+void expandMask( MaskDataBlockHandle mask, unsigned char** result )
+{
+  *result = mask->get_mask_data();
+}
+
+}
+
+// Threads that read a mask while it is expanded see the same voxels before and after the
+// expansion, and all threads that expand it get the same data.
+TEST(SparseMaskDataBlockTests, ConcurrentExpand)
+{
+  const size_t nx = 70, ny = 50, nz = 40;
+  std::vector<unsigned char> data( nx * ny * nz, 0 );
+  for ( size_t j = 0; j < data.size(); j++ )
+  {
+    data[ j ] = ( j / 7 ) % 3 == 0 ? 1 : 0;
+  }
+
+  const size_t numThreads = 4;
+  for ( int run = 0; run < 10; run++ )
+  {
+    SparseMaskDataBlockHandle sparse = SparseMaskDataBlock::New( &data[ 0 ], 1, nx, ny, nz );
+    MaskDataBlockHandle mask( new MaskDataBlock( sparse ) );
+    EXPECT_TRUE(mask->is_sparse());
+
+    std::vector<size_t> mismatches( numThreads, 0 );
+    std::vector<unsigned char*> expanded( numThreads, 0 );
+    boost::thread_group threads;
+    for ( size_t t = 0; t < numThreads; t++ )
+    {
+      threads.create_thread( boost::bind( &readMask, mask, &data, &mismatches[ t ] ) );
+      threads.create_thread( boost::bind( &expandMask, mask, &expanded[ t ] ) );
+    }
+    threads.join_all();
+
+    EXPECT_FALSE(mask->is_sparse());
+    EXPECT_EQ(0u, sparse->get_sparse_byte_size());
+    for ( size_t t = 0; t < numThreads; t++ )
+    {
+      EXPECT_EQ(0u, mismatches[ t ]);
+      EXPECT_EQ(expanded[ 0 ], expanded[ t ]);
+    }
+    ASSERT_TRUE(std::equal( data.begin(), data.end(), expanded[ 0 ] ));
+  }
+}
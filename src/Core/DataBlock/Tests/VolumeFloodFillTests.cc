@@ -0,0 +1,196 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <boost/bind.hpp>
+
+#include <Core/DataBlock/VolumeFloodFill.h>
+
+using namespace Core;
+
+static void CopyOpenSlice( const std::vector<unsigned char>* open, size_t slice_size,
+  size_t z, unsigned char* buffer )
+{
+  std::memcpy( buffer, &( *open )[ z * slice_size ], slice_size );
+}
+
+static void MarkFilled( std::vector<unsigned char>* filled, size_t begin, size_t end )
+{
+  for ( size_t j = begin; j < end; j++ ) ( *filled )[ j ]++;
+}
+
+static bool RecordProgress( std::vector<double>* progress, double fraction )
+{
+  progress->push_back( fraction );
+  return true;
+}
+
+static bool AbortAfter( size_t* num_calls, size_t max_calls, double )
+{
+  return ++( *num_calls ) < max_calls;
+}
+
+// Breadth first fill of single voxels
+static std::vector<unsigned char> ReferenceFill( const std::vector<unsigned char>& open,
+  int nx, int ny, int nz, const std::vector<IndexVector>& seeds )
+{
+  std::vector<unsigned char> filled( open.size(), 0 );
+  std::vector<size_t> queue;
+  for ( size_t j = 0; j < seeds.size(); j++ )
+  {
+    size_t index = seeds[ j ].x() + nx * ( seeds[ j ].y() + ny * seeds[ j ].z() );
+    if ( open[ index ] && !filled[ index ] ) { filled[ index ] = 1; queue.push_back( index ); }
+  }
+  for ( size_t q = 0; q < queue.size(); q++ )
+  {
+    int x = static_cast<int>( queue[ q ] % nx ), y = static_cast<int>( queue[ q ] / nx % ny );
+    int z = static_cast<int>( queue[ q ] / nx / ny );
+    const int offsets[ 6 ][ 3 ] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, 
+      { 0, 0, -1 }, { 0, 0, 1 } };
+    for ( int k = 0; k < 6; k++ )
+    {
+      int px = x + offsets[ k ][ 0 ], py = y + offsets[ k ][ 1 ], pz = z + offsets[ k ][ 2 ];
+      if ( px < 0 || px >= nx || py < 0 || py >= ny || pz < 0 || pz >= nz ) continue;
+      size_t index = px + nx * ( py + ny * pz );
+      if ( open[ index ] && !filled[ index ] ) { filled[ index ] = 1; queue.push_back( index ); }
+    }
+  }
+  return filled;
+}
+
+static void CheckFill( int nx, int ny, int nz, int density, unsigned int seed )
+{
+  std::srand( seed );
+  std::vector<unsigned char> open( nx * ny * nz );
+  for ( size_t j = 0; j < open.size(); j++ ) open[ j ] = ( std::rand() % 1000 ) < density;
+
+  std::vector<IndexVector> seeds;
+  seeds.push_back( IndexVector( nx / 2, ny / 2, nz / 2 ) );
+  seeds.push_back( IndexVector( 0, ny - 1, nz - 1 ) );
+  seeds.push_back( IndexVector( nx, 0, 0 ) );
+
+  std::vector<unsigned char> filled( open.size(), 0 );
+  std::vector<double> progress;
+  IndexVector min, max;
+  size_t num_filled = 0;
+  ASSERT_TRUE( VolumeFloodFill::Fill( nx, ny, nz, seeds, 
+    boost::bind( &CopyOpenSlice, &open, static_cast<size_t>( nx * ny ), _1, _2 ),
+    boost::bind( &MarkFilled, &filled, _1, _2 ), boost::bind( &RecordProgress, &progress, _1 ),
+    min, max, num_filled ) );
+
+  // The progress only grows and ends when the fill is done
+  ASSERT_FALSE( progress.empty() );
+  EXPECT_TRUE( std::is_sorted( progress.begin(), progress.end() ) );
+  EXPECT_EQ( 1.0, progress.back() );
+
+  // Every voxel is filled at most once
+  seeds.pop_back();
+  std::vector<unsigned char> expected = ReferenceFill( open, nx, ny, nz, seeds );
+  ASSERT_TRUE( filled == expected );
+
+  size_t count = 0;
+  IndexVector expected_min( nx, ny, nz ), expected_max( -1, -1, -1 );
+  for ( int z = 0; z < nz; z++ ) for ( int y = 0; y < ny; y++ ) for ( int x = 0; x < nx; x++ )
+  {
+    if ( !expected[ x + nx * ( y + ny * z ) ] ) continue;
+    count++;
+    IndexVector p( x, y, z );
+    for ( size_t k = 0; k < 3; k++ )
+    {
+      expected_min[ k ] = std::min( expected_min[ k ], p[ k ] );
+      expected_max[ k ] = std::max( expected_max[ k ], p[ k ] );
+    }
+  }
+  EXPECT_EQ( count, num_filled );
+  if ( count > 0 )
+  {
+    EXPECT_TRUE( min == expected_min );
+    EXPECT_TRUE( max == expected_max );
+  }
+}
+
+TEST(VolumeFloodFillTests, MatchesReferenceFill)
+{
+  // Sparse volumes give small regions, dense ones a single large region
+  CheckFill( 67, 31, 23, 400, 1 );
+  CheckFill( 67, 31, 23, 700, 2 );
+  CheckFill( 1, 1, 1, 1000, 3 );
+  CheckFill( 64, 1, 50, 650, 4 );
+}
+
+TEST(VolumeFloodFillTests, LargeRegionFillsInParallel)
+{
+  // The region exceeds the size at which the fill switches to parallel rounds
+  CheckFill( 130, 128, 100, 750, 5 );
+  CheckFill( 40, 37, 2000, 800, 6 );
+}
+
+TEST(VolumeFloodFillTests, LargeSlabContinuesInNextRound)
+{
+  // A single slab holds more voxels than a task fills in one round
+  CheckFill( 2500, 2500, 1, 1000, 7 );
+}
+
+TEST(VolumeFloodFillTests, Abort)
+{
+  // A single slab that takes several rounds to fill
+  const size_t nx = 2500, ny = 2500, nz = 1;
+  std::vector<unsigned char> open( nx * ny * nz, 1 );
+  std::vector<IndexVector> seeds( 1, IndexVector( 0, 0, 0 ) );
+
+  // Abort once the voxels that may be filled are known, before any voxel is filled
+  std::vector<unsigned char> filled( open.size(), 0 );
+  size_t num_calls = 0;
+  IndexVector min, max;
+  size_t num_filled = 0;
+  EXPECT_FALSE( VolumeFloodFill::Fill( nx, ny, nz, seeds, 
+    boost::bind( &CopyOpenSlice, &open, nx * ny, _1, _2 ),
+    boost::bind( &MarkFilled, &filled, _1, _2 ), boost::bind( &AbortAfter, &num_calls, 1, _1 ),
+    min, max, num_filled ) );
+  EXPECT_EQ( 1u, num_calls );
+  EXPECT_EQ( 0u, num_filled );
+  EXPECT_EQ( 0, std::count( filled.begin(), filled.end(), 1 ) );
+
+  // Abort in between the parallel rounds, which leaves part of the region filled
+  num_calls = 0;
+  EXPECT_FALSE( VolumeFloodFill::Fill( nx, ny, nz, seeds, 
+    boost::bind( &CopyOpenSlice, &open, nx * ny, _1, _2 ),
+    boost::bind( &MarkFilled, &filled, _1, _2 ), boost::bind( &AbortAfter, &num_calls, 3, _1 ),
+    min, max, num_filled ) );
+  EXPECT_EQ( 3u, num_calls );
+  EXPECT_LT( num_filled, open.size() );
+  EXPECT_EQ( static_cast<std::ptrdiff_t>( num_filled ), 
+    std::count( filled.begin(), filled.end(), 1 ) );
+}
@@ -0,0 +1,422 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <limits>
+#include <new>
+
+// Boost includes
+#include <boost/bind.hpp>
+
+// Core includes
+#include <Core/DataBlock/VolumeFloodFill.h>
+#include <Core/Utils/TaskScheduler.h>
+
+namespace Core
+{
+
+// The open voxels are stored as bits, every row starts with a new word, hence different slices
+// never share a word
+typedef unsigned long long word_type;
+static const size_t WORD_BITS_C = 64;
+static const word_type ALL_BITS_C = ~static_cast< word_type >( 0 );
+
+// Once the region holds this many voxels the remaining spans are expanded in parallel
+static const size_t PARALLEL_THRESHOLD_C = 1 << 20;
+
+// The number of voxels a task fills in one round before it passes its remaining spans on to
+// the next round, so that long fills report progress and can be aborted
+static const size_t ROUND_VOXELS_C = 1 << 22;
+
+// The number of slabs per worker thread, so that the slabs that hold most of the region can
+// be spread over all the threads
+static const size_t SLABS_PER_THREAD_C = 4;
+
+// CLASS FloodFillSpan:
+// The voxels [x0, x1) in row y of slice z
+
+class FloodFillSpan
+{
+public:
+  FloodFillSpan( size_t x0, size_t x1, size_t y, size_t z ) :
+    x0_( x0 ), x1_( x1 ), y_( y ), z_( z )
+  {
+  }
+
+  size_t x0_;
+  size_t x1_;
+  size_t y_;
+  size_t z_;
+};
+
+static inline bool SpanSliceLess( const FloodFillSpan& span1, const FloodFillSpan& span2 )
+{
+  return span1.z_ < span2.z_;
+}
+
+// CLASS FloodFillRegion:
+// The number of filled voxels and their bounding box
+
+class FloodFillRegion
+{
+public:
+  FloodFillRegion() :
+    num_filled_( 0 ), 
+    min_( std::numeric_limits< IndexVector::index_type >::max(), 
+      std::numeric_limits< IndexVector::index_type >::max(),
+      std::numeric_limits< IndexVector::index_type >::max() ),
+    max_( -1, -1, -1 )
+  {
+  }
+
+  void add( const FloodFillSpan& span )
+  {
+    this->num_filled_ += span.x1_ - span.x0_;
+    this->add( IndexVector( span.x0_, span.y_, span.z_ ), 
+      IndexVector( span.x1_ - 1, span.y_, span.z_ ) );
+  }
+
+  void add( const FloodFillRegion& region )
+  {
+    this->num_filled_ += region.num_filled_;
+    if ( region.num_filled_ > 0 ) this->add( region.min_, region.max_ );
+  }
+
+  size_t num_filled_;
+  IndexVector min_;
+  IndexVector max_;
+
+private:
+  void add( const IndexVector& min, const IndexVector& max )
+  {
+    for ( size_t j = 0; j < 3; j++ )
+    {
+      this->min_[ j ] = std::min( this->min_[ j ], min[ j ] );
+      this->max_[ j ] = std::max( this->max_[ j ], max[ j ] );
+    }
+  }
+};
+
+// CLASS VolumeFloodFillAlgo:
+// The state of one flood fill
+
+class VolumeFloodFillAlgo
+{
+public:
+  VolumeFloodFillAlgo( size_t nx, size_t ny, size_t nz, 
+    const VolumeFloodFill::open_function_type& open, 
+    const VolumeFloodFill::fill_function_type& fill,
+    const VolumeFloodFill::progress_function_type& progress ) :
+    nx_( nx ), ny_( ny ), nz_( nz ), row_words_( ( nx + WORD_BITS_C - 1 ) / WORD_BITS_C ),
+    open_function_( open ), fill_function_( fill ), progress_function_( progress )
+  {
+    size_t num_threads = static_cast< size_t >( 
+      std::max( TaskScheduler::Instance()->get_num_threads(), 1 ) );
+    size_t num_slabs = std::max< size_t >( std::min( nz, SLABS_PER_THREAD_C * num_threads ), 1 );
+    this->slab_size_ = std::max< size_t >( ( nz + num_slabs - 1 ) / num_slabs, 1 );
+  }
+
+  bool run( const std::vector< IndexVector >& seeds, FloodFillRegion& region );
+
+private:
+  // BUILD_OPEN:
+  // Convert the open voxels of the slices [begin, end) into bits
+  void build_open( size_t begin, size_t end );
+
+  // FILL_SLABS:
+  // Fill the slabs of the frontier groups [begin, end) for the parallel phase
+  void fill_slabs( size_t begin, size_t end );
+
+  // FILL_SPANS:
+  // Fill the open voxels that are reachable from the spans on the stack. New spans within the
+  // same slab go onto the stack, spans in the neighboring slabs go onto next if it is given
+  // and onto the stack otherwise. When limit is non-zero the fill stops once the region holds
+  // at least limit voxels, leaving the remaining spans on the stack.
+  void fill_spans( std::vector< FloodFillSpan >& stack, std::vector< FloodFillSpan >* next, 
+    FloodFillRegion& region, size_t limit );
+
+  size_t get_slab( size_t z ) const
+  {
+    return z / this->slab_size_;
+  }
+
+  word_type* get_row( size_t y, size_t z )
+  {
+    return &this->open_[ ( z * this->ny_ + y ) * this->row_words_ ];
+  }
+
+  static bool is_open( const word_type* row, size_t x )
+  {
+    return ( row[ x / WORD_BITS_C ] >> ( x % WORD_BITS_C ) & 1 ) != 0;
+  }
+
+  // FIND_OPEN:
+  // Find the first open voxel in [x, end) of the row, returns end if there is none
+  static size_t find_open( const word_type* row, size_t x, size_t end );
+
+  // CLEAR_OPEN:
+  // Remove the voxels [begin, end) of the row from the open set
+  static void clear_open( word_type* row, size_t begin, size_t end );
+
+  size_t nx_;
+  size_t ny_;
+  size_t nz_;
+  size_t row_words_;
+
+  // The number of slices of the slabs of the parallel phase
+  size_t slab_size_;
+
+  const VolumeFloodFill::open_function_type& open_function_;
+  const VolumeFloodFill::fill_function_type& fill_function_;
+  const VolumeFloodFill::progress_function_type& progress_function_;
+
+  std::vector< word_type > open_;
+
+  // The number of open voxels in each slice
+  std::vector< size_t > slice_open_;
+
+  // The spans of the current parallel round, sorted by slice, and the start of the group of
+  // spans of every slab
+  std::vector< FloodFillSpan > frontier_;
+  std::vector< size_t > group_start_;
+
+  // The results of each group in the current parallel round
+  std::vector< std::vector< FloodFillSpan > > next_;
+  std::vector< FloodFillRegion > regions_;
+};
+
+size_t VolumeFloodFillAlgo::find_open( const word_type* row, size_t x, size_t end )
+{
+  while ( x < end )
+  {
+    word_type word = row[ x / WORD_BITS_C ] >> ( x % WORD_BITS_C );
+    if ( word == 0 )
+    {
+      // Skip the remainder of the word
+      x = ( x / WORD_BITS_C + 1 ) * WORD_BITS_C;
+      continue;
+    }
+    while ( ( word & 1 ) == 0 )
+    {
+      word >>= 1;
+      x++;
+    }
+    return std::min( x, end );
+  }
+  return end;
+}
+
+void VolumeFloodFillAlgo::clear_open( word_type* row, size_t begin, size_t end )
+{
+  while ( begin < end )
+  {
+    size_t word_end = std::min( ( begin / WORD_BITS_C + 1 ) * WORD_BITS_C, end );
+    size_t num_bits = word_end - begin;
+    word_type bits = num_bits == WORD_BITS_C ? ALL_BITS_C : 
+      ( ( static_cast< word_type >( 1 ) << num_bits ) - 1 );
+    row[ begin / WORD_BITS_C ] &= ~( bits << ( begin % WORD_BITS_C ) );
+    begin = word_end;
+  }
+}
+
+bool VolumeFloodFillAlgo::run( const std::vector< IndexVector >& seeds, 
+  FloodFillRegion& region )
+{
+  std::vector< FloodFillSpan > stack;
+  try
+  {
+    this->open_.resize( this->row_words_ * this->ny_ * this->nz_ );
+    this->slice_open_.resize( this->nz_ );
+  }
+  catch ( std::bad_alloc& )
+  {
+    return false;
+  }
+
+  for ( size_t j = 0; j < seeds.size(); j++ )
+  {
+    const IndexVector& seed = seeds[ j ];
+    if ( seed.x() >= 0 && seed.x() < static_cast< IndexVector::index_type >( this->nx_ ) &&
+      seed.y() >= 0 && seed.y() < static_cast< IndexVector::index_type >( this->ny_ ) &&
+      seed.z() >= 0 && seed.z() < static_cast< IndexVector::index_type >( this->nz_ ) )
+    {
+      size_t x = static_cast< size_t >( seed.x() );
+      stack.push_back( FloodFillSpan( x, x + 1, static_cast< size_t >( seed.y() ), 
+        static_cast< size_t >( seed.z() ) ) );
+    }
+  }
+  if ( stack.empty() ) return true;
+
+  ParallelFor( 0, this->nz_, boost::bind( &VolumeFloodFillAlgo::build_open, this, _1, _2 ) );
+  double num_open = 0.0;
+  for ( size_t z = 0; z < this->nz_; z++ ) num_open += this->slice_open_[ z ];
+  if ( !this->progress_function_( 0.1 ) ) return false;
+
+  // Small regions are filled by this thread
+  this->fill_spans( stack, 0, region, PARALLEL_THRESHOLD_C );
+
+  // Large regions are expanded in rounds, with one task per slab in the frontier
+  this->frontier_.swap( stack );
+  while ( !this->frontier_.empty() )
+  {
+    // NOTE: The region can only grow into the open voxels
+    if ( !this->progress_function_( 0.1 + 0.9 * region.num_filled_ / num_open ) ) return false;
+
+    std::sort( this->frontier_.begin(), this->frontier_.end(), SpanSliceLess );
+    this->group_start_.clear();
+    for ( size_t j = 0; j < this->frontier_.size(); j++ )
+    {
+      if ( j == 0 || this->get_slab( this->frontier_[ j ].z_ ) != 
+        this->get_slab( this->frontier_[ j - 1 ].z_ ) )
+      {
+        this->group_start_.push_back( j );
+      }
+    }
+    size_t num_groups = this->group_start_.size();
+    this->group_start_.push_back( this->frontier_.size() );
+
+    this->next_.clear();
+    this->next_.resize( num_groups );
+    this->regions_.clear();
+    this->regions_.resize( num_groups );
+    ParallelFor( 0, num_groups, boost::bind( &VolumeFloodFillAlgo::fill_slabs, 
+      this, _1, _2 ), 1 );
+
+    this->frontier_.clear();
+    for ( size_t j = 0; j < num_groups; j++ )
+    {
+      region.add( this->regions_[ j ] );
+      this->frontier_.insert( this->frontier_.end(), this->next_[ j ].begin(), 
+        this->next_[ j ].end() );
+    }
+  }
+
+  return this->progress_function_( 1.0 );
+}
+
+void VolumeFloodFillAlgo::build_open( size_t begin, size_t end )
+{
+  std::vector< unsigned char > buffer( this->nx_ * this->ny_ );
+  for ( size_t z = begin; z < end; z++ )
+  {
+    this->open_function_( z, &buffer[ 0 ] );
+    const unsigned char* open = &buffer[ 0 ];
+    size_t num_open = 0;
+    for ( size_t y = 0; y < this->ny_; y++, open += this->nx_ )
+    {
+      word_type* row = this->get_row( y, z );
+      for ( size_t x = 0; x < this->nx_; x++ )
+      {
+        if ( open[ x ] ) 
+        {
+          row[ x / WORD_BITS_C ] |= static_cast< word_type >( 1 ) << ( x % WORD_BITS_C );
+          num_open++;
+        }
+      }
+    }
+    this->slice_open_[ z ] = num_open;
+  }
+}
+
+void VolumeFloodFillAlgo::fill_slabs( size_t begin, size_t end )
+{
+  for ( size_t j = begin; j < end; j++ )
+  {
+    std::vector< FloodFillSpan > stack( this->frontier_.begin() + this->group_start_[ j ],
+      this->frontier_.begin() + this->group_start_[ j + 1 ] );
+    this->fill_spans( stack, &this->next_[ j ], this->regions_[ j ], ROUND_VOXELS_C );
+
+    // The spans that were not reached in this round are continued in the next one
+    this->next_[ j ].insert( this->next_[ j ].end(), stack.begin(), stack.end() );
+  }
+}
+
+void VolumeFloodFillAlgo::fill_spans( std::vector< FloodFillSpan >& stack, 
+  std::vector< FloodFillSpan >* next, FloodFillRegion& region, size_t limit )
+{
+  while ( !stack.empty() && ( limit == 0 || region.num_filled_ < limit ) )
+  {
+    FloodFillSpan span = stack.back();
+    stack.pop_back();
+
+    word_type* row = this->get_row( span.y_, span.z_ );
+    size_t x = find_open( row, span.x0_, span.x1_ );
+    while ( x < span.x1_ )
+    {
+      // Extend the span to the full run of open voxels
+      size_t begin = x;
+      while ( begin > 0 && is_open( row, begin - 1 ) ) begin--;
+      size_t end = x + 1;
+      while ( end < this->nx_ && is_open( row, end ) ) end++;
+      clear_open( row, begin, end );
+
+      size_t base = ( span.z_ * this->ny_ + span.y_ ) * this->nx_;
+      this->fill_function_( base + begin, base + end );
+
+      FloodFillSpan filled( begin, end, span.y_, span.z_ );
+      region.add( filled );
+      if ( span.y_ > 0 ) stack.push_back( FloodFillSpan( begin, end, span.y_ - 1, span.z_ ) );
+      if ( span.y_ + 1 < this->ny_ ) 
+      {
+        stack.push_back( FloodFillSpan( begin, end, span.y_ + 1, span.z_ ) );
+      }
+      size_t slab = this->get_slab( span.z_ );
+      if ( span.z_ > 0 ) 
+      {
+        size_t z = span.z_ - 1;
+        ( next && this->get_slab( z ) != slab ? *next : stack ).push_back( 
+          FloodFillSpan( begin, end, span.y_, z ) );
+      }
+      if ( span.z_ + 1 < this->nz_ ) 
+      {
+        size_t z = span.z_ + 1;
+        ( next && this->get_slab( z ) != slab ? *next : stack ).push_back( 
+          FloodFillSpan( begin, end, span.y_, z ) );
+      }
+
+      x = find_open( row, end, span.x1_ );
+    }
+  }
+}
+
+bool VolumeFloodFill::Fill( size_t nx, size_t ny, size_t nz, 
+  const std::vector< IndexVector >& seeds, open_function_type open, fill_function_type fill,
+  progress_function_type progress, IndexVector& min, IndexVector& max, size_t& num_filled )
+{
+  FloodFillRegion region;
+  VolumeFloodFillAlgo algo( nx, ny, nz, open, fill, progress );
+  bool success = algo.run( seeds, region );
+
+  num_filled = region.num_filled_;
+  min = region.min_;
+  max = region.max_;
+  return success;
+}
+
+} // end namespace Core
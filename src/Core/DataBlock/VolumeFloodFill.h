@@ -0,0 +1,88 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_DATABLOCK_VOLUMEFLOODFILL_H
+#define CORE_DATABLOCK_VOLUMEFLOODFILL_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <cstddef>
+#include <vector>
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+// Core includes
+#include <Core/Geometry/IndexVector.h>
+
+namespace Core
+{
+
+// CLASS VolumeFloodFill:
+/// Flood fill of a volume with 6-connectivity, using spans of voxels along x. The voxels that
+/// may be filled are kept in a bit set from which each filled span is removed. Small regions
+/// are filled by the calling thread with a stack of spans. Once a region grows beyond a
+/// threshold, the volume is split into slabs of slices and the remaining spans are expanded in
+/// parallel rounds. In every round each slab is filled by one task, which follows the region
+/// through all the slices of its slab and passes on the spans that reach into the neighboring
+/// slabs to the next round.
+
+class VolumeFloodFill : public boost::noncopyable
+{
+public:
+  // The open function writes one byte for each voxel of slice z, with x running fastest, that
+  // is non-zero if the voxel may be filled. It is called from several threads at the same time.
+  typedef boost::function< void ( size_t z, unsigned char* open ) > open_function_type;
+
+  // The fill function is called with the first and one past the last index of each span of
+  // voxels that is filled. Spans in different slices may be reported from different threads
+  // at the same time.
+  typedef boost::function< void ( size_t begin, size_t end ) > fill_function_type;
+
+  // The progress function is called by the calling thread in between the rounds of the fill
+  // with the fraction that is done. When it returns false the fill is aborted.
+  typedef boost::function< bool ( double ) > progress_function_type;
+
+  // FILL:
+  /// Fill the region of open voxels that is connected to the seeds. Seeds outside the volume
+  /// or on voxels that are not open are ignored. The bounding box of the filled voxels is
+  /// returned in min and max, which are only valid if num_filled is larger than zero. Returns
+  /// false if the fill was aborted or if not enough memory could be allocated, in which case
+  /// only part of the region may have been filled.
+  static bool Fill( size_t nx, size_t ny, size_t nz, const std::vector< IndexVector >& seeds,
+    open_function_type open, fill_function_type fill, progress_function_type progress,
+    IndexVector& min, IndexVector& max, size_t& num_filled );
+};
+
+} // end namespace Core
+
+#endif
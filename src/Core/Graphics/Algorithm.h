@@ -37,6 +37,7 @@
 #undef max
 #endif
 
+#include <stack>
 #include <vector>
 #include <utility>
 
@@ -46,7 +46,15 @@
 #include <itkImageRegionConstIteratorWithIndex.h>
 
 // Boost includes:
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/tss.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+
+// system includes:
+#include <map>
 
 // local includes:
 #include <Core/ITKCommon/FFT/fft.hxx>
@@ -89,15 +97,270 @@ namespace itk_fft
   }
   
   
+  //----------------------------------------------------------------
+  // FFTW_PLANNER_MODE
+  // 
+  static fftw_planner_mode_t FFTW_PLANNER_MODE = FFTW_PLANNER_ESTIMATE_E;
+  
+  //----------------------------------------------------------------
+  // set_fftw_planner_mode
+  // 
+  // set's the planner mode used for new plans, returns previous value:
+  fftw_planner_mode_t set_fftw_planner_mode(fftw_planner_mode_t mode)
+  {
+    the_lock_t<the_mutex_interface_t> lock(fftw_mutex());
+    fftw_planner_mode_t prev = FFTW_PLANNER_MODE;
+    FFTW_PLANNER_MODE = mode;
+    return prev;
+  }
+  
+  //----------------------------------------------------------------
+  // fftw_planner_mode_from_string
+  // 
+  bool fftw_planner_mode_from_string(const std::string & str,
+                                     fftw_planner_mode_t & mode)
+  {
+    std::string lower = boost::to_lower_copy(str);
+    if (lower == "estimate")
+    {
+      mode = FFTW_PLANNER_ESTIMATE_E;
+    }
+    else if (lower == "measure")
+    {
+      mode = FFTW_PLANNER_MEASURE_E;
+    }
+    else if (lower == "patient")
+    {
+      mode = FFTW_PLANNER_PATIENT_E;
+    }
+    else
+    {
+      return false;
+    }
+    
+    return true;
+  }
+  
+  //----------------------------------------------------------------
+  // fftw_planner_flags
+  // 
+  static unsigned int fftw_planner_flags(fftw_planner_mode_t mode)
+  {
+    switch (mode)
+    {
+      case FFTW_PLANNER_MEASURE_E: return FFTW_MEASURE;
+      case FFTW_PLANNER_PATIENT_E: return FFTW_PATIENT;
+      default: return FFTW_ESTIMATE;
+    }
+  }
+  
+  //----------------------------------------------------------------
+  // FFTW_WISDOM_FILE
+  // 
+  static std::string FFTW_WISDOM_FILE;
+  
+  //----------------------------------------------------------------
+  // load_fftw_wisdom_file
+  // 
+  // NOTE: the caller must hold the fftw mutex:
+  static bool load_fftw_wisdom_file(const std::string & filename)
+  {
+    if (FFTW_WISDOM_FILE == filename)
+    {
+      return true;
+    }
+    
+    FFTW_WISDOM_FILE = filename;
+    if (filename.empty() || !boost::filesystem::exists(filename))
+    {
+      return true;
+    }
+    
+    return fftwf_import_wisdom_from_filename(filename.c_str()) != 0;
+  }
+  
+  //----------------------------------------------------------------
+  // set_fftw_wisdom_file
+  // 
+  bool set_fftw_wisdom_file(const std::string & filename)
+  {
+    the_lock_t<the_mutex_interface_t> lock(fftw_mutex());
+    return load_fftw_wisdom_file(filename);
+  }
+  
+  //----------------------------------------------------------------
+  // save_fftw_wisdom
+  // 
+  // NOTE: the caller must hold the fftw mutex. The wisdom is written
+  // to a temporary file first, so that a concurrent run never reads
+  // a partially written file:
+  static void save_fftw_wisdom()
+  {
+    if (FFTW_WISDOM_FILE.empty())
+    {
+      return;
+    }
+    
+    std::string tmp_file = FFTW_WISDOM_FILE + ".tmp";
+    if (fftwf_export_wisdom_to_filename(tmp_file.c_str()) != 0)
+    {
+      boost::system::error_code ec;
+      boost::filesystem::rename(tmp_file, FFTW_WISDOM_FILE, ec);
+    }
+  }
+  
+  
+  //----------------------------------------------------------------
+  // fftw_planner_scope_t::fftw_planner_scope_t
+  // 
+  fftw_planner_scope_t::fftw_planner_scope_t(fftw_planner_mode_t mode,
+                                             const std::string & wisdom_file)
+  {
+    the_lock_t<the_mutex_interface_t> lock(fftw_mutex());
+    prev_mode_ = FFTW_PLANNER_MODE;
+    prev_wisdom_file_ = FFTW_WISDOM_FILE;
+    FFTW_PLANNER_MODE = mode;
+    wisdom_loaded_ = load_fftw_wisdom_file(wisdom_file);
+  }
+  
+  //----------------------------------------------------------------
+  // fftw_planner_scope_t::~fftw_planner_scope_t
+  // 
+  fftw_planner_scope_t::~fftw_planner_scope_t()
+  {
+    the_lock_t<the_mutex_interface_t> lock(fftw_mutex());
+    FFTW_PLANNER_MODE = prev_mode_;
+    if (FFTW_WISDOM_FILE == prev_wisdom_file_)
+    {
+      return;
+    }
+    
+    // plans that were already created keep working without the
+    // wisdom they were created from:
+    fftwf_forget_wisdom();
+    FFTW_WISDOM_FILE.clear();
+    load_fftw_wisdom_file(prev_wisdom_file_);
+  }
+  
+  
+  //----------------------------------------------------------------
+  // fft_plans_t
+  // 
+  // Forward and inverse plans for one image size. Plans are created
+  // once and shared by all threads, fftwf_execute_dft* is thread safe.
+  // 
+  class fft_plans_t
+  {
+  public:
+    // NOTE: the caller must hold the fftw mutex:
+    fft_plans_t(const unsigned int & w,
+                const unsigned int & h,
+                const std::size_t & num_threads,
+                const unsigned int & flags):
+    w_(w),
+    h_(h),
+    h_complex_(h / 2 + 1),
+    h_padded_((h / 2 + 1) * 2)
+    {
+      // measuring planners overwrite the arrays, so plan on scratch
+      // arrays allocated with the same alignment as the real data:
+      float * buffer = (float *)(fftwf_malloc(w_ * h_padded_ * sizeof(float)));
+      fftwf_plan_with_nthreads(num_threads);
+      fwd_ = fftwf_plan_dft_r2c_2d(w_,
+                                   h_,
+                                   buffer,
+                                   (fftwf_complex *)buffer,
+                                   FFTW_DESTROY_INPUT | flags);
+      fftwf_free(buffer);
+      
+      fftwf_complex * in = (fftwf_complex *)(fftwf_malloc(w_ * h_ * sizeof(fftwf_complex)));
+      fftwf_complex * out = (fftwf_complex *)(fftwf_malloc(w_ * h_ * sizeof(fftwf_complex)));
+      fftwf_plan_with_nthreads(num_threads);
+      inv_ = fftwf_plan_dft_2d(w_,
+                               h_,
+                               in,
+                               out,
+                               FFTW_BACKWARD,
+                               flags);
+      fftwf_free(in);
+      fftwf_free(out);
+    }
+    
+    ~fft_plans_t()
+    {
+      // fftw is not thread safe:
+      the_lock_t<the_mutex_interface_t> lock(fftw_mutex());
+      
+      if (fwd_) fftwf_destroy_plan(fwd_);
+      if (inv_) fftwf_destroy_plan(inv_);
+    }
+    
+    fftwf_plan fwd_; // analysis, forward fft
+    fftwf_plan inv_; // synthesis, inverse fft
+    unsigned int w_;
+    unsigned int h_;
+    unsigned int h_complex_;
+    unsigned int h_padded_;
+  };
+  
+  //----------------------------------------------------------------
+  // fft_plans_ptr_t
+  // 
+  typedef boost::shared_ptr<fft_plans_t> fft_plans_ptr_t;
+  
+  //----------------------------------------------------------------
+  // fft_plan_key_t
+  // 
+  // plans depend on the image size, the number of fftw threads
+  // and the planner flags:
+  typedef boost::tuple<unsigned int, unsigned int, std::size_t, unsigned int>
+  fft_plan_key_t;
+  
+  //----------------------------------------------------------------
+  // get_fft_plans
+  // 
+  // Find the shared plans for the given image size, or create them
+  // with the current number of threads and planner mode:
+  static fft_plans_ptr_t
+  get_fft_plans(const unsigned int & w, const unsigned int & h)
+  {
+    typedef std::map<fft_plan_key_t, fft_plans_ptr_t> plan_map_t;
+    static plan_map_t plans;
+    
+    // fftw is not thread safe:
+    the_lock_t<the_mutex_interface_t> lock(fftw_mutex());
+    
+    const unsigned int flags = fftw_planner_flags(FFTW_PLANNER_MODE);
+    fft_plan_key_t key(w, h, NUM_FFTW_THREADS, flags);
+    plan_map_t::iterator iter = plans.find(key);
+    if (iter != plans.end())
+    {
+      return iter->second;
+    }
+    
+    fft_plans_ptr_t new_plans(new fft_plans_t(w, h, NUM_FFTW_THREADS, flags));
+    plans[key] = new_plans;
+    
+    // measured plans are expensive, keep them for the next run:
+    if (flags != FFTW_ESTIMATE)
+    {
+      save_fftw_wisdom();
+    }
+    
+    return new_plans;
+  }
+  
+  
   //----------------------------------------------------------------
   // fft_cache_t
   // 
+  // Per thread scratch buffer for the in-place forward transform,
+  // together with the shared plans for its size.
+  // 
   class fft_cache_t
   {
   public:
     fft_cache_t():
-    fwd_(NULL),
-    inv_(NULL),
     w_(0),
     h_(0),
     h_complex_(0),
@@ -117,16 +380,11 @@ namespace itk_fft
         // fftw is not thread safe:
         the_lock_t<the_mutex_interface_t> lock(fftw_mutex());
         
-        fftwf_destroy_plan(fwd_);
-        fwd_ = NULL;
-        
-        fftwf_destroy_plan(inv_);
-        inv_ = NULL;
-        
         fftwf_free(buffer_);
         buffer_ = NULL;
       }
       
+      plans_.reset();
       w_ = 0;
       h_ = 0;
       h_complex_ = 0;
@@ -140,43 +398,26 @@ namespace itk_fft
         return;
       }
       
+      plans_ = get_fft_plans(w, h);
+      
       // fftw is not thread safe:
       the_lock_t<the_mutex_interface_t> lock(fftw_mutex());
       
       if (buffer_)
       {
-        fftwf_destroy_plan(fwd_);
-        fftwf_destroy_plan(inv_);
         fftwf_free(buffer_);
       }
       
       w_ = w;
       h_ = h;
       
-      h_complex_ = h_ / 2 + 1;
-      h_padded_ = h_complex_ * 2;
+      h_complex_ = plans_->h_complex_;
+      h_padded_ = plans_->h_padded_;
       
       buffer_ = (float *)(fftwf_malloc(w_ * h_padded_ * sizeof(float)));
-      fftwf_plan_with_nthreads(NUM_FFTW_THREADS);
-      fwd_ = fftwf_plan_dft_r2c_2d(w_,
-                                   h_,
-                                   buffer_,
-                                   (fftwf_complex *)buffer_,
-                                   FFTW_DESTROY_INPUT | FFTW_ESTIMATE);
-      
-      fft_data_t dummy_in(4, 4);
-      fft_data_t dummy_out(4, 4);
-      fftwf_plan_with_nthreads(NUM_FFTW_THREADS);
-      inv_ = fftwf_plan_dft_2d(w_,
-                               h_,
-                               (fftwf_complex *)(dummy_in.data()),
-                               (fftwf_complex *)(dummy_out.data()),
-                               FFTW_BACKWARD,
-                               FFTW_ESTIMATE);
     }
     
-    fftwf_plan fwd_; // analysis, forward fft
-    fftwf_plan inv_; // synthesis, inverse fft
+    fft_plans_ptr_t plans_;
     unsigned int w_;
     unsigned int h_;
     unsigned int h_complex_;
@@ -189,6 +430,22 @@ namespace itk_fft
   // 
   static boost::thread_specific_ptr<fft_cache_t> tss;
   
+  //----------------------------------------------------------------
+  // get_fft_cache
+  // 
+  static fft_cache_t *
+  get_fft_cache()
+  {
+    fft_cache_t * cache = tss.get();
+    if (!cache)
+    {
+      cache = new fft_cache_t();
+      tss.reset(cache);
+    }
+    
+    return cache;
+  }
+  
   //----------------------------------------------------------------
   // fft_data_t::fft_data_t
   // 
@@ -439,12 +696,7 @@ namespace itk_fft
     const unsigned int w = size[0];
     const unsigned int h = size[1];
     
-    fft_cache_t * cache = tss.get();
-    if (!cache)
-    {
-      cache = new fft_cache_t();
-      tss.reset(cache);
-    }
+    fft_cache_t * cache = get_fft_cache();
     cache->update(w, h);
     
     // iterate over the image:
@@ -459,8 +711,8 @@ namespace itk_fft
       cache->buffer_[i] = itex.Get();
     }
     
-    if (!cache->fwd_) return false;
-    fftwf_execute_dft_r2c(cache->fwd_,
+    if (!cache->plans_->fwd_) return false;
+    fftwf_execute_dft_r2c(cache->plans_->fwd_,
                           cache->buffer_,
                           (fftwf_complex *)(cache->buffer_));
     
@@ -497,13 +749,13 @@ namespace itk_fft
   {
     out.resize(in.nx(), in.ny());
     
-    fft_cache_t * cache = tss.get();
-    if (!cache)
-    {
-      return false;
-    }
+    // the forward transform usually had the same size, in which case
+    // the cached plans are used as they are:
+    fft_cache_t * cache = get_fft_cache();
+    cache->update(in.nx(), in.ny());
     
-    fftwf_execute_dft(cache->inv_,
+    if (!cache->plans_->inv_) return false;
+    fftwf_execute_dft(cache->plans_->inv_,
                       (fftwf_complex *)(in.data()),
                       (fftwf_complex *)(out.data()));
     return true;
@@ -44,6 +44,7 @@
 
 // system includes:
 #include <complex>
+#include <string>
 #include <stdlib.h>
 
 #include <Core/Utils/Exception.h>
@@ -57,6 +58,69 @@ namespace itk_fft
   // set's number of threads used by fftw, returns previous value:
   extern std::size_t set_num_fftw_threads(std::size_t num_threads);
   
+  //----------------------------------------------------------------
+  // fftw_planner_mode_t
+  // 
+  // ESTIMATE creates plans instantly, MEASURE and PATIENT time
+  // candidate algorithms and create faster plans at a higher
+  // one time cost per image size:
+  enum fftw_planner_mode_t
+  {
+    FFTW_PLANNER_ESTIMATE_E,
+    FFTW_PLANNER_MEASURE_E,
+    FFTW_PLANNER_PATIENT_E
+  };
+  
+  //----------------------------------------------------------------
+  // set_fftw_planner_mode
+  // 
+  // set's the planner mode used for new plans, returns previous value:
+  extern fftw_planner_mode_t set_fftw_planner_mode(fftw_planner_mode_t mode);
+  
+  //----------------------------------------------------------------
+  // fftw_planner_mode_from_string
+  // 
+  // parse "estimate", "measure" or "patient":
+  extern bool fftw_planner_mode_from_string(const std::string & str,
+                                            fftw_planner_mode_t & mode);
+  
+  //----------------------------------------------------------------
+  // set_fftw_wisdom_file
+  // 
+  // load fftw wisdom from the given file if it exists, and save the
+  // accumulated wisdom to it whenever a measured plan is created,
+  // so that later runs can skip measuring. Returns false if the
+  // file exists but could not be read:
+  extern bool set_fftw_wisdom_file(const std::string & filename);
+  
+  //----------------------------------------------------------------
+  // fftw_planner_scope_t
+  // 
+  // Sets the planner mode and wisdom file for the lifetime of this
+  // object. The previous planner mode and wisdom file are restored
+  // when it goes out of scope, and wisdom loaded for this scope is
+  // forgotten, so later plans are created as if it never existed:
+  class fftw_planner_scope_t
+  {
+  public:
+    fftw_planner_scope_t(fftw_planner_mode_t mode,
+                         const std::string & wisdom_file);
+    ~fftw_planner_scope_t();
+    
+    // false if the wisdom file exists but could not be read:
+    bool wisdom_loaded() const
+    { return wisdom_loaded_; }
+    
+  private:
+    // disable default copy constructor and assignment operator:
+    fftw_planner_scope_t(const fftw_planner_scope_t &);
+    fftw_planner_scope_t & operator = (const fftw_planner_scope_t &);
+    
+    fftw_planner_mode_t prev_mode_;
+    std::string prev_wisdom_file_;
+    bool wisdom_loaded_;
+  };
+  
   //----------------------------------------------------------------
   // itk_image_t
   // 
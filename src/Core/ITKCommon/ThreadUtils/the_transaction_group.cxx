@@ -0,0 +1,127 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+ 
+ The MIT License
+ 
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+ 
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+// File         : the_transaction_group.cxx
+// Description  : Run transactions on the shared task scheduler.
+
+// local includes:
+#include <Core/ITKCommon/ThreadUtils/the_transaction_group.hxx>
+
+// Core includes:
+#include <Core/Utils/TaskScheduler.h>
+
+// Boost includes:
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+//----------------------------------------------------------------
+// execute_transaction
+// 
+static void
+execute_transaction(the_transaction_t * t)
+{
+  try
+  {
+    t->set_state(the_transaction_t::STARTED_E);
+    t->execute(NULL);
+    t->set_state(the_transaction_t::DONE_E);
+  }
+  catch (...)
+  {
+    // same as the thread pool, an interrupted or failed
+    // transaction is simply aborted:
+    t->set_state(the_transaction_t::ABORTED_E);
+  }
+  
+  delete t;
+}
+
+//----------------------------------------------------------------
+// the_transaction_queue_t
+// 
+// Transactions shared by a limited number of tasks.
+// 
+class the_transaction_queue_t
+{
+public:
+  the_transaction_queue_t(std::list<the_transaction_t *> & schedule)
+  { schedule_.splice(schedule_.end(), schedule); }
+  
+  // execute transactions until none are left:
+  void run()
+  {
+    while (true)
+    {
+      the_transaction_t * t = NULL;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        if (schedule_.empty()) return;
+        
+        t = schedule_.front();
+        schedule_.pop_front();
+      }
+      
+      execute_transaction(t);
+    }
+  }
+  
+private:
+  boost::mutex mutex_;
+  std::list<the_transaction_t *> schedule_;
+};
+
+//----------------------------------------------------------------
+// run_transactions
+// 
+void
+run_transactions(std::list<the_transaction_t *> & schedule,
+                 unsigned int max_concurrency)
+{
+  Core::TaskGroup group;
+  
+  if (max_concurrency > 0 && max_concurrency < schedule.size())
+  {
+    the_transaction_queue_t queue(schedule);
+    for (unsigned int i = 0; i < max_concurrency; i++)
+    {
+      group.run(boost::bind(&the_transaction_queue_t::run, &queue));
+    }
+    
+    group.wait();
+    return;
+  }
+  
+  while (!schedule.empty())
+  {
+    group.run(boost::bind(&execute_transaction, schedule.front()));
+    schedule.pop_front();
+  }
+  
+  group.wait();
+}
@@ -0,0 +1,61 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+ 
+ The MIT License
+ 
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+ 
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+// File         : the_transaction_group.hxx
+// Description  : Run transactions on the shared task scheduler.
+
+#ifndef THE_TRANSACTION_GROUP_HXX_
+#define THE_TRANSACTION_GROUP_HXX_
+
+// system includes:
+#include <list>
+
+// local includes:
+#include <Core/ITKCommon/ThreadUtils/the_transaction.hxx>
+
+
+//----------------------------------------------------------------
+// run_transactions
+// 
+// Execute the scheduled transactions on the workers of the
+// Core::TaskScheduler and wait until all of them are finished.
+// The transactions are deleted once they are done, and the
+// schedule is left empty.
+// 
+// When max_concurrency is not zero at most that many transactions
+// are executed at the same time.
+// 
+// NOTE: the transactions are executed without a thread interface,
+// the thread argument of execute will be NULL.
+// 
+extern void
+run_transactions(std::list<the_transaction_t *> & schedule,
+                 unsigned int max_concurrency = 0);
+
+
+#endif // THE_TRANSACTION_GROUP_HXX_
@@ -38,7 +38,7 @@
 #include <stack>
 
 // the includes:
-#include <Core/ITKCommon/ThreadUtils/the_thread_pool.hxx>
+#include <Core/ITKCommon/ThreadUtils/the_transaction_group.hxx>
 #include <Core/ITKCommon/Transform/IRRefineTranslateCanvas.hxx>
 #include <Core/ITKCommon/Transform/IRTransform.hxx>
 #include <Core/ITKCommon/Transform/IRConnection.hxx>
@@ -267,7 +267,7 @@ public:
   // virtual:
   void execute(the_thread_interface_t * thread)
   {
-    the_terminator_t terminator("IRTransaction");
+    WRAP(the_terminator_t terminator("IRTransaction"));
     canvas_->findOffsetsThreadEntry();
   }
   
@@ -280,17 +280,14 @@ public:
 void
 IRRefineTranslateCanvas::findIdealTransformationOffsets(unsigned int numThreads)
 {
-  the_thread_pool_t thread_pool(numThreads);
-  thread_pool.set_idle_sleep_duration(50); // 50 usec
-  
+  std::list<the_transaction_t *> schedule;
   for(unsigned int i = 0; i < numThreads; i++)
   {
     IRTransaction * t = new IRTransaction(this);
-    thread_pool.push_back(t);
+    schedule.push_back(t);
   }
   
-  thread_pool.start();
-  thread_pool.wait();
+  run_transactions(schedule);
 }
 
 //----------------------------------------------------------------
@@ -44,6 +44,7 @@
 #include <Core/ITKCommon/ThreadUtils/the_boost_thread.hxx>
 #include <Core/ITKCommon/ThreadUtils/the_transaction.hxx>
 #include <Core/ITKCommon/ThreadUtils/the_thread_pool.hxx>
+#include <Core/ITKCommon/ThreadUtils/the_transaction_group.hxx>
 #include <Core/ITKCommon/Filtering/itkNormalizeImageFilterWithMask.h>
 #include <Core/ITKCommon/Transform/itkLegendrePolynomialTransform.h>
 
@@ -3097,16 +3098,9 @@ make_mosaic_mt
     schedule.push_back(t);
   }
   
-  // setup the thread pool:
-  the_thread_pool_t thread_pool(num_threads);
-  thread_pool.set_idle_sleep_duration(50); // 50 usec
-  thread_pool.push_back(schedule);
-  thread_pool.pre_distribute_work();
-  
   // execute mosaic assembly transactions:
   suspend_itk_multithreading_t suspend_itk_mt;
-  thread_pool.start();
-  thread_pool.wait();
+  run_transactions(schedule);
   
   // done:
   return mosaic;
@@ -3742,16 +3736,9 @@ make_mask_mt(unsigned int num_threads,
     schedule.push_back(t);
   }
   
-  // setup the thread pool:
-  the_thread_pool_t thread_pool(num_threads);
-  thread_pool.set_idle_sleep_duration(50); // 50 usec
-  thread_pool.push_back(schedule);
-  thread_pool.pre_distribute_work();
-  
   // execute mosaic assembly transactions:
   suspend_itk_multithreading_t suspend_itk_mt;
-  thread_pool.start();
-  thread_pool.wait();
+  run_transactions(schedule);
   
   // done:
   return mosaic;
@@ -41,7 +41,7 @@
 #include <Core/ITKCommon/Optimizers/itkImageMosaicVarianceMetric.h>
 #include <Core/ITKCommon/Optimizers/itkRegularStepGradientDescentOptimizer2.h>
 #include <Core/ITKCommon/the_aa_bbox.hxx>
-#include <Core/ITKCommon/ThreadUtils/the_thread_pool.hxx>
+#include <Core/ITKCommon/ThreadUtils/the_transaction_group.hxx>
 
 // system includes:
 #include <math.h>
@@ -657,9 +657,6 @@ calc_displacements_mt(unsigned int num_threads,
                                             1.0,
                                             0.0);
   
-  the_thread_pool_t thread_pool(num_threads);
-  thread_pool.set_idle_sleep_duration(50); // 50 usec
-  
   // split nodes between threads:
   std::vector<std::list<image_t::IndexType> > node_index_list(num_threads);
   std::vector<std::list<pnt2d_t> > node_center_list(num_threads);
@@ -687,6 +684,7 @@ calc_displacements_mt(unsigned int num_threads,
   }
   
   // setup a transaction for each thread:
+  std::list<the_transaction_t *> schedule;
   for (unsigned int i = 0; i < num_threads; i++)
   {
     calc_displacements_t<TImage, TMask> * t =
@@ -710,14 +708,12 @@ calc_displacements_mt(unsigned int num_threads,
                                             node_index_list[i],
                                             node_center_list[i]);
     
-    thread_pool.push_back(t);
+    schedule.push_back(t);
   }
   
   // run the transactions:
-  thread_pool.pre_distribute_work();
   suspend_itk_multithreading_t suspend_itk_mt;
-  thread_pool.start();
-  thread_pool.wait();
+  run_transactions(schedule);
   
   // regularize the displacement vectors here:
   regularize_displacements(xy_shift, mass, dx, dy, db, median_radius);
@@ -1511,9 +1507,6 @@ refine_mosaic_mt(std::vector<itk::GridTransform::Pointer> & transform,
     warped_mask[i] = const_cast<TMask *>(mask[i].GetPointer());
   }
   
-  the_thread_pool_t thread_pool(num_threads);
-  thread_pool.set_idle_sleep_duration(50); // 50 usec
-  
   std::ostringstream oss;
   for (unsigned int pass = 0; pass < num_passes; pass++)
   {
@@ -1541,11 +1534,8 @@ refine_mosaic_mt(std::vector<itk::GridTransform::Pointer> & transform,
         schedule.push_back(t);
       }
       
-      thread_pool.push_back(schedule);
-      thread_pool.pre_distribute_work();
       suspend_itk_multithreading_t suspend_itk_mt;
-      thread_pool.start();
-      thread_pool.wait();
+      run_transactions(schedule);
     }
     
     set_minor_progress(0.2, next_major);
@@ -1584,11 +1574,8 @@ refine_mosaic_mt(std::vector<itk::GridTransform::Pointer> & transform,
       schedule.push_back(t);
     }
     
-    thread_pool.push_back(schedule);
-    // thread_pool.pre_distribute_work();
     suspend_itk_multithreading_t suspend_itk_mt;
-    thread_pool.start();
-    thread_pool.wait();
+    run_transactions(schedule);
     
     set_minor_progress(0.9, next_major);
     
@@ -27,7 +27,10 @@
 */
 
 // STL includes
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <limits>
 
 // Boost includes
 #include <boost/array.hpp>
@@ -36,8 +39,10 @@
 #include <Core/DataBlock/StdDataBlock.h>
 #include <Core/Isosurface/Isosurface.h>
 #include <Core/Isosurface/IsosurfaceExporter.h>
-#include <Core/Utils/StackVector.h>
+#include <Core/Isosurface/MarchingCubesTable.h>
+#include <Core/Isosurface/QuadricDecimator.h>
 #include <Core/Utils/Parallel.h>
+#include <Core/Utils/TaskScheduler.h>
 #include <Core/Utils/Log.h>
 #include <Core/Graphics/VertexBufferObject.h>
 #include <Core/RenderResources/RenderResources.h>
@@ -45,276 +50,6 @@
 namespace Core
 {
 
-// Marching Cubes tutorial: http://local.wasp.uwa.edu.au/~pbourke/geometry/polygonise/
-
-typedef struct {
-  int edges_[15]; // Vertex indices for at most 5 triangles
-  int num_triangles_; // Last number in each table entry
-} MarchingCubesTableType;
-
-// Precalculated array of 256 possible polygon configurations (2^8 = 256) within the cube
-// 256x16 table of integer values, which are used as indices for the array of 12 points of 
-// intersection. It defines the right order to connect the intersected edges to form triangles. 
-// The process for one cell stops when index of -1 is returned from the table, forming a maximum of 
-// 5 triangles. 
-const MarchingCubesTableType MARCHING_CUBES_TABLE_C[] = {
-  {{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 0},
-  {{ 0,  3,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 0,  9,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 1,  3,  8,  9,  1,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1, 11,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 0,  3,  8,  1, 11,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 9, 11,  2,  0,  9,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 2,  3,  8,  2,  8, 11, 11,  8,  9, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 3,  2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 0,  2, 10,  8,  0, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1,  0,  9,  2, 10,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1,  2, 10,  1, 10,  9,  9, 10,  8, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 3,  1, 11, 10,  3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 0,  1, 11,  0, 11,  8,  8, 11, 10, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 3,  0,  9,  3,  9, 10, 10,  9, 11, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9, 11,  8, 11, 10,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 4,  8,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 4,  0,  3,  7,  4,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 0,  9,  1,  8,  7,  4, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 4,  9,  1,  4,  1,  7,  7,  1,  3, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1, 11,  2,  8,  7,  4, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 3,  7,  4,  3,  4,  0,  1, 11,  2, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9, 11,  2,  9,  2,  0,  8,  7,  4, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 2,  9, 11,  2,  7,  9,  2,  3,  7,  7,  4,  9, -1, -1, -1}, 4},
-  {{ 8,  7,  4,  3,  2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{10,  7,  4, 10,  4,  2,  2,  4,  0, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  1,  0,  8,  7,  4,  2, 10,  3, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 4, 10,  7,  9, 10,  4,  9,  2, 10,  9,  1,  2, -1, -1, -1}, 4},
-  {{ 3,  1, 11,  3, 11, 10,  7,  4,  8, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1, 11, 10,  1, 10,  4,  1,  4,  0,  7,  4, 10, -1, -1, -1}, 4},
-  {{ 4,  8,  7,  9, 10,  0,  9, 11, 10, 10,  3,  0, -1, -1, -1}, 4},
-  {{ 4, 10,  7,  4,  9, 10,  9, 11, 10, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  4,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 9,  4,  5,  0,  3,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 0,  4,  5,  1,  0,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 8,  4,  5,  8,  5,  3,  3,  5,  1, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1, 11,  2,  9,  4,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 3,  8,  0,  1, 11,  2,  4,  5,  9, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 5, 11,  2,  5,  2,  4,  4,  2,  0, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 2,  5, 11,  3,  5,  2,  3,  4,  5,  3,  8,  4, -1, -1, -1}, 4},
-  {{ 9,  4,  5,  2, 10,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 0,  2, 10,  0, 10,  8,  4,  5,  9, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  4,  5,  0,  5,  1,  2, 10,  3, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 2,  5,  1,  2,  8,  5,  2, 10,  8,  4,  5,  8, -1, -1, -1}, 4},
-  {{11, 10,  3, 11,  3,  1,  9,  4,  5, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 4,  5,  9,  0,  1,  8,  8,  1, 11,  8, 11, 10, -1, -1, -1}, 4},
-  {{ 5,  0,  4,  5, 10,  0,  5, 11, 10, 10,  3,  0, -1, -1, -1}, 4},
-  {{ 5,  8,  4,  5, 11,  8, 11, 10,  8, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  8,  7,  5,  9,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 9,  0,  3,  9,  3,  5,  5,  3,  7, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  8,  7,  0,  7,  1,  1,  7,  5, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1,  3,  5,  3,  7,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 9,  8,  7,  9,  7,  5, 11,  2,  1, -1, -1, -1, -1, -1, -1}, 3},
-  {{11,  2,  1,  9,  0,  5,  5,  0,  3,  5,  3,  7, -1, -1, -1}, 4},
-  {{ 8,  2,  0,  8,  5,  2,  8,  7,  5, 11,  2,  5, -1, -1, -1}, 4},
-  {{ 2,  5, 11,  2,  3,  5,  3,  7,  5, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 7,  5,  9,  7,  9,  8,  3,  2, 10, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  7,  5,  9,  2,  7,  9,  0,  2,  2, 10,  7, -1, -1, -1}, 4},
-  {{ 2, 10,  3,  0,  8,  1,  1,  8,  7,  1,  7,  5, -1, -1, -1}, 4},
-  {{10,  1,  2, 10,  7,  1,  7,  5,  1, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  8,  5,  8,  7,  5, 11,  3,  1, 11, 10,  3, -1, -1, -1}, 4},
-  {{ 5,  0,  7,  5,  9,  0,  7,  0, 10,  1, 11,  0, 10,  0, 11}, 5},
-  {{10,  0, 11, 10,  3,  0, 11,  0,  5,  8,  7,  0,  5,  0,  7}, 5},
-  {{10,  5, 11,  7,  5, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{11,  5,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 0,  3,  8,  5,  6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 9,  1,  0,  5,  6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1,  3,  8,  1,  8,  9,  5,  6, 11, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1,  5,  6,  2,  1,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1,  5,  6,  1,  6,  2,  3,  8,  0, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  5,  6,  9,  6,  0,  0,  6,  2, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 5,  8,  9,  5,  2,  8,  5,  6,  2,  3,  8,  2, -1, -1, -1}, 4},
-  {{ 2, 10,  3, 11,  5,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{10,  8,  0, 10,  0,  2, 11,  5,  6, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  9,  1,  2, 10,  3,  5,  6, 11, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 5,  6, 11,  1,  2,  9,  9,  2, 10,  9, 10,  8, -1, -1, -1}, 4},
-  {{ 6, 10,  3,  6,  3,  5,  5,  3,  1, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0, 10,  8,  0,  5, 10,  0,  1,  5,  5,  6, 10, -1, -1, -1}, 4},
-  {{ 3,  6, 10,  0,  6,  3,  0,  5,  6,  0,  9,  5, -1, -1, -1}, 4},
-  {{ 6,  9,  5,  6, 10,  9, 10,  8,  9, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 5,  6, 11,  4,  8,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 4,  0,  3,  4,  3,  7,  6, 11,  5, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1,  0,  9,  5,  6, 11,  8,  7,  4, -1, -1, -1, -1, -1, -1}, 3},
-  {{11,  5,  6,  1,  7,  9,  1,  3,  7,  7,  4,  9, -1, -1, -1}, 4},
-  {{ 6,  2,  1,  6,  1,  5,  4,  8,  7, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1,  5,  2,  5,  6,  2,  3,  4,  0,  3,  7,  4, -1, -1, -1}, 4},
-  {{ 8,  7,  4,  9,  5,  0,  0,  5,  6,  0,  6,  2, -1, -1, -1}, 4},
-  {{ 7,  9,  3,  7,  4,  9,  3,  9,  2,  5,  6,  9,  2,  9,  6}, 5},
-  {{ 3,  2, 10,  7,  4,  8, 11,  5,  6, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 5,  6, 11,  4,  2,  7,  4,  0,  2,  2, 10,  7, -1, -1, -1}, 4},
-  {{ 0,  9,  1,  4,  8,  7,  2, 10,  3,  5,  6, 11, -1, -1, -1}, 4},
-  {{ 9,  1,  2,  9,  2, 10,  9, 10,  4,  7,  4, 10,  5,  6, 11}, 5},
-  {{ 8,  7,  4,  3,  5, 10,  3,  1,  5,  5,  6, 10, -1, -1, -1}, 4},
-  {{ 5, 10,  1,  5,  6, 10,  1, 10,  0,  7,  4, 10,  0, 10,  4}, 5},
-  {{ 0,  9,  5,  0,  5,  6,  0,  6,  3, 10,  3,  6,  8,  7,  4}, 5},
-  {{ 6,  9,  5,  6, 10,  9,  4,  9,  7,  7,  9, 10, -1, -1, -1}, 4},
-  {{11,  9,  4,  6, 11,  4, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 4,  6, 11,  4, 11,  9,  0,  3,  8, -1, -1, -1, -1, -1, -1}, 3},
-  {{11,  1,  0, 11,  0,  6,  6,  0,  4, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 8,  1,  3,  8,  6,  1,  8,  4,  6,  6, 11,  1, -1, -1, -1}, 4},
-  {{ 1,  9,  4,  1,  4,  2,  2,  4,  6, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 3,  8,  0,  1,  9,  2,  2,  9,  4,  2,  4,  6, -1, -1, -1}, 4},
-  {{ 0,  4,  2,  4,  6,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 8,  2,  3,  8,  4,  2,  4,  6,  2, -1, -1, -1, -1, -1, -1}, 3},
-  {{11,  9,  4, 11,  4,  6, 10,  3,  2, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  2,  8,  2, 10,  8,  4, 11,  9,  4,  6, 11, -1, -1, -1}, 4},
-  {{ 3,  2, 10,  0,  6,  1,  0,  4,  6,  6, 11,  1, -1, -1, -1}, 4},
-  {{ 6,  1,  4,  6, 11,  1,  4,  1,  8,  2, 10,  1,  8,  1, 10}, 5},
-  {{ 9,  4,  6,  9,  6,  3,  9,  3,  1, 10,  3,  6, -1, -1, -1}, 4},
-  {{ 8,  1, 10,  8,  0,  1, 10,  1,  6,  9,  4,  1,  6,  1,  4}, 5},
-  {{ 3,  6, 10,  3,  0,  6,  0,  4,  6, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 6,  8,  4, 10,  8,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 7,  6, 11,  7, 11,  8,  8, 11,  9, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  3,  7,  0,  7, 11,  0, 11,  9,  6, 11,  7, -1, -1, -1}, 4},
-  {{11,  7,  6,  1,  7, 11,  1,  8,  7,  1,  0,  8, -1, -1, -1}, 4},
-  {{11,  7,  6, 11,  1,  7,  1,  3,  7, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1,  6,  2,  1,  8,  6,  1,  9,  8,  8,  7,  6, -1, -1, -1}, 4},
-  {{ 2,  9,  6,  2,  1,  9,  6,  9,  7,  0,  3,  9,  7,  9,  3}, 5},
-  {{ 7,  0,  8,  7,  6,  0,  6,  2,  0, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 7,  2,  3,  6,  2,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 2, 10,  3, 11,  8,  6, 11,  9,  8,  8,  7,  6, -1, -1, -1}, 4},
-  {{ 2,  7,  0,  2, 10,  7,  0,  7,  9,  6, 11,  7,  9,  7, 11}, 5},
-  {{ 1,  0,  8,  1,  8,  7,  1,  7, 11,  6, 11,  7,  2, 10,  3}, 5},
-  {{10,  1,  2, 10,  7,  1, 11,  1,  6,  6,  1,  7, -1, -1, -1}, 4},
-  {{ 8,  6,  9,  8,  7,  6,  9,  6,  1, 10,  3,  6,  1,  6,  3}, 5},
-  {{ 0,  1,  9, 10,  7,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 7,  0,  8,  7,  6,  0,  3,  0, 10, 10,  0,  6, -1, -1, -1}, 4},
-  {{ 7,  6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 7, 10,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 3,  8,  0, 10,  6,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 0,  9,  1, 10,  6,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 8,  9,  1,  8,  1,  3, 10,  6,  7, -1, -1, -1, -1, -1, -1}, 3},
-  {{11,  2,  1,  6,  7, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1, 11,  2,  3,  8,  0,  6,  7, 10, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 2,  0,  9,  2,  9, 11,  6,  7, 10, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 6,  7, 10,  2,  3, 11, 11,  3,  8, 11,  8,  9, -1, -1, -1}, 4},
-  {{ 7,  3,  2,  6,  7,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 7,  8,  0,  7,  0,  6,  6,  0,  2, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 2,  6,  7,  2,  7,  3,  0,  9,  1, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1,  2,  6,  1,  6,  8,  1,  8,  9,  8,  6,  7, -1, -1, -1}, 4},
-  {{11,  6,  7, 11,  7,  1,  1,  7,  3, -1, -1, -1, -1, -1, -1}, 3},
-  {{11,  6,  7,  1, 11,  7,  1,  7,  8,  1,  8,  0, -1, -1, -1}, 4},
-  {{ 0,  7,  3,  0, 11,  7,  0,  9, 11,  6,  7, 11, -1, -1, -1}, 4},
-  {{ 7, 11,  6,  7,  8, 11,  8,  9, 11, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 6,  4,  8, 10,  6,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 3, 10,  6,  3,  6,  0,  0,  6,  4, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 8, 10,  6,  8,  6,  4,  9,  1,  0, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  6,  4,  9,  3,  6,  9,  1,  3, 10,  6,  3, -1, -1, -1}, 4},
-  {{ 6,  4,  8,  6,  8, 10,  2,  1, 11, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1, 11,  2,  3, 10,  0,  0, 10,  6,  0,  6,  4, -1, -1, -1}, 4},
-  {{ 4,  8, 10,  4, 10,  6,  0,  9,  2,  2,  9, 11, -1, -1, -1}, 4},
-  {{11,  3,  9, 11,  2,  3,  9,  3,  4, 10,  6,  3,  4,  3,  6}, 5},
-  {{ 8,  3,  2,  8,  2,  4,  4,  2,  6, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  2,  4,  4,  2,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1,  0,  9,  2,  4,  3,  2,  6,  4,  4,  8,  3, -1, -1, -1}, 4},
-  {{ 1,  4,  9,  1,  2,  4,  2,  6,  4, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 8,  3,  1,  8,  1,  6,  8,  6,  4,  6,  1, 11, -1, -1, -1}, 4},
-  {{11,  0,  1, 11,  6,  0,  6,  4,  0, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 4,  3,  6,  4,  8,  3,  6,  3, 11,  0,  9,  3, 11,  3,  9}, 5},
-  {{11,  4,  9,  6,  4, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 4,  5,  9,  7, 10,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 0,  3,  8,  4,  5,  9, 10,  6,  7, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 5,  1,  0,  5,  0,  4,  7, 10,  6, -1, -1, -1, -1, -1, -1}, 3},
-  {{10,  6,  7,  8,  4,  3,  3,  4,  5,  3,  5,  1, -1, -1, -1}, 4},
-  {{ 9,  4,  5, 11,  2,  1,  7, 10,  6, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 6,  7, 10,  1, 11,  2,  0,  3,  8,  4,  5,  9, -1, -1, -1}, 4},
-  {{ 7, 10,  6,  5, 11,  4,  4, 11,  2,  4,  2,  0, -1, -1, -1}, 4},
-  {{ 3,  8,  4,  3,  4,  5,  3,  5,  2, 11,  2,  5, 10,  6,  7}, 5},
-  {{ 7,  3,  2,  7,  2,  6,  5,  9,  4, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  4,  5,  0,  6,  8,  0,  2,  6,  6,  7,  8, -1, -1, -1}, 4},
-  {{ 3,  2,  6,  3,  6,  7,  1,  0,  5,  5,  0,  4, -1, -1, -1}, 4},
-  {{ 6,  8,  2,  6,  7,  8,  2,  8,  1,  4,  5,  8,  1,  8,  5}, 5},
-  {{ 9,  4,  5, 11,  6,  1,  1,  6,  7,  1,  7,  3, -1, -1, -1}, 4},
-  {{ 1, 11,  6,  1,  6,  7,  1,  7,  0,  8,  0,  7,  9,  4,  5}, 5},
-  {{ 4, 11,  0,  4,  5, 11,  0, 11,  3,  6,  7, 11,  3, 11,  7}, 5},
-  {{ 7, 11,  6,  7,  8, 11,  5, 11,  4,  4, 11,  8, -1, -1, -1}, 4},
-  {{ 6,  5,  9,  6,  9, 10, 10,  9,  8, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 3, 10,  6,  0,  3,  6,  0,  6,  5,  0,  5,  9, -1, -1, -1}, 4},
-  {{ 0,  8, 10,  0, 10,  5,  0,  5,  1,  5, 10,  6, -1, -1, -1}, 4},
-  {{ 6,  3, 10,  6,  5,  3,  5,  1,  3, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1, 11,  2,  9, 10,  5,  9,  8, 10, 10,  6,  5, -1, -1, -1}, 4},
-  {{ 0,  3, 10,  0, 10,  6,  0,  6,  9,  5,  9,  6,  1, 11,  2}, 5},
-  {{10,  5,  8, 10,  6,  5,  8,  5,  0, 11,  2,  5,  0,  5,  2}, 5},
-  {{ 6,  3, 10,  6,  5,  3,  2,  3, 11, 11,  3,  5, -1, -1, -1}, 4},
-  {{ 5,  9,  8,  5,  8,  2,  5,  2,  6,  3,  2,  8, -1, -1, -1}, 4},
-  {{ 9,  6,  5,  9,  0,  6,  0,  2,  6, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 1,  8,  5,  1,  0,  8,  5,  8,  6,  3,  2,  8,  6,  8,  2}, 5},
-  {{ 1,  6,  5,  2,  6,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1,  6,  3,  1, 11,  6,  3,  6,  8,  5,  9,  6,  8,  6,  9}, 5},
-  {{11,  0,  1, 11,  6,  0,  9,  0,  5,  5,  0,  6, -1, -1, -1}, 4},
-  {{ 0,  8,  3,  5, 11,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{11,  6,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{10, 11,  5,  7, 10,  5, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{10, 11,  5, 10,  5,  7,  8,  0,  3, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 5,  7, 10,  5, 10, 11,  1,  0,  9, -1, -1, -1, -1, -1, -1}, 3},
-  {{11,  5,  7, 11,  7, 10,  9,  1,  8,  8,  1,  3, -1, -1, -1}, 4},
-  {{10,  2,  1, 10,  1,  7,  7,  1,  5, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  3,  8,  1,  7,  2,  1,  5,  7,  7, 10,  2, -1, -1, -1}, 4},
-  {{ 9,  5,  7,  9,  7,  2,  9,  2,  0,  2,  7, 10, -1, -1, -1}, 4},
-  {{ 7,  2,  5,  7, 10,  2,  5,  2,  9,  3,  8,  2,  9,  2,  8}, 5},
-  {{ 2, 11,  5,  2,  5,  3,  3,  5,  7, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 8,  0,  2,  8,  2,  5,  8,  5,  7, 11,  5,  2, -1, -1, -1}, 4},
-  {{ 9,  1,  0,  5,  3, 11,  5,  7,  3,  3,  2, 11, -1, -1, -1}, 4},
-  {{ 9,  2,  8,  9,  1,  2,  8,  2,  7, 11,  5,  2,  7,  2,  5}, 5},
-  {{ 1,  5,  3,  3,  5,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 0,  7,  8,  0,  1,  7,  1,  5,  7, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  3,  0,  9,  5,  3,  5,  7,  3, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  7,  8,  5,  7,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 5,  4,  8,  5,  8, 11, 11,  8, 10, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 5,  4,  0,  5,  0, 10,  5, 10, 11, 10,  0,  3, -1, -1, -1}, 4},
-  {{ 0,  9,  1,  8, 11,  4,  8, 10, 11, 11,  5,  4, -1, -1, -1}, 4},
-  {{11,  4, 10, 11,  5,  4, 10,  4,  3,  9,  1,  4,  3,  4,  1}, 5},
-  {{ 2,  1,  5,  2,  5,  8,  2,  8, 10,  4,  8,  5, -1, -1, -1}, 4},
-  {{ 0, 10,  4,  0,  3, 10,  4, 10,  5,  2,  1, 10,  5, 10,  1}, 5},
-  {{ 0,  5,  2,  0,  9,  5,  2,  5, 10,  4,  8,  5, 10,  5,  8}, 5},
-  {{ 9,  5,  4,  2,  3, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 2, 11,  5,  3,  2,  5,  3,  5,  4,  3,  4,  8, -1, -1, -1}, 4},
-  {{ 5,  2, 11,  5,  4,  2,  4,  0,  2, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 3,  2, 11,  3, 11,  5,  3,  5,  8,  4,  8,  5,  0,  9,  1}, 5},
-  {{ 5,  2, 11,  5,  4,  2,  1,  2,  9,  9,  2,  4, -1, -1, -1}, 4},
-  {{ 8,  5,  4,  8,  3,  5,  3,  1,  5, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  5,  4,  1,  5,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 8,  5,  4,  8,  3,  5,  9,  5,  0,  0,  5,  3, -1, -1, -1}, 4},
-  {{ 9,  5,  4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 4,  7, 10,  4, 10,  9,  9, 10, 11, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0,  3,  8,  4,  7,  9,  9,  7, 10,  9, 10, 11, -1, -1, -1}, 4},
-  {{ 1, 10, 11,  1,  4, 10,  1,  0,  4,  7, 10,  4, -1, -1, -1}, 4},
-  {{ 3,  4,  1,  3,  8,  4,  1,  4, 11,  7, 10,  4, 11,  4, 10}, 5},
-  {{ 4,  7, 10,  9,  4, 10,  9, 10,  2,  9,  2,  1, -1, -1, -1}, 4},
-  {{ 9,  4,  7,  9,  7, 10,  9, 10,  1,  2,  1, 10,  0,  3,  8}, 5},
-  {{10,  4,  7, 10,  2,  4,  2,  0,  4, -1, -1, -1, -1, -1, -1}, 3},
-  {{10,  4,  7, 10,  2,  4,  8,  4,  3,  3,  4,  2, -1, -1, -1}, 4},
-  {{ 2, 11,  9,  2,  9,  7,  2,  7,  3,  7,  9,  4, -1, -1, -1}, 4},
-  {{ 9,  7, 11,  9,  4,  7, 11,  7,  2,  8,  0,  7,  2,  7,  0}, 5},
-  {{ 3, 11,  7,  3,  2, 11,  7, 11,  4,  1,  0, 11,  4, 11,  0}, 5},
-  {{ 1,  2, 11,  8,  4,  7, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 4,  1,  9,  4,  7,  1,  7,  3,  1, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 4,  1,  9,  4,  7,  1,  0,  1,  8,  8,  1,  7, -1, -1, -1}, 4},
-  {{ 4,  3,  0,  7,  3,  4, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 4,  7,  8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 9,  8, 11, 11,  8, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 3,  9,  0,  3, 10,  9, 10, 11,  9, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 0, 11,  1,  0,  8, 11,  8, 10, 11, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 3, 11,  1, 10, 11,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 1, 10,  2,  1,  9, 10,  9,  8, 10, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 3,  9,  0,  3, 10,  9,  1,  9,  2,  2,  9, 10, -1, -1, -1}, 4},
-  {{ 0, 10,  2,  8, 10,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 3, 10,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 2,  8,  3,  2, 11,  8, 11,  9,  8, -1, -1, -1, -1, -1, -1}, 3},
-  {{ 9,  2, 11,  0,  2,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 2,  8,  3,  2, 11,  8,  0,  8,  1,  1,  8, 11, -1, -1, -1}, 4},
-  {{ 1,  2, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 1,  8,  3,  9,  8,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 2},
-  {{ 0,  1,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{ 0,  8,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 1},
-  {{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}, 0}};
-
 typedef struct {
   int points_[12]; // Vertex indices for at most 4 triangles
   int num_triangles_; // Last number in each table entry
@@ -356,14 +91,54 @@ public:
 
 typedef boost::shared_ptr< VertexBufferBatch > VertexBufferBatchHandle;
 
+// Decimated geometry of one part of the isosurface at one level of detail
+class IsosurfaceLOD
+{
+public:
+  PointFVector points_;
+  VectorFVector normals_;
+  UIntVector faces_; // Indices relative to the part
+  UIntVector sources_; // Index of the full resolution point of the part each point comes from
+};
+
+// Geometry of one part of the isosurface, which is rendered from its own vertex buffers
+class IsosurfacePart
+{
+public:
+  IsosurfacePart() : area_( 0 ), changed_( true ), lod_outdated_( true ) {}
+
+  PointFVector points_;
+  VectorFVector normals_;
+  UIntVector faces_; // Indices relative to the part
+  float area_;
+
+  // Points of the part on the plane it shares with the block below and the block above it.
+  // Both lists follow the order of the split edges on the plane, hence the top seam of one
+  // block and the bottom seam of the next pair up point by point.
+  UIntVector seam_bottom_;
+  UIntVector seam_top_;
+
+  // Index of each point in the stitched mesh
+  UIntVector mesh_index_;
+
+  // Whether the vertex buffers need to be uploaded again
+  bool changed_;
+
+  // Decimated levels of detail, indexed by level - 1
+  std::vector< IsosurfaceLOD > lods_;
+  bool lod_outdated_;
+};
+
+typedef boost::shared_ptr< IsosurfacePart > IsosurfacePartHandle;
+
 #if defined (_WIN32) || defined(__APPLE__)
-const std::string Isosurface::EXPORT_FORMATS_C( "VTK (*.vtk);;ASCII (*.fac *.pts *.val);;ASCII STL (*.stl);;Binary STL (*.stl)" );
+const std::string Isosurface::EXPORT_FORMATS_C( "VTK (*.vtk);;Binary VTK (*.vtk);;Compressed VTK (*.vtk.gz);;ASCII (*.fac *.pts *.val);;ASCII STL (*.stl);;Binary STL (*.stl);;Binary PLY (*.ply);;Compressed PLY (*.ply.gz)" );
 #else
-const std::string Isosurface::EXPORT_FORMATS_C( "VTK (*.vtk);;ASCII (*.fac *.pts *.val);;ASCII STL (*.stl);;Binary STL (*.stl *)" );
+const std::string Isosurface::EXPORT_FORMATS_C( "VTK (*.vtk);;Binary VTK (*.vtk *);;Compressed VTK (*.vtk.gz);;ASCII (*.fac *.pts *.val);;ASCII STL (*.stl);;Binary STL (*.stl *);;Binary PLY (*.ply);;Compressed PLY (*.ply.gz)" );
 #endif
 
-// Binary STL handled as special case in LayerIOFunctions::ExportIsosurface
-const FilterMap Isosurface::EXPORT_FORMATS_MAP_C = { { "VTK (*.vtk)", ".vtk" }, { "ASCII (*.fac *.pts *.val)", ".fac" }, { "ASCII STL (*.stl)", ".stl" } };
+// Binary STL and VTK handled as special case in LayerIOFunctions::ExportIsosurface
+const FilterMap Isosurface::EXPORT_FORMATS_MAP_C = { { "VTK (*.vtk)", ".vtk" }, { "Compressed VTK (*.vtk.gz)", ".vtk.gz" }, { "ASCII (*.fac *.pts *.val)", ".fac" }, { "ASCII STL (*.stl)", ".stl" }, { "Binary PLY (*.ply)", ".ply" }, { "Compressed PLY (*.ply.gz)", ".ply.gz" } };
 
 class IsosurfacePrivate 
 {
@@ -404,9 +179,95 @@ public:
   // Parallelized isosurface normal computation algorithm 
   void parallel_compute_normals( int thread, int num_threads,  boost::barrier& barrier );
 
+  // COMPUTE_BLOCK:
+  // Compute the faces of one block of slices and store them as the part with the same index.
+  // One extra slice of cubes is processed on either side of the block.  The faces of those 
+  // slices are discarded, but they contribute to the normals of the points on the border of 
+  // the block, so that the normals are continuous across the seam with the next block.
+  // Returns false if the computation was aborted.
+  bool compute_block( size_t block );
+
+  // COMPUTE_CAPS:
+  // Compute the cap faces and store them as the part with the given index.
+  void compute_caps( size_t part );
+
+  // COLLECT_SEAM_POINTS:
+  // Collect the points on the split edges of a plane of the mask from the edge buffers of that
+  // plane, in the order of the edges.
+  void collect_seam_points( size_t plane, const UIntVector& edge_x, const UIntVector& edge_y,
+    UIntVector& seam );
+
+  // STORE_PART:
+  // Store the geometry in the block buffers, with the faces from face_start up to face_end, as
+  // the given part of the output mesh.  Points that are not used by these faces are dropped.
+  // The part replaces the geometry that was stored there before.  If part equals the number of 
+  // parts a new part is added at the end.
+  void store_part( size_t part, size_t face_start, size_t face_end );
+
+  // MESH_CHANGED:
+  // Discard the stitched mesh and the values after the geometry of a part changed.
+  void mesh_changed();
+
+  // ASSEMBLE_MESH:
+  // Build the stitched mesh out of the parts, if it is not up to date.  The points on the seam
+  // between two blocks are stored once, using the points of the lower block.
+  void assemble_mesh();
+
+  // GET_NUM_FACES:
+  // Number of triangles of the full resolution isosurface.
+  size_t get_num_faces() const;
+
   // UPLOAD_TO_VERTEX_BUFFER:
+  // Upload the parts of the mesh that changed to the vertex buffers.
   void upload_to_vertex_buffer();
 
+  // UPLOAD_PART_TO_VERTEX_BUFFER:
+  void upload_part_to_vertex_buffer( size_t part, bool has_values );
+
+  // UPLOAD_LOD_TO_VERTEX_BUFFER:
+  // Upload the parts of a decimated level of detail that changed to the vertex buffers.
+  void upload_lod_to_vertex_buffer( size_t level );
+
+  // UPLOAD_BATCH:
+  // Upload geometry to the buffers of a batch, values may be null.
+  void upload_batch( VertexBufferBatchHandle& batch, size_t num_pts, const PointF* points, 
+    const VectorF* normals, const float* values, size_t num_face_indices, 
+    const unsigned int* faces );
+
+  // DRAW_BATCH:
+  void draw_batch( const VertexBufferBatchHandle& batch, size_t num_face_indices, 
+    bool use_values );
+
+  // SETUP_LODS:
+  // Decide how many levels of detail are needed to get the number of triangles down to the 
+  // triangle budget, and how much each level reduces the number of triangles.
+  void setup_lods();
+
+  // COMPUTE_LODS:
+  // Compute the decimated levels of detail of the parts that are flagged in lod_outdated_.
+  // Returns false if the computation was aborted.
+  bool compute_lods();
+
+  // UPDATE_LODS:
+  // Bring the levels of detail up to date after some of the parts were computed again. Only the
+  // outdated parts are decimated, and only while the isosurface exceeds the triangle budget.
+  // Returns false if the computation was aborted.
+  bool update_lods();
+
+  // PARALLEL_COMPUTE_LODS:
+  // Decimate the outdated parts in the range [part_begin, part_end).
+  void parallel_compute_lods( TaskGroup* group, size_t part_begin, size_t part_end );
+
+  // CHECK_LOD_ABORT:
+  // Whether the decimation needs to be aborted, cancels the group when it does.
+  bool check_lod_abort( TaskGroup* group );
+
+  // GET_LOD_MESH:
+  // Get the mesh of a level of detail as one piece of geometry, with the values of its points
+  // if values were set.
+  void get_lod_mesh( size_t level, PointFVector& points, UIntVector& faces, 
+    FloatVector& values );
+
   void reset();
   
 
@@ -426,11 +287,12 @@ public:
   MaskVolumeHandle compute_mask_volume_; 
   unsigned char mask_value_; // Same for original volume and downsampled volume
 
-  // Output mesh
+  // Stitched output mesh, assembled from the parts when it is asked for
   PointFVector points_;
   VectorFVector normals_;
   UIntVector faces_; // unsigned int because GL expects this
-  FloatVector values_; // Should be in range [0, 1]
+  bool mesh_outdated_;
+  FloatVector values_; // Should be in range [0, 1], one for each point of the stitched mesh
   float area_; // Surface area of the isosurface
 
   // Single colormap shared by all isosurfaces
@@ -444,43 +306,78 @@ public:
   UCharVector type_buffer_;
   std::vector< UIntVector > edge_buffer_;
 
-  UIntVector min_point_index_;
-  UIntVector max_point_index_;
+  // Range of cube slices processed by parallel_compute_faces, and the range of slices of
+  // which the faces are kept
+  size_t zstart_, zend_;
+  size_t keep_zstart_, keep_zend_;
+
+  // Face ranges per processed slice
   UIntVector min_face_index_;
   UIntVector max_face_index_;
 
-  std::vector< std::pair< unsigned int, unsigned int > > part_points_;
-  std::vector< std::pair< unsigned int, unsigned int > > part_faces_;
-  std::vector< UIntVector > part_indices_;
-
+  // Geometry of the block that is being computed, face indices are relative to the block
+  PointFVector block_points_;
+  VectorFVector block_normals_;
+  UIntVector block_faces_;
+  float block_area_;
+  // Points of the block on the planes shared with the blocks below and above it
+  UIntVector block_seam_bottom_;
+  UIntVector block_seam_top_;
+
+  // The output mesh is made of parts: one for each block of BLOCK_SLICES_C cube slices, followed
+  // by one for the caps.  Each part is stored and rendered on its own, so recomputing a block
+  // only touches the geometry of that block.
+  std::vector< IsosurfacePartHandle > parts_;
+  size_t num_blocks_;
+
+  // Decimation settings of the levels of detail of the parts
+  size_t triangle_budget_;
+  size_t lod_triangle_budget_;
+  size_t num_lod_levels_;
+  double lod_ratio_;
+
+  // Settings and mask generation of the last computation
+  double quality_factor_;
+  bool capping_enabled_;
+  DataBlock::generation_type generation_;
+
+  // Per thread points and the edge cache slots that refer to them
   std::vector< PointFVector > new_points_; 
-  std::vector< std::vector< StackVector< size_t, 3 > > > new_elems_;
+  std::vector< std::vector< unsigned int* > > new_point_slots_;
+  // Per thread triangles, three point indices per triangle
+  std::vector< UIntVector > new_elems_;
   FloatVector new_elem_areas_;
 
-  IVector front_offset_;
-  IVector back_offset_;
+  // Offsets of the per thread points and triangles in the output mesh
+  std::vector< size_t > point_offset_;
+  std::vector< size_t > face_offset_;
   size_t global_point_cnt_;
 
-  unsigned int prev_point_min_;
-  unsigned int prev_point_max_;
-
   std::vector< VertexBufferBatchHandle > vbo_batches_;
   bool vbo_available_;
+
+  // Vertex buffers of the decimated levels, indexed by level - 1 and part
+  std::vector< std::vector< VertexBufferBatchHandle > > lod_batches_;
+  std::vector< std::vector< bool > > lod_changed_;
   bool surface_changed_;
   bool values_changed_;
 
   bool need_abort_;
   boost::function< bool () > check_abort_;
+  // Serializes the calls to check_abort_ from the decimation tasks
+  boost::mutex check_abort_mutex_;
+
+  // Number of cube slices in each block
+  const static size_t BLOCK_SLICES_C;
 
-  const static double COMPUTE_PERCENT_PROGRESS_C;
-  const static double NORMAL_PERCENT_PROGRESS_C;
-  const static double PARTITION_PERCENT_PROGRESS_C;
+  // Maximum number of decimated levels of detail
+  const static size_t MAX_LOD_LEVELS_C;
 };
 
 // Initialize static variables
-const double IsosurfacePrivate::COMPUTE_PERCENT_PROGRESS_C = 0.8;
-const double IsosurfacePrivate::NORMAL_PERCENT_PROGRESS_C = 0.05;
-const double IsosurfacePrivate::PARTITION_PERCENT_PROGRESS_C = 0.15; 
+const size_t IsosurfacePrivate::BLOCK_SLICES_C = 32;
+const size_t IsosurfacePrivate::MAX_LOD_LEVELS_C = 3;
+const size_t Isosurface::DEFAULT_TRIANGLE_BUDGET_C = 500000;
 
 void IsosurfacePrivate::downsample_setup( int num_threads, double quality_factor )
 {
@@ -651,26 +548,23 @@ void IsosurfacePrivate::compute_faces_setup( int num_threads )
 
   // Interpolated edge points for isosurface per thread
   this->new_points_.resize( num_threads );
+  // Edge buffer entries that refer to the new points of each thread
+  this->new_point_slots_.resize( num_threads );
 
   // Vector of face indices per triangle, per thread
   this->new_elems_.resize( num_threads );
   // Surface areas of generated triangles per thread
-  this->new_elem_areas_.resize( num_threads, 0 );
-  // Offset allows zero-based indexing over multiple slices
-  this->front_offset_.resize( num_threads, 0 );
-  this->back_offset_.resize( num_threads, 0 ); 
+  this->new_elem_areas_.assign( num_threads, 0 );
+  // Where the points and faces of each thread go in the output mesh
+  this->point_offset_.resize( num_threads, 0 );
+  this->face_offset_.resize( num_threads, 0 ); 
 
   // Total number of isosurface points
   this->global_point_cnt_ = 0;
 
-  this->min_point_index_.resize( this->elem_nz_ );
-  this->max_point_index_.resize( this->elem_nz_ );
-  this->min_face_index_.resize( this->elem_nz_ );
-  this->max_face_index_.resize( this->elem_nz_ );
+  this->min_face_index_.resize( this->zend_ - this->zstart_ );
+  this->max_face_index_.resize( this->zend_ - this->zstart_ );
 
-  this->prev_point_min_ = 0;
-  this->prev_point_max_ = 0;
-  
   this->need_abort_ = false;
 
 }
@@ -689,9 +583,14 @@ Basic ideas:
   - side_buffer - Edges along the sides between the back and front buffers (slices)
 - These are tables of split edges with indices into a points vector of actual points.
 - Number points as you encounter split edges.
+- Tables are built in parallel using relative indices per thread.  Each thread remembers which
+  table entries it wrote.
+- Once all threads are done with a slice the point lists are laid out one after the other in the
+  output, and every thread adds its offset to the entries it wrote.  From then on the tables hold
+  global indices, so an edge on the seam between two strips (or between two slices) resolves to
+  the one point that was created for it, no matter which thread looks it up.
 - After edge tables are built, go back to type list, use configurations to lookup into the tables.
-- Tables are built in parallel using relative indices per thread.
-- Parallel point lists are merged together at the end.
+- Triangles are copied in parallel into the output as well, each thread at its own offset.
 - At end, swap front and back data (front is now back).
 - One advantage of this approach is that we don't need complex and confusing linked lists; we can
   use tables that directly correspond to elements.
@@ -745,11 +644,11 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
   // Each thread generates new points for the isosurface
   PointFVector& points = this->new_points_[ thread ];
-  // StackVector is a SCIRun class.  
-  // StackVector implements a subclass of the std::vector class, except that
-  // the vector is statically allocated on the stack for performance.
-  // elems = triangles
-  std::vector< StackVector < size_t, 3 > >& elements = this->new_elems_[ thread ];
+  // Edge buffer entries pointing into points, converted into global indices once the
+  // points of all threads have been placed
+  std::vector< unsigned int* >& point_slots = this->new_point_slots_[ thread ];
+  // elems = triangles, stored as three consecutive point indices
+  UIntVector& elements = this->new_elems_[ thread ];
 
   // mark the point counter with the process number
   unsigned int point_cnt = 0;
@@ -767,13 +666,11 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
   int front_buffer_y = 3;
   int side_buffer = 4;
 
-  StackVector< size_t, 3 > elems( 3 );    
-
   // Get mask transform from MaskVolume 
   GridTransform grid_transform = this->compute_mask_volume_->get_grid_transform();
 
-  // Loop over all the slices
-  for ( size_t z = 0;  z < this->elem_nz_; z++ ) 
+  // Loop over the slices of the current run
+  for ( size_t z = this->zstart_;  z < this->zend_; z++ ) 
   {
     // Process two adjacent slices at a time (back and front)
     // Get pointer to beginning of each slice in the data
@@ -781,7 +678,8 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
     unsigned char* data2 = this->data_ + ( z + 1 ) * ( this->nx_ * this->ny_ );
 
     points.clear();
-    point_cnt = thread<<24; // upper 8 bits are used to store thread id -- efficiency trick
+    point_slots.clear();
+    point_cnt = 0;
 
     // References to back/front/side tables
     UIntVector& back_edge_x = this->edge_buffer_[ back_buffer_x ];
@@ -847,7 +745,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
           // between vertices along edges.  Always put point in center of edge.
           const float INTERP_EDGE_OFFSET_C = 0.5f;
 
-          if ( z == 0 )
+          if ( z == this->zstart_ )
           {
             // top border and center ones
             if ( ( ( type>>0 ) ^ ( type>>1 ) ) & 0x01 ) 
@@ -862,6 +760,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
               points.push_back( edge_point );
               back_edge_x[ q ] = point_cnt;
+              point_slots.push_back( &back_edge_x[ q ] );
               point_cnt++;
             }
 
@@ -878,6 +777,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
               points.push_back( edge_point );
               back_edge_x[ q + this->nx_ ] = point_cnt;
+              point_slots.push_back( &back_edge_x[ q + this->nx_ ] );
               point_cnt++;
             }
 
@@ -893,6 +793,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
               points.push_back( edge_point );
               back_edge_y[ q ] = point_cnt;
+              point_slots.push_back( &back_edge_y[ q ] );
               point_cnt++;
             }
 
@@ -908,6 +809,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
               points.push_back( edge_point );
               back_edge_y[ q + 1 ] = point_cnt;
+              point_slots.push_back( &back_edge_y[ q + 1 ] );
               point_cnt++;
             }
           }
@@ -924,6 +826,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
             points.push_back( edge_point );
             front_edge_x[ q ] = point_cnt;
+            point_slots.push_back( &front_edge_x[ q ] );
             point_cnt++;
           }
 
@@ -940,6 +843,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
             points.push_back( edge_point );
             front_edge_x[ q + this->nx_ ] = point_cnt;
+            point_slots.push_back( &front_edge_x[ q + this->nx_ ] );
             point_cnt++;
           }
 
@@ -955,6 +859,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
             points.push_back( edge_point );
             front_edge_y[ q ] = point_cnt;
+            point_slots.push_back( &front_edge_y[ q ] );
             point_cnt++;
           }
 
@@ -970,6 +875,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
             points.push_back( edge_point );
             front_edge_y[ q + 1 ] = point_cnt;
+            point_slots.push_back( &front_edge_y[ q + 1 ] );
             point_cnt++;
           }
 
@@ -986,6 +892,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
             points.push_back( edge_point );
             side_edge[ q ] = point_cnt;
+            point_slots.push_back( &side_edge[ q ] );
             point_cnt++;              
           }    
 
@@ -1001,6 +908,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
             points.push_back( edge_point );
             side_edge[ q + 1 ] = point_cnt;
+            point_slots.push_back( &side_edge[ q + 1 ] );
             point_cnt++;              
           }
 
@@ -1015,6 +923,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
             points.push_back( edge_point );
             side_edge[ q + this->nx_ ] = point_cnt;
+            point_slots.push_back( &side_edge[ q + this->nx_ ] );
             point_cnt++;              
           }
 
@@ -1030,6 +939,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
             points.push_back( edge_point );
             side_edge[ q + this->nx_ + 1 ] = point_cnt;
+            point_slots.push_back( &side_edge[ q + this->nx_ + 1 ] );
             point_cnt++;              
           }
         }
@@ -1039,34 +949,39 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
     barrier.wait();
     elements.clear();
 
-    // Combine points from all threads
+    // Place the points of all threads one after the other in the output
     if ( thread == 0 )
     {   
       size_t local_size = 0;
       for ( int p = 0; p < num_threads; p++ )
       {            
-        this->front_offset_[ p ] = this->global_point_cnt_ + local_size;
-        if ( z == 0 )
-        {
-          this->back_offset_[ p ] = this->front_offset_[ p ];
-        }
+        this->point_offset_[ p ] = this->global_point_cnt_ + local_size;
         local_size += this->new_points_[ p ].size();
-        PointFVector& points = this->new_points_[ p ];
-        for ( size_t q = 0; q < points.size(); q++ )
-        {
-          this->points_.push_back( points[ q ] ); 
-        }
       }
       this->global_point_cnt_ += local_size;
-    
-      this->min_point_index_[ z ] = this->prev_point_min_;
-      this->max_point_index_[ z ] = static_cast<unsigned int>( this->points_.size() );
-      this->prev_point_min_ = this->prev_point_max_;
-      this->prev_point_max_ = this->max_point_index_[ z ];
+      this->block_points_.resize( this->global_point_cnt_ );
+    }
+
+    barrier.wait();
+
+    // Copy the points of this thread and turn the relative indices this thread wrote into the
+    // edge buffers into global ones.  Edges on the seams between strips were only written by 
+    // one thread, hence after this step every split edge maps to a single shared point.
+    {
+      unsigned int point_offset = static_cast< unsigned int >( this->point_offset_[ thread ] );
+      std::copy( points.begin(), points.end(), this->block_points_.begin() + point_offset );
+      for ( size_t q = 0; q < point_slots.size(); q++ )
+      {
+        *( point_slots[ q ] ) += point_offset;
+      }
     }
 
     barrier.wait();
 
+    // Only the triangles of the block itself count towards the surface area, the ones in the
+    // slices around it are only needed for the normals
+    bool keep_slice = z >= this->keep_zstart_ && z < this->keep_zend_;
+
     // Build triangles
     for ( size_t y = elem_nystart; y < elem_nyend; y++ )
     {
@@ -1087,46 +1002,21 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
         for ( int k = 0; k < table.num_triangles_; k++ )
         {
-          // Get the edge index (0-11 for 12 edges)
-          int i1 = table.edges_[ 3 * k ];
-          int i2 = table.edges_[ 3 * k + 1 ];
-          int i3 = table.edges_[ 3 * k + 2 ];
-
-          unsigned int p1 = edge_table[ i1 ][ elem_offset ];
-          unsigned int p2 = edge_table[ i2 ][ elem_offset ];
-          unsigned int p3 = edge_table[ i3 ][ elem_offset ];
-
-          if ( i1 < 4 ) 
-          {
-            elems[ 0 ] = ( p1 & 0x00FFFFFF ) + this->back_offset_[ p1>>24 ];
-          }
-          else
-          {
-            elems[ 0 ] = ( p1 & 0x00FFFFFF ) + this->front_offset_[ p1>>24 ];            
-          }
-
-          if ( i2 < 4 ) 
-          {
-            elems[ 1 ] = ( p2 & 0x00FFFFFF ) + this->back_offset_[ p2>>24 ];
-          }
-          else
-          {
-            elems[ 1 ] = ( p2 & 0x00FFFFFF ) + this->front_offset_[ p2>>24 ];            
-          }
-
-          if ( i3 < 4 ) 
-          {
-            elems[ 2 ] = ( p3 & 0x00FFFFFF ) + this->back_offset_[ p3>>24 ];
-          }
-          else
+          // Get the edge index (0-11 for 12 edges) and look up the point on that edge
+          unsigned int p1 = edge_table[ table.edges_[ 3 * k ] ][ elem_offset ];
+          unsigned int p2 = edge_table[ table.edges_[ 3 * k + 1 ] ][ elem_offset ];
+          unsigned int p3 = edge_table[ table.edges_[ 3 * k + 2 ] ][ elem_offset ];
+
+          elements.push_back( p1 );
+          elements.push_back( p2 );
+          elements.push_back( p3 );
+          // Add the area of the triangle to the total
+          if ( keep_slice )
           {
-            elems[ 2 ] = ( p3 & 0x00FFFFFF ) + this->front_offset_[ p3>>24 ];            
+            this->new_elem_areas_[ thread ] += 0.5f * 
+              Cross( this->block_points_[ p2 ] - this->block_points_[ p1 ], 
+              this->block_points_[ p3 ] - this->block_points_[ p1 ] ).length();
           }
-          elements.push_back( elems );
-          // Add the area of the triangle to the total
-          this->new_elem_areas_[ thread ] += 0.5f * 
-            Cross( this->points_[ elems[ 1 ] ] - this->points_[ elems[ 0 ] ], 
-            this->points_[ elems[ 2 ] ] - this->points_[ elems[ 0 ] ] ).length();
         }
       }
     }
@@ -1137,26 +1027,34 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
     if ( thread == 0 )
     {
-      this->min_face_index_[ z ] = static_cast<unsigned int>( this->faces_.size() );
+      this->min_face_index_[ z - this->zstart_ ] = 
+        static_cast<unsigned int>( this->block_faces_.size() );
 
+      size_t num_faces = this->block_faces_.size();
       for ( int w = 0;  w < num_threads; w++ )
       {
-        std::vector< StackVector< size_t, 3 > >& pelements = this->new_elems_[ w ];
-        for ( size_t p = 0; p < pelements.size(); p++ )
-        {
-          StackVector< size_t, 3 >& el = pelements[ p ];
-          this->faces_.push_back( static_cast< unsigned int >( el[ 0 ] ) );
-          this->faces_.push_back( static_cast< unsigned int >( el[ 1 ] ) );
-          this->faces_.push_back( static_cast< unsigned int >( el[ 2 ] ) );
-        }
+        this->face_offset_[ w ] = num_faces;
+        num_faces += this->new_elems_[ w ].size();
       }
-      this->back_offset_ = this->front_offset_;
+      this->block_faces_.resize( num_faces );
 
-      this->max_face_index_[ z ] = static_cast<unsigned int>( this->faces_.size() );
-    }
+      this->max_face_index_[ z - this->zstart_ ] = 
+        static_cast<unsigned int>( this->block_faces_.size() );
+
+      // The edge buffers of the plane behind this slice now hold the points of that plane.
+      // Remember the ones on the planes shared with the neighboring blocks, so the blocks can
+      // be stitched together.
+      if ( z + 1 == this->keep_zstart_ )
+      {
+        this->collect_seam_points( z + 1, this->edge_buffer_[ back_buffer_x ], 
+          this->edge_buffer_[ back_buffer_y ], this->block_seam_bottom_ );
+      }
+      if ( z + 1 == this->keep_zend_ && this->keep_zend_ < this->elem_nz_ )
+      {
+        this->collect_seam_points( z + 1, this->edge_buffer_[ back_buffer_x ], 
+          this->edge_buffer_[ back_buffer_y ], this->block_seam_top_ );
+      }
 
-    if ( thread == 0 )
-    {
       if ( this->check_abort_() ) 
       {
         this->need_abort_ = true;
@@ -1165,16 +1063,15 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
 
     barrier.wait();   
 
+    std::copy( elements.begin(), elements.end(), 
+      this->block_faces_.begin() + this->face_offset_[ thread ] );
+
+    barrier.wait();   
+
     if ( this->need_abort_ ) 
     {
       return;
     }
-    
-    // Update progress based on number of z slices processed
-    double compute_progress = 
-      static_cast< double >( z + 1 ) / static_cast< double >( this->elem_nz_ );
-    double total_progress = compute_progress * COMPUTE_PERCENT_PROGRESS_C;
-    this->isosurface_->update_progress_signal_( total_progress );
   }   
 
   barrier.wait();
@@ -1184,7 +1081,7 @@ void IsosurfacePrivate::parallel_compute_faces( int thread, int num_threads,
   {
     for ( int p = 0; p < num_threads; ++p )
     {
-      this->area_ += this->new_elem_areas_[ p ];
+      this->block_area_ += this->new_elem_areas_[ p ];
     }
   }
   
@@ -1300,9 +1197,6 @@ void IsosurfacePrivate::compute_cap_faces()
   // For each of 6 caps
   for( int cap_num = 0; cap_num < 6; cap_num++ )
   {
-    unsigned int min_point_index = static_cast< unsigned int >( this->points_.size() );
-    unsigned int min_face_index = static_cast< unsigned int >( this->faces_.size() );
-
     // Each 
     // STEP 1: Find cell types
 
@@ -1391,9 +1285,9 @@ void IsosurfacePrivate::compute_cap_faces()
           // Transform point by mask transform
           PointF node_point = grid_transform.project( PointF( x, y, z ) );
           // Add node to the points list.
-          this->points_.push_back( node_point );
+          this->block_points_.push_back( node_point );
           unsigned int point_index = 
-            static_cast< unsigned int >( this->points_.size() - 1 );
+            static_cast< unsigned int >( this->block_points_.size() - 1 );
 
           // Add relevant canonical coordinates to translation table for adjacent cells.
           // Find indices and canonical coordinates of 1-4 adjacent cells
@@ -1463,9 +1357,9 @@ void IsosurfacePrivate::compute_cap_faces()
           // Transform point by mask transform
           PointF edge_point = grid_transform.project( PointF( edge_x, edge_y, edge_z) );
           // Add edge to the points list.
-          this->points_.push_back( edge_point );
+          this->block_points_.push_back( edge_point );
           unsigned int point_index = 
-            static_cast< unsigned int >( this->points_.size() - 1 );
+            static_cast< unsigned int >( this->block_points_.size() - 1 );
 
           // Add the relevant canonical coordinates to the translation table for adjacent 1-2 cells.
 
@@ -1515,9 +1409,9 @@ void IsosurfacePrivate::compute_cap_faces()
           // Transform point by mask transform
           PointF edge_point = grid_transform.project( PointF( edge_x, edge_y, edge_z) );
           // Add edge to the points list.
-          this->points_.push_back( edge_point );
+          this->block_points_.push_back( edge_point );
           unsigned int point_index = 
-            static_cast< unsigned int >( this->points_.size() - 1 );
+            static_cast< unsigned int >( this->block_points_.size() - 1 );
 
           // Add the relevant canonical coordinates to the translation table for adjacent 1-2 cells.
 
@@ -1566,40 +1460,28 @@ void IsosurfacePrivate::compute_cap_faces()
           // Look up the point index in the translation table for this cell 
           unsigned int point_index = point_trans_table[ cell_index ][ canonical_index ];
           // Store the point coordinates in the temporary variable
-          elem_vertices[ triangle_point_index ] = this->points_[ point_index ];
+          elem_vertices[ triangle_point_index ] = this->block_points_[ point_index ];
           // Add point index to the faces list
-          this->faces_.push_back( point_index );
+          this->block_faces_.push_back( point_index );
         }
         // Compute the area of  the triangle and add it to the total area
-        this->area_ += 0.5f * Cross( elem_vertices[ 1 ] - elem_vertices[ 0 ], 
+        this->block_area_ += 0.5f * Cross( elem_vertices[ 1 ] - elem_vertices[ 0 ], 
           elem_vertices[ 2 ] - elem_vertices[ 0 ] ).length();
       }
     }
-
-    // Create a rendering "patch" for each cap 
-    unsigned int max_point_index = static_cast< unsigned int >( this->points_.size() );
-    unsigned int max_face_index = static_cast< unsigned int >( this->faces_.size() );
-    if( min_point_index != max_point_index && min_face_index != max_face_index )
-    {
-      this->min_point_index_.push_back( min_point_index );
-      this->max_point_index_.push_back( max_point_index );
-
-      this->min_face_index_.push_back( min_face_index );
-      this->max_face_index_.push_back( max_face_index );
-    }
   }
 }
 
 void IsosurfacePrivate::parallel_compute_normals( int thread, int num_threads, 
   boost::barrier& barrier )
 {
-  size_t num_vertices = this->points_.size();
+  size_t num_vertices = this->block_points_.size();
 
   if ( thread == 0 ) // Only need to setup once 
   { 
     // Reset the normals vector
-    this->normals_.clear();
-    this->normals_.resize( num_vertices, VectorF( 0, 0, 0 ) );
+    this->block_normals_.clear();
+    this->block_normals_.resize( num_vertices, VectorF( 0, 0, 0 ) );
   }
 
   // All threads have to wait until setup is done before proceeding
@@ -1621,11 +1503,11 @@ void IsosurfacePrivate::parallel_compute_normals( int thread, int num_threads,
   }
 
   // For each face
-  for( size_t i = 0; i + 2 < this->faces_.size(); i += 3 )
+  for( size_t i = 0; i + 2 < this->block_faces_.size(); i += 3 )
   {
-    size_t vertex_index1 = this->faces_[ i ];
-    size_t vertex_index2 = this->faces_[ i + 1 ];
-    size_t vertex_index3 = this->faces_[ i + 2 ];
+    size_t vertex_index1 = this->block_faces_[ i ];
+    size_t vertex_index2 = this->block_faces_[ i + 1 ];
+    size_t vertex_index3 = this->block_faces_[ i + 2 ];
 
     // If this face has at least one vertex in our range
     if( ( vertex_index_start <= vertex_index1 && vertex_index1 < vertex_index_end ) ||
@@ -1633,9 +1515,9 @@ void IsosurfacePrivate::parallel_compute_normals( int thread, int num_threads,
       ( vertex_index_start <= vertex_index3 && vertex_index3 < vertex_index_end ) )
     { 
       // Get vertices of face
-      PointF p1 = this->points_[ vertex_index1 ];
-      PointF p2 = this->points_[ vertex_index2 ];
-      PointF p3 = this->points_[ vertex_index3 ];
+      PointF p1 = this->block_points_[ vertex_index1 ];
+      PointF p2 = this->block_points_[ vertex_index2 ];
+      PointF p3 = this->block_points_[ vertex_index3 ];
 
       // Calculate cross product of edges
       VectorF v0 = p3 - p2;
@@ -1645,15 +1527,15 @@ void IsosurfacePrivate::parallel_compute_normals( int thread, int num_threads,
       // Add to normal for each vertex in our range
       if( ( vertex_index_start <= vertex_index1 && vertex_index1 < vertex_index_end ) )
       {
-        this->normals_[ vertex_index1 ] += n;
+        this->block_normals_[ vertex_index1 ] += n;
       }
       if( ( vertex_index_start <= vertex_index2 && vertex_index2 < vertex_index_end ) )
       {
-        this->normals_[ vertex_index2 ] += n;
+        this->block_normals_[ vertex_index2 ] += n;
       }
       if( ( vertex_index_start <= vertex_index3 && vertex_index3 < vertex_index_end ) )
       {
-        this->normals_[ vertex_index3 ] += n;
+        this->block_normals_[ vertex_index3 ] += n;
       }
     }
   }
@@ -1662,8 +1544,203 @@ void IsosurfacePrivate::parallel_compute_normals( int thread, int num_threads,
   for( size_t i = vertex_index_start; i < vertex_index_end; i++ )
   {
     // Normalize normal
-    this->normals_[ i ].normalize();
+    this->block_normals_[ i ].normalize();
+  }
+}
+
+bool IsosurfacePrivate::compute_block( size_t block )
+{
+  this->keep_zstart_ = block * BLOCK_SLICES_C;
+  this->keep_zend_ = Min( this->keep_zstart_ + BLOCK_SLICES_C, this->elem_nz_ );
+  this->zstart_ = this->keep_zstart_ > 0 ? this->keep_zstart_ - 1 : 0;
+  this->zend_ = Min( this->keep_zend_ + 1, this->elem_nz_ );
+
+  this->block_points_.clear();
+  this->block_faces_.clear();
+  this->block_seam_bottom_.clear();
+  this->block_seam_top_.clear();
+  this->block_area_ = 0;
+
+  Parallel parallel_faces( boost::bind( &IsosurfacePrivate::parallel_compute_faces, 
+    this, _1, _2, _3 ) );
+  parallel_faces.run();
+
+  if ( this->need_abort_ )
+  {
+    return false;
+  }
+
+  Parallel parallel_normals( boost::bind( &IsosurfacePrivate::parallel_compute_normals, 
+    this, _1, _2, _3 ) );
+  parallel_normals.run();
+
+  this->store_part( block, this->min_face_index_[ this->keep_zstart_ - this->zstart_ ],
+    this->max_face_index_[ this->keep_zend_ - 1 - this->zstart_ ] );
+  return true;
+}
+
+void IsosurfacePrivate::compute_caps( size_t part )
+{
+  this->block_points_.clear();
+  this->block_faces_.clear();
+  this->block_seam_bottom_.clear();
+  this->block_seam_top_.clear();
+  this->block_area_ = 0;
+
+  this->compute_cap_faces();
+
+  Parallel parallel_normals( boost::bind( &IsosurfacePrivate::parallel_compute_normals, 
+    this, _1, _2, _3 ) );
+  parallel_normals.run();
+
+  this->store_part( part, 0, this->block_faces_.size() );
+}
+
+void IsosurfacePrivate::collect_seam_points( size_t plane, const UIntVector& edge_x, 
+  const UIntVector& edge_y, UIntVector& seam )
+{
+  seam.clear();
+
+  // Without cubes no points were made
+  if ( this->elem_nx_ == 0 || this->elem_ny_ == 0 ) return;
+
+  // An edge is split when the mask differs between its two ends, which only depends on the
+  // plane itself, so both blocks find the same edges in the same order
+  const unsigned char* data = this->data_ + plane * ( this->nx_ * this->ny_ );
+  for ( size_t y = 0; y < this->ny_; y++ )
+  {
+    for ( size_t x = 0; x < this->nx_; x++ )
+    {
+      size_t q = y * this->nx_ + x;
+      if ( x + 1 < this->nx_ && ( ( data[ q ] ^ data[ q + 1 ] ) & this->mask_value_ ) )
+      {
+        seam.push_back( edge_x[ q ] );
+      }
+      if ( y + 1 < this->ny_ && ( ( data[ q ] ^ data[ q + this->nx_ ] ) & this->mask_value_ ) )
+      {
+        seam.push_back( edge_y[ q ] );
+      }
+    }
+  }
+}
+
+void IsosurfacePrivate::store_part( size_t part, size_t face_start, size_t face_end )
+{
+  IsosurfacePartHandle new_part( new IsosurfacePart );
+
+  // Compact the points of the block to the ones that are used by the faces that are kept
+  const unsigned int UNUSED_C = std::numeric_limits< unsigned int >::max();
+  UIntVector point_map( this->block_points_.size(), UNUSED_C );
+  new_part->faces_.resize( face_end - face_start );
+  for ( size_t j = face_start; j < face_end; j++ )
+  {
+    unsigned int& index = point_map[ this->block_faces_[ j ] ];
+    if ( index == UNUSED_C )
+    {
+      index = static_cast< unsigned int >( new_part->points_.size() );
+      new_part->points_.push_back( this->block_points_[ this->block_faces_[ j ] ] );
+      new_part->normals_.push_back( this->block_normals_[ this->block_faces_[ j ] ] );
+    }
+    new_part->faces_[ j - face_start ] = index;
+  }
+  new_part->area_ = this->block_area_;
+
+  // The seams refer to the compacted points
+  new_part->seam_bottom_.resize( this->block_seam_bottom_.size() );
+  for ( size_t j = 0; j < this->block_seam_bottom_.size(); j++ )
+  {
+    new_part->seam_bottom_[ j ] = point_map[ this->block_seam_bottom_[ j ] ];
+  }
+  new_part->seam_top_.resize( this->block_seam_top_.size() );
+  for ( size_t j = 0; j < this->block_seam_top_.size(); j++ )
+  {
+    new_part->seam_top_[ j ] = point_map[ this->block_seam_top_[ j ] ];
+  }
+
+  if ( part == this->parts_.size() )
+  {
+    this->parts_.push_back( new_part );
+  }
+  else
+  {
+    this->parts_[ part ] = new_part;
+  }
+
+  this->mesh_changed();
+}
+
+void IsosurfacePrivate::mesh_changed()
+{
+  this->mesh_outdated_ = true;
+  PointFVector().swap( this->points_ );
+  VectorFVector().swap( this->normals_ );
+  UIntVector().swap( this->faces_ );
+
+  // The values no longer match the points
+  if ( !this->values_.empty() )
+  {
+    this->values_.clear();
+    this->values_changed_ = true;
+    for ( size_t level = 0; level < this->lod_changed_.size(); level++ )
+    {
+      this->lod_changed_[ level ].assign( this->lod_changed_[ level ].size(), true );
+    }
+  }
+}
+
+void IsosurfacePrivate::assemble_mesh()
+{
+  if ( !this->mesh_outdated_ ) return;
+
+  const unsigned int UNUSED_C = std::numeric_limits< unsigned int >::max();
+  this->points_.clear();
+  this->normals_.clear();
+  this->faces_.clear();
+
+  for ( size_t i = 0; i < this->parts_.size(); i++ )
+  {
+    IsosurfacePart& part = *this->parts_[ i ];
+    part.mesh_index_.assign( part.points_.size(), UNUSED_C );
+
+    // The points on the seam with the block below are the points of that block
+    if ( i > 0 && i < this->num_blocks_ )
+    {
+      const IsosurfacePart& below = *this->parts_[ i - 1 ];
+      if ( part.seam_bottom_.size() == below.seam_top_.size() )
+      {
+        for ( size_t j = 0; j < part.seam_bottom_.size(); j++ )
+        {
+          if ( part.seam_bottom_[ j ] == UNUSED_C || below.seam_top_[ j ] == UNUSED_C ) continue;
+          part.mesh_index_[ part.seam_bottom_[ j ] ] = below.mesh_index_[ below.seam_top_[ j ] ];
+        }
+      }
+    }
+
+    for ( size_t j = 0; j < part.points_.size(); j++ )
+    {
+      if ( part.mesh_index_[ j ] != UNUSED_C ) continue;
+      part.mesh_index_[ j ] = static_cast< unsigned int >( this->points_.size() );
+      this->points_.push_back( part.points_[ j ] );
+      this->normals_.push_back( part.normals_[ j ] );
+    }
+
+    for ( size_t j = 0; j < part.faces_.size(); j++ )
+    {
+      this->faces_.push_back( part.mesh_index_[ part.faces_[ j ] ] );
+    }
   }
+
+  this->mesh_outdated_ = false;
+}
+
+size_t IsosurfacePrivate::get_num_faces() const
+{
+  size_t num_faces = 0;
+  for ( size_t i = 0; i < this->parts_.size(); i++ )
+  {
+    num_faces += this->parts_[ i ]->faces_.size() / 3;
+  }
+  return num_faces;
 }
 
 void IsosurfacePrivate::upload_to_vertex_buffer()
@@ -1673,24 +1750,33 @@ void IsosurfacePrivate::upload_to_vertex_buffer()
     return;
   }
 
-  size_t num_of_parts = this->part_points_.size();
-  bool has_values = this->values_.size() == this->points_.size();
+  size_t num_of_parts = this->parts_.size();
+  bool has_values = !this->values_.empty();
+
+  // Only the parts that changed need to be uploaded again, unless the values changed or the
+  // isosurface did not fit in GPU memory before
+  bool upload_all = !this->vbo_available_ || this->values_changed_ || 
+    this->vbo_batches_.size() != num_of_parts;
 
   // Estimate the size of video memory required to upload the isosurface
   ptrdiff_t total_size = 0;
   for ( size_t i = 0; i < num_of_parts; ++i )
   {
-    unsigned int num_pts = this->part_points_[ i ].second - this->part_points_[ i ].first;
+    const IsosurfacePart& part = *this->parts_[ i ];
+    size_t num_pts = part.points_.size();
     ptrdiff_t vertex_size = num_pts * sizeof( PointF );
     ptrdiff_t normal_size = num_pts * sizeof( VectorF );
     ptrdiff_t value_size = has_values ? num_pts * sizeof( float ) : 0;
-    unsigned int num_face_indices = this->part_faces_[ i ].second - this->part_faces_[ i ].first;
+    size_t num_face_indices = part.faces_.size();
     ptrdiff_t face_size = num_face_indices * sizeof( unsigned int );
     ptrdiff_t batch_size = vertex_size + normal_size + value_size + face_size;
-    CORE_LOG_MESSAGE( "Isosurface Batch " + ExportToString( i ) + ": " +
-             ExportToString( num_pts ) + " vertices, " +
-             ExportToString( num_face_indices / 3 ) + " triangles. Total memory: " + 
-             ExportToString( batch_size ) );
+    if ( upload_all || part.changed_ )
+    {
+      CORE_LOG_MESSAGE( "Isosurface Batch " + ExportToString( i ) + ": " +
+               ExportToString( num_pts ) + " vertices, " +
+               ExportToString( num_face_indices / 3 ) + " triangles. Total memory: " + 
+               ExportToString( batch_size ) );
+    }
     total_size += batch_size;
   }
   CORE_LOG_MESSAGE( "Total memory required for the isosurface: " +
@@ -1711,35 +1797,11 @@ void IsosurfacePrivate::upload_to_vertex_buffer()
   this->vbo_batches_.resize( num_of_parts );
   for ( size_t i = 0; i < num_of_parts; ++i )
   {
-    this->vbo_batches_[ i ].reset( new VertexBufferBatch );
-    this->vbo_batches_[ i ]->vertex_buffer_.reset( new Core::VertexAttribArrayBuffer );
-    this->vbo_batches_[ i ]->normal_buffer_.reset( new Core::VertexAttribArrayBuffer );
-    this->vbo_batches_[ i ]->faces_buffer_.reset( new Core::ElementArrayBuffer );
-    this->vbo_batches_[ i ]->vertex_buffer_->set_array( 
-      VertexAttribArrayType::VERTEX_E, 3, GL_FLOAT, 0, 0 );
-    this->vbo_batches_[ i ]->normal_buffer_->set_array( 
-      VertexAttribArrayType::NORMAL_E, GL_FLOAT, 0, 0 );
-
-    unsigned int num_pts = this->part_points_[ i ].second - this->part_points_[ i ].first;
-    ptrdiff_t vertex_size = num_pts * sizeof( PointF );
-    ptrdiff_t normal_size = num_pts * sizeof( VectorF );
-    unsigned int num_face_indices = this->part_faces_[ i ].second - this->part_faces_[ i ].first;
-    ptrdiff_t face_size = num_face_indices * sizeof( unsigned int );
-
-    this->vbo_batches_[ i ]->vertex_buffer_->set_buffer_data( vertex_size, 
-      &this->points_[ this->part_points_[ i ].first ], GL_STATIC_DRAW );
-    this->vbo_batches_[ i ]->normal_buffer_->set_buffer_data( normal_size, 
-      &this->normals_[ this->part_points_[ i ].first ], GL_STATIC_DRAW );
-    this->vbo_batches_[ i ]->faces_buffer_->set_buffer_data( face_size, 
-      &this->part_indices_[ i ][ 0 ], GL_STATIC_DRAW );
-    if ( has_values )
+    if ( upload_all || this->parts_[ i ]->changed_ )
     {
-      this->vbo_batches_[ i ]->value_buffer_.reset( new Core::VertexAttribArrayBuffer );
-      this->vbo_batches_[ i ]->value_buffer_->set_generic_array( 1, 1, GL_FLOAT, 
-        GL_FALSE, 0, 0 );
-      this->vbo_batches_[ i ]->value_buffer_->set_buffer_data( num_pts * sizeof( float ),
-        &this->values_[ this->part_points_[ i ].first ], GL_STATIC_DRAW );
+      this->upload_part_to_vertex_buffer( i, has_values );
     }
+    this->parts_[ i ]->changed_ = false;
   }
   
   this->surface_changed_ = false;
@@ -1747,12 +1809,328 @@ void IsosurfacePrivate::upload_to_vertex_buffer()
   this->vbo_available_ = true;
 }
 
+void IsosurfacePrivate::upload_part_to_vertex_buffer( size_t part, bool has_values )
+{
+  const IsosurfacePart& iso_part = *this->parts_[ part ];
+
+  // Nothing to render for this part
+  if ( iso_part.faces_.empty() )
+  {
+    this->vbo_batches_[ part ].reset();
+    return;
+  }
+
+  // The values are stored for the points of the stitched mesh
+  FloatVector values;
+  if ( has_values )
+  {
+    values.resize( iso_part.points_.size() );
+    for ( size_t j = 0; j < values.size(); j++ )
+    {
+      values[ j ] = this->values_[ iso_part.mesh_index_[ j ] ];
+    }
+  }
+
+  this->upload_batch( this->vbo_batches_[ part ], iso_part.points_.size(), 
+    &iso_part.points_[ 0 ], &iso_part.normals_[ 0 ], has_values ? &values[ 0 ] : 0,
+    iso_part.faces_.size(), &iso_part.faces_[ 0 ] );
+}
+
+void IsosurfacePrivate::upload_lod_to_vertex_buffer( size_t level )
+{
+  size_t num_of_parts = this->parts_.size();
+  bool has_values = !this->values_.empty();
+
+  std::vector< VertexBufferBatchHandle >& batches = this->lod_batches_[ level - 1 ];
+  std::vector< bool >& changed = this->lod_changed_[ level - 1 ];
+  if ( batches.size() != num_of_parts )
+  {
+    batches.resize( num_of_parts );
+    changed.assign( num_of_parts, true );
+  }
+
+  RenderResources::lock_type rr_lock( RenderResources::GetMutex() );
+  for ( size_t i = 0; i < num_of_parts; ++i )
+  {
+    if ( !changed[ i ] ) continue;
+    changed[ i ] = false;
+
+    const IsosurfaceLOD& lod = this->parts_[ i ]->lods_[ level - 1 ];
+    if ( lod.faces_.empty() )
+    {
+      batches[ i ].reset();
+      continue;
+    }
+
+    // The values are stored for the full resolution points
+    FloatVector values;
+    if ( has_values )
+    {
+      values.resize( lod.points_.size() );
+      for ( size_t j = 0; j < lod.sources_.size(); j++ )
+      {
+        values[ j ] = this->values_[ this->parts_[ i ]->mesh_index_[ lod.sources_[ j ] ] ];
+      }
+    }
+
+    this->upload_batch( batches[ i ], lod.points_.size(), &lod.points_[ 0 ], 
+      &lod.normals_[ 0 ], has_values ? &values[ 0 ] : 0, lod.faces_.size(), 
+      &lod.faces_[ 0 ] );
+  }
+}
+
+void IsosurfacePrivate::upload_batch( VertexBufferBatchHandle& batch, size_t num_pts, 
+  const PointF* points, const VectorF* normals, const float* values, 
+  size_t num_face_indices, const unsigned int* faces )
+{
+  // Reuse the buffers of the batch if it was uploaded before, so the data is replaced in place
+  if ( !batch )
+  {
+    batch.reset( new VertexBufferBatch );
+    batch->vertex_buffer_.reset( new Core::VertexAttribArrayBuffer );
+    batch->normal_buffer_.reset( new Core::VertexAttribArrayBuffer );
+    batch->faces_buffer_.reset( new Core::ElementArrayBuffer );
+    batch->vertex_buffer_->set_array( VertexAttribArrayType::VERTEX_E, 3, GL_FLOAT, 0, 0 );
+    batch->normal_buffer_->set_array( VertexAttribArrayType::NORMAL_E, GL_FLOAT, 0, 0 );
+  }
+
+  ptrdiff_t vertex_size = num_pts * sizeof( PointF );
+  ptrdiff_t normal_size = num_pts * sizeof( VectorF );
+  ptrdiff_t face_size = num_face_indices * sizeof( unsigned int );
+
+  batch->vertex_buffer_->set_buffer_data( vertex_size, points, GL_STATIC_DRAW );
+  batch->normal_buffer_->set_buffer_data( normal_size, normals, GL_STATIC_DRAW );
+  batch->faces_buffer_->set_buffer_data( face_size, faces, GL_STATIC_DRAW );
+  if ( values )
+  {
+    if ( !batch->value_buffer_ )
+    {
+      batch->value_buffer_.reset( new Core::VertexAttribArrayBuffer );
+      batch->value_buffer_->set_generic_array( 1, 1, GL_FLOAT, GL_FALSE, 0, 0 );
+    }
+    batch->value_buffer_->set_buffer_data( num_pts * sizeof( float ), values, GL_STATIC_DRAW );
+  }
+  else
+  {
+    batch->value_buffer_.reset();
+  }
+}
+
+void IsosurfacePrivate::draw_batch( const VertexBufferBatchHandle& batch, 
+  size_t num_face_indices, bool use_values )
+{
+  // Parts without faces have no vertex buffers
+  if ( !batch ) return;
+
+  batch->vertex_buffer_->enable_arrays();
+  batch->normal_buffer_->enable_arrays();
+  if ( use_values )
+  {
+    batch->value_buffer_->enable_arrays();
+  }
+  batch->faces_buffer_->draw_elements( GL_TRIANGLES, 
+    static_cast< GLsizei >( num_face_indices ), GL_UNSIGNED_INT );
+  batch->vertex_buffer_->disable_arrays();
+  batch->normal_buffer_->disable_arrays();
+  if ( use_values )
+  {
+    batch->value_buffer_->disable_arrays();
+  }
+}
+
+void IsosurfacePrivate::setup_lods()
+{
+  size_t num_faces = this->get_num_faces();
+  this->num_lod_levels_ = 0;
+  this->lod_ratio_ = 1.0;
+  this->lod_triangle_budget_ = this->triangle_budget_;
+  if ( this->triangle_budget_ > 0 && num_faces > this->triangle_budget_ )
+  {
+    // Each level has about a quarter of the triangles of the level before it, unless more 
+    // levels than MAX_LOD_LEVELS_C would be needed to get down to the budget
+    double reduction = static_cast< double >( this->triangle_budget_ ) / 
+      static_cast< double >( num_faces );
+    this->num_lod_levels_ = Min( MAX_LOD_LEVELS_C, 
+      static_cast< size_t >( std::ceil( std::log( reduction ) / std::log( 0.25 ) - 1e-6 ) ) );
+    this->num_lod_levels_ = Max( this->num_lod_levels_, size_t( 1 ) );
+    this->lod_ratio_ = std::pow( reduction, 
+      1.0 / static_cast< double >( this->num_lod_levels_ ) );
+  }
+
+  this->lod_batches_.clear();
+  this->lod_batches_.resize( this->num_lod_levels_ );
+  this->lod_changed_.clear();
+  this->lod_changed_.resize( this->num_lod_levels_ );
+  for ( size_t i = 0; i < this->parts_.size(); i++ )
+  {
+    this->parts_[ i ]->lod_outdated_ = true;
+    if ( this->num_lod_levels_ == 0 ) this->parts_[ i ]->lods_.clear();
+  }
+}
+
+bool IsosurfacePrivate::compute_lods()
+{
+  this->need_abort_ = false;
+
+  // Within the triangle budget the full resolution mesh is rendered as is
+  if ( this->num_lod_levels_ == 0 )
+  {
+    return true;
+  }
+
+  // Parts differ a lot in size, hence every part is a task of its own so that idle workers
+  // can pick up the remaining parts
+  TaskGroup group;
+  ParallelFor( group, 0, this->parts_.size(), boost::bind( 
+    &IsosurfacePrivate::parallel_compute_lods, this, &group, _1, _2 ), 1 );
+  this->need_abort_ = group.is_canceled();
+
+  if ( this->need_abort_ )
+  {
+    return false;
+  }
+
+  for ( size_t i = 0; i < this->parts_.size(); i++ )
+  {
+    if ( !this->parts_[ i ]->lod_outdated_ ) continue;
+    this->parts_[ i ]->lod_outdated_ = false;
+    for ( size_t level = 0; level < this->lod_changed_.size(); level++ )
+    {
+      if ( this->lod_changed_[ level ].size() > i ) this->lod_changed_[ level ][ i ] = true;
+    }
+  }
+  return true;
+}
+
+bool IsosurfacePrivate::update_lods()
+{
+  size_t num_faces = this->get_num_faces();
+  bool over_budget = this->triangle_budget_ > 0 && num_faces > this->triangle_budget_;
+
+  // The levels only need to be set up again when the budget changed or when the edit moved the
+  // isosurface across the budget, otherwise the parts that were not touched keep their levels
+  if ( this->lod_triangle_budget_ != this->triangle_budget_ || 
+    over_budget != ( this->num_lod_levels_ > 0 ) )
+  {
+    this->setup_lods();
+  }
+
+  return this->compute_lods();
+}
+
+bool IsosurfacePrivate::check_lod_abort( TaskGroup* group )
+{
+  boost::mutex::scoped_lock lock( this->check_abort_mutex_ );
+  if ( group->is_canceled() ) return true;
+  if ( this->check_abort_ && this->check_abort_() )
+  {
+    group->cancel();
+    return true;
+  }
+  return false;
+}
+
+void IsosurfacePrivate::parallel_compute_lods( TaskGroup* group, size_t part_begin, 
+  size_t part_end )
+{
+  boost::function< bool () > check_abort = boost::bind( 
+    &IsosurfacePrivate::check_lod_abort, this, group );
+
+  for ( size_t part = part_begin; part < part_end; part++ )
+  {
+    IsosurfacePart& iso_part = *this->parts_[ part ];
+    if ( !iso_part.lod_outdated_ ) continue;
+    if ( check_abort() ) return;
+
+    std::vector< IsosurfaceLOD >& lods = iso_part.lods_;
+    lods.clear();
+    lods.resize( this->num_lod_levels_ );
+
+    size_t num_faces = iso_part.faces_.size() / 3;
+
+    for ( size_t level = 0; level < this->num_lod_levels_; level++ )
+    {
+      // Each level is decimated from the level before it
+      const PointFVector& src_points = level == 0 ? iso_part.points_ : 
+        lods[ level - 1 ].points_;
+      const UIntVector& src_faces = level == 0 ? iso_part.faces_ : lods[ level - 1 ].faces_;
+      size_t target_faces = static_cast< size_t >( static_cast< double >( num_faces ) * 
+        std::pow( this->lod_ratio_, static_cast< double >( level + 1 ) ) );
+
+      IsosurfaceLOD& lod = lods[ level ];
+      UIntVector sources;
+      if ( !QuadricDecimator::Decimate( src_points, src_faces, target_faces, lod.points_, 
+        lod.faces_, sources, check_abort ) )
+      {
+        group->cancel();
+        return;
+      }
+
+      lod.sources_.resize( sources.size() );
+      lod.normals_.resize( sources.size() );
+      for ( size_t j = 0; j < sources.size(); j++ )
+      {
+        lod.sources_[ j ] = level == 0 ? sources[ j ] : 
+          lods[ level - 1 ].sources_[ sources[ j ] ];
+        lod.normals_[ j ] = iso_part.normals_[ lod.sources_[ j ] ];
+      }
+    }
+  }
+}
+
+void IsosurfacePrivate::get_lod_mesh( size_t level, PointFVector& points, UIntVector& faces, 
+  FloatVector& values )
+{
+  points.clear();
+  faces.clear();
+  values.clear();
+  bool has_values = !this->values_.empty();
+
+  // The points on the seams between the blocks are never moved by the decimation, hence they
+  // are stitched together through the points of the full resolution mesh they come from
+  this->assemble_mesh();
+  const unsigned int UNUSED_C = std::numeric_limits< unsigned int >::max();
+  UIntVector lod_index( this->points_.size(), UNUSED_C );
+
+  for ( size_t i = 0; i < this->parts_.size(); i++ )
+  {
+    const IsosurfacePart& part = *this->parts_[ i ];
+    const IsosurfaceLOD& lod = part.lods_[ level - 1 ];
+    UIntVector point_map( lod.points_.size() );
+    for ( size_t j = 0; j < lod.points_.size(); j++ )
+    {
+      unsigned int mesh_index = part.mesh_index_[ lod.sources_[ j ] ];
+      if ( lod_index[ mesh_index ] == UNUSED_C )
+      {
+        lod_index[ mesh_index ] = static_cast< unsigned int >( points.size() );
+        points.push_back( lod.points_[ j ] );
+        if ( has_values ) values.push_back( this->values_[ mesh_index ] );
+      }
+      point_map[ j ] = lod_index[ mesh_index ];
+    }
+
+    for ( size_t j = 0; j < lod.faces_.size(); j++ )
+    {
+      faces.push_back( point_map[ lod.faces_[ j ] ] );
+    }
+  }
+}
+
 void IsosurfacePrivate::reset()
 {
   this->points_.clear();
   this->normals_.clear();
   this->faces_.clear();
   this->values_.clear();
+  this->mesh_outdated_ = false;
+  this->parts_.clear();
+  this->num_blocks_ = 0;
+  this->lod_batches_.clear();
+  this->lod_changed_.clear();
+  this->num_lod_levels_ = 0;
+  this->lod_ratio_ = 1.0;
+  this->area_ = 0;
+  this->generation_ = -1;
 }
 
 Isosurface::Isosurface( const MaskVolumeHandle& mask_volume ) :
@@ -1764,6 +2142,16 @@ Isosurface::Isosurface( const MaskVolumeHandle& mask_volume ) :
   this->private_->surface_changed_ = false;
   this->private_->values_changed_ = false;
   this->private_->vbo_available_ = false;
+  this->private_->area_ = 0;
+  this->private_->mesh_outdated_ = false;
+  this->private_->num_blocks_ = 0;
+  this->private_->quality_factor_ = 1.0;
+  this->private_->capping_enabled_ = false;
+  this->private_->generation_ = -1;
+  this->private_->triangle_budget_ = DEFAULT_TRIANGLE_BUDGET_C;
+  this->private_->lod_triangle_budget_ = DEFAULT_TRIANGLE_BUDGET_C;
+  this->private_->num_lod_levels_ = 0;
+  this->private_->lod_ratio_ = 1.0;
 
   // Test code -- set default colormap
   //this->private_->color_map_ = ColorMapHandle( new ColorMap() );
@@ -1774,17 +2162,20 @@ void Isosurface::compute( double quality_factor, bool capping_enabled,
 {
   lock_type lock( this->get_mutex() );
 
-  this->private_->points_.clear();
-  this->private_->normals_.clear();
-  this->private_->faces_.clear();
-  this->private_->values_.clear();
-  this->private_->area_ = 0;
+  this->private_->reset();
   this->private_->values_changed_ = false;
   this->private_->check_abort_ = check_abort;
+  this->private_->quality_factor_ = quality_factor;
+  this->private_->capping_enabled_ = capping_enabled;
 
   {
     Core::MaskVolume::shared_lock_type vol_lock( this->private_->orig_mask_volume_->get_mutex() );
 
+    // Remember which version of the mask the isosurface was computed for, so it can be updated
+    // incrementally later on.
+    DataBlock::generation_type generation = this->private_->orig_mask_volume_->
+      get_mask_data_block()->get_generation();
+
     // Initially assume we're computing the isosurface for the original volume (not downsampled)
     this->private_->compute_mask_volume_ = this->private_->orig_mask_volume_;
 
@@ -1807,153 +2198,199 @@ void Isosurface::compute( double quality_factor, bool capping_enabled,
     // Copy values to members just to simplify and shorten code.
     this->private_->compute_setup();
 
-    // Compute isosurface without caps
-    Parallel parallel_faces( boost::bind( &IsosurfacePrivate::parallel_compute_faces, 
-      this->private_, _1, _2, _3 ) );
-    parallel_faces.run();
-
-    if ( check_abort() )
+    // Compute isosurface without caps, one block of slices at a time
+    this->private_->elem_nz_ = this->private_->nz_ - 1;
+    this->private_->num_blocks_ = ( this->private_->elem_nz_ + 
+      IsosurfacePrivate::BLOCK_SLICES_C - 1 ) / IsosurfacePrivate::BLOCK_SLICES_C;
+    for ( size_t block = 0; block < this->private_->num_blocks_; block++ )
     {
-      // leave it in a decent state
-      this->private_->reset();
-      return;
+      if ( !this->private_->compute_block( block ) || check_abort() )
+      {
+        // leave it in a decent state
+        this->private_->reset();
+        return;
+      }
+
+      this->update_progress_signal_( static_cast< double >( block + 1 ) / 
+        static_cast< double >( this->private_->num_blocks_ + 1 ) );
     }
 
     // Compute isosurface caps
     if( capping_enabled )
     {
-      this->private_->compute_cap_faces();
+      this->private_->compute_caps( this->private_->num_blocks_ );
     }
-  }
 
-  // Check for empty isosurface
-  if( this->private_->points_.size() == 0 ) 
-  {
-    return;
+    this->private_->generation_ = generation;
   }
 
-  // Test code -- assign values to vertices in range [0, 1].  
-  /*size_t num_points = this->private_->points_.size();
-  for( size_t i = 0; i < num_points; i++ )
-  {
-    float val = static_cast< float >( i ) / static_cast< float >( num_points );
-    this->private_->values_.push_back( val );
-  }*/
-
-  Parallel parallel_normals( boost::bind( &IsosurfacePrivate::parallel_compute_normals, 
-    this->private_, _1, _2, _3 ) );
-  parallel_normals.run();
-
-  if ( check_abort() )
+  // Decimate the isosurface into levels of detail that fit the triangle budget
+  this->private_->setup_lods();
+  if ( !this->private_->compute_lods() )
   {
     // leave it in a decent state
     this->private_->reset();
     return;
   }
 
-  this->update_progress_signal_( IsosurfacePrivate::COMPUTE_PERCENT_PROGRESS_C + 
-    IsosurfacePrivate::NORMAL_PERCENT_PROGRESS_C );
+  this->private_->area_ = 0;
+  for ( size_t i = 0; i < this->private_->parts_.size(); i++ )
+  {
+    this->private_->area_ += this->private_->parts_[ i ]->area_;
+  }
 
   this->private_->type_buffer_.clear();
   this->private_->edge_buffer_.clear();
   this->private_->new_points_.clear();
+  this->private_->new_point_slots_.clear();
   this->private_->new_elems_.clear();
   this->private_->new_elem_areas_.clear();
-  this->private_->front_offset_.clear();
-  this->private_->back_offset_.clear();
-  
-  this->private_->part_points_.clear();
-  this->private_->part_faces_.clear();
-  this->private_->part_indices_.clear();
-  
-  unsigned int num_faces = 0;
-  unsigned int min_point_index = 0;
-  unsigned int min_face_index = 0;
-  
-  for ( size_t j = 0; j < this->private_->min_point_index_.size(); j++ )
+  this->private_->point_offset_.clear();
+  this->private_->face_offset_.clear();
+  this->private_->block_points_.clear();
+  this->private_->block_normals_.clear();
+  this->private_->block_faces_.clear();
+  this->private_->block_seam_bottom_.clear();
+  this->private_->block_seam_top_.clear();
+
+  this->private_->surface_changed_ = true;
+
+  this->update_progress_signal_( 1.0 );
+
+  // Test code
+  // this->export_legacy_isosurface( "", "test_isosurface" );
+}
+
+bool Isosurface::update( boost::function< bool () > check_abort )
+{
+  lock_type lock( this->get_mutex() );
+
+  MaskDataBlockHandle mask_data_block = 
+    this->private_->orig_mask_volume_->get_mask_data_block();
+  // NOTE: The generation is read before locking, so a change made while the isosurface is being
+  // updated will be picked up by the next update.
+  DataBlock::generation_type generation = mask_data_block->get_generation();
+  if ( this->private_->generation_ < 0 || generation == this->private_->generation_ )
   {
-    if ( num_faces == 0 )
-    {
-      min_point_index = this->private_->min_point_index_[ j ];
-      min_face_index = this->private_->min_face_index_[ j ];
-    }
-    
-    num_faces += this->private_->max_face_index_[ j ] - this->private_->min_face_index_[ j ];
-    
-    if ( num_faces > 0 && (num_faces > 1000000 || j == this->private_->min_point_index_.size() - 1 ) )
-    {
-      this->private_->part_points_.push_back( std::make_pair(
-        min_point_index, this->private_->max_point_index_[ j ] ) );
-      this->private_->part_faces_.push_back( std::make_pair(
-        min_face_index, this->private_->max_face_index_[ j ] ) );
-      num_faces = 0;
-    }
+    return true;
+  }
 
-    if ( check_abort() )
-    {
-      // leave it in a decent state
-      this->private_->reset();
-      return;
-    }
+  // Find the region that changed since the isosurface was computed.  Updates are only done for
+  // isosurfaces computed at full resolution.
+  IndexVector min, max;
+  bool known_region = false;
+  if ( this->private_->quality_factor_ == 1.0 )
+  {
+    MaskDataBlock::shared_lock_type data_lock( mask_data_block->get_mutex() );
+    known_region = mask_data_block->get_data_block()->get_changed_region( 
+      this->private_->generation_, min, max );
+  }
 
-    // Update progress
-    double partition_progress = 
-      static_cast< double >( j + 1 ) / static_cast< double >( this->private_->min_point_index_.size() ); 
-    double total_progress = IsosurfacePrivate::COMPUTE_PERCENT_PROGRESS_C + 
-      IsosurfacePrivate::NORMAL_PERCENT_PROGRESS_C +
-      ( partition_progress * IsosurfacePrivate::PARTITION_PERCENT_PROGRESS_C );
-    this->update_progress_signal_( total_progress );
+  // The whole isosurface needs to be computed again, which is left to the caller as it takes
+  // as long as the first computation
+  if ( !known_region || mask_data_block->get_nz() != this->private_->nz_ ||
+    mask_data_block->get_ny() != this->private_->ny_ ||
+    mask_data_block->get_nx() != this->private_->nx_ )
+  {
+    return false;
   }
-  size_t num_batches = this->private_->part_points_.size();
-  for ( size_t i = 0; i < num_batches; ++i )
+
+  // Nothing changed
+  if ( min.x() > max.x() || min.y() > max.y() || min.z() > max.z() )
+  {
+    this->private_->generation_ = generation;
+    return true;
+  }
+
+  this->private_->check_abort_ = check_abort;
+
   {
-    unsigned int num_face_indices = this->private_->part_faces_[ i ].second - 
-      this->private_->part_faces_[ i ].first;
-    UIntVector local_indices( num_face_indices );
-    for ( size_t j = 0; j < num_face_indices; ++j )
+    Core::MaskVolume::shared_lock_type vol_lock( this->private_->orig_mask_volume_->get_mutex() );
+    this->private_->compute_mask_volume_ = this->private_->orig_mask_volume_;
+    this->private_->compute_setup();
+    this->private_->elem_nz_ = this->private_->nz_ - 1;
+
+    // The faces of the cubes next to the changed voxels change, and with them the normals of
+    // all the points of these faces, which are shared with the cubes one slice further out.
+    IndexVector::index_type elem_nz = 
+      static_cast< IndexVector::index_type >( this->private_->elem_nz_ );
+    IndexVector::index_type z_start = Max( min.z() - 2, IndexVector::index_type( 0 ) );
+    IndexVector::index_type z_end = Min( max.z() + 1, elem_nz - 1 );
+    for ( IndexVector::index_type z = z_start; z <= z_end; z++ )
     {
-      size_t pt_global_idx = this->private_->part_faces_[ i ].first + j;
-      local_indices[ j ] = this->private_->faces_[ pt_global_idx ] - 
-        this->private_->part_points_[ i ].first;
-      assert( local_indices[ j ] >= 0 && 
-           local_indices[ j ] < ( this->private_->part_points_[ i ].second - 
-                     this->private_->part_points_[ i ].first ) );
+      // Process each block once
+      if ( z != z_start && z % IsosurfacePrivate::BLOCK_SLICES_C != 0 ) continue;
+      
+      if ( !this->private_->compute_block( z / IsosurfacePrivate::BLOCK_SLICES_C ) ||
+        check_abort() )
+      {
+        // leave it in a decent state
+        this->private_->reset();
+        return true;
+      }
     }
-    this->private_->part_indices_.push_back( local_indices );
-  }
-  
-  this->private_->min_point_index_.clear();
-  this->private_->max_point_index_.clear();
-  this->private_->min_face_index_.clear();
-  this->private_->max_face_index_.clear();
 
-  this->private_->surface_changed_ = true;
+    // The caps only change if the changed region touches the border of the volume
+    if ( this->private_->capping_enabled_ && ( min.x() == 0 || min.y() == 0 || min.z() == 0 ||
+      max.x() + 1 == static_cast< IndexVector::index_type >( this->private_->nx_ ) ||
+      max.y() + 1 == static_cast< IndexVector::index_type >( this->private_->ny_ ) ||
+      max.z() + 1 == static_cast< IndexVector::index_type >( this->private_->nz_ ) ) )
+    {
+      this->private_->compute_caps( this->private_->num_blocks_ );
+    }
 
-  if ( check_abort() )
+    this->private_->generation_ = generation;
+  }
+
+  // Only the parts that were computed again need to be decimated again
+  if ( !this->private_->update_lods() )
   {
     // leave it in a decent state
     this->private_->reset();
-    return;
+    return true;
   }
 
-  this->update_progress_signal_( 1.0 );
+  this->private_->area_ = 0;
+  for ( size_t i = 0; i < this->private_->parts_.size(); i++ )
+  {
+    this->private_->area_ += this->private_->parts_[ i ]->area_;
+  }
 
-  // Test code
-  // this->export_legacy_isosurface( "", "test_isosurface" );
+  this->private_->block_points_.clear();
+  this->private_->block_normals_.clear();
+  this->private_->block_faces_.clear();
+
+  this->private_->surface_changed_ = true;
+  return true;
+}
+
+double Isosurface::get_quality_factor() const
+{
+  lock_type lock( this->get_mutex() );
+  return this->private_->quality_factor_;
+}
+
+bool Isosurface::get_capping_enabled() const
+{
+  lock_type lock( this->get_mutex() );
+  return this->private_->capping_enabled_;
 }
 
 const PointFVector& Isosurface::get_points() const
 {
+  this->private_->assemble_mesh();
   return this->private_->points_;
 }
 
 const UIntVector& Isosurface::get_faces() const
 {
+  this->private_->assemble_mesh();
   return this->private_->faces_;
 }
 
 const VectorFVector& Isosurface::get_normals() const
 { 
+  this->private_->assemble_mesh();
   return this->private_->normals_;
 }
 
@@ -1964,15 +2401,63 @@ const FloatVector& Isosurface::get_values() const
 
 bool Isosurface::set_values( const FloatVector& values )
 {
+  this->private_->assemble_mesh();
   if( !( values.size() == this->private_->points_.size() || values.size() == 0 ) )
   {
     return false;
   }
   this->private_->values_ = values; 
   this->private_->values_changed_ = true;
+  for ( size_t level = 0; level < this->private_->lod_changed_.size(); level++ )
+  {
+    this->private_->lod_changed_[ level ].assign( 
+      this->private_->lod_changed_[ level ].size(), true );
+  }
   return true;
 }
 
+void Isosurface::set_triangle_budget( size_t triangle_budget )
+{
+  lock_type lock( this->get_mutex() );
+  this->private_->triangle_budget_ = triangle_budget;
+}
+
+size_t Isosurface::get_triangle_budget() const
+{
+  lock_type lock( this->get_mutex() );
+  return this->private_->triangle_budget_;
+}
+
+size_t Isosurface::get_num_lod_levels() const
+{
+  lock_type lock( this->get_mutex() );
+  return this->private_->num_lod_levels_ + 1;
+}
+
+size_t Isosurface::select_lod_level( size_t num_pixels ) const
+{
+  lock_type lock( this->get_mutex() );
+
+  // Use the most detailed level that does not have many more triangles than there are pixels to
+  // show them, as the extra triangles would not be visible anyway
+  size_t max_faces = num_pixels / 2;
+  size_t num_faces = this->private_->get_num_faces();
+  for ( size_t level = 0; level < this->private_->num_lod_levels_; level++ )
+  {
+    if ( num_faces <= max_faces )
+    {
+      return level;
+    }
+
+    num_faces = 0;
+    for ( size_t i = 0; i < this->private_->parts_.size(); i++ )
+    {
+      num_faces += this->private_->parts_[ i ]->lods_[ level ].faces_.size() / 3;
+    }
+  }
+  return this->private_->num_lod_levels_;
+}
+
 
 void Isosurface::set_color_map( ColorMapHandle color_map )
 {
@@ -1986,19 +2471,19 @@ Core::ColorMapHandle Isosurface::get_color_map() const
   return this->private_->color_map_;
 }
 
-void Isosurface::redraw( bool use_colormap )
+void Isosurface::redraw( bool use_colormap, size_t lod_level )
 {
   lock_type lock( this->get_mutex() );
 
   // Check for empty isosurface
-  if( this->private_->points_.size() == 0 ) 
+  if( this->private_->get_num_faces() == 0 ) 
   {
     return;
   }
   
-  this->private_->upload_to_vertex_buffer();
-  size_t num_batches = this->private_->part_points_.size();
-  bool has_values = this->private_->values_.size() == this->private_->points_.size();
+  lod_level = Min( lod_level, this->private_->num_lod_levels_ );
+  size_t num_batches = this->private_->parts_.size();
+  bool has_values = !this->private_->values_.empty();
   
   // Error checking
   if( use_colormap ) 
@@ -2013,26 +2498,28 @@ void Isosurface::redraw( bool use_colormap )
     }
   }
 
+  // The decimated levels of detail fit the triangle budget, so they are always rendered from
+  // vertex buffers
+  if ( lod_level > 0 )
+  {
+    this->private_->upload_lod_to_vertex_buffer( lod_level );
+    for ( size_t i = 0; i < num_batches; ++i )
+    {
+      this->private_->draw_batch( this->private_->lod_batches_[ lod_level - 1 ][ i ],
+        this->private_->parts_[ i ]->lods_[ lod_level - 1 ].faces_.size(), 
+        has_values && use_colormap );
+    }
+    return;
+  }
+
   // Use the uploaded VBO for rendering if it's available
+  this->private_->upload_to_vertex_buffer();
   if ( this->private_->vbo_available_ )
   {
     for ( size_t i = 0; i < num_batches; ++i )
     {
-      this->private_->vbo_batches_[ i ]->vertex_buffer_->enable_arrays();
-      this->private_->vbo_batches_[ i ]->normal_buffer_->enable_arrays();
-      if ( has_values && use_colormap )
-      {
-        this->private_->vbo_batches_[ i ]->value_buffer_->enable_arrays();
-      }
-      this->private_->vbo_batches_[ i ]->faces_buffer_->draw_elements( GL_TRIANGLES, 
-        static_cast< GLsizei >( ( this->private_->part_faces_[ i ].second - 
-        this->private_->part_faces_[ i ].first ) ), GL_UNSIGNED_INT );
-      this->private_->vbo_batches_[ i ]->vertex_buffer_->disable_arrays();
-      this->private_->vbo_batches_[ i ]->normal_buffer_->disable_arrays();
-      if ( has_values && use_colormap )
-      {
-        this->private_->vbo_batches_[ i ]->value_buffer_->disable_arrays();
-      }
+      this->private_->draw_batch( this->private_->vbo_batches_[ i ], 
+        this->private_->parts_[ i ]->faces_.size(), has_values && use_colormap );
     }
     return;
   }
@@ -2053,12 +2540,14 @@ void Isosurface::redraw( bool use_colormap )
   ElementArrayBufferHandle face_buffer( new ElementArrayBuffer );
   for ( size_t i = 0; i < num_batches; ++i )
   {
-    unsigned int num_pts = this->private_->part_points_[ i ].second - this->private_->part_points_[ i ].first;
+    const IsosurfacePart& part = *this->private_->parts_[ i ];
+    size_t num_pts = part.points_.size();
     ptrdiff_t vertex_size = num_pts * sizeof( PointF );
     ptrdiff_t normal_size = num_pts * sizeof( VectorF );
     ptrdiff_t value_size = has_values && use_colormap ? num_pts * sizeof( float ) : 0;
-    unsigned int num_face_indices = this->private_->part_faces_[ i ].second - this->private_->part_faces_[ i ].first;
+    size_t num_face_indices = part.faces_.size();
     ptrdiff_t face_size = num_face_indices * sizeof( unsigned int );
+    if ( num_face_indices == 0 ) continue;
     
     vertex_buffer->set_buffer_data( vertex_size, 0, GL_STREAM_DRAW );
     void* buffer = vertex_buffer->map_buffer( GL_WRITE_ONLY );
@@ -2068,7 +2557,7 @@ void Isosurface::redraw( bool use_colormap )
         " be incomplete!" );
       return;
     }
-    memcpy( buffer, &this->private_->points_[ this->private_->part_points_[ i ].first ], vertex_size );
+    memcpy( buffer, &part.points_[ 0 ], vertex_size );
     vertex_buffer->unmap_buffer();
     
     normal_buffer->set_buffer_data( normal_size, 0, GL_STREAM_DRAW );
@@ -2079,7 +2568,7 @@ void Isosurface::redraw( bool use_colormap )
         " be incomplete!" );
       return;
     }
-    memcpy( buffer, &this->private_->normals_[ this->private_->part_points_[ i ].first ], normal_size );
+    memcpy( buffer, &part.normals_[ 0 ], normal_size );
     normal_buffer->unmap_buffer();
     
     if ( has_values && use_colormap )
@@ -2092,7 +2581,11 @@ void Isosurface::redraw( bool use_colormap )
           " be incomplete!" );
         return;
       }
-      memcpy( buffer, &this->private_->values_[ this->private_->part_points_[ i ].first ], value_size );
+      float* values = reinterpret_cast< float* >( buffer );
+      for ( size_t j = 0; j < num_pts; j++ )
+      {
+        values[ j ] = this->private_->values_[ part.mesh_index_[ j ] ];
+      }
       value_buffer->unmap_buffer();
     }
 
@@ -2104,7 +2597,7 @@ void Isosurface::redraw( bool use_colormap )
         " be incomplete!" );
       return;
     }
-    memcpy( buffer, &this->private_->part_indices_[ i ][ 0 ], face_size );
+    memcpy( buffer, &part.faces_[ 0 ], face_size );
     face_buffer->unmap_buffer();
 
     vertex_buffer->enable_arrays();
@@ -2114,8 +2607,7 @@ void Isosurface::redraw( bool use_colormap )
       value_buffer->enable_arrays();
     }
     face_buffer->draw_elements( GL_TRIANGLES, 
-      static_cast< GLsizei >( ( this->private_->part_faces_[ i ].second - 
-      this->private_->part_faces_[ i ].first ) ), GL_UNSIGNED_INT );
+      static_cast< GLsizei >( num_face_indices ), GL_UNSIGNED_INT );
     vertex_buffer->disable_arrays();
     normal_buffer->disable_arrays();
     if ( has_values && use_colormap )
@@ -2126,9 +2618,22 @@ void Isosurface::redraw( bool use_colormap )
 }
 
 bool Isosurface::export_legacy_isosurface( const boost::filesystem::path& path,
-                                           const std::string& file_prefix )
+                                           const std::string& file_prefix,
+                                           size_t lod_level )
 {
   lock_type lock( this->get_mutex() );
+  if ( lod_level > this->private_->num_lod_levels_ ) return false;
+
+  if ( lod_level > 0 )
+  {
+    PointFVector points;
+    UIntVector faces;
+    FloatVector values;
+    this->private_->get_lod_mesh( lod_level, points, faces, values );
+    return IsosurfaceExporter::ExportLegacy( path, file_prefix, points, faces, values );
+  }
+
+  this->private_->assemble_mesh();
   bool result = IsosurfaceExporter::ExportLegacy( path, file_prefix,
                                                   this->private_->points_,
                                                   this->private_->faces_,
@@ -2138,9 +2643,22 @@ bool Isosurface::export_legacy_isosurface( const boost::filesystem::path& path,
 }
 
 
-bool Isosurface::export_vtk_isosurface( const boost::filesystem::path& filename )
+bool Isosurface::export_vtk_isosurface( const boost::filesystem::path& filename, 
+                                        size_t lod_level )
 {
   lock_type lock( this->get_mutex() );
+  if ( lod_level > this->private_->num_lod_levels_ ) return false;
+
+  if ( lod_level > 0 )
+  {
+    PointFVector points;
+    UIntVector faces;
+    FloatVector values;
+    this->private_->get_lod_mesh( lod_level, points, faces, values );
+    return IsosurfaceExporter::ExportVTKASCII( filename, points, faces );
+  }
+
+  this->private_->assemble_mesh();
   bool result = IsosurfaceExporter::ExportVTKASCII( filename,
                                                     this->private_->points_,
                                                     this->private_->faces_
@@ -2148,10 +2666,73 @@ bool Isosurface::export_vtk_isosurface( const boost::filesystem::path& filename
   return result;
 }
 
+bool Isosurface::export_vtk_binary_isosurface( const boost::filesystem::path& filename, 
+                                               bool compress,
+                                               size_t lod_level )
+{
+  lock_type lock( this->get_mutex() );
+  if ( lod_level > this->private_->num_lod_levels_ ) return false;
+
+  if ( lod_level > 0 )
+  {
+    PointFVector points;
+    UIntVector faces;
+    FloatVector values;
+    this->private_->get_lod_mesh( lod_level, points, faces, values );
+    return IsosurfaceExporter::ExportVTKBinary( filename, points, faces, compress );
+  }
+
+  this->private_->assemble_mesh();
+  bool result = IsosurfaceExporter::ExportVTKBinary( filename,
+                                                     this->private_->points_,
+                                                     this->private_->faces_,
+                                                     compress
+                                                   );
+  return result;
+}
+
+bool Isosurface::export_ply_binary_isosurface( const boost::filesystem::path& filename, 
+                                               bool compress,
+                                               size_t lod_level )
+{
+  lock_type lock( this->get_mutex() );
+  if ( lod_level > this->private_->num_lod_levels_ ) return false;
+
+  if ( lod_level > 0 )
+  {
+    PointFVector points;
+    UIntVector faces;
+    FloatVector values;
+    this->private_->get_lod_mesh( lod_level, points, faces, values );
+    return IsosurfaceExporter::ExportPLYBinary( filename, points, faces, compress );
+  }
+
+  this->private_->assemble_mesh();
+  bool result = IsosurfaceExporter::ExportPLYBinary( filename,
+                                                     this->private_->points_,
+                                                     this->private_->faces_,
+                                                     compress
+                                                   );
+  return result;
+}
+
 bool Isosurface::export_stl_ascii_isosurface( const boost::filesystem::path& filename,
-                                              const std::string& name )
+                                              const std::string& name,
+                                              size_t lod_level )
 {
   lock_type lock( this->get_mutex() );
+  if ( lod_level > this->private_->num_lod_levels_ ) return false;
+
+  if ( lod_level > 0 )
+  {
+    PointFVector points;
+    UIntVector faces;
+    FloatVector values;
+    this->private_->get_lod_mesh( lod_level, points, faces, values );
+    return IsosurfaceExporter::ExportSTLASCII( filename, name, points, faces );
+  }
+
+  this->private_->assemble_mesh();
   bool result = IsosurfaceExporter::ExportSTLASCII( filename, name,
                                                     this->private_->points_,
                                                     this->private_->faces_
@@ -2160,9 +2741,22 @@ bool Isosurface::export_stl_ascii_isosurface( const boost::filesystem::path& fil
 }
 
 bool Isosurface::export_stl_binary_isosurface( const boost::filesystem::path& filename,
-                                               const std::string& name )
+                                               const std::string& name,
+                                               size_t lod_level )
 {
   lock_type lock( this->get_mutex() );
+  if ( lod_level > this->private_->num_lod_levels_ ) return false;
+
+  if ( lod_level > 0 )
+  {
+    PointFVector points;
+    UIntVector faces;
+    FloatVector values;
+    this->private_->get_lod_mesh( lod_level, points, faces, values );
+    return IsosurfaceExporter::ExportSTLBinary( filename, name, points, faces );
+  }
+
+  this->private_->assemble_mesh();
   bool result = IsosurfaceExporter::ExportSTLBinary( filename, name,
                                                      this->private_->points_,
                                                      this->private_->faces_
@@ -74,8 +74,26 @@ public:
   /// Compute isosurface.  quality_factor must be one of: {0.125, 0.25, 0.5, 1.0} 
   void compute( double quality_factor, bool capping_enabled, boost::function< bool () > check_abort );
 
+  // UPDATE:
+  /// Bring the isosurface up to date after the mask changed.  The isosurface is computed in 
+  /// blocks of slices, and only the blocks near the voxels that changed since the last 
+  /// computation are computed again, after which only their vertex buffers are uploaded again.
+  /// Returns false if the isosurface cannot be updated in place, because the changed region is
+  /// not known or the isosurface was computed from a downsampled mask, in which case it needs
+  /// to be computed again.  Values set with set_values are cleared when the isosurface changes.
+  bool update( boost::function< bool () > check_abort );
+
+  // GET_QUALITY_FACTOR:
+  /// Get the quality factor of the last computation.
+  double get_quality_factor() const;
+
+  // GET_CAPPING_ENABLED:
+  /// Get whether the last computation included the caps.
+  bool get_capping_enabled() const;
+
   // GET_POINTS:
-  /// Get 3D points for vertices, each stored only once
+  /// Get 3D points for vertices, each stored only once.  Points of the caps are stored 
+  /// separately from the points of the rest of the isosurface.
   /// NOTE: This function is not thread-safe, make sure you have the mutex
   /// allocated before using this array (use get_mutex())
   const PointFVector& get_points() const;
@@ -109,6 +127,28 @@ public:
   /// allocated before using this array (use get_mutex())
   bool set_values( const FloatVector& values );
 
+  // SET_TRIANGLE_BUDGET:
+  /// Set the number of triangles the most decimated level of detail should have.  After the 
+  /// isosurface is computed, up to three decimated levels of detail are made, each with fewer
+  /// triangles than the one before, until the budget is met.  A budget of zero disables the
+  /// decimation.  The budget is used by the next call to compute or update, where update only
+  /// decimates the parts that changed while the isosurface exceeds the budget.
+  void set_triangle_budget( size_t triangle_budget );
+
+  // GET_TRIANGLE_BUDGET:
+  /// Get the number of triangles the most decimated level of detail should have.
+  size_t get_triangle_budget() const;
+
+  // GET_NUM_LOD_LEVELS:
+  /// Get the number of levels of detail, including the full resolution isosurface, which is
+  /// level 0.
+  size_t get_num_lod_levels() const;
+
+  // SELECT_LOD_LEVEL:
+  /// Pick the most detailed level of detail that is worth rendering into a view with the given 
+  /// number of pixels.
+  size_t select_lod_level( size_t num_pixels ) const;
+
   // SET_COLOR_MAP:
   /// Set mapping from vertex values to RGB colors.  
   /// NOTE: This function is not thread-safe. Passing handle since colormap is unlikely
@@ -121,8 +161,9 @@ public:
 
   // REDRAW:
   /// Render the isosurface.  This function doesn't work in isolation -- it must be called from the 
-  /// Seg3D Renderer. 
-  void redraw( bool use_colormap );
+  /// Seg3D Renderer.  Level 0 renders the full resolution isosurface, higher levels render
+  /// the decimated levels of detail.
+  void redraw( bool use_colormap, size_t lod_level = 0 );
 
   // EXPORT_LEGACY_ISOSURFACE:
   /// Write points to .pts file, faces to .fac file, and values (if assigned) to .val file.  
@@ -146,23 +187,42 @@ public:
   /// v2
   /// ...
   ///
+  /// The isosurface is written at the given level of detail, 0 being full resolution.
+  ///
   /// Note: can't call this function "export" because it is reserved by the Visual C++ compiler.
   bool export_legacy_isosurface( const boost::filesystem::path& path,
-                                 const std::string& file_prefix ); 
+                                 const std::string& file_prefix,
+                                 size_t lod_level = 0 ); 
 
   // EXPORT_VTK_ISOSURFACE:
   /// Writes out an isosurface in ASCII VTK mesh format
-  bool export_vtk_isosurface( const boost::filesystem::path& filename );
+  bool export_vtk_isosurface( const boost::filesystem::path& filename, 
+                              size_t lod_level = 0 );
+
+  // EXPORT_VTK_BINARY_ISOSURFACE:
+  /// Writes out an isosurface in binary VTK mesh format, gzip compressed if compress is set
+  bool export_vtk_binary_isosurface( const boost::filesystem::path& filename, 
+                                     bool compress,
+                                     size_t lod_level = 0 );
+
+  // EXPORT_PLY_BINARY_ISOSURFACE:
+  /// Writes out an isosurface in binary little endian PLY format, gzip compressed if compress 
+  /// is set
+  bool export_ply_binary_isosurface( const boost::filesystem::path& filename, 
+                                     bool compress,
+                                     size_t lod_level = 0 );
 
   // EXPORT_STL_ASCII_ISOSURFACE:
   /// Writes out an isosurface in ASCII STL file format
   bool export_stl_ascii_isosurface( const boost::filesystem::path& filename,
-                                    const std::string& name );
+                                    const std::string& name,
+                                    size_t lod_level = 0 );
 
   // EXPORT_STL_BINARY_ISOSURFACE:
   /// Writes out an isosurface in Binary STL file format
   bool export_stl_binary_isosurface( const boost::filesystem::path& filename,
-                                     const std::string& name );
+                                     const std::string& name,
+                                     size_t lod_level = 0 );
 
   typedef boost::signals2::signal< void (double) > update_progress_signal_type;
 
@@ -175,6 +235,9 @@ public:
   static const std::string EXPORT_FORMATS_C;
   static const FilterMap EXPORT_FORMATS_MAP_C;
 
+  /// Default number of triangles of the most decimated level of detail
+  static const size_t DEFAULT_TRIANGLE_BUDGET_C;
+
 private:
   IsosurfacePrivateHandle private_;
 };
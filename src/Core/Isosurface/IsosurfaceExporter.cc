@@ -28,11 +28,18 @@
 
 #include <Core/Isosurface/IsosurfaceExporter.h>
 #include <Core/Geometry/Point.h>
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/Utils/Parallel.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/shared_array.hpp>
 
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 #include <string>
 
 namespace Core
@@ -285,4 +292,490 @@ bool IsosurfaceExporter::ExportSTLBinary( const boost::filesystem::path& filenam
   return true;
 }
 
+// Binary PLY and VTK files are serialized into a single buffer of which the size is known up
+// front, so the points and faces can be converted by all threads at once.  Compressed files are
+// written as a series of gzip members that are deflated in parallel; gzip readers decompress
+// concatenated members as a single stream.
+class BinaryMeshSerializer : public boost::noncopyable
+{
+public:
+  BinaryMeshSerializer( const PointFVector& points, const UIntVector& faces, 
+    bool little_endian, bool vtk_cell_size ) :
+    points_( points ),
+    faces_( faces ),
+    swap_bytes_( little_endian != DataBlock::IsLittleEndian() ),
+    vtk_cell_size_( vtk_cell_size ),
+    points_offset_( 0 ),
+    faces_offset_( 0 ),
+    compress_failed_( false )
+  {
+  }
+
+  // SETUP:
+  // Allocate the buffer and copy the text sections into it.
+  bool setup( const std::string& header, const std::string& separator, 
+    const std::string& footer )
+  {
+    size_t num_faces = this->faces_.size() / 3;
+    this->points_offset_ = header.size();
+    this->faces_offset_ = this->points_offset_ + this->points_.size() * POINT_SIZE_C + 
+      separator.size();
+    size_t size = this->faces_offset_ + num_faces * this->face_size() + footer.size();
+
+    try
+    {
+      this->buffer_.resize( size );
+    }
+    catch ( ... )
+    {
+      return false;
+    }
+
+    std::memcpy( &this->buffer_[ 0 ], header.c_str(), header.size() );
+    if ( !separator.empty() )
+    {
+      std::memcpy( &this->buffer_[ this->faces_offset_ - separator.size() ], 
+        separator.c_str(), separator.size() );
+    }
+    if ( !footer.empty() )
+    {
+      std::memcpy( &this->buffer_[ size - footer.size() ], footer.c_str(), footer.size() );
+    }
+    return true;
+  }
+
+  // PARALLEL_SERIALIZE:
+  // Each thread converts its own range of points and faces.
+  void parallel_serialize( int thread, int num_threads, boost::barrier& barrier )
+  {
+    size_t num_points = this->points_.size();
+    size_t start = num_points * thread / num_threads;
+    size_t end = num_points * ( thread + 1 ) / num_threads;
+    char* dst = &this->buffer_[ this->points_offset_ + start * POINT_SIZE_C ];
+    for ( size_t i = start; i < end; i++, dst += POINT_SIZE_C )
+    {
+      this->put_word( dst, this->points_[ i ].x() );
+      this->put_word( dst + 4, this->points_[ i ].y() );
+      this->put_word( dst + 8, this->points_[ i ].z() );
+    }
+
+    size_t num_faces = this->faces_.size() / 3;
+    size_t face_size = this->face_size();
+    start = num_faces * thread / num_threads;
+    end = num_faces * ( thread + 1 ) / num_threads;
+    dst = &this->buffer_[ this->faces_offset_ + start * face_size ];
+    for ( size_t i = start; i < end; i++, dst += face_size )
+    {
+      // Both formats store the number of indices in front of each face
+      char* indices = dst;
+      if ( this->vtk_cell_size_ )
+      {
+        this->put_word( dst, static_cast< unsigned int >( 3 ) );
+        indices += 4;
+      }
+      else
+      {
+        *dst = 3;
+        indices += 1;
+      }
+      this->put_word( indices, this->faces_[ 3 * i ] );
+      this->put_word( indices + 4, this->faces_[ 3 * i + 1 ] );
+      this->put_word( indices + 8, this->faces_[ 3 * i + 2 ] );
+    }
+  }
+
+  // PARALLEL_COMPRESS:
+  // Deflate the chunks of the buffer into separate gzip members, chunks are divided 
+  // round robin over the threads.
+  void parallel_compress( int thread, int num_threads, boost::barrier& barrier )
+  {
+    if ( thread == 0 )
+    {
+      size_t num_chunks = ( this->buffer_.size() + COMPRESS_CHUNK_SIZE_C - 1 ) / 
+        COMPRESS_CHUNK_SIZE_C;
+      this->chunks_.resize( num_chunks );
+    }
+    barrier.wait();
+
+    for ( size_t chunk = thread; chunk < this->chunks_.size(); chunk += num_threads )
+    {
+      size_t start = chunk * COMPRESS_CHUNK_SIZE_C;
+      size_t size = std::min( size_t( COMPRESS_CHUNK_SIZE_C ), this->buffer_.size() - start );
+
+      z_stream stream;
+      std::memset( &stream, 0, sizeof( stream ) );
+      // A window size of 15 plus 16 selects the gzip wrapper
+      if ( deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, 
+        Z_DEFAULT_STRATEGY ) != Z_OK )
+      {
+        this->compress_failed_ = true;
+        continue;
+      }
+
+      std::vector< unsigned char >& compressed = this->chunks_[ chunk ];
+      compressed.resize( deflateBound( &stream, static_cast< uLong >( size ) ) );
+      stream.next_in = reinterpret_cast< Bytef* >( &this->buffer_[ start ] );
+      stream.avail_in = static_cast< uInt >( size );
+      stream.next_out = &compressed[ 0 ];
+      stream.avail_out = static_cast< uInt >( compressed.size() );
+      if ( deflate( &stream, Z_FINISH ) != Z_STREAM_END )
+      {
+        this->compress_failed_ = true;
+      }
+      compressed.resize( stream.total_out );
+      deflateEnd( &stream );
+    }
+  }
+
+  // WRITE:
+  // Write the buffer, compressed or as is, to file.
+  bool write( const boost::filesystem::path& filename, bool compress )
+  {
+    if ( compress )
+    {
+      Parallel parallel_compress( boost::bind( &BinaryMeshSerializer::parallel_compress, 
+        this, _1, _2, _3 ) );
+      parallel_compress.run();
+      if ( this->compress_failed_ ) return false;
+    }
+
+    std::ofstream file( filename.string().c_str(), std::ios::out | std::ios::binary );
+    if ( ! file.is_open() ) return false;
+
+    if ( compress )
+    {
+      for ( size_t i = 0; i < this->chunks_.size(); i++ )
+      {
+        file.write( reinterpret_cast< const char* >( &this->chunks_[ i ][ 0 ] ), 
+          this->chunks_[ i ].size() );
+      }
+    }
+    else
+    {
+      file.write( &this->buffer_[ 0 ], this->buffer_.size() );
+    }
+    file.close();
+
+    return !file.fail();
+  }
+
+  bool run( const boost::filesystem::path& filename, const std::string& header, 
+    const std::string& separator, const std::string& footer, bool compress )
+  {
+    if ( ! this->setup( header, separator, footer ) ) return false;
+
+    Parallel parallel_serialize( boost::bind( &BinaryMeshSerializer::parallel_serialize, 
+      this, _1, _2, _3 ) );
+    parallel_serialize.run();
+
+    return this->write( filename, compress );
+  }
+
+private:
+  size_t face_size() const
+  {
+    // PLY stores the number of indices as a byte, VTK as an integer
+    return ( this->vtk_cell_size_ ? 4 : 1 ) + 3 * sizeof( unsigned int );
+  }
+
+  template< class T >
+  void put_word( char* dst, T value ) const
+  {
+    std::memcpy( dst, &value, 4 );
+    if ( this->swap_bytes_ )
+    {
+      std::swap( dst[ 0 ], dst[ 3 ] );
+      std::swap( dst[ 1 ], dst[ 2 ] );
+    }
+  }
+
+  const static size_t POINT_SIZE_C = 3 * sizeof( float );
+  const static size_t COMPRESS_CHUNK_SIZE_C = 1 << 22;
+
+  const PointFVector& points_;
+  const UIntVector& faces_;
+  bool swap_bytes_;
+  bool vtk_cell_size_;
+
+  std::vector< char > buffer_;
+  size_t points_offset_;
+  size_t faces_offset_;
+
+  std::vector< std::vector< unsigned char > > chunks_;
+  bool compress_failed_;
+};
+
+// Binary PLY format (http://paulbourke.net/dataformats/ply/)
+bool IsosurfaceExporter::ExportPLYBinary( const boost::filesystem::path& filename,
+                                          const PointFVector& points,
+                                          const UIntVector& faces,
+                                          bool compress
+                                        )
+{
+  std::ostringstream header;
+  header << "ply\n";
+  header << "format binary_little_endian 1.0\n";
+  header << "comment Seg3D isosurface\n";
+  header << "element vertex " << points.size() << "\n";
+  header << "property float x\n";
+  header << "property float y\n";
+  header << "property float z\n";
+  header << "element face " << faces.size() / 3 << "\n";
+  header << "property list uchar uint vertex_indices\n";
+  header << "end_header\n";
+
+  BinaryMeshSerializer serializer( points, faces, true, false );
+  return serializer.run( filename, header.str(), "", "", compress );
+}
+
+// Legacy VTK file format (http://vtk.org/VTK/img/file-formats.pdf), binary data is big endian
+bool IsosurfaceExporter::ExportVTKBinary( const boost::filesystem::path& filename,
+                                          const PointFVector& points,
+                                          const UIntVector& faces,
+                                          bool compress
+                                        )
+{
+  size_t num_triangles = faces.size() / 3;
+
+  std::ostringstream header;
+  header << "# vtk DataFile Version 3.0\n";
+  header << "vtk output\n";
+  header << "BINARY\n";
+  header << "DATASET POLYDATA\n";
+  header << "POINTS " << points.size() << " float\n";
+
+  std::ostringstream separator;
+  separator << "\nPOLYGONS " << num_triangles << " " << num_triangles * 4 << "\n";
+
+  BinaryMeshSerializer serializer( points, faces, false, true );
+  return serializer.run( filename, header.str(), separator.str(), "\n", compress );
+}
+
+// Streamed binary STL: the triangle count in the header is filled in when the file is closed
+class STLBinaryStreamWriter : public IsosurfaceStreamWriter
+{
+public:
+  STLBinaryStreamWriter() : num_triangles_( 0 ) {}
+
+  bool open( const boost::filesystem::path& filename, const std::string& name, 
+    std::string& error )
+  {
+    this->stl_file_.open( filename.string().c_str(), std::ios::out | std::ios::binary );
+    if ( ! this->stl_file_.is_open() )
+    {
+      error = "Could not open file '" + filename.string() + "' for writing.";
+      return false;
+    }
+
+    char header[ STL_HEADER_LENGTH_C ];
+    std::memset( header, 0, STL_HEADER_LENGTH_C );
+    std::string text = "STL header: Seg3D isosurface " + name;
+    std::memcpy( header, text.c_str(), std::min( text.size(), size_t( STL_HEADER_LENGTH_C ) ) );
+    this->stl_file_.write( header, STL_HEADER_LENGTH_C );
+    this->stl_file_.write( reinterpret_cast< const char* >( &this->num_triangles_ ), 4 );
+    return true;
+  }
+
+  virtual bool write_piece( const PointFVector& points, const UIntVector& point_ids,
+    const UIntVector& faces, std::string& error )
+  {
+    // Normal, three vertices and the attribute byte count
+    const size_t TRIANGLE_SIZE_C = 12 * sizeof( float ) + 2;
+    size_t num_triangles = faces.size() / 3;
+    std::vector< char > buffer( num_triangles * TRIANGLE_SIZE_C, 0 );
+    for ( size_t i = 0; i < num_triangles; i++ )
+    {
+      const PointF& p1 = points[ faces[ 3 * i ] ];
+      const PointF& p2 = points[ faces[ 3 * i + 1 ] ];
+      const PointF& p3 = points[ faces[ 3 * i + 2 ] ];
+      boost::shared_array<float> normal = computeFaceNormal( p1, p2, p3 );
+      float values[ 12 ] = { normal[ 0 ], normal[ 1 ], normal[ 2 ], p1.x(), p1.y(), p1.z(),
+        p2.x(), p2.y(), p2.z(), p3.x(), p3.y(), p3.z() };
+      std::memcpy( &buffer[ i * TRIANGLE_SIZE_C ], values, sizeof( values ) );
+    }
+
+    if ( !buffer.empty() ) this->stl_file_.write( &buffer[ 0 ], buffer.size() );
+    this->num_triangles_ += static_cast< unsigned int >( num_triangles );
+    if ( ! this->stl_file_ )
+    {
+      error = "Could not write to STL file.";
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool close( std::string& error )
+  {
+    this->stl_file_.seekp( STL_HEADER_LENGTH_C );
+    this->stl_file_.write( reinterpret_cast< const char* >( &this->num_triangles_ ), 4 );
+    this->stl_file_.close();
+    if ( ! this->stl_file_ )
+    {
+      error = "Could not write to STL file.";
+      return false;
+    }
+    return true;
+  }
+
+private:
+  // 80 byte header, usually ignored
+  const static size_t STL_HEADER_LENGTH_C = 80;
+
+  std::ofstream stl_file_;
+  unsigned int num_triangles_;
+};
+
+// Streamed binary PLY: the header needs the number of points and faces, so both are written
+// to temporary files first, which are appended to the header when the file is closed.
+class PLYBinaryStreamWriter : public IsosurfaceStreamWriter
+{
+public:
+  PLYBinaryStreamWriter() : num_points_( 0 ), num_faces_( 0 ) {}
+
+  bool open( const boost::filesystem::path& filename, std::string& error )
+  {
+    this->filename_ = filename;
+    this->points_filename_ = filename.string() + ".points.tmp";
+    this->faces_filename_ = filename.string() + ".faces.tmp";
+    this->points_file_.open( this->points_filename_.string().c_str(), 
+      std::ios::out | std::ios::binary );
+    this->faces_file_.open( this->faces_filename_.string().c_str(), 
+      std::ios::out | std::ios::binary );
+    if ( ! this->points_file_.is_open() || ! this->faces_file_.is_open() )
+    {
+      error = "Could not open file '" + filename.string() + "' for writing.";
+      this->remove_temporary_files();
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool write_piece( const PointFVector& points, const UIntVector& point_ids,
+    const UIntVector& faces, std::string& error )
+  {
+    std::vector< float > point_buffer;
+    for ( size_t i = 0; i < points.size(); i++ )
+    {
+      if ( point_ids[ i ] != this->num_points_ ) continue;
+      point_buffer.push_back( points[ i ].x() );
+      point_buffer.push_back( points[ i ].y() );
+      point_buffer.push_back( points[ i ].z() );
+      this->num_points_++;
+    }
+
+    // Each face is a list with a one byte count followed by three indices
+    const size_t FACE_SIZE_C = 1 + 3 * sizeof( unsigned int );
+    size_t num_faces = faces.size() / 3;
+    std::vector< char > face_buffer( num_faces * FACE_SIZE_C );
+    for ( size_t i = 0; i < num_faces; i++ )
+    {
+      unsigned int indices[ 3 ] = { point_ids[ faces[ 3 * i ] ], 
+        point_ids[ faces[ 3 * i + 1 ] ], point_ids[ faces[ 3 * i + 2 ] ] };
+      face_buffer[ i * FACE_SIZE_C ] = 3;
+      std::memcpy( &face_buffer[ i * FACE_SIZE_C + 1 ], indices, sizeof( indices ) );
+    }
+
+    if ( !point_buffer.empty() ) 
+    {
+      this->points_file_.write( reinterpret_cast< const char* >( &point_buffer[ 0 ] ), 
+        point_buffer.size() * sizeof( float ) );
+    }
+    if ( !face_buffer.empty() ) this->faces_file_.write( &face_buffer[ 0 ], face_buffer.size() );
+    this->num_faces_ += num_faces;
+
+    if ( ! this->points_file_ || ! this->faces_file_ )
+    {
+      error = "Could not write to PLY file.";
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool close( std::string& error )
+  {
+    this->points_file_.close();
+    this->faces_file_.close();
+
+    std::ofstream ply_file( this->filename_.string().c_str(), std::ios::out | std::ios::binary );
+    if ( ! ply_file.is_open() )
+    {
+      error = "Could not open file '" + this->filename_.string() + "' for writing.";
+      this->remove_temporary_files();
+      return false;
+    }
+
+    ply_file << "ply\n";
+    ply_file << "format " << ( DataBlock::IsLittleEndian() ? "binary_little_endian" :
+      "binary_big_endian" ) << " 1.0\n";
+    ply_file << "comment Seg3D isosurface\n";
+    ply_file << "element vertex " << this->num_points_ << "\n";
+    ply_file << "property float x\n";
+    ply_file << "property float y\n";
+    ply_file << "property float z\n";
+    ply_file << "element face " << this->num_faces_ << "\n";
+    ply_file << "property list uchar uint vertex_indices\n";
+    ply_file << "end_header\n";
+
+    std::ifstream points_file( this->points_filename_.string().c_str(), 
+      std::ios::in | std::ios::binary );
+    std::ifstream faces_file( this->faces_filename_.string().c_str(), 
+      std::ios::in | std::ios::binary );
+    if ( this->num_points_ > 0 ) ply_file << points_file.rdbuf();
+    if ( this->num_faces_ > 0 ) ply_file << faces_file.rdbuf();
+    points_file.close();
+    faces_file.close();
+    ply_file.close();
+    this->remove_temporary_files();
+
+    if ( ! ply_file )
+    {
+      error = "Could not write to PLY file.";
+      return false;
+    }
+    return true;
+  }
+
+private:
+  void remove_temporary_files()
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove( this->points_filename_, ec );
+    boost::filesystem::remove( this->faces_filename_, ec );
+  }
+
+  boost::filesystem::path filename_;
+  boost::filesystem::path points_filename_;
+  boost::filesystem::path faces_filename_;
+  std::ofstream points_file_;
+  std::ofstream faces_file_;
+  unsigned int num_points_;
+  size_t num_faces_;
+};
+
+bool IsosurfaceExporter::OpenStream( const boost::filesystem::path& filename,
+                                     const std::string& name,
+                                     IsosurfaceStreamWriterHandle& writer,
+                                     std::string& error
+                                   )
+{
+  std::string extension = filename.extension().string();
+  if ( extension == ".stl" )
+  {
+    boost::shared_ptr< STLBinaryStreamWriter > stl_writer( new STLBinaryStreamWriter );
+    if ( ! stl_writer->open( filename, name, error ) ) return false;
+    writer = stl_writer;
+    return true;
+  }
+  else if ( extension == ".ply" )
+  {
+    boost::shared_ptr< PLYBinaryStreamWriter > ply_writer( new PLYBinaryStreamWriter );
+    if ( ! ply_writer->open( filename, error ) ) return false;
+    writer = ply_writer;
+    return true;
+  }
+
+  error = "Streamed isosurfaces can only be written to binary STL (.stl) or PLY (.ply) files.";
+  return false;
+}
+
 }
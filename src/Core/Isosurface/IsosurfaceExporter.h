@@ -29,14 +29,49 @@
 #ifndef CORE_ISOSURFACE_ISOSURFACEEXPORTER_H
 #define CORE_ISOSURFACE_ISOSURFACEEXPORTER_H
 
+#include <boost/utility.hpp>
+
 #include <Core/Isosurface/Isosurface.h>
 
 namespace Core
 {
 
+class IsosurfaceStreamWriter;
+typedef boost::shared_ptr< IsosurfaceStreamWriter > IsosurfaceStreamWriterHandle;
+
+// ISOSURFACESTREAMWRITER:
+/// Writes a mesh to file piece by piece, so the whole mesh never needs to be in memory.
+class IsosurfaceStreamWriter : public boost::noncopyable
+{
+public:
+  virtual ~IsosurfaceStreamWriter() {}
+
+  // WRITE_PIECE:
+  /// Append a piece of the mesh.  faces holds 3 indices into points per triangle, and point_ids
+  /// holds the index of each point in the whole mesh.  A point whose id equals the number of
+  /// points written so far is new and is appended to the mesh, other points were written with
+  /// an earlier piece.
+  virtual bool write_piece( const PointFVector& points, const UIntVector& point_ids,
+    const UIntVector& faces, std::string& error ) = 0;
+
+  // CLOSE:
+  /// Finish the file.
+  virtual bool close( std::string& error ) = 0;
+};
+
 class IsosurfaceExporter
 {
   friend class Isosurface;
+  friend class LargeVolumeIsosurface;
+
+  // OPENSTREAM:
+  /// Open a file for writing a mesh piece by piece, the format is picked by the extension:
+  /// binary STL for .stl and binary PLY for .ply.
+  static bool OpenStream( const boost::filesystem::path& filename,
+                          const std::string& name,
+                          IsosurfaceStreamWriterHandle& writer,
+                          std::string& error
+                        );
 
   static bool ExportLegacy( const boost::filesystem::path& path,
                             const std::string& file_prefix,
@@ -50,6 +85,22 @@ class IsosurfaceExporter
                               const UIntVector& faces
                             );
 
+  // EXPORTVTKBINARY:
+  /// Write a binary legacy VTK file, optionally gzip compressed.
+  static bool ExportVTKBinary( const boost::filesystem::path& filename,
+                               const PointFVector& points,
+                               const UIntVector& faces,
+                               bool compress
+                             );
+
+  // EXPORTPLYBINARY:
+  /// Write a binary little endian PLY file, optionally gzip compressed.
+  static bool ExportPLYBinary( const boost::filesystem::path& filename,
+                               const PointFVector& points,
+                               const UIntVector& faces,
+                               bool compress
+                             );
+
   static bool ExportSTLASCII( const boost::filesystem::path& filename,
                               const std::string& name,
                               const PointFVector& points,
@@ -0,0 +1,536 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+// STL includes
+#include <algorithm>
+#include <limits>
+#include <map>
+
+// Boost includes
+#include <boost/unordered_map.hpp>
+
+// Core includes
+#include <Core/Isosurface/IsosurfaceExporter.h>
+#include <Core/Isosurface/LargeVolumeIsosurface.h>
+#include <Core/Isosurface/MarchingCubesTable.h>
+#include <Core/Utils/StringUtil.h>
+
+namespace Core
+{
+
+// Corner of the cube from which each of the 12 cube edges starts, and the axis it runs along
+const int EDGE_OFFSET_C[ 12 ][ 3 ] = { 
+  { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 0 }, 
+  { 0, 0, 1 }, { 1, 0, 1 }, { 0, 1, 1 }, { 0, 0, 1 },
+  { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 } };
+const int EDGE_AXIS_C[ 12 ] = { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 };
+
+// Offsets of the 8 corners of a cube in the order of the marching cubes table
+const int CORNER_OFFSET_C[ 8 ][ 3 ] = { 
+  { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 }, 
+  { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } };
+
+class LargeVolumeIsosurfacePrivate
+{
+public:
+  typedef IndexVector::index_type index_type;
+  typedef unsigned long long edge_type;
+
+  // GET_BRICK:
+  // Read a brick of the current level, recently read bricks are kept around because with a 
+  // brick overlap of zero the next brick is needed to finish the current one.
+  bool get_brick( index_type index, DataBlockHandle& brick, std::string& error );
+
+  // READ_REGION:
+  // Classify the voxels of a region of the current level as inside or outside.
+  bool read_region( const IndexVector& brick_index, std::string& error );
+
+  // COPY_BRICK:
+  // Copy part of a brick into the region, start and end are in level coordinates.
+  template< class T >
+  void copy_brick( const DataBlockHandle& brick, const IndexVector& brick_start, 
+    const IndexVector& start, const IndexVector& end );
+
+  // GET_BRICK_OF_CUBE:
+  index_type get_brick_of_cube( index_type x, index_type y, index_type z ) const;
+
+  // GET_POINT:
+  // Get the index in the current piece of the point on an edge of a cube, creating the point if
+  // this is the first cube that uses it.
+  unsigned int get_point( const IndexVector& cube, int edge, index_type brick );
+
+  // EXTRACT_BRICK:
+  // Extract the triangles of the cubes owned by a brick and write them to file.
+  bool extract_brick( index_type brick, std::string& error );
+
+  LargeVolumeSchemaHandle schema_;
+
+  // Inside test
+  bool use_mask_;
+  double min_value_;
+  double max_value_;
+  unsigned int mask_bits_;
+
+  // Level that is extracted and its layout
+  size_t level_;
+  IndexVector level_size_;
+  IndexVector layout_;
+  IndexVector effective_brick_size_;
+  IndexVector overlap_;
+  GridTransform transform_;
+
+  // Voxels needed for the cubes of the current brick, the brick itself plus one voxel
+  IndexVector region_start_;
+  IndexVector region_size_;
+  std::vector< unsigned char > inside_;
+  std::vector< float > values_;
+
+  // Recently read bricks
+  std::vector< std::pair< index_type, DataBlockHandle > > brick_cache_;
+
+  // Points on edges that are shared with bricks that have not been extracted yet, and the 
+  // edges that can be released after each brick.
+  boost::unordered_map< edge_type, unsigned int > seam_points_;
+  std::map< index_type, std::vector< edge_type > > seam_release_;
+  unsigned int num_points_;
+
+  // Geometry of the current brick
+  boost::unordered_map< edge_type, unsigned int > piece_edges_;
+  PointFVector piece_points_;
+  UIntVector piece_point_ids_;
+  UIntVector piece_faces_;
+
+  IsosurfaceStreamWriterHandle writer_;
+
+  // Number of bricks kept in brick_cache_
+  const static size_t BRICK_CACHE_SIZE_C;
+};
+
+const size_t LargeVolumeIsosurfacePrivate::BRICK_CACHE_SIZE_C = 4;
+
+bool LargeVolumeIsosurfacePrivate::get_brick( index_type index, DataBlockHandle& brick, 
+  std::string& error )
+{
+  for ( size_t j = 0; j < this->brick_cache_.size(); j++ )
+  {
+    if ( this->brick_cache_[ j ].first == index )
+    {
+      brick = this->brick_cache_[ j ].second;
+      return true;
+    }
+  }
+
+  if ( !this->schema_->read_brick( brick, BrickInfo( index, this->level_ ), error ) )
+  {
+    return false;
+  }
+
+  if ( this->brick_cache_.size() == BRICK_CACHE_SIZE_C )
+  {
+    this->brick_cache_.erase( this->brick_cache_.begin() );
+  }
+  this->brick_cache_.push_back( std::make_pair( index, brick ) );
+  return true;
+}
+
+template< class T >
+void LargeVolumeIsosurfacePrivate::copy_brick( const DataBlockHandle& brick, 
+  const IndexVector& brick_start, const IndexVector& start, const IndexVector& end )
+{
+  const T* data = reinterpret_cast< const T* >( brick->get_data() );
+  const index_type bnx = static_cast< index_type >( brick->get_nx() );
+  const index_type bny = static_cast< index_type >( brick->get_ny() );
+  const index_type rnx = this->region_size_.x();
+  const index_type rny = this->region_size_.y();
+  const bool keep_values = !this->use_mask_;
+
+  for ( index_type z = start.z(); z < end.z(); z++ )
+  {
+    for ( index_type y = start.y(); y < end.y(); y++ )
+    {
+      const T* src = data + ( ( z - brick_start.z() ) * bny + ( y - brick_start.y() ) ) * bnx - 
+        brick_start.x();
+      size_t dst = static_cast< size_t >( ( ( z - this->region_start_.z() ) * rny + 
+        ( y - this->region_start_.y() ) ) * rnx - this->region_start_.x() );
+      for ( index_type x = start.x(); x < end.x(); x++ )
+      {
+        if ( this->use_mask_ )
+        {
+          this->inside_[ dst + x ] = ( static_cast< unsigned int >( src[ x ] ) & 
+            this->mask_bits_ ) != 0;
+        }
+        else
+        {
+          double value = static_cast< double >( src[ x ] );
+          this->inside_[ dst + x ] = value >= this->min_value_ && value <= this->max_value_;
+        }
+        if ( keep_values ) this->values_[ dst + x ] = static_cast< float >( src[ x ] );
+      }
+    }
+  }
+}
+
+bool LargeVolumeIsosurfacePrivate::read_region( const IndexVector& brick_index, 
+  std::string& error )
+{
+  size_t num_voxels = static_cast< size_t >( this->region_size_.x() * this->region_size_.y() *
+    this->region_size_.z() );
+  this->inside_.assign( num_voxels, 0 );
+  if ( !this->use_mask_ ) this->values_.assign( num_voxels, 0.0f );
+
+  IndexVector region_end = this->region_start_ + this->region_size_;
+
+  // The brick stores its own voxels plus an overlap on either side.  The voxels of the region 
+  // that are beyond that come from the neighboring bricks.
+  IndexVector brick_start, brick_end;
+  for ( int a = 0; a < 3; a++ )
+  {
+    brick_start[ a ] = brick_index[ a ] * this->effective_brick_size_[ a ] - this->overlap_[ a ];
+    brick_end[ a ] = Min( ( brick_index[ a ] + 1 ) * this->effective_brick_size_[ a ] + 
+      this->overlap_[ a ], this->level_size_[ a ] );
+  }
+
+  for ( int d = 0; d < 8; d++ )
+  {
+    IndexVector neighbor, start, end;
+    bool needed = true;
+    for ( int a = 0; a < 3; a++ )
+    {
+      bool next = ( ( d >> a ) & 1 ) != 0;
+      neighbor[ a ] = brick_index[ a ] + ( next ? 1 : 0 );
+      start[ a ] = next ? brick_end[ a ] : this->region_start_[ a ];
+      end[ a ] = next ? region_end[ a ] : Min( region_end[ a ], brick_end[ a ] );
+      if ( start[ a ] >= end[ a ] || neighbor[ a ] >= this->layout_[ a ] ) needed = false;
+    }
+    if ( !needed ) continue;
+
+    index_type index = ( neighbor.z() * this->layout_.y() + neighbor.y() ) * 
+      this->layout_.x() + neighbor.x();
+    DataBlockHandle brick;
+    if ( !this->get_brick( index, brick, error ) )
+    {
+      return false;
+    }
+
+    IndexVector data_start;
+    for ( int a = 0; a < 3; a++ )
+    {
+      data_start[ a ] = neighbor[ a ] * this->effective_brick_size_[ a ] - this->overlap_[ a ];
+    }
+
+    switch ( brick->get_data_type() )
+    {
+    case DataType::UCHAR_E:
+      this->copy_brick< unsigned char >( brick, data_start, start, end ); break;
+    case DataType::CHAR_E:
+      this->copy_brick< signed char >( brick, data_start, start, end ); break;
+    case DataType::USHORT_E:
+      this->copy_brick< unsigned short >( brick, data_start, start, end ); break;
+    case DataType::SHORT_E:
+      this->copy_brick< short >( brick, data_start, start, end ); break;
+    case DataType::UINT_E:
+      this->copy_brick< unsigned int >( brick, data_start, start, end ); break;
+    case DataType::INT_E:
+      this->copy_brick< int >( brick, data_start, start, end ); break;
+    case DataType::FLOAT_E:
+      this->copy_brick< float >( brick, data_start, start, end ); break;
+    case DataType::DOUBLE_E:
+      this->copy_brick< double >( brick, data_start, start, end ); break;
+    default:
+      error = "Unsupported data type.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+LargeVolumeIsosurfacePrivate::index_type LargeVolumeIsosurfacePrivate::get_brick_of_cube( 
+  index_type x, index_type y, index_type z ) const
+{
+  return ( ( z / this->effective_brick_size_.z() ) * this->layout_.y() + 
+    y / this->effective_brick_size_.y() ) * this->layout_.x() + 
+    x / this->effective_brick_size_.x();
+}
+
+unsigned int LargeVolumeIsosurfacePrivate::get_point( const IndexVector& cube, int edge, 
+  index_type brick )
+{
+  IndexVector start( cube.x() + EDGE_OFFSET_C[ edge ][ 0 ], cube.y() + EDGE_OFFSET_C[ edge ][ 1 ],
+    cube.z() + EDGE_OFFSET_C[ edge ][ 2 ] );
+  int axis = EDGE_AXIS_C[ edge ];
+  edge_type edge_id = ( ( static_cast< edge_type >( start.z() ) * this->level_size_.y() + 
+    start.y() ) * this->level_size_.x() + start.x() ) * 3 + axis;
+
+  boost::unordered_map< edge_type, unsigned int >::iterator it = 
+    this->piece_edges_.find( edge_id );
+  if ( it != this->piece_edges_.end() )
+  {
+    return it->second;
+  }
+
+  unsigned int local_index = static_cast< unsigned int >( this->piece_points_.size() );
+  this->piece_edges_[ edge_id ] = local_index;
+
+  // Points on the seam with an earlier brick keep the index they were given there.  Their 
+  // position is computed again from the same voxels, so it comes out exactly the same.
+  boost::unordered_map< edge_type, unsigned int >::iterator seam_it = 
+    this->seam_points_.find( edge_id );
+  bool new_point = seam_it == this->seam_points_.end();
+  this->piece_point_ids_.push_back( new_point ? this->num_points_ : seam_it->second );
+
+  // Where along the edge the surface crosses it
+  float t = 0.5f;
+  if ( !this->use_mask_ )
+  {
+    IndexVector local = start - this->region_start_;
+    size_t index0 = static_cast< size_t >( ( local.z() * this->region_size_.y() + local.y() ) * 
+      this->region_size_.x() + local.x() );
+    size_t index1 = index0 + ( axis == 0 ? 1 : ( axis == 1 ? this->region_size_.x() : 
+      this->region_size_.x() * this->region_size_.y() ) );
+    double value0 = this->values_[ index0 ];
+    double value1 = this->values_[ index1 ];
+    double outside = this->inside_[ index0 ] ? value1 : value0;
+    double bound = outside < this->min_value_ ? this->min_value_ : this->max_value_;
+    if ( value1 != value0 )
+    {
+      t = static_cast< float >( Max( 0.0, Min( 1.0, ( bound - value0 ) / 
+        ( value1 - value0 ) ) ) );
+    }
+  }
+
+  PointF point( static_cast< float >( start.x() ), static_cast< float >( start.y() ), 
+    static_cast< float >( start.z() ) );
+  point[ axis ] += t;
+  this->piece_points_.push_back( this->transform_.project( point ) );
+
+  if ( new_point )
+  {
+    // Find the last brick with a cube that uses this edge, cubes lie on either side of the edge
+    // in the directions other than the axis of the edge
+    index_type last[ 3 ];
+    for ( int a = 0; a < 3; a++ )
+    {
+      last[ a ] = a == axis ? start[ a ] : Min( start[ a ], this->level_size_[ a ] - 2 );
+    }
+    index_type last_brick = this->get_brick_of_cube( last[ 0 ], last[ 1 ], last[ 2 ] );
+    if ( last_brick > brick )
+    {
+      this->seam_points_[ edge_id ] = this->num_points_;
+      this->seam_release_[ last_brick ].push_back( edge_id );
+    }
+    this->num_points_++;
+  }
+
+  return local_index;
+}
+
+bool LargeVolumeIsosurfacePrivate::extract_brick( index_type brick, std::string& error )
+{
+  IndexVector brick_index( brick % this->layout_.x(), 
+    ( brick / this->layout_.x() ) % this->layout_.y(), 
+    brick / ( this->layout_.x() * this->layout_.y() ) );
+
+  // The brick owns the cubes that start inside it
+  IndexVector cube_start, cube_end;
+  for ( int a = 0; a < 3; a++ )
+  {
+    cube_start[ a ] = brick_index[ a ] * this->effective_brick_size_[ a ];
+    cube_end[ a ] = Min( cube_start[ a ] + this->effective_brick_size_[ a ], 
+      this->level_size_[ a ] - 1 );
+    if ( cube_end[ a ] <= cube_start[ a ] ) return true;
+  }
+
+  this->region_start_ = cube_start;
+  this->region_size_ = cube_end - cube_start + IndexVector( 1, 1, 1 );
+  if ( !this->read_region( brick_index, error ) )
+  {
+    return false;
+  }
+
+  this->piece_edges_.clear();
+  this->piece_points_.clear();
+  this->piece_point_ids_.clear();
+  this->piece_faces_.clear();
+
+  const index_type rnx = this->region_size_.x();
+  const index_type rnxy = this->region_size_.x() * this->region_size_.y();
+  index_type corner_offset[ 8 ];
+  for ( int c = 0; c < 8; c++ )
+  {
+    corner_offset[ c ] = CORNER_OFFSET_C[ c ][ 2 ] * rnxy + CORNER_OFFSET_C[ c ][ 1 ] * rnx + 
+      CORNER_OFFSET_C[ c ][ 0 ];
+  }
+
+  for ( index_type z = 0; z < this->region_size_.z() - 1; z++ )
+  {
+    for ( index_type y = 0; y < this->region_size_.y() - 1; y++ )
+    {
+      const unsigned char* inside = &this->inside_[ static_cast< size_t >( z * rnxy + y * rnx ) ];
+      for ( index_type x = 0; x < this->region_size_.x() - 1; x++ )
+      {
+        unsigned char type = 0;
+        for ( int c = 0; c < 8; c++ )
+        {
+          if ( inside[ x + corner_offset[ c ] ] ) type |= ( 1 << c );
+        }
+        if ( type == 0 || type == 0xFF ) continue;
+
+        IndexVector cube( cube_start.x() + x, cube_start.y() + y, cube_start.z() + z );
+        const MarchingCubesTableType& table = MARCHING_CUBES_TABLE_C[ type ];
+        for ( int k = 0; k < 3 * table.num_triangles_; k++ )
+        {
+          this->piece_faces_.push_back( this->get_point( cube, table.edges_[ k ], brick ) );
+        }
+      }
+    }
+  }
+
+  if ( !this->writer_->write_piece( this->piece_points_, this->piece_point_ids_, 
+    this->piece_faces_, error ) )
+  {
+    return false;
+  }
+
+  // Points on edges that no later brick uses are no longer needed
+  std::map< index_type, std::vector< edge_type > >::iterator it = 
+    this->seam_release_.find( brick );
+  if ( it != this->seam_release_.end() )
+  {
+    for ( size_t j = 0; j < it->second.size(); j++ )
+    {
+      this->seam_points_.erase( it->second[ j ] );
+    }
+    this->seam_release_.erase( it );
+  }
+
+  return true;
+}
+
+LargeVolumeIsosurface::LargeVolumeIsosurface( const LargeVolumeSchemaHandle& schema ) :
+  private_( new LargeVolumeIsosurfacePrivate )
+{
+  this->private_->schema_ = schema;
+  this->private_->use_mask_ = false;
+  this->private_->min_value_ = std::numeric_limits< double >::min();
+  this->private_->max_value_ = std::numeric_limits< double >::max();
+  this->private_->mask_bits_ = 0;
+  this->private_->level_ = 0;
+  this->private_->overlap_ = IndexVector( 0, 0, 0 );
+  this->private_->num_points_ = 0;
+}
+
+void LargeVolumeIsosurface::set_threshold( double min_value, double max_value )
+{
+  this->private_->use_mask_ = false;
+  this->private_->min_value_ = min_value;
+  this->private_->max_value_ = max_value;
+}
+
+void LargeVolumeIsosurface::set_mask( unsigned int mask_bits )
+{
+  this->private_->use_mask_ = true;
+  this->private_->mask_bits_ = mask_bits;
+}
+
+void LargeVolumeIsosurface::set_level( size_t level )
+{
+  this->private_->level_ = level;
+}
+
+bool LargeVolumeIsosurface::export_isosurface( const boost::filesystem::path& filename, 
+  const std::string& name, boost::function< bool () > check_abort, std::string& error )
+{
+  LargeVolumeIsosurfacePrivate* p = this->private_.get();
+  if ( p->level_ >= p->schema_->get_num_levels() )
+  {
+    error = "The large volume does not have level " + ExportToString( p->level_ ) + ".";
+    return false;
+  }
+
+  p->level_size_ = p->schema_->get_level_size( p->level_ );
+  p->layout_ = p->schema_->get_level_layout( p->level_ );
+  p->effective_brick_size_ = p->schema_->get_effective_brick_size();
+  p->overlap_ = p->schema_->get_brick_overlap();
+  Vector spacing = p->schema_->get_level_spacing( p->level_ );
+  p->transform_ = GridTransform( p->level_size_.x(), p->level_size_.y(), p->level_size_.z(), 
+    p->schema_->get_origin(), spacing.x() * GridTransform::X_AXIS, 
+    spacing.y() * GridTransform::Y_AXIS, spacing.z() * GridTransform::Z_AXIS );
+
+  if ( !IsosurfaceExporter::OpenStream( filename, name, p->writer_, error ) )
+  {
+    return false;
+  }
+
+  p->num_points_ = 0;
+  p->seam_points_.clear();
+  p->seam_release_.clear();
+  p->brick_cache_.clear();
+
+  // Bricks are processed in order of their index, so the points a brick shares with the bricks
+  // before it have already been created
+  size_t num_bricks = static_cast< size_t >( p->layout_.x() * p->layout_.y() * p->layout_.z() );
+  bool success = true;
+  for ( size_t brick = 0; brick < num_bricks && success; brick++ )
+  {
+    if ( check_abort && check_abort() )
+    {
+      error = "Isosurface extraction was aborted.";
+      success = false;
+      break;
+    }
+
+    success = p->extract_brick( static_cast< LargeVolumeIsosurfacePrivate::index_type >( brick ),
+      error );
+    this->update_progress_signal_( static_cast< double >( brick + 1 ) / 
+      static_cast< double >( num_bricks ) );
+  }
+
+  std::string close_error;
+  if ( !p->writer_->close( close_error ) && success )
+  {
+    error = close_error;
+    success = false;
+  }
+
+  p->writer_.reset();
+  p->seam_points_.clear();
+  p->seam_release_.clear();
+  p->brick_cache_.clear();
+  p->inside_.clear();
+  p->values_.clear();
+
+  if ( !success )
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove( filename, ec );
+  }
+  return success;
+}
+
+} // end namespace Core
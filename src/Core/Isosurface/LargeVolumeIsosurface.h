@@ -0,0 +1,96 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef CORE_ISOSURFACE_LARGEVOLUMEISOSURFACE_H
+#define CORE_ISOSURFACE_LARGEVOLUMEISOSURFACE_H
+
+// Boost includes
+#include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/signals2/signal.hpp>
+#include <boost/utility.hpp>
+
+// Core includes
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+
+namespace Core
+{
+
+// Hide header includes, private interface and implementation
+class LargeVolumeIsosurfacePrivate;
+typedef boost::shared_ptr< LargeVolumeIsosurfacePrivate > LargeVolumeIsosurfacePrivateHandle;
+
+// LARGEVOLUMEISOSURFACE:
+/// Extracts an isosurface from a large volume one brick at a time and writes the triangles of
+/// each brick straight to file, so only a few bricks and the points on the seams between bricks
+/// need to be in memory.  Every brick owns the cubes whose first corner lies inside it, and the
+/// points on the seams are shared with the neighboring bricks, so the mesh has no cracks or 
+/// duplicate points at brick boundaries.
+class LargeVolumeIsosurface : public boost::noncopyable
+{
+public:
+  LargeVolumeIsosurface( const LargeVolumeSchemaHandle& schema );
+
+  // SET_THRESHOLD:
+  /// Voxels with a value between min_value and max_value are inside the isosurface.  The
+  /// points are interpolated to where the data crosses the threshold.  This is the default, 
+  /// with a range that includes all values above zero.
+  void set_threshold( double min_value, double max_value );
+
+  // SET_MASK:
+  /// Voxels of which the integer value has any of the bits of mask_bits set are inside the 
+  /// isosurface, for large volumes that hold masks or labels.  The points are placed halfway 
+  /// along the cube edges, as for mask isosurfaces.
+  void set_mask( unsigned int mask_bits );
+
+  // SET_LEVEL:
+  /// Extract the isosurface from the bricks of a downsampled level instead of the full
+  /// resolution bricks of level 0.
+  void set_level( size_t level );
+
+  // EXPORT_ISOSURFACE:
+  /// Extract the isosurface and write it to a binary STL (.stl) or binary PLY (.ply) file.  
+  /// Returns false and sets error if a brick cannot be read, the file cannot be written, or 
+  /// the extraction was aborted.
+  bool export_isosurface( const boost::filesystem::path& filename, const std::string& name,
+    boost::function< bool () > check_abort, std::string& error );
+
+  typedef boost::signals2::signal< void (double) > update_progress_signal_type;
+
+  // UPDATE_PROGRESS:
+  /// Progress between 0.0 and 1.0, triggered after each brick.
+  update_progress_signal_type update_progress_signal_;
+
+private:
+  LargeVolumeIsosurfacePrivateHandle private_;
+};
+
+} // end namespace Core
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef CORE_ISOSURFACE_MARCHINGCUBESTABLE_H
+#define CORE_ISOSURFACE_MARCHINGCUBESTABLE_H
+
+namespace Core
+{
+
+// Marching Cubes tutorial: http://local.wasp.uwa.edu.au/~pbourke/geometry/polygonise/
+
+typedef struct {
+  int edges_[15]; // Vertex indices for at most 5 triangles
+  int num_triangles_; // Last number in each table entry
+} MarchingCubesTableType;
+
+// Precalculated array of 256 possible polygon configurations (2^8 = 256) within the cube.
+// Bits 0-3 of the index are the corners (x,y), (x+1,y), (x+1,y+1), (x,y+1) of the back slice
+// and bits 4-7 the same corners of the front slice.  Edges 0-3 connect corners 0-1, 1-2, 3-2 and
+// 0-3 of the back slice, edges 4-7 the same corners of the front slice, and edges 8-11 connect
+// corners 0, 1, 3 and 2 of the back slice with the corners in front of them.
+extern const MarchingCubesTableType MARCHING_CUBES_TABLE_C[];
+
+} // end namespace Core
+
+#endif
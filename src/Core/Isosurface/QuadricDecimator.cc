@@ -0,0 +1,443 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+// Core includes
+#include <Core/Isosurface/QuadricDecimator.h>
+
+namespace Core
+{
+
+namespace
+{
+
+// Symmetric 4x4 matrix that measures the squared distance of a point to a set of planes
+class Quadric
+{
+public:
+  Quadric()
+  {
+    std::fill( this->a_, this->a_ + 10, 0.0 );
+  }
+
+  void add_plane( double nx, double ny, double nz, double d, double weight )
+  {
+    this->a_[ 0 ] += weight * nx * nx;
+    this->a_[ 1 ] += weight * nx * ny;
+    this->a_[ 2 ] += weight * nx * nz;
+    this->a_[ 3 ] += weight * nx * d;
+    this->a_[ 4 ] += weight * ny * ny;
+    this->a_[ 5 ] += weight * ny * nz;
+    this->a_[ 6 ] += weight * ny * d;
+    this->a_[ 7 ] += weight * nz * nz;
+    this->a_[ 8 ] += weight * nz * d;
+    this->a_[ 9 ] += weight * d * d;
+  }
+
+  Quadric& operator+=( const Quadric& q )
+  {
+    for ( int j = 0; j < 10; j++ ) this->a_[ j ] += q.a_[ j ];
+    return *this;
+  }
+
+  double error( double x, double y, double z ) const
+  {
+    const double* a = this->a_;
+    return a[ 0 ] * x * x + 2.0 * a[ 1 ] * x * y + 2.0 * a[ 2 ] * x * z + 2.0 * a[ 3 ] * x +
+      a[ 4 ] * y * y + 2.0 * a[ 5 ] * y * z + 2.0 * a[ 6 ] * y + 
+      a[ 7 ] * z * z + 2.0 * a[ 8 ] * z + a[ 9 ];
+  }
+
+  // Find the point with the smallest error, returns false if it is not well defined
+  bool minimum( double& x, double& y, double& z ) const
+  {
+    const double* a = this->a_;
+    double det = a[ 0 ] * ( a[ 4 ] * a[ 7 ] - a[ 5 ] * a[ 5 ] ) - 
+      a[ 1 ] * ( a[ 1 ] * a[ 7 ] - a[ 5 ] * a[ 2 ] ) + 
+      a[ 2 ] * ( a[ 1 ] * a[ 5 ] - a[ 4 ] * a[ 2 ] );
+    double scale = a[ 0 ] + a[ 4 ] + a[ 7 ];
+    if ( std::abs( det ) <= 1e-6 * scale * scale * scale ) return false;
+
+    double bx = -a[ 3 ], by = -a[ 6 ], bz = -a[ 8 ];
+    x = ( bx * ( a[ 4 ] * a[ 7 ] - a[ 5 ] * a[ 5 ] ) - a[ 1 ] * ( by * a[ 7 ] - a[ 5 ] * bz ) +
+      a[ 2 ] * ( by * a[ 5 ] - a[ 4 ] * bz ) ) / det;
+    y = ( a[ 0 ] * ( by * a[ 7 ] - a[ 5 ] * bz ) - bx * ( a[ 1 ] * a[ 7 ] - a[ 5 ] * a[ 2 ] ) +
+      a[ 2 ] * ( a[ 1 ] * bz - by * a[ 2 ] ) ) / det;
+    z = ( a[ 0 ] * ( a[ 4 ] * bz - by * a[ 5 ] ) - a[ 1 ] * ( a[ 1 ] * bz - by * a[ 2 ] ) +
+      bx * ( a[ 1 ] * a[ 5 ] - a[ 4 ] * a[ 2 ] ) ) / det;
+    return true;
+  }
+
+private:
+  double a_[ 10 ];
+};
+
+// A candidate edge collapse, merging point1_ into point0_ at position target_
+class EdgeCollapse
+{
+public:
+  double cost_;
+  unsigned int point0_;
+  unsigned int point1_;
+  unsigned int version0_;
+  unsigned int version1_;
+  PointF target_;
+
+  bool operator<( const EdgeCollapse& other ) const
+  {
+    // Reversed, so the priority queue returns the cheapest collapse first
+    return this->cost_ > other.cost_;
+  }
+};
+
+class Decimation
+{
+public:
+  Decimation( const PointFVector& points, const UIntVector& faces );
+
+  // Collapse edges until the number of faces drops to target_faces
+  bool run( size_t target_faces, const boost::function< bool () >& check_abort );
+
+  // Write out the remaining mesh
+  void extract( PointFVector& points, UIntVector& faces, UIntVector& source_points ) const;
+
+private:
+  void add_collapse( unsigned int point0, unsigned int point1 );
+  bool can_collapse( unsigned int point0, unsigned int point1, const PointF& target ) const;
+  void collapse( unsigned int point0, unsigned int point1, const PointF& target );
+
+  PointFVector points_;
+  UIntVector faces_;
+  std::vector< bool > face_removed_;
+  std::vector< UIntVector > point_faces_;
+  std::vector< Quadric > quadrics_;
+  std::vector< bool > locked_;
+  std::vector< bool > point_removed_;
+  UIntVector versions_;
+  std::priority_queue< EdgeCollapse > collapses_;
+  size_t num_faces_;
+};
+
+Decimation::Decimation( const PointFVector& points, const UIntVector& faces ) :
+  points_( points ),
+  faces_( faces ),
+  face_removed_( faces.size() / 3, false ),
+  point_faces_( points.size() ),
+  quadrics_( points.size() ),
+  locked_( points.size(), false ),
+  point_removed_( points.size(), false ),
+  versions_( points.size(), 0 ),
+  num_faces_( faces.size() / 3 )
+{
+  // Plane quadrics of the faces, weighted by their area
+  for ( size_t f = 0; f < this->num_faces_; f++ )
+  {
+    const unsigned int* v = &this->faces_[ 3 * f ];
+    const PointF& p0 = this->points_[ v[ 0 ] ];
+    VectorF normal = Cross( this->points_[ v[ 1 ] ] - p0, this->points_[ v[ 2 ] ] - p0 );
+    double length = normal.length();
+    for ( int k = 0; k < 3; k++ )
+    {
+      this->point_faces_[ v[ k ] ].push_back( static_cast< unsigned int >( f ) );
+    }
+    if ( length == 0.0 ) continue;
+
+    double nx = normal.x() / length, ny = normal.y() / length, nz = normal.z() / length;
+    double d = -( nx * p0.x() + ny * p0.y() + nz * p0.z() );
+    for ( int k = 0; k < 3; k++ )
+    {
+      this->quadrics_[ v[ k ] ].add_plane( nx, ny, nz, d, 0.5 * length );
+    }
+  }
+
+  // Edges that are not shared by exactly two faces are on the border of the mesh
+  std::vector< std::pair< unsigned int, unsigned int > > edges;
+  edges.reserve( this->faces_.size() );
+  for ( size_t j = 0; j < this->faces_.size(); j += 3 )
+  {
+    for ( int k = 0; k < 3; k++ )
+    {
+      unsigned int a = this->faces_[ j + k ];
+      unsigned int b = this->faces_[ j + ( k + 1 ) % 3 ];
+      edges.push_back( std::make_pair( std::min( a, b ), std::max( a, b ) ) );
+    }
+  }
+  std::sort( edges.begin(), edges.end() );
+  for ( size_t j = 0; j < edges.size(); )
+  {
+    size_t k = j + 1;
+    while ( k < edges.size() && edges[ k ] == edges[ j ] ) k++;
+    if ( k - j != 2 )
+    {
+      this->locked_[ edges[ j ].first ] = true;
+      this->locked_[ edges[ j ].second ] = true;
+    }
+    j = k;
+  }
+
+  // Queue the collapses once all the border points are known
+  edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+  for ( size_t j = 0; j < edges.size(); j++ )
+  {
+    this->add_collapse( edges[ j ].first, edges[ j ].second );
+  }
+}
+
+void Decimation::add_collapse( unsigned int point0, unsigned int point1 )
+{
+  if ( this->locked_[ point0 ] && this->locked_[ point1 ] ) return;
+
+  // A point on the border stays where it is
+  if ( this->locked_[ point1 ] ) std::swap( point0, point1 );
+
+  Quadric quadric = this->quadrics_[ point0 ];
+  quadric += this->quadrics_[ point1 ];
+
+  EdgeCollapse collapse;
+  collapse.point0_ = point0;
+  collapse.point1_ = point1;
+  collapse.version0_ = this->versions_[ point0 ];
+  collapse.version1_ = this->versions_[ point1 ];
+
+  const PointF& p0 = this->points_[ point0 ];
+  const PointF& p1 = this->points_[ point1 ];
+  double x, y, z;
+  if ( this->locked_[ point0 ] )
+  {
+    collapse.target_ = p0;
+  }
+  else if ( quadric.minimum( x, y, z ) )
+  {
+    collapse.target_ = PointF( static_cast< float >( x ), static_cast< float >( y ), 
+      static_cast< float >( z ) );
+  }
+  else
+  {
+    // Pick the best of the end points and the mid point
+    PointF candidates[ 3 ] = { p0, p1, PointF( ( p0 + p1 ) * 0.5f ) };
+    collapse.target_ = candidates[ 0 ];
+    for ( int k = 1; k < 3; k++ )
+    {
+      if ( quadric.error( candidates[ k ].x(), candidates[ k ].y(), candidates[ k ].z() ) < 
+        quadric.error( collapse.target_.x(), collapse.target_.y(), collapse.target_.z() ) )
+      {
+        collapse.target_ = candidates[ k ];
+      }
+    }
+  }
+
+  collapse.cost_ = quadric.error( collapse.target_.x(), collapse.target_.y(), 
+    collapse.target_.z() );
+  this->collapses_.push( collapse );
+}
+
+bool Decimation::can_collapse( unsigned int point0, unsigned int point1, 
+  const PointF& target ) const
+{
+  // The points that are connected to both end points must be exactly the points opposite to
+  // the edge, otherwise the collapse would make the mesh non-manifold.
+  UIntVector neighbors0, neighbors1;
+  size_t num_shared_faces = 0;
+  for ( size_t j = 0; j < this->point_faces_[ point0 ].size(); j++ )
+  {
+    const unsigned int* v = &this->faces_[ 3 * this->point_faces_[ point0 ][ j ] ];
+    bool shared = v[ 0 ] == point1 || v[ 1 ] == point1 || v[ 2 ] == point1;
+    if ( shared ) num_shared_faces++;
+    for ( int k = 0; k < 3; k++ )
+    {
+      if ( v[ k ] != point0 && v[ k ] != point1 ) neighbors0.push_back( v[ k ] );
+    }
+  }
+  for ( size_t j = 0; j < this->point_faces_[ point1 ].size(); j++ )
+  {
+    const unsigned int* v = &this->faces_[ 3 * this->point_faces_[ point1 ][ j ] ];
+    for ( int k = 0; k < 3; k++ )
+    {
+      if ( v[ k ] != point0 && v[ k ] != point1 ) neighbors1.push_back( v[ k ] );
+    }
+  }
+  std::sort( neighbors0.begin(), neighbors0.end() );
+  neighbors0.erase( std::unique( neighbors0.begin(), neighbors0.end() ), neighbors0.end() );
+  std::sort( neighbors1.begin(), neighbors1.end() );
+  neighbors1.erase( std::unique( neighbors1.begin(), neighbors1.end() ), neighbors1.end() );
+  UIntVector shared_neighbors;
+  std::set_intersection( neighbors0.begin(), neighbors0.end(), neighbors1.begin(), 
+    neighbors1.end(), std::back_inserter( shared_neighbors ) );
+  if ( num_shared_faces != 2 || shared_neighbors.size() != 2 ) return false;
+
+  // None of the remaining faces may flip over
+  const unsigned int ends[ 2 ] = { point0, point1 };
+  for ( int e = 0; e < 2; e++ )
+  {
+    const UIntVector& point_faces = this->point_faces_[ ends[ e ] ];
+    for ( size_t j = 0; j < point_faces.size(); j++ )
+    {
+      const unsigned int* v = &this->faces_[ 3 * point_faces[ j ] ];
+      if ( ( v[ 0 ] == point0 || v[ 1 ] == point0 || v[ 2 ] == point0 ) &&
+        ( v[ 0 ] == point1 || v[ 1 ] == point1 || v[ 2 ] == point1 ) ) continue;
+
+      PointF p[ 3 ], q[ 3 ];
+      for ( int k = 0; k < 3; k++ )
+      {
+        p[ k ] = this->points_[ v[ k ] ];
+        q[ k ] = v[ k ] == ends[ e ] ? target : p[ k ];
+      }
+      VectorF before = Cross( p[ 1 ] - p[ 0 ], p[ 2 ] - p[ 0 ] );
+      VectorF after = Cross( q[ 1 ] - q[ 0 ], q[ 2 ] - q[ 0 ] );
+      if ( Dot( before, after ) <= 0.2f * before.length() * after.length() ) return false;
+    }
+  }
+  return true;
+}
+
+void Decimation::collapse( unsigned int point0, unsigned int point1, const PointF& target )
+{
+  UIntVector& faces0 = this->point_faces_[ point0 ];
+  const UIntVector& faces1 = this->point_faces_[ point1 ];
+  for ( size_t j = 0; j < faces1.size(); j++ )
+  {
+    unsigned int f = faces1[ j ];
+    unsigned int* v = &this->faces_[ 3 * f ];
+    if ( v[ 0 ] == point0 || v[ 1 ] == point0 || v[ 2 ] == point0 )
+    {
+      // The face degenerates, remove it from its points
+      this->face_removed_[ f ] = true;
+      this->num_faces_--;
+      for ( int k = 0; k < 3; k++ )
+      {
+        if ( v[ k ] == point1 ) continue;
+        UIntVector& point_faces = this->point_faces_[ v[ k ] ];
+        point_faces.erase( std::remove( point_faces.begin(), point_faces.end(), f ), 
+          point_faces.end() );
+      }
+    }
+    else
+    {
+      for ( int k = 0; k < 3; k++ )
+      {
+        if ( v[ k ] == point1 ) v[ k ] = point0;
+      }
+      faces0.push_back( f );
+    }
+  }
+
+  this->points_[ point0 ] = target;
+  this->quadrics_[ point0 ] += this->quadrics_[ point1 ];
+  this->point_removed_[ point1 ] = true;
+  this->point_faces_[ point1 ].clear();
+  this->versions_[ point0 ]++;
+  this->versions_[ point1 ]++;
+
+  // The costs of all the edges around the merged point changed
+  UIntVector neighbors;
+  for ( size_t j = 0; j < faces0.size(); j++ )
+  {
+    const unsigned int* v = &this->faces_[ 3 * faces0[ j ] ];
+    for ( int k = 0; k < 3; k++ )
+    {
+      if ( v[ k ] != point0 ) neighbors.push_back( v[ k ] );
+    }
+  }
+  std::sort( neighbors.begin(), neighbors.end() );
+  neighbors.erase( std::unique( neighbors.begin(), neighbors.end() ), neighbors.end() );
+  for ( size_t j = 0; j < neighbors.size(); j++ )
+  {
+    this->versions_[ neighbors[ j ] ]++;
+  }
+  for ( size_t j = 0; j < neighbors.size(); j++ )
+  {
+    this->add_collapse( point0, neighbors[ j ] );
+  }
+}
+
+bool Decimation::run( size_t target_faces, const boost::function< bool () >& check_abort )
+{
+  size_t count = 0;
+  while ( this->num_faces_ > target_faces && !this->collapses_.empty() )
+  {
+    EdgeCollapse collapse = this->collapses_.top();
+    this->collapses_.pop();
+
+    // Skip collapses of which the end points changed since they were queued
+    if ( this->point_removed_[ collapse.point0_ ] || this->point_removed_[ collapse.point1_ ] ||
+      this->versions_[ collapse.point0_ ] != collapse.version0_ ||
+      this->versions_[ collapse.point1_ ] != collapse.version1_ ) continue;
+
+    if ( !this->can_collapse( collapse.point0_, collapse.point1_, collapse.target_ ) ) continue;
+
+    this->collapse( collapse.point0_, collapse.point1_, collapse.target_ );
+
+    if ( ( ++count & 0xFFF ) == 0 && check_abort && check_abort() ) return false;
+  }
+  return true;
+}
+
+void Decimation::extract( PointFVector& points, UIntVector& faces, 
+  UIntVector& source_points ) const
+{
+  const unsigned int UNUSED_C = static_cast< unsigned int >( -1 );
+  UIntVector point_map( this->points_.size(), UNUSED_C );
+  points.clear();
+  faces.clear();
+  source_points.clear();
+  faces.reserve( 3 * this->num_faces_ );
+
+  for ( size_t f = 0; f < this->face_removed_.size(); f++ )
+  {
+    if ( this->face_removed_[ f ] ) continue;
+    for ( int k = 0; k < 3; k++ )
+    {
+      unsigned int point = this->faces_[ 3 * f + k ];
+      if ( point_map[ point ] == UNUSED_C )
+      {
+        point_map[ point ] = static_cast< unsigned int >( points.size() );
+        points.push_back( this->points_[ point ] );
+        source_points.push_back( point );
+      }
+      faces.push_back( point_map[ point ] );
+    }
+  }
+}
+
+} // end anonymous namespace
+
+bool QuadricDecimator::Decimate( const PointFVector& points, const UIntVector& faces, 
+  size_t target_faces, PointFVector& decimated_points, UIntVector& decimated_faces, 
+  UIntVector& source_points, boost::function< bool () > check_abort )
+{
+  Decimation decimation( points, faces );
+  if ( !decimation.run( target_faces, check_abort ) ) return false;
+  decimation.extract( decimated_points, decimated_faces, source_points );
+  return true;
+}
+
+} // end namespace Core
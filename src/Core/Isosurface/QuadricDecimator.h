@@ -0,0 +1,63 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef CORE_ISOSURFACE_QUADRICDECIMATOR_H
+#define CORE_ISOSURFACE_QUADRICDECIMATOR_H
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+
+// Core includes
+#include <Core/Isosurface/Isosurface.h>
+
+namespace Core
+{
+
+// QUADRICDECIMATOR:
+/// Reduces the number of triangles of a mesh by collapsing edges, picking the collapse that 
+/// adds the least quadric error each time (Garland and Heckbert).
+class QuadricDecimator : public boost::noncopyable
+{
+public:
+  // DECIMATE:
+  /// Decimate the mesh given by points and faces (3 indices per triangle) until it has at most
+  /// target_faces triangles, or until no more edges can be collapsed.  Points on the border of 
+  /// the mesh, i.e. on edges that are used by only one triangle, are never moved or removed, so
+  /// meshes that share a border still fit together after decimating each of them.  For each
+  /// point of the decimated mesh, source_points holds the index of the point of the original
+  /// mesh it was derived from.  Returns false if the decimation was aborted.
+  static bool Decimate( const PointFVector& points, const UIntVector& faces, 
+    size_t target_faces, PointFVector& decimated_points, UIntVector& decimated_faces, 
+    UIntVector& source_points, 
+    boost::function< bool () > check_abort = boost::function< bool () >() );
+};
+
+} // end namespace Core
+
+#endif
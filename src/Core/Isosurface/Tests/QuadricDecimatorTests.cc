@@ -0,0 +1,282 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <map>
+#include <set>
+#include <utility>
+
+#include <Core/Isosurface/QuadricDecimator.h>
+
+using namespace Core;
+
+namespace {
+
+typedef std::map<std::pair<unsigned int, unsigned int>, size_t> EdgeCountMap;
+
+// Closed sphere made of rings of quads split into triangles, with a fan at each pole.
+void makeSphere(size_t numRings, size_t numSegments, PointFVector& points, UIntVector& faces)
+{
+  const double pi = 3.14159265358979323846;
+  points.clear();
+  faces.clear();
+  points.push_back(PointF(0.0f, 0.0f, 1.0f));
+  for (size_t ring = 1; ring < numRings; ring++)
+  {
+    double theta = pi * static_cast<double>(ring) / static_cast<double>(numRings);
+    for (size_t segment = 0; segment < numSegments; segment++)
+    {
+      double phi = 2.0 * pi * static_cast<double>(segment) / static_cast<double>(numSegments);
+      points.push_back(PointF(static_cast<float>(std::sin(theta) * std::cos(phi)),
+        static_cast<float>(std::sin(theta) * std::sin(phi)), static_cast<float>(std::cos(theta))));
+    }
+  }
+  points.push_back(PointF(0.0f, 0.0f, -1.0f));
+
+  unsigned int southPole = static_cast<unsigned int>(points.size() - 1);
+  for (size_t segment = 0; segment < numSegments; segment++)
+  {
+    unsigned int next = static_cast<unsigned int>((segment + 1) % numSegments);
+    unsigned int current = static_cast<unsigned int>(segment);
+
+    faces.push_back(0);
+    faces.push_back(1 + current);
+    faces.push_back(1 + next);
+
+    for (size_t ring = 1; ring + 1 < numRings; ring++)
+    {
+      unsigned int top = static_cast<unsigned int>(1 + (ring - 1) * numSegments);
+      unsigned int bottom = static_cast<unsigned int>(top + numSegments);
+      faces.push_back(top + current);
+      faces.push_back(bottom + current);
+      faces.push_back(bottom + next);
+      faces.push_back(top + current);
+      faces.push_back(bottom + next);
+      faces.push_back(top + next);
+    }
+
+    unsigned int last = static_cast<unsigned int>(1 + (numRings - 2) * numSegments);
+    faces.push_back(last + current);
+    faces.push_back(southPole);
+    faces.push_back(last + next);
+  }
+}
+
+// Flat square grid of size x size quads with a small bump in the middle.
+void makeGrid(size_t size, PointFVector& points, UIntVector& faces)
+{
+  points.clear();
+  faces.clear();
+  for (size_t y = 0; y <= size; y++)
+  {
+    for (size_t x = 0; x <= size; x++)
+    {
+      double dx = static_cast<double>(x) - 0.5 * size;
+      double dy = static_cast<double>(y) - 0.5 * size;
+      points.push_back(PointF(static_cast<float>(x), static_cast<float>(y),
+        static_cast<float>(2.0 * std::exp(-(dx * dx + dy * dy) / (0.05 * size * size)))));
+    }
+  }
+  for (size_t y = 0; y < size; y++)
+  {
+    for (size_t x = 0; x < size; x++)
+    {
+      unsigned int corner = static_cast<unsigned int>(y * (size + 1) + x);
+      unsigned int row = static_cast<unsigned int>(size + 1);
+      faces.push_back(corner);
+      faces.push_back(corner + 1);
+      faces.push_back(corner + row + 1);
+      faces.push_back(corner);
+      faces.push_back(corner + row + 1);
+      faces.push_back(corner + row);
+    }
+  }
+}
+
+EdgeCountMap countEdges(const UIntVector& faces)
+{
+  EdgeCountMap edges;
+  for (size_t j = 0; j < faces.size(); j += 3)
+  {
+    for (size_t k = 0; k < 3; k++)
+    {
+      unsigned int a = faces[j + k];
+      unsigned int b = faces[j + (k + 1) % 3];
+      edges[std::make_pair(std::min(a, b), std::max(a, b))]++;
+    }
+  }
+  return edges;
+}
+
+// Every face refers to three different existing points, and every point is used.
+void expectValidFaces(const PointFVector& points, const UIntVector& faces)
+{
+  ASSERT_EQ(0u, faces.size() % 3);
+  std::set<unsigned int> used;
+  for (size_t j = 0; j < faces.size(); j += 3)
+  {
+    ASSERT_LT(faces[j], points.size());
+    ASSERT_LT(faces[j + 1], points.size());
+    ASSERT_LT(faces[j + 2], points.size());
+    EXPECT_NE(faces[j], faces[j + 1]);
+    EXPECT_NE(faces[j + 1], faces[j + 2]);
+    EXPECT_NE(faces[j + 2], faces[j]);
+    used.insert(faces[j]);
+    used.insert(faces[j + 1]);
+    used.insert(faces[j + 2]);
+  }
+  EXPECT_EQ(points.size(), used.size());
+}
+
+bool neverAbort()
+{
+  return false;
+}
+
+bool alwaysAbort()
+{
+  return true;
+}
+
+}
+
+TEST(QuadricDecimatorTests, ClosedMeshKeepsTopology)
+{
+  PointFVector points;
+  UIntVector faces;
+  makeSphere(32, 64, points, faces);
+  size_t numFaces = faces.size() / 3;
+
+  PointFVector decimatedPoints;
+  UIntVector decimatedFaces;
+  UIntVector sourcePoints;
+  size_t targetFaces = numFaces / 4;
+  ASSERT_TRUE(QuadricDecimator::Decimate(points, faces, targetFaces, decimatedPoints,
+    decimatedFaces, sourcePoints, &neverAbort));
+
+  size_t numDecimatedFaces = decimatedFaces.size() / 3;
+  EXPECT_LE(numDecimatedFaces, targetFaces);
+  EXPECT_GT(numDecimatedFaces, targetFaces / 2);
+  expectValidFaces(decimatedPoints, decimatedFaces);
+
+  // Still a closed two-manifold of genus zero
+  EdgeCountMap edges = countEdges(decimatedFaces);
+  for (EdgeCountMap::const_iterator it = edges.begin(); it != edges.end(); ++it)
+  {
+    EXPECT_EQ(2u, it->second);
+  }
+  EXPECT_EQ(2, static_cast<int>(decimatedPoints.size()) - static_cast<int>(edges.size()) +
+    static_cast<int>(numDecimatedFaces));
+
+  // The points stay close to the sphere and know where they came from
+  ASSERT_EQ(decimatedPoints.size(), sourcePoints.size());
+  for (size_t j = 0; j < decimatedPoints.size(); j++)
+  {
+    ASSERT_LT(sourcePoints[j], points.size());
+    const PointF& p = decimatedPoints[j];
+    EXPECT_NEAR(1.0, std::sqrt(p.x() * p.x() + p.y() * p.y() + p.z() * p.z()), 0.05);
+  }
+}
+
+TEST(QuadricDecimatorTests, BorderPointsAreKept)
+{
+  PointFVector points;
+  UIntVector faces;
+  const size_t size = 40;
+  makeGrid(size, points, faces);
+
+  PointFVector decimatedPoints;
+  UIntVector decimatedFaces;
+  UIntVector sourcePoints;
+  ASSERT_TRUE(QuadricDecimator::Decimate(points, faces, faces.size() / 3 / 10, decimatedPoints,
+    decimatedFaces, sourcePoints));
+  EXPECT_LT(decimatedFaces.size(), faces.size() / 2);
+  expectValidFaces(decimatedPoints, decimatedFaces);
+
+  // Every border point of the grid is still there, at the same position
+  std::set<unsigned int> keptSources(sourcePoints.begin(), sourcePoints.end());
+  for (size_t j = 0; j < sourcePoints.size(); j++)
+  {
+    const PointF& original = points[sourcePoints[j]];
+    if (original.x() == 0.0f || original.y() == 0.0f || original.x() == size ||
+      original.y() == size)
+    {
+      EXPECT_EQ(original, decimatedPoints[j]);
+    }
+  }
+  size_t numBorderPoints = 0;
+  for (size_t j = 0; j < points.size(); j++)
+  {
+    size_t x = j % (size + 1);
+    size_t y = j / (size + 1);
+    if (x != 0 && y != 0 && x != size && y != size) continue;
+    numBorderPoints++;
+    EXPECT_EQ(1u, keptSources.count(static_cast<unsigned int>(j)));
+  }
+
+  // The border is made of the same number of edges, each used by one triangle
+  EdgeCountMap edges = countEdges(decimatedFaces);
+  size_t numBorderEdges = 0;
+  for (EdgeCountMap::const_iterator it = edges.begin(); it != edges.end(); ++it)
+  {
+    EXPECT_LE(it->second, 2u);
+    if (it->second == 1) numBorderEdges++;
+  }
+  EXPECT_EQ(numBorderPoints, numBorderEdges);
+}
+
+TEST(QuadricDecimatorTests, TargetAboveFaceCount)
+{
+  PointFVector points;
+  UIntVector faces;
+  makeSphere(8, 16, points, faces);
+
+  PointFVector decimatedPoints;
+  UIntVector decimatedFaces;
+  UIntVector sourcePoints;
+  ASSERT_TRUE(QuadricDecimator::Decimate(points, faces, faces.size(), decimatedPoints,
+    decimatedFaces, sourcePoints));
+  EXPECT_EQ(faces.size(), decimatedFaces.size());
+  EXPECT_EQ(points.size(), decimatedPoints.size());
+}
+
+TEST(QuadricDecimatorTests, Abort)
+{
+  PointFVector points;
+  UIntVector faces;
+  makeSphere(64, 128, points, faces);
+
+  PointFVector decimatedPoints;
+  UIntVector decimatedFaces;
+  UIntVector sourcePoints;
+  EXPECT_FALSE(QuadricDecimator::Decimate(points, faces, 100, decimatedPoints, decimatedFaces,
+    sourcePoints, &alwaysAbort));
+}
@@ -0,0 +1,385 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <zlib.h>
+
+#include <cstring>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/cstdint.hpp>
+
+#include <Core/LargeVolume/BrickCodec.h>
+
+namespace Core
+{
+
+#ifdef Z_PREFIX
+  #define zlib_uLongf z_uLongf
+  #define zlib_Bytef z_Bytef
+  #define zlib_uncompress z_uncompress
+  #define zlib_compress2 z_compress2
+  #define zlib_compressBound z_compressBound
+#else
+  #define zlib_uLongf uLongf
+  #define zlib_Bytef Bytef
+  #define zlib_uncompress uncompress
+  #define zlib_compress2 compress2
+  #define zlib_compressBound compressBound
+#endif
+
+bool ImportFromString( const std::string& codec_string, BrickCodecType& codec )
+{
+  std::string lower_codec = boost::to_lower_copy( codec_string ); 
+  boost::erase_all( lower_codec, " " );
+
+  if ( lower_codec == "none" || lower_codec == "raw" )
+  {
+    codec = BrickCodecType::NONE_E;
+    return true;
+  }
+  else if ( lower_codec == "zlib" )
+  {
+    codec = BrickCodecType::ZLIB_E;
+    return true;
+  }
+  else if ( lower_codec == "lz4" )
+  {
+    codec = BrickCodecType::LZ4_E;
+    return true;
+  }
+
+  return false;
+}
+
+std::string ExportToString( BrickCodecType codec )
+{
+  switch ( codec )
+  {
+  case BrickCodecType::NONE_E:
+    return "none";
+  case BrickCodecType::ZLIB_E:
+    return "zlib";
+  case BrickCodecType::LZ4_E:
+    return "lz4";
+  }
+
+  return "none";
+}
+
+// -- LZ4 block format --
+// Each sequence consists of a token (high nibble: number of literals, low nibble: match
+// length minus 4), optional extra literal length bytes, the literals, a 2 byte little endian
+// match offset and optional extra match length bytes. The last sequence only has literals.
+// The last 5 bytes of a block are always literals and the last match starts at least 12
+// bytes before the end of the block.
+
+namespace
+{
+
+const size_t LZ4_MIN_MATCH = 4;
+const size_t LZ4_LAST_LITERALS = 5;
+const size_t LZ4_MF_LIMIT = 12;
+const size_t LZ4_MAX_DISTANCE = 65535;
+const int LZ4_HASH_LOG = 16;
+
+inline boost::uint32_t lz4_read32( const unsigned char* ptr )
+{
+  boost::uint32_t value;
+  std::memcpy( &value, ptr, sizeof( value ) );
+  return value;
+}
+
+inline boost::uint32_t lz4_hash( boost::uint32_t sequence )
+{
+  return ( sequence * 2654435761U ) >> ( 32 - LZ4_HASH_LOG );
+}
+
+inline bool lz4_write_length( unsigned char* dst, size_t& op, size_t dst_size, size_t length )
+{
+  while ( length >= 255 )
+  {
+    if ( op >= dst_size ) return false;
+    dst[ op++ ] = 255;
+    length -= 255;
+  }
+  if ( op >= dst_size ) return false;
+  dst[ op++ ] = static_cast<unsigned char>( length );
+  return true;
+}
+
+bool lz4_write_sequence( unsigned char* dst, size_t& op, size_t dst_size, 
+  const unsigned char* literals, size_t num_literals, size_t offset, size_t match_length )
+{
+  if ( op >= dst_size ) return false;
+  unsigned char& token = dst[ op++ ];
+
+  token = static_cast<unsigned char>( ( num_literals < 15 ? num_literals : 15 ) << 4 );
+  if ( num_literals >= 15 && !lz4_write_length( dst, op, dst_size, num_literals - 15 ) ) 
+    return false;
+
+  if ( op + num_literals > dst_size ) return false;
+  std::memcpy( dst + op, literals, num_literals );
+  op += num_literals;
+
+  // Last sequence does not contain a match
+  if ( match_length == 0 ) return true;
+
+  if ( op + 2 > dst_size ) return false;
+  dst[ op++ ] = static_cast<unsigned char>( offset & 0xff );
+  dst[ op++ ] = static_cast<unsigned char>( offset >> 8 );
+
+  size_t length = match_length - LZ4_MIN_MATCH;
+  token |= static_cast<unsigned char>( length < 15 ? length : 15 );
+  if ( length >= 15 && !lz4_write_length( dst, op, dst_size, length - 15 ) ) return false;
+
+  return true;
+}
+
+bool lz4_compress( const unsigned char* src, size_t src_size, unsigned char* dst, 
+  size_t dst_capacity, size_t& dst_size )
+{
+  size_t op = 0;
+  size_t anchor = 0;
+
+  if ( src_size > LZ4_MF_LIMIT )
+  {
+    std::vector<boost::uint32_t> table( static_cast<size_t>( 1 ) << LZ4_HASH_LOG, 0 );
+    const size_t match_limit = src_size - LZ4_LAST_LITERALS;
+    const size_t mf_limit = src_size - LZ4_MF_LIMIT;
+
+    // The first position is never a match, which makes 0 safe as the empty table value
+    size_t ip = 1;
+    table[ lz4_hash( lz4_read32( src ) ) ] = 0;
+
+    while ( ip < mf_limit )
+    {
+      boost::uint32_t sequence = lz4_read32( src + ip );
+      boost::uint32_t hash = lz4_hash( sequence );
+      size_t ref = table[ hash ];
+      table[ hash ] = static_cast<boost::uint32_t>( ip );
+
+      if ( ip - ref > LZ4_MAX_DISTANCE || lz4_read32( src + ref ) != sequence )
+      {
+        // Skip faster through data that does not compress
+        ip += 1 + ( ( ip - anchor ) >> 6 );
+        continue;
+      }
+
+      // Extend the match backwards into the pending literals
+      while ( ip > anchor && ref > 0 && src[ ip - 1 ] == src[ ref - 1 ] ) 
+      {
+        ip--;
+        ref--;
+      }
+
+      size_t length = LZ4_MIN_MATCH;
+      while ( ip + length < match_limit && src[ ref + length ] == src[ ip + length ] ) length++;
+
+      if ( !lz4_write_sequence( dst, op, dst_capacity, src + anchor, ip - anchor, 
+        ip - ref, length ) )
+      {
+        return false;
+      }
+
+      ip += length;
+      anchor = ip;
+
+      // Make the position just before the end of the match available for the next match
+      if ( ip - 2 < mf_limit ) 
+      {
+        table[ lz4_hash( lz4_read32( src + ip - 2 ) ) ] = static_cast<boost::uint32_t>( ip - 2 );
+      }
+    }
+  }
+
+  if ( !lz4_write_sequence( dst, op, dst_capacity, src + anchor, src_size - anchor, 0, 0 ) )
+  {
+    return false;
+  }
+
+  dst_size = op;
+  return true;
+}
+
+bool lz4_decompress( const unsigned char* src, size_t src_size, unsigned char* dst, 
+  size_t dst_size )
+{
+  size_t ip = 0;
+  size_t op = 0;
+
+  while ( true )
+  {
+    if ( ip >= src_size ) return false;
+    unsigned char token = src[ ip++ ];
+
+    size_t num_literals = token >> 4;
+    if ( num_literals == 15 )
+    {
+      unsigned char value;
+      do 
+      {
+        if ( ip >= src_size ) return false;
+        value = src[ ip++ ];
+        num_literals += value;
+      } while ( value == 255 );
+    }
+
+    if ( ip + num_literals > src_size || op + num_literals > dst_size ) return false;
+    std::memcpy( dst + op, src + ip, num_literals );
+    ip += num_literals;
+    op += num_literals;
+
+    // Last sequence
+    if ( ip == src_size ) break;
+
+    if ( ip + 2 > src_size ) return false;
+    size_t offset = static_cast<size_t>( src[ ip ] ) | ( static_cast<size_t>( src[ ip + 1 ] ) << 8 );
+    ip += 2;
+    if ( offset == 0 || offset > op ) return false;
+
+    size_t length = token & 15;
+    if ( length == 15 )
+    {
+      unsigned char value;
+      do 
+      {
+        if ( ip >= src_size ) return false;
+        value = src[ ip++ ];
+        length += value;
+      } while ( value == 255 );
+    }
+    length += LZ4_MIN_MATCH;
+
+    if ( op + length > dst_size ) return false;
+
+    const unsigned char* match = dst + op - offset;
+    if ( offset >= length )
+    {
+      std::memcpy( dst + op, match, length );
+      op += length;
+    }
+    else
+    {
+      // Overlapping copy repeats the pattern
+      for ( size_t k = 0; k < length; k++ ) dst[ op++ ] = match[ k ];
+    }
+  }
+
+  return op == dst_size;
+}
+
+} // end anonymous namespace
+
+bool BrickCodec::Compress( BrickCodecType codec, const char* src, size_t src_size, 
+  std::vector<char>& dst )
+{
+  switch ( codec )
+  {
+  case BrickCodecType::ZLIB_E:
+    {
+      zlib_uLongf dst_size = zlib_compressBound( static_cast<zlib_uLongf>( src_size ) );
+      dst.resize( dst_size );
+      if ( zlib_compress2( reinterpret_cast<zlib_Bytef*>( &dst[ 0 ] ), &dst_size,
+        reinterpret_cast<const zlib_Bytef*>( src ), src_size, Z_DEFAULT_COMPRESSION ) != Z_OK )
+      {
+        return false;
+      }
+      if ( dst_size >= src_size ) return false;
+
+      dst.resize( dst_size );
+      return true;
+    }
+  case BrickCodecType::LZ4_E:
+    {
+      // Compressed data needs to be smaller than the input to be of any use
+      if ( src_size == 0 ) return false;
+      dst.resize( src_size );
+      size_t dst_size = 0;
+      if ( !lz4_compress( reinterpret_cast<const unsigned char*>( src ), src_size, 
+        reinterpret_cast<unsigned char*>( &dst[ 0 ] ), src_size - 1, dst_size ) )
+      {
+        return false;
+      }
+
+      dst.resize( dst_size );
+      return true;
+    }
+  case BrickCodecType::NONE_E:
+    break;
+  }
+
+  return false;
+}
+
+bool BrickCodec::Decompress( BrickCodecType codec, const char* src, size_t src_size, 
+  char* dst, size_t dst_size )
+{
+  switch ( codec )
+  {
+  case BrickCodecType::ZLIB_E:
+    {
+      zlib_uLongf dst_size_ul = dst_size;
+      if ( zlib_uncompress( reinterpret_cast<zlib_Bytef*>( dst ), &dst_size_ul,
+        reinterpret_cast<const zlib_Bytef*>( src ), src_size ) != Z_OK )
+      {
+        return false;
+      }
+
+      return dst_size_ul == dst_size;
+    }
+  case BrickCodecType::LZ4_E:
+    return lz4_decompress( reinterpret_cast<const unsigned char*>( src ), src_size,
+      reinterpret_cast<unsigned char*>( dst ), dst_size );
+  case BrickCodecType::NONE_E:
+    break;
+  }
+
+  return false;
+}
+
+void BrickCodec::Shuffle( const char* src, char* dst, size_t num_elements, size_t elem_size )
+{
+  for ( size_t b = 0; b < elem_size; b++ )
+  {
+    const char* in = src + b;
+    char* out = dst + b * num_elements;
+    for ( size_t k = 0; k < num_elements; k++, in += elem_size ) out[ k ] = *in;
+  }
+}
+
+void BrickCodec::Unshuffle( const char* src, char* dst, size_t num_elements, size_t elem_size )
+{
+  for ( size_t b = 0; b < elem_size; b++ )
+  {
+    const char* in = src + b * num_elements;
+    char* out = dst + b;
+    for ( size_t k = 0; k < num_elements; k++, out += elem_size ) *out = in[ k ];
+  }
+}
+
+} // end namespace Core
@@ -0,0 +1,91 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_LARGEVOLUME_BRICKCODEC_H
+#define CORE_LARGEVOLUME_BRICKCODEC_H
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Core includes
+#include <Core/Utils/EnumClass.h>
+
+namespace Core
+{
+
+// CLASS BrickCodecType:
+/// The codecs that can be used to compress the bricks of a large volume
+
+CORE_ENUM_CLASS
+(
+  BrickCodecType,
+  // Bricks are stored uncompressed
+  NONE_E = 0,
+  // Bricks are compressed with zlib (deflate), the format of older large volumes
+  ZLIB_E,
+  // Bricks are compressed with the LZ4 block format, trading ratio for decoding speed
+  LZ4_E
+)
+
+// IMPORTFROMSTRING:
+/// Import a BrickCodecType from a string
+bool ImportFromString( const std::string& codec_string, BrickCodecType& codec );
+
+// EXPORTTOSTRING:
+/// Export the codec type to a string
+std::string ExportToString( BrickCodecType codec );
+
+class BrickCodec
+{
+public:
+  /// COMPRESS
+  /// Compress a buffer with the given codec. If the compressed data is not smaller than the
+  /// input the function returns false, in which case the brick should be stored uncompressed.
+  static bool Compress( BrickCodecType codec, const char* src, size_t src_size, 
+    std::vector<char>& dst );
+
+  /// DECOMPRESS
+  /// Decompress a buffer, dst_size needs to be the exact size of the uncompressed data
+  static bool Decompress( BrickCodecType codec, const char* src, size_t src_size, 
+    char* dst, size_t dst_size );
+
+  /// SHUFFLE
+  /// Byte-shuffle filter: group the first bytes of all the elements, then all the second
+  /// bytes, etc. For 16 bit and floating point data this puts the slowly varying bytes next
+  /// to each other, which makes the data far more compressible.
+  static void Shuffle( const char* src, char* dst, size_t num_elements, size_t elem_size );
+
+  /// UNSHUFFLE
+  /// Inverse of the byte-shuffle filter
+  static void Unshuffle( const char* src, char* dst, size_t num_elements, size_t elem_size );
+};
+
+} // end namespace Core
+
+#endif
@@ -0,0 +1,359 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+// Core includes
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/LargeVolume/LargeVolumeBuilder.h>
+#include <Core/Utils/TaskScheduler.h>
+
+namespace Core
+{
+
+typedef IndexVector::index_type index_type;
+
+// GETBRICKINDEX:
+/// Get the position of a brick in the layout of its level
+static IndexVector GetBrickIndex( const IndexVector& layout, index_type brick_index )
+{
+  const index_type nxy = layout.x() * layout.y();
+  const index_type z = brick_index / nxy;
+  const index_type y = ( brick_index - z * nxy ) / layout.x();
+  const index_type x = brick_index - z * nxy - y * layout.x();
+  return IndexVector( x, y, z );
+}
+
+// COPYREGION:
+/// Copy a box of voxels between two data blocks of the same data type
+static void CopyRegion( DataBlockHandle src, const IndexVector& src_start, DataBlockHandle dst,
+  const IndexVector& dst_start, const IndexVector& size )
+{
+  const size_t elem_size = src->get_elem_size();
+  const size_t row_size = static_cast< size_t >( size.x() ) * elem_size;
+  const char* src_data = reinterpret_cast< const char* >( src->get_data() );
+  char* dst_data = reinterpret_cast< char* >( dst->get_data() );
+
+  for ( index_type z = 0; z < size.z(); z++ )
+  {
+    for ( index_type y = 0; y < size.y(); y++ )
+    {
+      std::memcpy( dst_data + dst->to_index( dst_start.x(), dst_start.y() + y, 
+        dst_start.z() + z ) * elem_size, src_data + src->to_index( src_start.x(), 
+        src_start.y() + y, src_start.z() + z ) * elem_size, row_size );
+    }
+  }
+}
+
+// DOWNSAMPLEREGION:
+/// Average boxes of ratio voxels of the source into the voxels of the destination, boxes at
+/// the far edges of the source may be partial
+template< class T >
+static void DownsampleRegion( DataBlockHandle src, DataBlockHandle dst, const IndexVector& ratio )
+{
+  const T* src_data = reinterpret_cast< const T* >( src->get_data() );
+  T* dst_data = reinterpret_cast< T* >( dst->get_data() );
+
+  const index_type snx = static_cast< index_type >( src->get_nx() );
+  const index_type sny = static_cast< index_type >( src->get_ny() );
+  const index_type snz = static_cast< index_type >( src->get_nz() );
+  const index_type dnx = static_cast< index_type >( dst->get_nx() );
+  const index_type dny = static_cast< index_type >( dst->get_ny() );
+  const index_type dnz = static_cast< index_type >( dst->get_nz() );
+
+  for ( index_type z = 0; z < dnz; z++ )
+  {
+    const index_type z_end = std::min( ( z + 1 ) * ratio.z(), snz );
+    for ( index_type y = 0; y < dny; y++ )
+    {
+      const index_type y_end = std::min( ( y + 1 ) * ratio.y(), sny );
+      for ( index_type x = 0; x < dnx; x++, dst_data++ )
+      {
+        const index_type x_end = std::min( ( x + 1 ) * ratio.x(), snx );
+        double sum = 0.0;
+        index_type count = 0;
+        for ( index_type sz = z * ratio.z(); sz < z_end; sz++ )
+        {
+          for ( index_type sy = y * ratio.y(); sy < y_end; sy++ )
+          {
+            const T* src_row = src_data + ( sz * sny + sy ) * snx;
+            for ( index_type sx = x * ratio.x(); sx < x_end; sx++, count++ )
+            {
+              sum += static_cast< double >( src_row[ sx ] );
+            }
+          }
+        }
+        *dst_data = count > 0 ? static_cast< T >( sum / count ) : T( 0 );
+      }
+    }
+  }
+}
+
+static bool DownsampleRegion( DataBlockHandle src, DataBlockHandle dst, const IndexVector& ratio )
+{
+  switch( src->get_data_type() )
+  {
+    case DataType::CHAR_E:
+      DownsampleRegion< signed char >( src, dst, ratio ); return true;
+    case DataType::UCHAR_E:
+      DownsampleRegion< unsigned char >( src, dst, ratio ); return true;
+    case DataType::SHORT_E:
+      DownsampleRegion< short >( src, dst, ratio ); return true;
+    case DataType::USHORT_E:
+      DownsampleRegion< unsigned short >( src, dst, ratio ); return true;
+    case DataType::INT_E:
+      DownsampleRegion< int >( src, dst, ratio ); return true;
+    case DataType::UINT_E:
+      DownsampleRegion< unsigned int >( src, dst, ratio ); return true;
+    case DataType::FLOAT_E:
+      DownsampleRegion< float >( src, dst, ratio ); return true;
+    case DataType::DOUBLE_E:
+      DownsampleRegion< double >( src, dst, ratio ); return true;
+    default:
+      return false;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Class LargeVolumeBuilderPrivate
+//////////////////////////////////////////////////////////////////////////
+
+class LargeVolumeBuilderPrivate
+{
+public:
+  // BUILD_BRICKS:
+  /// Build the bricks [brick_begin, brick_end) of a level, cancels the group on an error
+  void build_bricks( TaskGroup* group, size_t level, size_t brick_begin, size_t brick_end );
+
+  // BUILD_BRICK:
+  /// Render or downsample the data of one brick and write the brick
+  bool build_brick( const BrickInfo& bi, std::string& error );
+
+  // GATHER_REGION:
+  /// Copy a region of a level, which starts at start and has the size of the data block,
+  /// out of the bricks of that level
+  bool gather_region( size_t level, const IndexVector& start, DataBlockHandle region,
+    std::string& error );
+
+  LargeVolumeSchemaHandle schema_;
+  LargeVolumeBuilder::render_function_type render_;
+
+  // Range of the data and the first error, protected by the mutex
+  boost::mutex mutex_;
+  double min_;
+  double max_;
+  std::string error_;
+};
+
+void LargeVolumeBuilderPrivate::build_bricks( TaskGroup* group, size_t level, 
+  size_t brick_begin, size_t brick_end )
+{
+  for ( size_t k = brick_begin; k < brick_end; k++ )
+  {
+    if ( group->is_canceled() ) return;
+
+    std::string error;
+    if ( !this->build_brick( BrickInfo( k, level ), error ) )
+    {
+      boost::mutex::scoped_lock lock( this->mutex_ );
+      if ( this->error_.empty() ) this->error_ = error;
+      group->cancel();
+      return;
+    }
+  }
+}
+
+bool LargeVolumeBuilderPrivate::build_brick( const BrickInfo& bi, std::string& error )
+{
+  const DataType data_type = this->schema_->get_data_type();
+
+  IndexVector start, end;
+  LargeVolumeBuilder::GetBrickRegion( this->schema_, bi, start, end );
+  const IndexVector size = end - start;
+
+  DataBlockHandle region = StdDataBlock::New( size.x(), size.y(), size.z(), data_type );
+
+  if ( bi.level_ == 0 )
+  {
+    if ( !this->render_( start, region, error ) ) return false;
+
+    region->update_histogram();
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    this->min_ = std::min( this->min_, region->get_min() );
+    this->max_ = std::max( this->max_, region->get_max() );
+  }
+  else
+  {
+    // Each voxel is the average of a box of voxels of the level before
+    const IndexVector& ratio = this->schema_->get_level_downsample_ratio( bi.level_ );
+    const IndexVector& prev_ratio = this->schema_->get_level_downsample_ratio( bi.level_ - 1 );
+    const IndexVector step( ratio.x() / prev_ratio.x(), ratio.y() / prev_ratio.y(), 
+      ratio.z() / prev_ratio.z() );
+    const IndexVector prev_size = this->schema_->get_level_size( bi.level_ - 1 );
+
+    const IndexVector src_start( start.x() * step.x(), start.y() * step.y(), 
+      start.z() * step.z() );
+    const IndexVector src_end( std::min( end.x() * step.x(), prev_size.x() ),
+      std::min( end.y() * step.y(), prev_size.y() ), std::min( end.z() * step.z(), prev_size.z() ) );
+    const IndexVector src_size = src_end - src_start;
+
+    DataBlockHandle source = StdDataBlock::New( src_size.x(), src_size.y(), src_size.z(), 
+      data_type );
+    if ( !this->gather_region( bi.level_ - 1, src_start, source, error ) ) return false;
+    DownsampleRegion( source, region, step );
+  }
+
+  // The voxels of the overlap that are outside the volume are zero
+  const IndexVector brick_size = this->schema_->get_brick_size( bi );
+  DataBlockHandle brick = StdDataBlock::New( brick_size.x(), brick_size.y(), brick_size.z(),
+    data_type );
+  std::memset( brick->get_data(), 0, brick->get_byte_size() );
+
+  const IndexVector index = GetBrickIndex( this->schema_->get_level_layout( bi.level_ ), 
+    bi.index_ );
+  const IndexVector& eff_size = this->schema_->get_effective_brick_size();
+  const IndexVector& overlap = this->schema_->get_brick_overlap();
+  const IndexVector brick_start( index.x() * eff_size.x() - overlap.x(), 
+    index.y() * eff_size.y() - overlap.y(), index.z() * eff_size.z() - overlap.z() );
+
+  CopyRegion( region, IndexVector( 0, 0, 0 ), brick, start - brick_start, size );
+
+  return this->schema_->write_brick( brick, bi, error );
+}
+
+bool LargeVolumeBuilderPrivate::gather_region( size_t level, const IndexVector& start, 
+  DataBlockHandle region, std::string& error )
+{
+  const IndexVector end = start + IndexVector( region->get_nx(), region->get_ny(), 
+    region->get_nz() );
+  const IndexVector& eff_size = this->schema_->get_effective_brick_size();
+  const IndexVector& overlap = this->schema_->get_brick_overlap();
+  const IndexVector layout = this->schema_->get_level_layout( level );
+  const IndexVector level_size = this->schema_->get_level_size( level );
+
+  // Copy the part of each brick that it owns, i.e. without the overlap
+  for ( index_type bz = start.z() / eff_size.z(); bz <= ( end.z() - 1 ) / eff_size.z(); bz++ )
+  {
+    for ( index_type by = start.y() / eff_size.y(); by <= ( end.y() - 1 ) / eff_size.y(); by++ )
+    {
+      for ( index_type bx = start.x() / eff_size.x(); bx <= ( end.x() - 1 ) / eff_size.x(); bx++ )
+      {
+        const IndexVector owned_start( bx * eff_size.x(), by * eff_size.y(), bz * eff_size.z() );
+        const IndexVector copy_start( std::max( owned_start.x(), start.x() ), 
+          std::max( owned_start.y(), start.y() ), std::max( owned_start.z(), start.z() ) );
+        const IndexVector copy_end( 
+          std::min( std::min( owned_start.x() + eff_size.x(), level_size.x() ), end.x() ),
+          std::min( std::min( owned_start.y() + eff_size.y(), level_size.y() ), end.y() ),
+          std::min( std::min( owned_start.z() + eff_size.z(), level_size.z() ), end.z() ) );
+
+        BrickInfo bi( bx + layout.x() * ( by + layout.y() * bz ), level );
+        DataBlockHandle brick;
+        if ( !this->schema_->read_brick( brick, bi, error ) ) return false;
+
+        const IndexVector brick_start = owned_start - overlap;
+        CopyRegion( brick, copy_start - brick_start, region, copy_start - start, 
+          copy_end - copy_start );
+      }
+    }
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Class LargeVolumeBuilder
+//////////////////////////////////////////////////////////////////////////
+
+LargeVolumeBuilder::LargeVolumeBuilder( LargeVolumeSchemaHandle schema ) :
+  private_( new LargeVolumeBuilderPrivate )
+{
+  this->private_->schema_ = schema;
+}
+
+bool LargeVolumeBuilder::run( render_function_type render, std::string& error )
+{
+  error = "";
+  this->private_->render_ = render;
+  this->private_->min_ = std::numeric_limits< double >::max();
+  this->private_->max_ = -std::numeric_limits< double >::max();
+  this->private_->error_ = "";
+
+  // Saving the schema creates the directory for the bricks
+  if ( !this->private_->schema_->save( error ) ) return false;
+
+  // Each level is built from the finished bricks of the level before it
+  for ( size_t level = 0; level < this->private_->schema_->get_num_levels(); level++ )
+  {
+    size_t num_bricks = this->private_->schema_->compute_level_num_bricks( level );
+
+    if ( this->private_->schema_->is_sharded() && 
+      !this->private_->schema_->clear_shard( level, error ) )
+    {
+      return false;
+    }
+
+    TaskGroup group;
+    ParallelFor( group, 0, num_bricks, boost::bind( &LargeVolumeBuilderPrivate::build_bricks,
+      this->private_, &group, level, _1, _2 ), 1 );
+
+    if ( group.is_canceled() )
+    {
+      error = this->private_->error_;
+      return false;
+    }
+  }
+
+  this->private_->schema_->set_min_max( this->private_->min_, this->private_->max_ );
+  return this->private_->schema_->save( error );
+}
+
+void LargeVolumeBuilder::GetBrickRegion( LargeVolumeSchemaHandle schema, const BrickInfo& bi, 
+  IndexVector& start, IndexVector& end )
+{
+  const IndexVector index = GetBrickIndex( schema->get_level_layout( bi.level_ ), bi.index_ );
+  const IndexVector& eff_size = schema->get_effective_brick_size();
+  const IndexVector& overlap = schema->get_brick_overlap();
+  const IndexVector brick_size = schema->get_brick_size( bi );
+  const IndexVector level_size = schema->get_level_size( bi.level_ );
+
+  for ( size_t j = 0; j < 3; j++ )
+  {
+    index_type brick_start = index[ j ] * eff_size[ j ] - overlap[ j ];
+    start[ j ] = std::max( brick_start, index_type( 0 ) );
+    end[ j ] = std::min( brick_start + brick_size[ j ], level_size[ j ] );
+  }
+}
+
+} // end namespace Core
@@ -0,0 +1,90 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_LARGEVOLUME_LARGEVOLUMEBUILDER_H
+#define CORE_LARGEVOLUME_LARGEVOLUMEBUILDER_H
+
+// Boost includes
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+// Core includes
+#include <Core/Geometry/IndexVector.h>
+#include <Core/DataBlock/DataBlock.h>
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+
+namespace Core
+{
+
+// Internals are separated from the interface
+class LargeVolumeBuilderPrivate;
+typedef boost::shared_ptr< LargeVolumeBuilderPrivate > LargeVolumeBuilderPrivateHandle;
+
+// CLASS LARGEVOLUMEBUILDER:
+/// Build the bricks of a large volume from a function that renders regions of the volume at
+/// full resolution. Unlike the converter, which needs the data as a stack of slices, the
+/// builder only asks for the region of one brick at a time, hence data that does not fit in
+/// memory can be written straight into a large volume.
+
+class LargeVolumeBuilder : public boost::noncopyable
+{
+  // -- types --
+public:
+  /// Function that fills the data block with the full resolution data of the region that
+  /// starts at the given voxel and has the size of the data block. It is called from several
+  /// threads at the same time.
+  typedef boost::function< bool ( const IndexVector& start, DataBlockHandle data_block, 
+    std::string& error ) > render_function_type;
+
+  // -- constructor --
+public:
+  /// The schema needs to have its directory and parameters set and its levels computed
+  explicit LargeVolumeBuilder( LargeVolumeSchemaHandle schema );
+
+  // -- building --
+public:
+  /// RUN
+  /// Render the full resolution bricks in parallel, build each coarser level by averaging 
+  /// the bricks of the level before it, and save the schema with the range of the data.
+  bool run( render_function_type render, std::string& error );
+
+  /// GETBRICKREGION
+  /// Get the voxels of the brick's level that are stored in a brick, clipped to the size of
+  /// the level. The region is [start, end).
+  static void GetBrickRegion( LargeVolumeSchemaHandle schema, const BrickInfo& bi, 
+    IndexVector& start, IndexVector& end );
+
+  // -- internals --
+private:
+  LargeVolumeBuilderPrivateHandle private_;
+};
+
+} // end namespace Core
+
+#endif
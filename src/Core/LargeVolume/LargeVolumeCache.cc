@@ -26,54 +26,125 @@
  DEALINGS IN THE SOFTWARE.
  */
 
-#include <list>
+#include <limits>
+#include <map>
 #include <queue>
 
 #include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include <Core/Application/Application.h>
 #include <Core/Utils/ConnectionHandler.h>
 #include <Core/DataBlock/DataBlock.h>
+#include <Core/Utils/StringUtil.h>
+#include <Core/Utils/Log.h>
 #include <Core/LargeVolume/LargeVolumeCache.h>
 
 namespace Core
 {
 CORE_SINGLETON_IMPLEMENTATION( LargeVolumeCache );
 
-class LargeVolumeCachePrivate : ConnectionHandler, Lockable, public EventHandler
+class LargeVolumeCachePrivate : ConnectionHandler, public Lockable
 {
-  typedef std::list<std::string> cache_access_list_type;
+  // Bricks ordered by priority, the brick with the lowest priority is evicted first
+  typedef std::multimap<double, std::string> cache_priority_map_type;
 
   struct CacheEntry
   {
     DataBlockHandle data_block_;
-    cache_access_list_type::iterator access_record_;
+    cache_priority_map_type::iterator priority_record_;
+    double cost_;
+    bool pinned_;
   };
 
   struct LoadJob
   {
-    LoadJob( LargeVolumeSchemaHandle schema, BrickInfo bi ) :
-      schema_( schema ), bi_( bi )
+    LoadJob( LargeVolumeSchemaHandle schema, BrickInfo bi, const std::string& load_key,
+      long long generation, double distance, bool prefetch, long long sequence ) :
+      schema_( schema ), bi_( bi ), load_key_( load_key ), generation_( generation ),
+      distance_( distance ), prefetch_( prefetch ), sequence_( sequence )
     {
     };
 
+    // Order used by the priority queue: bricks that are needed for rendering before the
+    // bricks that are prefetched, coarse levels first, as they serve as a fallback for all
+    // the bricks underneath them, then the bricks closest to the viewport center, and finally
+    // the order in which the bricks were requested.
+    bool operator<( const LoadJob& rhs ) const
+    {
+      if ( this->prefetch_ != rhs.prefetch_ ) return this->prefetch_;
+      if ( this->bi_.level_ != rhs.bi_.level_ ) return this->bi_.level_ < rhs.bi_.level_;
+      if ( this->distance_ != rhs.distance_ ) return this->distance_ > rhs.distance_;
+      return this->sequence_ > rhs.sequence_;
+    }
+
     LargeVolumeSchemaHandle schema_;
     BrickInfo bi_;
+    std::string load_key_;
+    long long generation_;
+    double distance_;
+    bool prefetch_;
+    long long sequence_;
   };
 
   typedef boost::unordered_map<std::string, CacheEntry> cache_map_type;
+  typedef Lockable::mutex_type queue_mutex_type;
+  typedef Lockable::lock_type queue_lock_type;
 
 public:
   long long cache_capacity_;
+  // Capacity picked at startup from the memory size or the cachegb command line parameter
+  long long default_cache_capacity_;
   long long cache_size_;
-  cache_access_list_type cache_access_list_;
+  long long pinned_size_;
+  cache_priority_map_type cache_priority_map_;
   cache_map_type cache_map_;
 
-  LargeVolumeCache* instance_;
+  // Priority of the last evicted brick. The priority of a brick is its reload cost on top of
+  // the priority of the last eviction at the time it was last used, hence bricks that are not
+  // used age relative to the bricks that are.
+  double cache_inflation_;
+
+  LargeVolumeCachePolicyHandle policy_;
+
+  // -- statistics --
+  long long hits_;
+  long long misses_;
+  long long evictions_;
 
-  boost::unordered_map<std::string,std::queue<LoadJob> > jobs_;
+  LargeVolumeCache* instance_;
 
-  LargeVolumeCachePrivate()
+  // -- load queue --
+  // The load queue is protected by its own mutex, so that workers that are reading or
+  // decompressing bricks never block the cache lookups done by the render threads.
+  queue_mutex_type queue_mutex_;
+  boost::condition_variable queue_condition_;
+  std::priority_queue<LoadJob> jobs_;
+
+  // Generation of each load key, clearing the load queue of a key bumps its generation,
+  // which invalidates all the jobs that are still waiting in the queue.
+  boost::unordered_map<std::string, long long> load_key_generation_;
+
+  // Bricks that are currently being read by one of the workers
+  boost::unordered_set<std::string> loading_bricks_;
+
+  long long job_sequence_;
+  bool done_;
+
+  boost::thread_group workers_;
+
+  LargeVolumeCachePrivate() :
+    cache_size_( 0 ),
+    pinned_size_( 0 ),
+    cache_inflation_( 0.0 ),
+    policy_( new LargeVolumeCachePolicy ),
+    hits_( 0 ),
+    misses_( 0 ),
+    evictions_( 0 ),
+    job_sequence_( 0 ),
+    done_( false )
   {
     if (sizeof( void * ) == 4)
     {
@@ -96,7 +167,14 @@ public:
       this->cache_capacity_ = Core::Min( static_cast<long long>( 32 ) << 30, mem_size );
     }
 
-    this->cache_size_ = 0;
+    std::string cache_gb;
+    double gb = 0.0;
+    if ( Core::Application::Instance()->check_command_line_parameter( "cachegb", cache_gb ) &&
+      ImportFromString( cache_gb, gb ) && gb > 0.0 )
+    {
+      this->cache_capacity_ = static_cast<long long>( gb * ( static_cast<long long>( 1 ) << 30 ) );
+    }
+    this->default_cache_capacity_ = this->cache_capacity_;
 
     this->add_connection( Application::Instance()->reset_signal_.connect(
       boost::bind( &LargeVolumeCachePrivate::clear_cache, this ) ) );
@@ -105,32 +183,85 @@ public:
   ~LargeVolumeCachePrivate()
   {
     this->disconnect_all();
+    this->stop_workers();
+  }
+
+  void start_workers()
+  {
+    // Loading a brick is a mix of disk access and decompression, hence use a few more
+    // workers than cores for small machines, but do not flood the disk on large machines.
+    int num_workers = static_cast<int>( boost::thread::hardware_concurrency() );
+    num_workers = Core::Max( 2, Core::Min( 8, num_workers ) );
+
+    for ( int j = 0; j < num_workers; j++ )
+    {
+      this->workers_.create_thread( boost::bind( &LargeVolumeCachePrivate::run_worker, this ) );
+    }
+  }
+
+  void stop_workers()
+  {
+    {
+      queue_lock_type lock( this->queue_mutex_ );
+      this->done_ = true;
+    }
+    this->queue_condition_.notify_all();
+    this->workers_.join_all();
+  }
+
+  // GET_PRIORITY:
+  /// Priority of a brick that has just been used, pinned bricks are evicted last
+  double get_priority( const CacheEntry& entry ) const
+  {
+    if ( entry.pinned_ ) return std::numeric_limits<double>::infinity();
+    return this->cache_inflation_ + entry.cost_;
   }
 
-  void add_entry(const std::string& brick_name, DataBlockHandle data_block)
+  void add_entry( const std::string& brick_name, DataBlockHandle data_block, double cost, 
+    bool pinned )
   {
     lock_type lock( this->get_mutex() );
 
-    this->cache_access_list_.push_front( brick_name );
-    this->cache_size_ += data_block->get_byte_size();
+    // Another worker may have inserted the same brick in the mean time
+    if ( this->cache_map_.find( brick_name ) != this->cache_map_.end() ) return;
+
+    long long byte_size = static_cast<long long>( data_block->get_byte_size() );
+
+    // Do not let the pinned bricks take up more than half of the cache
+    if ( pinned && 2 * ( this->pinned_size_ + byte_size ) > this->cache_capacity_ ) pinned = false;
 
     CacheEntry entry;
     entry.data_block_ = data_block;
-    entry.access_record_ = this->cache_access_list_.begin();
+    entry.cost_ = cost;
+    entry.pinned_ = pinned;
+    entry.priority_record_ = this->cache_priority_map_.insert( 
+      std::make_pair( this->get_priority( entry ), brick_name ) );
     this->cache_map_[ brick_name ] = entry;
 
+    this->cache_size_ += byte_size;
+    if ( pinned ) this->pinned_size_ += byte_size;
+
     this->constraint_cache_size();
   }
 
   void constraint_cache_size()
   {
-    while (this->cache_size_ > this->cache_capacity_)
+    while ( this->cache_size_ > this->cache_capacity_ && !this->cache_priority_map_.empty() )
     {
-      std::string brick_name = this->cache_access_list_.back();
-      cache_map_type::iterator it = this->cache_map_.find( brick_name );
-      this->cache_size_ -= it->second.data_block_->get_byte_size();
-      this->cache_access_list_.pop_back();
+      cache_priority_map_type::iterator pit = this->cache_priority_map_.begin();
+      if ( pit->first != std::numeric_limits<double>::infinity() )
+      {
+        this->cache_inflation_ = pit->first;
+      }
+
+      cache_map_type::iterator it = this->cache_map_.find( pit->second );
+      long long byte_size = static_cast<long long>( it->second.data_block_->get_byte_size() );
+      this->cache_size_ -= byte_size;
+      if ( it->second.pinned_ ) this->pinned_size_ -= byte_size;
+
+      this->cache_priority_map_.erase( pit );
       this->cache_map_.erase( it );
+      this->evictions_++;
     }
   }
 
@@ -142,9 +273,9 @@ public:
     if (it == this->cache_map_.end()) 
       return false;
 
-    this->cache_access_list_.erase( it->second.access_record_ );
-    this->cache_access_list_.push_front( brick_name );
-    it->second.access_record_ = this->cache_access_list_.begin();
+    this->cache_priority_map_.erase( it->second.priority_record_ );
+    it->second.priority_record_ = this->cache_priority_map_.insert( 
+      std::make_pair( this->get_priority( it->second ), brick_name ) );
     data_block = it->second.data_block_;
 
     return true;
@@ -154,52 +285,106 @@ public:
   {
     lock_type lock( this->get_mutex() );
 
-    this->cache_access_list_.clear();
+    // Report how well the cache did for the data that is being discarded
+    if ( this->hits_ + this->misses_ > 0 )
+    {
+      CORE_LOG_MESSAGE( "Large volume cache: " + ExportToString( this->hits_ ) + " hits, " +
+        ExportToString( this->misses_ ) + " misses, " + ExportToString( this->evictions_ ) +
+        " evictions." );
+    }
+    this->hits_ = 0;
+    this->misses_ = 0;
+    this->evictions_ = 0;
+
+    this->cache_priority_map_.clear();
     this->cache_map_.clear();
     this->cache_size_ = 0;
+    this->pinned_size_ = 0;
+    this->cache_inflation_ = 0.0;
   }
 
-  void load_brick( LargeVolumeSchemaHandle schema, BrickInfo bi, std::string load_key )
+  void load_brick( LargeVolumeSchemaHandle schema, BrickInfo bi, const std::string& load_key, 
+    double distance, bool prefetch )
   {
-    this->jobs_[ load_key ].push( LoadJob( schema, bi ) );
+    {
+      queue_lock_type lock( this->queue_mutex_ );
+      this->jobs_.push( LoadJob( schema, bi, load_key, this->load_key_generation_[ load_key ],
+        distance, prefetch, this->job_sequence_++ ) );
+    }
+    this->queue_condition_.notify_one();
+  }
 
-    this->post_event( boost::bind( &LargeVolumeCachePrivate::process_load_job, this, load_key ) );
+  void clear_load_queue( const std::string& load_key )
+  {
+    queue_lock_type lock( this->queue_mutex_ );
+    this->load_key_generation_[ load_key ]++;
   }
 
-  void process_load_job( std::string load_key )
+  // RUN_WORKER:
+  /// Main loop of each of the loader threads
+  void run_worker()
   {
-    if (! this->jobs_[ load_key ].empty() )
+    while ( true )
     {
-      LoadJob lj = this->jobs_[ load_key ].front();
-      this->jobs_[ load_key ].pop();
+      LargeVolumeSchemaHandle schema;
+      BrickInfo bi( 0, 0 );
+      std::string brick_name;
+
+      {
+        queue_lock_type lock( this->queue_mutex_ );
+        while ( !this->done_ && this->jobs_.empty() )
+        {
+          this->queue_condition_.wait( lock );
+        }
+
+        if ( this->done_ ) return;
+
+        LoadJob lj = this->jobs_.top();
+        this->jobs_.pop();
+
+        // Job was cancelled
+        if ( lj.generation_ != this->load_key_generation_[ lj.load_key_ ] ) continue;
+
+        brick_name = lj.schema_->get_brick_file_name( lj.bi_ ).string();
+
+        // Another worker is already reading this brick
+        if ( this->loading_bricks_.find( brick_name ) != this->loading_bricks_.end() ) continue;
+        this->loading_bricks_.insert( brick_name );
+
+        schema = lj.schema_;
+        bi = lj.bi_;
+      }
 
-      std::string brick_name = lj.schema_->get_brick_file_name( lj.bi_ ).string();
       DataBlockHandle data_block;
-      if (! this->get_entry( brick_name, data_block )) 
+      if (! this->get_entry( brick_name, data_block ) ) 
       {
         std::string error;
-        lj.schema_->read_brick( data_block, lj.bi_, error );
-        this->add_entry( brick_name, data_block );
-        this->instance_->brick_loaded_signal_();
+        if ( schema->read_brick( data_block, bi, error ) )
+        {
+          LargeVolumeCachePolicyHandle policy;
+          {
+            lock_type lock( this->get_mutex() );
+            policy = this->policy_;
+          }
+
+          this->add_entry( brick_name, data_block, policy->get_reload_cost( schema, bi ),
+            policy->is_pinned( schema, bi ) );
+          this->instance_->brick_loaded_signal_();
+        }
       }
-    }
 
-    if (! this->jobs_[ load_key ].empty() )
-    {
-      this->post_event( boost::bind( &LargeVolumeCachePrivate::process_load_job, this, load_key ) );  
+      {
+        queue_lock_type lock( this->queue_mutex_ );
+        this->loading_bricks_.erase( brick_name );
+      }
     }
   }
-
-  void clear_load_queue( std::string load_key )
-  {
-    this->jobs_[ load_key ] = std::queue<LoadJob>();
-  }
 };
 
 LargeVolumeCache::LargeVolumeCache() : private_( new LargeVolumeCachePrivate )
 {
   this->private_->instance_ = this;
-  this->private_->start_eventhandler();
+  this->private_->start_workers();
 }
 
 LargeVolumeCache::~LargeVolumeCache()
@@ -222,10 +407,17 @@ bool LargeVolumeCache::get_brick( LargeVolumeSchemaHandle schema, const BrickInf
 
   if (this->private_->get_entry( brick_name, data_block ))
   {
+    LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+    this->private_->hits_++;
     return true;
   }
 
-  this->private_->post_event( boost::bind( &LargeVolumeCachePrivate::load_brick, this->private_, schema, bi, load_key ) );
+  {
+    LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+    this->private_->misses_++;
+  }
+
+  this->private_->load_brick( schema, bi, load_key, 0.0, false );
 
   return false;
 }
@@ -236,9 +428,94 @@ void LargeVolumeCache::load_brick( LargeVolumeSchemaHandle schema, const BrickIn
   this->get_brick( schema, bi, load_key, data_block ); 
 }
 
+void LargeVolumeCache::load_brick( LargeVolumeSchemaHandle schema, const BrickInfo& bi, 
+  const std::string& load_key, const Point& center )
+{
+  if ( this->mark_brick( schema, bi ) ) return;
+
+  GridTransform trans = schema->get_brick_grid_transform( bi );
+  Point brick_center = trans.project( Point( 0.5 * ( trans.get_nx() - 1 ),
+    0.5 * ( trans.get_ny() - 1 ), 0.5 * ( trans.get_nz() - 1 ) ) );
+  double distance = ( brick_center - center ).length();
+
+  this->private_->load_brick( schema, bi, load_key, distance, false );
+}
+
+void LargeVolumeCache::prefetch_brick( LargeVolumeSchemaHandle schema, const BrickInfo& bi, 
+  const std::string& load_key, const Point& center )
+{
+  // NOTE: Do not use mark_brick here, a prefetch should not keep a brick alive
+  std::string brick_name = schema->get_brick_file_name( bi ).string();
+  {
+    LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+    if ( this->private_->cache_map_.find( brick_name ) != this->private_->cache_map_.end() ) return;
+  }
+
+  GridTransform trans = schema->get_brick_grid_transform( bi );
+  Point brick_center = trans.project( Point( 0.5 * ( trans.get_nx() - 1 ),
+    0.5 * ( trans.get_ny() - 1 ), 0.5 * ( trans.get_nz() - 1 ) ) );
+  double distance = ( brick_center - center ).length();
+
+  this->private_->load_brick( schema, bi, load_key, distance, true );
+}
+
 void LargeVolumeCache::clear_load_queue( const std::string& load_key )
 {
-  this->private_->post_event( boost::bind( &LargeVolumeCachePrivate::clear_load_queue, this->private_, load_key ) );
+  this->private_->clear_load_queue( load_key );
+}
+
+void LargeVolumeCache::set_policy( LargeVolumeCachePolicyHandle policy )
+{
+  LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+  this->private_->policy_ = policy;
+}
+
+LargeVolumeCachePolicyHandle LargeVolumeCache::get_policy() const
+{
+  LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+  return this->private_->policy_;
+}
+
+void LargeVolumeCache::set_capacity( long long capacity )
+{
+  LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+  this->private_->cache_capacity_ = capacity;
+  this->private_->constraint_cache_size();
+}
+
+long long LargeVolumeCache::get_capacity() const
+{
+  LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+  return this->private_->cache_capacity_;
+}
+
+long long LargeVolumeCache::get_default_capacity() const
+{
+  LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+  return this->private_->default_cache_capacity_;
+}
+
+long long LargeVolumeCache::get_size() const
+{
+  LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+  return this->private_->cache_size_;
+}
+
+void LargeVolumeCache::get_statistics( long long& hits, long long& misses, 
+  long long& evictions ) const
+{
+  LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+  hits = this->private_->hits_;
+  misses = this->private_->misses_;
+  evictions = this->private_->evictions_;
+}
+
+void LargeVolumeCache::reset_statistics()
+{
+  LargeVolumeCachePrivate::lock_type lock( this->private_->get_mutex() );
+  this->private_->hits_ = 0;
+  this->private_->misses_ = 0;
+  this->private_->evictions_ = 0;
 }
 
 } // end namespace
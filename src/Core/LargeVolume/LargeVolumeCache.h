@@ -34,6 +34,7 @@
 #include <boost/signals2.hpp>
 
 #include <Core/LargeVolume/LargeVolumeSchema.h>
+#include <Core/LargeVolume/LargeVolumeCachePolicy.h>
 #include <Core/Utils/Singleton.h>
 
 namespace Core
@@ -63,8 +64,54 @@ public:
   void load_brick( LargeVolumeSchemaHandle schema, const BrickInfo& bi, 
     const std::string& load_key );
 
+  /// LOAD_BRICK
+  /// Queue a brick for loading. Bricks are loaded by a pool of workers, coarse levels first
+  /// and then in order of distance between the brick and the given viewport center.
+  void load_brick( LargeVolumeSchemaHandle schema, const BrickInfo& bi, 
+    const std::string& load_key, const Point& center );
+
+  /// PREFETCH_BRICK
+  /// Queue a brick that is likely needed soon. Prefetched bricks are only loaded when no
+  /// bricks that are needed for rendering are waiting.
+  void prefetch_brick( LargeVolumeSchemaHandle schema, const BrickInfo& bi, 
+    const std::string& load_key, const Point& center );
+
+  /// CLEAR_LOAD_QUEUE
+  /// Cancel all the bricks queued for loading under this load key
   void clear_load_queue( const std::string& load_key );
 
+  /// SET_POLICY
+  /// Set the policy that decides which bricks are pinned and how costly they are to reload
+  void set_policy( LargeVolumeCachePolicyHandle policy );
+
+  /// GET_POLICY
+  /// Get the policy that is used by the cache
+  LargeVolumeCachePolicyHandle get_policy() const;
+
+  /// SET_CAPACITY
+  /// Set the number of bytes the cache may use, bricks are evicted if needed
+  void set_capacity( long long capacity );
+
+  /// GET_CAPACITY
+  /// Get the number of bytes the cache may use
+  long long get_capacity() const;
+
+  /// GET_DEFAULT_CAPACITY
+  /// Get the capacity picked at startup from the memory size or the cachegb parameter
+  long long get_default_capacity() const;
+
+  /// GET_SIZE
+  /// Get the number of bytes currently used by the cache
+  long long get_size() const;
+
+  /// GET_STATISTICS
+  /// Get the number of cache hits and misses of get_brick and the number of evicted bricks
+  void get_statistics( long long& hits, long long& misses, long long& evictions ) const;
+
+  /// RESET_STATISTICS
+  /// Reset the hit, miss and eviction counters
+  void reset_statistics();
+
   boost::signals2::signal<void()> brick_loaded_signal_;
 
 private:
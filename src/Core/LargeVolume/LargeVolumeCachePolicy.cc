@@ -0,0 +1,73 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <Core/LargeVolume/LargeVolumeCachePolicy.h>
+
+namespace Core
+{
+
+LargeVolumeCachePolicy::LargeVolumeCachePolicy() :
+  num_pinned_levels_( 2 )
+{
+}
+
+LargeVolumeCachePolicy::~LargeVolumeCachePolicy()
+{
+}
+
+bool LargeVolumeCachePolicy::is_pinned( LargeVolumeSchemaHandle schema, const BrickInfo& bi ) const
+{
+  size_t num_levels = schema->get_num_levels();
+  return static_cast<size_t>( bi.level_ ) + this->num_pinned_levels_ >= num_levels;
+}
+
+double LargeVolumeCachePolicy::get_reload_cost( LargeVolumeSchemaHandle schema, 
+  const BrickInfo& bi ) const
+{
+  // Each level up covers a larger part of the volume and is used as a fallback while the
+  // finer bricks are loaded, hence losing it is more expensive
+  double cost = static_cast<double>( bi.level_ + 1 );
+
+  // Compressed bricks need to be decompressed after reading them, raw bricks are mapped
+  // and usually still in the page cache of the operating system
+  if ( schema->is_compressed() ) cost *= 2.0;
+
+  return cost;
+}
+
+void LargeVolumeCachePolicy::set_num_pinned_levels( size_t num_pinned_levels )
+{
+  this->num_pinned_levels_ = num_pinned_levels;
+}
+
+size_t LargeVolumeCachePolicy::get_num_pinned_levels() const
+{
+  return this->num_pinned_levels_;
+}
+
+} // end namespace Core
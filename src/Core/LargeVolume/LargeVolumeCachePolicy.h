@@ -0,0 +1,84 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_LARGEVOLUME_LARGEVOLUMECACHEPOLICY_H
+#define CORE_LARGEVOLUME_LARGEVOLUMECACHEPOLICY_H
+
+// Boost includes
+#include <boost/shared_ptr.hpp>
+
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+
+namespace Core
+{
+
+class LargeVolumeCachePolicy;
+typedef boost::shared_ptr< LargeVolumeCachePolicy > LargeVolumeCachePolicyHandle;
+
+// CLASS LARGEVOLUMECACHEPOLICY:
+/// Decides which bricks the large volume cache keeps in memory. The cache keeps pinned bricks
+/// until the cache is cleared and evicts the other bricks in order of their reload cost, 
+/// where the cost of a brick decays as it is not used (greedy dual replacement). With a 
+/// constant cost this reduces to least recently used replacement. 
+/// The default policy pins the coarsest levels of the pyramid, which provide the fallback
+/// for all the other bricks, and weights bricks by level and compression.
+class LargeVolumeCachePolicy
+{
+  // -- constructor/destructor --
+public:
+  LargeVolumeCachePolicy();
+  virtual ~LargeVolumeCachePolicy();
+
+  // -- policy --
+public:
+  /// IS_PINNED
+  /// Check whether a brick should be kept in the cache regardless of when it was used last
+  virtual bool is_pinned( LargeVolumeSchemaHandle schema, const BrickInfo& bi ) const;
+
+  /// GET_RELOAD_COST
+  /// Get the relative cost of reloading a brick from disk, bricks with a higher cost stay in
+  /// the cache longer
+  virtual double get_reload_cost( LargeVolumeSchemaHandle schema, const BrickInfo& bi ) const;
+
+  // -- settings --
+public:
+  /// SET_NUM_PINNED_LEVELS
+  /// Set how many of the coarsest levels are pinned
+  void set_num_pinned_levels( size_t num_pinned_levels );
+
+  /// GET_NUM_PINNED_LEVELS
+  /// Get how many of the coarsest levels are pinned
+  size_t get_num_pinned_levels() const;
+
+private:
+  size_t num_pinned_levels_;
+};
+
+} // end namespace Core
+
+#endif
@@ -28,14 +28,18 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <iomanip>
 
+#include <boost/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #include <Core/DataBlock/ITKDataBlock.h>
 #include <Core/DataBlock/ITKImage2DData.h>
 #include <Core/DataBlock/StdDataBlock.h>
 #include <Core/Geometry/IndexVector.h>
 #include <Core/Utils/FileUtil.h>
-#include <Core/Utils/Parallel.h>
+#include <Core/Utils/TaskScheduler.h>
 
 #include <itkPNGImageIO.h>
 #include <itkTIFFImageIO.h>
@@ -109,7 +113,8 @@ void LargeVolumeBrickLevel::allocate_buffers( size_t size )
 template<class T>
 bool LargeVolumeBrickLevel::insert_slice_internals( DataBlockHandle slice )
 {
-  const IndexVector::index_type overlap = static_cast<IndexVector::index_type>( this->schema_->get_overlap() );
+  const IndexVector::index_type overlap_x = this->schema_->get_brick_overlap().x();
+  const IndexVector::index_type overlap_y = this->schema_->get_brick_overlap().y();
   const IndexVector brick_size = this->schema_->get_brick_size();
   const IndexVector eff_brick_size =  this->schema_->get_effective_brick_size();
 
@@ -133,15 +138,15 @@ bool LargeVolumeBrickLevel::insert_slice_internals( DataBlockHandle slice )
         T* data = reinterpret_cast<T*>( buffer->get_data() );
         data += ( nx * ny * this->buffer_index_ );
 
-        IndexVector::index_type sy_begin = by * eff_brick_size.y() - overlap;
-        IndexVector::index_type sy_begin2 = Max( by * eff_brick_size.y() - overlap , static_cast<IndexVector::index_type>( 0 ) );
-        IndexVector::index_type sy_end2 = Min( ( by + 1 ) * eff_brick_size.y() + overlap, sny );
-        IndexVector::index_type sy_end = Min( ( by + 1 ) * eff_brick_size.y() + overlap, sny + overlap ) ;
+        IndexVector::index_type sy_begin = by * eff_brick_size.y() - overlap_y;
+        IndexVector::index_type sy_begin2 = Max( by * eff_brick_size.y() - overlap_y , static_cast<IndexVector::index_type>( 0 ) );
+        IndexVector::index_type sy_end2 = Min( ( by + 1 ) * eff_brick_size.y() + overlap_y, sny );
+        IndexVector::index_type sy_end = Min( ( by + 1 ) * eff_brick_size.y() + overlap_y, sny + overlap_y ) ;
         
-        IndexVector::index_type sx_begin = bx * eff_brick_size.x() - overlap;
-        IndexVector::index_type sx_begin2 = Max(bx * eff_brick_size.x() - overlap, static_cast<IndexVector::index_type>( 0 ) );
-        IndexVector::index_type sx_end2 = Min( ( bx + 1 ) * eff_brick_size.x() + overlap, snx );
-        IndexVector::index_type sx_end = Min( ( bx + 1 ) * eff_brick_size.x() + overlap, snx + overlap );
+        IndexVector::index_type sx_begin = bx * eff_brick_size.x() - overlap_x;
+        IndexVector::index_type sx_begin2 = Max(bx * eff_brick_size.x() - overlap_x, static_cast<IndexVector::index_type>( 0 ) );
+        IndexVector::index_type sx_end2 = Min( ( bx + 1 ) * eff_brick_size.x() + overlap_x, snx );
+        IndexVector::index_type sx_end = Min( ( bx + 1 ) * eff_brick_size.x() + overlap_x, snx + overlap_x );
 
         // Copy brick;
 
@@ -247,7 +252,7 @@ bool LargeVolumeBrickLevel::sync_buffers( bool done, std::string& error )
         
     IndexVector brick_size = this->schema_->get_brick_size();
     IndexVector eff_brick_size = this->schema_->get_effective_brick_size();
-    IndexVector::index_type overlap = this->schema_->get_overlap();
+    IndexVector::index_type overlap = this->schema_->get_brick_overlap().z();
     IndexVector level_size = this->schema_->get_level_size( this->level_ );
 
     for (IndexVector::index_type z = 0; z < this->layout_.z(); z++)
@@ -266,24 +271,20 @@ bool LargeVolumeBrickLevel::sync_buffers( bool done, std::string& error )
       if ( end >= 0 && start < buffer_size && start < end)
       {
 
-        std::cout << "saving buffers level " << this->level_ << ": 000000/000000";
+        // NOTE: All levels are written concurrently, hence only report one line per level
+        std::cout << "saving buffers level " << this->level_ << ": " << this->buffers_.size() 
+          << " bricks" << std::endl;
 
         for (size_t k = 0; k < this->buffers_.size(); k++ )
         {
-          
-
           IndexVector::index_type brick = k + z * (this->layout_.x() * this->layout_.y() );
           BrickInfo bi( brick, this->level_ );
 
-          std::cout << "\b\b\b\b\b\b\b\b\b\b\b\b\b" << std::setfill('0') << std::setw(6) << (k+1) << "/" << std::setfill('0') << std::setw(6) << this->buffers_.size();
-          std::cout.flush();
-
           if (! this->schema_->append_brick_buffer( this->buffers_[ k ], start, end, offset, bi, error ) )
           {
             return false;
           }
         }
-        std::cout << std::endl;
       }
 
     }
@@ -299,11 +300,86 @@ bool LargeVolumeBrickLevel::sync_buffers( bool done, std::string& error )
 
 
 
+class LargeVolumeSliceQueue;
+typedef boost::shared_ptr<LargeVolumeSliceQueue> LargeVolumeSliceQueueHandle;
+
+// CLASS LARGEVOLUMESLICEQUEUE:
+/// Bounded queue that hands slices from one stage of the conversion pipeline to the next.
+/// Slices may be pushed out of order, but are popped in order of their index. A producer 
+/// blocks while its slice is too far ahead of the consumer, which bounds the memory used.
+class LargeVolumeSliceQueue
+{
+public:
+  LargeVolumeSliceQueue( size_t capacity ) :
+    capacity_( capacity ),
+    next_index_( 0 ),
+    aborted_( false )
+  {
+  }
+
+  /// PUSH:
+  /// Add a slice, returns false if the pipeline was aborted
+  bool push( size_t index, DataBlockHandle slice, bool last )
+  {
+    boost::unique_lock<boost::mutex> lock( this->mutex_ );
+    while ( !this->aborted_ && index >= this->next_index_ + this->capacity_ )
+    {
+      this->condition_.wait( lock );
+    }
+    if ( this->aborted_ ) return false;
+
+    this->slices_[ index ] = std::make_pair( slice, last );
+    this->condition_.notify_all();
+    return true;
+  }
+
+  /// POP:
+  /// Get the next slice in order, returns false if the pipeline was aborted
+  bool pop( DataBlockHandle& slice, bool& last )
+  {
+    boost::unique_lock<boost::mutex> lock( this->mutex_ );
+    std::map< size_t, std::pair< DataBlockHandle, bool > >::iterator it;
+    while ( !this->aborted_ && 
+      ( it = this->slices_.find( this->next_index_ ) ) == this->slices_.end() )
+    {
+      this->condition_.wait( lock );
+    }
+    if ( this->aborted_ ) return false;
+
+    slice = it->second.first;
+    last = it->second.second;
+    this->slices_.erase( it );
+    this->next_index_++;
+    this->condition_.notify_all();
+    return true;
+  }
+
+  /// ABORT:
+  /// Wake up all producers and consumers, which will fail from now on
+  void abort()
+  {
+    boost::unique_lock<boost::mutex> lock( this->mutex_ );
+    this->aborted_ = true;
+    this->condition_.notify_all();
+  }
+
+private:
+  size_t capacity_;
+  size_t next_index_;
+  bool aborted_;
+  std::map< size_t, std::pair< DataBlockHandle, bool > > slices_;
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+};
+
 class LargeVolumeConverterPrivate {
 
 public:
   LargeVolumeConverterPrivate() :
-    data_type_( DataType::UNKNOWN_E )
+    data_type_( DataType::UNKNOWN_E ),
+    codec_( BrickCodecType::ZLIB_E ),
+    shuffle_( false ),
+    sharded_( false )
   {}
 
   // -- input parameters --
@@ -320,6 +396,10 @@ public:
   IndexVector brick_size_;
   size_t overlap_;
 
+  BrickCodecType codec_;
+  bool shuffle_;
+  bool sharded_;
+
   long long mem_limit_;
 
   LargeVolumeSchemaHandle schema_;
@@ -376,21 +456,53 @@ public:
   bool compute_min_max( DataBlockHandle slice, double& min, double& max );
 
 
-    // -- slice processor --
+    // -- slice pipeline --
 public:
-    bool process_slice( size_t level, std::string& error );
-    
+  /// BRICK_SLICE
+  /// Insert a slice into the brick buffers of a level and write the buffers when full
+  bool brick_slice( size_t level, DataBlockHandle slice, bool first_slice, bool last_slice,
+    std::string& error );
+
+  /// RUN_DECODER
+  /// Decoder thread, reads files from the stack and passes them on to the first level
+  void run_decoder();
 
-    // slices at different resolution levels
-    std::vector<DataBlockHandle> slices_;
+  /// RUN_LEVEL
+  /// Level thread, bricks the slices of one level and downsamples them for the next level
+  void run_level( size_t level );
 
-    std::vector<IndexVector::index_type> index_;
+  /// ABORT_PIPELINE
+  /// Record an error and stop all the stages of the pipeline
+  void abort_pipeline( const std::string& error );
+
+  // Input queue of each level, the decoders feed the queue of level 0
+  std::vector<LargeVolumeSliceQueueHandle> queues_;
   std::vector<LargeVolumeBrickLevelHandle> brick_level_;
 
-  void run_phase3_parallel( int num_threads, int thread_num, boost::barrier& barrier  );
+  // Next file to be read by the decoders
+  size_t next_file_;
+  boost::mutex file_mutex_;
+
+  // Min and max of the data, computed by the thread of level 0
+  double min_;
+  double max_;
+
+  // First error encountered in the pipeline
+  std::string pipeline_error_;
+  boost::mutex error_mutex_;
+
+  /// REPROCESS_BRICKS
+  /// Compress the bricks in the range [brick_begin, brick_end) of a level, cancels the group
+  /// when a brick fails
+  void reprocess_bricks( TaskGroup* group, size_t level, size_t brick_begin, size_t brick_end );
 
   bool success_;
 
+  // Number of bricks of the current level and the number that have been compressed
+  size_t num_bricks_;
+  size_t num_bricks_done_;
+  boost::mutex progress_mutex_;
+
 };
 
 template<class T>
@@ -439,110 +551,164 @@ bool LargeVolumeConverterPrivate::compute_min_max( DataBlockHandle slice, double
   return false;
 }
 
-bool LargeVolumeConverterPrivate::process_slice( size_t level, std::string& error )
+bool LargeVolumeConverterPrivate::brick_slice( size_t level, DataBlockHandle slice, 
+  bool first_slice, bool last_slice, std::string& error )
 {
-  bool last_slice = ( this->files_.size() - 1 ) == this->index_[ 0 ];
-  bool first_slice = ( this->index_[ level ] == 0);
+  LargeVolumeBrickLevelHandle brick_level = this->brick_level_[ level ];
+  size_t overlap = static_cast<size_t>( this->schema_->get_brick_overlap().z() );
 
-    DataBlockHandle slice = slices_[ level ];
-    
-    // Brick the data
-    if ( first_slice )
+  DataBlockHandle empty;
+  if ( ( first_slice || last_slice ) && overlap > 0 )
   {
-    DataBlockHandle empty = Core::StdDataBlock::New( this->slices_[ level ]->get_nx(),
-      this->slices_[ level ]->get_ny(), this->slices_[ level ]->get_nz(),
-      this->slices_[ level ]->get_data_type() );
+    empty = Core::StdDataBlock::New( slice->get_nx(), slice->get_ny(), slice->get_nz(),
+      slice->get_data_type() );
     empty->clear();
+  }
 
-    size_t overlap = this->schema_->get_overlap();
+  if ( first_slice )
+  {
     for (size_t k = 0; k < overlap; k++ )
     {
-      this->brick_level_[ level ]->insert_slice( empty );
-      this->brick_level_[ level ]->sync_buffers( false, error );
+      brick_level->insert_slice( empty );
+      if (! brick_level->sync_buffers( false, error ) ) return false;
     }
   }
 
-  this->brick_level_[ level ]->insert_slice( this->slices_[ level ] );
+  brick_level->insert_slice( slice );
 
-    if ( last_slice )
+  if ( last_slice )
   {
-    DataBlockHandle empty = Core::StdDataBlock::New( this->slices_[ level ]->get_nx(),
-      this->slices_[ level ]->get_ny(), this->slices_[ level ]->get_nz(),
-      this->slices_[ level ]->get_data_type() );
-    empty->clear();
-
-    size_t overlap = this->schema_->get_overlap();
     for (size_t k = 0; k < overlap; k++ )
     {
-      this->brick_level_[ level ]->sync_buffers( false, error );
-      this->brick_level_[ level ]->insert_slice( empty );
+      if (! brick_level->sync_buffers( false, error ) ) return false;
+      brick_level->insert_slice( empty );
     }
 
-    this->brick_level_[ level ]->sync_buffers( true, error );
+    return brick_level->sync_buffers( true, error );
   }
-  else
+
+  return brick_level->sync_buffers( false, error );
+}
+
+void LargeVolumeConverterPrivate::abort_pipeline( const std::string& error )
+{
   {
-    this->brick_level_[ level ]->sync_buffers( false, error );
+    boost::mutex::scoped_lock lock( this->error_mutex_ );
+    if ( this->success_ ) this->pipeline_error_ = error;
+    this->success_ = false;
   }
-    
-    // Down sample data for next level
-    if ( level < this->schema_->get_num_levels() - 1 )
+
+  for ( size_t j = 0; j < this->queues_.size(); j++ )
+  {
+    this->queues_[ j ]->abort();
+  }
+}
+
+void LargeVolumeConverterPrivate::run_decoder()
+{
+  const size_t num_files = this->files_.size();
+  IndexVector total_size = this->schema_->get_size();
+
+  while ( true )
+  {
+    size_t slice_idx;
     {
-        IndexVector input_ratio = this->schema_->get_level_downsample_ratio( level );
-        IndexVector output_ratio = this->schema_->get_level_downsample_ratio( level + 1);
-        
-        if ( output_ratio.z() / input_ratio.z() == 2 )
-        {
-            if ( index_[ level ] % 2 )
-            {
-                if (! this->downsample_add( slices_[ level ], slices_[ level + 1 ], input_ratio, output_ratio ) )
-                {
-                    error = "Failed to downsample slice.";
-                    return false;
-                }
-                if (! this->process_slice( level + 1, error ) )
-                {
-                    return false;
-                }
-            }
-            else
-            {
-                if (! this->downsample( slices_[ level ], slices_[ level + 1 ], input_ratio, output_ratio ) )
-                {
-                    error = "Failed to downsample slice.";
-                    return false;
-                }
+      boost::mutex::scoped_lock lock( this->file_mutex_ );
+      if ( this->next_file_ >= num_files ) return;
+      slice_idx = this->next_file_++;
+    }
+
+    // indicate which slice is being processed
+    std::cout << "Processing file: " << this->files_[ slice_idx ].string() << std::endl;
+
+    std::string error;
+    DataBlockHandle slice = this->load_file( this->files_[ slice_idx ], error );
+    if (! slice )
+    {
+      this->abort_pipeline( error );
+      return;
+    }
+
+    if ( slice->get_nx() != total_size.x() || slice->get_ny() != total_size.y() )
+    {
+      std::cout << "WARNING: Dimensions of the slices are not equal, clipping/padding image to fit dimensions of first image." <<std::endl;
+      DataBlock::Clip( slice, slice, total_size.x(), total_size.y(), 1, 0.0 );
+    } 
+
+    if (! this->queues_[ 0 ]->push( slice_idx, slice, slice_idx == num_files - 1 ) ) return;
+  }
+}
+
+void LargeVolumeConverterPrivate::run_level( size_t level )
+{
+  std::string error;
+  const bool has_next_level = level + 1 < this->schema_->get_num_levels();
+
+  IndexVector input_ratio = this->schema_->get_level_downsample_ratio( level );
+  IndexVector output_ratio = has_next_level ? 
+    this->schema_->get_level_downsample_ratio( level + 1 ) : input_ratio;
+  IndexVector next_level_size = has_next_level ? 
+    this->schema_->get_level_size( level + 1 ) : IndexVector( 0, 0, 0 );
+  const bool merge_slices = output_ratio.z() / input_ratio.z() == 2;
+
+  // Downsampled slice that is being accumulated for the next level
+  DataBlockHandle next_slice;
+  size_t next_index = 0;
+
+  for ( size_t index = 0; ; index++ )
+  {
+    DataBlockHandle slice;
+    bool last_slice;
+    if (! this->queues_[ level ]->pop( slice, last_slice ) ) return;
+
+    if ( level == 0 && !this->compute_min_max( slice, this->min_, this->max_ ) )
+    {
+      this->abort_pipeline( "Could not compute min and max." );
+      return;
+    }
+
+    if (! this->brick_slice( level, slice, index == 0, last_slice, error ) )
+    {
+      this->abort_pipeline( error );
+      return;
+    }
 
-        if ( last_slice )
+    if ( has_next_level )
+    {
+      bool ready = true;
+      if ( merge_slices && ( index % 2 ) )
+      {
+        if (! this->downsample_add( slice, next_slice, input_ratio, output_ratio ) )
         {
-          if (! this->process_slice( level + 1, error ) )
-          {
-            return false;
-          }       
-        }
-            }
+          this->abort_pipeline( "Failed to downsample slice." );
+          return;
         }
-        else
+      }
+      else
+      {
+        next_slice = StdDataBlock::New( next_level_size.x(), next_level_size.y(), 1, 
+          this->schema_->get_data_type() );
+        if (! next_slice || 
+          ! this->downsample( slice, next_slice, input_ratio, output_ratio ) )
         {
-            if (! this->downsample( slices_[ level ], slices_[ level + 1 ], input_ratio, output_ratio ) )
-            {
-                error = "Failed to downsample slice.";
-                return false;
-            }
-            
-            if (! this->process_slice( level + 1, error ) )
-            {
-                return false;
-            }
+          this->abort_pipeline( "Failed to downsample slice." );
+          return;
         }
-        
-    }
 
-  index_[ level ]++;
+        // Even slices wait for the odd slice that is merged into them
+        ready = !merge_slices || last_slice;
+      }
 
-  return true;
-}
+      if ( ready )
+      {
+        if (! this->queues_[ level + 1 ]->push( next_index++, next_slice, last_slice ) ) return;
+        next_slice.reset();
+      }
+    }
 
+    if ( last_slice ) return;
+  }
+}
 
 template<class T>
 DataBlockHandle LargeVolumeConverterPrivate::load_file_internals( const boost::filesystem::path& filename, std::string& error )
@@ -968,6 +1134,17 @@ void LargeVolumeConverter::set_schema_parameters( const Vector& spacing, const P
   this->private_->overlap_ = overlap;
 }
 
+void LargeVolumeConverter::set_codec( BrickCodecType codec, bool shuffle )
+{
+  this->private_->codec_ = codec;
+  this->private_->shuffle_ = shuffle;
+}
+
+void LargeVolumeConverter::set_sharded( bool sharded )
+{
+  this->private_->sharded_ = sharded;
+}
+
 bool LargeVolumeConverter::run_phase1( std::string& error )
 {
   error = "";
@@ -990,7 +1167,9 @@ bool LargeVolumeConverter::run_phase1( std::string& error )
   this->private_->schema_->set_parameters( this->private_->data_size_, this->private_->spacing_,
     this->private_->origin_, this->private_->brick_size_, this->private_->overlap_, this->private_->data_type_ );
 
-  this->private_->schema_->set_compression( true );
+  this->private_->schema_->set_codec( this->private_->codec_ );
+  this->private_->schema_->set_shuffle( this->private_->shuffle_ );
+  this->private_->schema_->set_sharded( this->private_->sharded_ );
   this->private_->schema_->compute_levels();
 
   return true;
@@ -1038,25 +1217,43 @@ bool LargeVolumeConverter::run_phase2( std::string& error )
     return false;
   }
 
-    // Initialize parameters for each level
-    this->private_->slices_.resize( num_levels );
-    this->private_->index_.resize( num_levels, 0 );
-  
-  this->private_->brick_level_.resize( num_levels );
+  // Slices that are waiting in the queue of each level
+  const size_t queue_depth = 2;
+
+  // Use a few decoders to read files ahead, as decoding compressed images is often the
+  // bottleneck. Each decoder holds one full resolution slice while waiting for the queue.
+  size_t level0_slice_size = this->private_->schema_->get_level_size( 0 ).x() * 
+    this->private_->schema_->get_level_size( 0 ).y() * element_size;
+  size_t num_decoders = Max( 1, Min( 8, static_cast<int>( boost::thread::hardware_concurrency() ) -
+    static_cast<int>( num_levels ) ) );
+
+  // Each level holds its input queue, the slice that is being processed and the slice that
+  // is being downsampled for the next level
+  slice_buffer_size *= ( queue_depth + 2 );
+  while ( num_decoders > 1 && 
+    slice_buffer_size + num_decoders * level0_slice_size > this->private_->mem_limit_ / 2 )
+  {
+    num_decoders--;
+  }
+  slice_buffer_size += num_decoders * level0_slice_size;
 
-    // Allocate resample buffers
+  if ( slice_buffer_size > this->private_->mem_limit_ )
+  {
+    error = "Please allocate more memory to conversion process.";
+    return false;
+  }
+
+    // Initialize the pipeline for each level
+  this->private_->brick_level_.resize( num_levels );
+  this->private_->queues_.resize( num_levels );
 
   size_t num_buffers = 0;
 
     for ( size_t j = 0; j < num_levels; j++ )
     {
-        IndexVector level_size = this->private_->schema_->get_level_size( j );
-        size_t slice_size = level_size.x() * level_size.y();
-        if ( j > 0 )
-    {
-        // NOTE: The first one will always be allocated by ITK
-      this->private_->slices_[ j ] = StdDataBlock::New( level_size.x(), level_size.y(), 1, this->private_->schema_->get_data_type() );
-    }
+    // The queue of the first level is filled out of order by the decoders
+    size_t capacity = ( j == 0 ) ? queue_depth + num_decoders : queue_depth;
+    this->private_->queues_[ j ] = LargeVolumeSliceQueueHandle( new LargeVolumeSliceQueue( capacity ) );
     this->private_->brick_level_[ j ] = LargeVolumeBrickLevelHandle( new LargeVolumeBrickLevel( this->private_->schema_, j ) ) ;
 
     num_buffers += this->private_->brick_level_[ j ]->get_num_buffers();
@@ -1076,47 +1273,37 @@ bool LargeVolumeConverter::run_phase2( std::string& error )
     this->private_->brick_level_[ j ]->allocate_buffers( buffer_size );
   }
 
-    // Main loading loop
-    size_t num_files = this->private_->files_.size();
-    double min = std::numeric_limits<double>::max();
-  double max = std::numeric_limits<double>::min();
-
-  IndexVector total_size = this->private_->schema_->get_size();
-
-    for ( IndexVector::index_type slice_idx = 0; slice_idx < num_files; slice_idx++)
-    {
+  // Main loading pipeline: decoders -> level 0 -> level 1 -> ... each stage in its own thread
+  this->private_->next_file_ = 0;
+  this->private_->min_ = std::numeric_limits<double>::max();
+  this->private_->max_ = std::numeric_limits<double>::min();
+  this->private_->success_ = true;
+  this->private_->pipeline_error_ = "";
 
-        // indicate which slice is being processed
-        std::cout << "Processing file: " << this->private_->files_[ slice_idx ].string() << std::endl;
-    
-        // load slice
-        this->private_->slices_[ 0 ] = this->private_->load_file( this->private_->files_[ slice_idx ], error );
-    
-    if (! this->private_->slices_[ 0 ] ) 
-    {
-      return false;
-    }
+  // The stages wait for each other on the queues, hence they run as a gang
+  std::vector< boost::function< void () > > stages;
+  for ( size_t j = 0; j < num_levels; j++ )
+  {
+    stages.push_back( boost::bind( &LargeVolumeConverterPrivate::run_level, 
+      this->private_, j ) );
+  }
+  for ( size_t j = 0; j < num_decoders; j++ )
+  {
+    stages.push_back( boost::bind( &LargeVolumeConverterPrivate::run_decoder, 
+      this->private_ ) );
+  }
+  TaskScheduler::Instance()->run_gang( stages );
 
-    if ( this->private_->slices_[ 0 ]->get_nx() != total_size.x() ||  this->private_->slices_[ 0 ]->get_ny() != total_size.y() )
-    {
-      std::cout << "WARNING: Dimensions of the slices are not equal, clipping/padding image to fit dimensions of first image." <<std::endl;
-      DataBlock::Clip( this->private_->slices_[ 0 ], this->private_->slices_[ 0 ], total_size.x(), total_size.y(), 1, 0.0 );
-    } 
-  
-    
-    if (! this->private_->compute_min_max( this->private_->slices_[ 0 ], min, max ) )
-    {
-      error = "Could not compute min and max.";
-      return false;
-    }
+  this->private_->queues_.clear();
+  this->private_->brick_level_.clear();
 
-    this->private_->schema_->set_min_max( min, max );
+  if ( !this->private_->success_ )
+  {
+    error = this->private_->pipeline_error_;
+    return false;
+  }
 
-        if (! this->private_->process_slice( 0, error ) )
-        {
-            return false;
-        }
-    }
+  this->private_->schema_->set_min_max( this->private_->min_, this->private_->max_ );
 
   // Save schema file to update min and max
   if (! this->private_->schema_->save( error ) )
@@ -1124,61 +1311,33 @@ bool LargeVolumeConverter::run_phase2( std::string& error )
     return false;
   }
 
-  this->private_->slices_.clear();
-  this->private_->brick_level_.clear();
-  this->private_->index_.clear();
-
-
   return true;
 }
 
-void LargeVolumeConverterPrivate::run_phase3_parallel( int thread_num, int num_threads, boost::barrier& barrier )
+void LargeVolumeConverterPrivate::reprocess_bricks( TaskGroup* group, size_t level, 
+  size_t brick_begin, size_t brick_end )
 {
   std::string error;
 
-  size_t num_levels = this->schema_->get_num_levels();
-
-    for ( size_t j = 0; j < num_levels; j ++ )
-    {
-    if ( thread_num == 0 )
-    {
-      std::cout << "processing level: " << ExportToString( j ) << std::endl; 
-    }
+  for ( size_t k = brick_begin; k < brick_end; k++ )
+  {
+    if ( group->is_canceled() ) return;
 
-        IndexVector layout = this->schema_->get_level_layout( j );
-        IndexVector::index_type num_bricks = layout[0] * layout[1] * layout[2];
-        
-    if ( thread_num == 0 )
+    BrickInfo bi( k, level );
+    if ( !this->schema_->reprocess_brick( bi, error ) )
     {
-      std::cout << "processing brick: 000000/000000";
+      std::cerr << error << std::endl;
+      group->cancel();
+      return;
     }
 
-        for ( size_t k = thread_num;  k < num_bricks; k += num_threads )
-        {
-      if ( thread_num == 0 )
-      {
-        std::cout << "\b\b\b\b\b\b\b\b\b\b\b\b\b" << std::setfill('0') << std::setw(6) << (k+1) << "/" << std::setfill('0') << std::setw(6) << num_bricks;
-        std::cout.flush();
-      }
-      
-      BrickInfo bi( k ,j );
-            if (! this->schema_->reprocess_brick( bi, error) )
-      {
-                std::cerr << error << std::endl;
-                this->success_ = false;
-        break;
-      }
-        }
-    barrier.wait();
-
-    if ( thread_num == 0 )
-    {
-      std::cout << "\b\b\b\b\b\b\b\b\b\b\b\b\b" << std::setfill('0') << std::setw(6) << num_bricks << "/" << std::setfill('0') << std::setw(6) << num_bricks;
-      std::cout << std::endl;
-            
-    }
+    boost::mutex::scoped_lock lock( this->progress_mutex_ );
+    this->num_bricks_done_++;
+    std::cout << "\b\b\b\b\b\b\b\b\b\b\b\b\b" << std::setfill('0') << std::setw(6) << 
+      this->num_bricks_done_ << "/" << std::setfill('0') << std::setw(6) << 
+      this->num_bricks_;
+    std::cout.flush();
   }
-
 }
 
 bool LargeVolumeConverter::run_phase3( std::string& error )
@@ -1186,15 +1345,48 @@ bool LargeVolumeConverter::run_phase3( std::string& error )
   error = "";
   this->private_->success_ = true;
 
-  Parallel parallel( boost::bind( &LargeVolumeConverterPrivate::run_phase3_parallel, this->private_, _1, _2, _3 ) );
+  size_t num_levels = this->private_->schema_->get_num_levels();
+
+  for ( size_t j = 0; j < num_levels; j++ )
+  {
+    std::cout << "processing level: " << ExportToString( j ) << std::endl; 
+
+    IndexVector layout = this->private_->schema_->get_level_layout( j );
+    IndexVector::index_type num_bricks = layout[0] * layout[1] * layout[2];
+
+    // Start the shard of the level from scratch, so that a rerun does not append to the
+    // bricks of a previous conversion
+    if ( this->private_->schema_->is_sharded() && 
+      !this->private_->schema_->clear_shard( j, error ) )
+    {
+      return false;
+    }
 
-  parallel.run();
-    if ( !this->private_->success_ )
+    std::cout << "processing brick: 000000/000000";
+    this->private_->num_bricks_ = static_cast< size_t >( num_bricks );
+    this->private_->num_bricks_done_ = 0;
+
+    // Bricks take very different amounts of time to compress, hence the bricks are
+    // handed out one at a time
+    TaskGroup group;
+    ParallelFor( group, 0, static_cast< size_t >( num_bricks ), boost::bind( 
+      &LargeVolumeConverterPrivate::reprocess_bricks, this->private_, &group, j, _1, _2 ), 1 );
+    std::cout << std::endl;
+
+    if ( group.is_canceled() )
     {
-        error = "Could not compress bricks.";
+      error = "Could not compress bricks.";
+      return false;
     }
+  }
+
+  // Save schema file to write the offset index of the shards
+  if ( this->private_->schema_->is_sharded() && !this->private_->schema_->save( error ) )
+  {
+    return false;
+  }
 
-  return this->private_->success_;
+  return true;
 }
 
 
@@ -77,6 +77,14 @@ public:
   /// Upload parameters for schema
   void set_schema_parameters( const Vector& spacing, const Point& origin, const IndexVector& brick_size, size_t overlap );
 
+  /// SET_CODEC
+  /// Set the codec used for compressing the bricks and whether the bytes are shuffled first
+  void set_codec( BrickCodecType codec, bool shuffle );
+
+  /// SET_SHARDED
+  /// Set whether the bricks of each level are written into a single shard file
+  void set_sharded( bool sharded );
+
   /// RUN_PHASE1
   /// Check files and determine size
   bool run_phase1( std::string& error );
@@ -86,7 +94,8 @@ public:
   void set_mem_limit( long long mem_limit );
 
   /// RUN_PHASE2
-  /// Downsample and build bricks
+  /// Downsample and build bricks, the files are decoded and each level is processed by its
+  /// own thread
   bool run_phase2( std::string& error );
 
     /// RUN_PHASE3
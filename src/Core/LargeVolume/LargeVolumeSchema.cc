@@ -26,8 +26,6 @@
  DEALINGS IN THE SOFTWARE.
  */
 
-#include <zlib.h>
-
 #include <limits>
 #include <fstream>
 #include <set>
@@ -37,10 +35,14 @@
 #include <iostream>
 // test
 
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <Core/Utils/FilesystemUtil.h>
 #include <Core/Utils/StringUtil.h>
 #include <Core/Math/MathFunctions.h>
 #include <Core/DataBlock/StdDataBlock.h>
+#include <Core/DataBlock/MappedDataBlock.h>
 
 #include <Core/LargeVolume/LargeVolumeSchema.h>
 #include <Core/LargeVolume/LargeVolumeCache.h>
@@ -50,18 +52,6 @@ namespace bfs=boost::filesystem;
 namespace Core
 {
 
-#ifdef Z_PREFIX
-  #define zlib_uLongf z_uLongf
-  #define zlib_Bytef z_Bytef
-  #define zlib_uncompress z_uncompress
-  #define zlib_compress2 z_compress2
-#else
-  #define zlib_uLongf uLongf
-  #define zlib_Bytef Bytef
-  #define zlib_uncompress uncompress
-  #define zlib_compress2 compress2
-#endif
-
 class LargeVolumeSchemaPrivate {
 
 public:
@@ -74,8 +64,11 @@ public:
     brick_size_( 256, 256, 256 ),
     effective_brick_size_( 256, 256, 256 ),
     overlap_(0),
+    brick_overlap_( 0, 0, 0 ),
     data_type_(DataType::UNKNOWN_E),
-    compression_(false),
+    codec_(BrickCodecType::NONE_E),
+    shuffle_(false),
+    sharded_(false),
     little_endian_(DataBlock::IsLittleEndian()),
     downsample_x_( true ),
     downsample_y_( true ),
@@ -85,6 +78,18 @@ public:
   {
   }
 
+  // Bricks that are one voxel thick along an axis, as used for volumes that are a single slice
+  // thick, have no overlap along that axis
+  void update_effective_brick_size()
+  {
+    const index_type overlap = static_cast< index_type >( this->overlap_ );
+    for ( size_t j = 0; j < 3; j++ )
+    {
+      this->brick_overlap_[ j ] = this->brick_size_[ j ] == 1 ? 0 : overlap;
+      this->effective_brick_size_[ j ] = this->brick_size_[ j ] - 2 * this->brick_overlap_[ j ];
+    }
+  }
+
   IndexVector compute_brick_layout( const IndexVector& size ) const
   {
     const IndexVector& effective_brick_size = this->effective_brick_size_;
@@ -132,12 +137,12 @@ public:
   {
     const IndexVector& layout = this->level_layout_[ bi.level_ ];
     const IndexVector& size = this->level_size_[ bi.level_ ];
-    const size_t overlap = this->overlap_;
+    const IndexVector& overlap = this->brick_overlap_;
     IndexVector remainder_brick_size = this->brick_size_;
     
-    if ( index.x() == layout.x() - 1 ) remainder_brick_size.x( size.x() - ( this->effective_brick_size_.x() * index.x()) + 2 * overlap );
-    if ( index.y() == layout.y() - 1 ) remainder_brick_size.y( size.y() - ( this->effective_brick_size_.y() * index.y()) + 2 * overlap );
-    if ( index.z() == layout.z() - 1 ) remainder_brick_size.z( size.z() - ( this->effective_brick_size_.z() * index.z()) + 2 * overlap );
+    if ( index.x() == layout.x() - 1 ) remainder_brick_size.x( size.x() - ( this->effective_brick_size_.x() * index.x()) + 2 * overlap.x() );
+    if ( index.y() == layout.y() - 1 ) remainder_brick_size.y( size.y() - ( this->effective_brick_size_.y() * index.y()) + 2 * overlap.y() );
+    if ( index.z() == layout.z() - 1 ) remainder_brick_size.z( size.z() - ( this->effective_brick_size_.z() * index.z()) + 2 * overlap.z() );
     return remainder_brick_size;
   }
 
@@ -149,6 +154,16 @@ public:
     return this->dir_ / filename;
   }
 
+  bfs::path get_shard_file_name( index_type level )
+  {
+    return this->dir_ / ( std::string() + static_cast<char>( 65 + static_cast<int>( level ) ) + ".shard" );
+  }
+
+  bfs::path get_shard_index_file_name( index_type level )
+  {
+    return this->dir_ / ( std::string() + static_cast<char>( 65 + static_cast<int>( level ) ) + ".index" );
+  }
+
 
   void compute_cached_level_info() 
   {
@@ -180,8 +195,35 @@ public:
                      const IndexVector& clip_start,
                      const IndexVector& clip_end );
 
+  // READ_BRICK_FILE:
+  /// Read a brick from its own brick file, uncompressed bricks are memory mapped if allowed
+  bool read_brick_file( DataBlockHandle& data_block, const BrickInfo& bi, bool allow_mapping,
+    std::string& error );
+
+  // READ_BRICK_SHARD:
+  /// Read a brick from the shard file of its level
+  bool read_brick_shard( DataBlockHandle& data_block, const BrickInfo& bi, std::string& error );
+
+  // READ_BRICK_DATA:
+  /// Read a brick that is stored at an offset in a file, stored_size is the number of bytes
+  /// on disk, if this is less than the size of the brick the data is compressed
+  bool read_brick_data( DataBlockHandle& data_block, const BrickInfo& bi, const bfs::path& file,
+    size_t offset, size_t stored_size, bool allow_mapping, std::string& error );
+
+  // APPEND_TO_SHARD:
+  /// Append the data of a brick to the shard file of its level and record it in the index
+  bool append_to_shard( const BrickInfo& bi, const char* data, size_t size, std::string& error );
+
+  // LOAD_SHARD_INDEX:
+  /// Load the offset index of the shard of a level
+  bool load_shard_index( index_type level, std::string& error );
+
+  // SAVE_SHARD_INDEX:
+  /// Save the offset index of the shard of a level
+  bool save_shard_index( index_type level, std::string& error );
+
   void load_and_substitue_missing_bricks( std::vector<BrickInfo>& want_to_render, SliceType slice, 
-    double depth, const std::string& load_key, std::vector<BrickInfo>& current_render );
+    double depth, const Point& center, const std::string& load_key, std::vector<BrickInfo>& current_render );
 
   // -- contents in the text header --
 public:
@@ -193,10 +235,14 @@ public:
   IndexVector brick_size_;
   IndexVector effective_brick_size_;
   size_t overlap_;
+  // Overlap along each axis, derived from overlap_ and brick_size_
+  IndexVector brick_overlap_;
 
   DataType data_type_;
 
-  bool compression_;
+  BrickCodecType codec_;
+  bool shuffle_;
+  bool sharded_;
   bool little_endian_;
 
   bool downsample_x_;
@@ -213,6 +259,23 @@ public:
   
   bfs::path dir_;
   LargeVolumeSchema* schema_;
+
+  // -- shard container --
+public:
+  // Location of a brick inside a shard file, a size of zero indicates a missing brick
+  struct ShardEntry
+  {
+    ShardEntry() : offset_( 0 ), size_( 0 ) {}
+
+    boost::uint64_t offset_;
+    boost::uint64_t size_;
+  };
+
+  // Offset index of the shard of each level
+  std::vector< std::vector< ShardEntry > > shard_index_;
+
+  // Protects appending to the shards and the shard index
+  boost::mutex shard_mutex_;
 };
 
 template<class T>
@@ -222,20 +285,20 @@ bool LargeVolumeSchemaPrivate::insert_brick_internals( DataBlockHandle volume, D
                                                        const IndexVector& clip_end )
 {
   // TODO: too much repeated code
-  const IndexVector::index_type overlap = static_cast<IndexVector::index_type>( this->overlap_ );
+  const IndexVector& overlap = this->brick_overlap_;
 
   const IndexVector::index_type bnx = static_cast<IndexVector::index_type>( brick->get_nx() );
   const IndexVector::index_type bny = static_cast<IndexVector::index_type>( brick->get_ny() );
   const IndexVector::index_type bnz = static_cast<IndexVector::index_type>( brick->get_nz() );
   const IndexVector::index_type bnxy = bnx * bny;
 
-  const IndexVector::index_type bxstart = overlap + clip_start.x();
-  const IndexVector::index_type bystart = overlap + clip_start.y();
-  const IndexVector::index_type bzstart = overlap + clip_start.z();
+  const IndexVector::index_type bxstart = overlap.x() + clip_start.x();
+  const IndexVector::index_type bystart = overlap.y() + clip_start.y();
+  const IndexVector::index_type bzstart = overlap.z() + clip_start.z();
 
-  const IndexVector::index_type bxend = overlap + clip_end.x();
-  const IndexVector::index_type byend = overlap + clip_end.y();
-  const IndexVector::index_type bzend = overlap + clip_end.z();
+  const IndexVector::index_type bxend = overlap.x() + clip_end.x();
+  const IndexVector::index_type byend = overlap.y() + clip_end.y();
+  const IndexVector::index_type bzend = overlap.z() + clip_end.z();
 
   const IndexVector::index_type bxstride = ( bnx - ( bxend - bxstart ) );
   const IndexVector::index_type bystride = ( bny - ( byend - bystart ) ) * bnx;
@@ -274,20 +337,20 @@ bool LargeVolumeSchemaPrivate::insert_brick_internals( DataBlockHandle volume, D
                                                        const IndexVector& offset )
 {
   // TODO: too much repeated code
-  const IndexVector::index_type overlap = static_cast<IndexVector::index_type>( this->overlap_ );
+  const IndexVector& overlap = this->brick_overlap_;
 
   const IndexVector::index_type bnx = static_cast<IndexVector::index_type>( brick->get_nx() );
   const IndexVector::index_type bny = static_cast<IndexVector::index_type>( brick->get_ny() );
   const IndexVector::index_type bnz = static_cast<IndexVector::index_type>( brick->get_nz() );
   const IndexVector::index_type bnxy = bnx * bny;
 
-  const IndexVector::index_type bxstart = overlap;
-  const IndexVector::index_type bystart = overlap;
-  const IndexVector::index_type bzstart = overlap;
+  const IndexVector::index_type bxstart = overlap.x();
+  const IndexVector::index_type bystart = overlap.y();
+  const IndexVector::index_type bzstart = overlap.z();
   
-  const IndexVector::index_type bxend = bnx - overlap;
-  const IndexVector::index_type byend = bny - overlap;
-  const IndexVector::index_type bzend = bnz - overlap;
+  const IndexVector::index_type bxend = bnx - overlap.x();
+  const IndexVector::index_type byend = bny - overlap.y();
+  const IndexVector::index_type bzend = bnz - overlap.z();
 
   const IndexVector::index_type bxstride = ( bnx - ( bxend - bxstart ) );
   const IndexVector::index_type bystride = ( bny - ( byend - bystart ) ) * bnx;
@@ -297,8 +360,8 @@ bool LargeVolumeSchemaPrivate::insert_brick_internals( DataBlockHandle volume, D
   const IndexVector::index_type vnz = static_cast<IndexVector::index_type>( volume->get_nz() );
   const IndexVector::index_type vnxy = vnx * vny;
 
-  const IndexVector::index_type vxstride = vnx - ( bnx - 2 * overlap );
-  const IndexVector::index_type vystride = ( vny - ( bny - 2 * overlap ) ) * vnx;
+  const IndexVector::index_type vxstride = vnx - ( bnx - 2 * overlap.x() );
+  const IndexVector::index_type vystride = ( vny - ( bny - 2 * overlap.y() ) ) * vnx;
   
   // same code from here to return
   T* src = reinterpret_cast<T*>( brick->get_data() );
@@ -432,9 +495,7 @@ bool LargeVolumeSchema::load( std::string& error)
       return false;
     }
 
-    this->private_->effective_brick_size_.x( this->private_->brick_size_.x() -  2 * this->private_->overlap_ );
-    this->private_->effective_brick_size_.y( this->private_->brick_size_.y() -  2 * this->private_->overlap_ );
-    this->private_->effective_brick_size_.z( this->private_->brick_size_.z() -  2 * this->private_->overlap_ );
+    this->private_->update_effective_brick_size();
 
     if ( values.find( "datatype" ) == values.end() )
     {
@@ -463,6 +524,23 @@ bool LargeVolumeSchema::load( std::string& error)
       this->private_->little_endian_ = false;
     }
 
+    // Volumes written before codecs were introduced only use zlib
+    this->private_->codec_ = BrickCodecType::ZLIB_E;
+    if ( values.find( "codec" ) != values.end() &&
+      !ImportFromString( values[ "codec" ], this->private_->codec_ ) )
+    {
+      error = "Could not read codec field.";
+      return false;
+    }
+
+    this->private_->shuffle_ = false;
+    if ( values.find( "shuffle" ) != values.end() &&
+      !ImportFromString( values[ "shuffle" ], this->private_->shuffle_ ) )
+    {
+      error = "Could not read shuffle field.";
+      return false;
+    }
+
     if ( values.find( "min" ) == values.end() )
     {
       error = "Volume file does not contain a field called 'min'.";
@@ -488,6 +566,20 @@ bool LargeVolumeSchema::load( std::string& error)
       return false;
     }
 
+    this->private_->sharded_ = false;
+    if ( values.find( "container" ) != values.end() )
+    {
+      if ( values[ "container" ] == "shards" )
+      {
+        this->private_->sharded_ = true;
+      }
+      else if ( values[ "container" ] != "files" )
+      {
+        error = "Could not read container field.";
+        return false;
+      }
+    }
+
     size_t level = 0;
     
     while ( values.find( "level" + ExportToString(level)) != values.end() )
@@ -507,6 +599,16 @@ bool LargeVolumeSchema::load( std::string& error)
     }
     
     this->private_->compute_cached_level_info();
+
+    if ( this->private_->sharded_ )
+    {
+      this->private_->shard_index_.clear();
+      this->private_->shard_index_.resize( this->private_->levels_.size() );
+      for ( size_t j = 0; j < this->private_->levels_.size(); j++ )
+      {
+        if ( !this->private_->load_shard_index( j, error ) ) return false;
+      }
+    }
   }
   catch (...)
   {
@@ -539,6 +641,9 @@ bool LargeVolumeSchema::save( std::string& error ) const
 
     text_file << "datatype: " << ExportToString( this->private_->data_type_ ) << std::endl;
     text_file << "endian: " << ( this->private_->little_endian_ ? "little" : "big" ) << std::endl;
+    text_file << "codec: " << ExportToString( this->private_->codec_ ) << std::endl;
+    text_file << "shuffle: " << ExportToString( this->private_->shuffle_ ) << std::endl;
+    text_file << "container: " << ( this->private_->sharded_ ? "shards" : "files" ) << std::endl;
     text_file << "min: " << ExportToString( this->private_->min_ ) << std::endl;
     text_file << "max: " << ExportToString( this->private_->max_ ) << std::endl;
     
@@ -552,6 +657,14 @@ bool LargeVolumeSchema::save( std::string& error ) const
     return false;
   }
 
+  if ( this->private_->sharded_ )
+  {
+    for ( size_t j = 0; j < this->private_->shard_index_.size(); j++ )
+    {
+      if ( !this->private_->save_shard_index( j, error ) ) return false;
+    }
+  }
+
   return true;
 }
 
@@ -601,6 +714,11 @@ size_t LargeVolumeSchema::get_overlap() const
   return this->private_->overlap_;
 }
 
+const IndexVector& LargeVolumeSchema::get_brick_overlap() const
+{
+  return this->private_->brick_overlap_;
+}
+
 DataType LargeVolumeSchema::get_data_type() const
 {
   return this->private_->data_type_;
@@ -639,12 +757,11 @@ GridTransform LargeVolumeSchema::get_brick_grid_transform( const BrickInfo& bi )
 
   const Point origin = this->get_origin();
   const IndexVector& effective_brick_size = this->private_->effective_brick_size_;
-  const size_t overlap = this->private_->overlap_;
+  const IndexVector& overlap = this->private_->brick_overlap_;
 
-  Vector offset = Vector( index.x() * effective_brick_size.x() * spacing.x(),
-                          index.y() * effective_brick_size.y() * spacing.y(),
-                          index.z() * effective_brick_size.z() * spacing.z() )
-                    - spacing * static_cast<double>( overlap );
+  Vector offset = Vector( ( index.x() * effective_brick_size.x() - overlap.x() ) * spacing.x(),
+                          ( index.y() * effective_brick_size.y() - overlap.y() ) * spacing.y(),
+                          ( index.z() * effective_brick_size.z() - overlap.z() ) * spacing.z() );
   IndexVector bs = this->private_->compute_remainder_brick(bi, index);
 
   return GridTransform( bs.x(), bs.y(), bs.z(),
@@ -662,7 +779,17 @@ void LargeVolumeSchema::set_min_max( double min, double max ) const
 
 bool LargeVolumeSchema::is_compressed() const
 {
-  return this->private_->compression_;
+  return this->private_->codec_ != BrickCodecType::NONE_E;
+}
+
+BrickCodecType LargeVolumeSchema::get_codec() const
+{
+  return this->private_->codec_;
+}
+
+bool LargeVolumeSchema::get_shuffle() const
+{
+  return this->private_->shuffle_;
 }
 
 bool LargeVolumeSchema::is_little_endian() const
@@ -694,14 +821,32 @@ void LargeVolumeSchema::set_parameters( const IndexVector& size, const Vector& s
   this->private_->brick_size_ = brick_size;
   this->private_->overlap_ =  overlap;
   this->private_->data_type_ = data_type;
-  this->private_->effective_brick_size_.x( brick_size.x() - 2 * overlap );
-  this->private_->effective_brick_size_.y( brick_size.y() - 2 * overlap );
-  this->private_->effective_brick_size_.z( brick_size.z() - 2 * overlap );
+  this->private_->update_effective_brick_size();
 }
 
 void LargeVolumeSchema::set_compression( bool compression )
 {
-  this->private_->compression_ = compression;
+  this->private_->codec_ = compression ? BrickCodecType::ZLIB_E : BrickCodecType::NONE_E;
+}
+
+void LargeVolumeSchema::set_codec( BrickCodecType codec )
+{
+  this->private_->codec_ = codec;
+}
+
+void LargeVolumeSchema::set_shuffle( bool shuffle )
+{
+  this->private_->shuffle_ = shuffle;
+}
+
+bool LargeVolumeSchema::is_sharded() const
+{
+  return this->private_->sharded_;
+}
+
+void LargeVolumeSchema::set_sharded( bool sharded )
+{
+  this->private_->sharded_ = sharded;
 }
 
 void LargeVolumeSchema::compute_levels()
@@ -744,6 +889,9 @@ void LargeVolumeSchema::compute_levels()
 
     this->private_->compute_cached_level_info();
   }
+
+  this->private_->shard_index_.clear();
+  this->private_->shard_index_.resize( this->private_->levels_.size() );
 }
 
 
@@ -763,6 +911,11 @@ IndexVector LargeVolumeSchema::get_level_layout( index_type level ) const
   return this->private_->level_layout_[ level ];
 }
 
+size_t LargeVolumeSchema::compute_level_num_bricks( index_type level ) const
+{
+  return this->private_->compute_level_num_bricks( level );
+}
+
 IndexVector LargeVolumeSchema::get_brick_size( const BrickInfo& bi ) const
 {
   const IndexVector& effective_brick_size = this->private_->effective_brick_size_;
@@ -775,16 +928,18 @@ IndexVector LargeVolumeSchema::get_brick_size( const BrickInfo& bi ) const
 
 bool LargeVolumeSchema::read_brick( DataBlockHandle& brick, const BrickInfo& bi, std::string& error ) const
 {
-  IndexVector size = this->get_brick_size( bi );
-  brick = StdDataBlock::New( size[0], size[1], size[2], this->get_data_type() );
-  
-  if ( !brick )
+  if ( this->private_->sharded_ )
   {
-    error = "Could not allocate brick.";
-    return false;
+    return this->private_->read_brick_shard( brick, bi, error );
   }
 
-  bfs::path brick_file = this->private_->get_brick_file_name( bi );
+  return this->private_->read_brick_file( brick, bi, true, error );
+}
+
+bool LargeVolumeSchemaPrivate::read_brick_file( DataBlockHandle& brick, const BrickInfo& bi, 
+  bool allow_mapping, std::string& error )
+{
+  bfs::path brick_file = this->get_brick_file_name( bi );
 
   if ( !bfs::exists(brick_file ) )
   {
@@ -793,31 +948,91 @@ bool LargeVolumeSchema::read_brick( DataBlockHandle& brick, const BrickInfo& bi,
   }
 
   size_t file_size = bfs::file_size( brick_file );
-  size_t brick_size = size[0] * size[1] * size[2] * GetSizeDataType( this->get_data_type() );
+  return this->read_brick_data( brick, bi, brick_file, 0, file_size, allow_mapping, error );
+}
+
+bool LargeVolumeSchemaPrivate::read_brick_shard( DataBlockHandle& brick, const BrickInfo& bi, 
+  std::string& error )
+{
+  ShardEntry entry;
+  {
+    boost::mutex::scoped_lock lock( this->shard_mutex_ );
+    if ( bi.level_ >= 0 && bi.index_ >= 0 &&
+      static_cast<size_t>( bi.level_ ) < this->shard_index_.size() && 
+      static_cast<size_t>( bi.index_ ) < this->shard_index_[ bi.level_ ].size() )
+    {
+      entry = this->shard_index_[ bi.level_ ][ bi.index_ ];
+    }
+  }
+
+  if ( entry.size_ == 0 )
+  {
+    error = "Could not open brick.";
+    return false;
+  }
+
+  return this->read_brick_data( brick, bi, this->get_shard_file_name( bi.level_ ), 
+    static_cast<size_t>( entry.offset_ ), static_cast<size_t>( entry.size_ ), true, error );
+}
+
+bool LargeVolumeSchemaPrivate::read_brick_data( DataBlockHandle& brick, const BrickInfo& bi, 
+  const bfs::path& brick_file, size_t offset, size_t stored_size, bool allow_mapping, 
+  std::string& error )
+{
+  IndexVector size = this->schema_->get_brick_size( bi );
+  const size_t elem_size = GetSizeDataType( this->data_type_ );
+  size_t brick_size = size[0] * size[1] * size[2] * elem_size;
+
+  // Uncompressed bricks in native byte order can be used straight from the page cache
+  if ( allow_mapping && brick_size == stored_size && offset % elem_size == 0 &&
+    DataBlock::IsLittleEndian() == this->little_endian_ )
+  {
+    brick = MappedDataBlock::New( brick_file.string(), size[0], size[1], size[2], 
+      this->data_type_, offset );
+    if ( brick ) return true;
+  }
+
+  brick = StdDataBlock::New( size[0], size[1], size[2], this->data_type_ );
+  
+  if ( !brick )
+  {
+    error = "Could not allocate brick.";
+    return false;
+  }
 
-  if ( brick_size > file_size )
+  if ( brick_size > stored_size )
   {
     try
     {
-      std::vector<char> buffer( file_size );
+      std::vector<char> buffer( stored_size );
 
       std::ifstream input( brick_file.string().c_str(), std::ios_base::in | std::ios_base::binary );
-      input.read( &buffer[0],  file_size);
+      input.seekg( offset, std::ios_base::beg );
+      input.read( &buffer[0], stored_size );
+      if ( !input )
+      {
+        error = "Error reading file '" + brick_file.string() + "'.";
+        brick->clear();
+        return false;
+      }
       input.close();
 
-      zlib_uLongf brick_size_ul = brick_size;
-      if ( zlib_uncompress( reinterpret_cast<zlib_Bytef*>( brick->get_data() ), &brick_size_ul,
-        reinterpret_cast<zlib_Bytef*>(&buffer[0]), file_size ) != Z_OK)
+      // Shuffled data is decompressed into a scratch buffer first
+      const bool shuffle = this->shuffle_ && elem_size > 1;
+      std::vector<char> shuffled( shuffle ? brick_size : 0 );
+      char* dst = shuffle ? &shuffled[ 0 ] : reinterpret_cast<char*>( brick->get_data() );
+
+      if ( !BrickCodec::Decompress( this->codec_, &buffer[ 0 ], stored_size, dst, brick_size ) )
       {
         error = "Could not decompress file '" + brick_file.string() + "'.";
+        brick->clear();
         return false;
       }
 
-      if ( brick_size_ul != brick_size )
+      if ( shuffle )
       {
-        error = "Brick '" + brick_file.string() + "' contains invalid data.";
-        brick->clear();
-        return false;     
+        BrickCodec::Unshuffle( &shuffled[ 0 ], reinterpret_cast<char*>( brick->get_data() ),
+          brick_size / elem_size, elem_size );
       }
     }
     catch ( ... )
@@ -827,12 +1042,19 @@ bool LargeVolumeSchema::read_brick( DataBlockHandle& brick, const BrickInfo& bi,
       return false;
     }
   }
-  else if ( brick_size == file_size )
+  else if ( brick_size == stored_size )
   {
     try
     {
       std::ifstream input( brick_file.string().c_str(), std::ios_base::in | std::ios_base::binary );
+      input.seekg( offset, std::ios_base::beg );
       input.read( reinterpret_cast<char *>(brick->get_data()), brick_size );
+      if ( !input )
+      {
+        error = "Error reading file '" + brick_file.string() + "'.";
+        brick->clear();
+        return false;
+      }
       input.close();
     }
     catch ( ... )
@@ -849,7 +1071,7 @@ bool LargeVolumeSchema::read_brick( DataBlockHandle& brick, const BrickInfo& bi,
     return false;
   }
 
-  if ( DataBlock::IsLittleEndian() != this->private_->little_endian_ )
+  if ( DataBlock::IsLittleEndian() != this->little_endian_ )
   {
     brick->swap_endian();
   }
@@ -857,6 +1079,171 @@ bool LargeVolumeSchema::read_brick( DataBlockHandle& brick, const BrickInfo& bi,
   return true;
 }
 
+bool LargeVolumeSchemaPrivate::append_to_shard( const BrickInfo& bi, const char* data, size_t size, 
+  std::string& error )
+{
+  bfs::path shard_file = this->get_shard_file_name( bi.level_ );
+
+  if ( bi.level_ < 0 || bi.index_ < 0 )
+  {
+    error = "Invalid brick index.";
+    return false;
+  }
+
+  boost::mutex::scoped_lock lock( this->shard_mutex_ );
+
+  if ( static_cast<size_t>( bi.level_ ) >= this->shard_index_.size() )
+  {
+    this->shard_index_.resize( static_cast<size_t>( bi.level_ ) + 1 );
+  }
+
+  std::vector< ShardEntry >& index = this->shard_index_[ bi.level_ ];
+  if ( static_cast<size_t>( bi.index_ ) >= index.size() )
+  {
+    index.resize( static_cast<size_t>( bi.index_ ) + 1 );
+  }
+
+  // A brick is written only once, a second copy would leave stale data behind in the shard
+  if ( index[ bi.index_ ].size_ != 0 )
+  {
+    error = "Brick " + ExportToString( bi.index_ ) + " is already stored in shard '" + 
+      shard_file.string() + "'.";
+    return false;
+  }
+
+  try
+  {
+    // The shard is truncated by clear_shard() before the level is written, hence the end of
+    // the file is the end of the bricks that are in the index
+    boost::uint64_t offset = bfs::exists( shard_file ) ? bfs::file_size( shard_file ) : 0;
+
+    std::ofstream output( shard_file.string().c_str(), std::ios_base::app | std::ios_base::binary | std::ios_base::out );
+    output.write( data, size );
+    output.close();
+    if ( !output )
+    {
+      error = "Could not write to file '" + shard_file.string() + "'.";
+      return false;
+    }
+
+    index[ bi.index_ ].offset_ = offset;
+    index[ bi.index_ ].size_ = size;
+  }
+  catch ( ... )
+  {
+    error = "Could not write to file '" + shard_file.string() + "'.";
+    return false;
+  }
+
+  return true;
+}
+
+bool LargeVolumeSchema::clear_shard( index_type level, std::string& error ) const
+{
+  bfs::path shard_file = this->private_->get_shard_file_name( level );
+
+  boost::mutex::scoped_lock lock( this->private_->shard_mutex_ );
+
+  if ( level >= static_cast<index_type>( this->private_->shard_index_.size() ) )
+  {
+    this->private_->shard_index_.resize( level + 1 );
+  }
+  this->private_->shard_index_[ level ].assign( this->compute_level_num_bricks( level ), 
+    LargeVolumeSchemaPrivate::ShardEntry() );
+
+  try
+  {
+    std::ofstream output( shard_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
+    output.close();
+    if ( !output )
+    {
+      error = "Could not create file '" + shard_file.string() + "'.";
+      return false;
+    }
+  }
+  catch ( ... )
+  {
+    error = "Could not create file '" + shard_file.string() + "'.";
+    return false;
+  }
+
+  return true;
+}
+
+bool LargeVolumeSchemaPrivate::load_shard_index( index_type level, std::string& error )
+{
+  std::vector< ShardEntry >& index = this->shard_index_[ level ];
+  index.assign( this->compute_level_num_bricks( level ), ShardEntry() );
+
+  // A level without an index has not been written yet
+  bfs::path index_file = this->get_shard_index_file_name( level );
+  if ( !bfs::exists( index_file ) ) return true;
+
+  try
+  {
+    std::ifstream input( index_file.string().c_str(), std::ios_base::in | std::ios_base::binary );
+    std::vector<unsigned char> buffer( 16 );
+    for ( size_t j = 0; j < index.size(); j++ )
+    {
+      input.read( reinterpret_cast<char*>( &buffer[ 0 ] ), 16 );
+      if ( !input ) break;
+
+      // The index is stored as pairs of little endian 64 bit offsets and sizes
+      boost::uint64_t values[ 2 ] = { 0, 0 };
+      for ( size_t k = 0; k < 16; k++ )
+      {
+        values[ k / 8 ] |= static_cast<boost::uint64_t>( buffer[ k ] ) << ( 8 * ( k % 8 ) );
+      }
+      index[ j ].offset_ = values[ 0 ];
+      index[ j ].size_ = values[ 1 ];
+    }
+  }
+  catch ( ... )
+  {
+    error = "Could not read shard index '" + index_file.string() + "'.";
+    return false;
+  }
+
+  return true;
+}
+
+bool LargeVolumeSchemaPrivate::save_shard_index( index_type level, std::string& error )
+{
+  bfs::path index_file = this->get_shard_index_file_name( level );
+
+  boost::mutex::scoped_lock lock( this->shard_mutex_ );
+  const std::vector< ShardEntry >& index = this->shard_index_[ level ];
+
+  std::vector<unsigned char> buffer( 16 * index.size() );
+  for ( size_t j = 0; j < index.size(); j++ )
+  {
+    boost::uint64_t values[ 2 ] = { index[ j ].offset_, index[ j ].size_ };
+    for ( size_t k = 0; k < 16; k++ )
+    {
+      buffer[ 16 * j + k ] = static_cast<unsigned char>( values[ k / 8 ] >> ( 8 * ( k % 8 ) ) );
+    }
+  }
+
+  try
+  {
+    std::ofstream output( index_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
+    if ( !buffer.empty() ) output.write( reinterpret_cast<char*>( &buffer[ 0 ] ), buffer.size() );
+    output.close();
+    if ( !output )
+    {
+      error = "Could not write shard index '" + index_file.string() + "'.";
+      return false;
+    }
+  }
+  catch ( ... )
+  {
+    error = "Could not write shard index '" + index_file.string() + "'.";
+    return false;
+  }
+
+  return true;
+}
+
 bool LargeVolumeSchema::append_brick_buffer( DataBlockHandle data_block, size_t z_start, size_t z_end,
     size_t offset, const BrickInfo& bi, std::string& error ) const
 {
@@ -918,60 +1305,48 @@ bool LargeVolumeSchema::write_brick( DataBlockHandle data_block, const BrickInfo
 
   size_t brick_size = size[0] * size[1] * size[2] * GetSizeDataType( this->get_data_type() );
 
-  if ( this->private_->compression_) 
-  {
-    std::vector<char> buffer( brick_size + 12 );
-    zlib_uLongf brick_size_ul = brick_size + 12;
+  const char* data = reinterpret_cast<char *>( data_block->get_data() );
+  std::vector<char> buffer;
+  bool compressed = false;
 
-    int result = zlib_compress2( reinterpret_cast<zlib_Bytef*>( &buffer[0] ), &brick_size_ul,
-      reinterpret_cast<zlib_Bytef*>(data_block->get_data()), brick_size, Z_DEFAULT_COMPRESSION );
-    if (result != Z_OK )
+  if ( this->private_->codec_ != BrickCodecType::NONE_E ) 
+  {
+    const size_t elem_size = GetSizeDataType( this->get_data_type() );
+    if ( this->private_->shuffle_ && elem_size > 1 )
     {
-      error = "Could not compress file.";
-      return false;
+      std::vector<char> shuffled( brick_size );
+      BrickCodec::Shuffle( data, &shuffled[ 0 ], brick_size / elem_size, elem_size );
+      compressed = BrickCodec::Compress( this->private_->codec_, &shuffled[ 0 ], brick_size, buffer );
     }
-  
-    if ( brick_size_ul < brick_size )
-    {
-      // Compression succeeded
-      try
-      {
-        std::ofstream output( brick_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
-        output.write( &buffer[0], brick_size_ul );
-      }
-      catch ( ... )
-      {
-        error = "Could not write to file '" + brick_file.string() + "'.";
-        return false;
-      }
-
-    } 
-    else 
+    else
     {
-      try
-      {
-        std::ofstream output( brick_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
-        output.write( reinterpret_cast<char *>( data_block->get_data() ) , brick_size );
-      }
-      catch ( ... )
-      {
-        error = "Could not write to file '" + brick_file.string() + "'.";
-        return false;
-      }   
+      compressed = BrickCodec::Compress( this->private_->codec_, data, brick_size, buffer );
     }
   }
-  else
+
+  // If compression did not reduce the size the brick is stored uncompressed
+  if ( this->private_->sharded_ )
   {
-    try
+    return this->private_->append_to_shard( bi, compressed ? &buffer[ 0 ] : data, 
+      compressed ? buffer.size() : brick_size, error );
+  }
+
+  try
+  {
+    std::ofstream output( brick_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
+    if ( compressed )
     {
-      std::ofstream output( brick_file.string().c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out );
-      output.write( reinterpret_cast<char *>( data_block->get_data() ) , brick_size );
+      output.write( &buffer[0], buffer.size() );
     }
-    catch ( ... )
+    else
     {
-      error = "Could not write to file '" + brick_file.string() + "'.";
-      return false;
-    }   
+      output.write( data, brick_size );
+    }
+  }
+  catch ( ... )
+  {
+    error = "Could not write to file '" + brick_file.string() + "'.";
+    return false;
   }
 
   return true;
@@ -1139,7 +1514,7 @@ std::vector<BrickInfo> LargeVolumeSchema::get_bricks_for_volume( Transform world
 
   bool found_right_level = false;
   
-  size_t overlap = this->get_overlap();
+  const IndexVector& overlap = this->get_brick_overlap();
 
   BBox viewable_box( Point(-1.0, -1.0, -1.0), Point( 1.0, 1.0, 1.0 ));
 
@@ -1149,9 +1524,9 @@ std::vector<BrickInfo> LargeVolumeSchema::get_bricks_for_volume( Transform world
     bricks.pop();
     Vector spacing = this->get_level_spacing(  bi.level_ );
     GridTransform trans = this->get_brick_grid_transform( bi );
-    BBox bbox( trans * ( Point( overlap, overlap, overlap ) - Vector( 0.5, 0.5, 0.5 ) ),
-      trans * ( Point( trans.get_nx() - overlap, trans.get_ny() - overlap,
-      trans.get_nz() - overlap ) - Vector( 0.5, 0.5, 0.5 ) ) );
+    BBox bbox( trans * ( Point( overlap.x(), overlap.y(), overlap.z() ) - Vector( 0.5, 0.5, 0.5 ) ),
+      trans * ( Point( trans.get_nx() - overlap.x(), trans.get_ny() - overlap.y(),
+      trans.get_nz() - overlap.z() ) - Vector( 0.5, 0.5, 0.5 ) ) );
 
     switch ( slice )
     {
@@ -1328,14 +1703,30 @@ std::vector<BrickInfo> LargeVolumeSchema::get_bricks_for_volume( Transform world
     }
   }
 
+  // Center of the visible part of the slice, bricks closest to it are loaded first
+  Point center = effective_bbox.center();
+  switch ( slice )
+  {
+  case SliceType::SAGITTAL_E:
+    center.x( depth );
+    break;
+  case SliceType::CORONAL_E:
+    center.y( depth );
+    break;
+  case SliceType::AXIAL_E:
+    center.z( depth );
+    break;
+  }
+
   std::vector<BrickInfo> current_render;
-  this->private_->load_and_substitue_missing_bricks( result, slice, depth, load_key, current_render );
+  this->private_->load_and_substitue_missing_bricks( result, slice, depth, center, load_key, current_render );
 
   return current_render;
 }
 
 void LargeVolumeSchemaPrivate::load_and_substitue_missing_bricks( std::vector<BrickInfo>& want_to_render, 
-  SliceType slice, double depth, const std::string& load_key, std::vector<BrickInfo>& current_render )
+  SliceType slice, double depth, const Point& center, const std::string& load_key, 
+  std::vector<BrickInfo>& current_render )
 {
   LargeVolumeCache* cache = LargeVolumeCache::Instance();
 
@@ -1402,25 +1793,21 @@ void LargeVolumeSchemaPrivate::load_and_substitue_missing_bricks( std::vector<Br
   cache->clear_load_queue( load_key );
   for (size_t k = 0; k < bricks_to_load.size(); k++)
   {
-    cache->load_brick( this->schema_->shared_from_this(), bricks_to_load[ k ], load_key );
+    cache->load_brick( this->schema_->shared_from_this(), bricks_to_load[ k ], load_key, center );
   }
 }
 
-std::vector<BrickInfo> LargeVolumeSchema::get_bricks_for_region( const BBox& region, double pixel_size, SliceType slice,
-  const std::string& load_key)
+std::vector<BrickInfo> LargeVolumeSchema::get_bricks_in_region( const BBox& region, 
+  double pixel_size, SliceType slice ) const
 {
   index_type level = 0;
   index_type num_levels = this->get_num_levels();
 
-  LargeVolumeCache* cache = LargeVolumeCache::Instance();
-  double depth;
-
   // Compute needed level
   switch( slice )
   {
     case SliceType::SAGITTAL_E:
       {
-        depth = region.min().x();
         while (level + 1 < num_levels)
         {
           Vector spacing = this->get_level_spacing( level + 1 );
@@ -1432,7 +1819,6 @@ std::vector<BrickInfo> LargeVolumeSchema::get_bricks_for_region( const BBox& reg
 
     case SliceType::CORONAL_E:
       {
-        depth = region.min().y();
         while (level + 1 < num_levels)
         {
           Vector spacing = this->get_level_spacing( level + 1 );
@@ -1443,7 +1829,6 @@ std::vector<BrickInfo> LargeVolumeSchema::get_bricks_for_region( const BBox& reg
       } 
     case SliceType::AXIAL_E:
       {
-        depth = region.min().z();
         while (level + 1 < num_levels)
         {
           Vector spacing = this->get_level_spacing( level + 1 );
@@ -1488,8 +1873,31 @@ std::vector<BrickInfo> LargeVolumeSchema::get_bricks_for_region( const BBox& reg
     } 
   }
 
+  return want_to_render;
+}
+
+std::vector<BrickInfo> LargeVolumeSchema::get_bricks_for_region( const BBox& region, double pixel_size, SliceType slice,
+  const std::string& load_key)
+{
+  double depth;
+  switch( slice )
+  {
+    case SliceType::SAGITTAL_E:
+      depth = region.min().x();
+      break;
+    case SliceType::CORONAL_E:
+      depth = region.min().y();
+      break;
+    default:
+      depth = region.min().z();
+      break;
+  }
+
+  std::vector<BrickInfo> want_to_render = this->get_bricks_in_region( region, pixel_size, slice );
+
   std::vector<BrickInfo> current_render;
-  this->private_->load_and_substitue_missing_bricks( want_to_render, slice, depth, load_key, current_render );
+  this->private_->load_and_substitue_missing_bricks( want_to_render, slice, depth, region.center(),
+    load_key, current_render );
 
   return current_render;
 }
@@ -1500,30 +1908,61 @@ bool LargeVolumeSchema::reprocess_brick( const BrickInfo& bi,
 {
   error = "";
 
-  // Read in uncompressed brick
+  // Read in uncompressed brick, the file is removed below, hence it cannot be mapped.
+  // The bricks written by the converter always start out in their own file, and are moved
+  // into the shard of their level when the volume is sharded.
   DataBlockHandle data_block;
-  if (! this->read_brick( data_block, bi, error ) )
+  if (! this->private_->read_brick_file( data_block, bi, false, error ) )
   {
     return false;
   }
 
-
-  // Delete file, so that when we write the file again it will be more likely
-  // to be in a continuous block, especially since we do it as one write, hence
-  // a good FS should give us contiguous blocks on disk
   bfs::path brick_file = this->private_->get_brick_file_name( bi );
-  if (! bfs::remove( brick_file ) )
+
+  if ( this->private_->sharded_ )
   {
-    error = "Could not remove brick file.";
+    // Only remove the staging file once the brick and its index entry are in the shard, so a
+    // failed write does not lose the brick
+    if (! this->write_brick( data_block, bi, error ) )
+    {
+      return false;
+    }
+
+    if (! bfs::remove( brick_file ) )
+    {
+      error = "Could not remove brick file.";
+      return false;
+    }
+
+    return true;
+  }
+
+  // Write the brick as one entity next to the original and replace the original with it, a
+  // good FS should give us contiguous blocks on disk for a single write
+  bfs::path temp_file = brick_file.parent_path() / 
+    bfs::unique_path( brick_file.filename().string() + ".%%%%-%%%%.tmp" );
+
+  try
+  {
+    bfs::rename( brick_file, temp_file );
+  }
+  catch ( ... )
+  {
+    error = "Could not move brick file.";
     return false;
   }
 
-  // Write the file as one entity back to disk
   if (! this->write_brick( data_block, bi, error ) )
   {
+    boost::system::error_code ec;
+    bfs::remove( brick_file, ec );
+    bfs::rename( temp_file, brick_file, ec );
     return false;
   }
 
+  boost::system::error_code ec;
+  bfs::remove( temp_file, ec );
+
   return true;
 }
 
@@ -37,6 +37,7 @@
 #include <Core/Geometry/GridTransform.h>
 #include <Core/DataBlock/DataType.h>
 #include <Core/DataBlock/DataBlock.h>
+#include <Core/LargeVolume/BrickCodec.h>
 
 // Boost includes
 #include <boost/shared_ptr.hpp>
@@ -181,6 +182,11 @@ public:
   /// the full brick
   size_t get_overlap() const;
 
+  /// GET_BRICK_OVERLAP
+  /// Get the overlap along each axis. Bricks that are one voxel thick along an axis, as used for
+  /// volumes that are a single slice thick, have no overlap along that axis.
+  const IndexVector& get_brick_overlap() const;
+
   /// GET_DATA_TYPE
   /// Get the type of the underlying data
   DataType get_data_type() const;
@@ -189,6 +195,18 @@ public:
   /// Check whether the data is compressed
   bool is_compressed() const;
 
+  /// GET_CODEC
+  /// Get the codec used to compress the bricks
+  BrickCodecType get_codec() const;
+
+  /// GET_SHUFFLE
+  /// Check whether the bytes of the bricks are shuffled before compression
+  bool get_shuffle() const;
+
+  /// IS_SHARDED
+  /// Check whether the bricks of each level are stored in a single shard file
+  bool is_sharded() const;
+
   /// IS_LITTLE_ENDIAN
   /// Check whether data is little endian
   bool is_little_endian() const;
@@ -218,9 +236,22 @@ public:
   void set_parameters( const IndexVector& size, const Vector& spacing, const Point& origin, const IndexVector& brick_size, size_t overlap, DataType datatype );
 
   /// SET_COMPRESSION
-  /// Set whether data is compressed
+  /// Set whether data is compressed, compressed data uses the zlib codec
   void set_compression( bool compression );
 
+  /// SET_CODEC
+  /// Set the codec that is used to compress the bricks
+  void set_codec( BrickCodecType codec );
+
+  /// SET_SHUFFLE
+  /// Set whether the bytes of multi-byte data types are shuffled before compression
+  void set_shuffle( bool shuffle );
+
+  /// SET_SHARDED
+  /// Set whether the bricks of each level are stored in a single shard file with an offset
+  /// index, instead of one file per brick
+  void set_sharded( bool sharded );
+
   /// SET_MIN_MAX
   /// Set min and max values for the dataset
   void set_min_max( double min, double max ) const;
@@ -268,6 +299,12 @@ public:
   /// GET_GRID_TRANSFORM
   GridTransform get_brick_grid_transform( const BrickInfo& bi ) const;
 
+  /// GET_BRICKS_IN_REGION
+  /// Get the bricks at the resolution level that matches the pixel size, which cover a region.
+  /// Unlike get_bricks_for_region this does not substitute or load any bricks.
+  std::vector<BrickInfo> get_bricks_in_region( const BBox& region, double pixel_size, 
+    SliceType slice ) const;
+
   /// GET_BRICKS_FOR_REGION
   /// Get bricks for a certain region
   std::vector<BrickInfo> get_bricks_for_region( const BBox& region, 
@@ -318,6 +355,11 @@ public:
   bool reprocess_brick( const BrickInfo& bi,
     std::string& error ) const;
 
+  /// CLEAR_SHARD
+  /// Create or truncate the shard file of a level and clear its offset index, this needs to
+  /// be called before the bricks of a level are written into a sharded volume
+  bool clear_shard( index_type level, std::string& error ) const;
+
   /// APPEND_BRICK_BUFFER
   /// Append data to a brick to disk
   bool append_brick_buffer( DataBlockHandle data_block, size_t z_start, size_t z_end, const size_t offset,
@@ -0,0 +1,198 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <Core/LargeVolume/BrickCodec.h>
+
+using namespace Core;
+
+namespace {
+
+// Fill a buffer with a smooth ramp so that both codecs can actually shrink it.
+template<class T>
+std::vector<char> makeSmoothBuffer(size_t numElements)
+{
+  std::vector<char> buffer(numElements * sizeof(T));
+  T* data = reinterpret_cast<T*>(&buffer[0]);
+  for (size_t j = 0; j < numElements; j++)
+  {
+    data[j] = static_cast<T>((j / 7) % 100);
+  }
+  return buffer;
+}
+
+std::vector<char> makeRandomBuffer(size_t numBytes)
+{
+  std::vector<char> buffer(numBytes);
+  boost::uint32_t state = 0x12345678u;
+  for (size_t j = 0; j < numBytes; j++)
+  {
+    state = state * 1664525u + 1013904223u;
+    buffer[j] = static_cast<char>(state >> 24);
+  }
+  return buffer;
+}
+
+// Run the encode path of the schema (shuffle, compress) followed by the decode path
+// (decompress, unshuffle) and check that the original bytes come back.
+void roundTrip(BrickCodecType codec, const std::vector<char>& original,
+  size_t elemSize, bool shuffle, bool expectCompressed)
+{
+  size_t numBytes = original.size();
+  size_t numElements = numBytes / elemSize;
+
+  std::vector<char> input = original;
+  if (shuffle)
+  {
+    BrickCodec::Shuffle(&original[0], &input[0], numElements, elemSize);
+  }
+
+  std::vector<char> compressed;
+  bool isCompressed = BrickCodec::Compress(codec, &input[0], numBytes, compressed);
+  if (expectCompressed)
+  {
+    ASSERT_TRUE(isCompressed);
+  }
+
+  std::vector<char> decoded(numBytes);
+  if (isCompressed)
+  {
+    ASSERT_LT(compressed.size(), numBytes);
+    ASSERT_TRUE(BrickCodec::Decompress(codec, &compressed[0], compressed.size(),
+      &decoded[0], numBytes));
+  }
+  else
+  {
+    // An incompressible brick is stored as is.
+    decoded = input;
+  }
+
+  if (shuffle)
+  {
+    std::vector<char> unshuffled(numBytes);
+    BrickCodec::Unshuffle(&decoded[0], &unshuffled[0], numElements, elemSize);
+    decoded.swap(unshuffled);
+  }
+
+  ASSERT_EQ(0, std::memcmp(&original[0], &decoded[0], numBytes));
+}
+
+template<class T>
+void roundTripType(BrickCodecType codec)
+{
+  // Use an element count that is not a multiple of any block size.
+  std::vector<char> original = makeSmoothBuffer<T>(32 * 32 * 33 + 5);
+  roundTrip(codec, original, sizeof(T), false, true);
+  roundTrip(codec, original, sizeof(T), true, true);
+}
+
+void roundTripAllTypes(BrickCodecType codec)
+{
+  roundTripType<signed char>(codec);
+  roundTripType<unsigned char>(codec);
+  roundTripType<short>(codec);
+  roundTripType<unsigned short>(codec);
+  roundTripType<int>(codec);
+  roundTripType<unsigned int>(codec);
+  roundTripType<float>(codec);
+  roundTripType<double>(codec);
+}
+
+}
+
+TEST(BrickCodecTests, ShuffleRoundTrip)
+{
+  std::vector<char> original = makeRandomBuffer(8 * 1001);
+  std::vector<char> shuffled(original.size());
+  std::vector<char> unshuffled(original.size());
+
+  const size_t elemSizes[] = { 1, 2, 4, 8 };
+  for (size_t k = 0; k < 4; k++)
+  {
+    size_t elemSize = elemSizes[k];
+    size_t numElements = original.size() / elemSize;
+    BrickCodec::Shuffle(&original[0], &shuffled[0], numElements, elemSize);
+    BrickCodec::Unshuffle(&shuffled[0], &unshuffled[0], numElements, elemSize);
+    ASSERT_EQ(original, unshuffled);
+  }
+
+  // Byte planes: all the low bytes first, then all the high bytes.
+  const unsigned short values[] = { 0x0102, 0x0304, 0x0506 };
+  char planes[6];
+  BrickCodec::Shuffle(reinterpret_cast<const char*>(values), planes, 3, 2);
+  const unsigned short one = 1;
+  bool littleEndian = *reinterpret_cast<const char*>(&one) == 1;
+  const char expectedLe[] = { 0x02, 0x04, 0x06, 0x01, 0x03, 0x05 };
+  const char expectedBe[] = { 0x01, 0x03, 0x05, 0x02, 0x04, 0x06 };
+  ASSERT_EQ(0, std::memcmp(planes, littleEndian ? expectedLe : expectedBe, 6));
+}
+
+TEST(BrickCodecTests, ZlibRoundTrip)
+{
+  roundTripAllTypes(BrickCodecType::ZLIB_E);
+}
+
+TEST(BrickCodecTests, Lz4RoundTrip)
+{
+  roundTripAllTypes(BrickCodecType::LZ4_E);
+}
+
+TEST(BrickCodecTests, IncompressibleBuffer)
+{
+  std::vector<char> original = makeRandomBuffer(64 * 1024);
+  std::vector<char> compressed;
+
+  // Random data does not shrink, so the codec must report that the brick is to be
+  // stored uncompressed instead of handing back a larger buffer.
+  ASSERT_FALSE(BrickCodec::Compress(BrickCodecType::LZ4_E, &original[0],
+    original.size(), compressed));
+  ASSERT_FALSE(BrickCodec::Compress(BrickCodecType::ZLIB_E, &original[0],
+    original.size(), compressed));
+
+  roundTrip(BrickCodecType::LZ4_E, original, 4, true, false);
+  roundTrip(BrickCodecType::ZLIB_E, original, 4, false, false);
+}
+
+TEST(BrickCodecTests, DecompressSizeMismatch)
+{
+  std::vector<char> original = makeSmoothBuffer<unsigned short>(4096);
+  std::vector<char> compressed;
+  ASSERT_TRUE(BrickCodec::Compress(BrickCodecType::LZ4_E, &original[0],
+    original.size(), compressed));
+
+  // The decoded size is stored in the brick index; a mismatch means a corrupt brick.
+  std::vector<char> decoded(original.size() / 2);
+  ASSERT_FALSE(BrickCodec::Decompress(BrickCodecType::LZ4_E, &compressed[0],
+    compressed.size(), &decoded[0], decoded.size()));
+}
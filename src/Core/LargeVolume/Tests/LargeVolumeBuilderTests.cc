@@ -0,0 +1,257 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/LargeVolume/LargeVolumeBuilder.h>
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+#include <Testing/Utils/FilesystemPaths.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+namespace {
+
+typedef IndexVector::index_type index_type;
+
+unsigned short voxelValue(index_type x, index_type y, index_type z)
+{
+  return static_cast<unsigned short>((x * 7 + y * 13 + z * 29) % 1000);
+}
+
+bool renderRegion(const IndexVector& start, DataBlockHandle dataBlock, std::string&)
+{
+  unsigned short* data = reinterpret_cast<unsigned short*>(dataBlock->get_data());
+  for (size_t z = 0; z < dataBlock->get_nz(); ++z)
+  {
+    for (size_t y = 0; y < dataBlock->get_ny(); ++y)
+    {
+      for (size_t x = 0; x < dataBlock->get_nx(); ++x)
+      {
+        data[dataBlock->to_index(x, y, z)] = voxelValue(start.x() + x, start.y() + y,
+          start.z() + z);
+      }
+    }
+  }
+  return true;
+}
+
+// A level of the volume as one block of voxels
+struct Level
+{
+  IndexVector size_;
+  std::vector<unsigned short> data_;
+
+  unsigned short at(index_type x, index_type y, index_type z) const
+  {
+    return this->data_[static_cast<size_t>((z * this->size_.y() + y) * this->size_.x() + x)];
+  }
+};
+
+// Compute the expected levels the same way the builder defines them: every voxel of a coarser
+// level is the average of a box of voxels of the level before it.
+std::vector<Level> expectedLevels(LargeVolumeSchemaHandle schema)
+{
+  std::vector<Level> levels(schema->get_num_levels());
+  for (size_t level = 0; level < levels.size(); ++level)
+  {
+    Level& current = levels[level];
+    current.size_ = schema->get_level_size(level);
+    current.data_.resize(static_cast<size_t>(current.size_.x() * current.size_.y() *
+      current.size_.z()));
+
+    const IndexVector& ratio = schema->get_level_downsample_ratio(level);
+    IndexVector step(1, 1, 1);
+    if (level > 0)
+    {
+      const IndexVector& prevRatio = schema->get_level_downsample_ratio(level - 1);
+      step = IndexVector(ratio.x() / prevRatio.x(), ratio.y() / prevRatio.y(),
+        ratio.z() / prevRatio.z());
+    }
+
+    size_t i = 0;
+    for (index_type z = 0; z < current.size_.z(); ++z)
+    {
+      for (index_type y = 0; y < current.size_.y(); ++y)
+      {
+        for (index_type x = 0; x < current.size_.x(); ++x, ++i)
+        {
+          if (level == 0)
+          {
+            current.data_[i] = voxelValue(x, y, z);
+            continue;
+          }
+
+          const Level& prev = levels[level - 1];
+          double sum = 0.0;
+          index_type count = 0;
+          for (index_type sz = z * step.z(); sz < std::min((z + 1) * step.z(), prev.size_.z()); ++sz)
+          {
+            for (index_type sy = y * step.y(); sy < std::min((y + 1) * step.y(), prev.size_.y()); ++sy)
+            {
+              for (index_type sx = x * step.x(); sx < std::min((x + 1) * step.x(), prev.size_.x());
+                ++sx, ++count)
+              {
+                sum += prev.at(sx, sy, sz);
+              }
+            }
+          }
+          current.data_[i] = static_cast<unsigned short>(sum / count);
+        }
+      }
+    }
+  }
+  return levels;
+}
+
+// Read every brick of every level back and compare it with the expected levels, the overlap
+// outside of the level is zero.
+void expectBricks(LargeVolumeSchemaHandle schema)
+{
+  std::vector<Level> levels = expectedLevels(schema);
+  const IndexVector& effSize = schema->get_effective_brick_size();
+  const IndexVector& overlap = schema->get_brick_overlap();
+
+  for (size_t level = 0; level < levels.size(); ++level)
+  {
+    const Level& expected = levels[level];
+    const IndexVector layout = schema->get_level_layout(level);
+    size_t numBricks = schema->compute_level_num_bricks(level);
+    ASSERT_EQ(static_cast<size_t>(layout.x() * layout.y() * layout.z()), numBricks);
+
+    for (size_t k = 0; k < numBricks; ++k)
+    {
+      BrickInfo bi(k, level);
+      DataBlockHandle brick;
+      std::string error;
+      ASSERT_TRUE(schema->read_brick(brick, bi, error)) << error;
+
+      IndexVector brickSize = schema->get_brick_size(bi);
+      ASSERT_EQ(static_cast<size_t>(brickSize.x()), brick->get_nx());
+      ASSERT_EQ(static_cast<size_t>(brickSize.y()), brick->get_ny());
+      ASSERT_EQ(static_cast<size_t>(brickSize.z()), brick->get_nz());
+
+      index_type index = static_cast<index_type>(k);
+      IndexVector brickIndex(index % layout.x(), (index / layout.x()) % layout.y(),
+        index / (layout.x() * layout.y()));
+      IndexVector brickStart(brickIndex.x() * effSize.x() - overlap.x(),
+        brickIndex.y() * effSize.y() - overlap.y(), brickIndex.z() * effSize.z() - overlap.z());
+
+      const unsigned short* data = reinterpret_cast<const unsigned short*>(brick->get_data());
+      size_t numMismatches = 0;
+      for (index_type z = 0; z < brickSize.z(); ++z)
+      {
+        for (index_type y = 0; y < brickSize.y(); ++y)
+        {
+          for (index_type x = 0; x < brickSize.x(); ++x, ++data)
+          {
+            IndexVector p = brickStart + IndexVector(x, y, z);
+            bool inside = p.x() >= 0 && p.y() >= 0 && p.z() >= 0 &&
+              p.x() < expected.size_.x() && p.y() < expected.size_.y() &&
+              p.z() < expected.size_.z();
+            unsigned short value = inside ? expected.at(p.x(), p.y(), p.z()) : 0;
+            if (*data != value) numMismatches++;
+          }
+        }
+      }
+      EXPECT_EQ(0u, numMismatches) << "level " << level << " brick " << k;
+    }
+  }
+}
+
+LargeVolumeSchemaHandle createSchema(const boost::filesystem::path& dir, const IndexVector& size,
+  const IndexVector& brickSize, size_t overlap)
+{
+  boost::filesystem::remove_all(dir);
+  boost::filesystem::create_directories(dir);
+
+  LargeVolumeSchemaHandle schema(new LargeVolumeSchema);
+  schema->set_dir(dir);
+  schema->set_parameters(size, Vector(1, 1, 1), Point(0, 0, 0), brickSize, overlap,
+    DataType::USHORT_E);
+  schema->set_codec(BrickCodecType::LZ4_E);
+  schema->compute_levels();
+  return schema;
+}
+
+}
+
+// Build a volume with several levels and read every brick back, which covers gathering the
+// bricks of a level and averaging them into the next one.
+TEST(LargeVolumeBuilderTests, RoundTrip)
+{
+  boost::filesystem::path dir = testOutputDir() / "largevolume_builder";
+  LargeVolumeSchemaHandle schema = createSchema(dir, IndexVector(70, 45, 20),
+    IndexVector(16, 16, 16), 2);
+  ASSERT_GT(schema->get_num_levels(), 2u);
+
+  LargeVolumeBuilder builder(schema);
+  std::string error;
+  ASSERT_TRUE(builder.run(boost::bind(&renderRegion, _1, _2, _3), error)) << error;
+  EXPECT_EQ(0.0, schema->get_min());
+  EXPECT_EQ(999.0, schema->get_max());
+
+  expectBricks(schema);
+
+  // The saved schema describes the same bricks
+  LargeVolumeSchemaHandle loaded(new LargeVolumeSchema);
+  loaded->set_dir(dir);
+  ASSERT_TRUE(loaded->load(error)) << error;
+  EXPECT_EQ(schema->get_num_levels(), loaded->get_num_levels());
+  expectBricks(loaded);
+}
+
+// Bricks of a single slice volume are one voxel thick and only overlap within the slice.
+TEST(LargeVolumeBuilderTests, SingleSlice)
+{
+  boost::filesystem::path dir = testOutputDir() / "largevolume_builder_slice";
+  LargeVolumeSchemaHandle schema = createSchema(dir, IndexVector(70, 45, 1),
+    IndexVector(16, 16, 1), 2);
+  EXPECT_EQ(IndexVector(2, 2, 0), schema->get_brick_overlap());
+  EXPECT_EQ(IndexVector(12, 12, 1), schema->get_effective_brick_size());
+
+  LargeVolumeBuilder builder(schema);
+  std::string error;
+  ASSERT_TRUE(builder.run(boost::bind(&renderRegion, _1, _2, _3), error)) << error;
+
+  for (size_t level = 0; level < schema->get_num_levels(); ++level)
+  {
+    for (size_t k = 0; k < schema->compute_level_num_bricks(level); ++k)
+    {
+      EXPECT_EQ(1, schema->get_brick_size(BrickInfo(k, level)).z());
+    }
+  }
+  expectBricks(schema);
+}
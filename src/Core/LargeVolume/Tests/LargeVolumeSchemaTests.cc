@@ -0,0 +1,165 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+
+#include <Core/DataBlock/StdDataBlock.h>
+#include <Core/LargeVolume/LargeVolumeSchema.h>
+#include <Testing/Utils/FilesystemPaths.h>
+
+using namespace Core;
+using namespace Testing::Utils;
+
+namespace {
+
+LargeVolumeSchemaHandle createSchema(const boost::filesystem::path& dir, bool sharded)
+{
+  boost::filesystem::remove_all(dir);
+  boost::filesystem::create_directories(dir);
+
+  LargeVolumeSchemaHandle schema(new LargeVolumeSchema);
+  schema->set_dir(dir);
+  schema->set_parameters(IndexVector(40, 30, 12), Vector(1, 1, 1), Point(0, 0, 0),
+    IndexVector(16, 16, 16), 1, DataType::USHORT_E);
+  schema->set_codec(BrickCodecType::LZ4_E);
+  schema->set_shuffle(true);
+  schema->set_sharded(sharded);
+  schema->compute_levels();
+  return schema;
+}
+
+DataBlockHandle createBrick(LargeVolumeSchemaHandle schema, const BrickInfo& bi, int seed)
+{
+  IndexVector size = schema->get_brick_size(bi);
+  DataBlockHandle brick = StdDataBlock::New(size[0], size[1], size[2], DataType::USHORT_E);
+  unsigned short* data = reinterpret_cast<unsigned short*>(brick->get_data());
+  for (size_t i = 0; i < brick->get_size(); ++i)
+  {
+    data[i] = static_cast<unsigned short>((i / 5 + bi.index_ * 31 + seed) % 4000);
+  }
+  return brick;
+}
+
+bool equalBricks(DataBlockHandle a, DataBlockHandle b)
+{
+  if (a->get_size() != b->get_size()) return false;
+  const unsigned short* adata = reinterpret_cast<const unsigned short*>(a->get_data());
+  return std::equal(adata, adata + a->get_size(),
+    reinterpret_cast<const unsigned short*>(b->get_data()));
+}
+
+}
+
+// Rewriting a level starts a new shard instead of appending after the bricks of the last run.
+TEST(LargeVolumeSchemaTests, RewriteShard)
+{
+  boost::filesystem::path dir = testOutputDir() / "largevolume_shard";
+  LargeVolumeSchemaHandle schema = createSchema(dir, true);
+
+  std::string error;
+  ASSERT_TRUE(schema->save(error)) << error;
+
+  size_t numBricks = schema->compute_level_num_bricks(0);
+  ASSERT_GT(numBricks, 1u);
+
+  ASSERT_TRUE(schema->clear_shard(0, error)) << error;
+  for (size_t k = 0; k < numBricks; ++k)
+  {
+    BrickInfo bi(k, 0);
+    ASSERT_TRUE(schema->write_brick(createBrick(schema, bi, 0), bi, error)) << error;
+  }
+
+  // A brick is stored only once per run
+  EXPECT_FALSE(schema->write_brick(createBrick(schema, BrickInfo(0, 0), 0), BrickInfo(0, 0),
+    error));
+
+  boost::filesystem::path shardFile = dir / "A.shard";
+  ASSERT_TRUE(boost::filesystem::exists(shardFile));
+  boost::uintmax_t shardSize = boost::filesystem::file_size(shardFile);
+
+  ASSERT_TRUE(schema->clear_shard(0, error)) << error;
+  EXPECT_EQ(boost::filesystem::file_size(shardFile), 0u);
+  for (size_t k = 0; k < numBricks; ++k)
+  {
+    BrickInfo bi(k, 0);
+    ASSERT_TRUE(schema->write_brick(createBrick(schema, bi, 0), bi, error)) << error;
+  }
+  EXPECT_EQ(boost::filesystem::file_size(shardFile), shardSize);
+  ASSERT_TRUE(schema->save(error)) << error;
+
+  // Read the bricks back through a freshly loaded schema
+  LargeVolumeSchemaHandle loaded(new LargeVolumeSchema);
+  loaded->set_dir(dir);
+  ASSERT_TRUE(loaded->load(error)) << error;
+  ASSERT_TRUE(loaded->is_sharded());
+  for (size_t k = 0; k < numBricks; ++k)
+  {
+    BrickInfo bi(k, 0);
+    DataBlockHandle brick;
+    ASSERT_TRUE(loaded->read_brick(brick, bi, error)) << error;
+    EXPECT_TRUE(equalBricks(brick, createBrick(schema, bi, 0)));
+  }
+}
+
+// Moving a staged brick into the shard only removes the staging file once the brick is stored.
+TEST(LargeVolumeSchemaTests, ReprocessBrickIntoShard)
+{
+  boost::filesystem::path dir = testOutputDir() / "largevolume_reprocess";
+  LargeVolumeSchemaHandle schema = createSchema(dir, false);
+  schema->set_codec(BrickCodecType::NONE_E);
+
+  std::string error;
+  ASSERT_TRUE(schema->save(error)) << error;
+
+  BrickInfo bi(1, 0);
+  DataBlockHandle original = createBrick(schema, bi, 7);
+  ASSERT_TRUE(schema->write_brick(original, bi, error)) << error;
+  boost::filesystem::path brickFile = schema->get_brick_file_name(bi);
+  ASSERT_TRUE(boost::filesystem::exists(brickFile));
+
+  // Reprocessing a brick that is kept in its own file leaves the file in place
+  ASSERT_TRUE(schema->reprocess_brick(bi, error)) << error;
+  ASSERT_TRUE(boost::filesystem::exists(brickFile));
+
+  schema->set_codec(BrickCodecType::LZ4_E);
+  schema->set_sharded(true);
+  ASSERT_TRUE(schema->clear_shard(0, error)) << error;
+  ASSERT_TRUE(schema->reprocess_brick(bi, error)) << error;
+  EXPECT_FALSE(boost::filesystem::exists(brickFile));
+
+  DataBlockHandle brick;
+  ASSERT_TRUE(schema->read_brick(brick, bi, error)) << error;
+  EXPECT_TRUE(equalBricks(brick, original));
+
+  // Without a staging file there is nothing to move, and the stored brick is kept
+  EXPECT_FALSE(schema->reprocess_brick(bi, error));
+  ASSERT_TRUE(schema->read_brick(brick, bi, error)) << error;
+  EXPECT_TRUE(equalBricks(brick, original));
+}
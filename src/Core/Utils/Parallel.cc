@@ -30,10 +30,12 @@
 #include <vector>
 
 // Boost includes
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 
 // Core includes
 #include <Core/Utils/Parallel.h>
+#include <Core/Utils/TaskScheduler.h>
 
 namespace Core
 {
@@ -67,21 +69,19 @@ Parallel::Parallel( boost::function< void ( int, int, boost::barrier& ) > functi
 
 void Parallel::run()
 {
-  boost::barrier barrier( this->private_->num_threads_ );
+  int num_threads = this->private_->num_threads_;
+  boost::barrier barrier( num_threads );
 
-  std::vector< boost::thread* > threads( this->private_->num_threads_ );
-
-  for ( int i = 0; i < this->private_->num_threads_; i++ )
+  // The threads wait for each other at the barrier, hence they are run as a gang
+  // on the workers of the task scheduler
+  std::vector< boost::function< void () > > functions( num_threads );
+  for ( int i = 0; i < num_threads; i++ )
   {
-    threads[ i ] = new boost::thread( boost::bind( this->private_->function_, i, 
-      this->private_->num_threads_, boost::ref( barrier ) ) );
+    functions[ i ] = boost::bind( this->private_->function_, i, num_threads, 
+      boost::ref( barrier ) );
   }
 
-  for ( int i = 0; i < this->private_->num_threads_; i++ )
-  {
-    threads[ i ]->join();
-    delete threads[ i ];
-  }
+  TaskScheduler::Instance()->run_gang( functions );
 }
 
 } // end namespace Core
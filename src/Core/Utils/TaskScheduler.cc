@@ -0,0 +1,580 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+// STL includes
+#include <algorithm>
+#include <deque>
+#include <limits>
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+// Core includes
+#include <Core/Utils/TaskScheduler.h>
+
+namespace Core
+{
+
+CORE_SINGLETON_IMPLEMENTATION( TaskScheduler );
+
+//////////////////////////////////////////////////////////////////////////
+// Class TaskGroupPrivate
+//////////////////////////////////////////////////////////////////////////
+
+class TaskGroupPrivate
+{
+public:
+  TaskGroupPrivate() :
+    pending_( 0 ),
+    queued_( 0 ),
+    queue_events_( 0 ),
+    canceled_( false )
+  {
+  }
+
+  // Protects the counters, the cancel flag and the exception
+  boost::mutex mutex_;
+  // Signaled when the last pending task is done or when a task of the group is queued
+  boost::condition_variable changed_;
+
+  // Number of tasks that were scheduled but are not done yet
+  size_t pending_;
+  // Number of tasks that are scheduled but have not been taken from a queue yet
+  size_t queued_;
+  // Increased every time a task of the group has been queued
+  size_t queue_events_;
+  // Whether tasks that have not started yet should be skipped
+  bool canceled_;
+  // The first exception thrown by a task of the group
+  boost::exception_ptr exception_;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Class TaskSchedulerPrivate
+//////////////////////////////////////////////////////////////////////////
+
+class Task
+{
+public:
+  boost::function< void () > function_;
+  TaskGroupPrivateHandle group_;
+};
+
+class TaskWorker
+{
+public:
+  TaskWorker() :
+    idle_( false )
+  {
+  }
+
+  // Tasks queued on this worker, the worker takes from the back and the other
+  // workers steal from the front
+  boost::mutex queue_mutex_;
+  std::deque< Task > queue_;
+
+  // Function of a gang this worker has been reserved for and whether the worker is
+  // waiting for work, both are protected by the mutex of the scheduler
+  boost::function< void () > gang_function_;
+  bool idle_;
+};
+
+typedef boost::shared_ptr< TaskWorker > TaskWorkerHandle;
+
+class TaskGang
+{
+public:
+  explicit TaskGang( size_t remaining ) :
+    remaining_( remaining )
+  {
+  }
+
+  boost::mutex mutex_;
+  boost::condition_variable done_;
+  size_t remaining_;
+};
+
+typedef boost::shared_ptr< TaskGang > TaskGangHandle;
+
+class TaskSchedulerPrivate
+{
+public:
+  // SCHEDULE:
+  /// Queue a task on the worker that calls this function, or on the next worker in turn
+  /// when it is called from another thread
+  void schedule( const Task& task );
+
+  // TAKE_TASK:
+  /// Take the newest task of the given worker, or steal the oldest task of another worker
+  bool take_task( size_t worker, Task& task );
+
+  // TAKE_GROUP_TASK:
+  /// Take the newest task of the group from the queue of the given worker, or steal the oldest
+  /// task of the group from another worker
+  bool take_group_task( size_t worker, TaskGroupPrivate* group, Task& task );
+
+  // TASK_TAKEN:
+  /// Update the counters after a task has been taken from a queue
+  void task_taken( const Task& task );
+
+  // EXECUTE_TASK:
+  /// Execute a task unless its group was canceled and mark it as done
+  void execute_task( Task& task );
+
+  // RUN_WORKER:
+  /// Main loop of a worker thread
+  void run_worker( size_t worker );
+
+  // GET_WORKER_INDEX:
+  /// Index of the worker that calls this function, or the number of workers when called
+  /// from another thread
+  size_t get_worker_index();
+
+  // RUN_GANG_MEMBER:
+  /// Run one of the functions of a gang and report when it is done
+  static void RunGangMember( boost::function< void () > function, TaskGangHandle gang );
+
+  std::vector< TaskWorkerHandle > workers_;
+  boost::thread_group threads_;
+
+  // Protects the counters and the state of the workers
+  boost::mutex mutex_;
+  // Signaled when tasks are queued or a worker is reserved for a gang
+  boost::condition_variable work_available_;
+
+  // Number of tasks in all the queues
+  size_t num_queued_;
+  // Queue that receives the next task scheduled from outside the workers
+  size_t next_queue_;
+  // Whether the workers need to quit
+  bool done_;
+
+  // Index of the worker that runs in the current thread
+  boost::thread_specific_ptr< size_t > worker_index_;
+};
+
+void TaskSchedulerPrivate::schedule( const Task& task )
+{
+  size_t worker = this->get_worker_index();
+
+  boost::mutex::scoped_lock lock( this->mutex_ );
+  if ( worker == this->workers_.size() )
+  {
+    worker = this->next_queue_;
+    this->next_queue_ = ( this->next_queue_ + 1 ) % this->workers_.size();
+  }
+
+  {
+    boost::mutex::scoped_lock queue_lock( this->workers_[ worker ]->queue_mutex_ );
+    this->workers_[ worker ]->queue_.push_back( task );
+  }
+
+  this->num_queued_++;
+  this->work_available_.notify_one();
+}
+
+bool TaskSchedulerPrivate::take_task( size_t worker, Task& task )
+{
+  size_t num_workers = this->workers_.size();
+  bool found = false;
+
+  if ( worker < num_workers )
+  {
+    TaskWorker* own = this->workers_[ worker ].get();
+    boost::mutex::scoped_lock queue_lock( own->queue_mutex_ );
+    if ( !own->queue_.empty() )
+    {
+      task = own->queue_.back();
+      own->queue_.pop_back();
+      found = true;
+    }
+  }
+
+  for ( size_t j = 1; !found && j <= num_workers; j++ )
+  {
+    TaskWorker* victim = this->workers_[ ( worker + j ) % num_workers ].get();
+    boost::mutex::scoped_lock queue_lock( victim->queue_mutex_ );
+    if ( !victim->queue_.empty() )
+    {
+      task = victim->queue_.front();
+      victim->queue_.pop_front();
+      found = true;
+    }
+  }
+
+  if ( found ) this->task_taken( task );
+  return found;
+}
+
+bool TaskSchedulerPrivate::take_group_task( size_t worker, TaskGroupPrivate* group, Task& task )
+{
+  size_t num_workers = this->workers_.size();
+  bool found = false;
+
+  if ( worker < num_workers )
+  {
+    TaskWorker* own = this->workers_[ worker ].get();
+    boost::mutex::scoped_lock queue_lock( own->queue_mutex_ );
+    for ( size_t j = own->queue_.size(); !found && j > 0; j-- )
+    {
+      if ( own->queue_[ j - 1 ].group_.get() != group ) continue;
+      task = own->queue_[ j - 1 ];
+      own->queue_.erase( own->queue_.begin() + ( j - 1 ) );
+      found = true;
+    }
+  }
+
+  for ( size_t j = 1; !found && j <= num_workers; j++ )
+  {
+    TaskWorker* victim = this->workers_[ ( worker + j ) % num_workers ].get();
+    boost::mutex::scoped_lock queue_lock( victim->queue_mutex_ );
+    for ( size_t k = 0; !found && k < victim->queue_.size(); k++ )
+    {
+      if ( victim->queue_[ k ].group_.get() != group ) continue;
+      task = victim->queue_[ k ];
+      victim->queue_.erase( victim->queue_.begin() + k );
+      found = true;
+    }
+  }
+
+  if ( found ) this->task_taken( task );
+  return found;
+}
+
+void TaskSchedulerPrivate::task_taken( const Task& task )
+{
+  {
+    boost::mutex::scoped_lock lock( this->mutex_ );
+    this->num_queued_--;
+  }
+
+  boost::mutex::scoped_lock lock( task.group_->mutex_ );
+  task.group_->queued_--;
+}
+
+void TaskSchedulerPrivate::execute_task( Task& task )
+{
+  TaskGroupPrivateHandle group = task.group_;
+
+  bool canceled;
+  {
+    boost::mutex::scoped_lock lock( group->mutex_ );
+    canceled = group->canceled_;
+  }
+
+  if ( !canceled )
+  {
+    try
+    {
+      task.function_();
+    }
+    catch ( ... )
+    {
+      // Keep the first exception for wait() to rethrow and skip the rest of the group
+      boost::mutex::scoped_lock lock( group->mutex_ );
+      if ( !group->exception_ ) group->exception_ = boost::current_exception();
+      group->canceled_ = true;
+    }
+  }
+
+  // Release whatever the task holds on to before the group is reported done
+  task = Task();
+
+  boost::mutex::scoped_lock lock( group->mutex_ );
+  if ( --group->pending_ == 0 )
+  {
+    group->changed_.notify_all();
+  }
+}
+
+void TaskSchedulerPrivate::run_worker( size_t worker )
+{
+  this->worker_index_.reset( new size_t( worker ) );
+  TaskWorker* self = this->workers_[ worker ].get();
+
+  Task task;
+  while ( true )
+  {
+    if ( this->take_task( worker, task ) )
+    {
+      this->execute_task( task );
+      continue;
+    }
+
+    boost::function< void () > gang_function;
+    {
+      boost::mutex::scoped_lock lock( this->mutex_ );
+      while ( !this->done_ && this->num_queued_ == 0 && !self->gang_function_ )
+      {
+        self->idle_ = true;
+        this->work_available_.wait( lock );
+      }
+      self->idle_ = false;
+
+      if ( this->done_ ) return;
+      gang_function.swap( self->gang_function_ );
+
+      // Pass on the wake up for queued tasks this worker is not going to pick up now
+      if ( gang_function && this->num_queued_ > 0 )
+      {
+        this->work_available_.notify_one();
+      }
+    }
+
+    if ( gang_function ) gang_function();
+  }
+}
+
+size_t TaskSchedulerPrivate::get_worker_index()
+{
+  size_t* index = this->worker_index_.get();
+  return index ? *index : this->workers_.size();
+}
+
+void TaskSchedulerPrivate::RunGangMember( boost::function< void () > function, 
+  TaskGangHandle gang )
+{
+  function();
+
+  boost::mutex::scoped_lock lock( gang->mutex_ );
+  if ( --gang->remaining_ == 0 )
+  {
+    gang->done_.notify_all();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Class TaskScheduler
+//////////////////////////////////////////////////////////////////////////
+
+TaskScheduler::TaskScheduler() :
+  private_( new TaskSchedulerPrivate )
+{
+  this->private_->num_queued_ = 0;
+  this->private_->next_queue_ = 0;
+  this->private_->done_ = false;
+
+  size_t num_workers = std::max( 1u, boost::thread::hardware_concurrency() );
+  for ( size_t j = 0; j < num_workers; j++ )
+  {
+    this->private_->workers_.push_back( TaskWorkerHandle( new TaskWorker ) );
+  }
+
+  for ( size_t j = 0; j < num_workers; j++ )
+  {
+    this->private_->threads_.create_thread( boost::bind( 
+      &TaskSchedulerPrivate::run_worker, this->private_.get(), j ) );
+  }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  {
+    boost::mutex::scoped_lock lock( this->private_->mutex_ );
+    this->private_->done_ = true;
+    this->private_->work_available_.notify_all();
+  }
+  this->private_->threads_.join_all();
+}
+
+int TaskScheduler::get_num_threads() const
+{
+  return static_cast< int >( this->private_->workers_.size() );
+}
+
+void TaskScheduler::run_gang( const std::vector< boost::function< void () > >& functions )
+{
+  if ( functions.empty() ) return;
+
+  TaskGangHandle gang( new TaskGang( functions.size() - 1 ) );
+  size_t next = 1;
+
+  // Hand the functions to idle workers first
+  {
+    boost::mutex::scoped_lock lock( this->private_->mutex_ );
+    for ( size_t j = 0; j < this->private_->workers_.size() && next < functions.size(); j++ )
+    {
+      TaskWorker* worker = this->private_->workers_[ j ].get();
+      if ( worker->idle_ && !worker->gang_function_ )
+      {
+        worker->gang_function_ = boost::bind( &TaskSchedulerPrivate::RunGangMember, 
+          functions[ next++ ], gang );
+        worker->idle_ = false;
+      }
+    }
+    if ( next > 1 ) this->private_->work_available_.notify_all();
+  }
+
+  // The functions need to run at the same time, hence start extra threads for the
+  // functions that did not get a worker
+  boost::thread_group extra_threads;
+  for ( ; next < functions.size(); next++ )
+  {
+    extra_threads.create_thread( boost::bind( &TaskSchedulerPrivate::RunGangMember, 
+      functions[ next ], gang ) );
+  }
+
+  functions[ 0 ]();
+
+  {
+    boost::mutex::scoped_lock lock( gang->mutex_ );
+    while ( gang->remaining_ > 0 )
+    {
+      gang->done_.wait( lock );
+    }
+  }
+  extra_threads.join_all();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Class TaskGroup
+//////////////////////////////////////////////////////////////////////////
+
+TaskGroup::TaskGroup() :
+  private_( new TaskGroupPrivate )
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+  // Exceptions can not leave a destructor, they need to be picked up by calling wait()
+  try
+  {
+    this->wait();
+  }
+  catch ( ... )
+  {
+  }
+}
+
+void TaskGroup::run( boost::function< void () > task )
+{
+  {
+    boost::mutex::scoped_lock lock( this->private_->mutex_ );
+    this->private_->pending_++;
+    this->private_->queued_++;
+  }
+
+  Task scheduled_task;
+  scheduled_task.function_ = task;
+  scheduled_task.group_ = this->private_;
+  TaskScheduler::Instance()->private_->schedule( scheduled_task );
+
+  // Wake up the threads waiting for the group, so they can help with the new task
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  this->private_->queue_events_++;
+  this->private_->changed_.notify_all();
+}
+
+void TaskGroup::wait()
+{
+  TaskSchedulerPrivate* scheduler = TaskScheduler::Instance()->private_.get();
+  size_t worker = scheduler->get_worker_index();
+
+  Task task;
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  while ( this->private_->pending_ > 0 )
+  {
+    // Help out with the tasks of this group only, so the waiting thread never gets tied up in
+    // unrelated work that may take much longer than the group it is waiting for
+    if ( this->private_->queued_ > 0 )
+    {
+      size_t queue_events = this->private_->queue_events_;
+      lock.unlock();
+      bool found = scheduler->take_group_task( worker, this->private_.get(), task );
+      if ( found ) scheduler->execute_task( task );
+      lock.lock();
+
+      // A task that is counted but not yet in a queue signals when it gets there
+      if ( found || queue_events != this->private_->queue_events_ ) continue;
+    }
+
+    // The remaining tasks of this group are running elsewhere, they signal when they are done
+    // or when they queue more work for the group
+    this->private_->changed_.wait( lock );
+  }
+
+  if ( this->private_->exception_ )
+  {
+    boost::exception_ptr exception = this->private_->exception_;
+    this->private_->exception_ = boost::exception_ptr();
+    lock.unlock();
+    boost::rethrow_exception( exception );
+  }
+}
+
+void TaskGroup::cancel()
+{
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  this->private_->canceled_ = true;
+}
+
+bool TaskGroup::is_canceled() const
+{
+  boost::mutex::scoped_lock lock( this->private_->mutex_ );
+  return this->private_->canceled_;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ParallelFor
+//////////////////////////////////////////////////////////////////////////
+
+void ParallelFor( TaskGroup& group, size_t begin, size_t end, 
+  boost::function< void ( size_t, size_t ) > function, size_t grain_size )
+{
+  if ( end <= begin ) return;
+
+  if ( grain_size == 0 )
+  {
+    // A few chunks per worker leave room for balancing uneven chunks
+    size_t num_chunks = 4 * static_cast< size_t >( 
+      TaskScheduler::Instance()->get_num_threads() );
+    grain_size = std::max( size_t( 1 ), ( end - begin + num_chunks - 1 ) / num_chunks );
+  }
+
+  for ( size_t start = begin; start < end; )
+  {
+    size_t stop = end - start > grain_size ? start + grain_size : end;
+    group.run( boost::bind( function, start, stop ) );
+    start = stop;
+  }
+
+  group.wait();
+}
+
+void ParallelFor( size_t begin, size_t end, 
+  boost::function< void ( size_t, size_t ) > function, size_t grain_size )
+{
+  TaskGroup group;
+  ParallelFor( group, begin, end, function, grain_size );
+}
+
+} // end namespace Core
@@ -0,0 +1,135 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CORE_UTILS_TASKSCHEDULER_H
+#define CORE_UTILS_TASKSCHEDULER_H
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1020)
+# pragma once
+#endif 
+
+// STL includes
+#include <vector>
+
+// Boost includes
+#include <boost/noncopyable.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/function.hpp>
+
+// Core includes
+#include <Core/Utils/Singleton.h>
+
+namespace Core
+{
+
+class TaskGroupPrivate;
+typedef boost::shared_ptr< TaskGroupPrivate > TaskGroupPrivateHandle;
+
+class TaskSchedulerPrivate;
+typedef boost::shared_ptr< TaskSchedulerPrivate > TaskSchedulerPrivateHandle;
+
+// CLASS TASKSCHEDULER:
+/// Persistent pool of worker threads that is shared by all the parallel code in the program.
+/// Every worker has its own queue of tasks, a worker takes the newest task from its own
+/// queue and steals the oldest task from the other queues when its own queue is empty.
+
+class TaskScheduler : public boost::noncopyable
+{
+  CORE_SINGLETON( TaskScheduler );
+
+  // -- constructor/destructor --
+private:
+  TaskScheduler();
+  ~TaskScheduler();
+
+public:
+  // GET_NUM_THREADS:
+  /// Get the number of worker threads
+  int get_num_threads() const;
+
+  // RUN_GANG:
+  /// Run all the functions at the same time, each one in its own thread. The first function
+  /// runs in the calling thread, the others run on idle workers or on extra threads if not
+  /// enough workers are idle, hence the functions may wait for each other.
+  /// This function returns when all the functions are done.
+  void run_gang( const std::vector< boost::function< void () > >& functions );
+
+private:
+  friend class TaskGroup;
+  TaskSchedulerPrivateHandle private_;
+};
+
+// CLASS TASKGROUP:
+/// A set of tasks that run on the task scheduler and that are waited for together.
+/// Canceling the group skips the tasks that have not started yet.
+
+class TaskGroup : public boost::noncopyable
+{
+public:
+  TaskGroup();
+  ~TaskGroup();
+
+  // RUN:
+  /// Schedule a task for execution by the workers. A task that throws an exception cancels
+  /// the group.
+  void run( boost::function< void () > task );
+
+  // WAIT:
+  /// Wait until all the tasks in the group are done or skipped. The calling thread executes
+  /// queued tasks of this group in the meantime. If a task threw an exception, the first one
+  /// is rethrown once all the tasks are done.
+  void wait();
+
+  // CANCEL:
+  /// Skip all the tasks of the group that have not started yet. Running tasks can poll
+  /// is_canceled to stop early.
+  void cancel();
+
+  // IS_CANCELED:
+  /// Whether the group was canceled
+  bool is_canceled() const;
+
+private:
+  TaskGroupPrivateHandle private_;
+};
+
+// PARALLELFOR:
+/// Split the range [begin, end) into chunks of about grain_size indices and call the function
+/// with the first and one past the last index of each chunk on the task scheduler. The chunks
+/// are scheduled on the given group, which can be used to cancel the loop. When grain_size is 
+/// zero a chunk size is chosen based on the number of worker threads.
+/// This function returns when all chunks are done, and rethrows the first exception thrown
+/// by a chunk.
+void ParallelFor( TaskGroup& group, size_t begin, size_t end, 
+  boost::function< void ( size_t, size_t ) > function, size_t grain_size = 0 );
+void ParallelFor( size_t begin, size_t end, 
+  boost::function< void ( size_t, size_t ) > function, size_t grain_size = 0 );
+
+} // end namespace Core
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ For more information, please see: http://software.sci.utah.edu
+
+ The MIT License
+
+ Copyright (c) 2016 Scientific Computing and Imaging Institute,
+ University of Utah.
+
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included
+ in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ DEALINGS IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <Core/Utils/Parallel.h>
+#include <Core/Utils/TaskScheduler.h>
+
+static void MarkRange( std::vector< int >* marks, size_t begin, size_t end )
+{
+  for ( size_t j = begin; j < end; j++ ) ( *marks )[ j ]++;
+}
+
+static void CancelAndMark( Core::TaskGroup* group, std::vector< int >* marks, 
+  size_t begin, size_t end )
+{
+  group->cancel();
+  MarkRange( marks, begin, end );
+}
+
+static void NestedParallelFor( std::vector< int >* marks, size_t begin, size_t end )
+{
+  for ( size_t j = begin; j < end; j++ )
+  {
+    Core::ParallelFor( j * 100, ( j + 1 ) * 100, boost::bind( &MarkRange, marks, _1, _2 ), 7 );
+  }
+}
+
+static void ThrowInRange( size_t throw_at, size_t begin, size_t end )
+{
+  if ( begin <= throw_at && throw_at < end ) throw std::runtime_error( "task failed" );
+}
+
+static void CountWithBarrier( boost::mutex* mutex, int* count, int* seen, 
+  int thread, int, boost::barrier& barrier )
+{
+  {
+    boost::mutex::scoped_lock lock( *mutex );
+    ( *count )++;
+  }
+  barrier.wait();
+
+  boost::mutex::scoped_lock lock( *mutex );
+  seen[ thread ] = *count;
+}
+
+TEST(TaskSchedulerTests, ParallelForCoversRange)
+{
+  std::vector< int > marks( 10007, 0 );
+  Core::ParallelFor( 0, marks.size(), boost::bind( &MarkRange, &marks, _1, _2 ) );
+  for ( size_t j = 0; j < marks.size(); j++ )
+  {
+    ASSERT_EQ( 1, marks[ j ] );
+  }
+}
+
+TEST(TaskSchedulerTests, NestedParallelFor)
+{
+  std::vector< int > marks( 100 * 64, 0 );
+  Core::ParallelFor( 0, 64, boost::bind( &NestedParallelFor, &marks, _1, _2 ), 1 );
+  for ( size_t j = 0; j < marks.size(); j++ )
+  {
+    ASSERT_EQ( 1, marks[ j ] );
+  }
+}
+
+TEST(TaskSchedulerTests, CancelSkipsTasks)
+{
+  std::vector< int > marks( 1000, 0 );
+  Core::TaskGroup group;
+  Core::ParallelFor( group, 0, marks.size(), 
+    boost::bind( &CancelAndMark, &group, &marks, _1, _2 ), 1 );
+  ASSERT_TRUE( group.is_canceled() );
+
+  size_t num_marked = 0;
+  for ( size_t j = 0; j < marks.size(); j++ ) num_marked += marks[ j ];
+  ASSERT_TRUE( num_marked >= 1 );
+  ASSERT_TRUE( num_marked < marks.size() );
+}
+
+TEST(TaskSchedulerTests, WaitRethrowsTaskException)
+{
+  Core::TaskGroup group;
+  ASSERT_THROW( Core::ParallelFor( group, 0, 1000, boost::bind( &ThrowInRange, 500, _1, _2 ), 1 ),
+    std::runtime_error );
+  ASSERT_TRUE( group.is_canceled() );
+
+  // The exception is only thrown once
+  group.wait();
+}
+
+TEST(TaskSchedulerTests, ParallelRunsThreadsTogether)
+{
+  // More threads than workers, all of them need to reach the barrier
+  int num_threads = Core::TaskScheduler::Instance()->get_num_threads() + 3;
+  boost::mutex mutex;
+  int count = 0;
+  std::vector< int > seen( num_threads, 0 );
+
+  Core::Parallel parallel( boost::bind( &CountWithBarrier, &mutex, &count, &seen[ 0 ], 
+    _1, _2, _3 ), num_threads );
+  parallel.run();
+  parallel.run();
+
+  for ( int j = 0; j < num_threads; j++ )
+  {
+    ASSERT_TRUE( seen[ j ] >= num_threads );
+  }
+  ASSERT_EQ( 2 * num_threads, count );
+}
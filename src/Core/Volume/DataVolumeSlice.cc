@@ -35,14 +35,25 @@
 namespace Core
 {
 
+class DataVolumeSlicePrivate
+{
+public:
+  /// The data range that was used for scaling the data in the texture
+  double texture_min_;
+  double texture_max_;
+};
+
 const unsigned int DataVolumeSlice::TEXTURE_DATA_TYPE_C = GL_UNSIGNED_SHORT;
 
 const unsigned int DataVolumeSlice::TEXTURE_FORMAT_C = GL_LUMINANCE16;
 
 DataVolumeSlice::DataVolumeSlice( const DataVolumeHandle& data_volume, 
                  VolumeSliceType type, size_t slice_num ) :
-  VolumeSlice( data_volume, type, slice_num )
+  VolumeSlice( data_volume, type, slice_num ),
+  private_( new DataVolumeSlicePrivate )
 {
+  this->private_->texture_min_ = 0.0;
+  this->private_->texture_max_ = 0.0;
   this->data_block_ = data_volume->get_data_block().get();
   if ( this->data_block_ )
   {
@@ -53,6 +64,7 @@ DataVolumeSlice::DataVolumeSlice( const DataVolumeHandle& data_volume,
 
 DataVolumeSlice::DataVolumeSlice( const DataVolumeSlice &copy ) :
   VolumeSlice( copy ),
+  private_( copy.private_ ),
   data_block_( copy.data_block_ )
 {
 }
@@ -63,7 +75,8 @@ DataVolumeSlice::~DataVolumeSlice()
 }
 
 template<class TYPE1, class TYPE2>
-void CopyTypedData( DataVolumeSlice* slice, TYPE1* buffer, DataBlock* data_block )
+void CopyTypedData( DataVolumeSlice* slice, TYPE1* buffer, DataBlock* data_block,
+  size_t i_min, size_t j_min, size_t nx, size_t ny )
 {
   const double numeric_min = static_cast<double>( std::numeric_limits< TYPE1 >::min() );
   const double numeric_max = static_cast<double>( std::numeric_limits< TYPE1 >::max() );
@@ -74,14 +87,13 @@ void CopyTypedData( DataVolumeSlice* slice, TYPE1* buffer, DataBlock* data_block
 
   const TYPE2 typed_value_min = static_cast<TYPE2>( value_min );
 
-  size_t current_index = slice->to_index( 0, 0 );
+  size_t current_index = slice->to_index( i_min, j_min );
 
   // Index strides in X and Y direction. Use int instead of size_t because strides might be negative.
-  const int x_stride = slice->nx() > 1 ? static_cast<int>( slice->to_index( 1, 0 ) - current_index ) : 0;
-  const int y_stride = slice->ny() > 1 ? static_cast<int>( slice->to_index( 0, 1 ) - current_index ) : 0;
-
-  const size_t nx = slice->nx();
-  const size_t ny = slice->ny();
+  const int x_stride = slice->nx() > 1 ? static_cast<int>( slice->to_index( 1, 0 ) - 
+    slice->to_index( 0, 0 ) ) : 0;
+  const int y_stride = slice->ny() > 1 ? static_cast<int>( slice->to_index( 0, 1 ) - 
+    slice->to_index( 0, 0 ) ) : 0;
   
   TYPE2* data = static_cast<TYPE2*>( data_block->get_data() );
   size_t row_start = current_index;
@@ -109,24 +121,52 @@ void DataVolumeSlice::upload_texture()
   if ( !this->get_slice_changed() )
     return;
 
-  size_t nx = this->nx();
-  size_t ny = this->ny();
-
   RenderResources::lock_type rr_lock( RenderResources::GetMutex() );
 
   // Lock the texture
   Texture2DHandle tex = this->get_texture();
   Texture::lock_type tex_lock( tex->get_mutex() );
-  tex->bind();
 
+  // NOTE: The generation is retrieved before locking the volume, hence if the data changes in
+  // between, the next upload will include the change again.
+  DataBlock::generation_type generation = this->data_block_->get_generation();
+
+  // Lock the volume
+  DataBlock::shared_lock_type volume_lock( this->data_block_->get_mutex() );
+
+  // Only upload the part of the slice that changed since the last upload. If the data range
+  // changed, all the values in the texture need to be rescaled.
+  size_t i_min, j_min, i_max, j_max;
+  if ( !this->get_texture_update_region( this->data_block_, i_min, j_min, i_max, j_max ) ||
+    this->data_block_->get_min() != this->private_->texture_min_ ||
+    this->data_block_->get_max() != this->private_->texture_max_ )
+  {
+    i_min = 0;
+    j_min = 0;
+    i_max = this->nx() - 1;
+    j_max = this->ny() - 1;
+  }
+
+  this->private_->texture_min_ = this->data_block_->get_min();
+  this->private_->texture_max_ = this->data_block_->get_max();
+  this->set_texture_generation( generation );
+  this->set_slice_changed( false );
+
+  // Nothing in this slice changed
+  if ( i_min > i_max || j_min > j_max ) return;
+
+  size_t nx = i_max - i_min + 1;
+  size_t ny = j_max - j_min + 1;
+
+  tex->bind();
 
   if ( this->get_size_changed() )
   {
     // Make sure there is no pixel unpack buffer bound
     PixelUnpackBuffer::RestoreDefault();
 
-    tex->set_image( static_cast< int >( nx ), 
-      static_cast< int >( ny ), TEXTURE_FORMAT_C );
+    tex->set_image( static_cast< int >( this->nx() ), 
+      static_cast< int >( this->ny() ), TEXTURE_FORMAT_C );
     this->set_size_changed( false );
   }
   
@@ -137,35 +177,40 @@ void DataVolumeSlice::upload_texture()
     NULL, GL_STREAM_DRAW );
   texture_data_type* buffer = reinterpret_cast< texture_data_type* >(
     pixel_buffer->map_buffer( GL_WRITE_ONLY ) );
-
-  // Lock the volume
-  DataBlock::shared_lock_type volume_lock( this->data_block_->get_mutex() );
   
   switch ( this->data_block_->get_data_type() )
   {
     case DataType::CHAR_E:
-      CopyTypedData< texture_data_type, signed char >( this, buffer, this->data_block_ );
+      CopyTypedData< texture_data_type, signed char >( this, buffer, this->data_block_,
+        i_min, j_min, nx, ny );
       break;
     case DataType::UCHAR_E:
-      CopyTypedData< texture_data_type, unsigned char >( this, buffer, this->data_block_ );
+      CopyTypedData< texture_data_type, unsigned char >( this, buffer, this->data_block_,
+        i_min, j_min, nx, ny );
       break;
     case DataType::SHORT_E:
-      CopyTypedData< texture_data_type, short >( this, buffer, this->data_block_ );
+      CopyTypedData< texture_data_type, short >( this, buffer, this->data_block_,
+        i_min, j_min, nx, ny );
       break;
     case DataType::USHORT_E:
-      CopyTypedData< texture_data_type, unsigned short >( this, buffer, this->data_block_ );
+      CopyTypedData< texture_data_type, unsigned short >( this, buffer, this->data_block_,
+        i_min, j_min, nx, ny );
       break;
     case DataType::INT_E:
-      CopyTypedData< texture_data_type, int >( this, buffer, this->data_block_ );
+      CopyTypedData< texture_data_type, int >( this, buffer, this->data_block_,
+        i_min, j_min, nx, ny );
       break;
     case DataType::UINT_E:
-      CopyTypedData< texture_data_type, unsigned int >( this, buffer, this->data_block_ );
+      CopyTypedData< texture_data_type, unsigned int >( this, buffer, this->data_block_,
+        i_min, j_min, nx, ny );
       break;
     case DataType::FLOAT_E:
-      CopyTypedData< texture_data_type, float >( this, buffer, this->data_block_ );
+      CopyTypedData< texture_data_type, float >( this, buffer, this->data_block_,
+        i_min, j_min, nx, ny );
       break;
     case DataType::DOUBLE_E:
-      CopyTypedData< texture_data_type, double >( this, buffer, this->data_block_ );
+      CopyTypedData< texture_data_type, double >( this, buffer, this->data_block_,
+        i_min, j_min, nx, ny );
       break;
   }
 
@@ -174,8 +219,8 @@ void DataVolumeSlice::upload_texture()
   // Step 2. copy from the pixel buffer to texture
   pixel_buffer->unmap_buffer();
   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-  tex->set_sub_image( 0, 0, static_cast<int>( nx ), 
-    static_cast<int>( ny ), NULL, GL_LUMINANCE, TEXTURE_DATA_TYPE_C );
+  tex->set_sub_image( static_cast<int>( i_min ), static_cast<int>( j_min ), 
+    static_cast<int>( nx ), static_cast<int>( ny ), NULL, GL_LUMINANCE, TEXTURE_DATA_TYPE_C );
   tex->unbind();
 
   // Step 3. release the pixel unpack buffer
@@ -186,8 +231,6 @@ void DataVolumeSlice::upload_texture()
   glFinish();
 
   CORE_CHECK_OPENGL_ERROR();
-
-  this->set_slice_changed( false );
 }
 
 VolumeSliceHandle DataVolumeSlice::clone()
@@ -63,7 +63,9 @@ public:
 
     GridTransform total_trans = volume->get_grid_transform();
     GridTransform brick_trans = schema->get_brick_grid_transform( bi );
-    double overlap = static_cast<double>( schema->get_overlap() );
+    const IndexVector& brick_overlap = schema->get_brick_overlap();
+    Vector overlap( static_cast<double>( brick_overlap.x() ), static_cast<double>( brick_overlap.y() ), 
+      static_cast<double>( brick_overlap.z() ) );
     Vector spacing =  schema->get_level_spacing( bi.level_ );
 
     BBox total = BBox( total_trans.get_origin() - total_trans.project( Vector( 0.5, 0.5, 0.5 ) ) , total_trans.project( Point (
@@ -76,8 +78,9 @@ public:
       static_cast<double>(brick_trans.get_ny()), 
       static_cast<double>(brick_trans.get_nz()) ) ) - brick_trans.project( Vector( 0.5, 0.5, 0.5 ) ) );
 
-    Point inner_min = outer_.min() + spacing * overlap;
-    Point inner_max = outer_.max() - spacing * overlap;
+    Vector inner_offset( spacing.x() * overlap.x(), spacing.y() * overlap.y(), spacing.z() * overlap.z() );
+    Point inner_min = outer_.min() + inner_offset;
+    Point inner_max = outer_.max() - inner_offset;
     Point total_min = total.min();
     Point total_max = total.max();
 
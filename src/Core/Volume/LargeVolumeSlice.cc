@@ -30,9 +30,12 @@
 #include <vector>
 
 #include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <Core/Volume/LargeVolumeSlice.h>
 #include <Core/Volume/LargeVolumeBrickSlice.h>
+#include <Core/LargeVolume/LargeVolumeCache.h>
 #include <Core/Utils/Exception.h>
 
 
@@ -59,8 +62,141 @@ public:
   typedef boost::unordered_map<std::string, tile_cache_type> volume_view_tile_cache_type;
   tile_cache_type tiles_;
   volume_view_tile_cache_type volume_view_tiles_;
+
+  // -- prefetching --
+public:
+  // Navigation state of one viewer, used to predict which bricks are needed next
+  struct PrefetchState
+  {
+    PrefetchState() : valid_( false ), depth_( 0.0 ), depth_direction_( 0 ) {}
+
+    bool valid_;
+    double depth_;
+    int depth_direction_;
+    Point center_;
+    Vector pan_direction_;
+
+    // Bricks that were queued since the last change of direction
+    boost::unordered_set<BrickInfo, BrickInfoHash> requested_;
+  };
+
+  typedef boost::unordered_map<std::string, PrefetchState> prefetch_state_map_type;
+  prefetch_state_map_type prefetch_states_;
+  boost::mutex prefetch_mutex_;
+
+  // Minimum number of slices to look ahead while scrubbing
+  const static int PREFETCH_SLICES_C;
+  // Number of frames of movement to look ahead
+  const static double PREFETCH_LOOKAHEAD_C;
+  // Upper bound of the number of bricks remembered as requested
+  const static size_t PREFETCH_MAX_REQUESTED_C;
+
+  // PREFETCH_TILES:
+  /// Queue the bricks along the direction in which the viewer is moving
+  void prefetch_tiles( LargeVolumeSchemaHandle schema, SliceType slice, double depth, 
+    const BBox& region, double pixel_size, const std::string& load_key );
 };
 
+const int LargeVolumeSlicePrivate::PREFETCH_SLICES_C = 8;
+const double LargeVolumeSlicePrivate::PREFETCH_LOOKAHEAD_C = 4.0;
+const size_t LargeVolumeSlicePrivate::PREFETCH_MAX_REQUESTED_C = 4096;
+
+void LargeVolumeSlicePrivate::prefetch_tiles( LargeVolumeSchemaHandle schema, SliceType slice, 
+  double depth, const BBox& region, double pixel_size, const std::string& load_key )
+{
+  boost::mutex::scoped_lock lock( this->prefetch_mutex_ );
+
+  PrefetchState& state = this->prefetch_states_[ load_key ];
+  const std::string prefetch_key = load_key + "_prefetch";
+
+  // Normal of the slice and spacing of the slices
+  Vector normal( 0.0, 0.0, 1.0 );
+  double slice_spacing = schema->get_spacing().z();
+  if ( slice == SliceType::SAGITTAL_E )
+  {
+    normal = Vector( 1.0, 0.0, 0.0 );
+    slice_spacing = schema->get_spacing().x();
+  }
+  else if ( slice == SliceType::CORONAL_E )
+  {
+    normal = Vector( 0.0, 1.0, 0.0 );
+    slice_spacing = schema->get_spacing().y();
+  }
+
+  Point center = region.center();
+  if ( !state.valid_ )
+  {
+    state.valid_ = true;
+    state.depth_ = depth;
+    state.center_ = center;
+    return;
+  }
+
+  double depth_delta = depth - state.depth_;
+  Vector pan = center - state.center_;
+  pan = pan - Dot( pan, normal ) * normal;
+
+  // Ignore movements well below a voxel
+  const double epsilon = 1e-3 * slice_spacing;
+  int depth_direction = 0;
+  if ( depth_delta > epsilon ) depth_direction = 1;
+  else if ( depth_delta < -epsilon ) depth_direction = -1;
+  bool panning = pan.length() > epsilon;
+
+  // Cancel what was queued when the user turns around, those bricks are not needed anymore
+  bool reversed = ( depth_direction != 0 && state.depth_direction_ != 0 && 
+    depth_direction != state.depth_direction_ ) ||
+    ( panning && Dot( pan, state.pan_direction_ ) < 0.0 );
+
+  if ( reversed || state.requested_.size() > PREFETCH_MAX_REQUESTED_C )
+  {
+    LargeVolumeCache::Instance()->clear_load_queue( prefetch_key );
+    state.requested_.clear();
+  }
+
+  if ( depth_direction != 0 ) state.depth_direction_ = depth_direction;
+  if ( panning ) state.pan_direction_ = pan;
+  state.depth_ = depth;
+  state.center_ = center;
+
+  if ( depth_direction == 0 && !panning ) return;
+
+  // Extend the visible region along the direction of movement
+  BBox prefetch_region = region;
+  Vector shift( 0.0, 0.0, 0.0 );
+  if ( depth_direction != 0 )
+  {
+    double distance = Max( PREFETCH_SLICES_C * slice_spacing, 
+      PREFETCH_LOOKAHEAD_C * Abs( depth_delta ) );
+    shift += static_cast<double>( depth_direction ) * distance * normal;
+  }
+
+  if ( panning )
+  {
+    // Look ahead at most one viewport in the direction of the pan
+    Vector size = region.diagonal();
+    Vector pan_shift = PREFETCH_LOOKAHEAD_C * pan;
+    pan_shift = Vector( Max( -size.x(), Min( size.x(), pan_shift.x() ) ),
+      Max( -size.y(), Min( size.y(), pan_shift.y() ) ),
+      Max( -size.z(), Min( size.z(), pan_shift.z() ) ) );
+    shift += pan_shift;
+  }
+
+  prefetch_region.extend( region.min() + shift );
+  prefetch_region.extend( region.max() + shift );
+
+  std::vector<BrickInfo> bricks = schema->get_bricks_in_region( prefetch_region, pixel_size, slice );
+
+  LargeVolumeCache* cache = LargeVolumeCache::Instance();
+  for ( size_t j = 0; j < bricks.size(); j++ )
+  {
+    if ( state.requested_.insert( bricks[ j ] ).second )
+    {
+      cache->prefetch_brick( schema, bricks[ j ], prefetch_key, center + shift );
+    }
+  }
+}
+
 LargeVolumeSlice::LargeVolumeSlice( const LargeVolumeHandle& large_volume, 
                  VolumeSliceType type, size_t slice_num ) :
   VolumeSlice( large_volume, type, slice_num ),
@@ -122,6 +258,9 @@ std::vector<LargeVolumeBrickSliceHandle> LargeVolumeSlice::load_tiles(
   std::vector<BrickInfo> bricks = this->lv_schema_->
     get_bricks_for_region( effective_bbox, pixel_size, this->get_slice_type(), load_key );
 
+  this->private_->prefetch_tiles( this->lv_schema_, this->get_slice_type(), this->depth(),
+    effective_bbox, pixel_size, load_key );
+
   LargeVolumeSlicePrivate::tile_cache_type current_tiles;
   LargeVolumeSlicePrivate::tile_cache_type::iterator it;
   LargeVolumeBrickSliceHandle slice;
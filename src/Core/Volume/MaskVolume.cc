@@ -68,7 +68,7 @@ DataBlock::generation_type MaskVolume::get_generation() const
 {
   if ( this->mask_data_block_ )
   {
-    return this->mask_data_block_->get_data_block()->get_generation();
+    return this->mask_data_block_->get_generation();
   }
   else
   {
@@ -102,14 +102,16 @@ DataBlock::generation_type MaskVolume::register_data( DataBlock::generation_type
 {
   if ( this->mask_data_block_ )
   {
-    if ( this->mask_data_block_->get_data_block()->get_generation() != -1 )
+    // NOTE: Registering the data does not need to expand a sparse mask
+    if ( this->mask_data_block_->get_generation() != -1 )
     {
       MaskDataBlock::lock_type lock( this->mask_data_block_->get_mutex() );
       this->mask_data_block_->increase_generation();
     }
     else
     {
-      Core::DataBlockManager::Instance()->register_datablock( this->mask_data_block_->get_data_block() );
+      Core::DataBlockManager::Instance()->register_datablock( 
+        this->mask_data_block_->get_unexpanded_data_block() );
     }
 
     return this->mask_data_block_->get_generation();
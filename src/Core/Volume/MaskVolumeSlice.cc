@@ -43,6 +43,9 @@ class MaskVolumeSlicePrivate
 public:
   bool using_cache_;
   std::vector< unsigned char > cache_;
+
+  // Region of the slice that was changed through the cache
+  size_t cache_i_min_, cache_j_min_, cache_i_max_, cache_j_max_;
 };
 
 MaskVolumeSlice::MaskVolumeSlice( const MaskVolumeHandle& mask_volume, 
@@ -73,30 +76,50 @@ MaskVolumeSlice::~MaskVolumeSlice()
   this->disconnect_all();
 }
 
-static void CopyMaskData( const MaskVolumeSlice* slice, unsigned char* buffer, bool invert = false )
+static void CopyMaskData( const MaskVolumeSlice* slice, unsigned char* buffer, 
+  size_t i_min, size_t j_min, size_t nx, size_t ny, bool invert = false )
 {
-  size_t current_index = slice->to_index( 0, 0 );
+  size_t current_index = slice->to_index( i_min, j_min );
 
   // Index strides in X and Y direction. Use int instead of size_t because strides might be negative.
-  const int x_stride = slice->nx() > 1 ? static_cast< int >( slice->to_index( 1, 0 ) - current_index ) : 0;
-  const int y_stride = slice->ny() > 1 ? static_cast< int >( slice->to_index( 0, 1 ) - current_index ) : 0;
+  const int x_stride = slice->nx() > 1 ? static_cast< int >( slice->to_index( 1, 0 ) - 
+    slice->to_index( 0, 0 ) ) : 0;
+  const int y_stride = slice->ny() > 1 ? static_cast< int >( slice->to_index( 0, 1 ) - 
+    slice->to_index( 0, 0 ) ) : 0;
 
-  unsigned char* mask_data = slice->get_mask_data_block()->get_mask_data();
-  unsigned char mask_value = slice->get_mask_data_block()->get_mask_value();
-  const size_t nx = slice->nx();
-  const size_t ny = slice->ny();
+  MaskDataBlockHandle mask_data_block = slice->get_mask_data_block();
+  unsigned char mask_value = mask_data_block->get_mask_value();
 
   size_t row_start = current_index;
-  for ( size_t j = 0; j < ny; j++ )
+  if ( mask_data_block->is_sparse() )
   {
-    current_index = row_start;
-    for ( size_t i = 0; i < nx; i++ )
+    // Read a sparse mask from its chunks, so that displaying it does not expand it
+    for ( size_t j = 0; j < ny; j++ )
     {
-      buffer[ j * nx + i ] = mask_data[ current_index ] & mask_value ;
+      current_index = row_start;
+      for ( size_t i = 0; i < nx; i++ )
+      {
+        buffer[ j * nx + i ] = mask_data_block->get_mask_at( current_index ) ? mask_value : 0;
 
-      current_index += x_stride;
+        current_index += x_stride;
+      }
+      row_start += y_stride;
+    }
+  }
+  else
+  {
+    unsigned char* mask_data = mask_data_block->get_mask_data();
+    for ( size_t j = 0; j < ny; j++ )
+    {
+      current_index = row_start;
+      for ( size_t i = 0; i < nx; i++ )
+      {
+        buffer[ j * nx + i ] = mask_data[ current_index ] & mask_value ;
+
+        current_index += x_stride;
+      }
+      row_start += y_stride;
     }
-    row_start += y_stride;
   }
 
   if ( invert )
@@ -105,6 +128,11 @@ static void CopyMaskData( const MaskVolumeSlice* slice, unsigned char* buffer, b
   }
 }
 
+static void CopyMaskData( const MaskVolumeSlice* slice, unsigned char* buffer, bool invert = false )
+{
+  CopyMaskData( slice, buffer, 0, 0, slice->nx(), slice->ny(), invert );
+}
+
 void MaskVolumeSlice::upload_texture()
 {
   lock_type lock( this->get_mutex() );
@@ -129,6 +157,7 @@ void MaskVolumeSlice::upload_texture()
     tex->set_image( static_cast<int>( nx ), 
       static_cast<int>( ny ), GL_ALPHA );
     this->set_size_changed( false );
+    this->set_texture_generation( -1 );
   }
   
   if ( this->private_->using_cache_ )
@@ -137,9 +166,35 @@ void MaskVolumeSlice::upload_texture()
     tex->set_sub_image( 0, 0, static_cast<int>( nx ), 
       static_cast<int>( ny ), &this->private_->cache_[ 0 ], GL_ALPHA, GL_UNSIGNED_BYTE );
     tex->unbind();
+
+    // The texture no longer reflects the data in the mask
+    this->set_texture_generation( -1 );
   }
   else
   {
+    // NOTE: The generation is retrieved before locking the volume, hence if the data changes
+    // in between, the next upload will include the change again.
+    DataBlockHandle data_block = this->mask_data_block_->get_unexpanded_data_block();
+    DataBlock::generation_type generation = data_block->get_generation();
+
+    MaskDataBlock::shared_lock_type volume_lock( this->mask_data_block_->get_mutex() );
+
+    // Only upload the part of the slice that changed since the last upload
+    size_t i_min, j_min, i_max, j_max;
+    this->get_texture_update_region( data_block.get(), i_min, j_min, i_max, j_max );
+    this->set_texture_generation( generation );
+
+    if ( i_min > i_max || j_min > j_max )
+    {
+      // Nothing in this slice changed
+      tex->unbind();
+      this->set_slice_changed( false );
+      return;
+    }
+
+    nx = i_max - i_min + 1;
+    ny = j_max - j_min + 1;
+
     // Step 1. copy the data in the slice to a pixel unpack buffer
     PixelBufferObjectHandle pixel_buffer( new PixelUnpackBuffer );
     pixel_buffer->bind();
@@ -148,17 +203,14 @@ void MaskVolumeSlice::upload_texture()
     unsigned char* buffer = reinterpret_cast<unsigned char*>(
       pixel_buffer->map_buffer( GL_WRITE_ONLY ) );
 
-    {
-      MaskDataBlock::shared_lock_type volume_lock( 
-        this->mask_data_block_->get_mutex() );
-      CopyMaskData( this, buffer );
-    }
+    CopyMaskData( this, buffer, i_min, j_min, nx, ny );
+    volume_lock.unlock();
     
     // Step 2. copy from the pixel buffer to texture
     pixel_buffer->unmap_buffer();
     glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-    tex->set_sub_image( 0, 0, static_cast<int>( nx ), 
-      static_cast<int>( ny ), NULL, GL_ALPHA, GL_UNSIGNED_BYTE );
+    tex->set_sub_image( static_cast<int>( i_min ), static_cast<int>( j_min ), 
+      static_cast<int>( nx ), static_cast<int>( ny ), NULL, GL_ALPHA, GL_UNSIGNED_BYTE );
     tex->unbind();
 
     // Step 3. release the pixel unpack buffer
@@ -203,6 +255,12 @@ void MaskVolumeSlice::set_volume( const VolumeHandle& volume )
 }
 
 unsigned char* MaskVolumeSlice::get_cached_data()
+{
+  return this->get_cached_data( 0, 0, this->nx() - 1, this->ny() - 1 );
+}
+
+unsigned char* MaskVolumeSlice::get_cached_data( size_t i_min, size_t j_min, 
+  size_t i_max, size_t j_max )
 {
   ASSERT_IS_APPLICATION_THREAD();
 
@@ -219,6 +277,17 @@ unsigned char* MaskVolumeSlice::get_cached_data()
     }
 
     this->private_->using_cache_ = true;
+    this->private_->cache_i_min_ = i_min;
+    this->private_->cache_j_min_ = j_min;
+    this->private_->cache_i_max_ = i_max;
+    this->private_->cache_j_max_ = j_max;
+  }
+  else
+  {
+    this->private_->cache_i_min_ = Min( this->private_->cache_i_min_, i_min );
+    this->private_->cache_j_min_ = Min( this->private_->cache_j_min_, j_min );
+    this->private_->cache_i_max_ = Max( this->private_->cache_i_max_, i_max );
+    this->private_->cache_j_max_ = Max( this->private_->cache_j_max_, j_max );
   }
   
   return &this->private_->cache_[ 0 ];
@@ -280,7 +349,11 @@ void MaskVolumeSlice::release_cached_data()
   {
     MaskDataBlock::lock_type volume_lock( this->mask_data_block_->get_mutex() );
     CopyCachedDataBack( this, &this->private_->cache_[ 0 ] );
-    this->mask_data_block_->increase_generation();
+
+    IndexVector min, max;
+    this->get_slice_region( this->private_->cache_i_min_, this->private_->cache_j_min_,
+      this->private_->cache_i_max_, this->private_->cache_j_max_, min, max );
+    this->mask_data_block_->increase_generation( min, max );
   }
   
   this->private_->cache_.resize( 0 );
@@ -291,6 +364,13 @@ void MaskVolumeSlice::release_cached_data()
   this->mask_data_block_->mask_updated_signal_();
 }
 
+void MaskVolumeSlice::increase_slice_generation()
+{
+  IndexVector min, max;
+  this->get_slice_region( min, max );
+  this->mask_data_block_->increase_generation( min, max );
+}
+
 bool MaskVolumeSlice::get_mask_at( size_t i, size_t j ) const
 {
   lock_type lock( this->get_mutex() );
@@ -343,7 +423,7 @@ void MaskVolumeSlice::set_slice_data( const unsigned char* buffer, bool trigger_
       CopyCachedDataBack( this, buffer );
       if ( trigger_update )
       {
-        this->mask_data_block_->increase_generation();
+        this->increase_slice_generation();
       }
     }
   }
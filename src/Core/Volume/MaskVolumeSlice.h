@@ -79,8 +79,15 @@ public:
 
   // GET_CACHED_DATA:
   /// Return a pointer to the cached data of the current slice.
+  /// The whole slice will be marked as changed when the cache is released.
   unsigned char* get_cached_data();
 
+  // GET_CACHED_DATA:
+  /// Return a pointer to the cached data of the current slice, to change only the pixels from 
+  /// (i_min, j_min) up to and including (i_max, j_max). When the cache is released, only the
+  /// regions of all the calls are marked as changed.
+  unsigned char* get_cached_data( size_t i_min, size_t j_min, size_t i_max, size_t j_max );
+
   // RELEASE_CACHED_DATA:
   /// Sync the cached data back to the mask volume and then release the memory.
   void release_cached_data();
@@ -104,6 +111,11 @@ public:
   cache_updated_signal_type cache_updated_signal_;
 
 private:
+  // INCREASE_SLICE_GENERATION:
+  /// Increase the generation of the mask data block, marking only this slice as changed.
+  /// NOTE: The caller needs to hold a write lock on the mask data block.
+  void increase_slice_generation();
+
   ///  Pointer to the mask data block. The base class keeps a handle of the volume,
   /// so it's safe to use a pointer here.
   MaskDataBlock* mask_data_block_;
@@ -52,7 +52,8 @@ public:
     grid_ny_( volume->get_ny() ),
     grid_nz_( volume->get_nz() ),
     slice_type_( type ), 
-    slice_number_ ( slice_num )
+    slice_number_ ( slice_num ),
+    texture_generation_( -1 )
   {
   }
 
@@ -78,7 +79,8 @@ public:
     grid_ny_( copy.grid_ny_ ),
     grid_nz_( copy.grid_nz_ ),
     slice_type_( copy.slice_type_ ),
-    slice_number_( copy.slice_number_ )
+    slice_number_( copy.slice_number_ ),
+    texture_generation_( copy.texture_generation_ )
   {
   }
 
@@ -126,6 +128,9 @@ public:
   VolumeSliceType slice_type_;
   size_t slice_number_;
   VolumeSlice* slice_;
+
+  /// Generation of the data block that is currently in the texture
+  DataBlock::generation_type texture_generation_;
 };
 
 void VolumeSlicePrivate::update_dimension()
@@ -243,6 +248,7 @@ void VolumeSlice::set_slice_type( VolumeSliceType type )
     this->private_->slice_changed_ = true;
     this->private_->size_changed_ = true;
     this->private_->slice_type_ = type;
+    this->private_->texture_generation_ = -1;
 
     this->private_->update_dimension();
     this->private_->slice_number_ = Min( this->private_->slice_number_, 
@@ -264,6 +270,7 @@ void VolumeSlice::set_slice_number( size_t slice_num )
   {
     this->private_->slice_number_ = slice_num;
     this->private_->slice_changed_ = true;
+    this->private_->texture_generation_ = -1;
     this->private_->update_position();
   }
 }
@@ -281,6 +288,38 @@ size_t VolumeSlice::to_index( size_t i, size_t j ) const
   }
 }
 
+void VolumeSlice::get_slice_region( size_t i_min, size_t j_min, size_t i_max, size_t j_max,
+  IndexVector& min, IndexVector& max ) const
+{
+  const IndexVector::index_type slice_number = 
+    static_cast< IndexVector::index_type >( this->private_->slice_number_ );
+  const IndexVector::index_type i0 = static_cast< IndexVector::index_type >( i_min );
+  const IndexVector::index_type j0 = static_cast< IndexVector::index_type >( j_min );
+  const IndexVector::index_type i1 = static_cast< IndexVector::index_type >( i_max );
+  const IndexVector::index_type j1 = static_cast< IndexVector::index_type >( j_max );
+
+  switch ( this->private_->slice_type_ )
+  {
+  case VolumeSliceType::AXIAL_E:
+    min = IndexVector( i0, j0, slice_number );
+    max = IndexVector( i1, j1, slice_number );
+    break;
+  case VolumeSliceType::CORONAL_E:
+    min = IndexVector( i0, slice_number, j0 );
+    max = IndexVector( i1, slice_number, j1 );
+    break;
+  default:
+    min = IndexVector( slice_number, i0, j0 );
+    max = IndexVector( slice_number, i1, j1 );
+    break;
+  }
+}
+
+void VolumeSlice::get_slice_region( IndexVector& min, IndexVector& max ) const
+{
+  this->get_slice_region( 0, 0, this->private_->nx_ - 1, this->private_->ny_ - 1, min, max );
+}
+
 void VolumeSlice::to_index( size_t i, size_t j, Point& index ) const
 {
   switch ( this->private_->slice_type_ )
@@ -463,6 +502,7 @@ void VolumeSlice::set_volume( const VolumeHandle& volume )
   this->disconnect_all();
   this->private_->volume_ = volume;
   this->private_->slice_changed_ = true;
+  this->private_->texture_generation_ = -1;
 }
 
 VolumeHandle VolumeSlice::get_volume() const
@@ -589,6 +629,59 @@ void VolumeSlice::set_size_changed( bool changed )
   this->private_->size_changed_ = changed;
 }
 
+bool VolumeSlice::get_texture_update_region( const DataBlock* data_block, size_t& i_min, 
+  size_t& j_min, size_t& i_max, size_t& j_max ) const
+{
+  i_min = 0;
+  j_min = 0;
+  i_max = this->private_->nx_ - 1;
+  j_max = this->private_->ny_ - 1;
+
+  IndexVector min, max;
+  if ( this->private_->texture_generation_ < 0 || this->private_->size_changed_ ||
+    !data_block->get_changed_region( this->private_->texture_generation_, min, max ) )
+  {
+    return false;
+  }
+
+  // Axes of the volume that map onto the i, j and depth axis of the slice
+  size_t i_axis, j_axis, depth_axis;
+  switch ( this->private_->slice_type_ )
+  {
+  case VolumeSliceType::AXIAL_E:
+    i_axis = 0; j_axis = 1; depth_axis = 2;
+    break;
+  case VolumeSliceType::CORONAL_E:
+    i_axis = 0; j_axis = 2; depth_axis = 1;
+    break;
+  default:
+    i_axis = 1; j_axis = 2; depth_axis = 0;
+    break;
+  }
+
+  const IndexVector::index_type slice_number = 
+    static_cast< IndexVector::index_type >( this->private_->slice_number_ );
+  if ( slice_number < min[ depth_axis ] || slice_number > max[ depth_axis ] ||
+    min[ i_axis ] > max[ i_axis ] || min[ j_axis ] > max[ j_axis ] )
+  {
+    // Nothing changed in this slice
+    i_min = 1;
+    i_max = 0;
+    return true;
+  }
+
+  i_min = static_cast< size_t >( min[ i_axis ] );
+  j_min = static_cast< size_t >( min[ j_axis ] );
+  i_max = static_cast< size_t >( max[ i_axis ] );
+  j_max = static_cast< size_t >( max[ j_axis ] );
+  return true;
+}
+
+void VolumeSlice::set_texture_generation( DataBlock::generation_type generation )
+{
+  this->private_->texture_generation_ = generation;
+}
+
 bool VolumeSlice::is_valid() const
 {
   lock_type lock( this->get_mutex() );
@@ -32,6 +32,7 @@
 #include <boost/shared_ptr.hpp>
 
 #include <Core/DataBlock/SliceType.h>
+#include <Core/Geometry/IndexVector.h>
 #include <Core/Geometry/Point.h>
 #include <Core/Graphics/Texture.h>
 #include <Core/Utils/ConnectionHandler.h>
@@ -92,6 +93,14 @@ public:
   /// Returns the linear index of the point in the volume
   size_t to_index( size_t i, size_t j ) const;
 
+  /// Get the box in the volume that is covered by the rectangle [i_min, i_max] x [j_min, j_max]
+  /// of the slice.
+  void get_slice_region( size_t i_min, size_t j_min, size_t i_max, size_t j_max,
+    IndexVector& min, IndexVector& max ) const;
+
+  /// Get the box in the volume that is covered by the whole slice.
+  void get_slice_region( IndexVector& min, IndexVector& max ) const;
+
   /// Get the index of the point that's closest to the given position in world space
   /// NOTE: the indices returned can be out of the slice boundary.
   void world_to_index( double i_pos, double j_pos, int& i, int& j ) const;
@@ -164,6 +173,19 @@ protected:
   bool get_size_changed();
   void set_size_changed( bool );
 
+  // GET_TEXTURE_UPDATE_REGION:
+  /// Get the rectangle of the slice, in slice indices, that changed in the data block since the
+  /// texture was last uploaded. Returns false if the whole slice needs to be uploaded. If
+  /// nothing in the slice changed, i_min will be larger than i_max.
+  /// NOTE: The caller needs to hold a lock on the data block.
+  bool get_texture_update_region( const DataBlock* data_block, size_t& i_min, size_t& j_min,
+    size_t& i_max, size_t& j_max ) const;
+
+  // SET_TEXTURE_GENERATION:
+  /// Record the generation of the data block that was uploaded to the texture. Use -1 to
+  /// force the whole slice to be uploaded the next time.
+  void set_texture_generation( DataBlock::generation_type generation );
+
 private:
   friend class VolumeSlicePrivate;
   VolumeSlicePrivateHandle private_;
@@ -266,6 +266,8 @@ void PreferencesInterface::setup_layer_prefs()
     PreferencesManager::Instance()->default_mask_fill_state_ );
   QtUtils::QtBridge::Connect( this->private_->ui_.mask_border_combobox_, 
     PreferencesManager::Instance()->default_mask_border_state_ );
+  QtUtils::QtBridge::Connect( this->private_->ui_.isosurface_budget_spinbox_, 
+    PreferencesManager::Instance()->isosurface_triangle_budget_state_ );
   
   this->connect( this->private_->ui_.revert_to_defaults_button_, SIGNAL( clicked() ), 
     this, SLOT( set_buttons_to_default_colors () ) );
@@ -369,6 +371,8 @@ void PreferencesInterface::setup_large_volume_prefs()
 {
   this->private_->ui_.large_volume_checkbox_->setChecked( PreferencesManager::Instance()->enable_large_volume_state_->get() );
   QtUtils::QtBridge::Connect( this->private_->ui_.large_volume_checkbox_, PreferencesManager::Instance()->enable_large_volume_state_ );
+  QtUtils::QtBridge::Connect( this->private_->ui_.large_volume_cache_spinbox_, 
+    PreferencesManager::Instance()->large_volume_cache_gb_state_ );
 }
 
 void PreferencesInterface::set_autosave_checked_state( bool state )
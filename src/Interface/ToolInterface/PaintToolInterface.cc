@@ -115,6 +115,8 @@ bool PaintToolInterface::build_widget( QFrame* frame )
     tool->erase_state_ );
   QtUtils::QtBridge::Connect( this->private_->ui_.show_boundary_,
     tool->show_data_cstr_bound_state_ );
+  QtUtils::QtBridge::Connect( this->private_->ui_.flood_fill_3d_,
+    tool->flood_fill_3d_state_ );
   QtUtils::QtBridge::Enable( this->private_->ui_.target_mask_,
     tool->use_active_layer_state_, true );
   QtUtils::QtBridge::Connect( this->private_->ui_.floodfill_button_, boost::bind(
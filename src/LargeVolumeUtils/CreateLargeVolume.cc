@@ -68,7 +68,13 @@ void printUsage()
   std::cout << "  --bricksize=VECTOR | SCALAR  - Brick size, default is 256,256,256." << std::endl
             << "                                 Size of bricks can be set with single number (--bricksize=512 for 512,512,512 brick)." << std::endl;
   std::cout << "  --overlap=SCALAR             - Overlap betweeen the bricks, default is 1." << std::endl;
-  std::cout << "  --nodownsample=CHAR          - Do not downsample in given direction (x,y, or z)." << std::endl << std::endl;
+  std::cout << "  --nodownsample=CHAR          - Do not downsample in given direction (x,y, or z)." << std::endl;
+  std::cout << "  --codec=STRING               - Brick compression codec (none, zlib or lz4), default is zlib." << std::endl
+            << "                                 lz4 compresses less, but decompresses several times faster." << std::endl;
+  std::cout << "  --shuffle                    - Shuffle the bytes of 16 bit, 32 bit and floating point data" << std::endl
+            << "                                 before compression, which usually improves compression." << std::endl;
+  std::cout << "  --shards                     - Store the bricks of each level in a single shard file with an" << std::endl
+            << "                                 offset index, instead of one file per brick." << std::endl << std::endl;
   std::cout << "Tool parameters (optional):" << std::endl;
   std::cout << "  --maxgb=SCALAR               - Maximum number of GB to use for conversion, default is based on available memory." << std::endl;
   std::cout << "  --silent                     - Do not wait for user input to continue." << std::endl;
@@ -249,6 +255,24 @@ int main( int argc, char **argv )
     if ( nodownsample == "z" ) down_sample_z = false;
   }
   
+  // -- compression --
+  Core::BrickCodecType codec = Core::BrickCodecType::ZLIB_E;
+  std::string codec_string;
+  if ( Core::Application::Instance()->check_command_line_parameter( "codec" , codec_string ) )
+  {
+    if (! Core::ImportFromString( codec_string, codec ) )
+    {
+      printUsage();
+      CORE_PRINT_AND_LOG_ERROR("Codec needs to be none, zlib or lz4.");
+      return -1;
+    }
+  }
+  
+  bool shuffle = Core::Application::Instance()->is_command_line_parameter( "shuffle" );
+
+  // -- container --
+  bool sharded = Core::Application::Instance()->is_command_line_parameter( "shards" );
+  
   long long mem_limit = 0;
   if ( sizeof(void *) == 4 )
   {
@@ -303,6 +327,8 @@ int main( int argc, char **argv )
   converter->set_first_file( first_file );
   converter->set_schema_parameters( spacing, origin, brick_size, overlap );
   converter->get_schema()->enable_downsample( down_sample_x, down_sample_y, down_sample_z );
+  converter->set_codec( codec, shuffle );
+  converter->set_sharded( sharded );
   converter->set_mem_limit( mem_limit );
   
   // Scan files and compute schema
@@ -326,6 +352,9 @@ int main( int argc, char **argv )
   std::cout << "Brick Size:         " << Core::ExportToString( schema->get_brick_size() ) << std::endl;
   std::cout << "Overlap:            " << Core::ExportToString( schema->get_overlap() ) << std::endl;
   std::cout << "Resolution Levels:  " << Core::ExportToString( schema->get_num_levels() ) << std::endl;
+  std::cout << "Codec:              " << Core::ExportToString( schema->get_codec() )
+            << ( schema->get_shuffle() ? " (shuffled)" : "" ) << std::endl;
+  std::cout << "Container:          " << ( schema->is_sharded() ? "shards" : "files" ) << std::endl;
   std::cout << "Memory Usage Limit: " << Core::ExportToString( mem_limit >> 30 ) << " GB" << std::endl;
   if (nodownsample.size())
   {
@@ -231,6 +231,7 @@ void Seg3DBase::print_usage()
   std::cout << "  --nosplash              - Run without opening the splash screen." << std::endl;
   std::cout << "  --headless              - Run without opening the GUI." << std::endl;
   std::cout << "  --logging=FILE          - Log to the specified file." << std::endl;
+  std::cout << "  --cachegb=SCALAR        - Memory in GB used for caching large volume bricks." << std::endl;
   std::cout << "  --help                  - Print this usage message." << std::endl << std::endl;
 }
 